@@ -16,6 +16,9 @@
 
 #include "frame_source_queue.h"
 
+#include <algorithm>
+#include <chrono>
+#include <thread>
 #include <utility>
 
 #include <ndash.h>
@@ -64,6 +67,9 @@ constexpr AVRational kMicroseconds = {1, 1000000};
 // TODO(rdaum): This is a constant right now but should be returned by libdash.
 constexpr AVRational kTimebase = {1, 90000};
 
+// How long the decoder waits for the audio callback to make room.
+constexpr std::chrono::milliseconds kAudioBufferFullWait{5};
+
 }  // namespace
 
 FrameSourceQueue::FrameSourceQueue(NDashStream* dash_stream,
@@ -335,13 +341,13 @@ bool FrameSourceQueue::PullFrames(int out_sample_rate,
     DashFrameInfo frame_info;
     av_init_packet(&packet);
 
-    std::vector<uint8_t> frame_buffer;
+    util::BufferPool::Buffer frame_buffer = frame_buffers_.Acquire();
     size_t frame_bytes_size =
-        dash_stream_->ReadFrameInto(&frame_buffer, &frame_info);
+        dash_stream_->ReadFrameInto(frame_buffer.get(), &frame_info);
     if (!frame_bytes_size) {
       continue;
     }
-    packet.data = frame_buffer.data();
+    packet.data = frame_buffer->data();
     packet.pts = frame_info.pts;
     packet.duration = frame_info.duration;
     packet.size = (int)frame_bytes_size;
@@ -397,7 +403,29 @@ bool FrameSourceQueue::PullFrames(int out_sample_rate,
       int64_t pts_microseconds =
           av_rescale_q(frame->pts, kTimebase, kMicroseconds);
 
-      audio_buffer_.Write(dst_bufsize, dst_data[0], pts_microseconds);
+      // The audio callback drains the ring; wait for it rather than drop
+      // samples when we get ahead of playback. A frame too big for the ring
+      // to ever have room for is written a whole number of samples at a
+      // time, each piece with its own PTS.
+      const int sample_bytes =
+          audio_output_num_channels *
+          av_get_bytes_per_sample(audio_output_sample_format);
+      const size_t max_write =
+          audio_buffer_.capacity() / sample_bytes * sample_bytes;
+      size_t written = 0;
+      while (written < static_cast<size_t>(dst_bufsize) && running_) {
+        size_t size =
+            std::min(static_cast<size_t>(dst_bufsize) - written, max_write);
+        int64_t pts = pts_microseconds +
+                      av_rescale_q(written / sample_bytes,
+                                   AVRational{1, out_sample_rate},
+                                   kMicroseconds);
+        while (!audio_buffer_.Write(size, dst_data[0] + written, pts) &&
+               running_) {
+          std::this_thread::sleep_for(kAudioBufferFullWait);
+        }
+        written += size;
+      }
 
       av_free(dst_data[0]);
     }
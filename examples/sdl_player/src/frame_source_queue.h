@@ -36,6 +36,7 @@ extern "C" {
 
 #include "ndash.h"
 #include "ndash_stream.h"
+#include "util/buffer_pool.h"
 #include "util/byte_buffer.h"
 #include "util/statusor.h"
 
@@ -102,6 +103,8 @@ class FrameSourceQueue {
   std::mutex frame_queue_mutex_;
   std::queue<AVFramePtr> video_output_frames;
 
+  // Compressed frames are copied out of ndash into recycled buffers.
+  util::BufferPool frame_buffers_;
   util::PtsByteBuffer audio_buffer_;
 };
 
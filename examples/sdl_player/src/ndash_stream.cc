@@ -16,6 +16,8 @@
 
 #include "ndash_stream.h"
 
+#include <algorithm>
+
 #include <gflags/gflags.h>
 #include <glog/logging.h>
 
@@ -24,7 +26,10 @@ namespace player {
 
 namespace {
 
-constexpr size_t kMaxFrameBufferLen = 32768;
+// Enough for most audio frames and smaller video frames, so they are copied in
+// a single ndash_copy_frame() call. Larger frames grow the buffer, which keeps
+// that capacity when it is recycled.
+constexpr size_t kInitialFrameBufferLen = 32768;
 
 }  // namespace
 
@@ -116,17 +121,34 @@ bool NDashStream::GetAudioCodecSettings(
 
 size_t NDashStream::ReadFrameInto(std::vector<uint8_t>* frame_buffer,
                                   DashFrameInfo* frame_info) {
-  // Assess the available frame buffer data.
-  // TODO(rdaum): turn this into an API call for peek instead of abusing
-  // CopyFrame
-  DashFrameInfo tmp_frame_info;
-  ndash_copy_frame(player_handle_, nullptr, 0, &tmp_frame_info);
-  size_t available = (size_t)tmp_frame_info.frame_len;
-  frame_buffer->resize(available);
-  size_t read_size = static_cast<size_t>(ndash_copy_frame(
-      player_handle_, frame_buffer->data(), available, frame_info));
-
-  return read_size;
+  // Copy straight into whatever capacity the buffer already has; only a frame
+  // that doesn't fit needs a second call for the remainder.
+  frame_buffer->resize(
+      std::max(frame_buffer->capacity(), kInitialFrameBufferLen));
+  int copied = ndash_copy_frame(player_handle_, frame_buffer->data(),
+                                frame_buffer->size(), frame_info);
+  if (copied <= 0) {
+    frame_buffer->clear();
+    return 0;
+  }
+  size_t total = static_cast<size_t>(copied);
+  while (!(frame_info->flags & DASH_FRAME_INFO_FLAG_LAST_FRAGMENT)) {
+    frame_buffer->resize(
+        std::max(static_cast<size_t>(frame_info->frame_len), total + 1));
+    DashFrameInfo fragment_info;
+    copied = ndash_copy_frame(player_handle_, frame_buffer->data() + total,
+                              frame_buffer->size() - total, &fragment_info);
+    if (copied <= 0) {
+      LOG(WARNING) << "Frame copy stopped after " << total << " of "
+                   << frame_info->frame_len << " bytes";
+      frame_buffer->clear();
+      return 0;
+    }
+    total += copied;
+    frame_info->flags |= fragment_info.flags;
+  }
+  frame_buffer->resize(total);
+  return total;
 }
 
 void NDashStream::DecoderFlush() {
@@ -0,0 +1,62 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "util/buffer_pool.h"
+
+namespace util {
+
+void BufferPool::Releaser::operator()(std::vector<uint8_t>* buffer) const {
+  if (pool_) {
+    pool_->Release(buffer);
+  } else {
+    delete buffer;
+  }
+}
+
+BufferPool::BufferPool(size_t max_pooled) : max_pooled_(max_pooled) {}
+
+BufferPool::~BufferPool() {}
+
+BufferPool::Buffer BufferPool::Acquire() {
+  std::unique_ptr<std::vector<uint8_t>> buffer;
+  {
+    std::lock_guard<std::mutex> lock(lock_);
+    if (!free_.empty()) {
+      buffer = std::move(free_.back());
+      free_.pop_back();
+    }
+  }
+  if (!buffer) {
+    buffer.reset(new std::vector<uint8_t>);
+  }
+  return Buffer(buffer.release(), Releaser(this));
+}
+
+size_t BufferPool::pooled() const {
+  std::lock_guard<std::mutex> lock(lock_);
+  return free_.size();
+}
+
+void BufferPool::Release(std::vector<uint8_t>* buffer) {
+  std::unique_ptr<std::vector<uint8_t>> owned(buffer);
+  owned->clear();
+  std::lock_guard<std::mutex> lock(lock_);
+  if (free_.size() < max_pooled_) {
+    free_.push_back(std::move(owned));
+  }
+}
+
+}  // namespace util
@@ -0,0 +1,62 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef UTIL_BUFFER_POOL_H_
+#define UTIL_BUFFER_POOL_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace util {
+
+// Recycles byte buffers, so a steady stream of similarly sized frames is
+// copied without an allocation per frame. Buffers keep their capacity while
+// pooled. The pool must outlive the buffers it hands out.
+class BufferPool {
+ public:
+  class Releaser {
+   public:
+    explicit Releaser(BufferPool* pool = nullptr) : pool_(pool) {}
+    void operator()(std::vector<uint8_t>* buffer) const;
+
+   private:
+    BufferPool* pool_;
+  };
+  typedef std::unique_ptr<std::vector<uint8_t>, Releaser> Buffer;
+
+  // At most 'max_pooled' idle buffers are kept; the rest are freed.
+  explicit BufferPool(size_t max_pooled = 4);
+  ~BufferPool();
+
+  // Returns an empty buffer, which goes back to the pool when released.
+  Buffer Acquire();
+
+  // Return the number of idle buffers.
+  size_t pooled() const;
+
+ private:
+  void Release(std::vector<uint8_t>* buffer);
+
+  const size_t max_pooled_;
+  mutable std::mutex lock_;
+  std::vector<std::unique_ptr<std::vector<uint8_t>>> free_;
+};
+}
+
+#endif  // UTIL_BUFFER_POOL_H_
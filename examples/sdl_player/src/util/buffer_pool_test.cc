@@ -0,0 +1,55 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "util/buffer_pool.h"
+
+#include "gtest/gtest.h"
+
+namespace util {
+
+TEST(BufferPoolTest, ReusesReleasedBuffers) {
+  BufferPool pool;
+  const uint8_t* data;
+  {
+    BufferPool::Buffer buffer = pool.Acquire();
+    buffer->resize(1000);
+    data = buffer->data();
+    EXPECT_EQ(pool.pooled(), 0);
+  }
+  EXPECT_EQ(pool.pooled(), 1);
+
+  // The same storage comes back, emptied but with its capacity intact.
+  BufferPool::Buffer buffer = pool.Acquire();
+  EXPECT_EQ(pool.pooled(), 0);
+  EXPECT_TRUE(buffer->empty());
+  EXPECT_GE(buffer->capacity(), 1000);
+  buffer->resize(1000);
+  EXPECT_EQ(buffer->data(), data);
+}
+
+TEST(BufferPoolTest, KeepsAtMostMaxPooled) {
+  BufferPool pool(2);
+  {
+    BufferPool::Buffer one = pool.Acquire();
+    BufferPool::Buffer two = pool.Acquire();
+    BufferPool::Buffer three = pool.Acquire();
+    EXPECT_NE(one.get(), two.get());
+    EXPECT_NE(two.get(), three.get());
+  }
+  EXPECT_EQ(pool.pooled(), 2);
+}
+
+}  // namespace util
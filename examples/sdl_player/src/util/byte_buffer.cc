@@ -17,68 +17,107 @@
 #include "util/byte_buffer.h"
 
 #include <memory.h>
-#include <cassert>
+#include <algorithm>
 
 #include <glog/logging.h>
 
 namespace util {
 
-void PtsByteBuffer::Write(const size_t buffer_size,
+constexpr size_t PtsByteBuffer::kDefaultCapacity;
+constexpr size_t PtsByteBuffer::kDefaultMaxMarkers;
+
+PtsByteBuffer::PtsByteBuffer(size_t capacity, size_t max_markers)
+    : capacity_(capacity),
+      max_markers_(max_markers),
+      data_(new uint8_t[capacity]),
+      markers_(new pos_pts[max_markers]),
+      write_pos_(0),
+      read_pos_(0),
+      marker_write_pos_(0),
+      marker_read_pos_(0) {
+  CHECK_GT(capacity, 0);
+  CHECK_GT(max_markers, 0);
+}
+
+bool PtsByteBuffer::Write(const size_t buffer_size,
                           const uint8_t* data,
                           const int64_t pts) {
-  std::lock_guard<std::mutex> lock(byte_stream_lock_);
-  byte_stream_.insert(byte_stream_.end(), data, data + buffer_size);
-  pts_pos_.emplace_back(pos_pts{pts, buffer_size});
+  uint64_t write_pos = write_pos_.load(std::memory_order_relaxed);
+  uint64_t marker_write_pos = marker_write_pos_.load(std::memory_order_relaxed);
+  if (write_pos + buffer_size -
+              read_pos_.load(std::memory_order_acquire) >
+          capacity_ ||
+      marker_write_pos - marker_read_pos_.load(std::memory_order_acquire) >=
+          max_markers_) {
+    return false;
+  }
+
+  // At most two copies: up to the end of the ring, then from its start.
+  size_t offset = write_pos % capacity_;
+  size_t first = std::min(buffer_size, capacity_ - offset);
+  memcpy(data_.get() + offset, data, first);
+  memcpy(data_.get(), data + first, buffer_size - first);
+
+  markers_[marker_write_pos % max_markers_] =
+      pos_pts{pts, write_pos + buffer_size};
+  // The marker is published first, so a reader that sees the data also sees
+  // its PTS.
+  marker_write_pos_.store(marker_write_pos + 1, std::memory_order_release);
+  write_pos_.store(write_pos + buffer_size, std::memory_order_release);
+  return true;
 }
 
 size_t PtsByteBuffer::Read(size_t requested_amount,
                            uint8_t* buffer,
                            int64_t* pts) {
-  std::lock_guard<std::mutex> lock(byte_stream_lock_);
-  if (pts_pos_.empty()) {
+  uint64_t read_pos = read_pos_.load(std::memory_order_relaxed);
+  uint64_t write_pos = write_pos_.load(std::memory_order_acquire);
+  uint64_t marker_read_pos = marker_read_pos_.load(std::memory_order_relaxed);
+  if (marker_read_pos == marker_write_pos_.load(std::memory_order_acquire)) {
     return 0;
   }
-  if (requested_amount > byte_stream_.size()) {
-    requested_amount = byte_stream_.size();
-  }
-  if (requested_amount) {
-    std::copy(byte_stream_.begin(), byte_stream_.begin() + requested_amount,
-              buffer);
-    byte_stream_.erase(byte_stream_.begin(),
-                       byte_stream_.begin() + requested_amount);
-  }
-  size_t consumed_pts_bytes_amount = requested_amount;
-  *pts = pts_pos_.front().pts;
-  while (!pts_pos_.empty()) {
-    size_t& front_avail_bytes = pts_pos_.front().available_bytes;
-    if (front_avail_bytes <= consumed_pts_bytes_amount) {
-      consumed_pts_bytes_amount -= front_avail_bytes;
-      pts_pos_.pop_front();
-    } else {
-      front_avail_bytes -= consumed_pts_bytes_amount;
-      break;
-    }
+  if (requested_amount > write_pos - read_pos) {
+    requested_amount = write_pos - read_pos;
   }
+
+  size_t offset = read_pos % capacity_;
+  size_t first = std::min(requested_amount, capacity_ - offset);
+  memcpy(buffer, data_.get() + offset, first);
+  memcpy(buffer + first, data_.get(), requested_amount - first);
+
+  *pts = markers_[marker_read_pos % max_markers_].pts;
+  Consume(read_pos + requested_amount);
   return requested_amount;
 }
 
 size_t PtsByteBuffer::Available() const {
-  std::lock_guard<std::mutex> lock(byte_stream_lock_);
-  return byte_stream_.size();
+  return write_pos_.load(std::memory_order_acquire) -
+         read_pos_.load(std::memory_order_acquire);
 }
 
 void PtsByteBuffer::Flush() {
-  std::lock_guard<std::mutex> lock(byte_stream_lock_);
-  byte_stream_.clear();
-  pts_pos_.clear();
+  Consume(write_pos_.load(std::memory_order_acquire));
 }
 
 size_t PtsByteBuffer::PtsDataAvailable() const {
-  size_t total_avail(0);
-  for (auto& pts_pos : pts_pos_) {
-    total_avail += pts_pos.available_bytes;
+  uint64_t marker_read_pos = marker_read_pos_.load(std::memory_order_acquire);
+  uint64_t marker_write_pos = marker_write_pos_.load(std::memory_order_acquire);
+  if (marker_read_pos == marker_write_pos) {
+    return 0;
+  }
+  return markers_[(marker_write_pos - 1) % max_markers_].end -
+         read_pos_.load(std::memory_order_acquire);
+}
+
+void PtsByteBuffer::Consume(uint64_t position) {
+  uint64_t marker_read_pos = marker_read_pos_.load(std::memory_order_relaxed);
+  uint64_t marker_write_pos = marker_write_pos_.load(std::memory_order_acquire);
+  while (marker_read_pos != marker_write_pos &&
+         markers_[marker_read_pos % max_markers_].end <= position) {
+    marker_read_pos++;
   }
-  return total_avail;
+  marker_read_pos_.store(marker_read_pos, std::memory_order_release);
+  read_pos_.store(position, std::memory_order_release);
 }
 
 }  // namespace util
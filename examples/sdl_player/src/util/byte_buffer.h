@@ -17,18 +17,32 @@
 #ifndef UTIL_BYTE_BUFFER_H_
 #define UTIL_BYTE_BUFFER_H_
 
+#include <atomic>
+#include <cstddef>
 #include <cstdint>
-#include <deque>
-#include <mutex>
+#include <memory>
 
 namespace util {
 
-// A simple byte buffer which keeps the data portions in it in sync with the PTS
-// of the data they were originally associated with.
+// A byte buffer which keeps the data portions in it in sync with the PTS of
+// the data they were originally associated with.
+//
+// The data lives in a fixed size ring, with the PTS of each write kept as a
+// marker in a second ring. It is lock free for one writer thread (the decoder)
+// and one reader thread (the audio callback): Write() is only called by the
+// former and Read() and Flush() only by the latter.
 class PtsByteBuffer {
  public:
+  // About 5 seconds of 48kHz stereo 16 bit audio.
+  static constexpr size_t kDefaultCapacity = 1 << 20;
+  static constexpr size_t kDefaultMaxMarkers = 4096;
+
+  explicit PtsByteBuffer(size_t capacity = kDefaultCapacity,
+                         size_t max_markers = kDefaultMaxMarkers);
+
   // Add data of 'buffer_size' to the buffer, and associate it with 'pts'.
-  void Write(const size_t buffer_size, const uint8_t* data, const int64_t pts);
+  // Returns false, adding nothing, if there isn't room for all of it.
+  bool Write(const size_t buffer_size, const uint8_t* data, const int64_t pts);
 
   // Remove data up to 'requested_amount' from the buffer if it is available,
   // and copy it into 'buffer'.
@@ -42,18 +56,33 @@ class PtsByteBuffer {
   // Flushes all data and PTS values from the buffer.
   void Flush();
 
-  // Return the number of bytes available according to the pts_pos_ queue.
+  // Return the number of bytes available according to the PTS markers.
   size_t PtsDataAvailable() const;
 
+  size_t capacity() const { return capacity_; }
+
  private:
   struct pos_pts {
     int64_t pts;
-    size_t available_bytes;
+    // Stream position one past the last byte written with 'pts'.
+    uint64_t end;
   };
 
-  mutable std::mutex byte_stream_lock_;
-  std::deque<uint8_t> byte_stream_;
-  std::deque<pos_pts> pts_pos_;
+  // Drops the data before stream position 'position', and the markers that
+  // only cover that data.
+  void Consume(uint64_t position);
+
+  const size_t capacity_;
+  const size_t max_markers_;
+  std::unique_ptr<uint8_t[]> data_;
+  std::unique_ptr<pos_pts[]> markers_;
+
+  // Positions in the byte and marker streams; they only grow, and index the
+  // rings modulo their sizes. Each is stored only by the thread that owns it.
+  std::atomic<uint64_t> write_pos_;
+  std::atomic<uint64_t> read_pos_;
+  std::atomic<uint64_t> marker_write_pos_;
+  std::atomic<uint64_t> marker_read_pos_;
 };
 }
 
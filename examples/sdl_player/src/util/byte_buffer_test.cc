@@ -16,6 +16,9 @@
 
 #include "util/byte_buffer.h"
 
+#include <thread>
+#include <vector>
+
 #include "gtest/gtest.h"
 
 namespace util {
@@ -198,4 +201,103 @@ TEST(ByteBufferTest, PtsPushPopPtsMixedReadWrites) {
   EXPECT_EQ(buffer.Available(), buffer.PtsDataAvailable());
 }
 
+
+TEST(ByteBufferTest, WriteFailsWhenFull) {
+  PtsByteBuffer buffer(8, 3);
+  const uint8_t data[] = "abcdefgh";
+  EXPECT_TRUE(buffer.Write(5, data, 1));
+  EXPECT_FALSE(buffer.Write(4, data, 2));
+  EXPECT_EQ(buffer.Available(), 5);
+
+  // Running out of PTS markers also counts as full.
+  EXPECT_TRUE(buffer.Write(1, data, 2));
+  EXPECT_TRUE(buffer.Write(1, data, 3));
+  EXPECT_FALSE(buffer.Write(1, data, 4));
+  EXPECT_EQ(buffer.Available(), 7);
+
+  // Reading makes room again.
+  uint8_t read_buffer[8];
+  int64_t pts;
+  EXPECT_EQ(buffer.Read(5, read_buffer, &pts), 5);
+  EXPECT_EQ(pts, 1);
+  EXPECT_TRUE(buffer.Write(4, data, 4));
+}
+
+TEST(ByteBufferTest, WrapsAround) {
+  PtsByteBuffer buffer(8);
+  uint8_t read_buffer[8];
+  int64_t pts;
+  EXPECT_TRUE(buffer.Write(6, reinterpret_cast<const uint8_t*>("abcdef"), 1));
+  EXPECT_EQ(buffer.Read(5, read_buffer, &pts), 5);
+
+  // This write straddles the end of the ring.
+  EXPECT_TRUE(buffer.Write(6, reinterpret_cast<const uint8_t*>("ghijkl"), 2));
+  EXPECT_EQ(buffer.Available(), 7);
+  EXPECT_EQ(buffer.Read(sizeof(read_buffer), read_buffer, &pts), 7);
+  EXPECT_EQ(pts, 1);
+  EXPECT_EQ(std::string(reinterpret_cast<char*>(read_buffer), 7), "fghijkl");
+  EXPECT_EQ(buffer.Available(), 0);
+}
+
+TEST(ByteBufferTest, FlushDropsEverything) {
+  PtsByteBuffer buffer;
+  buffer.Write(3, reinterpret_cast<const uint8_t*>("abc"), 1);
+  buffer.Flush();
+  EXPECT_EQ(buffer.Available(), 0);
+  EXPECT_EQ(buffer.PtsDataAvailable(), 0);
+
+  uint8_t read_buffer[4];
+  int64_t pts = 0;
+  buffer.Write(3, reinterpret_cast<const uint8_t*>("def"), 2);
+  EXPECT_EQ(buffer.Read(sizeof(read_buffer), read_buffer, &pts), 3);
+  EXPECT_EQ(pts, 2);
+}
+
+TEST(ByteBufferTest, SingleProducerSingleConsumer) {
+  // Small enough that the producer regularly finds the ring full and the
+  // writes wrap at many different offsets.
+  PtsByteBuffer buffer(1021, 16);
+  constexpr int kWrites = 20000;
+
+  std::thread producer([&buffer]() {
+    std::vector<uint8_t> data;
+    uint8_t next = 0;
+    for (int i = 0; i < kWrites; i++) {
+      data.resize(1 + i % 97);
+      for (uint8_t& byte : data) {
+        byte = next++;
+      }
+      while (!buffer.Write(data.size(), data.data(), i)) {
+        std::this_thread::yield();
+      }
+    }
+  });
+
+  uint8_t expected = 0;
+  int64_t last_pts = -1;
+  size_t total = 0;
+  size_t expected_total = 0;
+  for (int i = 0; i < kWrites; i++) {
+    expected_total += 1 + i % 97;
+  }
+  uint8_t read_buffer[61];
+  while (total < expected_total) {
+    int64_t pts;
+    size_t read = buffer.Read(sizeof(read_buffer), read_buffer, &pts);
+    if (!read) {
+      std::this_thread::yield();
+      continue;
+    }
+    ASSERT_GE(pts, last_pts);
+    last_pts = pts;
+    for (size_t i = 0; i < read; i++) {
+      ASSERT_EQ(read_buffer[i], expected++);
+    }
+    total += read;
+  }
+  producer.join();
+  EXPECT_EQ(last_pts, kWrites - 1);
+  EXPECT_EQ(buffer.Available(), 0);
+}
+
 }  // namespace util
@@ -0,0 +1,32 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NDASH_BENCH_ALLOCATION_COUNTER_H_
+#define NDASH_BENCH_ALLOCATION_COUNTER_H_
+
+#include <cstdint>
+
+namespace ndash {
+namespace bench {
+
+// Returns the number of times operator new has been called in this process.
+// ndash_bench replaces the global operator new to count them.
+int64_t GetAllocationCount();
+
+}  // namespace bench
+}  // namespace ndash
+
+#endif  // NDASH_BENCH_ALLOCATION_COUNTER_H_
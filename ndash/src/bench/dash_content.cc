@@ -0,0 +1,689 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "bench/dash_content.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <vector>
+
+#include "base/logging.h"
+#include "base/strings/stringprintf.h"
+
+namespace ndash {
+namespace bench {
+
+namespace {
+
+constexpr uint32_t FourCC(char a, char b, char c, char d) {
+  return (static_cast<uint32_t>(static_cast<uint8_t>(a)) << 24) |
+         (static_cast<uint32_t>(static_cast<uint8_t>(b)) << 16) |
+         (static_cast<uint32_t>(static_cast<uint8_t>(c)) << 8) |
+         static_cast<uint32_t>(static_cast<uint8_t>(d));
+}
+
+constexpr uint32_t kFtyp = FourCC('f', 't', 'y', 'p');
+constexpr uint32_t kHdlr = FourCC('h', 'd', 'l', 'r');
+constexpr uint32_t kMdat = FourCC('m', 'd', 'a', 't');
+constexpr uint32_t kMdhd = FourCC('m', 'd', 'h', 'd');
+constexpr uint32_t kMdia = FourCC('m', 'd', 'i', 'a');
+constexpr uint32_t kMfhd = FourCC('m', 'f', 'h', 'd');
+constexpr uint32_t kMoof = FourCC('m', 'o', 'o', 'f');
+constexpr uint32_t kMoov = FourCC('m', 'o', 'o', 'v');
+constexpr uint32_t kMvex = FourCC('m', 'v', 'e', 'x');
+constexpr uint32_t kMvhd = FourCC('m', 'v', 'h', 'd');
+constexpr uint32_t kSoun = FourCC('s', 'o', 'u', 'n');
+constexpr uint32_t kTfdt = FourCC('t', 'f', 'd', 't');
+constexpr uint32_t kTfhd = FourCC('t', 'f', 'h', 'd');
+constexpr uint32_t kTkhd = FourCC('t', 'k', 'h', 'd');
+constexpr uint32_t kTraf = FourCC('t', 'r', 'a', 'f');
+constexpr uint32_t kTrak = FourCC('t', 'r', 'a', 'k');
+constexpr uint32_t kTrex = FourCC('t', 'r', 'e', 'x');
+constexpr uint32_t kTrun = FourCC('t', 'r', 'u', 'n');
+constexpr uint32_t kVide = FourCC('v', 'i', 'd', 'e');
+
+// tfhd flags
+constexpr uint32_t kBaseDataOffsetPresent = 0x1;
+constexpr uint32_t kSampleDescriptionIndexPresent = 0x2;
+constexpr uint32_t kDefaultSampleDurationPresent = 0x8;
+constexpr uint32_t kDefaultSampleSizePresent = 0x10;
+constexpr uint32_t kDefaultSampleFlagsPresent = 0x20;
+constexpr uint32_t kDefaultBaseIsMoof = 0x20000;
+
+// trun flags
+constexpr uint32_t kDataOffsetPresent = 0x1;
+constexpr uint32_t kFirstSampleFlagsPresent = 0x4;
+constexpr uint32_t kSampleDurationPresent = 0x100;
+constexpr uint32_t kSampleSizePresent = 0x200;
+constexpr uint32_t kSampleFlagsPresent = 0x400;
+constexpr uint32_t kSampleCompositionTimeOffsetPresent = 0x800;
+
+uint32_t ReadU32(const std::string& data, size_t pos) {
+  const uint8_t* p = reinterpret_cast<const uint8_t*>(data.data()) + pos;
+  return (static_cast<uint32_t>(p[0]) << 24) |
+         (static_cast<uint32_t>(p[1]) << 16) |
+         (static_cast<uint32_t>(p[2]) << 8) | p[3];
+}
+
+uint64_t ReadU64(const std::string& data, size_t pos) {
+  return (static_cast<uint64_t>(ReadU32(data, pos)) << 32) |
+         ReadU32(data, pos + 4);
+}
+
+void AppendU32(std::string* out, uint32_t value) {
+  out->push_back(static_cast<char>(value >> 24));
+  out->push_back(static_cast<char>(value >> 16));
+  out->push_back(static_cast<char>(value >> 8));
+  out->push_back(static_cast<char>(value));
+}
+
+void AppendU64(std::string* out, uint64_t value) {
+  AppendU32(out, static_cast<uint32_t>(value >> 32));
+  AppendU32(out, static_cast<uint32_t>(value));
+}
+
+void WriteU32(std::string* out, size_t pos, uint32_t value) {
+  (*out)[pos] = static_cast<char>(value >> 24);
+  (*out)[pos + 1] = static_cast<char>(value >> 16);
+  (*out)[pos + 2] = static_cast<char>(value >> 8);
+  (*out)[pos + 3] = static_cast<char>(value);
+}
+
+std::string MakeBox(uint32_t type, const std::string& payload) {
+  std::string box;
+  AppendU32(&box, payload.size() + 8);
+  AppendU32(&box, type);
+  box += payload;
+  return box;
+}
+
+struct Box {
+  uint32_t type;
+  size_t offset;
+  size_t header_size;
+  size_t size;
+
+  size_t payload() const { return offset + header_size; }
+  size_t end() const { return offset + size; }
+};
+
+bool ParseBoxes(const std::string& data,
+                size_t begin,
+                size_t end,
+                std::vector<Box>* boxes) {
+  while (begin < end) {
+    if (end - begin < 8) {
+      return false;
+    }
+    Box box;
+    box.offset = begin;
+    box.type = ReadU32(data, begin + 4);
+    box.header_size = 8;
+    uint64_t size = ReadU32(data, begin);
+    if (size == 1) {
+      if (end - begin < 16) {
+        return false;
+      }
+      size = ReadU64(data, begin + 8);
+      box.header_size = 16;
+    } else if (size == 0) {
+      size = end - begin;
+    }
+    if (size < box.header_size || size > end - begin) {
+      return false;
+    }
+    box.size = size;
+    boxes->push_back(box);
+    begin += size;
+  }
+  return true;
+}
+
+const Box* FindBox(const std::vector<Box>& boxes, uint32_t type) {
+  for (const Box& box : boxes) {
+    if (box.type == type) {
+      return &box;
+    }
+  }
+  return nullptr;
+}
+
+// Returns the children of |box|, or an empty list if they don't parse.
+std::vector<Box> Children(const std::string& data, const Box& box) {
+  std::vector<Box> children;
+  if (!ParseBoxes(data, box.payload(), box.end(), &children)) {
+    children.clear();
+  }
+  return children;
+}
+
+struct TrackFragment {
+  // tfhd fields after track_ID, minus base_data_offset.
+  uint32_t tfhd_flags;
+  std::string tfhd_fields;
+  uint64_t base_time;
+  // trun, with data_offset to be rewritten.
+  std::string trun;
+  size_t trun_data_offset_pos;
+  // Any other traf children, copied unchanged.
+  std::string others;
+  std::string data;
+  uint64_t duration;
+};
+
+struct Track {
+  uint32_t id = 0;
+  const char* name = nullptr;
+  std::string trak;
+  std::string trex;
+  uint32_t timescale = 0;
+  uint32_t default_duration = 0;
+  uint32_t default_size = 0;
+  int width = 0;
+  int height = 0;
+  std::string codecs;
+  std::vector<TrackFragment> fragments;
+  uint64_t total_duration = 0;
+  uint64_t total_bytes = 0;
+};
+
+bool ParseTrak(const std::string& mp4, const Box& trak, Track* track) {
+  std::vector<Box> children = Children(mp4, trak);
+  const Box* tkhd = FindBox(children, kTkhd);
+  const Box* mdia = FindBox(children, kMdia);
+  if (!tkhd || !mdia) {
+    return false;
+  }
+  bool v1 = mp4[tkhd->payload()] == 1;
+  track->id = ReadU32(mp4, tkhd->payload() + (v1 ? 20 : 12));
+  track->width = ReadU32(mp4, tkhd->end() - 8) >> 16;
+  track->height = ReadU32(mp4, tkhd->end() - 4) >> 16;
+
+  std::vector<Box> mdia_children = Children(mp4, *mdia);
+  const Box* mdhd = FindBox(mdia_children, kMdhd);
+  const Box* hdlr = FindBox(mdia_children, kHdlr);
+  if (!mdhd || !hdlr) {
+    return false;
+  }
+  v1 = mp4[mdhd->payload()] == 1;
+  track->timescale = ReadU32(mp4, mdhd->payload() + (v1 ? 20 : 12));
+
+  track->trak = mp4.substr(trak.offset, trak.size);
+  uint32_t handler = ReadU32(mp4, hdlr->payload() + 8);
+  if (handler == kVide) {
+    track->name = "video";
+    size_t avcc = track->trak.find("avcC");
+    if (avcc != std::string::npos && avcc + 8 <= track->trak.size()) {
+      track->codecs = base::StringPrintf(
+          "avc1.%02x%02x%02x", static_cast<uint8_t>(track->trak[avcc + 5]),
+          static_cast<uint8_t>(track->trak[avcc + 6]),
+          static_cast<uint8_t>(track->trak[avcc + 7]));
+    }
+  } else if (handler == kSoun) {
+    track->name = "audio";
+    if (track->trak.find("mp4a") != std::string::npos) {
+      track->codecs = "mp4a.40.2";
+    } else if (track->trak.find("ec-3") != std::string::npos) {
+      track->codecs = "ec-3";
+    } else if (track->trak.find("ac-3") != std::string::npos) {
+      track->codecs = "ac-3";
+    }
+  }
+  return true;
+}
+
+bool ParseTraf(const std::string& mp4,
+               const Box& moof,
+               const Box& traf,
+               std::vector<Track>* tracks) {
+  std::vector<Box> children = Children(mp4, traf);
+  const Box* tfhd = FindBox(children, kTfhd);
+  const Box* tfdt = FindBox(children, kTfdt);
+  const Box* trun = FindBox(children, kTrun);
+  if (!tfhd || !tfdt || !trun) {
+    return false;
+  }
+
+  uint32_t track_id = ReadU32(mp4, tfhd->payload() + 4);
+  auto track = std::find_if(
+      tracks->begin(), tracks->end(),
+      [track_id](const Track& t) { return t.id == track_id; });
+  if (track == tracks->end()) {
+    return false;
+  }
+
+  TrackFragment fragment;
+  fragment.tfhd_flags = ReadU32(mp4, tfhd->payload()) & 0xffffff;
+  size_t pos = tfhd->payload() + 8;
+  uint64_t base = moof.offset;
+  if (fragment.tfhd_flags & kBaseDataOffsetPresent) {
+    base = ReadU64(mp4, pos);
+    pos += 8;
+  }
+  fragment.tfhd_fields = mp4.substr(pos, tfhd->end() - pos);
+  uint32_t default_duration = track->default_duration;
+  uint32_t default_size = track->default_size;
+  if (fragment.tfhd_flags & kSampleDescriptionIndexPresent) {
+    pos += 4;
+  }
+  if (fragment.tfhd_flags & kDefaultSampleDurationPresent) {
+    default_duration = ReadU32(mp4, pos);
+    pos += 4;
+  }
+  if (fragment.tfhd_flags & kDefaultSampleSizePresent) {
+    default_size = ReadU32(mp4, pos);
+    pos += 4;
+  }
+  fragment.tfhd_flags &= ~kBaseDataOffsetPresent;
+  fragment.tfhd_flags |= kDefaultBaseIsMoof;
+
+  fragment.base_time = mp4[tfdt->payload()] == 1
+                           ? ReadU64(mp4, tfdt->payload() + 4)
+                           : ReadU32(mp4, tfdt->payload() + 4);
+
+  uint32_t trun_flags = ReadU32(mp4, trun->payload()) & 0xffffff;
+  uint32_t sample_count = ReadU32(mp4, trun->payload() + 4);
+  if (!(trun_flags & kDataOffsetPresent)) {
+    LOG(ERROR) << "trun without data offset";
+    return false;
+  }
+  int32_t data_offset = static_cast<int32_t>(ReadU32(mp4, trun->payload() + 8));
+  fragment.trun = mp4.substr(trun->offset, trun->size);
+  fragment.trun_data_offset_pos = trun->header_size + 8;
+  pos = trun->payload() + 12;
+  if (trun_flags & kFirstSampleFlagsPresent) {
+    pos += 4;
+  }
+  uint64_t duration = 0;
+  uint64_t size = 0;
+  for (uint32_t i = 0; i < sample_count; i++) {
+    if (pos > trun->end()) {
+      return false;
+    }
+    if (trun_flags & kSampleDurationPresent) {
+      duration += ReadU32(mp4, pos);
+      pos += 4;
+    } else {
+      duration += default_duration;
+    }
+    if (trun_flags & kSampleSizePresent) {
+      size += ReadU32(mp4, pos);
+      pos += 4;
+    } else {
+      size += default_size;
+    }
+    if (trun_flags & kSampleFlagsPresent) {
+      pos += 4;
+    }
+    if (trun_flags & kSampleCompositionTimeOffsetPresent) {
+      pos += 4;
+    }
+  }
+  if (base + data_offset + size > mp4.size()) {
+    LOG(ERROR) << "Track " << track_id << " fragment data out of range";
+    return false;
+  }
+  fragment.data = mp4.substr(base + data_offset, size);
+  fragment.duration = duration;
+
+  for (const Box& child : children) {
+    if (child.type != kTfhd && child.type != kTfdt && child.type != kTrun) {
+      fragment.others += mp4.substr(child.offset, child.size);
+    }
+  }
+
+  track->total_duration += duration;
+  track->total_bytes += size;
+  track->fragments.push_back(std::move(fragment));
+  return true;
+}
+
+std::string BuildInitSegment(const std::string& mp4,
+                             const Box& ftyp,
+                             const Box& mvhd,
+                             const Track& track) {
+  std::string moov = mp4.substr(mvhd.offset, mvhd.size);
+  moov += track.trak;
+  moov += MakeBox(kMvex, track.trex);
+  return mp4.substr(ftyp.offset, ftyp.size) + MakeBox(kMoov, moov);
+}
+
+std::string BuildMediaSegment(const Track& track,
+                              const TrackFragment& fragment,
+                              uint32_t sequence_number,
+                              uint64_t time_shift) {
+  std::string mfhd;
+  AppendU32(&mfhd, 0);
+  AppendU32(&mfhd, sequence_number);
+
+  std::string tfhd;
+  AppendU32(&tfhd, fragment.tfhd_flags);
+  AppendU32(&tfhd, track.id);
+  tfhd += fragment.tfhd_fields;
+
+  std::string tfdt;
+  AppendU32(&tfdt, 0x01000000);  // version 1
+  AppendU64(&tfdt, fragment.base_time + time_shift);
+
+  std::string mfhd_box = MakeBox(kMfhd, mfhd);
+  std::string traf_prefix = MakeBox(kTfhd, tfhd) + MakeBox(kTfdt, tfdt);
+  std::string moof = MakeBox(
+      kMoof, mfhd_box + MakeBox(kTraf, traf_prefix + fragment.trun +
+                                           fragment.others));
+
+  // The moof header, mfhd, traf header, tfhd and tfdt precede the trun.
+  // Samples start right after the mdat header.
+  size_t trun_pos = 8 + mfhd_box.size() + 8 + traf_prefix.size();
+  WriteU32(&moof, trun_pos + fragment.trun_data_offset_pos, moof.size() + 8);
+
+  return moof + MakeBox(kMdat, fragment.data);
+}
+
+// Returns a SegmentTemplate listing segments of |durations|.
+std::string TimelineTemplate(const Track& track,
+                             const std::vector<uint64_t>& durations) {
+  std::string result = base::StringPrintf(
+      "    <SegmentTemplate timescale=\"%u\" startNumber=\"1\" "
+      "initialization=\"$RepresentationID$/init.mp4\" "
+      "media=\"$RepresentationID$/$Number$.m4s\">\n"
+      "     <SegmentTimeline>\n",
+      track.timescale);
+
+  // Collapse runs of equal durations into r="".
+  size_t i = 0;
+  bool first = true;
+  while (i < durations.size()) {
+    size_t run = 1;
+    while (i + run < durations.size() && durations[i + run] == durations[i]) {
+      run++;
+    }
+    result.append("      <S");
+    if (first) {
+      base::StringAppendF(&result, " t=\"%" PRIu64 "\"",
+                          track.fragments.front().base_time);
+      first = false;
+    }
+    base::StringAppendF(&result, " d=\"%" PRIu64 "\"", durations[i]);
+    if (run > 1) {
+      base::StringAppendF(&result, " r=\"%zu\"", run - 1);
+    }
+    result.append("/>\n");
+    i += run;
+  }
+
+  result.append(
+      "     </SegmentTimeline>\n"
+      "    </SegmentTemplate>\n");
+  return result;
+}
+
+void AppendRepresentation(const Track& track,
+                          int64_t bandwidth,
+                          const std::string& segment_template,
+                          std::string* mpd) {
+  bool video = track.name == std::string("video");
+  base::StringAppendF(mpd, "  <AdaptationSet mimeType=\"%s/mp4\" "
+                           "segmentAlignment=\"true\">\n",
+                      track.name);
+  base::StringAppendF(mpd, "   <Representation id=\"%s\" codecs=\"%s\" "
+                           "bandwidth=\"%" PRId64 "\" startWithSAP=\"1\"",
+                      track.name, track.codecs.c_str(), bandwidth);
+  if (video) {
+    base::StringAppendF(mpd, " width=\"%d\" height=\"%d\"", track.width,
+                        track.height);
+  } else {
+    base::StringAppendF(mpd, " audioSamplingRate=\"%u\"", track.timescale);
+  }
+  mpd->append(">\n");
+  mpd->append(segment_template);
+  mpd->append(
+      "   </Representation>\n"
+      "  </AdaptationSet>\n");
+}
+
+int64_t Bandwidth(const Track& track) {
+  return track.total_bytes * 8 * track.timescale / track.total_duration;
+}
+
+// The parts of the source MP4 the presentations are built from.
+struct Source {
+  Box ftyp;
+  Box mvhd;
+  std::vector<Track> tracks;
+};
+
+bool ParseSource(const std::string& mp4, Source* source) {
+  std::vector<Box> top;
+  if (!ParseBoxes(mp4, 0, mp4.size(), &top)) {
+    LOG(ERROR) << "Couldn't parse top-level boxes";
+    return false;
+  }
+  const Box* ftyp = FindBox(top, kFtyp);
+  const Box* moov = FindBox(top, kMoov);
+  if (!ftyp || !moov) {
+    LOG(ERROR) << "Missing ftyp or moov";
+    return false;
+  }
+
+  std::vector<Box> moov_children = Children(mp4, *moov);
+  const Box* mvhd = FindBox(moov_children, kMvhd);
+  const Box* mvex = FindBox(moov_children, kMvex);
+  if (!mvhd || !mvex) {
+    LOG(ERROR) << "Not a fragmented MP4";
+    return false;
+  }
+  source->ftyp = *ftyp;
+  source->mvhd = *mvhd;
+
+  std::vector<Track>& tracks = source->tracks;
+  for (const Box& box : moov_children) {
+    if (box.type != kTrak) {
+      continue;
+    }
+    Track track;
+    if (!ParseTrak(mp4, box, &track)) {
+      LOG(ERROR) << "Couldn't parse trak";
+      return false;
+    }
+    if (track.name) {
+      tracks.push_back(std::move(track));
+    }
+  }
+  for (const Box& trex : Children(mp4, *mvex)) {
+    if (trex.type != kTrex) {
+      continue;
+    }
+    uint32_t track_id = ReadU32(mp4, trex.payload() + 4);
+    for (Track& track : tracks) {
+      if (track.id == track_id) {
+        track.trex = mp4.substr(trex.offset, trex.size);
+        track.default_duration = ReadU32(mp4, trex.payload() + 12);
+        track.default_size = ReadU32(mp4, trex.payload() + 16);
+      }
+    }
+  }
+
+  for (const Box& box : top) {
+    if (box.type != kMoof) {
+      continue;
+    }
+    for (const Box& traf : Children(mp4, box)) {
+      if (traf.type == kTraf && !ParseTraf(mp4, box, traf, &tracks)) {
+        return false;
+      }
+    }
+  }
+
+  for (const Track& track : tracks) {
+    if (track.fragments.empty() || track.trex.empty() || !track.timescale ||
+        !track.total_duration) {
+      LOG(ERROR) << "Track " << track.id << " has no fragments";
+      return false;
+    }
+  }
+  if (tracks.empty()) {
+    LOG(ERROR) << "No usable tracks";
+    return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+bool BuildDashContent(const std::string& muxed_mp4,
+                      int64_t min_duration_ms,
+                      int64_t segment_duration_ms,
+                      std::map<std::string, std::string>* files) {
+  const std::string& mp4 = muxed_mp4;
+  Source source;
+  if (!ParseSource(mp4, &source)) {
+    return false;
+  }
+
+  int64_t shortest_ms = 0;
+  for (const Track& track : source.tracks) {
+    int64_t ms = track.total_duration * 1000 / track.timescale;
+    if (shortest_ms == 0 || ms < shortest_ms) {
+      shortest_ms = ms;
+    }
+  }
+  if (shortest_ms <= 0) {
+    LOG(ERROR) << "Source too short";
+    return false;
+  }
+  int loops = std::max<int64_t>(1, (min_duration_ms + shortest_ms - 1) /
+                                       shortest_ms);
+
+  std::string mpd = base::StringPrintf(
+      "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+      "<MPD xmlns=\"urn:mpeg:DASH:schema:MPD:2011\" "
+      "profiles=\"urn:mpeg:dash:profile:isoff-live:2011\" type=\"static\" "
+      "minBufferTime=\"PT1.500S\" mediaPresentationDuration=\"PT%.3fS\">\n"
+      " <Period>\n",
+      loops * shortest_ms / 1000.0);
+
+  for (const Track& track : source.tracks) {
+    (*files)[base::StringPrintf("%s/init.mp4", track.name)] =
+        BuildInitSegment(mp4, source.ftyp, source.mvhd, track);
+    uint64_t target_duration = segment_duration_ms * track.timescale / 1000;
+    std::vector<uint64_t> durations;
+    std::string segment;
+    uint64_t duration = 0;
+    uint32_t sequence_number = 1;
+    for (int loop = 0; loop < loops; loop++) {
+      for (size_t i = 0; i < track.fragments.size(); i++) {
+        const TrackFragment& fragment = track.fragments[i];
+        segment += BuildMediaSegment(track, fragment, sequence_number++,
+                                     loop * track.total_duration);
+        duration += fragment.duration;
+        bool last = loop == loops - 1 && i == track.fragments.size() - 1;
+        if (duration >= target_duration || last) {
+          durations.push_back(duration);
+          (*files)[base::StringPrintf("%s/%zu.m4s", track.name,
+                                      durations.size())] = std::move(segment);
+          segment.clear();
+          duration = 0;
+        }
+      }
+    }
+    AppendRepresentation(track, Bandwidth(track),
+                         TimelineTemplate(track, durations), &mpd);
+  }
+
+  mpd.append(" </Period>\n</MPD>\n");
+  (*files)["manifest.mpd"] = mpd;
+  return true;
+}
+
+bool BuildLiveDashContent(const std::string& muxed_mp4,
+                          base::Time availability_start,
+                          int64_t duration_ms,
+                          std::map<std::string, std::string>* files,
+                          std::map<std::string, LiveSegment>* segments) {
+  const std::string& mp4 = muxed_mp4;
+  Source source;
+  if (!ParseSource(mp4, &source)) {
+    return false;
+  }
+
+  // Segment duration, in the first track's timescale. Other tracks are
+  // shifted by the same amount per segment, so if their fragments run a
+  // little longer their last samples overlap the next segment's first.
+  const Track& first = source.tracks.front();
+  uint64_t segment_duration = first.total_duration;
+  int64_t segment_us = segment_duration * base::Time::kMicrosecondsPerSecond /
+                       first.timescale;
+  int64_t count = std::max<int64_t>(
+      1, (duration_ms * base::Time::kMicrosecondsPerMillisecond +
+          segment_us - 1) / segment_us);
+
+  base::Time::Exploded exploded;
+  availability_start.UTCExplode(&exploded);
+  std::string start_time = base::StringPrintf(
+      "%04d-%02d-%02dT%02d:%02d:%02d", exploded.year, exploded.month,
+      exploded.day_of_month, exploded.hour, exploded.minute, exploded.second);
+  std::string mpd = base::StringPrintf(
+      "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+      "<MPD xmlns=\"urn:mpeg:DASH:schema:MPD:2011\" "
+      "profiles=\"urn:mpeg:dash:profile:isoff-live:2011\" type=\"dynamic\" "
+      "availabilityStartTime=\"%s\" publishTime=\"%s\" "
+      "minimumUpdatePeriod=\"PT%" PRId64 "S\" minBufferTime=\"PT1S\">\n"
+      " <Period id=\"1\" start=\"PT0S\">\n",
+      start_time.c_str(), start_time.c_str(), duration_ms / 1000 + 1);
+
+  std::string segment_template = base::StringPrintf(
+      "    <SegmentTemplate timescale=\"%u\" duration=\"%" PRIu64
+      "\" startNumber=\"1\" "
+      "initialization=\"$RepresentationID$/init.mp4\" "
+      "media=\"$RepresentationID$/$Number$.m4s\"/>\n",
+      first.timescale, segment_duration);
+
+  for (const Track& track : source.tracks) {
+    (*files)[base::StringPrintf("%s/init.mp4", track.name)] =
+        BuildInitSegment(mp4, source.ftyp, source.mvhd, track);
+    uint64_t first_base_time = track.fragments.front().base_time;
+    uint32_t sequence_number = 1;
+    for (int64_t n = 0; n < count; n++) {
+      // Where this segment starts, in |track|'s timescale.
+      uint64_t start =
+          n * segment_duration * track.timescale / first.timescale;
+      base::TimeDelta segment_end =
+          base::TimeDelta::FromMicroseconds((n + 1) * segment_us);
+      LiveSegment& segment = (*segments)[base::StringPrintf(
+          "%s/%" PRId64 ".m4s", track.name, n + 1)];
+      segment.start = base::TimeDelta::FromMicroseconds(n * segment_us);
+      for (const TrackFragment& fragment : track.fragments) {
+        uint64_t shift = start - first_base_time;
+        segment.body += BuildMediaSegment(track, fragment, sequence_number++,
+                                          shift);
+        uint64_t end = fragment.base_time + shift + fragment.duration;
+        base::TimeDelta available_at = std::min(
+            segment_end,
+            base::TimeDelta::FromMicroseconds(
+                end * base::Time::kMicrosecondsPerSecond / track.timescale));
+        segment.chunks.emplace_back(segment.body.size(), available_at);
+      }
+    }
+    AppendRepresentation(track, Bandwidth(track), segment_template, &mpd);
+  }
+
+  mpd.append(" </Period>\n</MPD>\n");
+  (*files)["manifest.mpd"] = mpd;
+  return true;
+}
+
+}  // namespace bench
+}  // namespace ndash
@@ -0,0 +1,79 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NDASH_BENCH_DASH_CONTENT_H_
+#define NDASH_BENCH_DASH_CONTENT_H_
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/time/time.h"
+
+namespace ndash {
+namespace bench {
+
+// Builds a static DASH presentation out of a fragmented, multiplexed MP4 (such
+// as test/data/bear-1280x720-av_frag.mp4). Each track becomes its own
+// representation with an init segment and media segments made of consecutive
+// fragments, at least |segment_duration_ms| long (bar the last); fragments are
+// repeated (with decode times shifted) until the presentation is at least
+// |min_duration_ms| long.
+//
+// The result maps server paths to bodies:
+//   manifest.mpd, <track>/init.mp4, <track>/<n>.m4s  (n starts at 1)
+// where <track> is "video" or "audio".
+//
+// Returns false if |muxed_mp4| is not laid out as ftyp/moov followed by
+// moof/mdat pairs.
+bool BuildDashContent(const std::string& muxed_mp4,
+                      int64_t min_duration_ms,
+                      int64_t segment_duration_ms,
+                      std::map<std::string, std::string>* files);
+
+// A live media segment, which a low-latency origin produces one CMAF chunk
+// (moof/mdat pair) at a time.
+struct LiveSegment {
+  std::string body;
+  // When the segment starts being produced, relative to the
+  // availabilityStartTime.
+  base::TimeDelta start;
+  // For each chunk, one past its last byte in |body| and when it is complete,
+  // relative to the availabilityStartTime.
+  std::vector<std::pair<size_t, base::TimeDelta>> chunks;
+};
+
+// Builds a live (dynamic) presentation out of the same source as
+// BuildDashContent(), starting at |availability_start| (whole seconds). Every
+// media segment is one pass over the source fragments, each of which is a
+// chunk, so segments are addressed by number with SegmentTemplate@duration;
+// all tracks share the first track's segment duration. Segments are built for
+// the first |duration_ms| of the presentation.
+//
+// |files| gets manifest.mpd and the init segments, and |segments| the media
+// segments, under the same paths as BuildDashContent().
+bool BuildLiveDashContent(const std::string& muxed_mp4,
+                          base::Time availability_start,
+                          int64_t duration_ms,
+                          std::map<std::string, std::string>* files,
+                          std::map<std::string, LiveSegment>* segments);
+
+}  // namespace bench
+}  // namespace ndash
+
+#endif  // NDASH_BENCH_DASH_CONTENT_H_
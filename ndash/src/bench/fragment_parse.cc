@@ -0,0 +1,134 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "bench/fragment_parse.h"
+
+#include <set>
+#include <vector>
+
+#include "base/bind.h"
+#include "base/files/file_path.h"
+#include "base/files/file_util.h"
+#include "base/logging.h"
+#include "mp4/es_descriptor.h"
+#include "mp4/fourccs.h"
+#include "mp4/media_log.h"
+#include "mp4/media_tracks.h"
+#include "mp4/mp4_stream_parser.h"
+
+namespace ndash {
+namespace bench {
+
+namespace {
+
+uint32_t ReadUint32(const std::string& data, size_t pos) {
+  const uint8_t* p = reinterpret_cast<const uint8_t*>(data.data() + pos);
+  return (p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+// Returns the offset of the first top-level box of |type| in |data|, or
+// |data|.size() if there is none.
+size_t FindTopLevelBox(const std::string& data, uint32_t type) {
+  size_t pos = 0;
+  while (pos + 8 <= data.size()) {
+    uint64_t size = ReadUint32(data, pos);
+    if (ReadUint32(data, pos + 4) == type) {
+      return pos;
+    }
+    if (size == 1 && pos + 16 <= data.size()) {
+      size = (static_cast<uint64_t>(ReadUint32(data, pos + 8)) << 32) |
+             ReadUint32(data, pos + 12);
+    }
+    if (size < 8) {
+      break;
+    }
+    pos += size;
+  }
+  return data.size();
+}
+
+void OnInit(const media::StreamParser::InitParameters& params) {}
+
+void OnEncryptedMediaInitData(media::EmeInitDataType data_type,
+                              const std::vector<uint8_t>& init_data) {}
+
+void OnMediaSegment() {}
+
+void OnSidx(std::unique_ptr<std::vector<uint32_t>> sizes,
+            std::unique_ptr<std::vector<uint64_t>> offsets,
+            std::unique_ptr<std::vector<uint64_t>> durations_us,
+            std::unique_ptr<std::vector<uint64_t>> times_us) {}
+
+}  // namespace
+
+FragmentParse::FragmentParse() {
+  std::set<int> audio_object_types;
+  audio_object_types.insert(media::mp4::kISO_14496_3);
+  audio_object_types.insert(media::mp4::kAC3);
+  audio_object_types.insert(media::mp4::kEAC3);
+  parser_.reset(new media::mp4::MP4StreamParser(audio_object_types, false));
+  parser_->Init(
+      base::Bind(&OnInit),
+      base::Bind(&FragmentParse::NewConfig, base::Unretained(this)),
+      base::Bind(&FragmentParse::NewBuffers, base::Unretained(this)), true,
+      base::Bind(&OnEncryptedMediaInitData), base::Bind(&OnMediaSegment),
+      base::Bind(&OnMediaSegment), base::Bind(&OnSidx),
+      scoped_refptr<media::MediaLog>(new media::MediaLog()));
+}
+
+FragmentParse::~FragmentParse() {}
+
+bool FragmentParse::Init(const std::string& file) {
+  base::FilePath path(file);
+  if (!base::ReadFileToString(path, &file_)) {
+    LOG(ERROR) << "Couldn't read " << path.value();
+    return false;
+  }
+  fragments_offset_ = FindTopLevelBox(file_, media::mp4::FOURCC_MOOF);
+  if (fragments_offset_ == file_.size()) {
+    LOG(ERROR) << path.value() << " has no fragments";
+    return false;
+  }
+  return parser_->Parse(reinterpret_cast<const uint8_t*>(file_.data()),
+                        file_.size());
+}
+
+bool FragmentParse::ParseFragments(int64_t* samples) {
+  parser_->Flush();
+  samples_ = 0;
+  bool ok = parser_->Parse(
+      reinterpret_cast<const uint8_t*>(file_.data()) + fragments_offset_,
+      file_.size() - fragments_offset_);
+  *samples += samples_;
+  return ok;
+}
+
+bool FragmentParse::NewConfig(
+    std::unique_ptr<media::MediaTracks> tracks,
+    const media::StreamParser::TextTrackConfigMap& text_configs) {
+  return true;
+}
+
+bool FragmentParse::NewBuffers(
+    const media::StreamParser::BufferQueue& audio_buffers,
+    const media::StreamParser::BufferQueue& video_buffers,
+    const media::StreamParser::TextBufferQueueMap& text_map) {
+  samples_ += audio_buffers.size() + video_buffers.size();
+  return true;
+}
+
+}  // namespace bench
+}  // namespace ndash
@@ -0,0 +1,64 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NDASH_BENCH_FRAGMENT_PARSE_H_
+#define NDASH_BENCH_FRAGMENT_PARSE_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "mp4/stream_parser.h"
+
+namespace ndash {
+namespace bench {
+
+// Feeds the fragments of a fragmented MP4 file to one MP4StreamParser over
+// and over, the way a StreamParserExtractor is fed one media segment after
+// another.
+class FragmentParse {
+ public:
+  FragmentParse();
+  ~FragmentParse();
+
+  // Parses |file|, which must start with its initialization segment ('moov').
+  bool Init(const std::string& file);
+
+  // Parses all the fragments again, adding the number of samples they held
+  // to |samples|.
+  bool ParseFragments(int64_t* samples);
+
+  FragmentParse(const FragmentParse& other) = delete;
+  FragmentParse& operator=(const FragmentParse& other) = delete;
+
+ private:
+  bool NewConfig(std::unique_ptr<media::MediaTracks> tracks,
+                 const media::StreamParser::TextTrackConfigMap& text_configs);
+  bool NewBuffers(const media::StreamParser::BufferQueue& audio_buffers,
+                  const media::StreamParser::BufferQueue& video_buffers,
+                  const media::StreamParser::TextBufferQueueMap& text_map);
+
+  std::unique_ptr<media::StreamParser> parser_;
+  std::string file_;
+  // Where the first 'moof' starts in |file_|.
+  size_t fragments_offset_ = 0;
+  int64_t samples_ = 0;
+};
+
+}  // namespace bench
+}  // namespace ndash
+
+#endif  // NDASH_BENCH_FRAGMENT_PARSE_H_
@@ -0,0 +1,437 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "bench/local_http_server.h"
+
+#include <event2/buffer.h>
+#include <event2/bufferevent.h>
+#include <event2/event.h>
+#include <event2/http.h>
+#include <event2/keyvalq_struct.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+
+#include "base/files/file_util.h"
+#include "base/logging.h"
+#include "base/strings/string_util.h"
+#include "base/strings/stringprintf.h"
+
+namespace ndash {
+namespace bench {
+
+namespace {
+const struct timeval kStopCheckInterval = {0, 100 * 1000};
+// Granularity of bandwidth throttling.
+const base::TimeDelta kThrottleTick = base::TimeDelta::FromMilliseconds(10);
+
+struct timeval ToTimeval(base::TimeDelta delta) {
+  struct timeval tv;
+  tv.tv_sec = delta.InSeconds();
+  tv.tv_usec = (delta - base::TimeDelta::FromSeconds(tv.tv_sec)).InMicroseconds();
+  return tv;
+}
+
+const char* ContentTypeFor(const std::string& path) {
+  if (base::EndsWith(path, ".mpd", base::CompareCase::INSENSITIVE_ASCII)) {
+    return "application/dash+xml";
+  }
+  if (base::EndsWith(path, ".mp4", base::CompareCase::INSENSITIVE_ASCII) ||
+      base::EndsWith(path, ".m4s", base::CompareCase::INSENSITIVE_ASCII)) {
+    return "video/mp4";
+  }
+  return "application/octet-stream";
+}
+
+const char* ReasonFor(int code) {
+  return code == 206 ? "Partial Content" : "OK";
+}
+
+// Parses "bytes=first-[last]" against a body of |size| bytes. Returns false
+// if the header is malformed or unsatisfiable.
+bool ParseRange(const char* header,
+                size_t size,
+                size_t* first,
+                size_t* last) {
+  unsigned long long start = 0;
+  unsigned long long end = 0;
+  int n = sscanf(header, "bytes=%llu-%llu", &start, &end);
+  if (n < 1 || start >= size) {
+    return false;
+  }
+  if (n == 1 || end >= size) {
+    end = size - 1;
+  }
+  if (end < start) {
+    return false;
+  }
+  *first = start;
+  *last = end;
+  return true;
+}
+
+// Returns how much of a body produced as |chunks| is available at |now|, and
+// sets |next| to when more will be.
+size_t AvailableBytes(const std::vector<LocalHttpServer::TimedChunk>& chunks,
+                      base::TimeTicks now,
+                      base::TimeTicks* next) {
+  size_t available = 0;
+  for (const LocalHttpServer::TimedChunk& chunk : chunks) {
+    if (chunk.available_at > now) {
+      *next = chunk.available_at;
+      return available;
+    }
+    available = chunk.end;
+  }
+  *next = now;
+  return available;
+}
+}  // namespace
+
+LocalHttpServer::LocalHttpServer(const base::FilePath& root) : root_(root) {}
+
+LocalHttpServer::~LocalHttpServer() {
+  Stop();
+}
+
+void LocalHttpServer::AddContent(const std::string& path, std::string body) {
+  DCHECK(!thread_);
+  files_["/" + path].reset(new std::string(std::move(body)));
+}
+
+void LocalHttpServer::AddTimedContent(const std::string& path,
+                                      std::string body,
+                                      base::TimeTicks published_at,
+                                      std::vector<TimedChunk> chunks) {
+  DCHECK(!thread_);
+  DCHECK(!chunks.empty() && chunks.back().end == body.size());
+  AddContent(path, std::move(body));
+  Schedule& schedule = schedules_["/" + path];
+  schedule.published_at = published_at;
+  schedule.chunks = std::move(chunks);
+}
+
+void LocalHttpServer::SetNetworkConditions(
+    const NetworkConditions& conditions) {
+  DCHECK(!thread_);
+  conditions_ = conditions;
+}
+
+bool LocalHttpServer::Start() {
+  event_base_ = event_base_new();
+  http_ = evhttp_new(event_base_);
+  if (!event_base_ || !http_) {
+    LOG(ERROR) << "Couldn't create HTTP server";
+    return false;
+  }
+  evhttp_set_allowed_methods(http_, EVHTTP_REQ_GET | EVHTTP_REQ_HEAD);
+  evhttp_set_gencb(http_, &LocalHttpServer::OnRequest, this);
+  evhttp_set_bevcb(http_, &LocalHttpServer::OnNewConnection, this);
+
+  struct evhttp_bound_socket* socket =
+      evhttp_bind_socket_with_handle(http_, "127.0.0.1", 0);
+  if (!socket) {
+    LOG(ERROR) << "Couldn't bind HTTP server socket";
+    return false;
+  }
+  struct sockaddr_in addr;
+  socklen_t addr_len = sizeof(addr);
+  if (getsockname(evhttp_bound_socket_get_fd(socket),
+                  reinterpret_cast<struct sockaddr*>(&addr), &addr_len) != 0) {
+    LOG(ERROR) << "Couldn't get HTTP server port";
+    return false;
+  }
+  port_ = ntohs(addr.sin_port);
+
+  // libevent is not set up for cross-thread wakeups, so Stop() just raises a
+  // flag that the server thread polls.
+  stop_check_ = event_new(event_base_, -1, EV_PERSIST,
+                          &LocalHttpServer::OnStopCheck, this);
+  event_add(stop_check_, &kStopCheckInterval);
+
+  thread_.reset(new base::DelegateSimpleThread(this, "LocalHttpServer"));
+  thread_->Start();
+  VLOG(1) << "Serving " << root_.value() << " at " << BaseUrl();
+  return true;
+}
+
+void LocalHttpServer::Stop() {
+  if (thread_) {
+    stop_ = true;
+    thread_->Join();
+    thread_.reset();
+  }
+  // Requests still pending are freed along with their connections below.
+  for (PendingResponse* pending : pending_) {
+    event_free(pending->timer);
+    delete pending;
+  }
+  pending_.clear();
+  if (stop_check_) {
+    event_free(stop_check_);
+    stop_check_ = nullptr;
+  }
+  if (http_) {
+    evhttp_free(http_);
+    http_ = nullptr;
+  }
+  if (event_base_) {
+    event_base_free(event_base_);
+    event_base_ = nullptr;
+  }
+}
+
+std::string LocalHttpServer::BaseUrl() const {
+  return base::StringPrintf("http://127.0.0.1:%u/", port_);
+}
+
+void LocalHttpServer::Run() {
+  event_base_dispatch(event_base_);
+}
+
+// static
+void LocalHttpServer::OnRequest(struct evhttp_request* request, void* arg) {
+  static_cast<LocalHttpServer*>(arg)->HandleRequest(request);
+}
+
+// static
+struct bufferevent* LocalHttpServer::OnNewConnection(struct event_base* base,
+                                                     void* arg) {
+  // This is what evhttp would create itself; it is only made here to learn
+  // of the connection.
+  LocalHttpServer* server = static_cast<LocalHttpServer*>(arg);
+  struct bufferevent* bev =
+      bufferevent_socket_new(base, -1, BEV_OPT_CLOSE_ON_FREE);
+  if (bev) {
+    server->connections_accepted_++;
+    server->new_connections_.insert(bev);
+  }
+  return bev;
+}
+
+// static
+void LocalHttpServer::OnStopCheck(int fd, short what, void* arg) {
+  LocalHttpServer* server = static_cast<LocalHttpServer*>(arg);
+  if (server->stop_) {
+    event_base_loopbreak(server->event_base_);
+  }
+}
+
+// static
+void LocalHttpServer::OnPendingTimer(int fd, short what, void* arg) {
+  PendingResponse* pending = static_cast<PendingResponse*>(arg);
+  pending->server->ContinueResponse(pending);
+}
+
+// static
+void LocalHttpServer::OnConnectionClosed(struct evhttp_connection* connection,
+                                         void* arg) {
+  // The client went away; libevent frees the request itself.
+  PendingResponse* pending = static_cast<PendingResponse*>(arg);
+  event_free(pending->timer);
+  pending->server->pending_.erase(pending);
+  delete pending;
+}
+
+void LocalHttpServer::HandleRequest(struct evhttp_request* request) {
+  requests_served_++;
+
+  const char* raw_path =
+      evhttp_uri_get_path(evhttp_request_get_evhttp_uri(request));
+  char* decoded = evhttp_uridecode(raw_path ? raw_path : "/", 0, nullptr);
+  std::string path(decoded ? decoded : "");
+  free(decoded);
+
+  if (conditions_.loss > 0 && loss_distribution_(random_) < conditions_.loss) {
+    requests_failed_++;
+    evhttp_send_error(request, HTTP_SERVUNAVAIL, nullptr);
+    return;
+  }
+
+  const std::string* body = GetFile(path);
+  const std::vector<TimedChunk>* chunks = nullptr;
+  auto schedule = schedules_.find(path);
+  if (schedule != schedules_.end()) {
+    chunks = &schedule->second.chunks;
+    if (schedule->second.published_at > base::TimeTicks::Now()) {
+      body = nullptr;
+    }
+  }
+  if (!body) {
+    evhttp_send_error(request, HTTP_NOTFOUND, nullptr);
+    return;
+  }
+
+  struct evkeyvalq* out_headers = evhttp_request_get_output_headers(request);
+  evhttp_add_header(out_headers, "Content-Type", ContentTypeFor(path));
+  evhttp_add_header(out_headers, "Accept-Ranges", "bytes");
+
+  size_t first = 0;
+  size_t last = body->empty() ? 0 : body->size() - 1;
+  int code = HTTP_OK;
+  const char* range = evhttp_find_header(
+      evhttp_request_get_input_headers(request), "Range");
+  if (range) {
+    if (!ParseRange(range, body->size(), &first, &last)) {
+      evhttp_add_header(out_headers, "Content-Range",
+                        base::StringPrintf("bytes */%zu", body->size()).c_str());
+      evhttp_send_reply(request, 416, "Range Not Satisfiable", nullptr);
+      return;
+    }
+    code = 206;
+    evhttp_add_header(
+        out_headers, "Content-Range",
+        base::StringPrintf("bytes %zu-%zu/%zu", first, last, body->size())
+            .c_str());
+  }
+  size_t end = body->empty() ? 0 : last + 1;
+  if (evhttp_request_get_command(request) == EVHTTP_REQ_HEAD) {
+    end = first;
+  }
+
+  PendingResponse* pending = new PendingResponse;
+  pending->server = this;
+  pending->request = request;
+  pending->body = body;
+  pending->next = first;
+  pending->end = end;
+  pending->code = code;
+  pending->chunks = chunks;
+  pending->timer = evtimer_new(event_base_, &LocalHttpServer::OnPendingTimer,
+                               pending);
+  pending_.insert(pending);
+  evhttp_connection_set_closecb(evhttp_request_get_connection(request),
+                                &LocalHttpServer::OnConnectionClosed, pending);
+
+  base::TimeDelta latency = conditions_.latency;
+  // A bufferevent freed without a request leaves a stale entry; that is
+  // harmless, since a new connection reusing its address is inserted anew.
+  if (new_connections_.erase(evhttp_connection_get_bufferevent(
+          evhttp_request_get_connection(request)))) {
+    latency += conditions_.connect_latency;
+  }
+  if (latency > base::TimeDelta()) {
+    struct timeval delay = ToTimeval(latency);
+    evtimer_add(pending->timer, &delay);
+  } else {
+    ContinueResponse(pending);
+  }
+}
+
+void LocalHttpServer::ContinueResponse(PendingResponse* pending) {
+  struct evhttp_request* request = pending->request;
+
+  // Everything up to |limit| can be sent now.
+  size_t limit = pending->end;
+  base::TimeTicks now = base::TimeTicks::Now();
+  base::TimeTicks next_chunk = now;
+  if (pending->chunks) {
+    limit = std::min(limit, AvailableBytes(*pending->chunks, now, &next_chunk));
+  }
+  bool throttled = conditions_.bandwidth_bps > 0;
+
+  if (!pending->started && !throttled && limit >= pending->end) {
+    struct evbuffer* out = evbuffer_new();
+    if (pending->end > pending->next) {
+      // Cached files live as long as the server, so no copy is needed.
+      evbuffer_add_reference(out, pending->body->data() + pending->next,
+                             pending->end - pending->next, nullptr, nullptr);
+      bytes_served_ += pending->end - pending->next;
+    }
+    int code = pending->code;
+    FinishResponse(pending);
+    evhttp_send_reply(request, code, ReasonFor(code), out);
+    evbuffer_free(out);
+    return;
+  }
+
+  if (!pending->started) {
+    pending->started = true;
+    // Bodies still being produced go out with chunked transfer encoding, as
+    // a low-latency origin would send them; their length is not announced.
+    if (!pending->chunks || limit >= pending->end) {
+      evhttp_add_header(
+          evhttp_request_get_output_headers(request), "Content-Length",
+          base::StringPrintf("%zu", pending->end - pending->next).c_str());
+    }
+    evhttp_send_reply_start(request, pending->code, ReasonFor(pending->code));
+  }
+
+  size_t n = limit > pending->next ? limit - pending->next : 0;
+  if (throttled) {
+    size_t slice = std::max<int64_t>(
+        1, conditions_.bandwidth_bps * kThrottleTick.InMicroseconds() /
+               (8 * base::Time::kMicrosecondsPerSecond));
+    n = std::min(slice, n);
+  }
+  if (n > 0) {
+    struct evbuffer* out = evbuffer_new();
+    evbuffer_add_reference(out, pending->body->data() + pending->next, n,
+                           nullptr, nullptr);
+    evhttp_send_reply_chunk(request, out);
+    evbuffer_free(out);
+    pending->next += n;
+    bytes_served_ += n;
+  }
+
+  if (pending->next >= pending->end) {
+    FinishResponse(pending);
+    evhttp_send_reply_end(request);
+  } else if (pending->next < limit) {
+    struct timeval tick = ToTimeval(kThrottleTick);
+    evtimer_add(pending->timer, &tick);
+  } else {
+    // Wait for the origin to produce more.
+    struct timeval delay = ToTimeval(std::max(
+        next_chunk - now, base::TimeDelta::FromMilliseconds(1)));
+    evtimer_add(pending->timer, &delay);
+  }
+}
+
+void LocalHttpServer::FinishResponse(PendingResponse* pending) {
+  // Detach before the final send, which may close the connection.
+  evhttp_connection_set_closecb(
+      evhttp_request_get_connection(pending->request), nullptr, nullptr);
+  event_free(pending->timer);
+  pending_.erase(pending);
+  delete pending;
+}
+
+const std::string* LocalHttpServer::GetFile(const std::string& path) {
+  auto it = files_.find(path);
+  if (it != files_.end()) {
+    return it->second.get();
+  }
+
+  if (root_.empty() || path.empty() || path[0] != '/' ||
+      path.find("..") != std::string::npos) {
+    return nullptr;
+  }
+  std::unique_ptr<std::string> contents(new std::string);
+  if (!base::ReadFileToString(root_.Append(path.substr(1)), contents.get())) {
+    return nullptr;
+  }
+  const std::string* result = contents.get();
+  files_[path] = std::move(contents);
+  return result;
+}
+
+}  // namespace bench
+}  // namespace ndash
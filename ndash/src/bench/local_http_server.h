@@ -0,0 +1,170 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NDASH_BENCH_LOCAL_HTTP_SERVER_H_
+#define NDASH_BENCH_LOCAL_HTTP_SERVER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "base/files/file_path.h"
+#include "base/threading/simple_thread.h"
+#include "base/time/time.h"
+
+struct bufferevent;
+struct evhttp;
+struct evhttp_connection;
+struct evhttp_request;
+struct event;
+struct event_base;
+
+namespace ndash {
+namespace bench {
+
+// A minimal HTTP/1.1 origin on 127.0.0.1 for benchmarks. Serves in-memory
+// content and the files under a root directory (cached in memory after the
+// first request), and honours single byte-range requests, which is all
+// DataSources need. Responses can be shaped to emulate a remote CDN.
+class LocalHttpServer : public base::DelegateSimpleThread::Delegate {
+ public:
+  // Applied to every response independently, so concurrent sessions do not
+  // compete for one bandwidth budget.
+  struct NetworkConditions {
+    // Delay before the response headers are sent.
+    base::TimeDelta latency;
+    // Further delay for the first request on a new connection, standing in
+    // for the TCP (and TLS) handshake.
+    base::TimeDelta connect_latency;
+    // Body throughput cap in bits per second, or 0 for unlimited.
+    int64_t bandwidth_bps = 0;
+    // Fraction of requests, in [0, 1], answered with 503 Service Unavailable.
+    // HTTP cannot express packet loss; a failed request is the closest thing
+    // the player can observe.
+    double loss = 0;
+  };
+
+  // Part of a body that an origin is still producing, like a CMAF chunk of a
+  // live segment.
+  struct TimedChunk {
+    // One past the last byte of the chunk.
+    size_t end;
+    // When the chunk is complete.
+    base::TimeTicks available_at;
+  };
+
+  explicit LocalHttpServer(const base::FilePath& root);
+  ~LocalHttpServer() override;
+
+  // These must be called before Start().
+  void AddContent(const std::string& path, std::string body);
+  // Adds |body| to be published progressively, as |chunks| become available
+  // (in order, the last one ending at |body|'s end). Requests made before
+  // |published_at| get 404 Not Found; later ones get what is available
+  // straight away and the rest, chunked, as it is produced.
+  void AddTimedContent(const std::string& path,
+                       std::string body,
+                       base::TimeTicks published_at,
+                       std::vector<TimedChunk> chunks);
+  void SetNetworkConditions(const NetworkConditions& conditions);
+
+  // Binds an ephemeral port and starts serving on a thread of its own.
+  bool Start();
+  void Stop();
+
+  uint16_t port() const { return port_; }
+  // e.g. "http://127.0.0.1:12345/"
+  std::string BaseUrl() const;
+
+  int64_t requests_served() const { return requests_served_; }
+  int64_t requests_failed() const { return requests_failed_; }
+  int64_t bytes_served() const { return bytes_served_; }
+  int64_t connections_accepted() const { return connections_accepted_; }
+
+  LocalHttpServer(const LocalHttpServer& other) = delete;
+  LocalHttpServer& operator=(const LocalHttpServer& other) = delete;
+
+ private:
+  // A response being delayed or throttled.
+  struct PendingResponse {
+    LocalHttpServer* server;
+    struct evhttp_request* request;
+    const std::string* body;
+    size_t next;  // Next byte of |body| to send.
+    size_t end;   // One past the last byte to send.
+    int code;
+    // Non-null if |body| is still being produced.
+    const std::vector<TimedChunk>* chunks;
+    bool started = false;
+    struct event* timer = nullptr;
+  };
+
+  // base::DelegateSimpleThread::Delegate
+  void Run() override;
+
+  static void OnRequest(struct evhttp_request* request, void* arg);
+  static struct bufferevent* OnNewConnection(struct event_base* base,
+                                             void* arg);
+  static void OnStopCheck(int fd, short what, void* arg);
+  static void OnPendingTimer(int fd, short what, void* arg);
+  static void OnConnectionClosed(struct evhttp_connection* connection,
+                                 void* arg);
+
+  void HandleRequest(struct evhttp_request* request);
+  // Sends headers and/or the next slice of a shaped response.
+  void ContinueResponse(PendingResponse* pending);
+  void FinishResponse(PendingResponse* pending);
+  // Returns nullptr if |path| is not a readable file under |root_|.
+  const std::string* GetFile(const std::string& path);
+
+  const base::FilePath root_;
+
+  struct event_base* event_base_ = nullptr;
+  struct evhttp* http_ = nullptr;
+  struct event* stop_check_ = nullptr;
+  uint16_t port_ = 0;
+  std::atomic<bool> stop_{false};
+  std::unique_ptr<base::DelegateSimpleThread> thread_;
+  NetworkConditions conditions_;
+
+  // Only touched by the server thread once started.
+  std::map<std::string, std::unique_ptr<std::string>> files_;
+  struct Schedule {
+    base::TimeTicks published_at;
+    std::vector<TimedChunk> chunks;
+  };
+  std::map<std::string, Schedule> schedules_;
+  std::set<PendingResponse*> pending_;
+  // Connections that have not had a request yet.
+  std::set<struct bufferevent*> new_connections_;
+  std::minstd_rand random_;
+  std::uniform_real_distribution<double> loss_distribution_{0, 1};
+
+  std::atomic<int64_t> requests_served_{0};
+  std::atomic<int64_t> requests_failed_{0};
+  std::atomic<int64_t> bytes_served_{0};
+  std::atomic<int64_t> connections_accepted_{0};
+};
+
+}  // namespace bench
+}  // namespace ndash
+
+#endif  // NDASH_BENCH_LOCAL_HTTP_SERVER_H_
@@ -0,0 +1,769 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Headless benchmarks for ndash. Everything runs against a LocalHttpServer so
+// results do not depend on a real CDN.
+//
+//   ndash_bench --scenario=loaders --sessions=100 --executor=shared
+//   ndash_bench --scenario=playback --sessions=20 --latency_ms=50
+//       --bandwidth_kbps=8000 --script=play:10,seek:20000,play:5
+//   ndash_bench --scenario=playback --live --live_target_latency_ms=1000
+//   ndash_bench --scenario=sample_queue --queue_samples=1800
+//   ndash_bench --scenario=fragment_parse --iterations=200
+//   ndash_bench --scenario=start_codes --iterations=100
+//   ndash_bench --scenario=local_reads --iterations=200 --segment_kb=256
+//   ndash_bench --scenario=offline_download --parallel_transfers=16
+//       --latency_ms=50 --bandwidth_kbps=8000
+
+#include <curl/curl.h>
+
+#include <gflags/gflags.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/at_exit.h"
+#include "base/command_line.h"
+#include "base/cpu.h"
+#include "base/files/file_path.h"
+#include "base/files/file_util.h"
+#include "base/files/scoped_temp_dir.h"
+#include "base/logging.h"
+#include "base/message_loop/message_loop.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/string_split.h"
+#include "base/threading/platform_thread.h"
+#include "bench/allocation_counter.h"
+#include "bench/dash_content.h"
+#include "bench/fragment_parse.h"
+#include "bench/local_http_server.h"
+#include "bench/player_session.h"
+#include "bench/process_stats.h"
+#include "bench/synthetic_session.h"
+#include "extractor/info_queue.h"
+#include "mp4/start_code.h"
+#include "offline/downloader.h"
+#include "util/util.h"
+#include "upstream/constants.h"
+#include "upstream/curl_data_source.h"
+#include "upstream/data_spec.h"
+#include "upstream/file_data_source.h"
+#include "upstream/loader_pool.h"
+#include "upstream/uri.h"
+
+DEFINE_string(scenario,
+              "loaders",
+              "Benchmark to run: loaders, playback, sample_queue, "
+              "fragment_parse, start_codes, local_reads, offline_download");
+DEFINE_string(data_dir,
+              "ndash/src/test/data",
+              "Directory served by the local origin");
+DEFINE_int32(sessions, 10, "Number of concurrent sessions");
+DEFINE_int32(seconds, 10, "How long to measure for, after warm-up");
+DEFINE_int32(warmup_seconds, 2, "How long to run before measuring");
+DEFINE_string(executor,
+              "dedicated",
+              "dedicated: threads per track; shared: process-wide LoaderPool");
+DEFINE_int32(loader_threads,
+             ndash::upstream::LoaderPool::kDefaultLoaderThreads,
+             "Loader pool size with --executor=shared");
+DEFINE_int32(network_threads,
+             ndash::upstream::LoaderPool::kDefaultNetworkThreads,
+             "Network pool size with --executor=shared");
+DEFINE_int32(segment_kb,
+             256,
+             "Bytes per synthetic segment, or per local_reads request, in KiB");
+DEFINE_int32(segment_interval_ms,
+             100,
+             "Pause between segment loads per synthetic track");
+DEFINE_string(script,
+              "play:10",
+              "Playback session script: comma separated play:<seconds>, "
+              "seek:<milliseconds> and rate:<rate> steps");
+DEFINE_int32(content_seconds,
+             60,
+             "Minimum length of the presentation served for playback");
+DEFINE_int32(segment_ms,
+             2000,
+             "Target media segment duration of the playback presentation");
+DEFINE_int32(latency_ms, 0, "Delay added to every response by the origin");
+DEFINE_int32(connect_latency_ms,
+             0,
+             "Further delay for the first request on each new connection");
+DEFINE_int32(bandwidth_kbps,
+             0,
+             "Per-response throughput cap at the origin, 0 for none");
+DEFINE_bool(live,
+            false,
+            "Play a live presentation whose segments the origin produces "
+            "a CMAF chunk at a time");
+DEFINE_int32(live_target_latency_ms,
+             1500,
+             "With --live, the live-target-latency-ms attribute");
+DEFINE_double(loss,
+              0,
+              "Fraction of origin requests failed with 503, in [0, 1]");
+DEFINE_int32(queue_samples,
+             1800,
+             "Samples buffered for --scenario=sample_queue (30s at 60fps)");
+DEFINE_int32(gop_samples, 120, "Samples per keyframe for sample_queue");
+DEFINE_int32(iterations,
+             2000,
+             "Operations timed by sample_queue, or passes over each file "
+             "by fragment_parse, start_codes and local_reads");
+DEFINE_string(parse_files,
+              "bear-1280x720-av_frag.mp4,bear-1280x720-avt_subt_frag.mp4,"
+              "bear-1280x720-av_with-aud-nalus_frag.mp4",
+              "Comma separated fragmented MP4 files in --data_dir parsed by "
+              "fragment_parse");
+DEFINE_string(scan_files,
+              "bear-1280x720-av_frag.mp4,bear-hevc-frag.mp4",
+              "Comma separated files in --data_dir scanned by start_codes");
+DEFINE_int32(parallel_transfers,
+             ndash::offline::Downloader::kDefaultParallelTransfers,
+             "Requests in flight at once for --scenario=offline_download");
+DEFINE_string(read_files,
+              "bear-1280x720-av_frag.mp4,bear-hevc-frag.mp4",
+              "Comma separated files in --data_dir read by local_reads");
+
+namespace ndash {
+namespace bench {
+
+namespace {
+
+// Remuxed into the DASH presentation used for playback.
+const char kPlaybackSourceFile[] = "bear-1280x720-av_frag.mp4";
+// How long live presentations have been running when the benchmark starts.
+const int kLiveHistorySeconds = 10;
+
+const char* const kSyntheticTrackFiles[] = {
+    "bear-1280x720-av_frag.mp4",  // video
+    "bear-eac3-only-frag.mp4",    // audio
+    "bear-hevc-frag.mp4",         // text stand-in
+};
+
+void PrintStats(const char* label,
+                int sessions,
+                const ProcessStats& start,
+                const ProcessStats& end) {
+  base::TimeDelta wall = end.sampled_at - start.sampled_at;
+  base::TimeDelta cpu = end.TotalCpu() - start.TotalCpu();
+  double cpu_percent = 100.0 * cpu.InSecondsF() / wall.InSecondsF();
+  printf("%s: sessions=%d wall=%.2fs cpu=%.2fs (%.1f%%) cpu/session=%.2f%% "
+         "threads=%d rss=%" PRId64 "kB peak_rss=%" PRId64 "kB rss/session=%"
+         PRId64 "kB\n",
+         label, sessions, wall.InSecondsF(), cpu.InSecondsF(), cpu_percent,
+         cpu_percent / sessions, end.threads, end.rss_kb, end.peak_rss_kb,
+         end.rss_kb / sessions);
+}
+
+int RunLoaders(LocalHttpServer* server) {
+  SyntheticSession::Options options;
+  for (const char* file : kSyntheticTrackFiles) {
+    options.track_urls.push_back(server->BaseUrl() + file);
+  }
+  options.segment_size = FLAGS_segment_kb * 1024;
+  options.segment_interval =
+      base::TimeDelta::FromMilliseconds(FLAGS_segment_interval_ms);
+  if (FLAGS_executor == "shared") {
+    upstream::LoaderPool::SetThreadCounts(FLAGS_loader_threads,
+                                          FLAGS_network_threads);
+    options.loader_pool = upstream::LoaderPool::GetInstance();
+  } else if (FLAGS_executor != "dedicated") {
+    LOG(ERROR) << "Unknown --executor " << FLAGS_executor;
+    return 1;
+  }
+
+  ProcessStats idle = SampleProcessStats();
+
+  std::vector<std::unique_ptr<SyntheticSession>> sessions;
+  for (int i = 0; i < FLAGS_sessions; i++) {
+    sessions.emplace_back(new SyntheticSession(i, options));
+    sessions.back()->Start();
+  }
+
+  base::PlatformThread::Sleep(
+      base::TimeDelta::FromSeconds(FLAGS_warmup_seconds));
+  int64_t segments_before = 0;
+  for (const auto& session : sessions) {
+    segments_before += session->segments_loaded();
+  }
+  ProcessStats start = SampleProcessStats();
+  base::PlatformThread::Sleep(base::TimeDelta::FromSeconds(FLAGS_seconds));
+  ProcessStats end = SampleProcessStats();
+
+  int64_t segments = -segments_before;
+  int64_t bytes = 0;
+  int64_t errors = 0;
+  for (const auto& session : sessions) {
+    segments += session->segments_loaded();
+    bytes += session->bytes_loaded();
+    errors += session->load_errors();
+  }
+  sessions.clear();
+
+  printf("executor=%s loader_threads=%zu network_threads=%zu idle_threads=%d\n",
+         FLAGS_executor.c_str(),
+         options.loader_pool ? options.loader_pool->loader_threads() : 0,
+         options.loader_pool ? options.loader_pool->network_threads() : 0,
+         idle.threads);
+  printf("segments=%" PRId64 " (%.1f/s) bytes=%" PRId64 " errors=%" PRId64
+         " requests=%" PRId64 "\n",
+         segments, segments / (end.sampled_at - start.sampled_at).InSecondsF(),
+         bytes, errors, server->requests_served());
+  PrintStats("loaders", FLAGS_sessions, start, end);
+  return 0;
+}
+
+// Adds a live presentation that has been running for a few seconds (so
+// there is a live edge to join) to |server|. Each media segment can be
+// requested once it starts being produced, and is sent as it is.
+bool AddLiveContent(const std::string& source, LocalHttpServer* server) {
+  base::Time now = base::Time::Now();
+  base::TimeTicks now_ticks = base::TimeTicks::Now();
+  base::Time start = base::Time::FromTimeT(
+      (now - base::TimeDelta::FromSeconds(kLiveHistorySeconds)).ToTimeT());
+
+  std::map<std::string, std::string> files;
+  std::map<std::string, LiveSegment> segments;
+  if (!BuildLiveDashContent(
+          source, start,
+          (kLiveHistorySeconds + FLAGS_content_seconds) * 1000, &files,
+          &segments)) {
+    return false;
+  }
+  for (auto& file : files) {
+    server->AddContent(file.first, std::move(file.second));
+  }
+  base::TimeTicks start_ticks = now_ticks - (now - start);
+  for (auto& segment : segments) {
+    std::vector<LocalHttpServer::TimedChunk> chunks;
+    for (const auto& chunk : segment.second.chunks) {
+      chunks.push_back({chunk.first, start_ticks + chunk.second});
+    }
+    server->AddTimedContent(segment.first, std::move(segment.second.body),
+                            start_ticks + segment.second.start,
+                            std::move(chunks));
+  }
+  return true;
+}
+
+// Adds the playback presentation to |server|.
+bool AddPlaybackContent(LocalHttpServer* server) {
+  std::string source;
+  base::FilePath path = base::FilePath(FLAGS_data_dir).Append(
+      kPlaybackSourceFile);
+  if (!base::ReadFileToString(path, &source)) {
+    LOG(ERROR) << "Couldn't read " << path.value();
+    return false;
+  }
+  if (FLAGS_live) {
+    if (!AddLiveContent(source, server)) {
+      LOG(ERROR) << "Couldn't build live DASH content from " << path.value();
+      return false;
+    }
+    return true;
+  }
+  std::map<std::string, std::string> files;
+  if (!BuildDashContent(source, FLAGS_content_seconds * 1000,
+                        FLAGS_segment_ms, &files)) {
+    LOG(ERROR) << "Couldn't build DASH content from " << path.value();
+    return false;
+  }
+  for (auto& file : files) {
+    server->AddContent(file.first, std::move(file.second));
+  }
+  return true;
+}
+
+// Prints min/median/p90/max of |values|.
+void PrintDistribution(const char* label, std::vector<double> values) {
+  if (values.empty()) {
+    printf("%s: no samples\n", label);
+    return;
+  }
+  std::sort(values.begin(), values.end());
+  printf("%s: min=%.3f p50=%.3f p90=%.3f max=%.3f\n", label, values.front(),
+         values[values.size() / 2], values[values.size() * 9 / 10],
+         values.back());
+}
+
+int RunPlayback(LocalHttpServer* server) {
+  PlayerSession::Options options;
+  options.url = server->BaseUrl() + "manifest.mpd";
+  if (!ParseScript(FLAGS_script, &options.script)) {
+    LOG(ERROR) << "Bad --script " << FLAGS_script;
+    return 1;
+  }
+  if (FLAGS_executor != "shared" && FLAGS_executor != "dedicated") {
+    LOG(ERROR) << "Unknown --executor " << FLAGS_executor;
+    return 1;
+  }
+  options.attributes.emplace_back("executor", FLAGS_executor);
+  if (FLAGS_live) {
+    options.attributes.emplace_back(
+        "live-target-latency-ms",
+        base::IntToString(FLAGS_live_target_latency_ms));
+    options.follow_catchup_rate = true;
+  }
+
+  ProcessStats idle = SampleProcessStats();
+
+  std::vector<std::unique_ptr<PlayerSession>> sessions;
+  for (int i = 0; i < FLAGS_sessions; i++) {
+    sessions.emplace_back(new PlayerSession(i, options));
+    sessions.back()->Start();
+  }
+  // Sample while every session is still alive, once the first finishes.
+  ProcessStats peak = idle;
+  for (auto& session : sessions) {
+    session->Join();
+    if (session == sessions.front()) {
+      peak = SampleProcessStats();
+    }
+  }
+  ProcessStats end = SampleProcessStats();
+  int failed = 0;
+  int eos = 0;
+  int rebuffers = 0;
+  int64_t bytes = 0;
+  std::vector<double> startup;
+  std::vector<double> fps;
+  std::vector<double> rebuffer;
+  std::vector<double> seek;
+  std::vector<double> live_latency;
+  for (const auto& session : sessions) {
+    const PlayerSession::Results& results = session->results();
+    if (results.load_failed) {
+      failed++;
+      continue;
+    }
+    eos += results.reached_eos;
+    rebuffers += results.rebuffer_count;
+    bytes += results.bytes_copied;
+    startup.push_back(results.startup_time.InSecondsF());
+    fps.push_back(results.FramesPerSecond());
+    rebuffer.push_back(results.rebuffer_time.InSecondsF());
+    if (results.seek_count > 0) {
+      seek.push_back(results.seek_time.InSecondsF() / results.seek_count);
+    }
+    live_latency.insert(live_latency.end(), results.live_latency.begin(),
+                        results.live_latency.end());
+  }
+  sessions.clear();
+
+  printf("executor=%s script=%s latency=%dms connect_latency=%dms "
+         "bandwidth=%dkbps loss=%.3f\n",
+         FLAGS_executor.c_str(), FLAGS_script.c_str(), FLAGS_latency_ms,
+         FLAGS_connect_latency_ms, FLAGS_bandwidth_kbps, FLAGS_loss);
+  printf("sessions=%d load_failures=%d eos=%d rebuffers=%d bytes_copied=%"
+         PRId64 " requests=%" PRId64 " failed_requests=%" PRId64
+         " connections=%" PRId64 "\n",
+         FLAGS_sessions, failed, eos, rebuffers, bytes,
+         server->requests_served(), server->requests_failed(),
+         server->connections_accepted());
+  PrintDistribution("startup_s", startup);
+  PrintDistribution("frames_per_s", fps);
+  PrintDistribution("rebuffer_s", rebuffer);
+  PrintDistribution("seek_s", seek);
+  if (FLAGS_live) {
+    printf("live: target_latency=%dms\n", FLAGS_live_target_latency_ms);
+    PrintDistribution("live_latency_s", live_latency);
+  }
+
+  // CPU and memory are process-wide. Memory is also reported as sampled with
+  // every session alive, less the idle baseline (server, content cache).
+  PrintStats("playback", FLAGS_sessions, idle, end);
+  printf("playback: threads_playing=%d rss_playing=%" PRId64
+         "kB rss_growth/session=%" PRId64 "kB\n",
+         peak.threads, peak.rss_kb,
+         (peak.rss_kb - idle.rss_kb) / FLAGS_sessions);
+  return 0;
+}
+
+// Fills |queue| with --queue_samples samples at 60fps, a keyframe every
+// --gop_samples, with the rest of each group in shuffled (B-frame like)
+// order. Returns the time of the last group.
+int64_t FillSampleQueue(std::mt19937* random, extractor::InfoQueue* queue) {
+  const int64_t kFrameUs = 16667;
+  queue->Clear();
+  std::vector<int64_t> times;
+  int64_t offset = 0;
+  int64_t gop_time_us = 0;
+  for (int i = 0; i < FLAGS_queue_samples; i += FLAGS_gop_samples) {
+    gop_time_us = i * kFrameUs;
+    int count = std::min(FLAGS_gop_samples, FLAGS_queue_samples - i);
+    times.clear();
+    for (int j = 1; j < count; j++) {
+      times.push_back(gop_time_us + j * kFrameUs);
+    }
+    std::shuffle(times.begin(), times.end(), *random);
+    times.insert(times.begin(), gop_time_us);
+    for (size_t j = 0; j < times.size(); j++) {
+      queue->CommitSample(times[j], kFrameUs,
+                          j == 0 ? util::kSampleFlagSync : 0, offset, 1000);
+      offset += 1000;
+    }
+  }
+  return gop_time_us;
+}
+
+// Times in-buffer seeks (SkipToKeyframeBefore) and discards (DiscardUntil)
+// in a sample queue, each to a random point in it. Both hold the lock that
+// the loading thread needs to commit samples.
+int RunSampleQueue() {
+  typedef std::chrono::steady_clock Clock;
+  typedef std::chrono::duration<double, std::micro> Microseconds;
+  if (FLAGS_queue_samples <= 0 || FLAGS_gop_samples <= 0) {
+    LOG(ERROR) << "Bad --queue_samples or --gop_samples";
+    return 1;
+  }
+  std::mt19937 random(1);
+  extractor::InfoQueue queue;
+  std::vector<double> seek_us;
+  std::vector<double> discard_us;
+  int64_t skipped = 0;
+  for (int i = 0; i < FLAGS_iterations; i++) {
+    int64_t last_time_us = FillSampleQueue(&random, &queue);
+    int64_t time_us =
+        std::uniform_int_distribution<int64_t>(0, last_time_us)(random);
+    // TimeTicks only has microsecond resolution.
+    Clock::time_point start = Clock::now();
+    int64_t offset = queue.SkipToKeyframeBefore(time_us);
+    seek_us.push_back(Microseconds(Clock::now() - start).count());
+    skipped += offset >= 0 ? queue.GetReadIndex() : 0;
+
+    FillSampleQueue(&random, &queue);
+    start = Clock::now();
+    queue.DiscardUntil(time_us);
+    discard_us.push_back(Microseconds(Clock::now() - start).count());
+  }
+
+  printf("sample_queue: queue_samples=%d gop_samples=%d iterations=%d "
+         "mean_skipped=%.1f\n",
+         FLAGS_queue_samples, FLAGS_gop_samples, FLAGS_iterations,
+         static_cast<double>(skipped) / FLAGS_iterations);
+  PrintDistribution("seek_us", seek_us);
+  PrintDistribution("discard_us", discard_us);
+  return 0;
+}
+
+// Parses the fragments of each of --parse_files --iterations times with one
+// MP4StreamParser per file, as a StreamParserExtractor parses one segment
+// after another, and reports the time and heap allocations per sample.
+int RunFragmentParse() {
+  typedef std::chrono::steady_clock Clock;
+  typedef std::chrono::duration<double, std::nano> Nanoseconds;
+  for (const std::string& name :
+       base::SplitString(FLAGS_parse_files, ",", base::TRIM_WHITESPACE,
+                         base::SPLIT_WANT_NONEMPTY)) {
+    FragmentParse parse;
+    if (!parse.Init(
+            base::FilePath(FLAGS_data_dir).Append(name).value())) {
+      LOG(ERROR) << "Couldn't parse " << name;
+      return 1;
+    }
+    int64_t samples = 0;
+    int64_t allocations = GetAllocationCount();
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < FLAGS_iterations; i++) {
+      if (!parse.ParseFragments(&samples)) {
+        LOG(ERROR) << "Couldn't parse the fragments of " << name;
+        return 1;
+      }
+    }
+    double ns = Nanoseconds(Clock::now() - start).count();
+    allocations = GetAllocationCount() - allocations;
+    if (samples == 0) {
+      LOG(ERROR) << name << " has no samples";
+      return 1;
+    }
+    printf("fragment_parse: file=%s iterations=%d samples=%" PRId64
+           " ns/sample=%.0f allocations/sample=%.2f\n",
+           name.c_str(), FLAGS_iterations, samples, ns / samples,
+           static_cast<double>(allocations) / samples);
+  }
+  return 0;
+}
+
+// Counts the start code prefixes in |data| with |find|.
+int64_t CountStartCodes(size_t (*find)(const uint8_t* data, size_t size),
+                        const std::string& data) {
+  const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data.data());
+  int64_t count = 0;
+  size_t pos = find(bytes, data.size());
+  while (pos < data.size()) {
+    count++;
+    pos += 3;
+    pos += find(bytes + pos, data.size() - pos);
+  }
+  return count;
+}
+
+// Scans each of --scan_files for H.264/H.265 start codes --iterations times
+// with every implementation the CPU supports, and reports the throughput of
+// each. The files are scanned as they are; compressed sample data dominates
+// them, as it does Annex B streams.
+int RunStartCodes() {
+  typedef std::chrono::steady_clock Clock;
+  typedef std::chrono::duration<double> Seconds;
+  typedef size_t (*FindFunction)(const uint8_t* data, size_t size);
+  std::vector<std::pair<const char*, FindFunction>> functions;
+  functions.emplace_back("scalar", &media::start_code::FindScalar);
+#if defined(START_CODE_HAVE_SSE2)
+  functions.emplace_back("sse2", &media::start_code::FindSSE2);
+  if (base::CPU().has_avx2()) {
+    functions.emplace_back("avx2", &media::start_code::FindAVX2);
+  }
+#endif
+#if defined(START_CODE_HAVE_NEON)
+  functions.emplace_back("neon", &media::start_code::FindNEON);
+#endif
+
+  for (const std::string& name :
+       base::SplitString(FLAGS_scan_files, ",", base::TRIM_WHITESPACE,
+                         base::SPLIT_WANT_NONEMPTY)) {
+    std::string data;
+    if (!base::ReadFileToString(base::FilePath(FLAGS_data_dir).Append(name),
+                                &data)) {
+      LOG(ERROR) << "Couldn't read " << name;
+      return 1;
+    }
+    for (const auto& function : functions) {
+      int64_t start_codes = 0;
+      Clock::time_point start = Clock::now();
+      for (int i = 0; i < FLAGS_iterations; i++) {
+        start_codes = CountStartCodes(function.second, data);
+      }
+      double seconds = Seconds(Clock::now() - start).count();
+      printf("start_codes: file=%s impl=%s bytes=%zu start_codes=%" PRId64
+             " GB/s=%.2f\n",
+             name.c_str(), function.first, data.size(), start_codes,
+             data.size() * static_cast<double>(FLAGS_iterations) / seconds /
+                 1e9);
+    }
+  }
+  return 0;
+}
+
+// How local_reads reads a request.
+enum LocalReadMode {
+  LOCAL_READ_COPY,  // Read() into a buffer
+  LOCAL_READ_VIEW,  // ReadView() where the source supports it
+};
+
+// Reads |size| bytes through |source| in --segment_kb requests of |uri|, as
+// media chunks are loaded, and returns the bytes read (or -1 on error).
+int64_t ReadInSegments(upstream::DataSourceInterface* source,
+                       const std::string& uri,
+                       int64_t size,
+                       LocalReadMode mode) {
+  const size_t kReadSize = 64 * 1024;
+  std::vector<char> buffer(kReadSize);
+  const int64_t segment_size = FLAGS_segment_kb * 1024;
+  int64_t total = 0;
+  for (int64_t position = 0; position < size; position += segment_size) {
+    upstream::DataSpec spec(upstream::Uri(uri), position,
+                            std::min(segment_size, size - position), nullptr);
+    if (source->Open(spec) < 0) {
+      source->Close();
+      return -1;
+    }
+    ssize_t n;
+    do {
+      if (mode == LOCAL_READ_VIEW) {
+        const void* data;
+        n = source->ReadView(&data, kReadSize);
+      } else {
+        n = source->Read(buffer.data(), kReadSize);
+      }
+      total += std::max<ssize_t>(n, 0);
+    } while (n >= 0);
+    source->Close();
+    if (n != upstream::RESULT_END_OF_INPUT) {
+      return -1;
+    }
+  }
+  return total;
+}
+
+// Reads each of --read_files --iterations times in --segment_kb ranges, once
+// through CurlDataSource from the origin and once each with FileDataSource
+// copying and viewing, and reports the throughput and CPU time of each. The
+// origin runs in this process, so the curl figures include serving.
+int RunLocalReads(LocalHttpServer* server) {
+  typedef std::chrono::steady_clock Clock;
+  typedef std::chrono::duration<double> Seconds;
+  if (FLAGS_segment_kb <= 0) {
+    LOG(ERROR) << "Bad --segment_kb";
+    return 1;
+  }
+  base::FilePath data_dir =
+      base::MakeAbsoluteFilePath(base::FilePath(FLAGS_data_dir));
+  for (const std::string& name :
+       base::SplitString(FLAGS_read_files, ",", base::TRIM_WHITESPACE,
+                         base::SPLIT_WANT_NONEMPTY)) {
+    int64_t size;
+    if (data_dir.empty() ||
+        !base::GetFileSize(data_dir.Append(name), &size)) {
+      LOG(ERROR) << "Couldn't find " << name;
+      return 1;
+    }
+    upstream::CurlDataSource curl_source("bench");
+    upstream::FileDataSource file_source;
+    const std::string file_uri = "file://" + data_dir.Append(name).value();
+    struct Reader {
+      const char* label;
+      upstream::DataSourceInterface* source;
+      std::string uri;
+      LocalReadMode mode;
+    } readers[] = {
+        {"curl", &curl_source, server->BaseUrl() + name, LOCAL_READ_COPY},
+        {"file_read", &file_source, file_uri, LOCAL_READ_COPY},
+        {"file_view", &file_source, file_uri, LOCAL_READ_VIEW},
+    };
+    for (const Reader& reader : readers) {
+      ProcessStats start_stats = SampleProcessStats();
+      Clock::time_point start = Clock::now();
+      int64_t bytes = 0;
+      for (int i = 0; i < FLAGS_iterations; i++) {
+        int64_t read =
+            ReadInSegments(reader.source, reader.uri, size, reader.mode);
+        if (read != size) {
+          LOG(ERROR) << "Couldn't read " << reader.uri;
+          return 1;
+        }
+        bytes += read;
+      }
+      double seconds = Seconds(Clock::now() - start).count();
+      base::TimeDelta cpu =
+          SampleProcessStats().TotalCpu() - start_stats.TotalCpu();
+      printf("local_reads: file=%s reader=%s bytes=%" PRId64
+             " MB/s=%.1f cpu_ms/MB=%.3f\n",
+             name.c_str(), reader.label, bytes, bytes / seconds / 1e6,
+             cpu.InMillisecondsF() / (bytes / 1e6));
+    }
+  }
+  return 0;
+}
+
+// Downloads the playback presentation for offline playback and reports
+// the throughput. With a per-response --bandwidth_kbps, more
+// --parallel_transfers fill more of the link.
+int RunOfflineDownload(LocalHttpServer* server) {
+  base::ScopedTempDir dir;
+  if (!dir.CreateUniqueTempDir()) {
+    LOG(ERROR) << "Couldn't create a download directory";
+    return 1;
+  }
+  offline::Downloader::Options options;
+  options.parallel_transfers = std::max(FLAGS_parallel_transfers, 1);
+  offline::Downloader downloader(options);
+  ProcessStats start = SampleProcessStats();
+  bool ok = downloader.Download(server->BaseUrl() + "manifest.mpd",
+                                std::vector<offline::RepresentationKey>(),
+                                dir.path());
+  ProcessStats end = SampleProcessStats();
+  offline::Downloader::Progress progress = downloader.GetProgress();
+  printf("offline_download: parallel_transfers=%zu latency=%dms "
+         "bandwidth=%dkbps ok=%d requests=%d failed=%d bytes=%" PRId64
+         " seconds=%.2f kbps=%" PRId64 " cpu=%.2fs\n",
+         options.parallel_transfers, FLAGS_latency_ms, FLAGS_bandwidth_kbps,
+         ok, progress.requests_total, progress.requests_failed,
+         progress.bytes, progress.elapsed.InSecondsF(),
+         progress.BitsPerSecond() / 1000,
+         (end.TotalCpu() - start.TotalCpu()).InSecondsF());
+  return ok ? 0 : 1;
+}
+
+}  // namespace
+
+}  // namespace bench
+}  // namespace ndash
+
+int main(int argc, char** argv) {
+  base::CommandLine::Init(argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  bool playback = FLAGS_scenario == "playback";
+  bool offline_download = FLAGS_scenario == "offline_download";
+
+  // libndash creates (and destroys) its own AtExitManager while any player
+  // exists, and there can only be one at a time.
+  std::unique_ptr<base::AtExitManager> exit_manager;
+  if (!playback) {
+    exit_manager.reset(new base::AtExitManager);
+  }
+
+  logging::LoggingSettings logging_settings;
+  logging::InitLogging(logging_settings);
+
+  // These need no origin.
+  if (FLAGS_scenario == "sample_queue") {
+    return ndash::bench::RunSampleQueue();
+  }
+  if (FLAGS_scenario == "fragment_parse") {
+    return ndash::bench::RunFragmentParse();
+  }
+  if (FLAGS_scenario == "start_codes") {
+    return ndash::bench::RunStartCodes();
+  }
+
+  curl_global_init(CURL_GLOBAL_ALL);
+
+  ndash::bench::LocalHttpServer server((base::FilePath(FLAGS_data_dir)));
+  ndash::bench::LocalHttpServer::NetworkConditions conditions;
+  conditions.latency = base::TimeDelta::FromMilliseconds(FLAGS_latency_ms);
+  conditions.connect_latency =
+      base::TimeDelta::FromMilliseconds(FLAGS_connect_latency_ms);
+  conditions.bandwidth_bps = static_cast<int64_t>(FLAGS_bandwidth_kbps) * 1000;
+  conditions.loss = FLAGS_loss;
+  server.SetNetworkConditions(conditions);
+  if ((playback || offline_download) &&
+      !ndash::bench::AddPlaybackContent(&server)) {
+    return 1;
+  }
+  if (!server.Start()) {
+    return 1;
+  }
+
+  int result;
+  if (FLAGS_scenario == "loaders") {
+    // LoaderPool must be created on a thread with a MessageLoop.
+    base::MessageLoop message_loop;
+    result = ndash::bench::RunLoaders(&server);
+  } else if (playback) {
+    result = ndash::bench::RunPlayback(&server);
+  } else if (FLAGS_scenario == "local_reads") {
+    result = ndash::bench::RunLocalReads(&server);
+  } else if (offline_download) {
+    result = ndash::bench::RunOfflineDownload(&server);
+  } else {
+    LOG(ERROR) << "Unknown --scenario " << FLAGS_scenario;
+    result = 1;
+  }
+
+  server.Stop();
+  curl_global_cleanup();
+  return result;
+}
@@ -0,0 +1,315 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "bench/player_session.h"
+
+#include <algorithm>
+
+#include "base/logging.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/string_split.h"
+#include "base/strings/stringprintf.h"
+#include "base/threading/platform_thread.h"
+
+namespace ndash {
+namespace bench {
+
+namespace {
+// Large enough for any frame in the test content, so frames are copied in one
+// call.
+const size_t kCopyBufferSize = 2 * 1024 * 1024;
+// How long to idle when the decode-ahead queue is full.
+const base::TimeDelta kRenderInterval = base::TimeDelta::FromMilliseconds(5);
+// Seeks that produce no frame within this time are abandoned.
+const base::TimeDelta kMaxSeekTime = base::TimeDelta::FromSeconds(30);
+// How often live sessions poll the catch-up rate.
+const base::TimeDelta kCatchupInterval = base::TimeDelta::FromMilliseconds(500);
+// DashFrameInfo PTS values are in 90kHz units.
+const int64_t kPtsPerMs = 90;
+}  // namespace
+
+bool ParseScript(const std::string& script, std::vector<ScriptStep>* steps) {
+  steps->clear();
+  for (const std::string& token :
+       base::SplitString(script, ",", base::TRIM_WHITESPACE,
+                         base::SPLIT_WANT_NONEMPTY)) {
+    size_t colon = token.find(':');
+    if (colon == std::string::npos) {
+      return false;
+    }
+    std::string op = token.substr(0, colon);
+    std::string arg = token.substr(colon + 1);
+    ScriptStep step;
+    double value;
+    if (!base::StringToDouble(arg, &value) || value < 0) {
+      return false;
+    }
+    if (op == "play") {
+      step.type = ScriptStep::PLAY;
+      step.duration = base::TimeDelta::FromSecondsD(value);
+    } else if (op == "seek") {
+      step.type = ScriptStep::SEEK;
+      step.time_ms = static_cast<MediaTimeMs>(value);
+    } else if (op == "rate") {
+      step.type = ScriptStep::RATE;
+      step.rate = static_cast<float>(value);
+    } else {
+      return false;
+    }
+    steps->push_back(step);
+  }
+  return !steps->empty();
+}
+
+double PlayerSession::Results::FramesPerSecond() const {
+  if (playing_time <= base::TimeDelta()) {
+    return 0;
+  }
+  return video_frames / playing_time.InSecondsF();
+}
+
+PlayerSession::PlayerSession(int id, const Options& options)
+    : id_(id),
+      options_(options),
+      thread_(this, base::StringPrintf("PlayerSession%d", id)),
+      buffer_(kCopyBufferSize) {}
+
+PlayerSession::~PlayerSession() {
+  if (thread_.HasBeenStarted() && !thread_.HasBeenJoined()) {
+    thread_.Join();
+  }
+}
+
+void PlayerSession::Start() {
+  thread_.Start();
+}
+
+void PlayerSession::Join() {
+  thread_.Join();
+}
+
+void PlayerSession::Run() {
+  DashPlayerCallbacks callbacks;
+  callbacks.get_media_time_ms_func = &PlayerSession::GetMediaTime;
+  callbacks.decoder_flush_func = &PlayerSession::DecoderFlush;
+  callbacks.open_cdm_session_func = &PlayerSession::OpenCdmSession;
+  callbacks.close_cdm_session_func = &PlayerSession::CloseCdmSession;
+  callbacks.fetch_license_func = &PlayerSession::FetchLicense;
+  handle_ = ndash_create(&callbacks, this);
+  for (const auto& attribute : options_.attributes) {
+    ndash_set_attribute(handle_, attribute.first.c_str(),
+                        attribute.second.c_str());
+  }
+
+  waiting_since_ = base::TimeTicks::Now();
+  if (ndash_load(handle_, options_.url.c_str(), 0) != 0) {
+    LOG(ERROR) << "Session " << id_ << " failed to load " << options_.url;
+    results_.load_failed = true;
+  } else {
+    for (const ScriptStep& step : options_.script) {
+      if (step.type == ScriptStep::PLAY) {
+        if (!Play(base::TimeTicks::Now() + step.duration)) {
+          break;
+        }
+      } else if (step.type == ScriptStep::SEEK) {
+        Seek(step.time_ms);
+      } else if (step.type == ScriptStep::RATE) {
+        ndash_set_playback_rate(handle_, step.rate);
+        AdvanceClock(base::TimeTicks::Now());
+        rate_ = step.rate;
+      }
+    }
+  }
+  if (stalled_) {
+    results_.rebuffer_time += base::TimeTicks::Now() - stall_start_;
+  }
+
+  ndash_destroy(handle_);
+  handle_ = nullptr;
+}
+
+bool PlayerSession::Play(base::TimeTicks deadline) {
+  while (true) {
+    base::TimeTicks now = base::TimeTicks::Now();
+    AdvanceClock(now);
+    if (now >= deadline) {
+      return true;
+    }
+    UpdateCatchup(now);
+
+    bool want_frame =
+        !started_ ||
+        buffered_until_ms_ < clock_ms_ + options_.decode_ahead.InMillisecondsF();
+    if (!want_frame) {
+      base::PlatformThread::Sleep(kRenderInterval);
+    } else if (!CopyFrame() && ndash_is_eos(handle_)) {
+      results_.reached_eos = true;
+      if (stalled_) {
+        // Running out of frames at the end is not a rebuffer.
+        stalled_ = false;
+        results_.rebuffer_count--;
+      }
+      return false;
+    }
+  }
+}
+
+void PlayerSession::Seek(MediaTimeMs time_ms) {
+  AdvanceClock(base::TimeTicks::Now());
+  if (stalled_) {
+    results_.rebuffer_time += base::TimeTicks::Now() - stall_start_;
+    stalled_ = false;
+  }
+  results_.seek_count++;
+  started_ = false;
+  seeking_ = true;
+  queued_frames_.clear();
+  clock_ms_ = time_ms;
+  buffered_until_ms_ = 0;
+  media_time_ = time_ms;
+  waiting_since_ = base::TimeTicks::Now();
+
+  if (ndash_seek(handle_, time_ms) != 0) {
+    LOG(WARNING) << "Session " << id_ << " failed to seek to " << time_ms;
+  }
+  base::TimeTicks deadline = waiting_since_ + kMaxSeekTime;
+  while (!started_ && base::TimeTicks::Now() < deadline) {
+    if (!CopyFrame() && ndash_is_eos(handle_)) {
+      break;
+    }
+  }
+  if (!started_) {
+    // Leave the session stalled so the rest of the script still runs.
+    results_.seek_time += base::TimeTicks::Now() - waiting_since_;
+    started_ = true;
+    last_tick_ = base::TimeTicks::Now();
+  }
+  seeking_ = false;
+}
+
+bool PlayerSession::CopyFrame() {
+  struct DashFrameInfo frame_info;
+  int copied =
+      ndash_copy_frame(handle_, buffer_.data(), buffer_.size(), &frame_info);
+  if (copied <= 0) {
+    return false;
+  }
+  results_.bytes_copied += copied;
+  if (!(frame_info.flags & DASH_FRAME_INFO_FLAG_LAST_FRAGMENT)) {
+    return true;
+  }
+
+  if (frame_info.type == DASH_FRAME_TYPE_AUDIO) {
+    results_.audio_frames++;
+  } else if (frame_info.type == DASH_FRAME_TYPE_VIDEO) {
+    MediaTimeMs pts_ms = frame_info.pts / kPtsPerMs;
+    buffered_until_ms_ =
+        std::max(buffered_until_ms_,
+                 static_cast<double>(frame_info.pts + frame_info.duration) /
+                     kPtsPerMs);
+    if (!started_) {
+      base::TimeTicks now = base::TimeTicks::Now();
+      if (seeking_) {
+        results_.seek_time += now - waiting_since_;
+      } else {
+        results_.startup_time = now - waiting_since_;
+      }
+      started_ = true;
+      clock_ms_ = pts_ms;
+      last_tick_ = now;
+    }
+    queued_frames_.insert(pts_ms);
+  }
+  return true;
+}
+
+void PlayerSession::AdvanceClock(base::TimeTicks now) {
+  if (!started_) {
+    return;
+  }
+  if (stalled_ && buffered_until_ms_ > clock_ms_) {
+    results_.rebuffer_time += now - stall_start_;
+    stalled_ = false;
+    last_tick_ = now;
+  }
+  if (!stalled_) {
+    clock_ms_ += (now - last_tick_).InMillisecondsF() * rate_ * catchup_rate_;
+    results_.playing_time += now - last_tick_;
+  }
+  last_tick_ = now;
+
+  while (!queued_frames_.empty() && *queued_frames_.begin() <= clock_ms_) {
+    queued_frames_.erase(queued_frames_.begin());
+    results_.video_frames++;
+  }
+  if (!stalled_ && clock_ms_ >= buffered_until_ms_) {
+    // Ran out of video; hold the clock until more arrives.
+    clock_ms_ = buffered_until_ms_;
+    stalled_ = true;
+    stall_start_ = now;
+    results_.rebuffer_count++;
+  }
+  media_time_ = static_cast<MediaTimeMs>(clock_ms_);
+}
+
+void PlayerSession::UpdateCatchup(base::TimeTicks now) {
+  if (!options_.follow_catchup_rate || !started_ || now < next_catchup_poll_) {
+    return;
+  }
+  next_catchup_poll_ = now + kCatchupInterval;
+  catchup_rate_ = ndash_get_catchup_rate(handle_);
+  MediaDurationMs latency = ndash_get_live_latency(handle_);
+  if (latency >= 0) {
+    results_.live_latency.push_back(latency / 1000.0);
+  }
+}
+
+// static
+MediaTimeMs PlayerSession::GetMediaTime(void* context) {
+  return static_cast<PlayerSession*>(context)->media_time_;
+}
+
+// static
+void PlayerSession::DecoderFlush(void* context) {
+  // Seek() drops queued frames itself.
+}
+
+// static
+DashCdmStatus PlayerSession::OpenCdmSession(void* context,
+                                            char** session_id,
+                                            size_t* len) {
+  // Benchmark content is not encrypted.
+  return DASH_CDM_FAILURE;
+}
+
+// static
+DashCdmStatus PlayerSession::CloseCdmSession(void* context,
+                                             const char* session_id,
+                                             size_t len) {
+  return DASH_CDM_FAILURE;
+}
+
+// static
+DashCdmStatus PlayerSession::FetchLicense(void* context,
+                                          const char* session_id,
+                                          size_t session_id_len,
+                                          const char* pssh,
+                                          size_t pssh_len) {
+  return DASH_CDM_FAILURE;
+}
+
+}  // namespace bench
+}  // namespace ndash
@@ -0,0 +1,163 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NDASH_BENCH_PLAYER_SESSION_H_
+#define NDASH_BENCH_PLAYER_SESSION_H_
+
+#include <atomic>
+#include <cstdint>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/threading/simple_thread.h"
+#include "base/time/time.h"
+#include "ndash.h"
+
+namespace ndash {
+namespace bench {
+
+// One step of a session script.
+struct ScriptStep {
+  enum Type {
+    PLAY,  // Play for |duration| of wall time (or until end of stream).
+    SEEK,  // ndash_seek() to |time_ms| and wait for the first frame.
+    RATE,  // ndash_set_playback_rate(|rate|).
+  };
+  Type type;
+  base::TimeDelta duration;
+  MediaTimeMs time_ms = 0;
+  float rate = 1;
+};
+
+// Parses a comma separated script such as "play:10,seek:30000,rate:2,play:5"
+// (play seconds, seek milliseconds). Returns false if it is malformed.
+bool ParseScript(const std::string& script, std::vector<ScriptStep>* steps);
+
+// Drives one ndash_handle the way a client player would, on a thread of its
+// own: frames are pulled with ndash_copy_frame() and "rendered" against a
+// simulated clock, which is what the player sees through its media time
+// callback. Nothing is decoded, so the costs measured are ndash's own.
+class PlayerSession : public base::DelegateSimpleThread::Delegate {
+ public:
+  struct Options {
+    std::string url;
+    std::vector<ScriptStep> script;
+    // Attributes passed to ndash_set_attribute() before loading.
+    std::vector<std::pair<std::string, std::string>> attributes;
+    // How far ahead of the clock frames are pulled, like a decoder queue.
+    base::TimeDelta decode_ahead = base::TimeDelta::FromSeconds(1);
+    // Follow ndash_get_catchup_rate() and sample ndash_get_live_latency(), as
+    // a low-latency live client would.
+    bool follow_catchup_rate = false;
+  };
+
+  struct Results {
+    bool load_failed = false;
+    bool reached_eos = false;
+    // From ndash_load() to the first video frame.
+    base::TimeDelta startup_time;
+    // Wall time spent with the clock running.
+    base::TimeDelta playing_time;
+    base::TimeDelta rebuffer_time;
+    int rebuffer_count = 0;
+    base::TimeDelta seek_time;
+    int seek_count = 0;
+    int64_t video_frames = 0;
+    int64_t audio_frames = 0;
+    int64_t bytes_copied = 0;
+    // Live latency samples, in seconds, with |follow_catchup_rate|.
+    std::vector<double> live_latency;
+
+    double FramesPerSecond() const;
+  };
+
+  PlayerSession(int id, const Options& options);
+  ~PlayerSession() override;
+
+  void Start();
+  // Waits for the script to finish.
+  void Join();
+
+  // Valid after Join().
+  const Results& results() const { return results_; }
+
+  PlayerSession(const PlayerSession& other) = delete;
+  PlayerSession& operator=(const PlayerSession& other) = delete;
+
+ private:
+  // base::DelegateSimpleThread::Delegate
+  void Run() override;
+
+  static MediaTimeMs GetMediaTime(void* context);
+  static void DecoderFlush(void* context);
+  static DashCdmStatus OpenCdmSession(void* context,
+                                      char** session_id,
+                                      size_t* len);
+  static DashCdmStatus CloseCdmSession(void* context,
+                                       const char* session_id,
+                                       size_t len);
+  static DashCdmStatus FetchLicense(void* context,
+                                    const char* session_id,
+                                    size_t session_id_len,
+                                    const char* pssh,
+                                    size_t pssh_len);
+
+  // Plays until |deadline| or the end of the stream. Returns false at the end
+  // of the stream.
+  bool Play(base::TimeTicks deadline);
+  void Seek(MediaTimeMs time_ms);
+  // Pulls one fragment of a frame. Returns false if none was available.
+  bool CopyFrame();
+  // Moves the clock to |now| and consumes due frames.
+  void AdvanceClock(base::TimeTicks now);
+  // Polls the catch-up rate and live latency, if it is time to.
+  void UpdateCatchup(base::TimeTicks now);
+
+  const int id_;
+  const Options options_;
+  base::DelegateSimpleThread thread_;
+  struct ndash_handle* handle_ = nullptr;
+
+  std::vector<char> buffer_;
+  // PTS (ms) of video frames pulled but not yet due. Frames arrive in decode
+  // order, so this is kept sorted.
+  std::multiset<MediaTimeMs> queued_frames_;
+  // End time (ms) of the latest video frame pulled.
+  double buffered_until_ms_ = 0;
+  // In milliseconds; -1 until the first frame is rendered.
+  std::atomic<MediaTimeMs> media_time_{-1};
+  double clock_ms_ = 0;
+  float rate_ = 1;
+  // Applied on top of |rate_|.
+  float catchup_rate_ = 1;
+  base::TimeTicks next_catchup_poll_;
+  base::TimeTicks last_tick_;
+  // False until the first video frame after loading or seeking.
+  bool started_ = false;
+  bool seeking_ = false;
+  base::TimeTicks waiting_since_;
+  bool stalled_ = false;
+  base::TimeTicks stall_start_;
+
+  Results results_;
+};
+
+}  // namespace bench
+}  // namespace ndash
+
+#endif  // NDASH_BENCH_PLAYER_SESSION_H_
@@ -0,0 +1,65 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "bench/process_stats.h"
+
+#include <sys/resource.h>
+#include <sys/time.h>
+
+#include <fstream>
+#include <sstream>
+#include <string>
+
+namespace ndash {
+namespace bench {
+
+namespace {
+base::TimeDelta TimevalToTimeDelta(const struct timeval& tv) {
+  return base::TimeDelta::FromSeconds(tv.tv_sec) +
+         base::TimeDelta::FromMicroseconds(tv.tv_usec);
+}
+}  // namespace
+
+ProcessStats SampleProcessStats() {
+  ProcessStats stats;
+  stats.sampled_at = base::TimeTicks::Now();
+
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) == 0) {
+    stats.user_cpu = TimevalToTimeDelta(usage.ru_utime);
+    stats.system_cpu = TimevalToTimeDelta(usage.ru_stime);
+  }
+
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while (std::getline(status, line)) {
+    std::istringstream fields(line);
+    std::string key;
+    fields >> key;
+    if (key == "VmRSS:") {
+      fields >> stats.rss_kb;
+    } else if (key == "VmHWM:") {
+      fields >> stats.peak_rss_kb;
+    } else if (key == "Threads:") {
+      fields >> stats.threads;
+    }
+  }
+
+  return stats;
+}
+
+}  // namespace bench
+}  // namespace ndash
@@ -0,0 +1,45 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NDASH_BENCH_PROCESS_STATS_H_
+#define NDASH_BENCH_PROCESS_STATS_H_
+
+#include <cstdint>
+
+#include "base/time/time.h"
+
+namespace ndash {
+namespace bench {
+
+// A snapshot of the resources used by the whole process.
+struct ProcessStats {
+  base::TimeTicks sampled_at;
+  base::TimeDelta user_cpu;
+  base::TimeDelta system_cpu;
+  int64_t rss_kb = 0;
+  int64_t peak_rss_kb = 0;
+  int threads = 0;
+
+  base::TimeDelta TotalCpu() const { return user_cpu + system_cpu; }
+};
+
+// Reads getrusage() and /proc/self/status.
+ProcessStats SampleProcessStats();
+
+}  // namespace bench
+}  // namespace ndash
+
+#endif  // NDASH_BENCH_PROCESS_STATS_H_
@@ -0,0 +1,175 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "bench/synthetic_session.h"
+
+#include "base/bind.h"
+#include "base/logging.h"
+#include "base/memory/weak_ptr.h"
+#include "base/message_loop/message_loop.h"
+#include "base/strings/stringprintf.h"
+#include "base/synchronization/cancellation_flag.h"
+#include "upstream/curl_data_source.h"
+#include "upstream/data_spec.h"
+#include "upstream/loader_pool.h"
+#include "upstream/loader_thread.h"
+#include "upstream/uri.h"
+
+namespace ndash {
+namespace bench {
+
+namespace {
+constexpr size_t kReadSize = 32 * 1024;
+}  // namespace
+
+// One track: a loadable that fetches the next segment of |url_|, and the
+// loader that runs it. Everything but Load() runs on the session thread.
+class SyntheticSession::Track : public upstream::LoadableInterface {
+ public:
+  Track(SyntheticSession* session, const std::string& url, int index)
+      : session_(session),
+        uri_(url),
+        weak_ptr_factory_(this) {
+    const Options& options = session->options_;
+    scoped_refptr<base::TaskRunner> curl_task_runner;
+    if (options.loader_pool) {
+      curl_task_runner = options.loader_pool->network_task_runner();
+      loader_.reset(new upstream::LoaderThread(
+          options.loader_pool->loader_task_runner()));
+    } else {
+      loader_.reset(new upstream::LoaderThread(
+          base::StringPrintf("Loader:%d", index)));
+    }
+    data_source_.reset(new upstream::CurlDataSource(
+        "bench", nullptr, false,
+        upstream::CurlDataSource::kDefaultMaxBufLength, curl_task_runner));
+    buffer_.reset(new char[kReadSize]);
+  }
+
+  ~Track() override {
+    CancelLoad();
+    // Joins (or waits for) the load before |data_source_| goes away.
+    loader_.reset();
+  }
+
+  void StartNext() {
+    if (cancel_.IsSet()) {
+      return;
+    }
+    loader_->StartLoading(this, base::Bind(&Track::LoadDone,
+                                           weak_ptr_factory_.GetWeakPtr()));
+  }
+
+  // upstream::LoadableInterface
+  void CancelLoad() override { cancel_.Set(); }
+  bool IsLoadCanceled() const override { return cancel_.IsSet(); }
+  bool Load() override {
+    const Options& options = session_->options_;
+    upstream::DataSpec spec(uri_, position_, options.segment_size, nullptr);
+    ssize_t length = data_source_->Open(spec, &cancel_);
+    if (length == upstream::RESULT_IO_ERROR) {
+      data_source_->Close();
+      // Past the end of the file: start over from the beginning.
+      position_ = 0;
+      return false;
+    }
+
+    int64_t loaded = 0;
+    for (;;) {
+      ssize_t n = data_source_->Read(buffer_.get(), kReadSize);
+      if (n == upstream::RESULT_END_OF_INPUT) {
+        break;
+      }
+      if (n < 0) {
+        data_source_->Close();
+        return false;
+      }
+      loaded += n;
+    }
+    data_source_->Close();
+
+    position_ = loaded < options.segment_size ? 0 : position_ + loaded;
+    session_->bytes_loaded_ += loaded;
+    return true;
+  }
+
+ private:
+  void LoadDone(upstream::LoadableInterface* loadable,
+                upstream::LoaderOutcome outcome) {
+    if (outcome == upstream::LOAD_CANCELED) {
+      return;
+    }
+    if (outcome == upstream::LOAD_COMPLETE) {
+      session_->segments_loaded_++;
+    } else {
+      session_->load_errors_++;
+    }
+    base::MessageLoop::current()->task_runner()->PostDelayedTask(
+        FROM_HERE,
+        base::Bind(&Track::StartNext, weak_ptr_factory_.GetWeakPtr()),
+        session_->options_.segment_interval);
+  }
+
+  SyntheticSession* session_;
+  upstream::Uri uri_;
+  int64_t position_ = 0;
+  base::CancellationFlag cancel_;
+  std::unique_ptr<char[]> buffer_;
+  std::unique_ptr<upstream::CurlDataSource> data_source_;
+  std::unique_ptr<upstream::LoaderThread> loader_;
+  base::WeakPtrFactory<Track> weak_ptr_factory_;
+};
+
+SyntheticSession::SyntheticSession(int id, const Options& options)
+    : options_(options), thread_(base::StringPrintf("Session:%d", id)) {}
+
+SyntheticSession::~SyntheticSession() {
+  Stop();
+}
+
+void SyntheticSession::Start() {
+  thread_.Start();
+  thread_.task_runner()->PostTask(
+      FROM_HERE,
+      base::Bind(&SyntheticSession::StartOnThread, base::Unretained(this)));
+}
+
+void SyntheticSession::Stop() {
+  if (!thread_.IsRunning()) {
+    return;
+  }
+  base::WaitableEvent done(true, false);
+  thread_.task_runner()->PostTask(
+      FROM_HERE, base::Bind(&SyntheticSession::StopOnThread,
+                            base::Unretained(this), &done));
+  done.Wait();
+  thread_.Stop();
+}
+
+void SyntheticSession::StartOnThread() {
+  for (size_t i = 0; i < options_.track_urls.size(); i++) {
+    tracks_.emplace_back(new Track(this, options_.track_urls[i], i));
+    tracks_.back()->StartNext();
+  }
+}
+
+void SyntheticSession::StopOnThread(base::WaitableEvent* done) {
+  tracks_.clear();
+  done->Signal();
+}
+
+}  // namespace bench
+}  // namespace ndash
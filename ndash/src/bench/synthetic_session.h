@@ -0,0 +1,89 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NDASH_BENCH_SYNTHETIC_SESSION_H_
+#define NDASH_BENCH_SYNTHETIC_SESSION_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/synchronization/waitable_event.h"
+#include "base/threading/thread.h"
+#include "base/time/time.h"
+
+namespace ndash {
+
+namespace upstream {
+class LoaderPool;
+}  // namespace upstream
+
+namespace bench {
+
+// Reproduces the thread layout and request pattern of one player without any
+// parsing or decoding: a control thread (standing in for DashThread) keeps a
+// loader per track busy downloading segment-sized byte ranges through a
+// CurlDataSource. Used to compare per-session overhead of dedicated threads
+// against the shared LoaderPool.
+class SyntheticSession {
+ public:
+  struct Options {
+    // One track (loader + data source) is created per URL.
+    std::vector<std::string> track_urls;
+    // Bytes requested per "segment".
+    int64_t segment_size = 256 * 1024;
+    // Pause between a track's segment loads, emulating a full buffer.
+    base::TimeDelta segment_interval;
+    // If set, loads and transfers run on this pool.
+    upstream::LoaderPool* loader_pool = nullptr;
+  };
+
+  SyntheticSession(int id, const Options& options);
+  ~SyntheticSession();
+
+  void Start();
+  // Cancels outstanding loads and joins the control thread.
+  void Stop();
+
+  int64_t segments_loaded() const { return segments_loaded_; }
+  int64_t bytes_loaded() const { return bytes_loaded_; }
+  int64_t load_errors() const { return load_errors_; }
+
+  SyntheticSession(const SyntheticSession& other) = delete;
+  SyntheticSession& operator=(const SyntheticSession& other) = delete;
+
+ private:
+  class Track;
+
+  // These run on |thread_|.
+  void StartOnThread();
+  void StopOnThread(base::WaitableEvent* done);
+
+  const Options options_;
+  base::Thread thread_;
+  std::vector<std::unique_ptr<Track>> tracks_;
+
+  std::atomic<int64_t> segments_loaded_{0};
+  std::atomic<int64_t> bytes_loaded_{0};
+  std::atomic<int64_t> load_errors_{0};
+};
+
+}  // namespace bench
+}  // namespace ndash
+
+#endif  // NDASH_BENCH_SYNTHETIC_SESSION_H_
@@ -24,11 +24,14 @@
 
 #include "base/logging.h"
 #include "base/time/time.h"
+#include "base/trace_event/trace_event.h"
 #include "chunk/chunk.h"
 #include "chunk/format_evaluator.h"
 #include "chunk/media_chunk.h"
+#include "chunk/render_feedback.h"
 #include "playback_rate.h"
 #include "upstream/bandwidth_meter.h"
+#include "upstream/host_stats.h"
 #include "util/format.h"
 
 namespace ndash {
@@ -43,6 +46,9 @@ constexpr int kDefaultMinDurationToRetainAfterDiscardMs = 15000;
 // 90% to account for audio+text consuming some of the bandwidth
 constexpr float kDefaultBandwidthFraction = 0.90f;
 
+// Assumed for predicting fetch times until a chunk has been queued.
+constexpr int kDefaultSegmentDurationMs = 2000;
+
 constexpr int kMinHdHeight = 720;
 constexpr int kMinHdWidth = 1280;
 }  // namespace
@@ -85,22 +91,58 @@ void AdaptiveEvaluator::Evaluate(
     const std::vector<util::Format>& formats,
     FormatEvaluation* evaluation,
     const PlaybackRate& playback_rate) const {
+  TRACE_EVENT0("ndash", "AdaptiveEvaluator::Evaluate");
   DCHECK(!formats.empty());
 
   base::TimeDelta buffered_duration;
+  base::TimeDelta segment_duration =
+      base::TimeDelta::FromMilliseconds(kDefaultSegmentDurationMs);
   if (!queue.empty()) {
     buffered_duration =
         base::TimeDelta::FromMicroseconds(queue.back()->end_time_us()) -
         playback_position;
+    segment_duration = base::TimeDelta::FromMicroseconds(
+        queue.back()->end_time_us() - queue.back()->start_time_us());
+  }
+
+  std::vector<util::Format> allowed_formats;
+  if (render_feedback_) {
+    allowed_formats = render_feedback_->GetAllowedFormats(formats);
   }
+  const std::vector<util::Format>& candidates =
+      render_feedback_ ? allowed_formats : formats;
 
   const std::unique_ptr<util::Format>& current(evaluation->format_);
-  const util::Format* ideal = DetermineIdealFormat(
-      formats, bandwidth_meter_->GetBitrateEstimate(), playback_rate);
-  bool is_higher =
-      ideal && current && ideal->GetBitrate() > current->GetBitrate();
-  bool is_lower =
-      ideal && current && ideal->GetBitrate() < current->GetBitrate();
+  bool current_allowed = true;
+  if (current && render_feedback_) {
+    current_allowed = std::any_of(
+        candidates.begin(), candidates.end(),
+        [&current](const util::Format& format) { return format == *current; });
+  }
+  int64_t bitrate_estimate = PredictedBitrate(candidates, segment_duration);
+  if (bitrate_estimate == upstream::BandwidthMeterInterface::kNoEstimate) {
+    bitrate_estimate = bandwidth_meter_->GetBitrateEstimate();
+  }
+  const util::Format* ideal = nullptr;
+  if (!current && !initial_format_id_.empty() &&
+      bitrate_estimate == upstream::BandwidthMeterInterface::kNoEstimate) {
+    for (const util::Format& format : candidates) {
+      if (format.GetId() == initial_format_id_) {
+        VLOG(1) << "Evaluation: starting with " << initial_format_id_;
+        ideal = &format;
+        break;
+      }
+    }
+  }
+  if (!ideal) {
+    ideal = DetermineIdealFormat(candidates, bitrate_estimate, playback_rate);
+  }
+  // A format no longer allowed is left whatever the buffer holds.
+  VLOG_IF(1, !current_allowed) << "Evaluation: current format not allowed";
+  bool is_higher = current_allowed && ideal && current &&
+                   ideal->GetBitrate() > current->GetBitrate();
+  bool is_lower = current_allowed && ideal && current &&
+                  ideal->GetBitrate() < current->GetBitrate();
   if (is_higher) {
     if (buffered_duration < min_duration_for_quality_increase_) {
       // The ideal format is a higher quality, but we have insufficient buffer
@@ -156,6 +198,10 @@ void AdaptiveEvaluator::Evaluate(
     VLOG(2) << "Evaulation: changed (old bitrate "
             << (current ? current->GetBitrate() : -1) << ", new bitrate "
             << ideal->GetBitrate() << ")";
+    TRACE_EVENT_INSTANT2("ndash", "AdaptiveEvaluator::FormatChanged",
+                         TRACE_EVENT_SCOPE_THREAD, "bitrate",
+                         ideal->GetBitrate(), "bitrate_estimate",
+                         bitrate_estimate);
     evaluation->format_.reset(new util::Format(*ideal));
   } else {
     VLOG(2) << "Evaluation: no change";
@@ -168,6 +214,34 @@ int64_t AdaptiveEvaluator::EffectiveBitrate(int64_t bitrate_estimate) const {
              : llrint(bitrate_estimate * bandwidth_fraction_);
 }
 
+int64_t AdaptiveEvaluator::PredictedBitrate(
+    const std::vector<util::Format>& formats,
+    base::TimeDelta segment_duration) const {
+  if (!host_stats_ || segment_duration <= base::TimeDelta()) {
+    return upstream::BandwidthMeterInterface::kNoEstimate;
+  }
+  std::string host = host_stats_->GetLastHost();
+  if (host.empty() || host_stats_->GetThroughput(host) ==
+                          upstream::HostStats::kNoEstimate) {
+    return upstream::BandwidthMeterInterface::kNoEstimate;
+  }
+  base::TimeDelta budget = base::TimeDelta::FromSecondsD(
+      segment_duration.InSecondsF() * bandwidth_fraction_);
+  int64_t best = 0;
+  for (const util::Format& format : formats) {
+    int64_t bytes = static_cast<int64_t>(format.GetBitrate() *
+                                         segment_duration.InSecondsF() / 8);
+    if (format.GetBitrate() > best &&
+        host_stats_->PredictTransferTime(host, bytes) <= budget) {
+      best = format.GetBitrate();
+    }
+  }
+  VLOG(3) << "Predicted bitrate " << best << " for "
+          << segment_duration.InMillisecondsF() << "ms segments from "
+          << host;
+  return best;
+}
+
 const util::Format* AdaptiveEvaluator::DetermineIdealFormat(
     const std::vector<util::Format>& formats,
     int64_t effective_bitrate,
@@ -19,6 +19,7 @@
 
 #include <deque>
 #include <memory>
+#include <string>
 #include <vector>
 
 #include "base/time/time.h"
@@ -32,11 +33,13 @@ class PlaybackRate;
 
 namespace upstream {
 class BandwidthMeterInterface;
+class HostStats;
 }  // namespace upstream
 
 namespace chunk {
 
 class MediaChunk;
+class RenderFeedback;
 
 class AdaptiveEvaluator : public FormatEvaluatorInterface {
  public:
@@ -77,6 +80,26 @@ class AdaptiveEvaluator : public FormatEvaluatorInterface {
 
   ~AdaptiveEvaluator() override;
 
+  // The format with id |format_id|, if offered, is chosen to start with when
+  // there is no bandwidth estimate yet, rather than the lowest bitrate one.
+  void SetInitialFormatId(const std::string& format_id) {
+    initial_format_id_ = format_id;
+  }
+
+  // Only formats that |render_feedback| allows are chosen, and a format that
+  // is no longer allowed is switched away from at once. May be null.
+  void SetRenderFeedback(const RenderFeedback* render_feedback) {
+    render_feedback_ = render_feedback;
+  }
+
+  // Once |host_stats| has a throughput estimate for the host media last came
+  // from, formats are chosen by predicting how long one of their segments
+  // would take to fetch from it (request latency plus size over throughput)
+  // rather than by the bandwidth meter's single bitrate. May be null.
+  void SetHostStats(const upstream::HostStats* host_stats) {
+    host_stats_ = host_stats;
+  }
+
   void Enable() override;
   void Disable() override;
   void Evaluate(const std::deque<std::unique_ptr<MediaChunk>>& queue,
@@ -90,6 +113,13 @@ class AdaptiveEvaluator : public FormatEvaluatorInterface {
 
   int64_t EffectiveBitrate(int64_t bitrate_estimate) const;
 
+  // Returns the highest bitrate among |formats| whose segments of
+  // |segment_duration| |host_stats_| predicts can be fetched within
+  // |bandwidth_fraction_| of that duration, or 0 if none can. Returns
+  // kNoEstimate if there is nothing to predict from.
+  int64_t PredictedBitrate(const std::vector<util::Format>& formats,
+                           base::TimeDelta segment_duration) const;
+
   // Find the ideal format (within |formats|), ignoring buffer health.
   static const util::Format* DetermineIdealFormat(
       const std::vector<util::Format>& formats,
@@ -103,6 +133,9 @@ class AdaptiveEvaluator : public FormatEvaluatorInterface {
   base::TimeDelta max_duration_for_quality_decrease_;
   base::TimeDelta min_duration_to_retain_after_discard_;
   float bandwidth_fraction_;
+  std::string initial_format_id_;
+  const RenderFeedback* render_feedback_ = nullptr;
+  const upstream::HostStats* host_stats_ = nullptr;
 };
 
 }  // namespace chunk
@@ -16,17 +16,26 @@
 
 #include "chunk/adaptive_evaluator.h"
 
+#include <functional>
 #include <initializer_list>
 #include <memory>
+#include <string>
 
+#include "base/files/file_path.h"
+#include "base/files/scoped_temp_dir.h"
 #include "base/time/time.h"
 #include "chunk/media_chunk_mock.h"
+#include "chunk/render_feedback.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "playback_rate.h"
 #include "upstream/bandwidth_meter.h"
 #include "upstream/bandwidth_meter_mock.h"
+#include "upstream/constants.h"
 #include "upstream/data_spec.h"
+#include "upstream/host_stats.h"
+#include "upstream/network_trace.h"
+#include "upstream/replay_data_source.h"
 
 namespace ndash {
 namespace chunk {
@@ -37,6 +46,7 @@ using ::testing::Eq;
 using ::testing::Ge;
 using ::testing::Le;
 using ::testing::InSequence;
+using ::testing::Invoke;
 using ::testing::Mock;
 using ::testing::Return;
 using ::testing::StrictMock;
@@ -355,6 +365,52 @@ TEST_F(AdaptiveEvaluatorTest, Evaluate) {
   EXPECT_THAT(evaluation.trigger_, Eq(Chunk::kTriggerAdaptive));
 }
 
+TEST_F(AdaptiveEvaluatorTest, InitialFormatId) {
+  const std::vector<util::Format> formats{
+      util::Format("sd_low", "video/x-any", 320, 240, 0.0, -1, -1, -1, 5),
+      util::Format("sd_mid", "video/x-any", 640, 480, 0.0, -1, -1, -1, 28),
+      util::Format("hd_high", "video/x-any", 1920, 1080, 0.0, -1, -1, -1, 5000),
+  };
+  const std::deque<std::unique_ptr<MediaChunk>> empty_queue;
+  const base::TimeDelta playback_time = base::TimeDelta::FromSeconds(1);
+  PlaybackRate rate;
+
+  AdaptiveEvaluator evaluator(
+      &meter_, kExampleInitialBitrate, kExampleMinDurationIncrease,
+      kExampleMaxDurationDecrease, kExampleMinDurationRetain,
+      kExampleBandwidthFraction);
+  evaluator.SetInitialFormatId("sd_mid");
+
+  // Without an estimate the format used last time is where playback starts.
+  EXPECT_CALL(meter_, GetBitrateEstimate())
+      .WillRepeatedly(Return(upstream::BandwidthMeterInterface::kNoEstimate));
+  FormatEvaluation evaluation;
+  evaluator.Evaluate(empty_queue, playback_time, formats, &evaluation, rate);
+  ASSERT_THAT(evaluation.format_, NotNull());
+  EXPECT_THAT(evaluation.format_->GetId(), Eq("sd_mid"));
+  EXPECT_THAT(evaluation.trigger_, Eq(Chunk::kTriggerInitial));
+  VerifyAndClearMocks();
+
+  // An estimate takes precedence.
+  EXPECT_CALL(meter_, GetBitrateEstimate()).WillRepeatedly(Return(10000));
+  FormatEvaluation estimated_evaluation;
+  evaluator.Evaluate(empty_queue, playback_time, formats,
+                     &estimated_evaluation, rate);
+  ASSERT_THAT(estimated_evaluation.format_, NotNull());
+  EXPECT_THAT(estimated_evaluation.format_->GetId(), Eq("hd_high"));
+  VerifyAndClearMocks();
+
+  // A format that is no longer offered is ignored.
+  evaluator.SetInitialFormatId("gone");
+  EXPECT_CALL(meter_, GetBitrateEstimate())
+      .WillRepeatedly(Return(upstream::BandwidthMeterInterface::kNoEstimate));
+  FormatEvaluation fallback_evaluation;
+  evaluator.Evaluate(empty_queue, playback_time, formats, &fallback_evaluation,
+                     rate);
+  ASSERT_THAT(fallback_evaluation.format_, NotNull());
+  EXPECT_THAT(fallback_evaluation.format_->GetId(), Eq("sd_low"));
+}
+
 TEST_F(AdaptiveEvaluatorTest, TestEvaluateVideoMaxPlayoutRate) {
   upstream::DataSpec data_spec(upstream::Uri("dummy://"));
   PlaybackRate playback_rate;
@@ -612,5 +668,346 @@ TEST_F(AdaptiveEvaluatorTest, TestEvaluateVideoMaxPlayoutRate) {
   evaluator.Disable();
 }
 
+TEST_F(AdaptiveEvaluatorTest, RenderFeedback) {
+  const upstream::DataSpec data_spec(upstream::Uri(""));
+  constexpr int32_t kChunkIndex = 42;
+
+  const std::vector<util::Format> formats{
+      util::Format("hd_60", "video/x-any", 1920, 1080, 60.0, -1, -1, -1, 8000),
+      util::Format("hd_30", "video/x-any", 1920, 1080, 30.0, -1, -1, -1, 5000),
+      util::Format("hd_low", "video/x-any", 1280, 720, 30.0, -1, -1, -1, 3000),
+      util::Format("sd", "video/x-any", 854, 480, 30.0, -1, -1, -1, 1200),
+  };
+  const util::Format& hd_60_format = formats.at(0);
+  const util::Format& hd_30_format = formats.at(1);
+  const util::Format& hd_low_format = formats.at(2);
+  const util::Format& sd_format = formats.at(3);
+
+  const std::deque<std::unique_ptr<MediaChunk>> empty_queue;
+  const base::TimeDelta playback_time = base::TimeDelta::FromSeconds(1);
+  const base::TimeDelta chunk_duration = base::TimeDelta::FromSeconds(2);
+
+  // 30s of video buffered, enough to both switch up and not need to switch
+  // down.
+  std::deque<std::unique_ptr<MediaChunk>> queue_30s;
+  {
+    base::TimeDelta current_chunk_start = playback_time;
+    for (int i = 0; i < 15; i++) {
+      base::TimeDelta current_chunk_end = current_chunk_start + chunk_duration;
+      queue_30s.emplace_back(new MockMediaChunk(
+          &data_spec, Chunk::kTriggerUnspecified, &hd_60_format,
+          current_chunk_start.InMicroseconds(),
+          current_chunk_end.InMicroseconds(), kChunkIndex + i,
+          Chunk::kNoParentId));
+      current_chunk_start = current_chunk_end;
+    }
+  }
+
+  AdaptiveEvaluator evaluator(
+      &meter_, kExampleInitialBitrate, kExampleMinDurationIncrease,
+      kExampleMaxDurationDecrease, kExampleMinDurationRetain,
+      kExampleBandwidthFraction);
+  RenderFeedback feedback;
+  evaluator.SetRenderFeedback(&feedback);
+
+  FormatEvaluation evaluation;
+  PlaybackRate rate;
+
+  // Bandwidth is never the limit.
+  EXPECT_CALL(meter_, GetBitrateEstimate()).WillRepeatedly(Return(100000));
+
+  evaluator.Evaluate(empty_queue, playback_time, formats, &evaluation, rate);
+  ASSERT_THAT(evaluation.format_, NotNull());
+  EXPECT_THAT(*evaluation.format_, Eq(hd_60_format));
+
+  VLOG(1) << "A 720p viewport needs no more than 720p, even with a full "
+          << "buffer.";
+  feedback.SetViewportSize(1280, 720);
+  evaluator.Evaluate(queue_30s, playback_time, formats, &evaluation, rate);
+  EXPECT_THAT(*evaluation.format_, Eq(hd_low_format));
+
+  VLOG(1) << "A decoder limited to 30fps can still have 1080p.";
+  feedback.SetViewportSize(0, 0);
+  feedback.SetDecoderLimits(0, 0, 30.0);
+  evaluator.Evaluate(queue_30s, playback_time, formats, &evaluation, rate);
+  EXPECT_THAT(*evaluation.format_, Eq(hd_30_format));
+
+  VLOG(1) << "A decoder that handles nothing gets the lowest bitrate.";
+  feedback.SetDecoderLimits(640, 360, 0);
+  evaluator.Evaluate(queue_30s, playback_time, formats, &evaluation, rate);
+  EXPECT_THAT(*evaluation.format_, Eq(sd_format));
+
+  feedback.SetDecoderLimits(0, 0, 0);
+  evaluator.Evaluate(queue_30s, playback_time, formats, &evaluation, rate);
+  EXPECT_THAT(*evaluation.format_, Eq(hd_60_format));
+
+  VLOG(1) << "Dropping 20% of frames steps down, even with a full buffer.";
+  for (int i = 0; i < 4; i++) {
+    feedback.ReportFrames(24, 6, hd_60_format.GetBitrate());
+  }
+  EXPECT_THAT(feedback.max_bitrate(), Eq(hd_60_format.GetBitrate() - 1));
+  evaluator.Evaluate(queue_30s, playback_time, formats, &evaluation, rate);
+  EXPECT_THAT(*evaluation.format_, Eq(hd_30_format));
+
+  VLOG(1) << "Frames of the old format still buffered don't step down again.";
+  feedback.ReportFrames(96, 24, hd_60_format.GetBitrate());
+  evaluator.Evaluate(queue_30s, playback_time, formats, &evaluation, rate);
+  EXPECT_THAT(*evaluation.format_, Eq(hd_30_format));
+
+  VLOG(1) << "Still dropping frames steps down further.";
+  feedback.ReportFrames(96, 24, hd_30_format.GetBitrate());
+  evaluator.Evaluate(queue_30s, playback_time, formats, &evaluation, rate);
+  EXPECT_THAT(*evaluation.format_, Eq(hd_low_format));
+
+  VLOG(1) << "Once frames recover, step back up one format at a time.";
+  for (int i = 0; i < RenderFeedback::kReportPeriodsToStepUp - 1; i++) {
+    feedback.ReportFrames(120, 1, hd_low_format.GetBitrate());
+  }
+  evaluator.Evaluate(queue_30s, playback_time, formats, &evaluation, rate);
+  EXPECT_THAT(*evaluation.format_, Eq(hd_low_format));
+
+  feedback.ReportFrames(120, 1, hd_low_format.GetBitrate());
+  evaluator.Evaluate(queue_30s, playback_time, formats, &evaluation, rate);
+  EXPECT_THAT(*evaluation.format_, Eq(hd_30_format));
+
+  for (int i = 0; i < RenderFeedback::kReportPeriodsToStepUp; i++) {
+    feedback.ReportFrames(120, 0, hd_30_format.GetBitrate());
+  }
+  EXPECT_THAT(feedback.max_bitrate(), Eq(0));
+  evaluator.Evaluate(queue_30s, playback_time, formats, &evaluation, rate);
+  EXPECT_THAT(*evaluation.format_, Eq(hd_60_format));
+
+  evaluator.SetRenderFeedback(nullptr);
+  evaluator.Disable();
+}
+
+namespace {
+struct SimulationResult {
+  int64_t bitrate = 0;
+  base::TimeDelta stalled;
+  // The bitrate chosen for each chunk.
+  std::vector<int64_t> bitrates;
+};
+
+// Called with the URL, size, time to first byte and total time of each
+// simulated transfer, to report it as the session under test would.
+using TransferCB = std::function<void(const std::string&,
+                                      int64_t,
+                                      base::TimeDelta,
+                                      base::TimeDelta)>;
+
+// Plays a simulated session of |chunks| chunks over a link where each request
+// waits |kLatency| before its response comes in at |kThroughput|. Every 2s of
+// video comes with a small audio segment from the same host, so request
+// sizes are mixed. Returns the bitrate settled on and the time spent stalled.
+SimulationResult SimulateSession(AdaptiveEvaluator* evaluator,
+                                 const TransferCB& on_transfer,
+                                 const std::vector<util::Format>& formats,
+                                 int chunks = 150) {
+  const upstream::DataSpec data_spec(upstream::Uri(""));
+  const base::TimeDelta kLatency = base::TimeDelta::FromMilliseconds(250);
+  constexpr int64_t kThroughput = 10000000;
+  constexpr int64_t kAudioBitrate = 128000;
+  const base::TimeDelta kChunkDuration = base::TimeDelta::FromSeconds(2);
+  const base::TimeDelta kMaxBuffer = base::TimeDelta::FromSeconds(30);
+
+  auto fetch = [&](const char* url, int64_t bitrate) {
+    int64_t bytes = bitrate * kChunkDuration.InSeconds() / 8;
+    base::TimeDelta elapsed =
+        kLatency + base::TimeDelta::FromMicroseconds(bytes * 8 * 1000000 /
+                                                     kThroughput);
+    on_transfer(url, bytes, kLatency, elapsed);
+    return elapsed;
+  };
+
+  SimulationResult result;
+  std::deque<std::unique_ptr<MediaChunk>> queue;
+  FormatEvaluation evaluation;
+  PlaybackRate rate;
+  base::TimeDelta position;
+  base::TimeDelta buffer_end;
+  for (int i = 0; i < chunks; i++) {
+    while (!queue.empty() &&
+           base::TimeDelta::FromMicroseconds(queue.front()->end_time_us()) <=
+               position) {
+      queue.pop_front();
+    }
+    evaluator->Evaluate(queue, position, formats, &evaluation, rate);
+    const util::Format* format = nullptr;
+    for (const util::Format& candidate : formats) {
+      if (candidate == *evaluation.format_) {
+        format = &candidate;
+      }
+    }
+    CHECK(format);
+    result.bitrate = format->GetBitrate();
+    result.bitrates.push_back(result.bitrate);
+
+    base::TimeDelta elapsed = fetch("http://cdn.example/video", result.bitrate);
+    elapsed += fetch("http://cdn.example/audio", kAudioBitrate);
+    // Playback only starts once there is a chunk.
+    if (i > 0) {
+      base::TimeDelta buffered = buffer_end - position;
+      result.stalled += std::max(base::TimeDelta(), elapsed - buffered);
+      position += std::min(elapsed, buffered);
+    }
+    queue.emplace_back(new MockMediaChunk(
+        &data_spec, Chunk::kTriggerUnspecified, format,
+        buffer_end.InMicroseconds(),
+        (buffer_end + kChunkDuration).InMicroseconds(), i,
+        Chunk::kNoParentId));
+    buffer_end += kChunkDuration;
+    // Wait for room, as the loader would.
+    position = std::max(position, buffer_end - kMaxBuffer);
+  }
+  return result;
+}
+}  // namespace
+
+TEST_F(AdaptiveEvaluatorTest, LatencySimulation) {
+  const std::vector<util::Format> formats{
+      util::Format("1", "video/x-any", -1, -1, 0.0, -1, -1, -1, 8000000),
+      util::Format("2", "video/x-any", -1, -1, 0.0, -1, -1, -1, 5000000),
+      util::Format("3", "video/x-any", -1, -1, 0.0, -1, -1, -1, 3000000),
+      util::Format("4", "video/x-any", -1, -1, 0.0, -1, -1, -1, 1500000),
+      util::Format("5", "video/x-any", -1, -1, 0.0, -1, -1, -1, 800000),
+  };
+
+  VLOG(1) << "A single rate over whole requests is dragged down by the "
+          << "latency of the small ones.";
+  upstream::HostStats rate_stats;
+  EXPECT_CALL(meter_, GetBitrateEstimate())
+      .WillRepeatedly(Invoke([&rate_stats]() {
+        return rate_stats.GetThroughput("http://cdn.example/");
+      }));
+  AdaptiveEvaluator rate_evaluator(
+      &meter_, kExampleInitialBitrate, kExampleMinDurationIncrease,
+      kExampleMaxDurationDecrease, kExampleMinDurationRetain,
+      kExampleBandwidthFraction);
+  SimulationResult rate_result = SimulateSession(
+      &rate_evaluator,
+      [&rate_stats](const std::string& url, int64_t bytes,
+                    base::TimeDelta first_byte, base::TimeDelta elapsed) {
+        rate_stats.OnTransfer(url, bytes, elapsed);
+      },
+      formats);
+  EXPECT_EQ(1500000, rate_result.bitrate);
+  EXPECT_EQ(base::TimeDelta(), rate_result.stalled);
+  VerifyAndClearMocks();
+
+  VLOG(1) << "Predicting latency + size / throughput gets the most out of "
+          << "the link without stalling.";
+  upstream::HostStats latency_stats;
+  EXPECT_CALL(meter_, GetBitrateEstimate())
+      .WillRepeatedly(Return(upstream::BandwidthMeterInterface::kNoEstimate));
+  AdaptiveEvaluator latency_evaluator(
+      &meter_, kExampleInitialBitrate, kExampleMinDurationIncrease,
+      kExampleMaxDurationDecrease, kExampleMinDurationRetain,
+      kExampleBandwidthFraction);
+  latency_evaluator.SetHostStats(&latency_stats);
+  SimulationResult latency_result = SimulateSession(
+      &latency_evaluator,
+      [&latency_stats](const std::string& url, int64_t bytes,
+                       base::TimeDelta first_byte, base::TimeDelta elapsed) {
+        latency_stats.OnTransfer(url, bytes, elapsed, first_byte);
+      },
+      formats);
+  // 5 Mbps segments take 1.25s of the 1.5s (75%) budget; 8 Mbps ones 1.85s.
+  EXPECT_EQ(5000000, latency_result.bitrate);
+  EXPECT_EQ(base::TimeDelta(), latency_result.stalled);
+}
+
+TEST_F(AdaptiveEvaluatorTest, ReplayAdaptsAsRecorded) {
+  const std::vector<util::Format> formats{
+      util::Format("1", "video/x-any", -1, -1, 0.0, -1, -1, -1, 8000000),
+      util::Format("2", "video/x-any", -1, -1, 0.0, -1, -1, -1, 5000000),
+      util::Format("3", "video/x-any", -1, -1, 0.0, -1, -1, -1, 3000000),
+      util::Format("4", "video/x-any", -1, -1, 0.0, -1, -1, -1, 1500000),
+      util::Format("5", "video/x-any", -1, -1, 0.0, -1, -1, -1, 800000),
+  };
+  constexpr int kChunks = 20;
+  EXPECT_CALL(meter_, GetBitrateEstimate())
+      .WillRepeatedly(Return(upstream::BandwidthMeterInterface::kNoEstimate));
+  base::ScopedTempDir dir;
+  ASSERT_TRUE(dir.CreateUniqueTempDir());
+  base::FilePath path = dir.path().Append("trace");
+
+  // Record the session, reporting to the host stats as CurlDataSource does.
+  upstream::HostStats recorded_stats;
+  SimulationResult recorded;
+  {
+    upstream::NetworkTrace trace;
+    ASSERT_TRUE(trace.StartRecording(path));
+    AdaptiveEvaluator evaluator(
+        &meter_, kExampleInitialBitrate, kExampleMinDurationIncrease,
+        kExampleMaxDurationDecrease, kExampleMinDurationRetain,
+        kExampleBandwidthFraction);
+    evaluator.SetHostStats(&recorded_stats);
+    recorded = SimulateSession(
+        &evaluator,
+        [&recorded_stats, &trace](const std::string& url, int64_t bytes,
+                                  base::TimeDelta first_byte,
+                                  base::TimeDelta elapsed) {
+          recorded_stats.OnTransfer(url, bytes, elapsed, first_byte);
+          upstream::NetworkTrace::Transfer transfer;
+          transfer.key = upstream::NetworkTrace::KeyOf(
+              upstream::DataSpec(upstream::Uri(url)));
+          transfer.open_result = bytes;
+          transfer.open_time = first_byte;
+          transfer.response_code = 200;
+          transfer.read_results = {bytes, upstream::RESULT_END_OF_INPUT};
+          transfer.read_times = {elapsed, elapsed};
+          transfer.data.assign(bytes, 'x');
+          trace.Add(transfer);
+        },
+        formats, kChunks);
+  }
+
+  // Replay it with the requests going through ReplayDataSource, which is all
+  // the host stats hear from. Either way the chunks take as long as recorded;
+  // |mismatches| counts requests for other sizes than were recorded.
+  auto replay_session = [&](upstream::HostStats* host_stats,
+                            int* mismatches) {
+    upstream::NetworkTrace trace;
+    CHECK(trace.Load(path));
+    trace.set_paced(false);
+    upstream::ReplayDataSource replay(&trace, nullptr);
+    replay.SetHostStats(host_stats);
+    AdaptiveEvaluator evaluator(
+        &meter_, kExampleInitialBitrate, kExampleMinDurationIncrease,
+        kExampleMaxDurationDecrease, kExampleMinDurationRetain,
+        kExampleBandwidthFraction);
+    evaluator.SetHostStats(host_stats);
+    return SimulateSession(
+        &evaluator,
+        [&replay, mismatches](const std::string& url, int64_t bytes,
+                              base::TimeDelta first_byte,
+                              base::TimeDelta elapsed) {
+          replay.Open(upstream::DataSpec(upstream::Uri(url)));
+          if (replay.ReadAllToString().size() != static_cast<size_t>(bytes)) {
+            ++*mismatches;
+          }
+          replay.Close();
+        },
+        formats, kChunks);
+  };
+
+  upstream::HostStats replayed_stats;
+  int mismatches = 0;
+  SimulationResult replayed = replay_session(&replayed_stats, &mismatches);
+  EXPECT_EQ(recorded.bitrates, replayed.bitrates);
+  EXPECT_EQ(0, mismatches);
+  EXPECT_EQ(recorded_stats.GetThroughput("http://cdn.example/"),
+            replayed_stats.GetThroughput("http://cdn.example/"));
+  EXPECT_EQ(recorded_stats.GetLatency("http://cdn.example/"),
+            replayed_stats.GetLatency("http://cdn.example/"));
+
+  // Without the transfers reported, the choices are not the recorded ones.
+  mismatches = 0;
+  SimulationResult unreported = replay_session(nullptr, &mismatches);
+  EXPECT_NE(recorded.bitrates, unreported.bitrates);
+  EXPECT_NE(0, mismatches);
+}
+
 }  // namespace chunk
 }  // namespace ndash
@@ -41,10 +41,18 @@ void ChunkOperationHolder::SetEndOfStream(bool end_of_stream) {
   end_of_stream_ = end_of_stream;
 }
 
+void ChunkOperationHolder::SetLoadAllowance(int64_t duration_us,
+                                            int64_t bytes) {
+  load_allowance_us_ = duration_us;
+  load_allowance_bytes_ = bytes;
+}
+
 void ChunkOperationHolder::Clear() {
   queue_size_ = 0;
   chunk_ = nullptr;
   end_of_stream_ = false;
+  load_allowance_us_ = 0;
+  load_allowance_bytes_ = 0;
 }
 
 }  // namespace chunk
@@ -59,6 +59,14 @@ class ChunkOperationHolder {
   void SetEndOfStream(bool end_of_stream);
   bool IsEndOfStream() const { return end_of_stream_; }
 
+  // How much more media the caller has room for past its queue, as a
+  // duration and a size. A chunk source may fetch several segments in one
+  // chunk as long as they fit; when either is zero (the default) it should
+  // fetch one at a time.
+  void SetLoadAllowance(int64_t duration_us, int64_t bytes);
+  int64_t GetLoadAllowanceUs() const { return load_allowance_us_; }
+  int64_t GetLoadAllowanceBytes() const { return load_allowance_bytes_; }
+
  private:
   // The number of MediaChunk objects to retain in a queue.
   int32_t queue_size_;
@@ -72,6 +80,9 @@ class ChunkOperationHolder {
 
   // Indicates that the end of the stream has been reached.
   bool end_of_stream_;
+
+  int64_t load_allowance_us_ = 0;
+  int64_t load_allowance_bytes_ = 0;
 };
 
 }  // namespace chunk
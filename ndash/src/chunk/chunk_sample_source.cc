@@ -16,6 +16,7 @@
 
 #include "chunk/chunk_sample_source.h"
 
+#include <algorithm>
 #include <limits>
 
 #include "base/bind.h"
@@ -29,17 +30,37 @@
 
 namespace {
 constexpr int64_t kNoResetPending = std::numeric_limits<int64_t>::min();
+// Replacing buffered chunks is given up if less than this is left to play
+// before it would finish.
+constexpr int64_t kMinBufferWhileReplacingUs = 2500000;
 }
 
 namespace ndash {
 namespace chunk {
 
+DefaultLoaderFactory::DefaultLoaderFactory(
+    const util::ThreadConfig* thread_config)
+    : thread_config_(thread_config) {}
+
 DefaultLoaderFactory::~DefaultLoaderFactory() {}
 
 std::unique_ptr<upstream::LoaderInterface> DefaultLoaderFactory::CreateLoader(
     ChunkSourceInterface* chunk_source) {
   return std::unique_ptr<upstream::LoaderInterface>(
-      new upstream::LoaderThread("Loader:" + chunk_source->GetContentType()));
+      new upstream::LoaderThread("Loader:" + chunk_source->GetContentType(),
+                                 thread_config_));
+}
+
+PooledLoaderFactory::PooledLoaderFactory(
+    scoped_refptr<base::TaskRunner> task_runner)
+    : task_runner_(task_runner) {}
+
+PooledLoaderFactory::~PooledLoaderFactory() {}
+
+std::unique_ptr<upstream::LoaderInterface> PooledLoaderFactory::CreateLoader(
+    ChunkSourceInterface* chunk_source) {
+  return std::unique_ptr<upstream::LoaderInterface>(
+      new upstream::LoaderThread(task_runner_));
 }
 
 ChunkSampleSource::ChunkSampleSource(
@@ -150,6 +171,8 @@ void ChunkSampleSource::DisableAndClear() {
   chunk_source_->Disable(&media_chunks_);
   sample_queue_->Clear();
   media_chunks_.clear();
+  AbandonReplacement();
+  ClearSpliceOut();
   ClearCurrentLoadable();
   load_control_->TrimAllocator();
 
@@ -187,15 +210,33 @@ SampleSourceReaderInterface::ReadResult ChunkSampleSource::ReadData(
     return NOTHING_READ;
   }
 
-  bool have_samples = !sample_queue_->IsEmpty();
+  if (splice_out_queue_) {
+    if (!splice_out_queue_->IsEmpty()) {
+      return ReadFrom(splice_out_queue_.get(), &splice_out_chunks_, false,
+                      format_holder, sample_holder);
+    }
+    // Reached the splice point.
+    ClearSpliceOut();
+  }
+  return ReadFrom(sample_queue_.get(), &media_chunks_, loading_finished_,
+                  format_holder, sample_holder);
+}
+
+SampleSourceReaderInterface::ReadResult ChunkSampleSource::ReadFrom(
+    extractor::DefaultTrackOutput* queue,
+    std::deque<std::unique_ptr<MediaChunk>>* chunks,
+    bool loading_finished,
+    MediaFormatHolder* format_holder,
+    SampleHolder* sample_holder) {
+  bool have_samples = !queue->IsEmpty();
   BaseMediaChunk* current_chunk =
-      static_cast<BaseMediaChunk*>(media_chunks_.front().get());
+      static_cast<BaseMediaChunk*>(chunks->front().get());
 
-  while (have_samples && media_chunks_.size() > 1 &&
-         static_cast<BaseMediaChunk*>(media_chunks_.at(1).get())
-                 ->first_sample_index() <= sample_queue_->GetReadIndex()) {
-    media_chunks_.pop_front();
-    current_chunk = static_cast<BaseMediaChunk*>(media_chunks_.front().get());
+  while (have_samples && chunks->size() > 1 &&
+         static_cast<BaseMediaChunk*>(chunks->at(1).get())
+                 ->first_sample_index() <= queue->GetReadIndex()) {
+    chunks->pop_front();
+    current_chunk = static_cast<BaseMediaChunk*>(chunks->front().get());
   }
 
   // TODO(rmrossi): downstream_format_ can't be a ptr to what comes
@@ -236,13 +277,13 @@ SampleSourceReaderInterface::ReadResult ChunkSampleSource::ReadData(
   }
 
   if (!have_samples) {
-    if (loading_finished_) {
+    if (loading_finished) {
       return END_OF_STREAM;
     }
     return NOTHING_READ;
   }
 
-  if (sample_queue_->GetSample(sample_holder)) {
+  if (queue->GetSample(sample_holder)) {
     bool decode_only =
         playback_rate_->IsForward()
             ? sample_holder->GetTimeUs() < last_seek_position_us_
@@ -256,6 +297,20 @@ SampleSourceReaderInterface::ReadResult ChunkSampleSource::ReadData(
   return NOTHING_READ;
 }
 
+void ChunkSampleSource::DiscardUntil(int64_t position_us) {
+  DCHECK(state_ == STATE_ENABLED);
+  if (IsPendingReset() || splice_out_queue_) {
+    return;
+  }
+  sample_queue_->DiscardUntil(position_us);
+  bool have_samples = !sample_queue_->IsEmpty();
+  while (have_samples && media_chunks_.size() > 1 &&
+         static_cast<BaseMediaChunk*>(media_chunks_.at(1).get())
+                 ->first_sample_index() <= sample_queue_->GetReadIndex()) {
+    media_chunks_.pop_front();
+  }
+}
+
 void ChunkSampleSource::SeekToUs(int64_t position_us) {
   DCHECK(state_ == STATE_ENABLED);
 
@@ -267,6 +322,10 @@ void ChunkSampleSource::SeekToUs(int64_t position_us) {
     return;
   }
 
+  // Seeks are made in the queue being loaded, so a splice under way ends
+  // here.
+  ClearSpliceOut();
+
   // If we're not pending a reset, see if we can seek within the sample queue.
   bool seek_inside_buffer =
       !IsPendingReset() && sample_queue_->SkipToKeyframeBefore(position_us);
@@ -279,6 +338,14 @@ void ChunkSampleSource::SeekToUs(int64_t position_us) {
                    ->first_sample_index() <= sample_queue_->GetReadIndex()) {
       media_chunks_.pop_front();
     }
+    // What was being replaced may have been skipped.
+    if (replacement_queue_) {
+      if (loader_->IsLoading()) {
+        loader_->CancelLoading();
+      } else {
+        AbandonReplacement();
+      }
+    }
   } else {
     // We failed, and need to restart.
     RestartFrom(position_us);
@@ -297,6 +364,17 @@ bool ChunkSampleSource::CanContinueBuffering() {
   return true;
 }
 
+size_t ChunkSampleSource::GetBytesAllocated() const {
+  size_t bytes = sample_queue_->GetBytesAllocated();
+  if (replacement_queue_) {
+    bytes += replacement_queue_->GetBytesAllocated();
+  }
+  if (splice_out_queue_) {
+    bytes += splice_out_queue_->GetBytesAllocated();
+  }
+  return bytes;
+}
+
 int64_t ChunkSampleSource::GetBufferedPositionUs() {
   DCHECK(state_ == STATE_ENABLED);
   if (IsPendingReset()) {
@@ -369,7 +447,11 @@ void ChunkSampleSource::OnLoadCanceled(upstream::LoadableInterface* loadable) {
   Chunk* current_loadable = current_loadable_holder_.GetChunk();
   NotifyLoadCanceled(current_loadable->GetNumBytesLoaded());
   ClearCurrentLoadable();
-  if (state_ == STATE_ENABLED) {
+  if (state_ == STATE_ENABLED && replacement_queue_ && !IsPendingReset()) {
+    // Only the replacement was canceled; what is buffered stays.
+    AbandonReplacement();
+    UpdateLoadControl();
+  } else if (state_ == STATE_ENABLED) {
     RestartFrom(pending_reset_position_us_);
   } else {
     DisableAndClear();
@@ -379,11 +461,22 @@ void ChunkSampleSource::OnLoadCanceled(upstream::LoadableInterface* loadable) {
 // Called on the thread that called StartLoading
 void ChunkSampleSource::OnLoadError(upstream::LoadableInterface* loadable,
                                     ChunkLoadErrorReason e) {
+  if (replacement_queue_) {
+    // Not worth retrying when the chunks being replaced can be played.
+    NotifyLoadError(e);
+    chunk_source_->OnChunkLoadError(current_loadable_holder_.GetChunk(), e);
+    AbandonReplacement();
+    UpdateLoadControl();
+    return;
+  }
+  NotifyLoadError(e);
+  chunk_source_->OnChunkLoadError(current_loadable_holder_.GetChunk(), e);
+  if (RetryElsewhere()) {
+    return;
+  }
   current_loadable_error_reason_ = e;
   current_loadable_error_count_++;
   current_loadable_error_timestamp_ = base::TimeTicks::Now();
-  NotifyLoadError(e);
-  chunk_source_->OnChunkLoadError(current_loadable_holder_.GetChunk(), e);
   UpdateLoadControl();
 }
 
@@ -400,6 +493,8 @@ void ChunkSampleSource::RestartFrom(int64_t position_us) {
   } else {
     sample_queue_->Clear();
     media_chunks_.clear();
+    AbandonReplacement();
+    ClearSpliceOut();
     ClearCurrentLoadable();
     UpdateLoadControl();
   }
@@ -417,6 +512,19 @@ void ChunkSampleSource::ClearCurrentLoadableException() {
 
 void ChunkSampleSource::UpdateLoadControl() {
   base::TimeTicks now = base::TimeTicks::Now();
+  if (replacement_queue_ && !loading_finished_ &&
+      sample_queue_->GetLargestParsedTimestampUs() - downstream_position_us_ <
+          kMinBufferWhileReplacingUs) {
+    // Nothing is added to the buffer while chunks are being replaced. Keep
+    // what is there rather than let it run out.
+    VLOG(1) << "Buffer too low to continue replacing chunks";
+    if (loader_->IsLoading()) {
+      loader_->CancelLoading();
+    } else {
+      AbandonReplacement();
+    }
+  }
+
   int64_t next_load_position_us = GetNextLoadPositionUs();
   bool is_backed_off =
       current_loadable_error_reason_ != ChunkLoadErrorReason::NO_ERROR;
@@ -425,26 +533,41 @@ void ChunkSampleSource::UpdateLoadControl() {
   // If we're not loading or backed off, evaluate the operation if (a) we don't
   // have the next chunk yet and we're not finished, or (b) if the last
   // evaluation was over 2000ms ago.
-  if (!loading_or_backed_off &&
-      ((current_loadable_holder_.GetChunk() == nullptr &&
+  if (!loading_or_backed_off && replacement_queue_) {
+    if (current_loadable_holder_.GetChunk() == nullptr) {
+      ContinueReplacement();
+      next_load_position_us = GetNextLoadPositionUs();
+    }
+  } else if (!loading_or_backed_off &&
+             ((current_loadable_holder_.GetChunk() == nullptr &&
         next_load_position_us != -1) ||
        (now - last_performed_buffer_operation_ >
         base::TimeDelta::FromSeconds(2)))) {
     // Perform the evaluation.
     last_performed_buffer_operation_ = now;
     DoChunkOperation();
+    bool replacing = MaybeStartReplacement();
     bool chunks_discarded =
+        !replacing &&
         DiscardUpstreamMediaChunks(current_loadable_holder_.GetQueueSize());
     // Update the next load position as appropriate.
     if (current_loadable_holder_.GetChunk() == nullptr) {
       // Set loadPosition to -1 to indicate that we don't have anything to load.
       next_load_position_us = -1;
-    } else if (chunks_discarded) {
+    } else if (replacing || chunks_discarded) {
       // Chunks were discarded, so we need to re-evaluate the load position.
       next_load_position_us = GetNextLoadPositionUs();
     }
   }
 
+  // Far enough ahead, take no part in the load control until playback gets
+  // closer.
+  if (max_buffered_duration_us_ > 0 && next_load_position_us != -1 &&
+      next_load_position_us - downstream_position_us_ >
+          max_buffered_duration_us_) {
+    next_load_position_us = -1;
+  }
+
   // Update the control with our current state, and determine whether we're the
   // next loader.
   bool next_loader =
@@ -457,7 +580,13 @@ void ChunkSampleSource::UpdateLoadControl() {
     }
     return;
   }
-  if (!loader_->IsLoading() && next_loader) {
+  // Replacements stand in for data already counted against the buffer, so a
+  // full buffer doesn't hold them back. The memory budget shared with other
+  // players does: until they are spliced in, the chunks they replace stay
+  // in memory too.
+  bool may_replace =
+      replacement_queue_ && load_control_->IsWithinMemoryBudget();
+  if (!loader_->IsLoading() && (next_loader || may_replace)) {
     MaybeStartLoading();
   }
 }
@@ -465,6 +594,9 @@ void ChunkSampleSource::UpdateLoadControl() {
 int64_t ChunkSampleSource::GetNextLoadPositionUs() {
   if (IsPendingReset()) {
     return pending_reset_position_us_;
+  } else if (replacement_queue_) {
+    Chunk* chunk = current_loadable_holder_.GetChunk();
+    return chunk ? static_cast<MediaChunk*>(chunk)->start_time_us() : -1;
   } else {
     return loading_finished_ ? -1 : media_chunks_.back()->end_time_us();
   }
@@ -472,6 +604,10 @@ int64_t ChunkSampleSource::GetNextLoadPositionUs() {
 
 void ChunkSampleSource::ResumeFromBackOff() {
   current_loadable_error_reason_ = ChunkLoadErrorReason::NO_ERROR;
+  // Somewhere else may have become available while backing off.
+  if (RetryElsewhere()) {
+    return;
+  }
   Chunk* backed_off_chunk = current_loadable_holder_.GetChunk();
   if (!IsMediaChunk(backed_off_chunk)) {
     DoChunkOperation();
@@ -525,6 +661,33 @@ void ChunkSampleSource::ResumeFromBackOff() {
   }
 }
 
+bool ChunkSampleSource::RetryElsewhere() {
+  Chunk* failed = current_loadable_holder_.GetChunk();
+  if (!IsMediaChunk(failed) || media_chunks_.empty() ||
+      media_chunks_.back().get() != failed) {
+    return false;
+  }
+  BaseMediaChunk* failed_chunk = static_cast<BaseMediaChunk*>(failed);
+  if (failed_chunk->first_sample_index() < sample_queue_->GetReadIndex()) {
+    // Already being read, so it can only be resumed.
+    return false;
+  }
+  std::unique_ptr<MediaChunk> retry =
+      chunk_source_->GetRetryChunk(*failed_chunk);
+  if (!retry) {
+    return false;
+  }
+
+  VLOG(1) << "Retrying " << failed->data_spec()->uri.uri() << " from "
+          << retry->data_spec()->uri.uri();
+  sample_queue_->DiscardUpstreamSamples(failed_chunk->first_sample_index());
+  media_chunks_.pop_back();
+  ClearCurrentLoadableException();
+  current_loadable_holder_.SetChunk(std::move(retry));
+  MaybeStartLoading();
+  return true;
+}
+
 void ChunkSampleSource::MaybeStartLoading() {
   Chunk* current_loadable = current_loadable_holder_.GetChunk();
   if (current_loadable == nullptr) {
@@ -540,10 +703,15 @@ void ChunkSampleSource::MaybeStartLoading() {
     current_loadable = chunk_up.release();
     BaseMediaChunk* media_chunk =
         static_cast<BaseMediaChunk*>(current_loadable);
-    media_chunk->Init(sample_queue_.get());
-    media_chunks_.push_back(std::unique_ptr<MediaChunk>(media_chunk));
-    if (IsPendingReset()) {
-      pending_reset_position_us_ = kNoResetPending;
+    if (replacement_queue_) {
+      media_chunk->Init(replacement_queue_.get());
+      replacement_chunks_.push_back(std::unique_ptr<MediaChunk>(media_chunk));
+    } else {
+      media_chunk->Init(sample_queue_.get());
+      media_chunks_.push_back(std::unique_ptr<MediaChunk>(media_chunk));
+      if (IsPendingReset()) {
+        pending_reset_position_us_ = kNoResetPending;
+      }
     }
     NotifyLoadStarted(media_chunk->data_spec()->length, media_chunk->type(),
                       media_chunk->trigger(), media_chunk->format(),
@@ -561,6 +729,24 @@ void ChunkSampleSource::MaybeStartLoading() {
 void ChunkSampleSource::DoChunkOperation() {
   current_loadable_holder_.SetEndOfStream(false);
   current_loadable_holder_.SetQueueSize(media_chunks_.size());
+  // Let the chunk source know how much it may fetch at once. Right after a
+  // reset there is nothing queued and it starts with a single segment anyway.
+  int64_t load_allowance_us = 0;
+  int64_t load_allowance_bytes = 0;
+  if (!IsPendingReset() && !media_chunks_.empty()) {
+    int64_t next_load_position_us = media_chunks_.back()->end_time_us();
+    load_control_->GetLoadAllowance(downstream_position_us_,
+                                    next_load_position_us, &load_allowance_us,
+                                    &load_allowance_bytes);
+    if (max_buffered_duration_us_ > 0) {
+      load_allowance_us = std::min(
+          load_allowance_us, downstream_position_us_ +
+                                 max_buffered_duration_us_ -
+                                 next_load_position_us);
+    }
+  }
+  current_loadable_holder_.SetLoadAllowance(load_allowance_us,
+                                            load_allowance_bytes);
   chunk_source_->GetChunkOperation(
       &media_chunks_,
       pending_reset_position_us_ != kNoResetPending
@@ -570,6 +756,88 @@ void ChunkSampleSource::DoChunkOperation() {
   loading_finished_ = current_loadable_holder_.IsEndOfStream();
 }
 
+bool ChunkSampleSource::MaybeStartReplacement() {
+  Chunk* next_chunk = current_loadable_holder_.GetChunk();
+  size_t queue_size = current_loadable_holder_.GetQueueSize();
+  if (!quality_upgrade_enabled_ || splice_out_queue_ || IsPendingReset() ||
+      !playback_rate_->IsNormal() || next_chunk == nullptr ||
+      !IsMediaChunk(next_chunk) || queue_size >= media_chunks_.size()) {
+    return false;
+  }
+  BaseMediaChunk* first_replaced =
+      static_cast<BaseMediaChunk*>(media_chunks_.at(queue_size).get());
+  if (first_replaced->first_sample_index() <= sample_queue_->GetReadIndex()) {
+    // Already being read.
+    return false;
+  }
+  std::unique_ptr<MediaChunk> replacement = chunk_source_->GetReplacementChunk(
+      *first_replaced, *next_chunk->format());
+  if (!replacement) {
+    return false;
+  }
+
+  VLOG(1) << "Replacing chunks from " << first_replaced->start_time_us()
+          << "us with " << next_chunk->format()->GetId();
+  replacement_queue_.reset(
+      new extractor::DefaultTrackOutput(load_control_->GetAllocator()));
+  current_loadable_holder_.SetChunk(std::move(replacement));
+  current_loadable_holder_.SetQueueSize(media_chunks_.size());
+  return true;
+}
+
+void ChunkSampleSource::ContinueReplacement() {
+  DCHECK(!replacement_chunks_.empty());
+  const MediaChunk* last_replacement = replacement_chunks_.back().get();
+  for (const std::unique_ptr<MediaChunk>& chunk : media_chunks_) {
+    if (chunk->start_time_us() == last_replacement->end_time_us()) {
+      std::unique_ptr<MediaChunk> replacement =
+          chunk_source_->GetReplacementChunk(*chunk,
+                                             *last_replacement->format());
+      if (replacement) {
+        current_loadable_holder_.SetChunk(std::move(replacement));
+      } else {
+        AbandonReplacement();
+      }
+      return;
+    }
+  }
+
+  if (last_replacement->end_time_us() < media_chunks_.back()->end_time_us() ||
+      !sample_queue_->ConfigureSpliceTo(replacement_queue_.get())) {
+    AbandonReplacement();
+    return;
+  }
+
+  // Everything from the first replaced chunk on has been loaded again.
+  VLOG(1) << "Splicing to " << last_replacement->format()->GetId();
+  DCHECK(!splice_out_queue_);
+  splice_out_queue_ = std::move(sample_queue_);
+  sample_queue_ = std::move(replacement_queue_);
+  splice_out_chunks_.swap(media_chunks_);
+  media_chunks_.swap(replacement_chunks_);
+}
+
+void ChunkSampleSource::AbandonReplacement() {
+  if (!replacement_queue_) {
+    return;
+  }
+  VLOG(1) << "Abandoning replacement of buffered chunks";
+  // Any chunk left in the holder is a replacement that has not started.
+  ClearCurrentLoadable();
+  replacement_queue_->Clear();
+  replacement_queue_.reset();
+  replacement_chunks_.clear();
+}
+
+void ChunkSampleSource::ClearSpliceOut() {
+  if (!splice_out_queue_) {
+    return;
+  }
+  splice_out_queue_->Clear();
+  splice_out_queue_.reset();
+  splice_out_chunks_.clear();
+}
+
 bool ChunkSampleSource::DiscardUpstreamMediaChunks(int32_t queue_length) {
   if (media_chunks_.size() <= queue_length) {
     return false;
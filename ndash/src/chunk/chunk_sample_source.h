@@ -23,7 +23,9 @@
 #include <limits>
 #include <memory>
 
+#include "base/memory/ref_counted.h"
 #include "base/memory/weak_ptr.h"
+#include "base/task_runner.h"
 #include "chunk/base_media_chunk.h"
 #include "chunk/chunk_operation_holder.h"
 #include "chunk/chunk_sample_source_event_listener.h"
@@ -40,6 +42,10 @@ namespace ndash {
 class PlaybackRate;
 struct TrackCriteria;
 
+namespace util {
+class ThreadConfig;
+}  // namespace util
+
 namespace chunk {
 
 constexpr int64_t kNoResetPending = std::numeric_limits<int64_t>::min();
@@ -55,11 +61,31 @@ class LoaderFactoryInterface {
       ChunkSourceInterface* chunk_source) = 0;
 };
 
+// Creates loaders that each start a thread of their own, with
+// |thread_config| (nullptr for the settings of all players).
 class DefaultLoaderFactory : public LoaderFactoryInterface {
  public:
+  explicit DefaultLoaderFactory(
+      const util::ThreadConfig* thread_config = nullptr);
   ~DefaultLoaderFactory() override;
   std::unique_ptr<upstream::LoaderInterface> CreateLoader(
       ChunkSourceInterface* chunk_source) override;
+
+ private:
+  const util::ThreadConfig* thread_config_;
+};
+
+// Creates loaders that run on a shared task runner (e.g. a LoaderPool) rather
+// than on a thread of their own.
+class PooledLoaderFactory : public LoaderFactoryInterface {
+ public:
+  explicit PooledLoaderFactory(scoped_refptr<base::TaskRunner> task_runner);
+  ~PooledLoaderFactory() override;
+  std::unique_ptr<upstream::LoaderInterface> CreateLoader(
+      ChunkSourceInterface* chunk_source) override;
+
+ private:
+  scoped_refptr<base::TaskRunner> task_runner_;
 };
 
 // A SampleSource that loads media in Chunks, which are themselves obtained
@@ -106,6 +132,8 @@ class ChunkSampleSource : public SampleSourceInterface,
 
   int64_t GetBufferedPositionUs() override;
   void Release() override;
+  // Returns the size of the allocations holding this source's samples.
+  size_t GetBytesAllocated() const;
   void LoadComplete(upstream::LoadableInterface* loadable,
                     upstream::LoaderOutcome outcome);
   void OnLoadCompleted(upstream::LoadableInterface* loadable);
@@ -113,6 +141,28 @@ class ChunkSampleSource : public SampleSourceInterface,
   void OnLoadError(upstream::LoadableInterface* loadable,
                    ChunkLoadErrorReason e);
 
+  // When enabled, buffered chunks that the chunk source asks to discard after
+  // an upswitch are instead loaded again in the new format (see
+  // ChunkSourceInterface::GetReplacementChunk()) into a second sample queue,
+  // while the old ones continue to play. Once every replacement has loaded,
+  // playback moves to the new queue at its first keyframe past what has been
+  // read. Off by default.
+  void SetQualityUpgradeEnabled(bool enabled) {
+    quality_upgrade_enabled_ = enabled;
+  }
+
+  // For a track that is loaded but not read, so that reading can start from
+  // it at once: holds loading back while more than |duration_us| is buffered
+  // past the position given to ContinueBuffering(). 0 (the default) means no
+  // limit.
+  void SetMaxBufferedDurationUs(int64_t duration_us) {
+    max_buffered_duration_us_ = duration_us;
+  }
+
+  // Drops the samples before |position_us| without reading them, and the
+  // chunks that held only those, as reading would.
+  void DiscardUntil(int64_t position_us);
+
  private:
   // Called when a sample has been read. Can be used to perform any
   // modifications necessary before the sample is returned.
@@ -134,9 +184,38 @@ class ChunkSampleSource : public SampleSourceInterface,
   // then the loading of B will be resumed. In all other cases B will be
   // discarded and the new chunk will be loaded.
   void ResumeFromBackOff();
+  // If the media chunk that failed to load can be fetched from elsewhere (see
+  // ChunkSourceInterface::GetRetryChunk()) and none of it has been read,
+  // discards it and starts loading it from there straight away, without
+  // backing off. Returns false if it didn't.
+  bool RetryElsewhere();
 
   void MaybeStartLoading();
 
+  // Called after DoChunkOperation(). If the chunk source asked for buffered
+  // chunks to be discarded in favour of a better format and they can be
+  // replaced instead, puts the first replacement in current_loadable_holder_
+  // and returns true.
+  bool MaybeStartReplacement();
+  // Puts the replacement for the chunk following the last one replaced in
+  // current_loadable_holder_, or, when there is none, splices to the
+  // replacement queue.
+  void ContinueReplacement();
+  // Drops the replacement queue and chunks. Must not be called while one of
+  // the chunks is loading.
+  void AbandonReplacement();
+  // Drops the queue and chunks that were spliced out of.
+  void ClearSpliceOut();
+
+  // Pops chunks from the front of |chunks| that |queue| has read past and
+  // reads from |queue|.
+  SampleSourceReaderInterface::ReadResult ReadFrom(
+      extractor::DefaultTrackOutput* queue,
+      std::deque<std::unique_ptr<MediaChunk>>* chunks,
+      bool loading_finished,
+      MediaFormatHolder* format_holder,
+      SampleHolder* sample_holder);
+
   // Sets up the current_loadable_holder_, passes it to the chunk source to
   // cause it to be updated with the next operation, and updates
   // loading_finished _if the end of the stream is reached.
@@ -227,6 +306,17 @@ class ChunkSampleSource : public SampleSourceInterface,
   std::unique_ptr<upstream::LoaderInterface> loader_;
 
   base::Closure disable_done_callback_;
+
+  bool quality_upgrade_enabled_ = false;
+  int64_t max_buffered_duration_us_ = 0;
+  // While buffered chunks are being replaced, the replacements and the queue
+  // they load into (on the same allocator as sample_queue_).
+  std::unique_ptr<extractor::DefaultTrackOutput> replacement_queue_;
+  std::deque<std::unique_ptr<MediaChunk>> replacement_chunks_;
+  // After a splice, the queue and chunks that were replaced. They are read
+  // up to the splice point before sample_queue_ is.
+  std::unique_ptr<extractor::DefaultTrackOutput> splice_out_queue_;
+  std::deque<std::unique_ptr<MediaChunk>> splice_out_chunks_;
 };
 
 }  // namespace chunk
@@ -16,8 +16,14 @@
 
 #include "chunk/chunk_sample_source.h"
 
+#include <map>
+#include <utility>
+#include <vector>
+
 #include "base/bind.h"
 #include "base/location.h"
+#include "base/message_loop/message_loop.h"
+#include "base/run_loop.h"
 #include "base/synchronization/waitable_event.h"
 #include "base/threading/thread.h"
 #include "chunk/base_media_chunk_mock.h"
@@ -26,16 +32,28 @@
 #include "gtest/gtest.h"
 #include "load_control.h"
 #include "media_format.h"
+#include "memory_governor.h"
 #include "playback_rate.h"
 #include "track_criteria.h"
 #include "upstream/allocator_mock.h"
 #include "upstream/data_spec.h"
+#include "upstream/default_allocator.h"
 #include "upstream/loader_mock.h"
 #include "upstream/uri.h"
 
 namespace ndash {
 namespace chunk {
 
+using ::testing::_;
+using ::testing::Assign;
+using ::testing::DoAll;
+using ::testing::Eq;
+using ::testing::IsNull;
+using ::testing::Ref;
+using ::testing::Return;
+using ::testing::ReturnPointee;
+using ::testing::SaveArg;
+
 namespace {
 void SourceReaderDisabled(SampleSourceReaderInterface* source,
                           base::WaitableEvent* waitable_event) {
@@ -61,13 +79,259 @@ void AsyncDisableHelper(chunk::ChunkSampleSource* css) {
                             base::Unretained(&waiter)));
   waiter.Wait();
 }
-}  // namespace
 
-using ::testing::_;
-using ::testing::Eq;
-using ::testing::IsNull;
-using ::testing::Ref;
-using ::testing::Return;
+constexpr int64_t kSegmentDurationUs = 1000000;
+constexpr int64_t kSampleDurationUs = 250000;
+
+// Outputs a keyframe every kSampleDurationUs of its time range when loaded.
+class FakeMediaChunk : public BaseMediaChunk {
+ public:
+  FakeMediaChunk(const upstream::DataSpec* data_spec,
+                 const util::Format* format,
+                 const MediaFormat* media_format,
+                 int segment_num)
+      : BaseMediaChunk(data_spec,
+                       kTriggerAdaptive,
+                       format,
+                       segment_num * kSegmentDurationUs,
+                       (segment_num + 1) * kSegmentDurationUs,
+                       segment_num,
+                       true,
+                       0),
+        media_format_(media_format) {}
+
+  const MediaFormat* GetMediaFormat() const override { return media_format_; }
+  scoped_refptr<const drm::RefCountedDrmInitData> GetDrmInitData()
+      const override {
+    return nullptr;
+  }
+  int64_t GetNumBytesLoaded() const override { return bytes_loaded_; }
+  void CancelLoad() override {}
+  bool IsLoadCanceled() const override { return false; }
+  bool Load() override {
+    const char data[4] = {0};
+    for (int64_t time_us = start_time_us(); time_us < end_time_us();
+         time_us += kSampleDurationUs) {
+      output()->WriteSampleData(data, sizeof(data));
+      output()->WriteSampleMetadata(time_us, kSampleDurationUs,
+                                    util::kSampleFlagSync, sizeof(data), 0);
+      bytes_loaded_ += sizeof(data);
+    }
+    return true;
+  }
+
+ private:
+  const MediaFormat* const media_format_;
+  int64_t bytes_loaded_ = 0;
+};
+
+// Offers |available| one second segments in a low bitrate format. Upswitch()
+// makes one more available, in a high bitrate format, and asks once for those
+// from |discard_from| on to be discarded. Failed chunks are retried from
+// "elsewhere".
+class FakeChunkSource : public ChunkSourceInterface {
+ public:
+  explicit FakeChunkSource(int available)
+      : spec_(upstream::Uri("http://somewhere")),
+        elsewhere_(upstream::Uri("http://elsewhere")),
+        low_("low", "video/mp4", 640, 360, 30, 1, 0, 0, 1000000),
+        high_("high", "video/mp4", 1920, 1080, 30, 1, 0, 0, 5000000),
+        available_(available) {
+    media_formats_[&low_] = MediaFormat::CreateVideoFormat(
+        "low", "video/mp4", "h264", 1000000, 32768, 10000000, 640, 360,
+        nullptr, 0);
+    media_formats_[&high_] = MediaFormat::CreateVideoFormat(
+        "high", "video/mp4", "h264", 5000000, 32768, 10000000, 1920, 1080,
+        nullptr, 0);
+  }
+
+  void Upswitch(int discard_from) {
+    selected_ = &high_;
+    discard_from_ = discard_from;
+    available_++;
+  }
+  int replacements() const { return replacements_; }
+  int retries() const { return retries_; }
+
+  bool CanContinueBuffering() const override { return true; }
+  bool Prepare() override { return true; }
+  int64_t GetDurationUs() override { return 10 * kSegmentDurationUs; }
+  const std::string GetContentType() override { return "video"; }
+  void Enable(const TrackCriteria* track_criteria) override {}
+  void ContinueBuffering(base::TimeDelta playback_position) override {}
+  void GetChunkOperation(std::deque<std::unique_ptr<MediaChunk>>* queue,
+                         base::TimeDelta playback_position,
+                         ChunkOperationHolder* out) override {
+    if (discard_from_ > 0 && queue->size() > discard_from_) {
+      out->SetQueueSize(discard_from_);
+      discard_from_ = 0;
+    }
+    int segment_num =
+        queue->empty() ? playback_position.InMicroseconds() / kSegmentDurationUs
+                       : queue->back()->GetNextChunkIndex();
+    if (segment_num >= available_) {
+      out->SetChunk(nullptr);
+      return;
+    }
+    out->SetChunk(NewChunk(*selected_, segment_num));
+  }
+  void OnChunkLoadCompleted(Chunk* chunk) override {}
+  void OnChunkLoadError(const Chunk* chunk, ChunkLoadErrorReason e) override {}
+  void Disable(std::deque<std::unique_ptr<MediaChunk>>* queue) override {}
+  std::unique_ptr<MediaChunk> GetReplacementChunk(
+      const MediaChunk& chunk,
+      const util::Format& format) override {
+    replacements_++;
+    return NewChunk(format == high_ ? high_ : low_, chunk.chunk_index());
+  }
+  std::unique_ptr<MediaChunk> GetRetryChunk(const MediaChunk& chunk) override {
+    retries_++;
+    return NewChunk(*chunk.format(), chunk.chunk_index(), &elsewhere_);
+  }
+
+ private:
+  std::unique_ptr<MediaChunk> NewChunk(const util::Format& format,
+                                       int segment_num) {
+    return NewChunk(format, segment_num, &spec_);
+  }
+  std::unique_ptr<MediaChunk> NewChunk(const util::Format& format,
+                                       int segment_num,
+                                       const upstream::DataSpec* spec) {
+    const util::Format& own_format = format == high_ ? high_ : low_;
+    return std::unique_ptr<MediaChunk>(new FakeMediaChunk(
+        spec, &own_format, media_formats_[&own_format].get(), segment_num));
+  }
+
+  const upstream::DataSpec spec_;
+  const upstream::DataSpec elsewhere_;
+  const util::Format low_;
+  const util::Format high_;
+  std::map<const util::Format*, std::unique_ptr<MediaFormat>> media_formats_;
+  int available_;
+  const util::Format* selected_ = &low_;
+  size_t discard_from_ = 0;
+  int replacements_ = 0;
+  int retries_ = 0;
+};
+
+// Drives a ChunkSampleSource over a FakeChunkSource, completing each load
+// as soon as it starts.
+class QualityUpgradeTest : public ::testing::Test {
+ protected:
+  // The buffer holds |buffer_size| bytes, allocated |allocation_size| at a
+  // time.
+  explicit QualityUpgradeTest(size_t allocation_size = 1024,
+                              int buffer_size = 1024 * 1024)
+      : chunk_source_(8),
+        allocator_(allocation_size),
+        load_control_(&allocator_),
+        loader_(new upstream::MockLoaderInterface) {
+    EXPECT_CALL(*loader_, IsLoading())
+        .WillRepeatedly(ReturnPointee(&is_loading_));
+    EXPECT_CALL(*loader_, StartLoading(_, _))
+        .WillRepeatedly(DoAll(SaveArg<0>(&loading_),
+                              Assign(&is_loading_, true), Return(true)));
+
+    class Factory : public LoaderFactoryInterface {
+     public:
+      explicit Factory(upstream::MockLoaderInterface* loader)
+          : loader_(loader) {}
+      std::unique_ptr<upstream::LoaderInterface> CreateLoader(
+          ChunkSourceInterface* chunk_source) override {
+        return std::unique_ptr<upstream::LoaderInterface>(loader_);
+      }
+
+     private:
+      upstream::MockLoaderInterface* loader_;
+    };
+    source_.reset(new ChunkSampleSource(
+        &chunk_source_, &load_control_, &playback_rate_, buffer_size, nullptr,
+        0, kDefaultMinLoadableRetryCount,
+        std::unique_ptr<LoaderFactoryInterface>(new Factory(loader_))));
+    load_control_.SetMemoryGovernor(&governor_,
+                                    MemoryGovernor::kDefaultPriority);
+    source_->SetQualityUpgradeEnabled(true);
+    source_->Register();
+    EXPECT_TRUE(source_->Prepare(0));
+    source_->Enable(&criteria_, 0);
+  }
+
+  ~QualityUpgradeTest() override {
+    source_->Disable();
+    base::RunLoop().RunUntilIdle();
+  }
+
+  // Lets the source load until it stops, failing the first load if
+  // |fail_first|. Returns the number of loads; the URI of each is appended
+  // to |uris_|.
+  int LoadAll(int64_t position_us, bool fail_first = false) {
+    int loads = 0;
+    source_->ContinueBuffering(position_us);
+    while (loading_) {
+      upstream::LoadableInterface* loadable = loading_;
+      loading_ = nullptr;
+      is_loading_ = false;
+      uris_.push_back(
+          static_cast<Chunk*>(loadable)->data_spec()->uri.uri());
+      if (fail_first && loads == 0) {
+        source_->LoadComplete(loadable, upstream::LOAD_ERROR);
+      } else {
+        loadable->Load();
+        source_->LoadComplete(loadable, upstream::LOAD_COMPLETE);
+      }
+      loads++;
+      source_->ContinueBuffering(position_us);
+    }
+    return loads;
+  }
+
+  // Reads up to |count| samples, appending the time and format id of each to
+  // |samples|.
+  void Read(size_t count,
+            std::vector<std::pair<int64_t, std::string>>* samples) {
+    int64_t position_us = samples->empty() ? 0 : samples->back().first;
+    while (count-- > 0) {
+      MediaFormatHolder format_holder;
+      SampleHolder sample(true);
+      SampleSourceReaderInterface::ReadResult result =
+          source_->ReadData(position_us, &format_holder, &sample);
+      if (result == SampleSourceReaderInterface::FORMAT_READ) {
+        format_id_ = format_holder.format->GetTrackId();
+        count++;
+      } else if (result == SampleSourceReaderInterface::SAMPLE_READ) {
+        samples->emplace_back(sample.GetTimeUs(), format_id_);
+        position_us = sample.GetTimeUs();
+      } else {
+        return;
+      }
+    }
+  }
+
+  base::MessageLoop message_loop_;
+  FakeChunkSource chunk_source_;
+  upstream::DefaultAllocator allocator_;
+  MemoryGovernor governor_;
+  LoadControl load_control_;
+  PlaybackRate playback_rate_;
+  TrackCriteria criteria_{"video"};
+  upstream::MockLoaderInterface* loader_;
+  upstream::LoadableInterface* loading_ = nullptr;
+  bool is_loading_ = false;
+  std::unique_ptr<ChunkSampleSource> source_;
+  std::string format_id_;
+  std::vector<std::string> uris_;
+};
+
+// Quality upgrades play no part here.
+using StandbyTest = QualityUpgradeTest;
+
+// Each segment takes an allocation of its own, and the buffer is full once
+// the 8 available are loaded.
+class FullBufferTest : public QualityUpgradeTest {
+ protected:
+  FullBufferTest() : QualityUpgradeTest(16, 8 * 16) {}
+};
+}  // namespace
 
 TEST(ChunkSampleSource, Constructor) {
   MockChunkSource chunk_source;
@@ -188,5 +452,113 @@ TEST(ChunkSampleSource, EnableUseDisable) {
   css.Release();
 }
 
+TEST_F(QualityUpgradeTest, SplicesReplacementsIn) {
+  EXPECT_EQ(8, LoadAll(0));
+  std::vector<std::pair<int64_t, std::string>> samples;
+  Read(4, &samples);
+
+  // Segments 4 to 7 are loaded again rather than discarded, then loading
+  // continues with segment 8.
+  chunk_source_.Upswitch(4);
+  EXPECT_EQ(5, LoadAll(kSegmentDurationUs));
+  EXPECT_EQ(4, chunk_source_.replacements());
+  EXPECT_EQ(9 * kSegmentDurationUs - kSampleDurationUs,
+            source_->GetBufferedPositionUs());
+
+  Read(100, &samples);
+  ASSERT_EQ(36u, samples.size());
+  for (size_t i = 0; i < samples.size(); i++) {
+    EXPECT_EQ(static_cast<int64_t>(i) * kSampleDurationUs, samples[i].first);
+    EXPECT_EQ(i < 16 ? "low" : "high", samples[i].second) << i;
+  }
+}
+
+TEST_F(QualityUpgradeTest, KeepsBufferWhenReplacementFails) {
+  EXPECT_EQ(8, LoadAll(0));
+  std::vector<std::pair<int64_t, std::string>> samples;
+  Read(4, &samples);
+
+  chunk_source_.Upswitch(4);
+  EXPECT_EQ(2, LoadAll(kSegmentDurationUs, true));
+  EXPECT_EQ(1, chunk_source_.replacements());
+
+  Read(100, &samples);
+  ASSERT_EQ(36u, samples.size());
+  for (size_t i = 0; i < samples.size(); i++) {
+    EXPECT_EQ(static_cast<int64_t>(i) * kSampleDurationUs, samples[i].first);
+    EXPECT_EQ(i < 32 ? "low" : "high", samples[i].second) << i;
+  }
+}
+
+TEST_F(QualityUpgradeTest, ReplacementWaitsForMemoryBudget) {
+  EXPECT_EQ(8, LoadAll(0));
+  std::vector<std::pair<int64_t, std::string>> samples;
+  Read(4, &samples);
+
+  // The memory budget is used up, so the first replacement is chosen but not
+  // loaded.
+  governor_.SetBudget(allocator_.GetTotalBytesAllocated());
+  chunk_source_.Upswitch(4);
+  EXPECT_EQ(0, LoadAll(kSegmentDurationUs));
+  EXPECT_EQ(1, chunk_source_.replacements());
+
+  governor_.SetBudget(0);
+  EXPECT_EQ(5, LoadAll(kSegmentDurationUs));
+  EXPECT_EQ(4, chunk_source_.replacements());
+}
+
+TEST_F(QualityUpgradeTest, RetriesFailedChunkElsewhereAtOnce) {
+  // The failed first segment is loaded again from the other host straight
+  // away, without waiting out a back-off, and loading carries on from there.
+  EXPECT_EQ(9, LoadAll(0, true));
+  EXPECT_EQ(1, chunk_source_.retries());
+  ASSERT_EQ(9u, uris_.size());
+  EXPECT_EQ("http://somewhere", uris_[0]);
+  EXPECT_EQ("http://elsewhere", uris_[1]);
+  EXPECT_EQ("http://somewhere", uris_[2]);
+
+  std::vector<std::pair<int64_t, std::string>> samples;
+  Read(100, &samples);
+  ASSERT_EQ(32u, samples.size());
+  for (size_t i = 0; i < samples.size(); i++) {
+    EXPECT_EQ(static_cast<int64_t>(i) * kSampleDurationUs, samples[i].first);
+  }
+}
+
+TEST_F(FullBufferTest, ReplacesWithBufferFull) {
+  EXPECT_EQ(8, LoadAll(0));
+
+  // Nothing more fits, but the replacements take the place of what is there.
+  chunk_source_.Upswitch(4);
+  EXPECT_EQ(4, LoadAll(kSegmentDurationUs));
+  EXPECT_EQ(4, chunk_source_.replacements());
+
+  std::vector<std::pair<int64_t, std::string>> samples;
+  Read(100, &samples);
+  ASSERT_EQ(32u, samples.size());
+  for (size_t i = 0; i < samples.size(); i++) {
+    EXPECT_EQ(static_cast<int64_t>(i) * kSampleDurationUs, samples[i].first);
+    EXPECT_EQ(i < 16 ? "low" : "high", samples[i].second) << i;
+  }
+}
+
+TEST_F(StandbyTest, LoadsAheadOnlySoFarAndDiscards) {
+  source_->SetMaxBufferedDurationUs(2 * kSegmentDurationUs);
+  // Up to 2 segments past the position, plus the one it falls in.
+  EXPECT_EQ(3, LoadAll(0));
+  EXPECT_EQ(0, LoadAll(kSampleDurationUs));
+
+  // Nothing is read, but playback moves on.
+  source_->DiscardUntil(2 * kSegmentDurationUs + kSampleDurationUs);
+  EXPECT_EQ(2, LoadAll(2 * kSegmentDurationUs + kSampleDurationUs));
+
+  std::vector<std::pair<int64_t, std::string>> samples;
+  Read(100, &samples);
+  ASSERT_EQ(11u, samples.size());
+  EXPECT_EQ(2 * kSegmentDurationUs + kSampleDurationUs, samples[0].first);
+  EXPECT_EQ(5 * kSegmentDurationUs - kSampleDurationUs,
+            samples.back().first);
+}
+
 }  // namespace chunk
 }  // namespace ndash
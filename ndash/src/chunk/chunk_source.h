@@ -136,6 +136,27 @@ class ChunkSourceInterface {
   //
   //  queue A representation of the currently buffered MediaChunks.
   virtual void Disable(std::deque<std::unique_ptr<MediaChunk>>* queue) = 0;
+
+  // Returns a chunk covering exactly the same media time as |chunk| but in
+  // |format|, or null if there is none (or it cannot be loaded without first
+  // loading initialization data). Used to replace buffered chunks after an
+  // upswitch. Sources that cannot do this need not override it.
+  //
+  // This method should only be called when the source is enabled.
+  virtual std::unique_ptr<MediaChunk> GetReplacementChunk(
+      const MediaChunk& chunk,
+      const util::Format& format) {
+    return nullptr;
+  }
+
+  // Returns a chunk loading the same media as |chunk|, which failed to load,
+  // from somewhere else (e.g. another CDN), or null if there is nowhere else
+  // worth trying. Sources that cannot do this need not override it.
+  //
+  // This method should only be called when the source is enabled.
+  virtual std::unique_ptr<MediaChunk> GetRetryChunk(const MediaChunk& chunk) {
+    return nullptr;
+  }
 };
 
 }  // namespace chunk
@@ -18,6 +18,7 @@
 
 #include "base/memory/ref_counted.h"
 #include "base/synchronization/lock.h"
+#include "base/trace_event/trace_event.h"
 #include "chunk/chunk_extractor_wrapper.h"
 #include "drm/drm_init_data.h"
 #include "extractor/extractor.h"
@@ -85,6 +86,8 @@ bool ContainerMediaChunk::IsLoadCanceled() const {
 
 bool ContainerMediaChunk::Load() {
   VLOG(5) << __FUNCTION__;
+  TRACE_EVENT2("ndash", "ContainerMediaChunk::Load", "uri",
+               data_spec()->uri.uri(), "start_time_us", start_time_us());
 
   upstream::DataSpec load_data_spec(
       upstream::DataSpec::GetRemainder(*data_spec(), bytes_loaded_));
@@ -17,6 +17,7 @@
 #include "chunk/initialization_chunk.h"
 #include "base/logging.h"
 #include "base/memory/ref_counted.h"
+#include "base/trace_event/trace_event.h"
 #include "chunk/chunk_extractor_wrapper.h"
 #include "drm/drm_init_data.h"
 #include "extractor/extractor.h"
@@ -116,6 +117,8 @@ bool InitializationChunk::IsLoadCanceled() const {
 }
 
 bool InitializationChunk::Load() {
+  TRACE_EVENT1("ndash", "InitializationChunk::Load", "uri",
+               data_spec()->uri.uri());
   upstream::DataSpec load_data_spec =
       upstream::DataSpec::GetRemainder(*data_spec(), bytes_loaded_);
 
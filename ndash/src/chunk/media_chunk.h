@@ -54,7 +54,7 @@ class MediaChunk : public Chunk {
              ParentId parent_id);
   ~MediaChunk() override;
 
-  int GetNextChunkIndex() const { return chunk_index_ + 1; }
+  int GetNextChunkIndex() const { return chunk_index_ + chunk_count_; }
   int GetPrevChunkIndex() const { return chunk_index_ - 1; }
 
   // Accessors
@@ -62,6 +62,12 @@ class MediaChunk : public Chunk {
   int64_t end_time_us() const { return end_time_us_; }
   int32_t chunk_index() const { return chunk_index_; }
 
+  // The number of consecutive chunk indices, from chunk_index(), whose media
+  // this chunk holds. It is more than one when neighbouring segments are
+  // fetched in a single request.
+  int32_t chunk_count() const { return chunk_count_; }
+  void set_chunk_count(int32_t chunk_count) { chunk_count_ = chunk_count; }
+
  private:
   // The start time of the media contained by the chunk.
   int64_t start_time_us_;
@@ -69,6 +75,8 @@ class MediaChunk : public Chunk {
   int64_t end_time_us_;
   // The chunk index.
   int32_t chunk_index_;
+  // The number of chunk indices covered.
+  int32_t chunk_count_ = 1;
 };
 
 }  // namespace chunk
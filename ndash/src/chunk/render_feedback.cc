@@ -0,0 +1,126 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "chunk/render_feedback.h"
+
+#include "base/logging.h"
+
+namespace ndash {
+namespace chunk {
+
+constexpr double RenderFeedback::kStepDownDropFraction;
+constexpr double RenderFeedback::kStepUpDropFraction;
+constexpr int64_t RenderFeedback::kFramesPerReportPeriod;
+constexpr int RenderFeedback::kReportPeriodsToStepUp;
+
+RenderFeedback::RenderFeedback() {}
+
+RenderFeedback::~RenderFeedback() {}
+
+void RenderFeedback::SetViewportSize(int32_t width, int32_t height) {
+  viewport_width_ = width;
+  viewport_height_ = height;
+}
+
+void RenderFeedback::SetDecoderLimits(int32_t max_width,
+                                      int32_t max_height,
+                                      double max_frame_rate) {
+  max_width_ = max_width;
+  max_height_ = max_height;
+  max_frame_rate_ = max_frame_rate;
+}
+
+void RenderFeedback::ReportFrames(int64_t rendered,
+                                  int64_t dropped,
+                                  int32_t bitrate) {
+  period_frames_ += rendered + dropped;
+  period_dropped_ += dropped;
+  if (period_frames_ < kFramesPerReportPeriod) {
+    return;
+  }
+
+  double drop_fraction = static_cast<double>(period_dropped_) / period_frames_;
+  period_frames_ = 0;
+  period_dropped_ = 0;
+
+  if (drop_fraction > kStepDownDropFraction) {
+    good_periods_ = 0;
+    // Frames of a format above the limit are still buffered after stepping
+    // down; they don't count against the new one.
+    if (bitrate > 0 && (max_bitrate_ == 0 || bitrate <= max_bitrate_)) {
+      previous_max_bitrates_.push_back(max_bitrate_);
+      max_bitrate_ = bitrate - 1;
+      VLOG(1) << "Dropped " << drop_fraction * 100
+              << "% of frames; limiting bitrate to " << max_bitrate_;
+    }
+  } else if (drop_fraction < kStepUpDropFraction) {
+    if (!previous_max_bitrates_.empty() &&
+        ++good_periods_ >= kReportPeriodsToStepUp) {
+      good_periods_ = 0;
+      max_bitrate_ = previous_max_bitrates_.back();
+      previous_max_bitrates_.pop_back();
+      VLOG(1) << "Frames recovered; limiting bitrate to " << max_bitrate_;
+    }
+  } else {
+    good_periods_ = 0;
+  }
+}
+
+std::vector<util::Format> RenderFeedback::GetAllowedFormats(
+    const std::vector<util::Format>& formats) const {
+  // Of the formats at least as large as the viewport, the smallest.
+  const util::Format* fill_viewport = nullptr;
+  if (viewport_width_ > 0 && viewport_height_ > 0) {
+    for (const util::Format& format : formats) {
+      if (format.GetWidth() >= viewport_width_ &&
+          format.GetHeight() >= viewport_height_ &&
+          (!fill_viewport ||
+           format.GetWidth() * format.GetHeight() <
+               fill_viewport->GetWidth() * fill_viewport->GetHeight())) {
+        fill_viewport = &format;
+      }
+    }
+  }
+
+  std::vector<util::Format> allowed;
+  const util::Format* lowest = nullptr;
+  for (const util::Format& format : formats) {
+    if (!lowest || format.GetBitrate() < lowest->GetBitrate()) {
+      lowest = &format;
+    }
+    // Unknown (non-positive) dimensions are never limited.
+    if ((max_width_ > 0 && format.GetWidth() > max_width_) ||
+        (max_height_ > 0 && format.GetHeight() > max_height_) ||
+        (max_frame_rate_ > 0 && format.GetFrameRate() > max_frame_rate_)) {
+      continue;
+    }
+    if (fill_viewport && (format.GetWidth() > fill_viewport->GetWidth() ||
+                          format.GetHeight() > fill_viewport->GetHeight())) {
+      continue;
+    }
+    if (max_bitrate_ > 0 && format.GetBitrate() > max_bitrate_) {
+      continue;
+    }
+    allowed.push_back(format);
+  }
+  if (allowed.empty() && lowest) {
+    allowed.push_back(*lowest);
+  }
+  return allowed;
+}
+
+}  // namespace chunk
+}  // namespace ndash
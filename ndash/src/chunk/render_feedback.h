@@ -0,0 +1,94 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NDASH_CHUNK_RENDER_FEEDBACK_H_
+#define NDASH_CHUNK_RENDER_FEEDBACK_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "util/format.h"
+
+namespace ndash {
+namespace chunk {
+
+// What the client reports about showing video: the size of the viewport,
+// the limits of its decoder, and how many frames it drops. An
+// AdaptiveEvaluator given one only chooses among the formats it allows:
+//
+//  - none larger or faster than the decoder handles;
+//  - none larger than the smallest that fills the viewport;
+//  - when more than kStepDownDropFraction of the frames in a report period
+//    were dropped or late, none with the bitrate of the format being played
+//    or above. After kReportPeriodsToStepUp periods in a row dropping less
+//    than kStepUpDropFraction, that limit is lifted again, one step at a
+//    time.
+//
+// If no format is allowed the one with the lowest bitrate is, so that
+// playback goes on.
+class RenderFeedback {
+ public:
+  static constexpr double kStepDownDropFraction = 0.1;
+  static constexpr double kStepUpDropFraction = 0.02;
+  // Frames counted before the drop rate is judged.
+  static constexpr int64_t kFramesPerReportPeriod = 120;
+  static constexpr int kReportPeriodsToStepUp = 5;
+
+  RenderFeedback();
+  ~RenderFeedback();
+
+  // Sets the size, in pixels, that video is shown at, or 0 if unknown.
+  void SetViewportSize(int32_t width, int32_t height);
+
+  // Sets the largest video the decoder can handle, each 0 for no limit.
+  void SetDecoderLimits(int32_t max_width,
+                        int32_t max_height,
+                        double max_frame_rate);
+
+  // Adds |rendered| frames shown on time and |dropped| dropped or late,
+  // while showing a format of |bitrate|.
+  void ReportFrames(int64_t rendered, int64_t dropped, int32_t bitrate);
+
+  // Returns the formats in |formats| that are allowed, in the same order.
+  std::vector<util::Format> GetAllowedFormats(
+      const std::vector<util::Format>& formats) const;
+
+  // Returns the bitrate that formats must not exceed because of dropped
+  // frames, or 0 if there is no such limit.
+  int32_t max_bitrate() const { return max_bitrate_; }
+
+  RenderFeedback(const RenderFeedback& other) = delete;
+  RenderFeedback& operator=(const RenderFeedback& other) = delete;
+
+ private:
+  int32_t viewport_width_ = 0;
+  int32_t viewport_height_ = 0;
+  int32_t max_width_ = 0;
+  int32_t max_height_ = 0;
+  double max_frame_rate_ = 0;
+
+  int64_t period_frames_ = 0;
+  int64_t period_dropped_ = 0;
+  int good_periods_ = 0;
+  int32_t max_bitrate_ = 0;
+  // The limits stepped down from, most recent last.
+  std::vector<int32_t> previous_max_bitrates_;
+};
+
+}  // namespace chunk
+}  // namespace ndash
+
+#endif  // NDASH_CHUNK_RENDER_FEEDBACK_H_
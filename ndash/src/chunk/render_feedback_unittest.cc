@@ -0,0 +1,85 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "chunk/render_feedback.h"
+
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "util/format.h"
+
+namespace ndash {
+namespace chunk {
+
+using ::testing::ElementsAre;
+using ::testing::Eq;
+
+namespace {
+const std::vector<util::Format> kFormats{
+    util::Format("hd", "video/x-any", 1920, 1080, 30.0, -1, -1, -1, 5000),
+    util::Format("hd_low", "video/x-any", 1280, 720, 30.0, -1, -1, -1, 3000),
+    util::Format("sd", "video/x-any", 854, 480, 30.0, -1, -1, -1, 1200),
+};
+}  // namespace
+
+TEST(RenderFeedbackTest, NoFeedbackAllowsAll) {
+  RenderFeedback feedback;
+  EXPECT_THAT(feedback.GetAllowedFormats(kFormats), Eq(kFormats));
+  EXPECT_THAT(feedback.max_bitrate(), Eq(0));
+}
+
+TEST(RenderFeedbackTest, ViewportAllowsSmallestThatFills) {
+  RenderFeedback feedback;
+
+  feedback.SetViewportSize(1000, 500);
+  EXPECT_THAT(feedback.GetAllowedFormats(kFormats),
+              ElementsAre(kFormats[1], kFormats[2]));
+
+  // Nothing fills it, so nothing is too large.
+  feedback.SetViewportSize(3840, 2160);
+  EXPECT_THAT(feedback.GetAllowedFormats(kFormats), Eq(kFormats));
+}
+
+TEST(RenderFeedbackTest, DropsCountedOverWholePeriods) {
+  RenderFeedback feedback;
+
+  // Well over the threshold, but not yet a whole period.
+  feedback.ReportFrames(50, 50, 5000);
+  EXPECT_THAT(feedback.max_bitrate(), Eq(0));
+
+  // 50 of 120 frames dropped.
+  feedback.ReportFrames(20, 0, 5000);
+  EXPECT_THAT(feedback.max_bitrate(), Eq(4999));
+  EXPECT_THAT(feedback.GetAllowedFormats(kFormats),
+              ElementsAre(kFormats[1], kFormats[2]));
+
+  // A bad period resets the count towards stepping up.
+  for (int i = 0; i < RenderFeedback::kReportPeriodsToStepUp - 1; i++) {
+    feedback.ReportFrames(120, 0, 3000);
+  }
+  feedback.ReportFrames(112, 8, 3000);
+  feedback.ReportFrames(120, 0, 3000);
+  EXPECT_THAT(feedback.max_bitrate(), Eq(4999));
+
+  for (int i = 0; i < RenderFeedback::kReportPeriodsToStepUp - 1; i++) {
+    feedback.ReportFrames(120, 0, 3000);
+  }
+  EXPECT_THAT(feedback.max_bitrate(), Eq(0));
+}
+
+}  // namespace chunk
+}  // namespace ndash
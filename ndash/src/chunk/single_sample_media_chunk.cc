@@ -21,6 +21,7 @@
 
 #include "base/memory/ref_counted.h"
 #include "base/synchronization/lock.h"
+#include "base/trace_event/trace_event.h"
 #include "drm/drm_init_data.h"
 #include "extractor/track_output.h"
 #include "extractor/unbuffered_extractor_input.h"
@@ -79,6 +80,8 @@ bool SingleSampleMediaChunk::IsLoadCanceled() const {
 }
 
 bool SingleSampleMediaChunk::Load() {
+  TRACE_EVENT2("ndash", "SingleSampleMediaChunk::Load", "uri",
+               data_spec()->uri.uri(), "start_time_us", start_time_us());
   upstream::DataSpec load_data_spec(
       upstream::DataSpec::GetRemainder(*data_spec(), bytes_loaded_));
 
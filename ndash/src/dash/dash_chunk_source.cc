@@ -16,6 +16,7 @@
 
 #include "dash/dash_chunk_source.h"
 
+#include <algorithm>
 #include <map>
 #include <memory>
 #include <set>
@@ -39,6 +40,8 @@
 #include "dash/representation_holder.h"
 #include "drm/drm_init_data.h"
 #include "extractor/chunk_index.h"
+#include "extractor/extractor.h"
+#include "extractor/rawcc_index_extractor.h"
 #include "manifest_fetcher.h"
 #include "media_format.h"
 #include "mpd/adaptation_set.h"
@@ -52,6 +55,7 @@
 #include "time_range.h"
 #include "upstream/data_source.h"
 #include "upstream/data_spec.h"
+#include "upstream/host_stats.h"
 #include "upstream/uri.h"
 #include "util/format.h"
 #include "util/mime_types.h"
@@ -64,6 +68,15 @@ namespace {
 const char kFourccTTML[] = "stpp";
 const char kFourccWebVTT[] = "wvtt";
 
+// Initialization and index data this close together in a file are fetched in
+// one request. Whatever lies between them is parsed and skipped.
+constexpr int32_t kMaxInitializationGapBytes = 4096;
+
+// Limits on fetching several segments of a file in one request, so that a
+// change of format still takes effect reasonably soon.
+constexpr int32_t kMaxCoalescedSegments = 4;
+constexpr int64_t kMaxCoalescedDurationUs = 10000000;
+
 void BehindLiveWindowError(qoe::QoeManager* qoe) {
   // Do nothing.
   LOG(ERROR) << "BehindLiveWindow";
@@ -426,7 +439,8 @@ void DashChunkSource::GetChunkOperation(
     out->SetChunk(nullptr);
     return;
   } else if (out->GetQueueSize() == queue->size() && out_chunk &&
-             *out_chunk->format() == *selected_format) {
+             *out_chunk->format() == *selected_format &&
+             !ShouldMoveChunk(*out_chunk)) {
     // We already have a chunk, and the evaluation hasn't changed either the
     // format or the size of the queue. Leave unchanged.
     return;
@@ -450,37 +464,60 @@ void DashChunkSource::GetChunkOperation(
     media_format.reset(new MediaFormat(*mf));
   }
 
+  scoped_refptr<chunk::ChunkExtractorWrapper> initialization_extractor =
+      representation_holder->extractor_wrapper();
   if (!representation_holder->segment_index()) {
     pending_index_uri = selected_representation->GetIndexUri();
+    if (!pending_index_uri && representation_holder->index_scan_uri()) {
+      // The whole stream is scanned once for the windows to load it in.
+      pending_index_uri = representation_holder->index_scan_uri();
+      initialization_extractor = new chunk::ChunkExtractorWrapper(
+          std::unique_ptr<extractor::ExtractorInterface>(
+              new extractor::RawCCIndexExtractor()));
+    }
   }
 
   if (pending_initialization_uri || pending_index_uri) {
     // We have initialization and/or index requests to make.
     std::unique_ptr<chunk::Chunk> initialization_chunk = NewInitializationChunk(
-        pending_initialization_uri, pending_index_uri, *selected_representation,
-        representation_holder->extractor_wrapper(), data_source_,
-        period_holder->local_index(), evaluation_.trigger_, format_given_cb_);
+        pending_initialization_uri, pending_index_uri, *representation_holder,
+        initialization_extractor,
+        initialization_data_source_ ? initialization_data_source_
+                                    : data_source_,
+        host_stats_, period_holder->local_index(), evaluation_.trigger_, format_given_cb_);
     last_chunk_was_initialization_ = true;
     out->SetChunk(std::move(initialization_chunk));
+
+    if (!pending_index_uri && queue->empty() && !prefetch_cb_.is_null()) {
+      // The segment index came with the manifest, so we already know which
+      // media segment comes next. Only done when starting (or seeking): on a
+      // switch mid-stream there is buffered media to play while the
+      // initialization segment loads, and the evaluation may move on again
+      // before the prefetched segment is wanted.
+      int32_t segment_num =
+          GetNextSegmentNum(*queue, *representation_holder, playback_position,
+                            starting_new_period);
+      std::unique_ptr<mpd::RangedUri> segment_uri = CoalescedSegmentUri(
+          *representation_holder, segment_num,
+          GetSegmentCount(*representation_holder, segment_num, *out));
+      if (segment_uri) {
+        prefetch_cb_.Run(SegmentDataSpec(*segment_uri, *representation_holder,
+                                         host_stats_));
+      }
+    }
     return;
   }
 
   int segment_num =
-      queue->empty()
-          ? representation_holder->GetSegmentNum(playback_position)
-          : starting_new_period
-                ? representation_holder->GetFirstAvailableSegmentNum()
-                : playback_rate_->IsForward()
-                      ? queue->back()->GetNextChunkIndex()
-                      : queue->back()->GetPrevChunkIndex();
-
-  std::unique_ptr<mpd::RangedUri> segment_uri =
-      representation_holder->GetSegmentUri(segment_num);
-
-  std::unique_ptr<chunk::Chunk> next_media_chunk =
-      NewMediaChunk(*period_holder, representation_holder, data_source_,
-                    std::move(media_format), segment_num, evaluation_.trigger_,
-                    format_given_cb_);
+      GetNextSegmentNum(*queue, *representation_holder, playback_position,
+                        starting_new_period);
+  int32_t segment_count =
+      GetSegmentCount(*representation_holder, segment_num, *out);
+
+  std::unique_ptr<chunk::Chunk> next_media_chunk = NewMediaChunk(
+      *period_holder, representation_holder, data_source_, host_stats_,
+      std::move(media_format), segment_num, segment_count,
+      evaluation_.trigger_, format_given_cb_);
   last_chunk_was_initialization_ = false;
   out->SetChunk(std::move(next_media_chunk));
 }
@@ -518,11 +555,15 @@ void DashChunkSource::OnChunkLoadCompleted(chunk::Chunk* chunk) {
       std::unique_ptr<const extractor::ChunkIndex> chunk_index(
           static_cast<const extractor::ChunkIndex*>(seek_map.release()));
 
-      std::unique_ptr<mpd::DashSegmentIndexInterface> segment_index(
-          new DashWrappingSegmentIndex(
-              std::move(chunk_index),
-              initialization_chunk->data_spec()->uri.uri()));
-      representation_holder->GiveSegmentIndex(std::move(segment_index));
+      if (representation_holder->index_scan_uri()) {
+        representation_holder->GiveScannedIndex(std::move(chunk_index));
+      } else {
+        std::unique_ptr<mpd::DashSegmentIndexInterface> segment_index(
+            new DashWrappingSegmentIndex(
+                std::move(chunk_index),
+                initialization_chunk->data_spec()->uri.uri()));
+        representation_holder->GiveSegmentIndex(std::move(segment_index));
+      }
     }
     // The null check avoids overwriting drm_init_data obtained from the
     // manifest with drm_init_data obtained from the stream, as per DASH IF
@@ -560,6 +601,78 @@ void DashChunkSource::Disable(
   track_criteria_ = nullptr;
 }
 
+std::unique_ptr<chunk::MediaChunk> DashChunkSource::GetReplacementChunk(
+    const chunk::MediaChunk& chunk,
+    const util::Format& format) {
+  DCHECK(track_is_enabled_);
+
+  auto find_result = period_holders_.find(chunk.parent_id());
+  if (find_result == period_holders_.end()) {
+    return nullptr;
+  }
+  PeriodHolder* period_holder = find_result->second.get();
+  RepresentationHolder* representation_holder =
+      period_holder->GetRepresentationHolder(format.GetId());
+  if (!representation_holder || !representation_holder->media_format() ||
+      !representation_holder->segment_index()) {
+    return nullptr;
+  }
+
+  // Segments of different representations need not be numbered alike, so
+  // look the segments up by time, and only accept ones that line up exactly.
+  // A chunk made of several segments is replaced by as many, in one request.
+  base::TimeDelta start_time =
+      base::TimeDelta::FromMicroseconds(chunk.start_time_us());
+  int32_t segment_num = representation_holder->GetSegmentNum(start_time);
+  if (representation_holder->GetSegmentStartTime(segment_num) != start_time) {
+    return nullptr;
+  }
+  int32_t segment_count = 1;
+  while (representation_holder->GetSegmentEndTime(segment_num +
+                                                  segment_count - 1)
+             .InMicroseconds() < chunk.end_time_us()) {
+    if (segment_count == chunk.chunk_count() ||
+        representation_holder->IsBeyondLastSegment(segment_num +
+                                                   segment_count)) {
+      return nullptr;
+    }
+    segment_count++;
+  }
+  if (representation_holder->GetSegmentEndTime(segment_num + segment_count -
+                                               1)
+              .InMicroseconds() != chunk.end_time_us() ||
+      !CoalescedSegmentUri(*representation_holder, segment_num,
+                           segment_count)) {
+    return nullptr;
+  }
+
+  std::unique_ptr<const MediaFormat> media_format(
+      new MediaFormat(*representation_holder->media_format()));
+  std::unique_ptr<chunk::Chunk> replacement = NewMediaChunk(
+      *period_holder, representation_holder, data_source_, host_stats_,
+      std::move(media_format), segment_num, segment_count,
+      chunk::Chunk::kTriggerAdaptive, format_given_cb_);
+  return std::unique_ptr<chunk::MediaChunk>(
+      static_cast<chunk::MediaChunk*>(replacement.release()));
+}
+
+std::unique_ptr<chunk::MediaChunk> DashChunkSource::GetRetryChunk(
+    const chunk::MediaChunk& chunk) {
+  DCHECK(track_is_enabled_);
+
+  if (!ShouldMoveChunk(chunk)) {
+    return nullptr;
+  }
+  std::unique_ptr<chunk::MediaChunk> retry =
+      GetReplacementChunk(chunk, *chunk.format());
+  // Don't bounce between hosts that are all failing.
+  if (!retry || host_stats_->IsExcluded(upstream::HostStats::HostOf(
+                    retry->data_spec()->uri.uri()))) {
+    return nullptr;
+  }
+  return retry;
+}
+
 namespace {
 
 class PtrFormatBandwidthComparator {
@@ -702,9 +815,10 @@ bool DashChunkSource::MimeTypeIsRawText(const std::string& mime_type) {
 std::unique_ptr<chunk::Chunk> DashChunkSource::NewInitializationChunk(
     const mpd::RangedUri* initialization_uri,
     const mpd::RangedUri* index_uri,
-    const mpd::Representation& representation,
+    const RepresentationHolder& representation_holder,
     scoped_refptr<chunk::ChunkExtractorWrapper> extractor,
     upstream::DataSourceInterface* data_source,
+    const upstream::HostStats* host_stats,
     int32_t manifest_index,
     chunk::Chunk::TriggerReason trigger,
     chunk::Chunk::FormatGivenCB format_given_cb) {
@@ -712,9 +826,11 @@ std::unique_ptr<chunk::Chunk> DashChunkSource::NewInitializationChunk(
   std::unique_ptr<mpd::RangedUri> merged_uri;
 
   if (initialization_uri) {
-    // It's common for initialization and index data to be stored adjacently.
-    // Attempt to merge the two requests together to request both at once.
-    merged_uri = initialization_uri->AttemptMerge(index_uri);
+    // It's common for initialization and index data to be stored adjacently,
+    // or nearly so. Attempt to merge the two requests together to request
+    // both at once.
+    merged_uri =
+        initialization_uri->AttemptMerge(index_uri, kMaxInitializationGapBytes);
     if (merged_uri) {
       request_uri = merged_uri.get();
     } else {
@@ -724,10 +840,14 @@ std::unique_ptr<chunk::Chunk> DashChunkSource::NewInitializationChunk(
     request_uri = index_uri;
   }
   CHECK(request_uri);
+  const mpd::Representation& representation =
+      *representation_holder.representation();
   // TODO(adewhurst): Avoid useless temporary Uri and DataSpec
   const upstream::DataSpec data_spec(
-      upstream::Uri(request_uri->GetUriString()), request_uri->GetStart(),
-      request_uri->GetLength(), &representation.GetCacheKey());
+      upstream::Uri(
+          representation_holder.GetRequestUrl(*request_uri, host_stats)),
+      request_uri->GetStart(), request_uri->GetLength(),
+      &representation.GetCacheKey());
   std::unique_ptr<chunk::Chunk> new_chunk(new chunk::InitializationChunk(
       data_source, &data_spec, trigger, &representation.GetFormat(), extractor,
       manifest_index));
@@ -735,12 +855,123 @@ std::unique_ptr<chunk::Chunk> DashChunkSource::NewInitializationChunk(
   return new_chunk;
 }
 
+int32_t DashChunkSource::GetNextSegmentNum(
+    const std::deque<std::unique_ptr<chunk::MediaChunk>>& queue,
+    const RepresentationHolder& representation_holder,
+    base::TimeDelta playback_position,
+    bool starting_new_period) const {
+  if (queue.empty()) {
+    return representation_holder.GetSegmentNum(playback_position);
+  }
+  if (starting_new_period) {
+    return representation_holder.GetFirstAvailableSegmentNum();
+  }
+  return playback_rate_->IsForward() ? queue.back()->GetNextChunkIndex()
+                                     : queue.back()->GetPrevChunkIndex();
+}
+
+int32_t DashChunkSource::GetSegmentCount(
+    const RepresentationHolder& representation_holder,
+    int32_t segment_num,
+    const chunk::ChunkOperationHolder& out) const {
+  const util::Format& format =
+      representation_holder.representation()->GetFormat();
+  if (!playback_rate_->IsNormal() || MimeTypeIsRawText(format.GetMimeType())) {
+    return 1;
+  }
+  int64_t max_duration_us =
+      std::min(out.GetLoadAllowanceUs(), kMaxCoalescedDurationUs);
+  int64_t max_bytes = out.GetLoadAllowanceBytes();
+  std::unique_ptr<mpd::RangedUri> uri =
+      representation_holder.GetSegmentUri(segment_num);
+  if (!uri || uri->GetLength() == -1) {
+    return 1;
+  }
+  base::TimeDelta start_time =
+      representation_holder.GetSegmentStartTime(segment_num);
+
+  int32_t segment_count = 1;
+  while (segment_count < kMaxCoalescedSegments &&
+         !representation_holder.IsBeyondLastSegment(segment_num +
+                                                    segment_count)) {
+    int32_t next_segment_num = segment_num + segment_count;
+    base::TimeDelta end_time =
+        representation_holder.GetSegmentEndTime(next_segment_num);
+    if ((end_time - start_time).InMicroseconds() > max_duration_us) {
+      break;
+    }
+    std::unique_ptr<mpd::RangedUri> next_uri =
+        representation_holder.GetSegmentUri(next_segment_num);
+    if (!next_uri || next_uri->GetLength() == -1) {
+      break;
+    }
+    std::unique_ptr<mpd::RangedUri> merged_uri =
+        uri->AttemptMerge(next_uri.get());
+    // Only segments that follow on from one another in the same file.
+    if (!merged_uri || merged_uri->GetStart() != uri->GetStart() ||
+        merged_uri->GetLength() > max_bytes) {
+      break;
+    }
+    uri = std::move(merged_uri);
+    segment_count++;
+  }
+  return segment_count;
+}
+
+// static
+std::unique_ptr<mpd::RangedUri> DashChunkSource::CoalescedSegmentUri(
+    const RepresentationHolder& representation_holder,
+    int32_t segment_num,
+    int32_t segment_count) {
+  std::unique_ptr<mpd::RangedUri> uri =
+      representation_holder.GetSegmentUri(segment_num);
+  for (int32_t i = 1; i < segment_count && uri; i++) {
+    std::unique_ptr<mpd::RangedUri> next_uri =
+        representation_holder.GetSegmentUri(segment_num + i);
+    uri = uri->AttemptMerge(next_uri.get());
+  }
+  return uri;
+}
+
+bool DashChunkSource::ShouldMoveChunk(const chunk::Chunk& chunk) const {
+  if (!host_stats_) {
+    return false;
+  }
+  const std::string& url = chunk.data_spec()->uri.uri();
+  if (!host_stats_->IsExcluded(upstream::HostStats::HostOf(url))) {
+    return false;
+  }
+  auto find_result = period_holders_.find(chunk.parent_id());
+  if (find_result == period_holders_.end()) {
+    return false;
+  }
+  const RepresentationHolder* representation_holder =
+      find_result->second->GetRepresentationHolder(chunk.format()->GetId());
+  return representation_holder &&
+         representation_holder->GetRequestUrl(url, host_stats_) != url;
+}
+
+// static
+upstream::DataSpec DashChunkSource::SegmentDataSpec(
+    const mpd::RangedUri& segment_uri,
+    const RepresentationHolder& representation_holder,
+    const upstream::HostStats* host_stats) {
+  // TODO(adewhurst): Avoid useless temporary Uri and DataSpec
+  return upstream::DataSpec(
+      upstream::Uri(representation_holder.GetRequestUrl(segment_uri,
+                                                        host_stats)),
+      segment_uri.GetStart(), segment_uri.GetLength(),
+      &representation_holder.representation()->GetCacheKey());
+}
+
 std::unique_ptr<chunk::Chunk> DashChunkSource::NewMediaChunk(
     const PeriodHolder& period_holder,
     RepresentationHolder* representation_holder,
     upstream::DataSourceInterface* data_source,
+    const upstream::HostStats* host_stats,
     std::unique_ptr<const MediaFormat> media_format,
     int32_t segment_num,
+    int32_t segment_count,
     chunk::Chunk::TriggerReason trigger,
     chunk::Chunk::FormatGivenCB format_given_cb) {
   const mpd::Representation* representation =
@@ -749,22 +980,22 @@ std::unique_ptr<chunk::Chunk> DashChunkSource::NewMediaChunk(
   base::TimeDelta start_time =
       representation_holder->GetSegmentStartTime(segment_num);
   base::TimeDelta end_time =
-      representation_holder->GetSegmentEndTime(segment_num);
-  std::unique_ptr<mpd::RangedUri> segment_uri =
-      representation_holder->GetSegmentUri(segment_num);
-  // TODO(adewhurst): Avoid useless temporary Uri and DataSpec
-  const upstream::DataSpec data_spec(
-      upstream::Uri(segment_uri->GetUriString()), segment_uri->GetStart(),
-      segment_uri->GetLength(), &representation->GetCacheKey());
+      representation_holder->GetSegmentEndTime(segment_num + segment_count - 1);
+  std::unique_ptr<mpd::RangedUri> segment_uri = CoalescedSegmentUri(
+      *representation_holder, segment_num, segment_count);
+  CHECK(segment_uri);
+  const upstream::DataSpec data_spec =
+      SegmentDataSpec(*segment_uri, *representation_holder, host_stats);
 
   base::TimeDelta sample_offset =
       period_holder.start_time() -
       base::TimeDelta::FromMicroseconds(
           representation->GetPresentationTimeOffsetUs());
 
-  std::unique_ptr<chunk::Chunk> new_chunk;
+  std::unique_ptr<chunk::MediaChunk> new_chunk;
 
   if (MimeTypeIsRawText(format->GetMimeType())) {
+    DCHECK_EQ(1, segment_count);
     new_chunk.reset(new chunk::SingleSampleMediaChunk(
         data_source, &data_spec, chunk::Chunk::kTriggerInitial, format,
         start_time.InMicroseconds(), end_time.InMicroseconds(), segment_num,
@@ -781,9 +1012,10 @@ std::unique_ptr<chunk::Chunk> DashChunkSource::NewMediaChunk(
         period_holder.drm_init_data(), is_media_format_final,
         period_holder.local_index()));
     new_chunk->SetFormatGivenCallback(format_given_cb);
+    new_chunk->set_chunk_count(segment_count);
   }
 
-  return new_chunk;
+  return std::move(new_chunk);
 }
 
 PeriodHolder* DashChunkSource::FindPeriodHolder(base::TimeDelta position) {
@@ -803,8 +1035,8 @@ PeriodHolder* DashChunkSource::FindPeriodHolder(base::TimeDelta position) {
     PeriodHolder* period_holder = ii->second.get();
     const base::TimeDelta* end_time = period_holder->GetAvailableEndTime();
     size_t num_representations = period_holder->num_representation_holders();
-    DCHECK(end_time);
-    if (position < *end_time && num_representations > 0) {
+    // An unbounded index (live SegmentTemplate@duration) has no end.
+    if ((!end_time || position < *end_time) && num_representations > 0) {
       return period_holder;
     }
   }
@@ -832,8 +1064,8 @@ const PeriodHolder* DashChunkSource::FindPeriodHolder(
     const PeriodHolder* period_holder = ii->second.get();
     const base::TimeDelta* end_time = period_holder->GetAvailableEndTime();
     size_t num_representations = period_holder->num_representation_holders();
-    DCHECK(end_time);
-    if (position < *end_time && num_representations > 0) {
+    // An unbounded index (live SegmentTemplate@duration) has no end.
+    if ((!end_time || position < *end_time) && num_representations > 0) {
       return period_holder;
     }
   }
@@ -900,7 +1132,8 @@ void DashChunkSource::ProcessManifest(
             std::forward_as_tuple(next_period_holder_index_),
             std::forward_as_tuple(new PeriodHolder(
                 drm_session_manager_, next_period_holder_index_, *manifest, i,
-                track_criteria_, playback_rate_->rate()))));
+                track_criteria_, playback_rate_->rate(),
+                classify_frames_))));
     next_period_holder_index_++;
   }
 
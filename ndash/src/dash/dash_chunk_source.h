@@ -63,6 +63,8 @@ class QoeManager;
 
 namespace upstream {
 class DataSourceInterface;
+class DataSpec;
+class HostStats;
 }  // namespace upstream
 
 namespace dash {
@@ -85,6 +87,10 @@ class DashChunkSource : public chunk::ChunkSourceInterface {
   // Definition for a callback to be notified of available range changes.
   typedef base::Callback<void(const TimeRangeInterface& available_range)>
       AvailableRangeChangedCB;
+  // Definition for a callback asked to start fetching a request that will
+  // likely follow the chunk being returned.
+  typedef base::Callback<void(const upstream::DataSpec& data_spec)>
+      PrefetchCB;
 
   // Construct a new DashChunkSource.
   //
@@ -167,6 +173,13 @@ class DashChunkSource : public chunk::ChunkSourceInterface {
   void OnChunkLoadError(const chunk::Chunk* chunk,
                         chunk::ChunkLoadErrorReason e) override;
   void Disable(std::deque<std::unique_ptr<chunk::MediaChunk>>* queue) override;
+  std::unique_ptr<chunk::MediaChunk> GetReplacementChunk(
+      const chunk::MediaChunk& chunk,
+      const util::Format& format) override;
+  // Moves |chunk| to another of its representation's base URLs when its host
+  // has failed and one that hasn't is available.
+  std::unique_ptr<chunk::MediaChunk> GetRetryChunk(
+      const chunk::MediaChunk& chunk) override;
 
   std::unique_ptr<TimeRangeInterface> GetAvailableRange() const;
 
@@ -174,6 +187,42 @@ class DashChunkSource : public chunk::ChunkSourceInterface {
     format_given_cb_ = format_given_cb;
   }
 
+  // When set, the media segment that follows an initialization chunk is
+  // passed to |prefetch_cb| as that chunk is returned (if the segment index
+  // is already known and nothing is buffered yet), so the two can be fetched
+  // at the same time.
+  void SetPrefetchCallback(PrefetchCB prefetch_cb) {
+    prefetch_cb_ = prefetch_cb;
+  }
+
+  // Initialization (and index) requests go to |data_source| instead of the
+  // one given at construction, when set. It must outlive this object.
+  void SetInitializationDataSource(upstream::DataSourceInterface* data_source) {
+    initialization_data_source_ = data_source;
+  }
+
+  // When set, requests go to whichever of a representation's base URLs
+  // |host_stats| favours, and a chunk waiting to be retried after a failure
+  // is moved to another base URL if there is one. It must outlive this
+  // object.
+  void SetHostStats(const upstream::HostStats* host_stats) {
+    host_stats_ = host_stats;
+  }
+
+  // Whether the video frames of this track are classified as reference or
+  // non-reference frames (see PeriodHolder). On by default; must be set
+  // before Enable().
+  void SetFrameClassificationEnabled(bool enabled) {
+    classify_frames_ = enabled;
+  }
+
+  mpd::AdaptationType GetAdaptationType() const { return adaptation_type_; }
+
+  // The format most recently selected, or null.
+  const util::Format* GetSelectedFormat() const {
+    return evaluation_.format_.get();
+  }
+
  private:
   friend class DashChunkSourceTest;
 
@@ -215,19 +264,52 @@ class DashChunkSource : public chunk::ChunkSourceInterface {
   static std::unique_ptr<chunk::Chunk> NewInitializationChunk(
       const mpd::RangedUri* initialization_uri,
       const mpd::RangedUri* index_uri,
-      const mpd::Representation& representation,
+      const RepresentationHolder& representation_holder,
       scoped_refptr<chunk::ChunkExtractorWrapper> extractor,
       upstream::DataSourceInterface* data_source,
+      const upstream::HostStats* host_stats,
       int32_t manifest_index,
       chunk::Chunk::TriggerReason trigger,
       chunk::Chunk::FormatGivenCB format_given_cb);
 
+  // Returns the number of the media segment to load after |queue|.
+  int32_t GetNextSegmentNum(
+      const std::deque<std::unique_ptr<chunk::MediaChunk>>& queue,
+      const RepresentationHolder& representation_holder,
+      base::TimeDelta playback_position,
+      bool starting_new_period) const;
+
+  // Returns how many segments, from |segment_num| on, to fetch in one
+  // request: those that follow on from each other in the same file, as far
+  // as the load allowance in |out| goes.
+  int32_t GetSegmentCount(const RepresentationHolder& representation_holder,
+                          int32_t segment_num,
+                          const chunk::ChunkOperationHolder& out) const;
+
+  // Returns the byte range covering |segment_count| segments from
+  // |segment_num| on, or null if they aren't contiguous.
+  static std::unique_ptr<mpd::RangedUri> CoalescedSegmentUri(
+      const RepresentationHolder& representation_holder,
+      int32_t segment_num,
+      int32_t segment_count);
+
+  // Whether |chunk| is to be fetched from a host that failed recently while
+  // its representation offers another.
+  bool ShouldMoveChunk(const chunk::Chunk& chunk) const;
+
+  static upstream::DataSpec SegmentDataSpec(
+      const mpd::RangedUri& segment_uri,
+      const RepresentationHolder& representation_holder,
+      const upstream::HostStats* host_stats);
+
   static std::unique_ptr<chunk::Chunk> NewMediaChunk(
       const PeriodHolder& period_holder,
       RepresentationHolder* representation_holder,
       upstream::DataSourceInterface* data_source,
+      const upstream::HostStats* host_stats,
       std::unique_ptr<const MediaFormat> media_format,
       int32_t segment_num,
+      int32_t segment_count,
       chunk::Chunk::TriggerReason trigger,
       chunk::Chunk::FormatGivenCB format_given_cb);
 
@@ -260,8 +342,12 @@ class DashChunkSource : public chunk::ChunkSourceInterface {
 
   AvailableRangeChangedCB range_changed_cb_;
   chunk::Chunk::FormatGivenCB format_given_cb_;
+  PrefetchCB prefetch_cb_;
 
   upstream::DataSourceInterface* data_source_;
+  upstream::DataSourceInterface* initialization_data_source_ = nullptr;
+  const upstream::HostStats* host_stats_ = nullptr;
+  bool classify_frames_ = true;
   chunk::FormatEvaluatorInterface* adaptive_format_evaluator_;
 
   chunk::FormatEvaluation evaluation_;
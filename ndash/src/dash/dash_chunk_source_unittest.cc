@@ -15,6 +15,7 @@
  */
 
 #include "dash/dash_chunk_source.h"
+#include "base/bind.h"
 #include "base/memory/ref_counted.h"
 #include "chunk/fixed_evaluator.h"
 #include "chunk/initialization_chunk.h"
@@ -33,6 +34,7 @@
 #include "playback_rate.h"
 #include "time_range.h"
 #include "track_criteria.h"
+#include "upstream/data_spec.h"
 #include "util/util.h"
 
 namespace ndash {
@@ -41,6 +43,12 @@ namespace dash {
 using ::testing::Eq;
 using ::testing::Invoke;
 using ::testing::NotNull;
+using ::testing::StartsWith;
+
+static void RecordPrefetch(std::vector<std::string>* uris,
+                           const upstream::DataSpec& data_spec) {
+  uris->push_back(data_spec.uri.uri());
+}
 
 class DashChunkSourceTest : public ::testing::Test {
  public:
@@ -249,10 +257,10 @@ class DashChunkSourceTest : public ::testing::Test {
       drm::DrmSessionManagerInterface* drm_session_manager,
       mpd::MediaPresentationDescription* mpd,
       chunk::FixedEvaluator* evaluator,
-      PlaybackRate rate) {
+      const PlaybackRate* rate) {
     std::unique_ptr<DashChunkSource> chunk_source(
         new DashChunkSource(drm_session_manager, mpd, nullptr, evaluator,
-                            mpd::AdaptationType::VIDEO, &rate));
+                            mpd::AdaptationType::VIDEO, rate));
     return chunk_source;
   }
 };
@@ -266,7 +274,8 @@ TEST_F(DashChunkSourceTest, GetAvailableRangeOnVod) {
   chunk::FixedEvaluator evaluator;
   PlaybackRate rate;
   std::unique_ptr<DashChunkSource> chunk_source =
-      CreateChunkSource(&drm_session_manager_mock, mpd.get(), &evaluator, rate);
+      CreateChunkSource(&drm_session_manager_mock, mpd.get(), &evaluator,
+                        &rate);
 
   EXPECT_THAT(chunk_source->Prepare(), Eq(true));
   TrackCriteria criteria("video/*");
@@ -287,7 +296,8 @@ TEST_F(DashChunkSourceTest, GetAdjustedSeek) {
   chunk::FixedEvaluator evaluator;
   PlaybackRate rate;
   std::unique_ptr<DashChunkSource> chunk_source =
-      CreateChunkSource(&drm_session_manager_mock, mpd.get(), &evaluator, rate);
+      CreateChunkSource(&drm_session_manager_mock, mpd.get(), &evaluator,
+                        &rate);
 
   EXPECT_THAT(chunk_source->Prepare(), Eq(true));
   TrackCriteria criteria("video/*");
@@ -378,6 +388,161 @@ TEST_F(DashChunkSourceTest, GetChunkOperationMultiPeriodNoRepsAllPeriods) {
   EXPECT_THAT(log, Eq(""));
 }
 
+TEST_F(DashChunkSourceTest, PrefetchesMediaSegmentAfterInitialization) {
+  std::unique_ptr<std::string> base_uri(new std::string("http://a/"));
+  std::unique_ptr<mpd::RangedUri> initialization(
+      new mpd::RangedUri(base_uri.get(), "init.mp4", 0, -1));
+  std::unique_ptr<std::vector<mpd::SegmentTimelineElement>> segment_timeline(
+      new std::vector<mpd::SegmentTimelineElement>());
+  std::unique_ptr<std::vector<mpd::RangedUri>> media_segments(
+      new std::vector<mpd::RangedUri>());
+  for (int i = 0; i < 3; i++) {
+    segment_timeline->emplace_back(i * 10000, 10000);
+    media_segments->emplace_back(base_uri.get(),
+                                 "seg" + std::to_string(i) + ".m4s", 0, -1);
+  }
+  std::unique_ptr<mpd::MultiSegmentBase> segment_base(new mpd::SegmentList(
+      std::move(base_uri), std::move(initialization), 1000, 0, 0, 0,
+      std::move(segment_timeline), std::move(media_segments)));
+  std::vector<std::unique_ptr<mpd::Representation>> representations;
+  representations.emplace_back(mpd::Representation::NewInstance(
+      "", 0, kRegularVideo, std::move(segment_base)));
+  std::vector<std::unique_ptr<mpd::AdaptationSet>> adaptation_sets;
+  adaptation_sets.emplace_back(new mpd::AdaptationSet(
+      0, mpd::AdaptationType::VIDEO, &representations));
+  std::vector<std::unique_ptr<mpd::Period>> periods;
+  periods.emplace_back(new mpd::Period("period", 0, &adaptation_sets));
+  scoped_refptr<mpd::MediaPresentationDescription> mpd(
+      new mpd::MediaPresentationDescription(
+          kAvailabilityStartTimeMs, kVodDurationMs, -1, false, -1, -1,
+          std::unique_ptr<mpd::DescriptorType>(), "", &periods));
+
+  drm::MockDrmSessionManager drm_session_manager_mock;
+  chunk::FixedEvaluator evaluator;
+  PlaybackRate rate;
+  std::unique_ptr<DashChunkSource> chunk_source =
+      CreateChunkSource(&drm_session_manager_mock, mpd.get(), &evaluator,
+                        &rate);
+  std::vector<std::string> prefetched;
+  chunk_source->SetPrefetchCallback(base::Bind(&RecordPrefetch, &prefetched));
+  EXPECT_THAT(chunk_source->Prepare(), Eq(true));
+  TrackCriteria criteria("video/*");
+  chunk_source->Enable(&criteria);
+
+  // The segment for the playback position is suggested along with the
+  // initialization chunk, and is the one requested next.
+  EXPECT_THAT(ConsumeChunks(chunk_source.get()),
+              StartsWith("ihttp://a/init.mp4,mhttp://a/seg0.m4s,"));
+  EXPECT_THAT(prefetched, Eq(std::vector<std::string>{"http://a/seg0.m4s"}));
+}
+
+TEST_F(DashChunkSourceTest, CoalescesContiguousSegments) {
+  // One file holding 15 segments of 2s and 1000 bytes each, one after the
+  // other.
+  std::unique_ptr<std::string> base_uri(new std::string("http://a/v.mp4"));
+  std::unique_ptr<mpd::RangedUri> initialization(
+      new mpd::RangedUri(base_uri.get(), "", 0, 500));
+  std::unique_ptr<std::vector<mpd::SegmentTimelineElement>> segment_timeline(
+      new std::vector<mpd::SegmentTimelineElement>());
+  std::unique_ptr<std::vector<mpd::RangedUri>> media_segments(
+      new std::vector<mpd::RangedUri>());
+  for (int i = 0; i < 15; i++) {
+    segment_timeline->emplace_back(i * 2000, 2000);
+    media_segments->emplace_back(base_uri.get(), "", 500 + i * 1000, 1000);
+  }
+  std::unique_ptr<mpd::MultiSegmentBase> segment_base(new mpd::SegmentList(
+      std::move(base_uri), std::move(initialization), 1000, 0, 0, 0,
+      std::move(segment_timeline), std::move(media_segments)));
+  std::vector<std::unique_ptr<mpd::Representation>> representations;
+  representations.emplace_back(mpd::Representation::NewInstance(
+      "", 0, kRegularVideo, std::move(segment_base)));
+  std::vector<std::unique_ptr<mpd::AdaptationSet>> adaptation_sets;
+  adaptation_sets.emplace_back(new mpd::AdaptationSet(
+      0, mpd::AdaptationType::VIDEO, &representations));
+  std::vector<std::unique_ptr<mpd::Period>> periods;
+  periods.emplace_back(new mpd::Period("period", 0, &adaptation_sets));
+  scoped_refptr<mpd::MediaPresentationDescription> mpd(
+      new mpd::MediaPresentationDescription(
+          kAvailabilityStartTimeMs, kVodDurationMs, -1, false, -1, -1,
+          std::unique_ptr<mpd::DescriptorType>(), "", &periods));
+
+  drm::MockDrmSessionManager drm_session_manager_mock;
+  chunk::FixedEvaluator evaluator;
+  PlaybackRate rate;
+  std::unique_ptr<DashChunkSource> chunk_source = CreateChunkSource(
+      &drm_session_manager_mock, mpd.get(), &evaluator, &rate);
+  EXPECT_THAT(chunk_source->Prepare(), Eq(true));
+  TrackCriteria criteria("video/*");
+  chunk_source->Enable(&criteria);
+
+  std::deque<std::unique_ptr<chunk::MediaChunk>> queue;
+  chunk::ChunkOperationHolder out;
+  out.SetQueueSize(0);
+  chunk_source->GetChunkOperation(&queue, base::TimeDelta(), &out);
+  ASSERT_THAT(out.GetChunk(), NotNull());
+  ASSERT_THAT(out.GetChunk()->type(),
+              Eq(chunk::Chunk::kTypeMediaInitialization));
+  static_cast<chunk::InitializationChunk*>(out.GetChunk())
+      ->GiveFormat(MediaFormat::CreateVideoFormat(
+          "1", kRegularVideo.GetMimeType(), kRegularVideo.GetCodecs(),
+          kRegularVideo.GetBitrate(), 0, 33, kRegularVideo.GetWidth(),
+          kRegularVideo.GetHeight(), std::unique_ptr<char[]>(nullptr), 0, 0,
+          0));
+  chunk_source->OnChunkLoadCompleted(out.GetChunk());
+  out.SetChunk(nullptr);
+
+  // Queues the next media chunk, given how much more there is room for.
+  auto next_chunk = [&](int64_t allowance_us, int64_t allowance_bytes) {
+    out.SetQueueSize(queue.size());
+    out.SetLoadAllowance(allowance_us, allowance_bytes);
+    chunk_source->GetChunkOperation(&queue, base::TimeDelta(), &out);
+    std::unique_ptr<chunk::Chunk> chunk = out.TakeChunk();
+    out.SetChunk(nullptr);
+    EXPECT_THAT(chunk, NotNull());
+    EXPECT_THAT(chunk->type(), Eq(chunk::Chunk::kTypeMedia));
+    queue.emplace_back(static_cast<chunk::MediaChunk*>(chunk.release()));
+    return queue.back().get();
+  };
+
+  // Without an allowance, one segment at a time.
+  chunk::MediaChunk* media_chunk = next_chunk(0, 0);
+  EXPECT_THAT(media_chunk->chunk_count(), Eq(1));
+  EXPECT_THAT(media_chunk->data_spec()->position, Eq(500));
+  EXPECT_THAT(media_chunk->data_spec()->length, Eq(1000));
+
+  // As many segments as fit in the bytes allowed...
+  media_chunk = next_chunk(util::kMicrosPerSecond * 100, 2500);
+  EXPECT_THAT(media_chunk->chunk_index(), Eq(1));
+  EXPECT_THAT(media_chunk->chunk_count(), Eq(2));
+  EXPECT_THAT(media_chunk->start_time_us(), Eq(util::kMicrosPerSecond * 2));
+  EXPECT_THAT(media_chunk->end_time_us(), Eq(util::kMicrosPerSecond * 6));
+  EXPECT_THAT(media_chunk->data_spec()->position, Eq(1500));
+  EXPECT_THAT(media_chunk->data_spec()->length, Eq(2000));
+
+  // ... or the time allowed...
+  media_chunk = next_chunk(util::kMicrosPerSecond * 5, 1000000);
+  EXPECT_THAT(media_chunk->chunk_index(), Eq(3));
+  EXPECT_THAT(media_chunk->chunk_count(), Eq(2));
+
+  // ... up to a limit.
+  media_chunk = next_chunk(util::kMicrosPerSecond * 100, 1000000);
+  EXPECT_THAT(media_chunk->chunk_index(), Eq(5));
+  EXPECT_THAT(media_chunk->chunk_count(), Eq(4));
+  EXPECT_THAT(media_chunk->end_time_us(), Eq(util::kMicrosPerSecond * 18));
+  EXPECT_THAT(media_chunk->data_spec()->position, Eq(5500));
+  EXPECT_THAT(media_chunk->data_spec()->length, Eq(4000));
+
+  // The queue carries on after the last segment of a coalesced chunk.
+  media_chunk = next_chunk(0, 0);
+  EXPECT_THAT(media_chunk->chunk_index(), Eq(9));
+
+  // Never while playing backwards.
+  rate.set_rate(-2);
+  media_chunk = next_chunk(util::kMicrosPerSecond * 100, 1000000);
+  EXPECT_THAT(media_chunk->chunk_index(), Eq(8));
+  EXPECT_THAT(media_chunk->chunk_count(), Eq(1));
+}
+
 // TODO(adewhurst): Port the other ExoPlayer DashChunkSource unit tests
 
 }  // namespace dash
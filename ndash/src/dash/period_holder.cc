@@ -138,7 +138,8 @@ PeriodHolder::PeriodHolder(drm::DrmSessionManagerInterface* drm_session_manager,
                            const mpd::MediaPresentationDescription& manifest,
                            int32_t manifest_index,
                            const TrackCriteria* track_criteria,
-                           float playback_rate)
+                           float playback_rate,
+                           bool classify_frames)
     : local_index_(local_index),
       start_time_(base::TimeDelta::FromMilliseconds(
           manifest.GetPeriod(manifest_index)->GetStartMs())),
@@ -168,6 +169,9 @@ PeriodHolder::PeriodHolder(drm::DrmSessionManagerInterface* drm_session_manager,
         adaptation_set->GetRepresentation(index);
 
     scoped_refptr<chunk::ChunkExtractorWrapper> chunk_extractor;
+    bool windowed = false;
+    base::TimeDelta window_start;
+    base::TimeDelta window_end;
     if (adaptation_set->GetType() == mpd::AdaptationType::AUDIO ||
         adaptation_set->GetType() == mpd::AdaptationType::VIDEO) {
       std::set<int> audio_object_types;
@@ -177,8 +181,9 @@ PeriodHolder::PeriodHolder(drm::DrmSessionManagerInterface* drm_session_manager,
         audio_object_types.insert(media::mp4::kEAC3);
       }
 
-      std::unique_ptr<media::StreamParser> stream_parser(
+      std::unique_ptr<media::mp4::MP4StreamParser> stream_parser(
           new media::mp4::MP4StreamParser(audio_object_types, false));
+      stream_parser->set_classify_dependencies(classify_frames);
       scoped_refptr<media::MediaLog> media_log(new media::MediaLog());
       std::unique_ptr<extractor::ExtractorInterface> extractor(
           new extractor::StreamParserExtractor(drm_session_manager_,
@@ -212,6 +217,10 @@ PeriodHolder::PeriodHolder(drm::DrmSessionManagerInterface* drm_session_manager,
       // single segment representations. Therefore, Sudu LIVE or DVR streams
       // for which rawcc is properly chunked will operate normally and will be
       // unaffected.
+      //
+      // Such a stream is also loaded in windows around the playback position
+      // rather than all at once, using an index of the windows found by
+      // scanning it once (see RepresentationHolder::LoadInWindows()).
 
       std::unique_ptr<base::TimeDelta> trunc_start;
       std::unique_ptr<base::TimeDelta> trunc_end;
@@ -224,6 +233,9 @@ PeriodHolder::PeriodHolder(drm::DrmSessionManagerInterface* drm_session_manager,
             segment_base->GetPresentationTimeOffsetUs())));
         trunc_end.reset(new base::TimeDelta(*trunc_start + period_duration));
 
+        window_start = *trunc_start;
+        window_end = *trunc_end;
+        windowed = true;
         VLOG(2) << "Truncating single-file un-indexed rawcc stream to between "
                 << trunc_start->InSeconds() << " and "
                 << trunc_end->InSeconds();
@@ -238,14 +250,20 @@ PeriodHolder::PeriodHolder(drm::DrmSessionManagerInterface* drm_session_manager,
                              representation->GetPresentationTimeOffsetUs());
 
       std::unique_ptr<extractor::ExtractorInterface> extractor(
-          new extractor::RawCCParserExtractor(
-              sample_offset, std::move(trunc_start), std::move(trunc_end)));
+          new extractor::RawCCParserExtractor(sample_offset,
+                                              std::move(trunc_start),
+                                              std::move(trunc_end), windowed));
       chunk_extractor = new chunk::ChunkExtractorWrapper(std::move(extractor));
     }
-    representation_holders_.insert(std::make_pair(
-        representation->GetFormat().GetId(),
-        std::unique_ptr<RepresentationHolder>(new RepresentationHolder(
-            start_time_, period_duration, representation, chunk_extractor))));
+    std::unique_ptr<RepresentationHolder> representation_holder(
+        new RepresentationHolder(start_time_, period_duration, representation,
+                                 chunk_extractor));
+    if (windowed) {
+      representation_holder->LoadInWindows(window_start, window_end);
+    }
+    representation_holders_.insert(
+        std::make_pair(representation->GetFormat().GetId(),
+                       std::move(representation_holder)));
   }
   UpdateRepresentationIndependentProperties(
       period_duration,
@@ -395,9 +413,39 @@ base::TimeDelta PeriodHolder::GetPeriodDuration(
 // This logic involves filtering/sorting through adaptation sets within a
 // period. Currently, this is only called once for 'static' manifests and
 // on each manifest refresh for 'dynamic' manifests.
+// static
+std::vector<const mpd::AdaptationSet*> PeriodHolder::GetAdaptationSets(
+    const mpd::Period& period,
+    const std::string& mime_type) {
+  std::vector<const mpd::AdaptationSet*> sets;
+  int num_adaptation_sets = period.GetAdaptationSetCount();
+  for (int i = 0; i < num_adaptation_sets; i++) {
+    const mpd::AdaptationSet* adaptation_set = period.GetAdaptationSet(i);
+    if (adaptation_set->NumRepresentations() > 0 && !IsTrick(adaptation_set)) {
+      const std::string& rep_mime_type =
+          adaptation_set->GetRepresentation(0)->GetFormat().GetMimeType();
+      if (base::MatchPattern(rep_mime_type, mime_type)) {
+        sets.push_back(adaptation_set);
+      }
+    }
+  }
+  return sets;
+}
+
 const mpd::AdaptationSet* PeriodHolder::SelectAdaptationSet(
     const mpd::Period& period,
     const TrackCriteria* track_criteria) {
+  // A stream picked by number overrides the preferences.
+  if (track_criteria->adaptation_set_index >= 0 &&
+      !track_criteria->prefer_trick) {
+    std::vector<const mpd::AdaptationSet*> sets =
+        GetAdaptationSets(period, track_criteria->mime_type);
+    if (static_cast<size_t>(track_criteria->adaptation_set_index) <
+        sets.size()) {
+      return sets[track_criteria->adaptation_set_index];
+    }
+  }
+
   std::vector<const mpd::AdaptationSet*> all;
   int num_adaptation_sets = period.GetAdaptationSetCount();
   for (int i = 0; i < num_adaptation_sets; i++) {
@@ -57,12 +57,15 @@ class PeriodHolder {
   typedef util::ConstUniquePtrMapValueRange<RepresentationHolderMap>
       RepresentationHolderConstRange;
 
+  // |classify_frames| is passed to the MP4 parsers (see
+  // media::mp4::MP4StreamParser::set_classify_dependencies()).
   PeriodHolder(drm::DrmSessionManagerInterface* drm_session_manager,
                int32_t local_index,
                const mpd::MediaPresentationDescription& manifest,
                int32_t manifest_index,
                const TrackCriteria* track_criteria,
-               float playback_rate = 1);
+               float playback_rate = 1,
+               bool classify_frames = true);
   ~PeriodHolder();
 
   int32_t local_index() const { return local_index_; }
@@ -123,6 +126,19 @@ class PeriodHolder {
                     int32_t manifest_index,
                     const TrackCriteria* track_criteria);
 
+  // Returns the adaptation sets in |period| whose representations have a
+  // mime type matching |mime_type|, other than trick play ones, in manifest
+  // order. A stream's number is its position in this list.
+  static std::vector<const mpd::AdaptationSet*> GetAdaptationSets(
+      const mpd::Period& period,
+      const std::string& mime_type);
+
+  // Apply track_criteria to the adapatation sets found in |period| and
+  // select one.
+  static const mpd::AdaptationSet* SelectAdaptationSet(
+      const mpd::Period& period,
+      const TrackCriteria* track_criteria);
+
   // For when any representation will do. This pointer is only valid for the
   // current DashThread task.  It is not safe to store it since DashThread
   // update may cause it to become invalid before the next tasks's execution.
@@ -153,12 +169,6 @@ class PeriodHolder {
       base::TimeDelta period_duration,
       const mpd::DashSegmentIndexInterface* segment_index);
 
-  // Apply track_criteria to the adapatation sets found in |period| and
-  // select one.
-  static const mpd::AdaptationSet* SelectAdaptationSet(
-      const mpd::Period& period,
-      const TrackCriteria* track_criteria);
-
   static bool GetRepresentationIndex(const mpd::AdaptationSet& adaptation_set,
                                      const std::string& format_id,
                                      int32_t* found_index);
@@ -181,5 +181,40 @@ TEST(PeriodHolderTest, CriteriaByConstructorCodecPref) {
   ASSERT_TRUE(period_holder.GetRepresentationHolder("150") == nullptr);
 }
 
+TEST(PeriodHolderTest, GetAdaptationSets) {
+  scoped_refptr<mpd::MediaPresentationDescription> manifest =
+      ManifestFromFile("mpd/data/trick.xml");
+  ASSERT_TRUE(manifest.get() != nullptr);
+  const mpd::Period& period = *manifest->GetPeriod(0);
+
+  EXPECT_EQ(2u, PeriodHolder::GetAdaptationSets(period, "audio/*").size());
+  // Trick play sets are not counted.
+  EXPECT_EQ(1u, PeriodHolder::GetAdaptationSets(period, "video/*").size());
+  EXPECT_EQ(4u, PeriodHolder::GetAdaptationSets(period, "text/*").size());
+  EXPECT_EQ(0u, PeriodHolder::GetAdaptationSets(period, "image/*").size());
+}
+
+TEST(PeriodHolderTest, CriteriaByConstructorAdaptationSetIndex) {
+  scoped_refptr<mpd::MediaPresentationDescription> manifest =
+      ManifestFromFile("mpd/data/trick.xml");
+  ASSERT_TRUE(manifest.get() != nullptr);
+
+  drm::MockDrmSessionManager drm_session_manager;
+  // The second audio set, despite preferring the codec of the first.
+  TrackCriteria track_criteria("audio/*", false /* trick */, "", 0,
+                               "mp4a.40.2");
+  track_criteria.adaptation_set_index = 1;
+  PeriodHolder period_holder(&drm_session_manager, 0, *manifest, 0,
+                             &track_criteria);
+  ASSERT_TRUE(period_holder.GetRepresentationHolder("259") != nullptr);
+  ASSERT_TRUE(period_holder.GetRepresentationHolder("149") == nullptr);
+
+  // Out of range falls back on the preferences.
+  track_criteria.adaptation_set_index = 2;
+  PeriodHolder fallback_holder(&drm_session_manager, 0, *manifest, 0,
+                               &track_criteria);
+  ASSERT_TRUE(fallback_holder.GetRepresentationHolder("149") != nullptr);
+}
+
 }  // namespace dash
 }  // namespace ndash
@@ -16,14 +16,71 @@
 
 #include "dash/representation_holder.h"
 
+#include <set>
+#include <vector>
+
 #include "chunk/chunk_extractor_wrapper.h"
+#include "dash/dash_wrapping_segment_index.h"
+#include "extractor/chunk_index.h"
+#include "extractor/rawcc_index_extractor.h"
 #include "media_format.h"
+#include "mpd/base_url.h"
 #include "mpd/dash_segment_index.h"
+#include "mpd/ranged_uri.h"
 #include "mpd/representation.h"
+#include "upstream/host_stats.h"
+#include "util/uri_util.h"
 
 namespace ndash {
 namespace dash {
 
+namespace {
+bool IsBaseOf(const std::string& base_url, const std::string& url) {
+  if (url == base_url) {
+    return true;
+  }
+  return !base_url.empty() && base_url.back() == '/' &&
+         url.compare(0, base_url.size(), base_url) == 0;
+}
+
+// Returns null if every base URL's service location has failed recently.
+const mpd::BaseUrl* ChooseBaseUrl(const std::vector<mpd::BaseUrl>& base_urls,
+                                  const upstream::HostStats& host_stats) {
+  std::set<std::string> failed_locations;
+  for (const mpd::BaseUrl& base_url : base_urls) {
+    if (host_stats.IsExcluded(upstream::HostStats::HostOf(base_url.url))) {
+      failed_locations.insert(base_url.service_location);
+    }
+  }
+
+  const mpd::BaseUrl* best = nullptr;
+  int64_t best_throughput = upstream::HostStats::kNoEstimate;
+  for (const mpd::BaseUrl& base_url : base_urls) {
+    if (failed_locations.count(base_url.service_location)) {
+      continue;
+    }
+    int64_t throughput =
+        host_stats.GetThroughput(upstream::HostStats::HostOf(base_url.url));
+    bool better;
+    if (!best || base_url.priority != best->priority) {
+      better = !best || base_url.priority < best->priority;
+    } else if (throughput == upstream::HostStats::kNoEstimate) {
+      // Each host gets tried so that it can be compared.
+      better = best_throughput != upstream::HostStats::kNoEstimate ||
+               base_url.weight > best->weight;
+    } else {
+      better = best_throughput != upstream::HostStats::kNoEstimate &&
+               throughput > best_throughput;
+    }
+    if (better) {
+      best = &base_url;
+      best_throughput = throughput;
+    }
+  }
+  return best;
+}
+}  // namespace
+
 RepresentationHolder::RepresentationHolder(
     base::TimeDelta period_start_time,
     base::TimeDelta period_duration,
@@ -47,6 +104,43 @@ void RepresentationHolder::GiveSegmentIndex(
   segment_index_ = owned_segment_index_.get();
 }
 
+void RepresentationHolder::LoadInWindows(base::TimeDelta media_start,
+                                         base::TimeDelta media_end) {
+  DCHECK(segment_index_);
+  windowed_ = true;
+  window_start_ = media_start;
+  window_end_ = media_end;
+
+  std::unique_ptr<mpd::RangedUri> uri =
+      segment_index_->GetSegmentUrl(segment_index_->GetFirstSegmentNum());
+  std::string url = uri->GetUriString();
+  std::unique_ptr<const extractor::ChunkIndex> index =
+      extractor::RawCCIndexCache::GetInstance()->Get(
+          url, window_start_.InMicroseconds(), window_end_.InMicroseconds());
+  if (index) {
+    GiveSegmentIndex(std::unique_ptr<const mpd::DashSegmentIndexInterface>(
+        new DashWrappingSegmentIndex(std::move(index), url)));
+  } else {
+    segment_index_ = nullptr;
+    index_scan_uri_ = std::move(uri);
+  }
+}
+
+void RepresentationHolder::GiveScannedIndex(
+    std::unique_ptr<const extractor::ChunkIndex> index) {
+  DCHECK(index_scan_uri_);
+  std::string url = index_scan_uri_->GetUriString();
+  index_scan_uri_.reset();
+
+  extractor::RawCCIndexCache* cache = extractor::RawCCIndexCache::GetInstance();
+  cache->Put(url, std::move(index));
+  GiveSegmentIndex(std::unique_ptr<const mpd::DashSegmentIndexInterface>(
+      new DashWrappingSegmentIndex(
+          cache->Get(url, window_start_.InMicroseconds(),
+                     window_end_.InMicroseconds()),
+          url)));
+}
+
 bool RepresentationHolder::UpdateRepresentation(
     base::TimeDelta new_period_duration,
     const mpd::Representation* new_representation) {
@@ -57,6 +151,15 @@ bool RepresentationHolder::UpdateRepresentation(
   period_duration_ = new_period_duration;
   representation_ = new_representation;
 
+  if (windowed_) {
+    // The windows are found in the stream, not the manifest.
+    if (index_scan_uri_) {
+      index_scan_uri_ =
+          new_index->GetSegmentUrl(new_index->GetFirstSegmentNum());
+    }
+    return true;
+  }
+
   if (!old_index) {
     // Segment numbers cannot shift if the index isn't defined by the
     // manifest.
@@ -156,5 +259,35 @@ std::unique_ptr<mpd::RangedUri> RepresentationHolder::GetSegmentUri(
   return segment_index_->GetSegmentUrl(segment_num - segment_num_shift_);
 }
 
+std::string RepresentationHolder::GetRequestUrl(
+    const mpd::RangedUri& uri,
+    const upstream::HostStats* host_stats) const {
+  return GetRequestUrl(uri.GetUriString(), host_stats);
+}
+
+std::string RepresentationHolder::GetRequestUrl(
+    const std::string& url,
+    const upstream::HostStats* host_stats) const {
+  const std::vector<mpd::BaseUrl>& base_urls = representation_->GetBaseUrls();
+  if (!host_stats || base_urls.size() < 2) {
+    return url;
+  }
+
+  // The segment base's URLs were resolved against one of the base URLs; find
+  // which, so that the rest of the URL can be moved to another.
+  const mpd::BaseUrl* from = nullptr;
+  for (const mpd::BaseUrl& base_url : base_urls) {
+    if (IsBaseOf(base_url.url, url) &&
+        (!from || base_url.url.size() > from->url.size())) {
+      from = &base_url;
+    }
+  }
+  const mpd::BaseUrl* to = ChooseBaseUrl(base_urls, *host_stats);
+  if (!from || !to || from == to) {
+    return url;
+  }
+  return util::UriUtil::Resolve(to->url, url.substr(from->url.size()));
+}
+
 }  // namespace dash
 }  // namespace ndash
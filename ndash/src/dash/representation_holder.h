@@ -20,6 +20,7 @@
 #include <base/memory/ref_counted.h>
 #include <cstdint>
 #include <memory>
+#include <string>
 
 #include "base/time/time.h"
 
@@ -31,12 +32,20 @@ namespace chunk {
 class ChunkExtractorWrapper;
 }  // namespace chunk
 
+namespace extractor {
+class ChunkIndex;
+}  // namespace extractor
+
 namespace mpd {
 class DashSegmentIndexInterface;
 class RangedUri;
 class Representation;
 }  // namespace mpd
 
+namespace upstream {
+class HostStats;
+}  // namespace upstream
+
 namespace dash {
 
 // Internal to DashChunkSource, holds representations with some extra metadata
@@ -75,6 +84,19 @@ class RepresentationHolder {
   void GiveSegmentIndex(
       std::unique_ptr<const mpd::DashSegmentIndexInterface> segment_index);
 
+  // Loads the representation's single segment, a RAWCC stream, in windows
+  // instead of all at once, taking only those that overlap media times
+  // [|media_start|, |media_end|). Until the stream has been scanned for them
+  // (see index_scan_uri()) there is no segment index.
+  void LoadInWindows(base::TimeDelta media_start, base::TimeDelta media_end);
+
+  // The stream to scan with a RawCCIndexExtractor before any segment can be
+  // loaded, or null.
+  const mpd::RangedUri* index_scan_uri() const { return index_scan_uri_.get(); }
+
+  // Takes the index a RawCCIndexExtractor gave for the whole stream.
+  void GiveScannedIndex(std::unique_ptr<const extractor::ChunkIndex> index);
+
   // Called when the Manifest is updated and the representation pointer needs
   // to be updated.
   // Returns true if successful, false otherwise (BehindLiveWindowException)
@@ -91,6 +113,16 @@ class RepresentationHolder {
   int32_t GetFirstAvailableSegmentNum() const;
   std::unique_ptr<mpd::RangedUri> GetSegmentUri(int segment_num) const;
 
+  // Returns the URL to request |uri| from. When the representation has
+  // several base URLs, this is moved to the one that |host_stats| suggests:
+  // of those whose service location hasn't failed recently, the lowest
+  // priority; and among those, one not yet measured (highest weight first),
+  // or else the fastest.
+  std::string GetRequestUrl(const mpd::RangedUri& uri,
+                            const upstream::HostStats* host_stats) const;
+  std::string GetRequestUrl(const std::string& url,
+                            const upstream::HostStats* host_stats) const;
+
  private:
   const base::TimeDelta period_start_time_;
   base::TimeDelta period_duration_;
@@ -105,6 +137,12 @@ class RepresentationHolder {
   std::unique_ptr<const MediaFormat> media_format_;
   const mpd::DashSegmentIndexInterface* segment_index_;
 
+  // Set by LoadInWindows().
+  bool windowed_ = false;
+  base::TimeDelta window_start_;
+  base::TimeDelta window_end_;
+  std::unique_ptr<mpd::RangedUri> index_scan_uri_;
+
   RepresentationHolder(const RepresentationHolder& other) = delete;
   RepresentationHolder& operator=(const RepresentationHolder& other) = delete;
 };
@@ -17,16 +17,20 @@
 #include <cstdint>
 #include <limits>
 #include <string>
+#include <vector>
 
 #include "base/memory/ptr_util.h"
+#include "base/test/simple_test_tick_clock.h"
 #include "chunk/chunk_extractor_wrapper.h"
 #include "dash/representation_holder.h"
 #include "extractor/extractor.h"
 #include "extractor/extractor_mock.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
+#include "mpd/base_url.h"
 #include "mpd/representation.h"
 #include "mpd/segment_template.h"
+#include "upstream/host_stats.h"
 
 namespace ndash {
 namespace dash {
@@ -194,5 +198,62 @@ TEST(RepresentationHolderTest, SegmentMethods) {
   EXPECT_EQ("http://media/segment/1/1/", rh.GetSegmentUri(1)->GetUriString());
 }
 
+TEST(RepresentationHolderTest, RequestUrlFollowsHostStats) {
+  extractor::MockExtractor* extractor = new extractor::MockExtractor();
+  scoped_refptr<chunk::ChunkExtractorWrapper> chunk_extractor_wrapper(
+      new chunk::ChunkExtractorWrapper(
+          std::unique_ptr<extractor::ExtractorInterface>(extractor)));
+
+  std::unique_ptr<mpd::Representation> representation =
+      CreateTestRepresentation(0);
+  std::vector<mpd::BaseUrl> base_urls;
+  base_urls.emplace_back("http://media/");
+  base_urls.emplace_back("http://mirror/");
+  base_urls.emplace_back("http://backup/");
+  base_urls.back().priority = 2;
+  representation->SetBaseUrls(base_urls);
+
+  RepresentationHolder rh(base::TimeDelta::FromMilliseconds(0),
+                          base::TimeDelta::FromMilliseconds(15000),
+                          representation.get(), chunk_extractor_wrapper);
+  std::unique_ptr<mpd::RangedUri> segment_uri = rh.GetSegmentUri(0);
+  base::SimpleTestTickClock* clock = new base::SimpleTestTickClock;
+  upstream::HostStats host_stats{std::unique_ptr<base::TickClock>(clock)};
+
+  EXPECT_EQ("http://media/segment/1/0/",
+            rh.GetRequestUrl(*segment_uri, nullptr));
+  EXPECT_EQ("http://media/segment/1/0/",
+            rh.GetRequestUrl(*segment_uri, &host_stats));
+
+  // A host not yet measured is tried, then the faster one is used.
+  host_stats.OnTransfer("http://media/segment/1/0/", 1000000,
+                        base::TimeDelta::FromSeconds(1));
+  EXPECT_EQ("http://mirror/segment/1/0/",
+            rh.GetRequestUrl(*segment_uri, &host_stats));
+  host_stats.OnTransfer("http://mirror/segment/1/0/", 500000,
+                        base::TimeDelta::FromSeconds(1));
+  EXPECT_EQ("http://media/segment/1/0/",
+            rh.GetRequestUrl(*segment_uri, &host_stats));
+  EXPECT_EQ("http://media/segment/1/0/",
+            rh.GetRequestUrl("http://mirror/segment/1/0/", &host_stats));
+
+  // Failed hosts are avoided; a lower priority is used only when all of the
+  // higher have failed.
+  host_stats.OnError("http://media/segment/1/0/");
+  EXPECT_EQ("http://mirror/segment/1/0/",
+            rh.GetRequestUrl(*segment_uri, &host_stats));
+  host_stats.OnError("http://mirror/segment/1/0/");
+  EXPECT_EQ("http://backup/segment/1/0/",
+            rh.GetRequestUrl(*segment_uri, &host_stats));
+  host_stats.OnError("http://backup/segment/1/0/");
+  EXPECT_EQ("http://media/segment/1/0/",
+            rh.GetRequestUrl(*segment_uri, &host_stats));
+
+  clock->Advance(
+      base::TimeDelta::FromSeconds(upstream::HostStats::kExclusionSeconds));
+  EXPECT_EQ("http://media/segment/1/0/",
+            rh.GetRequestUrl("http://backup/segment/1/0/", &host_stats));
+}
+
 }  // namespace dash
 }  // namespace ndash
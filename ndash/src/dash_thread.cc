@@ -16,6 +16,7 @@
 
 #include "dash_thread.h"
 
+#include <algorithm>
 #include <cinttypes>
 #include <cstdint>
 #include <cstring>
@@ -26,19 +27,32 @@
 #include "base/logging.h"
 #include "base/memory/ptr_util.h"
 #include "base/single_thread_task_runner.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/string_util.h"
 #include "base/strings/stringprintf.h"
+#include "base/threading/worker_pool.h"
+#include "base/trace_event/trace_event.h"
 #include "chunk/adaptive_evaluator.h"
 #include "chunk/chunk_sample_source.h"
 #include "chunk/demo_evaluator.h"
 #include "dash/dash_chunk_source.h"
+#include "dash/period_holder.h"
+#include "memory_governor.h"
 #include "ndash.h"
 #include "qoe/qoe_manager.h"
 #include "sample_source_track_renderer.h"
 #include "time_range.h"
+#include "tracing.h"
 #include "track_renderer.h"
 #include "upstream/curl_data_source.h"
+#include "upstream/data_spec.h"
 #include "upstream/default_allocator.h"
+#include "upstream/default_uri_data_source.h"
+#include "upstream/host_stats.h"
+#include "upstream/loader_pool.h"
+#include "upstream/prefetching_data_source.h"
 #include "util/mime_types.h"
+#include "util/thread_config.h"
 #include "util/time.h"
 #include "util/uri_util.h"
 #include "util/util.h"
@@ -47,9 +61,16 @@ namespace ndash {
 
 namespace {
 const base::TimeDelta kMaxWaitCodecTime = base::TimeDelta::FromSeconds(6);
+// A bandwidth estimate older than this is not used to start a new session.
+const base::TimeDelta kMaxSessionStateAge = base::TimeDelta::FromMinutes(10);
 const size_t kVideoBufSize = 5242880;  // 5 MB
 const size_t kAudioBufSize = 2097152;  // 2 MB
 const size_t kTextBufSize = 1572864;   // 1.5 MB
+// Alternate audio and text streams only buffer a few seconds.
+const size_t kAlternateAudioBufSize = 262144;  // 256 KB
+const size_t kAlternateTextBufSize = 65536;    // 64 KB
+const char kVideoMimeType[] = "video/*";
+const char kAudioMimeType[] = "audio/*";
 const base::TimeDelta kUpdateScheduleDelay =
     base::TimeDelta::FromMilliseconds(400);
 const base::TimeDelta kTrackSummaryDelay = base::TimeDelta::FromSeconds(5);
@@ -58,6 +79,10 @@ const char kCurlGlobalLock[] = "curl-global-lock";
 const char kNoCurlGlobalLock[] = "no-curl-global-lock";
 const char kAllTracksMetered[] = "all-tracks-metered";
 const char kNoAllTracksMetered[] = "no-all-tracks-metered";
+const char kLoaderPoolThreads[] = "loader-pool-threads";
+const char kNetworkPoolThreads[] = "network-pool-threads";
+// Attributes "thread-<role>" configure this player's threads of each role.
+const char kThreadAttributePrefix[] = "thread-";
 
 void __attribute__((unused))
 AvailableRangeChanged(const char* track,
@@ -68,6 +93,31 @@ AvailableRangeChanged(const char* track,
             << range.first << " - " << range.second << "]";
 }
 
+// Returns a source for media requests whose transfers are counted in
+// |host_stats|. Local files are read directly rather than through curl.
+std::unique_ptr<upstream::DataSourceInterface> NewMediaDataSource(
+    const std::string& content_type,
+    upstream::TransferListenerInterface* listener,
+    bool use_global_lock,
+    scoped_refptr<base::TaskRunner> curl_task_runner,
+    const util::ThreadConfig* thread_config,
+    upstream::HostStats* host_stats,
+    upstream::NetworkTrace* network_trace) {
+  std::unique_ptr<upstream::CurlDataSource> curl_data_source(
+      new upstream::CurlDataSource(
+          content_type, listener, use_global_lock,
+          upstream::CurlDataSource::kDefaultMaxBufLength, curl_task_runner,
+          thread_config));
+  curl_data_source->SetHostStats(host_stats);
+  std::unique_ptr<upstream::HttpDataSourceInterface> data_source(
+      new upstream::DefaultUriDataSource(std::move(curl_data_source),
+                                         listener));
+  if (network_trace) {
+    return network_trace->Wrap(std::move(data_source), listener, host_stats);
+  }
+  return std::move(data_source);
+}
+
 template <typename ReturnType>
 void CallThenSignal(ReturnType* ret,
                     const base::Callback<ReturnType()>& task,
@@ -89,6 +139,36 @@ void APICallAndWait(DashThread* dash,
   done.Wait();
 }
 
+// Returns the process-wide loader pool, sized from the command line if this is
+// the first session to use it.
+upstream::LoaderPool* GetSharedLoaderPool() {
+  const base::CommandLine* command_line =
+      base::CommandLine::ForCurrentProcess();
+
+  size_t loader_threads = upstream::LoaderPool::kDefaultLoaderThreads;
+  size_t network_threads = upstream::LoaderPool::kDefaultNetworkThreads;
+  bool override_threads = false;
+  if (command_line && command_line->HasSwitch(kLoaderPoolThreads)) {
+    override_threads |= base::StringToSizeT(
+        command_line->GetSwitchValueASCII(kLoaderPoolThreads), &loader_threads);
+  }
+  if (command_line && command_line->HasSwitch(kNetworkPoolThreads)) {
+    override_threads |= base::StringToSizeT(
+        command_line->GetSwitchValueASCII(kNetworkPoolThreads),
+        &network_threads);
+  }
+  if (override_threads) {
+    upstream::LoaderPool::SetThreadCounts(loader_threads, network_threads);
+  }
+
+  return upstream::LoaderPool::GetInstance();
+}
+
+void PrefetchSegment(upstream::PrefetchingDataSource* source,
+                     const upstream::DataSpec& data_spec) {
+  source->Prefetch(data_spec);
+}
+
 }  // namespace
 
 DashThread::TrackContext::TrackContext() : sample_holder_(true) {}
@@ -104,9 +184,12 @@ DashThread::DashThread(const std::string& name, void* context)
       media_time_ready_(false),
       decoder_media_time_last_value_ms_(0),
       media_time_last_value_ms_(0),
+      thread_config_(util::ThreadConfig::GetInstance()),
       player_callbacks_({0}),
-      license_fetcher_(
-          base::WrapUnique(new upstream::CurlDataSource("license"))),
+      license_fetcher_(base::WrapUnique(new upstream::CurlDataSource(
+          "license", nullptr, false,
+          upstream::CurlDataSource::kDefaultMaxBufLength, nullptr,
+          &thread_config_))),
       drm_session_manager_(&context_, &player_callbacks_),
       qoe_manager_(nullptr),
       tracks_(),
@@ -121,9 +204,51 @@ DashThread::~DashThread() {
   LOG(INFO) << "~DashThread";
   Unload();
   Stop();
+  if (!player_attributes_.trace_file.empty()) {
+    StopTracing(base::FilePath(player_attributes_.trace_file));
+  }
+}
+
+bool DashThread::StartWithThreadConfig() {
+  return util::ThreadConfig::GetInstance()->StartThread(
+      util::ThreadRole::CONTROL, this, &inherited_thread_options_);
 }
 
 bool DashThread::Load(const char* url, int32_t initial_time_sec) {
+  StartLoad(url, initial_time_sec);
+
+  // Do not let caller proceed until we know both video and audio codecs
+  // for GetVideoCodecSettings and GetAudioCodecSettings functions below.
+  // We do our best to signal this waiter on error conditions that could
+  // prevent it from being signaled. However, to guarantee we return, we give a
+  // a reasonable time before giving up and reporting the load failed.
+  codec_waiter_.TimedWait(kMaxWaitCodecTime);
+
+  if (!HaveCodecs()) {
+    LOG(ERROR) << "Failed to obtain codecs from stream";
+    return false;
+  }
+  return true;
+}
+
+void DashThread::LoadAsync(const char* url,
+                           int32_t initial_time_sec,
+                           DashPlayerLoadedFunc loaded_func) {
+  uint64_t load_generation;
+  {
+    base::AutoLock auto_lock(loaded_func_lock_);
+    loaded_func_ = loaded_func;
+    load_generation = ++load_generation_;
+  }
+  StartLoad(url, initial_time_sec);
+  // The same deadline Load() gives itself.
+  task_runner()->PostDelayedTask(
+      FROM_HERE, base::Bind(&DashThread::LoadTimedOut, base::Unretained(this),
+                            load_generation),
+      kMaxWaitCodecTime);
+}
+
+void DashThread::StartLoad(const char* url, int32_t initial_time_sec) {
   DCHECK(initial_time_sec >= 0);
   LOG(INFO) << "load";
 
@@ -139,19 +264,51 @@ bool DashThread::Load(const char* url, int32_t initial_time_sec) {
   // Post the initial update task to kick things off.
   task_runner()->PostTask(FROM_HERE, base::Bind(&DashThread::Update,
                                                 base::Unretained(this), false));
+}
 
-  // Do not let caller proceed until we know both video and audio codecs
-  // for GetVideoCodecSettings and GetAudioCodecSettings functions below.
-  // We do our best to signal this waiter on error conditions that could
-  // prevent it from being signaled. However, to guarantee we return, we give a
-  // a reasonable time before giving up and reporting the load failed.
-  codec_waiter_.TimedWait(kMaxWaitCodecTime);
+void DashThread::SignalCodecWaiter() {
+  codec_waiter_.Signal();
+  RunLoadedFunc();
+}
 
-  if (!HaveCodecs()) {
-    LOG(ERROR) << "Failed to obtain codecs from stream";
-    return false;
+void DashThread::RunLoadedFunc() {
+  uint64_t load_generation;
+  {
+    base::AutoLock auto_lock(loaded_func_lock_);
+    load_generation = load_generation_;
+  }
+  LoadTimedOut(load_generation);
+}
+
+void DashThread::LoadTimedOut(uint64_t load_generation) {
+  DashPlayerLoadedFunc loaded_func;
+  {
+    base::AutoLock auto_lock(loaded_func_lock_);
+    if (load_generation != load_generation_) {
+      return;
+    }
+    loaded_func = loaded_func_;
+    loaded_func_ = nullptr;
+  }
+  if (loaded_func) {
+    bool loaded = HaveCodecs();
+    LOG_IF(ERROR, !loaded) << "Failed to obtain codecs from stream";
+    loaded_func(context_, loaded ? 0 : -1);
+  }
+}
+
+void DashThread::AbandonLoad() {
+  DashPlayerLoadedFunc loaded_func;
+  {
+    base::AutoLock auto_lock(loaded_func_lock_);
+    loaded_func = loaded_func_;
+    loaded_func_ = nullptr;
+    ++load_generation_;
+  }
+  if (loaded_func) {
+    LOG(INFO) << "Unloaded before the load finished";
+    loaded_func(context_, -1);
   }
-  return true;
 }
 
 void DashThread::Unload() {
@@ -162,9 +319,12 @@ void DashThread::Unload() {
   unload_waiter_.Wait();
 
   tracks_.clear();
+  pending_stream_switches_.clear();
+  session_state_.reset();
   load_control_.reset();
   allocator_.reset();
   manifest_fetcher_.reset();
+  network_trace_.reset();
 }
 
 void DashThread::SetPlayerCallbacks(const DashPlayerCallbacks* callbacks) {
@@ -185,6 +345,132 @@ bool DashThread::SetAttribute(const std::string& attr_name,
     player_attributes_.license_url = attr_value;
     license_fetcher_.UpdateLicenseUri(upstream::Uri(attr_value));
     return true;
+  } else if (base::StartsWith(attr_name, kThreadAttributePrefix,
+                              base::CompareCase::SENSITIVE)) {
+    util::ThreadRole role;
+    if (!thread_config_.Set(attr_name.substr(strlen(kThreadAttributePrefix)),
+                            attr_value, &role)) {
+      return false;
+    }
+    // This player's own threads are running already.
+    if (role == util::ThreadRole::CONTROL) {
+      thread_config_.Apply(role, this, inherited_thread_options_);
+    } else if (role == util::ThreadRole::DRM) {
+      drm_session_manager_.ApplyThreadConfig(&thread_config_);
+    }
+    return true;
+  } else if (attr_name == "license-cache") {
+    if (attr_value == "shared") {
+      return drm_session_manager_.SetSessionCache(
+          drm::CdmSessionCache::GetInstance());
+    } else if (attr_value == "player") {
+      return drm_session_manager_.SetSessionCache(nullptr);
+    }
+    LOG(WARNING) << "Unknown license cache " << attr_value;
+    return false;
+  } else if (attr_name == "executor") {
+    if (attr_value == "shared") {
+      player_attributes_.shared_executor = true;
+      return true;
+    } else if (attr_value == "dedicated") {
+      player_attributes_.shared_executor = false;
+      return true;
+    }
+    LOG(WARNING) << "Unknown executor " << attr_value;
+    return false;
+  } else if (attr_name == "live-target-latency-ms") {
+    int64_t latency_ms;
+    if (!base::StringToInt64(attr_value, &latency_ms) || latency_ms < 0) {
+      LOG(WARNING) << "Bad live target latency " << attr_value;
+      return false;
+    }
+    player_attributes_.live_target_latency =
+        base::TimeDelta::FromMilliseconds(latency_ms);
+    return true;
+  } else if (attr_name == "session-state-dir") {
+    player_attributes_.session_state_dir = attr_value;
+    return true;
+  } else if (attr_name == "quality-upgrade") {
+    if (attr_value == "replace") {
+      player_attributes_.replace_on_upswitch = true;
+      return true;
+    } else if (attr_value == "discard") {
+      player_attributes_.replace_on_upswitch = false;
+      return true;
+    }
+    LOG(WARNING) << "Unknown quality upgrade " << attr_value;
+    return false;
+  } else if (attr_name == "non-reference-drop-rate") {
+    double rate;
+    if (!base::StringToDouble(attr_value, &rate) || rate < 0) {
+      LOG(WARNING) << "Bad non-reference drop rate " << attr_value;
+      return false;
+    }
+    player_attributes_.non_reference_drop_rate = rate;
+    return true;
+  } else if (attr_name == "frame-classification") {
+    if (attr_value == "on") {
+      player_attributes_.classify_frames = true;
+      return true;
+    } else if (attr_value == "off") {
+      player_attributes_.classify_frames = false;
+      return true;
+    }
+    LOG(WARNING) << "Unknown frame classification " << attr_value;
+    return false;
+  } else if (attr_name == "alternate-track-buffer-ms") {
+    int64_t buffer_ms;
+    if (!base::StringToInt64(attr_value, &buffer_ms) || buffer_ms < 0) {
+      LOG(WARNING) << "Bad alternate track buffer " << attr_value;
+      return false;
+    }
+    player_attributes_.alternate_track_buffer =
+        base::TimeDelta::FromMilliseconds(buffer_ms);
+    return true;
+  } else if (attr_name == "memory-priority") {
+    int priority;
+    if (!base::StringToInt(attr_value, &priority) || priority < 1) {
+      LOG(WARNING) << "Bad memory priority " << attr_value;
+      return false;
+    }
+    player_attributes_.memory_priority = priority;
+    return true;
+  } else if (attr_name == "network-record-file") {
+    player_attributes_.network_record_file = attr_value;
+    return true;
+  } else if (attr_name == "network-replay-file") {
+    player_attributes_.network_replay_file = attr_value;
+    return true;
+  } else if (attr_name == "network-replay-pace") {
+    if (attr_value == "recorded") {
+      player_attributes_.network_replay_paced = true;
+      return true;
+    } else if (attr_value == "fast") {
+      player_attributes_.network_replay_paced = false;
+      return true;
+    }
+    LOG(WARNING) << "Unknown network replay pace " << attr_value;
+    return false;
+  } else if (attr_name == "trace-categories") {
+    player_attributes_.trace_categories = attr_value;
+    return true;
+  } else if (attr_name == "trace-file") {
+    if (!attr_value.empty()) {
+      if (!player_attributes_.trace_file.empty() ||
+          !StartTracing(player_attributes_.trace_categories)) {
+        LOG(WARNING) << "Already tracing";
+        return false;
+      }
+      player_attributes_.trace_file = attr_value;
+      return true;
+    }
+    if (player_attributes_.trace_file.empty()) {
+      LOG(WARNING) << "Not tracing";
+      return false;
+    }
+    base::FilePath path(player_attributes_.trace_file);
+    player_attributes_.trace_file.clear();
+    return StopTracing(path);
   }
   LOG(WARNING) << "Unknown attribute " << attr_name;
   return false;
@@ -213,133 +499,292 @@ void DashThread::OnManifestRefreshed() {
   const base::CommandLine* command_line =
       base::CommandLine::ForCurrentProcess();
 
-  bool curl_global_lock = false;
+  TrackSetup setup;
   if (command_line && command_line->HasSwitch(kCurlGlobalLock)) {
-    curl_global_lock = true;
+    setup.curl_global_lock = true;
   } else if (command_line && command_line->HasSwitch(kNoCurlGlobalLock)) {
-    curl_global_lock = false;
+    setup.curl_global_lock = false;
   }
 
-  bool all_tracks_metered = true;
   if (command_line && command_line->HasSwitch(kAllTracksMetered)) {
-    all_tracks_metered = true;
+    setup.all_tracks_metered = true;
   } else if (command_line && command_line->HasSwitch(kNoAllTracksMetered)) {
-    all_tracks_metered = false;
+    setup.all_tracks_metered = false;
   }
 
+  // With a target latency, live streams start that far behind the live edge
+  // (rather than at the start of the time shift window) and are held there.
+  setup.live_edge_latency = base::TimeDelta::FromSeconds(1);
+  live_latency_controller_.reset();
+  has_video_anchor_ = false;
+  if (!player_attributes_.live_target_latency.is_zero() &&
+      manifest_fetcher_->GetManifest()->IsDynamic()) {
+    setup.live_edge_latency = player_attributes_.live_target_latency;
+    setup.start_at_live_edge = true;
+    live_latency_controller_.reset(
+        new LiveLatencyController(player_attributes_.live_target_latency));
+  }
+
+  if (loader_pool_) {
+    setup.curl_task_runner = loader_pool_->network_task_runner();
+  }
+  // Prefetches wait on the network, and loaders wait on prefetches, so they
+  // must not share the loader pool's threads. Nor may their transfers share
+  // the network pool's: they stall until the track's next load reads them,
+  // which may be waiting for a transfer queued behind them. Each prefetching
+  // source gets a CURL thread of its own instead.
+  setup.prefetch_task_runner = base::WorkerPool::GetTaskRunner(true);
+
   // Set up video
   tracks_.emplace_back();
   TrackContext& video_track = tracks_.back();
   video_track.name_ = "video";
   video_track.frame_type_ = DASH_FRAME_TYPE_VIDEO;
-  video_track.data_source_.reset(new upstream::CurlDataSource(
-      "video", media_bandwidth_meter_.get(), curl_global_lock));
-  video_track.format_evaluator_.reset(
-      new chunk::AdaptiveEvaluator(media_bandwidth_meter_.get()));
+  video_track.data_source_ = NewMediaDataSource(
+      "video", media_bandwidth_meter_.get(), setup.curl_global_lock,
+      setup.curl_task_runner, &thread_config_, &host_stats_,
+      network_trace_.get());
+  video_track.prefetching_data_source_.reset(
+      new upstream::PrefetchingDataSource(
+          video_track.data_source_.get(),
+          NewMediaDataSource("video-prefetch", media_bandwidth_meter_.get(),
+                             setup.curl_global_lock, nullptr,
+                             &thread_config_, &host_stats_,
+                             network_trace_.get()),
+          setup.prefetch_task_runner));
+  chunk::AdaptiveEvaluator* video_evaluator =
+      new chunk::AdaptiveEvaluator(media_bandwidth_meter_.get());
+  video_evaluator->SetRenderFeedback(&render_feedback_);
+  video_evaluator->SetHostStats(&host_stats_);
+  video_track.format_evaluator_.reset(video_evaluator);
+  if (session_state_) {
+    video_track.initialization_data_source_.reset(new SessionStateDataSource(
+        video_track.data_source_.get(), session_state_.get()));
+    video_evaluator->SetInitialFormatId(
+        session_state_->GetSelectedFormatId(mpd::AdaptationType::VIDEO));
+  }
 
   // Url goes into dash chunk source here...
   video_track.chunk_source_.reset(new dash::DashChunkSource(
       &drm_session_manager_, manifest_fetcher_.get(),
-      video_track.data_source_.get(), video_track.format_evaluator_.get(),
-      mpd::AdaptationType::VIDEO, base::TimeDelta::FromSeconds(1),
-      base::TimeDelta(), false, base::Bind(AvailableRangeChanged, "video"),
+      video_track.prefetching_data_source_.get(),
+      video_track.format_evaluator_.get(),
+      mpd::AdaptationType::VIDEO, setup.live_edge_latency,
+      base::TimeDelta(), setup.start_at_live_edge,
+      base::Bind(AvailableRangeChanged, "video"),
       &playback_rate_, qoe_manager_.get()));
+  video_track.chunk_source_->SetHostStats(&host_stats_);
+  video_track.chunk_source_->SetFrameClassificationEnabled(
+      player_attributes_.classify_frames);
   video_track.chunk_source_->SetFormatGivenCallback(
       base::Bind(&DashThread::FormatGiven, base::Unretained(this),
                  base::Unretained(&video_track)));
+  video_track.chunk_source_->SetPrefetchCallback(base::Bind(
+      &PrefetchSegment,
+      base::Unretained(video_track.prefetching_data_source_.get())));
+  video_track.chunk_source_->SetInitializationDataSource(
+      video_track.initialization_data_source_.get());
   video_track.sample_source_.reset(new chunk::ChunkSampleSource(
       video_track.chunk_source_.get(), load_control_.get(), &playback_rate_,
-      kVideoBufSize, this));
+      kVideoBufSize, this, 0, chunk::kDefaultMinLoadableRetryCount,
+      CreateLoaderFactory()));
+  video_track.sample_source_->SetQualityUpgradeEnabled(
+      player_attributes_.replace_on_upswitch);
   video_track.renderer_.reset(
       new SampleSourceTrackRenderer(video_track.sample_source_.get()));
-  video_track.track_criteria_.reset(new TrackCriteria("video/*"));
+  video_track.track_criteria_.reset(new TrackCriteria(kVideoMimeType));
+
+  TrackContext* audio_track =
+      AddAudioTrack(setup, TakeInitialStream(DASH_FRAME_TYPE_AUDIO), false);
+  TrackContext* text_track =
+      AddTextTrack(setup, TakeInitialStream(DASH_FRAME_TYPE_CC), false);
+
+  // Keep the other audio and caption streams ready to switch to.
+  const mpd::Period* period = GetCurrentPeriod();
+  if (!player_attributes_.alternate_track_buffer.is_zero() && period) {
+    for (TrackContext* track : {audio_track, text_track}) {
+      int selected = GetStreamNumber(*track, *period);
+      int count = dash::PeriodHolder::GetAdaptationSets(
+                      *period, track->track_criteria_->mime_type)
+                      .size();
+      for (int stream = 0; stream < count; stream++) {
+        if (stream == selected) {
+          continue;
+        }
+        if (track->frame_type_ == DASH_FRAME_TYPE_AUDIO) {
+          AddAudioTrack(setup, stream, true);
+        } else {
+          AddTextTrack(setup, stream, true);
+        }
+      }
+    }
+  }
+
+  // Look up and handshake with each track's segment host while the
+  // renderers are prepared, so that the first segment requests don't wait
+  // for it.
+  if (period && (!network_trace_ || network_trace_->recording())) {
+    for (const auto& track : tracks_) {
+      if (track.standby_) {
+        continue;
+      }
+      const mpd::AdaptationSet* adaptation_set =
+          dash::PeriodHolder::SelectAdaptationSet(*period,
+                                                  track.track_criteria_.get());
+      const mpd::Representation* representation =
+          adaptation_set && adaptation_set->HasRepresentations()
+              ? adaptation_set->GetRepresentation(0)
+              : nullptr;
+      if (representation && !representation->GetBaseUrls().empty()) {
+        upstream::CurlDataSource::Preconnect(
+            representation->GetBaseUrls().front().url, 1);
+      }
+    }
+  }
+
+  for (auto& track : tracks_) {
+    int state = track.renderer_->Prepare(initial_time_.InMicroseconds());
 
-  // Set up audio
+    if (state != TrackRenderer::PREPARED) {
+      LOG(ERROR) << track.name_ << " could not prepare for initial time "
+                 << initial_time_;
+      SetState(STATE_ENDED);
+      return;
+    }
+
+    if (!track.renderer_->Enable(track.track_criteria_.get(),
+                                 initial_time_.InMicroseconds(), false)) {
+      LOG(ERROR) << "Problem enabling " << track.name_ << " renderer";
+      SetState(STATE_ENDED);
+      return;
+    }
+
+    if (!track.renderer_->Start()) {
+      LOG(ERROR) << "Problem starting " << track.name_ << " renderer";
+      SetState(STATE_ENDED);
+      return;
+    }
+  }
+
+  SetState(STATE_BUFFERING);
+  qoe_manager_->ReportBuffering();
+
+  duration_ = base::TimeDelta::FromMilliseconds(
+      manifest_fetcher_->GetManifest()->GetDuration());
+
+  Update(true);
+}
+
+DashThread::TrackContext* DashThread::AddAudioTrack(const TrackSetup& setup,
+                                                   int stream,
+                                                   bool standby) {
   tracks_.emplace_back();
   TrackContext& audio_track = tracks_.back();
   audio_track.name_ = "audio";
   audio_track.frame_type_ = DASH_FRAME_TYPE_AUDIO;
-  audio_track.data_source_.reset(new upstream::CurlDataSource(
-      "audio", all_tracks_metered ? media_bandwidth_meter_.get() : nullptr,
-      curl_global_lock));
+  audio_track.standby_ = standby;
+  upstream::TransferListenerInterface* bandwidth_meter =
+      setup.all_tracks_metered ? media_bandwidth_meter_.get() : nullptr;
+  audio_track.data_source_ = NewMediaDataSource(
+      "audio", bandwidth_meter, setup.curl_global_lock, setup.curl_task_runner,
+      &thread_config_, &host_stats_, network_trace_.get());
+  audio_track.prefetching_data_source_.reset(
+      new upstream::PrefetchingDataSource(
+          audio_track.data_source_.get(),
+          NewMediaDataSource("audio-prefetch", bandwidth_meter,
+                             setup.curl_global_lock, nullptr,
+                             &thread_config_, &host_stats_,
+                             network_trace_.get()),
+          setup.prefetch_task_runner));
   audio_track.format_evaluator_.reset(new chunk::DemoEvaluator());
+  if (session_state_) {
+    audio_track.initialization_data_source_.reset(new SessionStateDataSource(
+        audio_track.data_source_.get(), session_state_.get()));
+  }
 
   // Url goes into dash chunk source here...
   audio_track.chunk_source_.reset(new dash::DashChunkSource(
       &drm_session_manager_, manifest_fetcher_.get(),
-      audio_track.data_source_.get(), audio_track.format_evaluator_.get(),
-      mpd::AdaptationType::AUDIO, base::TimeDelta::FromSeconds(1),
-      base::TimeDelta(), false, base::Bind(AvailableRangeChanged, "audio"),
+      audio_track.prefetching_data_source_.get(),
+      audio_track.format_evaluator_.get(),
+      mpd::AdaptationType::AUDIO, setup.live_edge_latency,
+      base::TimeDelta(), setup.start_at_live_edge,
+      base::Bind(AvailableRangeChanged, "audio"),
       &playback_rate_, qoe_manager_.get()));
+  audio_track.chunk_source_->SetHostStats(&host_stats_);
   audio_track.chunk_source_->SetFormatGivenCallback(
       base::Bind(&DashThread::FormatGiven, base::Unretained(this),
                  base::Unretained(&audio_track)));
+  audio_track.chunk_source_->SetPrefetchCallback(base::Bind(
+      &PrefetchSegment,
+      base::Unretained(audio_track.prefetching_data_source_.get())));
+  audio_track.chunk_source_->SetInitializationDataSource(
+      audio_track.initialization_data_source_.get());
   audio_track.sample_source_.reset(new chunk::ChunkSampleSource(
       audio_track.chunk_source_.get(), load_control_.get(), &playback_rate_,
-      kAudioBufSize, this));
+      standby ? kAlternateAudioBufSize : kAudioBufSize, this, 0,
+      chunk::kDefaultMinLoadableRetryCount, CreateLoaderFactory()));
+  if (standby) {
+    audio_track.sample_source_->SetMaxBufferedDurationUs(
+        player_attributes_.alternate_track_buffer.InMicroseconds());
+  }
   audio_track.renderer_.reset(
       new SampleSourceTrackRenderer(audio_track.sample_source_.get()));
 
-  audio_track.track_criteria_.reset(new TrackCriteria("audio/*"));
+  audio_track.track_criteria_.reset(new TrackCriteria(kAudioMimeType));
+  audio_track.track_criteria_->adaptation_set_index = stream;
 
   // We always prefer e-ac3 for now.
   audio_track.track_criteria_->preferred_codec = kAudioCodecEAC3;
+  return &audio_track;
+}
 
-  // Set up text
+DashThread::TrackContext* DashThread::AddTextTrack(const TrackSetup& setup,
+                                                  int stream,
+                                                  bool standby) {
   tracks_.emplace_back();
   TrackContext& text_track = tracks_.back();
   text_track.name_ = "text";
   text_track.frame_type_ = DASH_FRAME_TYPE_CC;
-  text_track.data_source_.reset(new upstream::CurlDataSource(
-      "text", all_tracks_metered ? media_bandwidth_meter_.get() : nullptr,
-      curl_global_lock));
+  text_track.standby_ = standby;
+  text_track.data_source_ = NewMediaDataSource(
+      "text", setup.all_tracks_metered ? media_bandwidth_meter_.get() : nullptr,
+      setup.curl_global_lock, setup.curl_task_runner, &thread_config_,
+      &host_stats_, network_trace_.get());
   text_track.format_evaluator_.reset(new chunk::DemoEvaluator());
 
   // Url goes into dash chunk source here...
   text_track.chunk_source_.reset(new dash::DashChunkSource(
       &drm_session_manager_, manifest_fetcher_.get(),
       text_track.data_source_.get(), text_track.format_evaluator_.get(),
-      mpd::AdaptationType::TEXT, base::TimeDelta::FromSeconds(1),
-      base::TimeDelta(), false, base::Bind(AvailableRangeChanged, "text"),
+      mpd::AdaptationType::TEXT, setup.live_edge_latency,
+      base::TimeDelta(), setup.start_at_live_edge,
+      base::Bind(AvailableRangeChanged, "text"),
       &playback_rate_, qoe_manager_.get()));
+  text_track.chunk_source_->SetHostStats(&host_stats_);
   text_track.sample_source_.reset(new chunk::ChunkSampleSource(
       text_track.chunk_source_.get(), load_control_.get(), &playback_rate_,
-      kTextBufSize));
+      standby ? kAlternateTextBufSize : kTextBufSize, nullptr, 0,
+      chunk::kDefaultMinLoadableRetryCount, CreateLoaderFactory()));
+  if (standby) {
+    text_track.sample_source_->SetMaxBufferedDurationUs(
+        player_attributes_.alternate_track_buffer.InMicroseconds());
+  }
   text_track.renderer_.reset(
       new SampleSourceTrackRenderer(text_track.sample_source_.get()));
   text_track.track_criteria_.reset(new TrackCriteria(util::kApplicationRAWCC));
+  text_track.track_criteria_->adaptation_set_index = stream;
+  return &text_track;
+}
 
-  for (auto& track : tracks_) {
-    int state = track.renderer_->Prepare(initial_time_.InMicroseconds());
-
-    if (state != TrackRenderer::PREPARED) {
-      LOG(ERROR) << track.name_ << " could not prepare for initial time "
-                 << initial_time_;
-      SetState(STATE_ENDED);
-      return;
-    }
-
-    if (!track.renderer_->Enable(track.track_criteria_.get(),
-                                 initial_time_.InMicroseconds(), false)) {
-      LOG(ERROR) << "Problem enabling " << track.name_ << " renderer";
-      SetState(STATE_ENDED);
-      return;
-    }
-
-    if (!track.renderer_->Start()) {
-      LOG(ERROR) << "Problem starting " << track.name_ << " renderer";
-      SetState(STATE_ENDED);
-      return;
-    }
+std::unique_ptr<chunk::LoaderFactoryInterface>
+DashThread::CreateLoaderFactory() const {
+  if (loader_pool_) {
+    return std::unique_ptr<chunk::LoaderFactoryInterface>(
+        new chunk::PooledLoaderFactory(loader_pool_->loader_task_runner()));
   }
-
-  SetState(STATE_BUFFERING);
-  qoe_manager_->ReportBuffering();
-
-  duration_ = base::TimeDelta::FromMilliseconds(
-      manifest_fetcher_->GetManifest()->GetDuration());
-
-  Update(true);
+  return std::unique_ptr<chunk::LoaderFactoryInterface>(
+      new chunk::DefaultLoaderFactory(&thread_config_));
 }
 
 void DashThread::OnManifestError(ManifestFetcher::ManifestFetchError error) {
@@ -366,7 +811,7 @@ void DashThread::OnManifestError(ManifestFetcher::ManifestFetchError error) {
 void DashThread::SetState(PlayerState new_state) {
   state_ = new_state;
   if (state_ == STATE_ENDED) {
-    codec_waiter_.Signal();
+    SignalCodecWaiter();
   }
 }
 
@@ -508,7 +953,33 @@ int DashThread::Seek(DashThread* dash, MediaTimeMs time) {
   return ret;
 }
 
-// TODO(rdaum): Expose this in the C API.
+// static
+float DashThread::GetCatchupRate(DashThread* dash) {
+  float ret;
+  auto cb =
+      base::Bind(&DashThread::GetCatchupRateImpl, base::Unretained(dash));
+  APICallAndWait(dash, &ret, FROM_HERE, cb);
+  return ret;
+}
+
+// static
+MediaDurationMs DashThread::GetLiveLatencyMs(DashThread* dash) {
+  MediaDurationMs ret;
+  auto cb =
+      base::Bind(&DashThread::GetLiveLatencyMsImpl, base::Unretained(dash));
+  APICallAndWait(dash, &ret, FROM_HERE, cb);
+  return ret;
+}
+
+// static
+int DashThread::GetMemoryUsage(DashThread* dash, DashMemoryUsage* usage) {
+  int ret;
+  auto cb = base::Bind(&DashThread::GetMemoryUsageImpl, base::Unretained(dash),
+                       usage);
+  APICallAndWait(dash, &ret, FROM_HERE, cb);
+  return ret;
+}
+
 int DashThread::GetStreamCounts(DashThread* dash,
                                 int* num_videostreams,
                                 int* num_audiostreams,
@@ -520,11 +991,97 @@ int DashThread::GetStreamCounts(DashThread* dash,
   return ret;
 }
 
+int DashThread::GetStreamInfo(DashThread* dash,
+                              DashFrameType type,
+                              int stream,
+                              DashStreamInfo* info) {
+  int ret;
+  auto cb = base::Bind(&DashThread::GetStreamInfoImpl, base::Unretained(dash),
+                       type, stream, info);
+  APICallAndWait(dash, &ret, FROM_HERE, cb);
+  return ret;
+}
+
+int DashThread::SetAudioStream(DashThread* dash, int stream) {
+  int ret;
+  auto cb = base::Bind(&DashThread::SetStreamImpl, base::Unretained(dash),
+                       DASH_FRAME_TYPE_AUDIO, stream);
+  APICallAndWait(dash, &ret, FROM_HERE, cb);
+  return ret;
+}
+
+int DashThread::SetSpuStream(DashThread* dash, int stream) {
+  int ret;
+  auto cb = base::Bind(&DashThread::SetStreamImpl, base::Unretained(dash),
+                       DASH_FRAME_TYPE_CC, stream);
+  APICallAndWait(dash, &ret, FROM_HERE, cb);
+  return ret;
+}
+
+int DashThread::SetViewportSize(DashThread* dash, int width, int height) {
+  int ret;
+  auto cb = base::Bind(&DashThread::SetViewportSizeImpl,
+                       base::Unretained(dash), width, height);
+  APICallAndWait(dash, &ret, FROM_HERE, cb);
+  return ret;
+}
+
+int DashThread::SetDecoderLimits(DashThread* dash,
+                                 int max_width,
+                                 int max_height,
+                                 float max_frame_rate) {
+  int ret;
+  auto cb = base::Bind(&DashThread::SetDecoderLimitsImpl,
+                       base::Unretained(dash), max_width, max_height,
+                       max_frame_rate);
+  APICallAndWait(dash, &ret, FROM_HERE, cb);
+  return ret;
+}
+
+int DashThread::ReportRenderedFrames(DashThread* dash,
+                                     int rendered_frames,
+                                     int dropped_frames) {
+  int ret;
+  auto cb = base::Bind(&DashThread::ReportRenderedFramesImpl,
+                       base::Unretained(dash), rendered_frames, dropped_frames);
+  APICallAndWait(dash, &ret, FROM_HERE, cb);
+  return ret;
+}
+
 // Begin private methods
 
+void DashThread::SaveSessionState() {
+  if (!session_state_) {
+    return;
+  }
+  int64_t bitrate_estimate = media_bandwidth_meter_->GetBitrateEstimate();
+  if (bitrate_estimate != upstream::BandwidthMeterInterface::kNoEstimate) {
+    session_state_->SetBitrateEstimate(bitrate_estimate, base::Time::Now());
+  }
+  for (const auto& track : tracks_) {
+    if (track.standby_) {
+      continue;
+    }
+    const util::Format* format = track.chunk_source_->GetSelectedFormat();
+    if (format) {
+      session_state_->SetSelectedFormatId(
+          track.chunk_source_->GetAdaptationType(), format->GetId());
+    }
+  }
+  session_state_->Save();
+}
+
 void DashThread::UnloadImpl() {
   LOG(INFO) << "DashThread::UnloadImpl";
+  AbandonLoad();
+  SaveSessionState();
   SetState(STATE_ENDED);
+  // A prefetch stuck on the network would hold up destroying the tracks.
+  for (auto& track : tracks_) {
+    if (track.prefetching_data_source_) {
+      track.prefetching_data_source_->Cancel();
+    }
+  }
   TrackRenderer::RendererState state;
   // Transition renderer states back until they are released.
   pending_disable_.clear();
@@ -598,9 +1155,32 @@ void DashThread::Update(bool allow_schedule) {
         new upstream::DefaultAllocator(32768, 192));
     load_control_ =
         std::unique_ptr<LoadControl>(new LoadControl(allocator_.get()));
+    load_control_->SetMemoryGovernor(MemoryGovernor::GetInstance(),
+                                     player_attributes_.memory_priority);
+
+    if (player_attributes_.shared_executor) {
+      loader_pool_ = GetSharedLoaderPool();
+    }
+
+    if (!player_attributes_.network_replay_file.empty()) {
+      network_trace_.reset(new upstream::NetworkTrace);
+      network_trace_->set_paced(player_attributes_.network_replay_paced);
+      if (!network_trace_->Load(
+              base::FilePath(player_attributes_.network_replay_file))) {
+        network_trace_.reset();
+      }
+    } else if (!player_attributes_.network_record_file.empty()) {
+      network_trace_.reset(new upstream::NetworkTrace);
+      if (!network_trace_->StartRecording(
+              base::FilePath(player_attributes_.network_record_file))) {
+        network_trace_.reset();
+      }
+    }
 
     manifest_fetcher_ = std::unique_ptr<ManifestFetcher>(
-        new ManifestFetcher(url_, task_runner(), this));
+        new ManifestFetcher(url_, task_runner(), this, loader_pool_,
+                            &thread_config_));
+    manifest_fetcher_->SetNetworkTrace(network_trace_.get());
 
     // When refresh is done, our state will move to buffering.
     manifest_fetcher_->RequestRefresh();
@@ -609,6 +1189,15 @@ void DashThread::Update(bool allow_schedule) {
     media_bandwidth_meter_.reset(new upstream::DefaultBandwidthMeter(
         base::Bind(&DashThread::NewBandwidthEstimate, base::Unretained(this)),
         task_runner()));
+
+    if (!player_attributes_.session_state_dir.empty()) {
+      session_state_.reset(new SessionStateStore(
+          base::FilePath(player_attributes_.session_state_dir), url_));
+      session_state_->Load();
+      media_bandwidth_meter_->SetInitialEstimate(
+          session_state_->GetBitrateEstimate(base::Time::Now(),
+                                             kMaxSessionStateAge));
+    }
   } else if (state_ == STATE_BUFFERING) {
     LOG(INFO) << "update state=" << state_ << " dpos=" << decoder_position_
               << " rpos=" << reader_position_
@@ -619,6 +1208,11 @@ void DashThread::Update(bool allow_schedule) {
       if (track.renderer_->GetState() == TrackRenderer::STARTED ||
           track.renderer_->GetState() == TrackRenderer::ENABLED) {
         track.renderer_->Buffer(reader_position_.InMicroseconds());
+        // Keep what a switch would start from, and no more.
+        if (track.standby_) {
+          track.sample_source_->DiscardUntil(
+              decoder_position_.InMicroseconds());
+        }
       }
     }
 
@@ -660,6 +1254,13 @@ void DashThread::UpdateMediaTime() {
     decoder_media_time_last_value_ms_ = new_decoder_time_ms;
     decoder_media_time_last_call_timestamp_ = now;
 
+    base::Time position_time;
+    if (live_latency_controller_ &&
+        GetWallClockTime(new_decoder_time_ms, &position_time)) {
+      live_latency_controller_->UpdateLatency(base::Time::Now() -
+                                              position_time);
+    }
+
     if (old_decoder_time_ms != decoder_media_time_last_value_ms_) {
       decoder_time_moved = true;
     }
@@ -677,6 +1278,66 @@ void DashThread::UpdateMediaTime() {
   }
 }
 
+bool DashThread::GetWallClockTime(int64_t decoder_time_ms,
+                                  base::Time* time) {
+  const mpd::MediaPresentationDescription* manifest =
+      manifest_fetcher_->GetManifest().get();
+  if (!manifest || manifest->GetAvailabilityStartTime() == -1 ||
+      !has_video_anchor_) {
+    return false;
+  }
+  // The period of the last video sample handed to the decoder, and the
+  // representation selected in it.
+  base::TimeDelta anchor_time =
+      base::TimeDelta::FromMicroseconds(video_anchor_sample_us_);
+  const mpd::Period* period = nullptr;
+  for (size_t i = 0; i < manifest->GetPeriodCount(); i++) {
+    if (i > 0 && base::TimeDelta::FromMilliseconds(
+                     manifest->GetPeriod(i)->GetStartMs()) > anchor_time) {
+      break;
+    }
+    period = manifest->GetPeriod(i);
+  }
+  TrackContext* video_track = GetActiveTrack(DASH_FRAME_TYPE_VIDEO);
+  const mpd::AdaptationSet* adaptation_set =
+      period && video_track
+          ? dash::PeriodHolder::SelectAdaptationSet(
+                *period, video_track->track_criteria_.get())
+          : nullptr;
+  if (!adaptation_set || !adaptation_set->HasRepresentations()) {
+    return false;
+  }
+  const util::Format* format = video_track->chunk_source_->GetSelectedFormat();
+  const mpd::Representation* representation =
+      adaptation_set->GetRepresentation(0);
+  for (int32_t i = 0; format && i < adaptation_set->NumRepresentations();
+       i++) {
+    if (adaptation_set->GetRepresentation(i)->GetFormat().GetId() ==
+        format->GetId()) {
+      representation = adaptation_set->GetRepresentation(i);
+      break;
+    }
+  }
+
+  // Chunks put samples on the sample timeline by adding the period start less
+  // the presentationTimeOffset of their representation; take that back off to
+  // get the sample's media time, then move it on to |decoder_time_ms|.
+  base::TimeDelta period_start =
+      base::TimeDelta::FromMilliseconds(period->GetStartMs());
+  base::TimeDelta pto = base::TimeDelta::FromMicroseconds(
+      representation->GetPresentationTimeOffsetUs());
+  base::TimeDelta media_time =
+      anchor_time - period_start + pto +
+      base::TimeDelta::FromMilliseconds(decoder_time_ms) -
+      base::TimeDelta::FromMicroseconds(video_anchor_decoder_us_);
+  VLOG(3) << "Playing " << period->GetId() << " at media time " << media_time;
+  *time = LiveLatencyController::GetAvailabilityTime(
+      base::Time::UnixEpoch() + base::TimeDelta::FromMilliseconds(
+                                    manifest->GetAvailabilityStartTime()),
+      period_start, pto, media_time);
+  return true;
+}
+
 int64_t DashThread::GetSampleOffsetMs() {
   if (sample_offset_ms_ != -1) {
     return sample_offset_ms_;
@@ -782,7 +1443,7 @@ int DashThread::GetVideoCodecSettingsImpl(DashVideoCodecSettings* settings) {
 
 int DashThread::GetAudioCodecSettingsImpl(DashAudioCodecSettings* settings) {
   for (auto& track : tracks_) {
-    if (track.frame_type_ == DASH_FRAME_TYPE_AUDIO) {
+    if (track.frame_type_ == DASH_FRAME_TYPE_AUDIO && !track.standby_) {
       // We should not have been allowed to get here unless we have the
       // upstream media format. See Load().
       CHECK(track.upstream_format_ != nullptr);
@@ -827,7 +1488,7 @@ bool DashThread::FillTrackSampleHolders() {
 
   // Try to ensure that all tracks have a sample ready
   for (TrackContext& track : tracks_) {
-    if (track.is_eos_)
+    if (track.is_eos_ || track.standby_)
       continue;
 
     TrackRenderer::RendererState state = track.renderer_->GetState();
@@ -911,6 +1572,20 @@ bool DashThread::FillTrackSampleHolders() {
         continue;
       }
 
+      // Fast enough, and the decoder is spared the video frames that nothing
+      // else is predicted from.
+      if (track.frame_type_ == DASH_FRAME_TYPE_VIDEO &&
+          player_attributes_.non_reference_drop_rate > 0 &&
+          playback_rate_.GetMagnitude() >=
+              player_attributes_.non_reference_drop_rate &&
+          (track.sample_holder_.GetFlags() & util::kSampleFlagNonReference) !=
+              0) {
+        VLOG(6) << track.name_ << " dropping non-reference frame";
+        track.sample_holder_.ClearData();
+        i--;
+        continue;
+      }
+
       VLOG(6) << track.name_ << " sample read; size "
               << track.sample_holder_.GetWrittenSize();
       track.has_sample_ = true;
@@ -1110,6 +1785,8 @@ void DashThread::PopulateFrameInfoCrypto(struct DashFrameInfo* fi,
 int DashThread::CopyFrameImpl(void* buffer,
                               int buffer_len,
                               struct DashFrameInfo* fi) {
+  TRACE_EVENT0(TRACE_DISABLED_BY_DEFAULT("ndash.frames"),
+               "DashThread::CopyFrameImpl");
   memset(fi, 0, sizeof(struct DashFrameInfo));
 
   if (state_ != STATE_BUFFERING) {
@@ -1118,6 +1795,7 @@ int DashThread::CopyFrameImpl(void* buffer,
   }
 
   if (!current_track_) {
+    ApplyStreamSwitches();
     if (!FillTrackSampleHolders()) {
       LOG(INFO) << "All tracks report END_OF_STREAM; playback ended";
 
@@ -1155,12 +1833,29 @@ int DashThread::CopyFrameImpl(void* buffer,
 
   fi->type = current_track_->frame_type_;
 
+  int32_t sample_flags = sample_holder->GetFlags();
+  if ((sample_flags & util::kSampleFlagSync) != 0) {
+    fi->flags |= DASH_FRAME_INFO_FLAG_KEY_FRAME;
+  }
+  if ((sample_flags & util::kSampleFlagReference) != 0) {
+    fi->flags |= DASH_FRAME_INFO_FLAG_REFERENCE;
+  }
+  if ((sample_flags & util::kSampleFlagNonReference) != 0) {
+    fi->flags |= DASH_FRAME_INFO_FLAG_NON_REFERENCE;
+  }
+
   fi->width = current_track_->format_holder_.format->GetWidth();
   fi->height = current_track_->format_holder_.format->GetHeight();
 
   int64_t sample_time_us =
       sample_holder->GetTimeUs() - GetSampleOffsetMs() * 1000;
   util::PresentationTime pt = util::PresentationTimeFromUs(sample_time_us);
+  if (current_track_->frame_type_ == DASH_FRAME_TYPE_VIDEO &&
+      live_latency_controller_) {
+    has_video_anchor_ = true;
+    video_anchor_decoder_us_ = sample_time_us;
+    video_anchor_sample_us_ = sample_holder->GetTimeUs();
+  }
 
   fi->pts = pt.pts;
   util::MediaDuration md =
@@ -1169,6 +1864,8 @@ int DashThread::CopyFrameImpl(void* buffer,
   fi->frame_len = sample_holder->GetWrittenSize();
 
   if (num_to_write == sample_remaining) {
+    current_track_->delivered_until_us_ =
+        sample_holder->GetTimeUs() + sample_holder->GetDurationUs();
     sample_holder_consumed_ = 0;
     current_track_->has_sample_ = false;
     current_track_->sample_holder_.ClearData();
@@ -1199,6 +1896,53 @@ MediaDurationMs DashThread::GetDurationMsImpl() {
   return duration_.InMilliseconds();
 }
 
+float DashThread::GetCatchupRateImpl() {
+  if (!live_latency_controller_) {
+    return 1.0f;
+  }
+  return live_latency_controller_->GetCatchupRate();
+}
+
+int DashThread::GetMemoryUsageImpl(DashMemoryUsage* usage) {
+  memset(usage, 0, sizeof(DashMemoryUsage));
+  MemoryGovernor* governor = MemoryGovernor::GetInstance();
+  usage->budget = governor->GetBudget();
+  usage->total_allocated = governor->GetTotalBytesAllocated();
+  if (!load_control_) {
+    return -1;
+  }
+
+  usage->limit = load_control_->GetTargetBufferSize();
+  usage->allocated = allocator_->GetTotalBytesAllocated();
+  for (TrackContext& track : tracks_) {
+    if (!track.sample_source_) {
+      continue;
+    }
+    size_t bytes = track.sample_source_->GetBytesAllocated();
+    switch (track.frame_type_) {
+      case DASH_FRAME_TYPE_VIDEO:
+        usage->video_allocated += bytes;
+        break;
+      case DASH_FRAME_TYPE_AUDIO:
+        usage->audio_allocated += bytes;
+        break;
+      case DASH_FRAME_TYPE_CC:
+        usage->text_allocated += bytes;
+        break;
+      default:
+        break;
+    }
+  }
+  return 0;
+}
+
+MediaDurationMs DashThread::GetLiveLatencyMsImpl() {
+  if (!live_latency_controller_ || !live_latency_controller_->has_latency()) {
+    return -1;
+  }
+  return live_latency_controller_->latency().InMilliseconds();
+}
+
 int DashThread::SeekImpl(MediaTimeMs time_ms) {
   bool is_seek_to_start = time_ms == 0;
   time_ms += GetSampleOffsetMs();
@@ -1246,6 +1990,10 @@ int DashThread::SeekImpl(MediaTimeMs time_ms) {
   seek_position_ = seek_time;
   media_time_last_value_ms_ = seek_time.InMicroseconds();
   decoder_media_time_last_value_ms_ = 0;
+  if (live_latency_controller_) {
+    live_latency_controller_->Reset();
+  }
+  has_video_anchor_ = false;
 
   if (state_ != STATE_BUFFERING) {
     initial_time_ = seek_time;
@@ -1273,6 +2021,7 @@ int DashThread::SeekImpl(MediaTimeMs time_ms) {
   for (TrackContext& track : tracks_) {
     track.sample_holder_.ClearData();
     track.has_sample_ = false;
+    track.delivered_until_us_ = 0;
   }
 
   media_time_ready_ = false;
@@ -1364,6 +2113,7 @@ void DashThread::SetPlaybackRateEnableTracks(float target_rate,
       track.renderer_->Start();
       track.sample_holder_.ClearData();
       track.has_sample_ = false;
+      track.delivered_until_us_ = 0;
     }
   }
 
@@ -1378,11 +2128,282 @@ void DashThread::SetPlaybackRateEnableTracks(float target_rate,
 int DashThread::GetStreamCountsImpl(int* num_video_streams,
                                     int* num_audio_streams,
                                     int* num_cc_streams) {
-  // TODO(rmrossi): TBD
-  *num_video_streams = 1;
-  *num_audio_streams = 1;
-  *num_cc_streams = 0;
-  return 1;
+  const mpd::Period* period = GetCurrentPeriod();
+  if (!period) {
+    return -1;
+  }
+  *num_video_streams =
+      dash::PeriodHolder::GetAdaptationSets(*period, kVideoMimeType).size();
+  *num_audio_streams =
+      dash::PeriodHolder::GetAdaptationSets(*period, kAudioMimeType).size();
+  *num_cc_streams =
+      dash::PeriodHolder::GetAdaptationSets(*period, util::kApplicationRAWCC)
+          .size();
+  return 0;
+}
+
+int DashThread::GetStreamInfoImpl(DashFrameType type,
+                                  int stream,
+                                  DashStreamInfo* info) {
+  memset(info, 0, sizeof(DashStreamInfo));
+  const TrackContext* track = GetActiveTrack(type);
+  const mpd::Period* period = GetCurrentPeriod();
+  if (!track || !period) {
+    return -1;
+  }
+  std::vector<const mpd::AdaptationSet*> sets =
+      dash::PeriodHolder::GetAdaptationSets(*period,
+                                            track->track_criteria_->mime_type);
+  if (stream < 0 || static_cast<size_t>(stream) >= sets.size()) {
+    return -1;
+  }
+  const util::Format& format = sets[stream]->GetRepresentation(0)->GetFormat();
+  base::strlcpy(info->language, format.GetLanguage().c_str(),
+                sizeof(info->language));
+  base::strlcpy(info->codecs, format.GetCodecs().c_str(),
+                sizeof(info->codecs));
+  if (type == DASH_FRAME_TYPE_AUDIO) {
+    info->channels = format.GetAudioChannels();
+  }
+  int selected = GetStreamNumber(*track, *period);
+  auto pending = pending_stream_switches_.find(type);
+  if (pending != pending_stream_switches_.end()) {
+    selected = pending->second;
+  }
+  info->selected = stream == selected;
+  return 0;
+}
+
+int DashThread::SetStreamImpl(DashFrameType type, int stream) {
+  if (type != DASH_FRAME_TYPE_AUDIO && type != DASH_FRAME_TYPE_CC) {
+    return -1;
+  }
+  // Only the video track is enabled while tricking. While preparing, the
+  // tracks are yet to be set up and start with the stream asked for.
+  bool preparing = state_ == STATE_PREPARING;
+  if ((state_ != STATE_BUFFERING && !preparing) ||
+      !playback_rate_.IsNormal()) {
+    LOG(WARNING) << "Can't switch streams now";
+    return -1;
+  }
+  if (!preparing && !GetActiveTrack(type)) {
+    return -1;
+  }
+  // The manifest may not be there yet while preparing; the stream is checked
+  // against it when the tracks are set up.
+  const mpd::Period* period = GetCurrentPeriod();
+  if (stream < 0 || (period && !IsStream(*period, type, stream))) {
+    LOG(WARNING) << "No stream " << stream << " of type " << type;
+    return -1;
+  }
+  pending_stream_switches_[type] = stream;
+  if (!preparing) {
+    ApplyStreamSwitches();
+  }
+  return 0;
+}
+
+// static
+bool DashThread::IsStream(const mpd::Period& period,
+                          DashFrameType type,
+                          int stream) {
+  const char* mime_type = type == DASH_FRAME_TYPE_AUDIO
+                              ? kAudioMimeType
+                              : util::kApplicationRAWCC;
+  return stream >= 0 &&
+         static_cast<size_t>(stream) <
+             dash::PeriodHolder::GetAdaptationSets(period, mime_type).size();
+}
+
+int DashThread::TakeInitialStream(DashFrameType type) {
+  auto pending = pending_stream_switches_.find(type);
+  if (pending == pending_stream_switches_.end()) {
+    return -1;
+  }
+  int stream = pending->second;
+  pending_stream_switches_.erase(pending);
+  const mpd::Period* period = GetCurrentPeriod();
+  if (!period || !IsStream(*period, type, stream)) {
+    LOG(WARNING) << "No stream " << stream << " of type " << type
+                 << "; starting with the default";
+    return -1;
+  }
+  return stream;
+}
+
+int DashThread::SetViewportSizeImpl(int width, int height) {
+  if (width < 0 || height < 0) {
+    return -1;
+  }
+  render_feedback_.SetViewportSize(width, height);
+  return 0;
+}
+
+int DashThread::SetDecoderLimitsImpl(int max_width,
+                                     int max_height,
+                                     float max_frame_rate) {
+  if (max_width < 0 || max_height < 0 || max_frame_rate < 0) {
+    return -1;
+  }
+  render_feedback_.SetDecoderLimits(max_width, max_height, max_frame_rate);
+  return 0;
+}
+
+int DashThread::ReportRenderedFramesImpl(int rendered_frames,
+                                         int dropped_frames) {
+  if (rendered_frames < 0 || dropped_frames < 0) {
+    return -1;
+  }
+  // Frames are charged to the format last delivered to the client.
+  TrackContext* track = GetActiveTrack(DASH_FRAME_TYPE_VIDEO);
+  int32_t bitrate = 0;
+  if (track && track->format_holder_.format) {
+    bitrate = track->format_holder_.format->GetBitrate();
+  }
+  render_feedback_.ReportFrames(rendered_frames, dropped_frames, bitrate);
+  return 0;
+}
+
+const mpd::Period* DashThread::GetCurrentPeriod() const {
+  if (!manifest_fetcher_) {
+    return nullptr;
+  }
+  const mpd::MediaPresentationDescription* manifest =
+      manifest_fetcher_->GetManifest().get();
+  if (!manifest || manifest->GetPeriodCount() == 0) {
+    return nullptr;
+  }
+  int64_t position_ms = reader_position_.InMilliseconds();
+  size_t index = 0;
+  while (index + 1 < manifest->GetPeriodCount() &&
+         static_cast<int64_t>(manifest->GetPeriod(index + 1)->GetStartMs()) <=
+             position_ms) {
+    index++;
+  }
+  return manifest->GetPeriod(index);
+}
+
+DashThread::TrackContext* DashThread::GetActiveTrack(DashFrameType type) {
+  for (TrackContext& track : tracks_) {
+    if (track.frame_type_ == type && !track.standby_) {
+      return &track;
+    }
+  }
+  return nullptr;
+}
+
+// static
+int DashThread::GetStreamNumber(const TrackContext& track,
+                                const mpd::Period& period) {
+  std::vector<const mpd::AdaptationSet*> sets =
+      dash::PeriodHolder::GetAdaptationSets(period,
+                                            track.track_criteria_->mime_type);
+  auto it = std::find(
+      sets.begin(), sets.end(),
+      dash::PeriodHolder::SelectAdaptationSet(period,
+                                              track.track_criteria_.get()));
+  return it == sets.end() ? -1 : it - sets.begin();
+}
+
+void DashThread::ApplyStreamSwitches() {
+  auto it = pending_stream_switches_.begin();
+  while (it != pending_stream_switches_.end()) {
+    // Part of a sample has been delivered; finish it first.
+    if (current_track_ && current_track_->frame_type_ == it->first) {
+      ++it;
+      continue;
+    }
+    TrackContext* track = GetActiveTrack(it->first);
+    if (track) {
+      SwitchStream(track, it->second);
+    }
+    it = pending_stream_switches_.erase(it);
+  }
+}
+
+void DashThread::SwitchStream(TrackContext* track, int stream) {
+  const mpd::Period* period = GetCurrentPeriod();
+  int current_stream = period ? GetStreamNumber(*track, *period) : -1;
+  if (stream == current_stream) {
+    return;
+  }
+
+  // The new stream picks up after the last sample delivered. One already
+  // read from the old stream is dropped.
+  int64_t splice_us =
+      track->has_sample_
+          ? track->sample_holder_.GetTimeUs()
+          : std::max(track->delivered_until_us_,
+                     decoder_position_.InMicroseconds());
+  track->sample_holder_.ClearData();
+  track->has_sample_ = false;
+  track->is_eos_ = false;
+
+  TrackContext* standby = nullptr;
+  for (TrackContext& other : tracks_) {
+    if (other.standby_ && other.frame_type_ == track->frame_type_ &&
+        other.track_criteria_->adaptation_set_index == stream) {
+      standby = &other;
+      break;
+    }
+  }
+
+  if (standby) {
+    LOG(INFO) << "Switching " << track->name_ << " to standby stream "
+              << stream << " at " << splice_us << "us";
+    // The old stream takes the new one's place, buffering only a little.
+    track->standby_ = true;
+    track->track_criteria_->adaptation_set_index = current_stream;
+    track->sample_source_->SetMaxBufferedDurationUs(
+        player_attributes_.alternate_track_buffer.InMicroseconds());
+    standby->standby_ = false;
+    standby->sample_source_->SetMaxBufferedDurationUs(0);
+    standby->sample_source_->DiscardUntil(splice_us);
+    standby->delivered_until_us_ = splice_us;
+    standby->check_pssh_ = true;
+    return;
+  }
+
+  LOG(INFO) << "Switching " << track->name_ << " to stream " << stream
+            << " at " << splice_us << "us; reloading";
+  track->track_criteria_->adaptation_set_index = stream;
+  if (track->renderer_->GetState() == TrackRenderer::STARTED) {
+    track->renderer_->Stop();
+  }
+  if (track->renderer_->GetState() == TrackRenderer::ENABLED) {
+    base::Closure disable_done =
+        base::Bind(&DashThread::ReenableTrack, base::Unretained(this),
+                   base::Unretained(track), splice_us);
+    track->renderer_->Disable(&disable_done);
+  }
+}
+
+void DashThread::ReenableTrack(TrackContext* track, int64_t position_us) {
+  if (track->renderer_->GetState() != TrackRenderer::PREPARED) {
+    // A playback rate change has enabled it again already.
+    return;
+  }
+  if (state_ != STATE_BUFFERING || !playback_rate_.IsNormal()) {
+    // Unloading, or changing the playback rate. The change enables the
+    // track again itself when it is back to normal speed.
+    LOG(INFO) << "Not enabling " << track->name_ << " again in state "
+              << state_ << " at rate " << playback_rate_.rate();
+    return;
+  }
+  if (!track->renderer_->Enable(track->track_criteria_.get(), position_us,
+                                false) ||
+      !track->renderer_->Start()) {
+    LOG(ERROR) << "Problem enabling " << track->name_ << " renderer";
+    ReportPlaybackError(
+        qoe::VideoErrorCode::FRAMEWORK_MEDIA_PLAYER_PLAYBACK_ERROR,
+        std::string("Couldn't switch ") + track->name_ + " stream", false);
+    return;
+  }
+  track->sample_holder_.ClearData();
+  track->has_sample_ = false;
+  track->is_eos_ = false;
+  track->check_pssh_ = true;
+  track->delivered_until_us_ = position_us;
 }
 
 bool DashThread::MakeLicenseRequest(const std::string& key_message_blob,
@@ -1390,6 +2411,10 @@ bool DashThread::MakeLicenseRequest(const std::string& key_message_blob,
   return license_fetcher_.Fetch(key_message_blob, out_response);
 }
 
+bool DashThread::PrefetchLicense(const std::string& pssh) {
+  return drm_session_manager_.Prefetch(pssh.c_str(), pssh.length());
+}
+
 void DashThread::ReportPlaybackState(DashStreamState state) {
   if (!qoe_manager_) {
     return;
@@ -1453,7 +2478,7 @@ void DashThread::FormatGiven(TrackContext* track, const MediaFormat* format) {
 
   // We have codecs for both audio and video. Release the waiter.
   if (HaveCodecs()) {
-    codec_waiter_.Signal();
+    SignalCodecWaiter();
   }
 }
 
@@ -1474,6 +2499,9 @@ bool DashThread::HaveCodecs() const {
   bool have_audio = false;
   bool have_video = false;
   for (auto& track : tracks_) {
+    if (track.standby_) {
+      continue;
+    }
     if (track.frame_type_ == DASH_FRAME_TYPE_AUDIO &&
         track.upstream_format_.get() != nullptr) {
       have_audio = true;
@@ -19,6 +19,7 @@
 
 #include <atomic>
 #include <cstdint>
+#include <map>
 
 #include "base/memory/weak_ptr.h"
 #include "base/synchronization/lock.h"
@@ -26,23 +27,32 @@
 #include "base/threading/thread.h"
 #include "chunk/chunk_sample_source.h"
 #include "chunk/format_evaluator.h"
+#include "chunk/render_feedback.h"
 #include "dash/dash_chunk_source.h"
 #include "dash/dash_track_selector.h"
 #include "drm/drm_session_manager.h"
 #include "drm/license_fetcher.h"
+#include "live_latency_controller.h"
 #include "load_control.h"
 #include "manifest_fetcher.h"
+#include "mpd/period.h"
 #include "ndash.h"
 #include "playback_rate.h"
 #include "player_attributes.h"
 #include "qoe/qoe_manager.h"
 #include "sample_holder.h"
 #include "sample_source.h"
+#include "session_state.h"
 #include "track_criteria.h"
 #include "track_renderer.h"
 #include "upstream/allocator.h"
 #include "upstream/data_source.h"
 #include "upstream/default_bandwidth_meter.h"
+#include "upstream/host_stats.h"
+#include "upstream/loader_pool.h"
+#include "upstream/network_trace.h"
+#include "upstream/prefetching_data_source.h"
+#include "util/thread_config.h"
 
 namespace ndash {
 
@@ -61,11 +71,23 @@ class DashThread : public base::Thread,
   explicit DashThread(const std::string& name, void* context);
   ~DashThread() override;
 
+  // Starts the thread with the settings for control threads that
+  // ndash_set_thread_config() gave. Called by the consumer thread.
+  bool StartWithThreadConfig();
+
   // Load the manifest pointed to by |url|, process it and begin buffering.
   // This method should be called by the consumer (player) thread.
   // Returns false on fatal error.
   bool Load(const char* url, int32_t initialTimeSec);
 
+  // Like Load() but does not wait for the codecs: |loaded_func| is called
+  // with the callback context, and 0 or -1 as Load() would return true or
+  // false, once they are known, on failure, or when unloaded. It is called
+  // exactly once, from whichever thread made that so.
+  void LoadAsync(const char* url,
+                 int32_t initialTimeSec,
+                 DashPlayerLoadedFunc loaded_func);
+
   // Unloads the player. Renderer states will transition back to the
   // TrackRenderer::RELEASED state.  Loaders are canceled and stopped. This
   // method will block until tear down is complete. This method should be
@@ -116,13 +138,28 @@ class DashThread : public base::Thread,
   static MediaTimeMs GetFirstTime(DashThread* dash);
   static MediaDurationMs GetDurationMs(DashThread* dash);
   static int Seek(DashThread* dash, MediaTimeMs time);
+  static float GetCatchupRate(DashThread* dash);
+  static MediaDurationMs GetLiveLatencyMs(DashThread* dash);
+  static int GetMemoryUsage(DashThread* dash, DashMemoryUsage* usage);
   static int GetStreamCounts(DashThread* dash,
                              int* num_videostreams,
                              int* num_audiostreams,
                              int* num_cc_streams);
+  static int GetStreamInfo(DashThread* dash,
+                           DashFrameType type,
+                           int stream,
+                           DashStreamInfo* info);
   static int SetVideoStream(DashThread* dash, int stream);
   static int SetAudioStream(DashThread* dash, int stream);
   static int SetSpuStream(DashThread* dash, int stream);
+  static int SetViewportSize(DashThread* dash, int width, int height);
+  static int SetDecoderLimits(DashThread* dash,
+                              int max_width,
+                              int max_height,
+                              float max_frame_rate);
+  static int ReportRenderedFrames(DashThread* dash,
+                                  int rendered_frames,
+                                  int dropped_frames);
 
   // Make a request for a playback license from the license server.
   // key_message_blob - The body of the request constructed by the CDM.
@@ -131,6 +168,10 @@ class DashThread : public base::Thread,
   bool MakeLicenseRequest(const std::string& key_message_blob,
                           std::string* out_response);
 
+  // Fetches the license for |pssh| (a PSSH box) in the background; see
+  // DrmSessionManager::Prefetch(). Returns false on error.
+  bool PrefetchLicense(const std::string& pssh);
+
   void ReportPlaybackState(DashStreamState state);
 
   // Public report function that takes our published subset of playback error
@@ -177,6 +218,13 @@ class DashThread : public base::Thread,
     int times_selected_ = 0;
     bool has_sample_ = false;
     bool is_eos_ = false;
+    // Loading but not delivered: an alternate audio or caption stream kept
+    // ready so that switching to it needs no download. Its track criteria
+    // select it by number.
+    bool standby_ = false;
+    // The end of the last sample delivered, where a switch to another stream
+    // picks up.
+    int64_t delivered_until_us_ = 0;
     // |format_holder_| is a holder populated by the ReadFrame method and is
     // used on the consuming end.
     MediaFormatHolder format_holder_;
@@ -192,6 +240,12 @@ class DashThread : public base::Thread,
     // Order matters. Destroy things in the opposite order in which they
     // were created.
     std::unique_ptr<upstream::DataSourceInterface> data_source_;
+    // Fetches a track's first media segment while its initialization segment
+    // is loading. Null for tracks that do not need one.
+    std::unique_ptr<upstream::PrefetchingDataSource> prefetching_data_source_;
+    // Serves initialization and index requests from |session_state_|. Null
+    // without one.
+    std::unique_ptr<upstream::DataSourceInterface> initialization_data_source_;
     std::unique_ptr<chunk::FormatEvaluatorInterface> format_evaluator_;
     std::unique_ptr<dash::DashChunkSource> chunk_source_;
     std::unique_ptr<chunk::ChunkSampleSource> sample_source_;
@@ -199,14 +253,54 @@ class DashThread : public base::Thread,
     std::unique_ptr<TrackCriteria> track_criteria_;
   };
 
+  // What OnManifestRefreshed() works out once for all the tracks it sets up.
+  struct TrackSetup {
+    bool curl_global_lock = false;
+    bool all_tracks_metered = true;
+    base::TimeDelta live_edge_latency;
+    bool start_at_live_edge = false;
+    scoped_refptr<base::TaskRunner> curl_task_runner;
+    scoped_refptr<base::TaskRunner> prefetch_task_runner;
+  };
+
   // Unless otherwise stated, all private member functions are called by the
   // DashThread's task runner.
 
+  // Add a track for the audio or caption stream numbered |stream|, or for
+  // the one the default criteria select if -1, to |tracks_|. A |standby|
+  // track only buffers as far ahead as the alternate-track-buffer-ms
+  // attribute allows.
+  TrackContext* AddAudioTrack(const TrackSetup& setup,
+                              int stream,
+                              bool standby);
+  TrackContext* AddTextTrack(const TrackSetup& setup, int stream, bool standby);
+
+  // Posts the initial update that starts loading |url|. Called on the
+  // consumer thread.
+  void StartLoad(const char* url, int32_t initial_time_sec);
+  // Releases Load(), and runs the LoadAsync() callback if it has not run
+  // yet. Called on any thread.
+  void SignalCodecWaiter();
+  void RunLoadedFunc();
+  // Runs the LoadAsync() callback of the load numbered |load_generation|,
+  // unless that load has since been unloaded or replaced. Posted as the
+  // timeout for the codecs to arrive.
+  void LoadTimedOut(uint64_t load_generation);
+  // Runs the LoadAsync() callback with a failure if it has not run yet, and
+  // makes sure nothing else runs it for the current load.
+  void AbandonLoad();
+
+  // Remembers the bandwidth estimate and selected formats in
+  // |session_state_|, if set.
+  void SaveSessionState();
   void UnloadImpl();
   void UnloadImplDisabled(TrackRenderer* disabled_renderer);
   void NotifyUnloadWaiter();
   void ScheduleUpdate();
   void Update(bool allow_schedule);
+  // Returns a factory for the loaders of a new ChunkSampleSource, backed by
+  // |loader_pool_| if set.
+  std::unique_ptr<chunk::LoaderFactoryInterface> CreateLoaderFactory() const;
   void UpdateMediaTime();
 
   // Gets the next track that should have a sample passed to the API. Call
@@ -249,6 +343,43 @@ class DashThread : public base::Thread,
   MediaTimeMs GetFirstTimeMsImpl();
   MediaDurationMs GetDurationMsImpl();
   int SeekImpl(MediaTimeMs time_ms);
+  float GetCatchupRateImpl();
+  MediaDurationMs GetLiveLatencyMsImpl();
+  int GetMemoryUsageImpl(DashMemoryUsage* usage);
+  int GetStreamInfoImpl(DashFrameType type, int stream, DashStreamInfo* info);
+  // Requests a switch of the |type| track to |stream|, made by
+  // ApplyStreamSwitches() once that track is between samples, or when the
+  // tracks are set up if that is yet to happen.
+  int SetStreamImpl(DashFrameType type, int stream);
+  // Whether |period| has an audio or caption (|type|) stream |stream|.
+  static bool IsStream(const mpd::Period& period,
+                       DashFrameType type,
+                       int stream);
+  // Returns the stream a switch requested while preparing asks the |type|
+  // track to start with, or -1 for the default.
+  int TakeInitialStream(DashFrameType type);
+  int SetViewportSizeImpl(int width, int height);
+  int SetDecoderLimitsImpl(int max_width, int max_height, float max_frame_rate);
+  int ReportRenderedFramesImpl(int rendered_frames, int dropped_frames);
+
+  // Returns the period that holds the reader position, or null before the
+  // manifest has loaded.
+  const mpd::Period* GetCurrentPeriod() const;
+  // Returns the track delivering |type| samples, or null if there is none.
+  TrackContext* GetActiveTrack(DashFrameType type);
+  // Returns the number of the stream |track| delivers in |period|, or -1.
+  static int GetStreamNumber(const TrackContext& track,
+                             const mpd::Period& period);
+  // Makes the stream switches requested for tracks not in the middle of
+  // delivering a sample.
+  void ApplyStreamSwitches();
+  // Switches |track| to |stream|, taking a standby track's place if there
+  // is one for it, otherwise reloading the track from the new stream.
+  void SwitchStream(TrackContext* track, int stream);
+  // Enables and starts |track| again at |position_us| once it has been
+  // disabled to switch streams, unless the player is unloading or changing
+  // the playback rate, which enables it again later itself.
+  void ReenableTrack(TrackContext* track, int64_t position_us);
 
   // Disables the current tracks after a rate change.
   void SetPlaybackRateDisableTracks(float target_rate);
@@ -284,6 +415,14 @@ class DashThread : public base::Thread,
   // This value is used to shift the pts values so that the stream always
   // appears to start at time 0 to the client.
   int64_t GetSampleOffsetMs();
+  // Sets |time| to the wall-clock time at which the media at
+  // |decoder_time_ms| on the decoder's clock became available at the live
+  // edge: the availability start time, plus the start of its period, plus
+  // its media time less the presentationTimeOffset of the representation
+  // being played. The media time is measured from the last video sample
+  // handed to the decoder. Returns false if the manifest has no availability
+  // start time or no video sample has been handed over.
+  bool GetWallClockTime(int64_t decoder_time_ms, base::Time* time);
 
   // Unless stated otherwise, all private member variables are accessed
   // exclusively by the DashThread.
@@ -309,12 +448,24 @@ class DashThread : public base::Thread,
   // is_eos_ is accessed by both the media thread and dash thread.
   std::atomic<bool> is_eos_;
 
+  // Shared loader/network threads, or null when each track gets its own.
+  upstream::LoaderPool* loader_pool_ = nullptr;
   std::unique_ptr<ManifestFetcher> manifest_fetcher_;
   std::unique_ptr<upstream::AllocatorInterface> allocator_;
   std::unique_ptr<LoadControl> load_control_;
   PlaybackRate playback_rate_;
 
   std::unique_ptr<upstream::DefaultBandwidthMeter> media_bandwidth_meter_;
+  // What the client reports about showing video, which limits the formats
+  // the video evaluator chooses.
+  chunk::RenderFeedback render_feedback_;
+  // Throughput and failures per host, for choosing between the base URLs of
+  // a representation.
+  upstream::HostStats host_stats_;
+  // Set when the session-state-dir attribute is.
+  std::unique_ptr<SessionStateStore> session_state_;
+  // Set when the network-record-file or network-replay-file attribute is.
+  std::unique_ptr<upstream::NetworkTrace> network_trace_;
 
   // True when the decoder media time is valid. This is false at initial start
   // and when seeking.
@@ -325,6 +476,18 @@ class DashThread : public base::Thread,
   int64_t decoder_media_time_last_value_ms_;
   // Keeps track of the last value returned from UpdateMediaTime helper.
   int64_t media_time_last_value_ms_;
+  // Set for live streams when a target latency was requested.
+  std::unique_ptr<LiveLatencyController> live_latency_controller_;
+  // The last video sample handed to the decoder while there is a latency
+  // controller: its time on the decoder's clock and on the sample timeline.
+  bool has_video_anchor_ = false;
+  int64_t video_anchor_decoder_us_ = 0;
+  int64_t video_anchor_sample_us_ = 0;
+  // Settings from the thread-<role> attributes. Roles they don't set follow
+  // ndash_set_thread_config().
+  util::ThreadConfig thread_config_;
+  // What this thread started with, for settings thread_config_ leaves out.
+  util::ThreadOptions inherited_thread_options_;
   // Holds callback functions into the decoder.
   DashPlayerCallbacks player_callbacks_;
   // license_fetcher_ is accessed by the DrmSessionManager's worker thread.
@@ -345,9 +508,17 @@ class DashThread : public base::Thread,
   std::vector<int> scratch_enc_bytes_;
 
   std::list<TrackContext> tracks_;
+  // Stream switches waiting for a track to finish delivering a sample, by
+  // track type.
+  std::map<DashFrameType, int> pending_stream_switches_;
 
   base::WaitableEvent unload_waiter_;
   base::WaitableEvent codec_waiter_;
+  // Pending LoadAsync() callback, and the number of LoadAsync() and Unload()
+  // calls made so far, which tells a timeout which load it belongs to.
+  base::Lock loaded_func_lock_;
+  DashPlayerLoadedFunc loaded_func_ = nullptr;
+  uint64_t load_generation_ = 0;
   base::WaitableEvent playback_rate_waiter_;
 
   int64_t sample_offset_ms_;
@@ -0,0 +1,204 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "drm/cdm_session_cache.h"
+
+#include <algorithm>
+
+#include "base/lazy_instance.h"
+#include "base/logging.h"
+#include "base/memory/ptr_util.h"
+#include "base/time/default_tick_clock.h"
+#include "base/trace_event/trace_event.h"
+
+namespace ndash {
+namespace drm {
+
+namespace {
+base::LazyInstance<CdmSessionCache>::Leaky g_cache = LAZY_INSTANCE_INITIALIZER;
+}  // namespace
+
+constexpr int64_t CdmSessionCache::kDefaultExpirySeconds;
+
+// static
+CdmSessionCache* CdmSessionCache::GetInstance() {
+  return g_cache.Pointer();
+}
+
+CdmSessionCache::CdmSessionCache()
+    : CdmSessionCache(base::WrapUnique(new base::DefaultTickClock)) {}
+
+CdmSessionCache::CdmSessionCache(std::unique_ptr<base::TickClock> clock)
+    : clock_(std::move(clock)),
+      fetched_(&lock_),
+      expiry_(base::TimeDelta::FromSeconds(kDefaultExpirySeconds)) {}
+
+CdmSessionCache::~CdmSessionCache() {
+  DCHECK_EQ(0, cdms_);
+}
+
+void CdmSessionCache::SetExpiry(base::TimeDelta expiry) {
+  base::AutoLock auto_lock(lock_);
+  expiry_ = expiry;
+}
+
+void CdmSessionCache::AddCdm(CdmInterface* cdm) {
+  base::AutoLock auto_lock(lock_);
+  cdms_++;
+}
+
+void CdmSessionCache::RemoveCdm(CdmInterface* cdm) {
+  std::vector<std::string> idle;
+  {
+    base::AutoLock auto_lock(lock_);
+    DCHECK_GT(cdms_, 0);
+    // Nobody would be left to close the sessions later.
+    idle = TakeIdle(--cdms_ == 0);
+  }
+  CloseSessions(idle, cdm);
+}
+
+std::string CdmSessionCache::Acquire(const std::string& pssh,
+                                     CdmInterface* cdm) {
+  std::vector<std::string> idle;
+  {
+    base::AutoLock auto_lock(lock_);
+    idle = TakeIdle(false);
+  }
+  CloseSessions(idle, cdm);
+
+  base::AutoLock auto_lock(lock_);
+  Session* session;
+  while ((session = Find(pssh)) && session->fetching) {
+    TRACE_EVENT0("ndash", "CdmSessionCache::WaitForFetch");
+    fetched_.Wait();
+  }
+  if (session) {
+    VLOG(1) << "Joining cdm session " << session->session_id;
+    session->refs++;
+    return session->session_id;
+  }
+
+  session = new Session;
+  session->pssh = pssh;
+  session->refs = 1;
+  sessions_.emplace_back(session);
+
+  std::string session_id;
+  bool ok;
+  {
+    base::AutoUnlock auto_unlock(lock_);
+    ok = cdm->OpenSession(&session_id);
+    if (ok && !cdm->FetchLicense(session_id, pssh)) {
+      cdm->CloseSession(session_id);
+      ok = false;
+    }
+  }
+
+  fetched_.Broadcast();
+  if (!ok) {
+    // Whoever was waiting for it tries for themselves.
+    sessions_.erase(std::find_if(sessions_.begin(), sessions_.end(),
+                                 [session](const std::unique_ptr<Session>& s) {
+                                   return s.get() == session;
+                                 }));
+    return std::string();
+  }
+  VLOG(1) << "Opened cdm session " << session_id;
+  session->session_id = session_id;
+  session->fetching = false;
+  session->expires = clock_->NowTicks() + expiry_;
+  return session_id;
+}
+
+void CdmSessionCache::Release(const std::string& session_id,
+                              CdmInterface* cdm) {
+  std::vector<std::string> idle;
+  {
+    base::AutoLock auto_lock(lock_);
+    auto it = std::find_if(sessions_.begin(), sessions_.end(),
+                           [&session_id](const std::unique_ptr<Session>& s) {
+                             return !s->fetching &&
+                                    s->session_id == session_id;
+                           });
+    if (it == sessions_.end()) {
+      LOG(ERROR) << "Releasing unknown cdm session " << session_id;
+      return;
+    }
+    DCHECK_GT((*it)->refs, 0);
+    (*it)->refs--;
+    idle = TakeIdle(false);
+  }
+  CloseSessions(idle, cdm);
+}
+
+bool CdmSessionCache::Prefetch(const std::string& pssh, CdmInterface* cdm) {
+  std::string session_id = Acquire(pssh, cdm);
+  if (session_id.empty()) {
+    return false;
+  }
+  Release(session_id, cdm);
+  return true;
+}
+
+size_t CdmSessionCache::GetSessionCount() const {
+  base::AutoLock auto_lock(lock_);
+  return std::count_if(
+      sessions_.begin(), sessions_.end(),
+      [](const std::unique_ptr<Session>& s) { return !s->fetching; });
+}
+
+CdmSessionCache::Session* CdmSessionCache::Find(const std::string& pssh) const {
+  base::TimeTicks now = clock_->NowTicks();
+  for (const std::unique_ptr<Session>& session : sessions_) {
+    if (session->pssh == pssh &&
+        (session->fetching || now < session->expires)) {
+      return session.get();
+    }
+  }
+  return nullptr;
+}
+
+std::vector<std::string> CdmSessionCache::TakeIdle(bool all) {
+  lock_.AssertAcquired();
+  std::vector<std::string> idle;
+  base::TimeTicks now = clock_->NowTicks();
+  auto it = sessions_.begin();
+  while (it != sessions_.end()) {
+    Session* session = it->get();
+    if (session->fetching || session->refs > 0 ||
+        (!all && now < session->expires)) {
+      ++it;
+      continue;
+    }
+    idle.push_back(session->session_id);
+    it = sessions_.erase(it);
+  }
+  return idle;
+}
+
+// static
+void CdmSessionCache::CloseSessions(const std::vector<std::string>& session_ids,
+                                    CdmInterface* cdm) {
+  for (const std::string& session_id : session_ids) {
+    VLOG(1) << "Closing cdm session " << session_id;
+    cdm->CloseSession(session_id);
+  }
+}
+
+}  // namespace drm
+}  // namespace ndash
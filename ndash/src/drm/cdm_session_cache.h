@@ -0,0 +1,130 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef NDASH_DRM_CDM_SESSION_CACHE_H_
+#define NDASH_DRM_CDM_SESSION_CACHE_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/synchronization/condition_variable.h"
+#include "base/synchronization/lock.h"
+#include "base/time/tick_clock.h"
+#include "base/time/time.h"
+
+namespace ndash {
+namespace drm {
+
+// What the cache needs of a player's CDM.
+class CdmInterface {
+ public:
+  virtual ~CdmInterface() {}
+
+  // Opens a session, returning false on failure.
+  virtual bool OpenSession(std::string* session_id) = 0;
+  // Fetches the license for |pssh| into |session_id|, returning false on
+  // failure.
+  virtual bool FetchLicense(const std::string& session_id,
+                            const std::string& pssh) = 0;
+  virtual void CloseSession(const std::string& session_id) = 0;
+};
+
+// Shares CDM sessions, and the licenses fetched into them, between the
+// players of a process, so that a player starting on content another one
+// holds (or held recently) joins that session instead of making a license
+// round trip of its own. This assumes the players share one CDM.
+//
+// Sessions are keyed by PSSH box, which carries the key IDs. Each is counted
+// by the players using it, and kept after the last one lets go until it
+// expires, so that switching back to a channel, or to one whose license was
+// prefetched, is immediate. An expired session is not handed out again; a
+// new one is fetched. Sessions are opened and closed through the CDM of the
+// player asking or releasing, and those still open when the last player
+// goes are closed through its CDM. Safe to use from any thread.
+class CdmSessionCache {
+ public:
+  constexpr static int64_t kDefaultExpirySeconds = 10 * 60;
+
+  // Returns the cache shared by all players.
+  static CdmSessionCache* GetInstance();
+
+  CdmSessionCache();
+  // Expanded constructor with dependency injection for testing
+  explicit CdmSessionCache(std::unique_ptr<base::TickClock> clock);
+  ~CdmSessionCache();
+
+  // Sets how long after its license is fetched a session is handed out.
+  void SetExpiry(base::TimeDelta expiry);
+
+  // Players using the cache add their CDM before their first Acquire() and
+  // remove it once they have released everything.
+  void AddCdm(CdmInterface* cdm);
+  void RemoveCdm(CdmInterface* cdm);
+
+  // Returns a session with the license for |pssh|, fetching it through |cdm|
+  // if there is none. If another player is fetching it, waits for that.
+  // Returns an empty string on failure. Each session returned must be
+  // released.
+  std::string Acquire(const std::string& pssh, CdmInterface* cdm);
+  void Release(const std::string& session_id, CdmInterface* cdm);
+
+  // Fetches the license for |pssh| through |cdm| ahead of time, unless there
+  // is one, for a player to join before it expires. Returns false on failure.
+  bool Prefetch(const std::string& pssh, CdmInterface* cdm);
+
+  // Returns the number of sessions open, for tests.
+  size_t GetSessionCount() const;
+
+  CdmSessionCache(const CdmSessionCache& other) = delete;
+  CdmSessionCache& operator=(const CdmSessionCache& other) = delete;
+
+ private:
+  struct Session {
+    std::string pssh;
+    // Empty until the license is fetched.
+    std::string session_id;
+    bool fetching = true;
+    int refs = 0;
+    base::TimeTicks expires;
+  };
+
+  // Returns the session for |pssh| that may be handed out, or null. Called
+  // with |lock_| held.
+  Session* Find(const std::string& pssh) const;
+  // Removes the sessions nobody uses that have expired, or all of them if
+  // |all|, and returns their ids for CloseSessions(). Called with |lock_|
+  // held.
+  std::vector<std::string> TakeIdle(bool all);
+  // Closes |session_ids| with |cdm|. Called without |lock_| held, so that a
+  // slow CDM doesn't hold up every other player.
+  static void CloseSessions(const std::vector<std::string>& session_ids,
+                            CdmInterface* cdm);
+
+  const std::unique_ptr<base::TickClock> clock_;
+
+  mutable base::Lock lock_;  // Protects everything below
+  base::ConditionVariable fetched_;  // Signalled when a fetch finishes
+  base::TimeDelta expiry_;
+  int cdms_ = 0;
+  std::vector<std::unique_ptr<Session>> sessions_;
+};
+
+}  // namespace drm
+}  // namespace ndash
+
+#endif  // NDASH_DRM_CDM_SESSION_CACHE_H_
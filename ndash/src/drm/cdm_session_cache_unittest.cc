@@ -0,0 +1,255 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "drm/cdm_session_cache.h"
+
+#include <memory>
+#include <set>
+#include <string>
+
+#include "base/bind.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/synchronization/lock.h"
+#include "base/synchronization/waitable_event.h"
+#include "base/test/simple_test_tick_clock.h"
+#include "base/threading/thread.h"
+#include "base/time/time.h"
+#include "gtest/gtest.h"
+
+namespace ndash {
+namespace drm {
+
+namespace {
+// The sessions open in the CDM the players share.
+struct Sessions {
+  base::Lock lock;
+  std::set<std::string> open;
+  int next = 1;
+};
+
+// A player's view of the shared CDM, counting the licenses fetched through
+// it. Fetches block while |block_fetch| is set (until |unblock| is
+// signalled), and fail while |fail_fetch| is. Closing a session calls back
+// into |cache|, if set, as a CDM may when it reports the closed session.
+class FakeCdm : public CdmInterface {
+ public:
+  explicit FakeCdm(Sessions* sessions)
+      : sessions(sessions), fetch_started(true, false), unblock(true, false) {}
+
+  bool OpenSession(std::string* session_id) override {
+    base::AutoLock auto_lock(sessions->lock);
+    *session_id = "session" + base::IntToString(sessions->next++);
+    sessions->open.insert(*session_id);
+    return true;
+  }
+
+  bool FetchLicense(const std::string& session_id,
+                    const std::string& pssh) override {
+    fetch_started.Signal();
+    if (block_fetch) {
+      unblock.Wait();
+    }
+    base::AutoLock auto_lock(sessions->lock);
+    fetches++;
+    return !fail_fetch;
+  }
+
+  void CloseSession(const std::string& session_id) override {
+    if (cache) {
+      cache->GetSessionCount();
+    }
+    base::AutoLock auto_lock(sessions->lock);
+    EXPECT_EQ(1u, sessions->open.erase(session_id));
+  }
+
+  Sessions* const sessions;
+  CdmSessionCache* cache = nullptr;
+  int fetches = 0;
+  bool block_fetch = false;
+  bool fail_fetch = false;
+  base::WaitableEvent fetch_started;
+  base::WaitableEvent unblock;
+};
+
+void AcquireInto(CdmSessionCache* cache,
+                 CdmInterface* cdm,
+                 std::string* session_id) {
+  *session_id = cache->Acquire("pssh", cdm);
+}
+}  // namespace
+
+class CdmSessionCacheTest : public ::testing::Test {
+ protected:
+  CdmSessionCacheTest()
+      : clock_(new base::SimpleTestTickClock),
+        cache_(std::unique_ptr<base::TickClock>(clock_)),
+        cdm_a_(&sessions_),
+        cdm_b_(&sessions_) {
+    cache_.AddCdm(&cdm_a_);
+    cache_.AddCdm(&cdm_b_);
+  }
+
+  Sessions sessions_;
+  base::SimpleTestTickClock* clock_;
+  CdmSessionCache cache_;
+  FakeCdm cdm_a_;
+  FakeCdm cdm_b_;
+};
+
+TEST_F(CdmSessionCacheTest, SharesSessions) {
+  std::string session_a = cache_.Acquire("pssh1", &cdm_a_);
+  EXPECT_EQ("session1", session_a);
+  EXPECT_EQ(1, cdm_a_.fetches);
+
+  // Another player joins the session instead of fetching.
+  EXPECT_EQ(session_a, cache_.Acquire("pssh1", &cdm_b_));
+  EXPECT_EQ(0, cdm_b_.fetches);
+
+  std::string session_b = cache_.Acquire("pssh2", &cdm_b_);
+  EXPECT_NE(session_a, session_b);
+  EXPECT_EQ(1, cdm_b_.fetches);
+  EXPECT_EQ(2u, cache_.GetSessionCount());
+
+  // Unused sessions are kept until they expire.
+  cache_.Release(session_a, &cdm_a_);
+  cache_.Release(session_a, &cdm_b_);
+  EXPECT_EQ(2u, cache_.GetSessionCount());
+  EXPECT_EQ(session_a, cache_.Acquire("pssh1", &cdm_b_));
+  cache_.Release(session_a, &cdm_b_);
+
+  clock_->Advance(
+      base::TimeDelta::FromSeconds(CdmSessionCache::kDefaultExpirySeconds));
+  cache_.Release(session_b, &cdm_b_);
+  EXPECT_EQ(0u, cache_.GetSessionCount());
+  EXPECT_EQ(0u, sessions_.open.size());
+
+  cache_.RemoveCdm(&cdm_a_);
+  cache_.RemoveCdm(&cdm_b_);
+}
+
+TEST_F(CdmSessionCacheTest, Expiry) {
+  cache_.SetExpiry(base::TimeDelta::FromSeconds(60));
+  std::string old_session = cache_.Acquire("pssh", &cdm_a_);
+  clock_->Advance(base::TimeDelta::FromSeconds(60));
+
+  // An expired session isn't handed out, even while it's used.
+  std::string new_session = cache_.Acquire("pssh", &cdm_b_);
+  EXPECT_NE(old_session, new_session);
+  EXPECT_EQ(1, cdm_b_.fetches);
+  EXPECT_EQ(2u, cache_.GetSessionCount());
+
+  // It's closed once nobody uses it.
+  cache_.Release(old_session, &cdm_a_);
+  EXPECT_EQ(1u, cache_.GetSessionCount());
+  EXPECT_EQ(0u, sessions_.open.count(old_session));
+
+  // The last player to go closes what is left.
+  cache_.Release(new_session, &cdm_b_);
+  cache_.RemoveCdm(&cdm_a_);
+  EXPECT_EQ(1u, cache_.GetSessionCount());
+  cache_.RemoveCdm(&cdm_b_);
+  EXPECT_EQ(0u, cache_.GetSessionCount());
+  EXPECT_EQ(0u, sessions_.open.size());
+}
+
+TEST_F(CdmSessionCacheTest, ClosesWithoutLock) {
+  cdm_a_.cache = &cache_;
+  cdm_b_.cache = &cache_;
+  cache_.SetExpiry(base::TimeDelta::FromSeconds(60));
+  std::string session = cache_.Acquire("pssh1", &cdm_a_);
+  cache_.Release(session, &cdm_a_);
+  clock_->Advance(base::TimeDelta::FromSeconds(60));
+
+  // Each of these closes a session.
+  session = cache_.Acquire("pssh2", &cdm_a_);
+  EXPECT_EQ(1u, sessions_.open.size());
+  cache_.Release(session, &cdm_a_);
+  clock_->Advance(base::TimeDelta::FromSeconds(60));
+  cache_.Release(cache_.Acquire("pssh3", &cdm_b_), &cdm_b_);
+  EXPECT_EQ(1u, sessions_.open.size());
+  cache_.RemoveCdm(&cdm_a_);
+  cache_.RemoveCdm(&cdm_b_);
+  EXPECT_EQ(0u, sessions_.open.size());
+}
+
+TEST_F(CdmSessionCacheTest, JoinsFetchInProgress) {
+  cdm_a_.block_fetch = true;
+  std::string session_a;
+  base::Thread thread("fetch");
+  thread.Start();
+  thread.task_runner()->PostTask(
+      FROM_HERE, base::Bind(&AcquireInto, base::Unretained(&cache_),
+                            base::Unretained(&cdm_a_),
+                            base::Unretained(&session_a)));
+  cdm_a_.fetch_started.Wait();
+
+  std::string session_b;
+  base::Thread waiter("wait");
+  waiter.Start();
+  waiter.task_runner()->PostTask(
+      FROM_HERE, base::Bind(&AcquireInto, base::Unretained(&cache_),
+                            base::Unretained(&cdm_b_),
+                            base::Unretained(&session_b)));
+  cdm_a_.unblock.Signal();
+  thread.Stop();
+  waiter.Stop();
+
+  EXPECT_FALSE(session_a.empty());
+  EXPECT_EQ(session_a, session_b);
+  EXPECT_EQ(1, cdm_a_.fetches);
+  EXPECT_EQ(0, cdm_b_.fetches);
+
+  cache_.Release(session_a, &cdm_a_);
+  cache_.Release(session_b, &cdm_b_);
+  cache_.RemoveCdm(&cdm_a_);
+  cache_.RemoveCdm(&cdm_b_);
+}
+
+TEST_F(CdmSessionCacheTest, Failure) {
+  cdm_a_.fail_fetch = true;
+  EXPECT_EQ("", cache_.Acquire("pssh", &cdm_a_));
+  EXPECT_EQ(0u, cache_.GetSessionCount());
+  EXPECT_EQ(0u, sessions_.open.size());
+  EXPECT_FALSE(cache_.Prefetch("pssh", &cdm_a_));
+
+  // The next player tries again.
+  std::string session = cache_.Acquire("pssh", &cdm_b_);
+  EXPECT_FALSE(session.empty());
+
+  cache_.Release(session, &cdm_b_);
+  cache_.RemoveCdm(&cdm_a_);
+  cache_.RemoveCdm(&cdm_b_);
+}
+
+TEST_F(CdmSessionCacheTest, Prefetch) {
+  EXPECT_TRUE(cache_.Prefetch("pssh", &cdm_a_));
+  EXPECT_EQ(1u, cache_.GetSessionCount());
+  EXPECT_TRUE(cache_.Prefetch("pssh", &cdm_a_));
+  EXPECT_EQ(1, cdm_a_.fetches);
+
+  std::string session = cache_.Acquire("pssh", &cdm_b_);
+  EXPECT_EQ("session1", session);
+  EXPECT_EQ(0, cdm_b_.fetches);
+
+  cache_.Release(session, &cdm_b_);
+  cache_.RemoveCdm(&cdm_a_);
+  cache_.RemoveCdm(&cdm_b_);
+  EXPECT_EQ(0u, sessions_.open.size());
+}
+
+}  // namespace drm
+}  // namespace ndash
@@ -19,6 +19,8 @@
 #include "base/bind.h"
 #include "base/location.h"
 #include "base/logging.h"
+#include "base/trace_event/trace_event.h"
+#include "util/thread_config.h"
 
 namespace ndash {
 namespace drm {
@@ -29,7 +31,8 @@ DrmSessionManager::DrmSessionManager(
     : context_ptr_(context_ptr),
       decoder_callbacks_(decoder_callbacks),
       worker_thread_("CdmSessionThread") {
-  worker_thread_.Start();
+  util::ThreadConfig::GetInstance()->StartThread(
+      util::ThreadRole::DRM, &worker_thread_, &inherited_thread_options_);
 }
 
 DrmSessionManager::~DrmSessionManager() {
@@ -37,39 +40,41 @@ DrmSessionManager::~DrmSessionManager() {
   for (auto iter = pssh_sessions_.begin(); iter != pssh_sessions_.end();
        ++iter) {
     CdmSessionContext* context = iter->second.get();
-    std::string session_id = context->cdm_session_id_;
-    // TODO(rmrossi): Why is CloseCdmSessionFunc not const char*?
-    DashCdmStatus status = decoder_callbacks_->close_cdm_session_func(
-        GetContext(), const_cast<char*>(session_id.c_str()),
-        session_id.length());
-    if (status != DASH_CDM_SUCCESS) {
-      LOG(ERROR) << "Failed to close cdm session " << session_id;
+    if (context->cdm_session_id_.empty()) {
+      continue;
+    }
+    if (session_cache_) {
+      session_cache_->Release(context->cdm_session_id_, this);
     } else {
-      LOG(INFO) << "Closed cdm session " << session_id;
+      CloseSession(context->cdm_session_id_);
     }
   }
+  if (session_cache_) {
+    session_cache_->RemoveCdm(this);
+  }
 }
 
-void DrmSessionManager::Request(const char* pssh_data, size_t pssh_len) {
+bool DrmSessionManager::SetSessionCache(CdmSessionCache* session_cache) {
   base::AutoLock lock(lock_);
-  std::string pssh(pssh_data, pssh_len);
-
-  // Sanity checks.
-  if (decoder_callbacks_ == nullptr) {
-    LOG(ERROR) << "DrmSessionManager::SetDecoderCallbacks was not called";
-    return;
+  if (!pssh_sessions_.empty() || pending_prefetches_ > 0) {
+    LOG(ERROR) << "Sessions were requested before setting a session cache";
+    return false;
   }
-
-  if (decoder_callbacks_->open_cdm_session_func == nullptr) {
-    LOG(ERROR)
-        << "DrmSessionManager::open_cdm_session_func needs to be set via "
-        << "DashThread::SetDecoderCallbacks";
-    return;
+  if (session_cache_) {
+    session_cache_->RemoveCdm(this);
+  }
+  session_cache_ = session_cache;
+  if (session_cache_) {
+    session_cache_->AddCdm(this);
   }
+  return true;
+}
 
-  if (decoder_callbacks_->fetch_license_func == nullptr) {
-    LOG(ERROR) << "DrmSessionManager::fetch_license_func needs to be set via "
-               << "DashThread::SetDecoderCallbacks";
+void DrmSessionManager::Request(const char* pssh_data, size_t pssh_len) {
+  base::AutoLock lock(lock_);
+  std::string pssh(pssh_data, pssh_len);
+
+  if (!HasCallbacks()) {
     return;
   }
 
@@ -126,7 +131,10 @@ bool DrmSessionManager::Join(const char* pssh_data, size_t pssh_len) {
 
   VLOG(5) << "DrmSessionManager::waiting for in-flight license to finish";
   DCHECK(waitable != nullptr);
-  waitable->Wait();
+  {
+    TRACE_EVENT0("ndash", "DrmSessionManager::WaitForLicense");
+    waitable->Wait();
+  }
   VLOG(5) << "DrmSessionManager::in-flight license request has finished";
 
   // Check whether we got a session.
@@ -144,39 +152,50 @@ bool DrmSessionManager::Join(const char* pssh_data, size_t pssh_len) {
   return false;
 }
 
+bool DrmSessionManager::Prefetch(const char* pssh_data, size_t pssh_len) {
+  if (!HasCallbacks()) {
+    return false;
+  }
+  {
+    base::AutoLock lock(lock_);
+    if (session_cache_) {
+      VLOG(5) << "DrmSessionManager::prefetching license";
+      pending_prefetches_++;
+      worker_thread_.task_runner()->PostTask(
+          FROM_HERE,
+          base::Bind(&DrmSessionManager::RunPrefetch, base::Unretained(this),
+                     base::Unretained(session_cache_),
+                     std::string(pssh_data, pssh_len)));
+      return true;
+    }
+  }
+  // Without a cache the license is only any use to this player.
+  Request(pssh_data, pssh_len);
+  return true;
+}
+
+void DrmSessionManager::ApplyThreadConfig(
+    const util::ThreadConfig* thread_config) {
+  thread_config->Apply(util::ThreadRole::DRM, &worker_thread_,
+                       inherited_thread_options_);
+}
+
 void DrmSessionManager::Run(CdmSessionContext* session_context,
                             const std::string& pssh) {
-  char* session_id;
-  size_t session_id_len;
-  DashCdmStatus status;
-
   // TODO(rmrossi): Add some retry logic here. Make number of retries or
   // total time elapsed before giving up configurable.  Make sure license
   // fetcher has a short timeout too (15s?)
 
   VLOG(5) << "DrmSessionManager::begin cdm license request";
-  status = decoder_callbacks_->open_cdm_session_func(GetContext(), &session_id,
-                                                     &session_id_len);
-  // Take ownership of session_id storage and free it before we return.
-  std::unique_ptr<char, decltype(free)*> owned_session_id(session_id, free);
-
   std::string session_id_str;
-
-  if (status != DASH_CDM_SUCCESS) {
-    LOG(ERROR) << "DrmSessionManager::failed top open cdm session";
-    // Fall through to signal waitable with no session indicating failure.
-  } else {
-    session_id_str = std::string(session_id, session_id_len);
-    status = decoder_callbacks_->fetch_license_func(
-        GetContext(), session_id, session_id_len, pssh.c_str(), pssh.length());
-    if (status != DASH_CDM_SUCCESS) {
-      LOG(ERROR) << "DrmSessionManager::failed to fetch license";
-      decoder_callbacks_->close_cdm_session_func(GetContext(), session_id,
-                                                 session_id_len);
-      session_id_str.clear();
-      // Fall through to signal waitable with no session indicating failure.
-    }
+  if (session_cache_) {
+    session_id_str = session_cache_->Acquire(pssh, this);
+  } else if (OpenSession(&session_id_str) &&
+             !FetchLicense(session_id_str, pssh)) {
+    CloseSession(session_id_str);
+    session_id_str.clear();
   }
+  // An empty session signals the waitable with failure.
 
   VLOG(5) << "DrmSessionManager::end cdm license request";
   {
@@ -186,6 +205,78 @@ void DrmSessionManager::Run(CdmSessionContext* session_context,
     session_context->waitable_->Signal();
   }
 }
+
+void DrmSessionManager::RunPrefetch(CdmSessionCache* session_cache,
+                                    const std::string& pssh) {
+  if (!session_cache->Prefetch(pssh, this)) {
+    LOG(WARNING) << "DrmSessionManager::failed to prefetch license";
+  }
+  base::AutoLock lock(lock_);
+  pending_prefetches_--;
+}
+
+bool DrmSessionManager::OpenSession(std::string* session_id) {
+  char* session_id_data;
+  size_t session_id_len;
+  DashCdmStatus status = decoder_callbacks_->open_cdm_session_func(
+      GetContext(), &session_id_data, &session_id_len);
+  if (status != DASH_CDM_SUCCESS) {
+    LOG(ERROR) << "DrmSessionManager::failed top open cdm session";
+    return false;
+  }
+  // Take ownership of session_id storage and free it before we return.
+  std::unique_ptr<char, decltype(free)*> owned_session_id(session_id_data,
+                                                          free);
+  *session_id = std::string(session_id_data, session_id_len);
+  return true;
+}
+
+bool DrmSessionManager::FetchLicense(const std::string& session_id,
+                                     const std::string& pssh) {
+  DashCdmStatus status = decoder_callbacks_->fetch_license_func(
+      GetContext(), session_id.c_str(), session_id.length(), pssh.c_str(),
+      pssh.length());
+  if (status != DASH_CDM_SUCCESS) {
+    LOG(ERROR) << "DrmSessionManager::failed to fetch license";
+    return false;
+  }
+  return true;
+}
+
+void DrmSessionManager::CloseSession(const std::string& session_id) {
+  // TODO(rmrossi): Why is CloseCdmSessionFunc not const char*?
+  DashCdmStatus status = decoder_callbacks_->close_cdm_session_func(
+      GetContext(), const_cast<char*>(session_id.c_str()),
+      session_id.length());
+  if (status != DASH_CDM_SUCCESS) {
+    LOG(ERROR) << "Failed to close cdm session " << session_id;
+  } else {
+    LOG(INFO) << "Closed cdm session " << session_id;
+  }
+}
+
+bool DrmSessionManager::HasCallbacks() const {
+  // Sanity checks.
+  if (decoder_callbacks_ == nullptr) {
+    LOG(ERROR) << "DrmSessionManager::SetDecoderCallbacks was not called";
+    return false;
+  }
+
+  if (decoder_callbacks_->open_cdm_session_func == nullptr) {
+    LOG(ERROR)
+        << "DrmSessionManager::open_cdm_session_func needs to be set via "
+        << "DashThread::SetDecoderCallbacks";
+    return false;
+  }
+
+  if (decoder_callbacks_->fetch_license_func == nullptr) {
+    LOG(ERROR) << "DrmSessionManager::fetch_license_func needs to be set via "
+               << "DashThread::SetDecoderCallbacks";
+    return false;
+  }
+  return true;
+}
+
 void* DrmSessionManager::GetContext() const {
   if (context_ptr_) {
     return *context_ptr_;
@@ -23,7 +23,9 @@
 #include "base/synchronization/lock.h"
 #include "base/synchronization/waitable_event.h"
 #include "base/threading/thread.h"
+#include "drm/cdm_session_cache.h"
 #include "ndash.h"
+#include "util/thread_config.h"
 
 namespace ndash {
 
@@ -55,15 +57,30 @@ class DrmSessionManagerInterface {
 };
 
 // An implentation of a DrmSessionManagerInterface
-class DrmSessionManager : public DrmSessionManagerInterface {
+class DrmSessionManager : public DrmSessionManagerInterface,
+                          private CdmInterface {
  public:
   explicit DrmSessionManager(void** context_ptr,
                              const DashPlayerCallbacks* decoder_callbacks);
   ~DrmSessionManager() override;
 
+  // Gets sessions from |session_cache| instead of opening its own, so that
+  // other players' sessions are joined. Returns false (and does nothing) if
+  // sessions have already been requested, or prefetches are still running.
+  bool SetSessionCache(CdmSessionCache* session_cache);
+
   void Request(const char* pssh_data, size_t pssh_len) override;
   bool Join(const char* pssh_data, size_t pssh_len) override;
 
+  // Fetches the license for the given PSSH data in the background, so that a
+  // later Request() finds it: this player's, or with a session cache any
+  // player's until it expires. Returns false on fatal error.
+  bool Prefetch(const char* pssh_data, size_t pssh_len);
+
+  // Applies the settings for DRM threads in |thread_config| to the worker
+  // thread, which is running already.
+  void ApplyThreadConfig(const util::ThreadConfig* thread_config);
+
  private:
   struct CdmSessionContext {
     // A non-empty cdm_session_id_ indicates the CDM already has a license
@@ -77,8 +94,19 @@ class DrmSessionManager : public DrmSessionManagerInterface {
   };
 
   void *GetContext() const;
+  // Whether the callbacks needed to get licenses are set; logs if not.
+  bool HasCallbacks() const;
 
   void Run(CdmSessionContext* session_context, const std::string& pssh);
+  // |session_cache| is the one set when the prefetch was asked for; it
+  // can't change until the prefetch is done.
+  void RunPrefetch(CdmSessionCache* session_cache, const std::string& pssh);
+
+  // CdmInterface (through the decoder callbacks)
+  bool OpenSession(std::string* session_id) override;
+  bool FetchLicense(const std::string& session_id,
+                    const std::string& pssh) override;
+  void CloseSession(const std::string& session_id) override;
 
   void** context_ptr_;
   const DashPlayerCallbacks* decoder_callbacks_;
@@ -87,12 +115,19 @@ class DrmSessionManager : public DrmSessionManagerInterface {
   // with respect to license availability for that PSSH.
   std::map<std::string, std::unique_ptr<CdmSessionContext>> pssh_sessions_;
 
+  // Where sessions come from when they are shared, or null.
+  CdmSessionCache* session_cache_ = nullptr;
+  // Prefetches posted to |worker_thread_| that haven't finished.
+  int pending_prefetches_ = 0;
+
   // TODO(rmrossi): Change this to a base::SequencedWorkerPool and use
   // PostWorkerTask() method so we can fetch licenses in parallel. (Also, make
   // sure that CDM can handle multiple threads calling into it. Might want to
   // have a cdm capabilities flag to ask it how many concurrent threads are
   // allowed so we can configure our pool properly).
   base::Thread worker_thread_;
+  // What |worker_thread_| started with, for settings a player leaves out.
+  util::ThreadOptions inherited_thread_options_;
 
   // Lock to synchronize access.
   base::Lock lock_;
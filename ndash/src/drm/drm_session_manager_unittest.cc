@@ -19,8 +19,10 @@
 #include <string>
 
 #include "base/bind.h"
+#include "base/strings/string_number_conversions.h"
 #include "base/synchronization/waitable_event.h"
 #include "base/threading/thread.h"
+#include "drm/cdm_session_cache.h"
 #include "drm/drm_session_manager_mock.h"
 #include "gtest/gtest.h"
 
@@ -38,11 +40,15 @@ bool block_fetch;
 
 bool got_close_call;
 
+int open_calls;
+
 namespace {
 
 DashCdmStatus OpenCdmSession(void* context, char** session_id, size_t* len) {
-  *session_id = strdup(&kFakeSession[0]);
-  *len = strlen(kFakeSession);
+  // Each session gets its own id.
+  std::string id = kFakeSession + base::IntToString(++open_calls);
+  *session_id = strdup(id.c_str());
+  *len = id.length();
   return DASH_CDM_SUCCESS;
 }
 
@@ -76,6 +82,7 @@ void InitCallbacks(DashPlayerCallbacks* callbacks,
                    bool expect_success,
                    bool block) {
   got_close_call = false;
+  open_calls = 0;
   waitable.Reset();
   callbacks->open_cdm_session_func = &OpenCdmSession;
   callbacks->close_cdm_session_func = &CloseCdmSession;
@@ -158,5 +165,38 @@ TEST(DrmSessionManagerTests, CleanupOnDestroy) {
   EXPECT_EQ(true, got_close_call);
 }
 
+// Tests players with a session cache share their sessions.
+TEST(DrmSessionManagerTests, SharedSessionCache) {
+  std::string pssh = "abcdefg";
+  std::string other_pssh = "hijklmn";
+  DashPlayerCallbacks callbacks;
+  InitCallbacks(&callbacks, true, false);
+  CdmSessionCache cache;
+  {
+    DrmSessionManager first(nullptr /* context */, &callbacks);
+    DrmSessionManager second(nullptr /* context */, &callbacks);
+    EXPECT_TRUE(first.SetSessionCache(&cache));
+    EXPECT_TRUE(second.SetSessionCache(&cache));
+
+    first.Request(pssh.c_str(), pssh.length());
+    EXPECT_TRUE(first.Join(pssh.c_str(), pssh.length()));
+    second.Request(pssh.c_str(), pssh.length());
+    EXPECT_TRUE(second.Join(pssh.c_str(), pssh.length()));
+    EXPECT_EQ(1, open_calls);
+
+    // A license prefetched by one is there for the other.
+    EXPECT_TRUE(first.Prefetch(other_pssh.c_str(), other_pssh.length()));
+    second.Request(other_pssh.c_str(), other_pssh.length());
+    EXPECT_TRUE(second.Join(other_pssh.c_str(), other_pssh.length()));
+    EXPECT_EQ(2, open_calls);
+
+    // Too late to share sessions already requested.
+    EXPECT_FALSE(second.SetSessionCache(nullptr));
+    EXPECT_FALSE(got_close_call);
+  }
+  EXPECT_TRUE(got_close_call);
+  EXPECT_EQ(0u, cache.GetSessionCount());
+}
+
 }  // namespace drm
 }  // namespace ndash
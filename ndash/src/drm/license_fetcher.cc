@@ -19,6 +19,7 @@
 #include <memory>
 #include <string>
 
+#include "base/trace_event/trace_event.h"
 #include "upstream/constants.h"
 #include "upstream/data_spec.h"
 #include "upstream/http_data_source.h"
@@ -55,6 +56,7 @@ void LicenseFetcher::UpdateAuthToken(const std::string& auth_token) {
 bool LicenseFetcher::Fetch(const std::string& key_message,
                            std::string* out_license) {
   DCHECK(out_license != nullptr);
+  TRACE_EVENT0("ndash", "LicenseFetcher::Fetch");
   base::AutoLock fetch_autolock(fetch_lock_);
 
   upstream::Uri license_uri("");
@@ -61,6 +61,10 @@ int32_t DefaultTrackOutput::GetReadIndex() const {
   return rolling_buffer_.GetReadIndex();
 }
 
+size_t DefaultTrackOutput::GetBytesAllocated() const {
+  return rolling_buffer_.GetBytesAllocated();
+}
+
 bool DefaultTrackOutput::HasFormat() const {
   return format_ != nullptr;
 }
@@ -94,9 +98,7 @@ bool DefaultTrackOutput::GetSample(SampleHolder* holder) {
 }
 
 void DefaultTrackOutput::DiscardUntil(int64_t time_us) {
-  while (rolling_buffer_.PeekSample(&sample_info_holder_) &&
-         sample_info_holder_.GetTimeUs() < time_us) {
-    rolling_buffer_.SkipSample();
+  if (rolling_buffer_.DiscardUntil(time_us)) {
     // We're discarding one or more samples. A subsequent read will need to
     // start at a keyframe.
     need_key_frame_ = true;
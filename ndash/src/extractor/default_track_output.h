@@ -60,6 +60,10 @@ class DefaultTrackOutput : public IndexedTrackOutputInterface {
   // Returns the current absolute read index.
   int32_t GetReadIndex() const;
 
+  // Returns the size of the allocations holding sample data. May be called
+  // from any thread.
+  size_t GetBytesAllocated() const;
+
   // Returns true if the output has received a format. False otherwise.
   bool HasFormat() const;
 
@@ -20,6 +20,8 @@
 #include <cstdint>
 #include <cstdlib>
 
+#include "upstream/constants.h"
+
 namespace ndash {
 namespace extractor {
 
@@ -40,6 +42,16 @@ class ExtractorInputInterface {
   //   - RESULT_IO_ERROR if there is an error
   virtual ssize_t Read(void* target, size_t length) = 0;
 
+  // Whether ReadView() can be used instead of Read().
+  virtual bool CanReadView() const { return false; }
+
+  // Like Read(), but points |*data| at up to 'length' bytes held by the
+  // input rather than copying them. They stay valid until the next call on
+  // the input.
+  virtual ssize_t ReadView(const void** data, size_t length) {
+    return upstream::RESULT_IO_ERROR;
+  }
+
   // Like Read(), but reads the requested 'length' in full.
   // If the end of the input is found having read no data, then behavior is
   // dependent on 'end_of_input'. If end_of_input == null then false is
@@ -15,16 +15,25 @@
  */
 #include "info_queue.h"
 
+#include <iterator>
+#include <limits>
+
 namespace ndash {
 
 namespace extractor {
 
+namespace {
+constexpr int64_t kNoTime = std::numeric_limits<int64_t>::min();
+}  // namespace
+
 InfoQueue::InfoQueue()
     : capacity_(kSampleCapacityIncrement),
       queue_size_(0),
       absolute_read_index_(0),
       relative_read_index_(0),
-      relative_write_index_(0) {
+      relative_write_index_(0),
+      unordered_keyframes_(0),
+      max_time_us_(kNoTime) {
   offsets_ = std::unique_ptr<int64_t[]>(new int64_t[capacity_]);
   durations_ = std::unique_ptr<int64_t[]>(new int64_t[capacity_]);
   times_us_ = std::unique_ptr<int64_t[]>(new int64_t[capacity_]);
@@ -47,6 +56,9 @@ void InfoQueue::Clear() {
   relative_read_index_ = 0;
   relative_write_index_ = 0;
   queue_size_ = 0;
+  keyframes_.clear();
+  unordered_keyframes_ = 0;
+  max_time_us_ = kNoTime;
 }
 
 int32_t InfoQueue::GetWriteIndex() const {
@@ -73,6 +85,31 @@ int64_t InfoQueue::DiscardUpstreamSamples(int32_t discard_from_index) {
   queue_size_ -= discard_count;
   relative_write_index_ =
       (relative_write_index_ + capacity_ - discard_count) % capacity_;
+
+  while (!keyframes_.empty() &&
+         keyframes_.back().absolute_index >= discard_from_index) {
+    if (!keyframes_.back().ordered) {
+      unordered_keyframes_--;
+    }
+    keyframes_.pop_back();
+  }
+  // Recompute the latest time from the last remaining keyframe on (or from
+  // the read index if there is none; samples already read don't matter).
+  int32_t search_index;
+  if (keyframes_.empty()) {
+    max_time_us_ = kNoTime;
+    search_index = relative_read_index_;
+  } else {
+    max_time_us_ = keyframes_.back().max_time_us;
+    search_index = (relative_read_index_ + keyframes_.back().absolute_index -
+                    absolute_read_index_) %
+                   capacity_;
+  }
+  while (search_index != relative_write_index_) {
+    max_time_us_ = std::max(max_time_us_, times_us_[search_index]);
+    search_index = (search_index + 1) % capacity_;
+  }
+
   return offsets_[relative_write_index_];
 }
 
@@ -118,6 +155,7 @@ int64_t InfoQueue::MoveToNextSample() {
     // Wrap around.
     relative_read_index_ = 0;
   }
+  TrimKeyframesBeforeReadIndex();
   return queue_size_ > 0 ? offsets_[relative_read_index_]
                          : (sizes_[lastReadIndex] + offsets_[lastReadIndex]);
 }
@@ -143,37 +181,49 @@ int64_t InfoQueue::SkipToKeyframeBefore(int64_t time_us) {
     return -1;
   }
 
-  // TODO: This can be optimized further using binary search, although the fact
-  // that the array
-  // is cyclic means we'd need to implement the binary search ourselves.
-  int32_t sample_count = 0;
-  int32_t sample_count_to_key_frame = -1;
-  int32_t search_index = relative_read_index_;
-  while (search_index != relative_write_index_) {
-    if (times_us_[search_index] > time_us) {
-      // We've gone too far.
-      break;
-    } else if ((flags_[search_index] & util::kSampleFlagSync) != 0) {
-      // We've found a keyframe, and we're still before the seek position.
-      sample_count_to_key_frame = sample_count;
-    }
-    search_index = (search_index + 1) % capacity_;
-    sample_count++;
-  }
-
+  int32_t sample_count_to_key_frame = CountToKeyframeBefore(time_us);
   if (sample_count_to_key_frame == -1) {
     VLOG(1) << "Skip failed (couldn't find preceding keyframe)";
     return -1;
   }
 
-  queue_size_ -= sample_count_to_key_frame;
-  relative_read_index_ =
-      (relative_read_index_ + sample_count_to_key_frame) % capacity_;
-  absolute_read_index_ += sample_count_to_key_frame;
+  AdvanceReadIndex(sample_count_to_key_frame);
   VLOG(1) << "Skip success";
   return offsets_[relative_read_index_];
 }
 
+int64_t InfoQueue::DiscardUntil(int64_t time_us) {
+  base::AutoLock lock(lock_);
+
+  int32_t discard_count = 0;
+  if (IsKeyframeIndexUsable()) {
+    // Everything before a keyframe that is earlier than |time_us| is earlier
+    // too, so the scan can start at the last such keyframe.
+    auto it = std::lower_bound(keyframes_.begin(), keyframes_.end(), time_us,
+                               [](const Keyframe& keyframe, int64_t time_us) {
+                                 return keyframe.time_us < time_us;
+                               });
+    if (it != keyframes_.begin()) {
+      discard_count = std::prev(it)->absolute_index - absolute_read_index_;
+    }
+  }
+  int32_t search_index = (relative_read_index_ + discard_count) % capacity_;
+  while (discard_count < queue_size_ && times_us_[search_index] < time_us) {
+    search_index = (search_index + 1) % capacity_;
+    discard_count++;
+  }
+
+  if (discard_count == 0) {
+    return -1;
+  }
+  int32_t last_discarded_index =
+      (relative_read_index_ + discard_count - 1) % capacity_;
+  AdvanceReadIndex(discard_count);
+  return queue_size_ > 0 ? offsets_[relative_read_index_]
+                         : (sizes_[last_discarded_index] +
+                            offsets_[last_discarded_index]);
+}
+
 void InfoQueue::CommitSample(int64_t time_us,
                              int64_t duration_us,
                              int32_t sample_flags,
@@ -184,6 +234,19 @@ void InfoQueue::CommitSample(int64_t time_us,
                              std::vector<int32_t>* num_bytes_clear,
                              std::vector<int32_t>* num_bytes_enc) {
   base::AutoLock lock(lock_);
+  if ((sample_flags & util::kSampleFlagSync) != 0) {
+    Keyframe keyframe;
+    keyframe.absolute_index = GetWriteIndexInternal();
+    keyframe.time_us = time_us;
+    keyframe.max_time_us = std::max(max_time_us_, time_us);
+    keyframe.ordered = time_us >= max_time_us_;
+    if (!keyframe.ordered) {
+      unordered_keyframes_++;
+    }
+    keyframes_.push_back(keyframe);
+  }
+  max_time_us_ = std::max(max_time_us_, time_us);
+
   times_us_[relative_write_index_] = time_us;
   durations_[relative_write_index_] = duration_us;
   offsets_[relative_write_index_] = offset;
@@ -294,6 +357,64 @@ int32_t InfoQueue::GetWriteIndexInternal() const {
   return absolute_read_index_ + queue_size_;
 }
 
+bool InfoQueue::IsKeyframeIndexUsable() const {
+  lock_.AssertAcquired();
+  return unordered_keyframes_ == 0;
+}
+
+int32_t InfoQueue::CountToKeyframeBefore(int64_t time_us) const {
+  lock_.AssertAcquired();
+  if (IsKeyframeIndexUsable()) {
+    // The index is ordered by time, so the answer is the last keyframe no
+    // later than |time_us|.
+    auto it = std::upper_bound(keyframes_.begin(), keyframes_.end(), time_us,
+                               [](int64_t time_us, const Keyframe& keyframe) {
+                                 return time_us < keyframe.time_us;
+                               });
+    if (it == keyframes_.begin()) {
+      return -1;
+    }
+    return std::prev(it)->absolute_index - absolute_read_index_;
+  }
+
+  // Scan for the last keyframe before the first sample after |time_us|.
+  int32_t sample_count = 0;
+  int32_t sample_count_to_key_frame = -1;
+  int32_t search_index = relative_read_index_;
+  while (sample_count < queue_size_) {
+    if (times_us_[search_index] > time_us) {
+      // We've gone too far.
+      break;
+    } else if ((flags_[search_index] & util::kSampleFlagSync) != 0) {
+      // We've found a keyframe, and we're still before the seek position.
+      sample_count_to_key_frame = sample_count;
+    }
+    search_index = (search_index + 1) % capacity_;
+    sample_count++;
+  }
+  return sample_count_to_key_frame;
+}
+
+void InfoQueue::AdvanceReadIndex(int32_t count) {
+  lock_.AssertAcquired();
+  DCHECK(0 <= count && count <= queue_size_);
+  queue_size_ -= count;
+  relative_read_index_ = (relative_read_index_ + count) % capacity_;
+  absolute_read_index_ += count;
+  TrimKeyframesBeforeReadIndex();
+}
+
+void InfoQueue::TrimKeyframesBeforeReadIndex() {
+  lock_.AssertAcquired();
+  while (!keyframes_.empty() &&
+         keyframes_.front().absolute_index < absolute_read_index_) {
+    if (!keyframes_.front().ordered) {
+      unordered_keyframes_--;
+    }
+    keyframes_.pop_front();
+  }
+}
+
 void InfoQueue::CopyStrings(std::string* dest,
                             int32_t dest_pos,
                             std::string* src,
@@ -18,6 +18,7 @@
 #define NDASH_EXTRACTOR_INFO_QUEUE_H_
 
 #include <algorithm>
+#include <deque>
 #include <memory>
 #include <string>
 
@@ -124,6 +125,13 @@ class InfoQueue {
   // -1 otherwise.
   int64_t SkipToKeyframeBefore(int64_t time_us);
 
+  // Advances the read index past all samples before the first one whose time
+  // is at or after |time_us|.
+  // Returns the absolute position of the first byte in the rolling buffer that
+  // may still be required, as MoveToNextSample() does, or -1 if no samples
+  // were skipped.
+  int64_t DiscardUntil(int64_t time_us);
+
   // Called by the loading thread.
   void CommitSample(int64_t time_us,
                     int64_t duration_us,
@@ -136,8 +144,35 @@ class InfoQueue {
                     std::vector<int32_t>* num_bytes_enc = nullptr);
 
  private:
+  // An entry in the keyframe index.
+  struct Keyframe {
+    int32_t absolute_index;
+    int64_t time_us;
+    // The largest time of the samples committed up to this one, inclusive.
+    int64_t max_time_us;
+    // Whether no sample committed before this one has a later time.
+    bool ordered;
+  };
+
   int32_t GetWriteIndexInternal() const;
 
+  // The keyframe index can only stand in for a scan of the samples while
+  // every keyframe in it is ordered: the samples before such a keyframe are
+  // all no later than it, so whether a scan would reach it depends on its
+  // own time alone. That is the case unless presentation order differs from
+  // decode order across keyframes.
+  bool IsKeyframeIndexUsable() const;
+
+  // Returns the number of samples from the read index to the keyframe that
+  // SkipToKeyframeBefore(|time_us|) should skip to, or -1 if there is none.
+  int32_t CountToKeyframeBefore(int64_t time_us) const;
+
+  // Advances the read index by |count| samples.
+  void AdvanceReadIndex(int32_t count);
+
+  // Removes keyframes behind the read index from the index.
+  void TrimKeyframesBeforeReadIndex();
+
   void CopyStrings(std::string* dest,
                    int32_t dest_pos,
                    std::string* src,
@@ -168,6 +203,14 @@ class InfoQueue {
   int32_t absolute_read_index_;
   int32_t relative_read_index_;
   int32_t relative_write_index_;
+
+  // The keyframes in the queue, in commit order, so that seeks within it take
+  // logarithmic time.
+  std::deque<Keyframe> keyframes_;
+  // The number of |keyframes_| that are not ordered.
+  int32_t unordered_keyframes_;
+  // The largest time of the samples committed (and not discarded upstream).
+  int64_t max_time_us_;
 };
 
 }  // namespace extractor
@@ -16,6 +16,10 @@
 
 #include "extractor/info_queue.h"
 
+#include <algorithm>
+#include <random>
+#include <vector>
+
 #include "gtest/gtest.h"
 #include "sample_holder.h"
 
@@ -23,6 +27,79 @@ namespace ndash {
 
 namespace extractor {
 
+namespace {
+
+// The queue as a plain vector, searched linearly the way InfoQueue used to.
+class LinearInfoQueue {
+ public:
+  struct Sample {
+    int64_t time_us;
+    int32_t flags;
+    int64_t offset;
+    int32_t size;
+  };
+
+  void Clear() {
+    samples_.clear();
+    read_index_ = 0;
+    base_index_ = 0;
+  }
+
+  int32_t GetReadIndex() const { return base_index_ + read_index_; }
+  int32_t GetWriteIndex() const { return base_index_ + samples_.size(); }
+  int32_t size() const { return samples_.size() - read_index_; }
+  const Sample* Peek() const {
+    return size() > 0 ? &samples_[read_index_] : nullptr;
+  }
+
+  void Commit(const Sample& sample) { samples_.push_back(sample); }
+
+  void DiscardUpstreamSamples(int32_t discard_from_index) {
+    samples_.resize(discard_from_index - base_index_);
+  }
+
+  int64_t MoveToNextSample() {
+    const Sample& last = samples_[read_index_++];
+    return size() > 0 ? samples_[read_index_].offset : last.offset + last.size;
+  }
+
+  int64_t SkipToKeyframeBefore(int64_t time_us) {
+    if (size() == 0 || time_us < samples_[read_index_].time_us ||
+        time_us > samples_.back().time_us) {
+      return -1;
+    }
+    int32_t key_frame_index = -1;
+    for (size_t i = read_index_; i < samples_.size(); i++) {
+      if (samples_[i].time_us > time_us) {
+        break;
+      } else if ((samples_[i].flags & util::kSampleFlagSync) != 0) {
+        key_frame_index = i;
+      }
+    }
+    if (key_frame_index == -1) {
+      return -1;
+    }
+    read_index_ = key_frame_index;
+    return samples_[read_index_].offset;
+  }
+
+  int64_t DiscardUntil(int64_t time_us) {
+    int64_t next_offset = -1;
+    while (size() > 0 && samples_[read_index_].time_us < time_us) {
+      next_offset = MoveToNextSample();
+    }
+    return next_offset;
+  }
+
+ private:
+  std::vector<Sample> samples_;
+  int32_t read_index_ = 0;
+  // The absolute index of samples_[0].
+  int32_t base_index_ = 0;
+};
+
+}  // namespace
+
 TEST(InfoQueueTests, PeekBeforeCommit) {
   InfoQueue info_queue;
   SampleHolder sample_holder(true);
@@ -208,6 +285,84 @@ TEST(InfoQueueTests, SkipToKeyframeBefore) {
   EXPECT_EQ(0, info_queue.GetWriteIndex());
 }
 
+TEST(InfoQueueTests, RandomizedAgainstLinearSearch) {
+  std::mt19937 random(42);
+  auto uniform = [&random](int64_t min, int64_t max) {
+    return std::uniform_int_distribution<int64_t>(min, max)(random);
+  };
+
+  InfoQueue info_queue;
+  LinearInfoQueue expected;
+  SampleHolder sample_holder(true);
+  SampleExtrasHolder extras_holder;
+  int64_t next_time_us = 0;
+  int64_t next_offset = 0;
+
+  for (int op = 0; op < 20000; op++) {
+    int64_t choice = uniform(0, 99);
+    if (choice < 35) {
+      // A group of pictures in decode order: a keyframe, then the rest in
+      // shuffled presentation order, as with B-frames. Now and then the
+      // keyframe goes out of order, which the queue has to handle with a
+      // linear search.
+      int32_t length = uniform(1, 30);
+      std::vector<int64_t> times;
+      for (int32_t i = 1; i < length; i++) {
+        times.push_back(next_time_us + i * 1000);
+      }
+      std::shuffle(times.begin(), times.end(), random);
+      int64_t key_time_us = next_time_us;
+      if (uniform(0, 19) == 0) {
+        key_time_us -= uniform(1, 50) * 1000;
+      }
+      times.insert(times.begin(), key_time_us);
+      for (size_t i = 0; i < times.size(); i++) {
+        int32_t flags = i == 0 ? util::kSampleFlagSync : 0;
+        int32_t size = uniform(1, 100);
+        info_queue.CommitSample(times[i], 1000, flags, next_offset, size);
+        expected.Commit({times[i], flags, next_offset, size});
+        next_offset += size;
+      }
+      next_time_us += length * 1000;
+    } else if (choice < 60) {
+      for (int64_t n = uniform(1, 40); n > 0 && expected.size() > 0; n--) {
+        ASSERT_EQ(expected.MoveToNextSample(), info_queue.MoveToNextSample());
+      }
+    } else if (choice < 80) {
+      int64_t time_us = uniform(next_time_us - 200000, next_time_us + 1000);
+      ASSERT_EQ(expected.SkipToKeyframeBefore(time_us),
+                info_queue.SkipToKeyframeBefore(time_us))
+          << "op " << op << " time_us " << time_us;
+    } else if (choice < 95) {
+      int64_t time_us = uniform(next_time_us - 200000, next_time_us + 1000);
+      ASSERT_EQ(expected.DiscardUntil(time_us),
+                info_queue.DiscardUntil(time_us))
+          << "op " << op << " time_us " << time_us;
+    } else if (choice < 99) {
+      // Replace the end of the queue, as when switching formats.
+      int32_t discard_from_index =
+          uniform(expected.GetReadIndex(), expected.GetWriteIndex());
+      int32_t discard_count = expected.GetWriteIndex() - discard_from_index;
+      info_queue.DiscardUpstreamSamples(discard_from_index);
+      expected.DiscardUpstreamSamples(discard_from_index);
+      next_time_us -= uniform(0, discard_count) * 1000;
+    } else {
+      info_queue.Clear();
+      expected.Clear();
+    }
+
+    ASSERT_EQ(expected.GetReadIndex(), info_queue.GetReadIndex());
+    ASSERT_EQ(expected.GetWriteIndex(), info_queue.GetWriteIndex());
+    const LinearInfoQueue::Sample* sample = expected.Peek();
+    ASSERT_EQ(sample != nullptr,
+              info_queue.PeekSample(&sample_holder, &extras_holder));
+    if (sample) {
+      ASSERT_EQ(sample->time_us, sample_holder.GetTimeUs());
+      ASSERT_EQ(sample->offset, extras_holder.GetOffset());
+    }
+  }
+}
+
 }  // namespace extractor
 
 }  // namespace ndash
@@ -0,0 +1,264 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "extractor/rawcc_index_extractor.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#include "base/lazy_instance.h"
+#include "base/logging.h"
+#include "extractor/chunk_index.h"
+#include "extractor/extractor_input.h"
+#include "extractor/extractor_output.h"
+#include "util/util.h"
+
+namespace ndash {
+namespace extractor {
+
+namespace {
+constexpr size_t kRawCCHeaderSize = 8;
+constexpr uint32_t kRawCCHeader = 'R' << 24 | 'C' << 16 | 'C' << 8 | 0x01;
+constexpr size_t kRawCCPtsAndCountSizeV0 = 5;
+constexpr size_t kRawCCSampleSize = 3;
+
+uint32_t ReadUint32(const uint8_t* data) {
+  // network byte order
+  return static_cast<uint32_t>(data[0]) << 24 | data[1] << 16 | data[2] << 8 |
+         data[3];
+}
+
+base::LazyInstance<RawCCIndexCache>::Leaky g_index_cache =
+    LAZY_INSTANCE_INITIALIZER;
+}  // namespace
+
+constexpr int64_t RawCCIndexExtractor::kWindowDurationUs;
+constexpr size_t RawCCIndexCache::kMaxIndexes;
+
+RawCCIndexExtractor::RawCCIndexExtractor() {
+  Reset();
+}
+
+RawCCIndexExtractor::~RawCCIndexExtractor() {}
+
+void RawCCIndexExtractor::Init(ExtractorOutputInterface* output) {
+  output_ = output;
+}
+
+bool RawCCIndexExtractor::Sniff(ExtractorInputInterface* input) {
+  return true;
+}
+
+int RawCCIndexExtractor::Read(ExtractorInputInterface* input,
+                              int64_t* seek_position) {
+  if (read_pos_ == write_pos_) {
+    buf_position_ = input->GetPosition();
+    read_pos_ = 0;
+    write_pos_ = 0;
+  } else if (read_pos_ != 0) {
+    // Move the partial record back to the beginning of our buf.
+    memmove(buf_, buf_ + read_pos_, write_pos_ - read_pos_);
+    buf_position_ += read_pos_;
+    write_pos_ -= read_pos_;
+    read_pos_ = 0;
+  }
+
+  ssize_t result = input->Read(buf_ + write_pos_, kReadBufferSize - write_pos_);
+  if (result == 0) {
+    return RESULT_CONTINUE;
+  }
+  if (result == RESULT_END_OF_INPUT) {
+    if (!header_parsed_) {
+      LOG(ERROR) << "Truncated RAWCC header";
+      return RESULT_IO_ERROR;
+    }
+    GiveIndex();
+    Reset();
+    return RESULT_END_OF_INPUT;
+  }
+  if (result < 0) {
+    return RESULT_IO_ERROR;
+  }
+  write_pos_ += result;
+
+  if (!header_parsed_) {
+    if (write_pos_ < kRawCCHeaderSize) {
+      return RESULT_CONTINUE;
+    }
+    // Only version 0 is supported, as by RawCCParserExtractor.
+    if (ReadUint32(buf_) != kRawCCHeader || buf_[4] != 0x00) {
+      LOG(ERROR) << "Invalid RAWCC header";
+      return RESULT_IO_ERROR;
+    }
+    read_pos_ = kRawCCHeaderSize;
+    header_parsed_ = true;
+  }
+
+  // Records are at most 770 bytes, so the buffer always holds a whole one.
+  while (write_pos_ - read_pos_ >= kRawCCPtsAndCountSizeV0) {
+    const uint8_t* record = buf_ + read_pos_;
+    size_t record_size =
+        kRawCCPtsAndCountSizeV0 + record[4] * kRawCCSampleSize;
+    if (write_pos_ - read_pos_ < record_size) {
+      break;
+    }
+    // 45khz
+    int64_t pts_us = util::Util::ScaleLargeTimestamp(ReadUint32(record),
+                                                     util::kMicrosPerMs, 45);
+    AddRecord(pts_us, buf_position_ + read_pos_, record_size);
+    read_pos_ += record_size;
+  }
+  return RESULT_CONTINUE;
+}
+
+void RawCCIndexExtractor::AddRecord(int64_t pts_us,
+                                    int64_t offset,
+                                    size_t size) {
+  if (window_times_us_.empty()) {
+    // The first window includes the header.
+    window_times_us_.push_back(pts_us);
+    window_offsets_.push_back(0);
+  } else if (pts_us >= window_times_us_.back() + kWindowDurationUs) {
+    window_times_us_.push_back(pts_us);
+    window_offsets_.push_back(offset);
+  }
+  last_pts_us_ = std::max(last_pts_us_, pts_us);
+  end_offset_ = offset + size;
+}
+
+void RawCCIndexExtractor::GiveIndex() {
+  std::unique_ptr<std::vector<uint32_t>> sizes(new std::vector<uint32_t>);
+  std::unique_ptr<std::vector<uint64_t>> offsets(new std::vector<uint64_t>);
+  std::unique_ptr<std::vector<uint64_t>> durations_us(
+      new std::vector<uint64_t>);
+  std::unique_ptr<std::vector<uint64_t>> times_us(new std::vector<uint64_t>);
+
+  if (window_times_us_.empty()) {
+    // No records; one window holds the header.
+    window_times_us_.push_back(0);
+    window_offsets_.push_back(0);
+    end_offset_ = kRawCCHeaderSize;
+  }
+  for (size_t i = 0; i < window_times_us_.size(); i++) {
+    bool last = i + 1 == window_times_us_.size();
+    int64_t end_offset = last ? end_offset_ : window_offsets_[i + 1];
+    int64_t end_time_us =
+        last ? last_pts_us_ + 1 : window_times_us_[i + 1];
+    sizes->push_back(end_offset - window_offsets_[i]);
+    offsets->push_back(window_offsets_[i]);
+    durations_us->push_back(
+        std::max<int64_t>(end_time_us - window_times_us_[i], 0));
+    times_us->push_back(window_times_us_[i]);
+  }
+  VLOG(2) << "Indexed " << end_offset_ << " bytes of RAWCC in "
+          << times_us->size() << " windows";
+
+  if (output_) {
+    output_->GiveSeekMap(std::unique_ptr<const SeekMapInterface>(
+        new ChunkIndex(std::move(sizes), std::move(offsets),
+                       std::move(durations_us), std::move(times_us))));
+  }
+}
+
+void RawCCIndexExtractor::Seek() {
+  Reset();
+}
+
+void RawCCIndexExtractor::Release() {
+  output_ = nullptr;
+}
+
+void RawCCIndexExtractor::Reset() {
+  write_pos_ = 0;
+  read_pos_ = 0;
+  buf_position_ = 0;
+  header_parsed_ = false;
+  window_times_us_.clear();
+  window_offsets_.clear();
+  last_pts_us_ = 0;
+  end_offset_ = 0;
+}
+
+// static
+RawCCIndexCache* RawCCIndexCache::GetInstance() {
+  return g_index_cache.Pointer();
+}
+
+RawCCIndexCache::RawCCIndexCache() {}
+
+RawCCIndexCache::~RawCCIndexCache() {}
+
+void RawCCIndexCache::Put(const std::string& url,
+                          std::unique_ptr<const ChunkIndex> index) {
+  DCHECK_GT(index->GetChunkCount(), 0);
+  base::AutoLock auto_lock(lock_);
+  if (indexes_.find(url) == indexes_.end()) {
+    urls_.push_back(url);
+  }
+  indexes_[url] = std::move(index);
+  if (urls_.size() > kMaxIndexes) {
+    indexes_.erase(urls_.front());
+    urls_.pop_front();
+  }
+}
+
+std::unique_ptr<ChunkIndex> RawCCIndexCache::Get(const std::string& url,
+                                                 int64_t start_us,
+                                                 int64_t end_us) const {
+  base::AutoLock auto_lock(lock_);
+  auto it = indexes_.find(url);
+  if (it == indexes_.end()) {
+    return nullptr;
+  }
+  const ChunkIndex& index = *it->second;
+  const std::vector<uint64_t>& times_us = index.times_us();
+
+  // Start with the window that |start_us| falls in (or the first), so that
+  // the result is never empty and begins at 0.
+  size_t first = std::upper_bound(times_us.begin(), times_us.end(),
+                                  static_cast<uint64_t>(std::max<int64_t>(
+                                      start_us, 0))) -
+                 times_us.begin();
+  first = first > 0 ? first - 1 : 0;
+
+  std::unique_ptr<std::vector<uint32_t>> sizes(new std::vector<uint32_t>);
+  std::unique_ptr<std::vector<uint64_t>> offsets(new std::vector<uint64_t>);
+  std::unique_ptr<std::vector<uint64_t>> durations_us(
+      new std::vector<uint64_t>);
+  std::unique_ptr<std::vector<uint64_t>> slice_times_us(
+      new std::vector<uint64_t>);
+  for (size_t i = first; i < times_us.size(); i++) {
+    int64_t window_start_us = static_cast<int64_t>(times_us[i]);
+    if (i != first && window_start_us >= end_us) {
+      break;
+    }
+    int64_t time_us = i == first ? 0 : window_start_us - start_us;
+    int64_t window_end_us = std::min<int64_t>(
+        window_start_us + index.durations_us()[i], end_us);
+    sizes->push_back(index.sizes()[i]);
+    offsets->push_back(index.offsets()[i]);
+    durations_us->push_back(
+        std::max<int64_t>(window_end_us - start_us - time_us, 0));
+    slice_times_us->push_back(time_us);
+  }
+  return std::unique_ptr<ChunkIndex>(
+      new ChunkIndex(std::move(sizes), std::move(offsets),
+                     std::move(durations_us), std::move(slice_times_us)));
+}
+
+}  // namespace extractor
+}  // namespace ndash
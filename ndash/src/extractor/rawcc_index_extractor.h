@@ -0,0 +1,110 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NDASH_EXTRACTOR_RAWCC_INDEX_EXTRACTOR_H_
+#define NDASH_EXTRACTOR_RAWCC_INDEX_EXTRACTOR_H_
+
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/synchronization/lock.h"
+#include "extractor/extractor.h"
+
+namespace ndash {
+namespace extractor {
+
+class ChunkIndex;
+
+// Scans a whole RAWCC stream without producing samples, and gives a
+// ChunkIndex that divides it into windows of about kWindowDurationUs. Each
+// window starts at a record, except the first which starts at the header, so
+// that RawCCParserExtractor can parse a window loaded by itself. Times are
+// media PTS in microseconds.
+class RawCCIndexExtractor : public ExtractorInterface {
+ public:
+  static constexpr int64_t kWindowDurationUs = 30000000;
+
+  RawCCIndexExtractor();
+  ~RawCCIndexExtractor() override;
+
+  void Init(ExtractorOutputInterface* output) override;
+  bool Sniff(ExtractorInputInterface* input) override;
+  int Read(ExtractorInputInterface* input, int64_t* seek_position) override;
+  void Seek() override;
+  void Release() override;
+
+ private:
+  static constexpr size_t kReadBufferSize = 16384;
+
+  void AddRecord(int64_t pts_us, int64_t offset, size_t size);
+  void GiveIndex();
+  void Reset();
+
+  ExtractorOutputInterface* output_ = nullptr;
+
+  uint8_t buf_[kReadBufferSize];
+  size_t write_pos_;
+  size_t read_pos_;
+  // Stream position of buf_[0].
+  int64_t buf_position_;
+  bool header_parsed_;
+
+  std::vector<int64_t> window_times_us_;
+  std::vector<int64_t> window_offsets_;
+  int64_t last_pts_us_;
+  int64_t end_offset_;
+};
+
+// Keeps the indexes of the last few RAWCC streams scanned, by URL, so that
+// periods sharing a stream (and later sessions) don't scan it again. Safe to
+// use from any thread.
+class RawCCIndexCache {
+ public:
+  static RawCCIndexCache* GetInstance();
+
+  RawCCIndexCache();
+  ~RawCCIndexCache();
+
+  // Keeps |index|, as given by RawCCIndexExtractor, for |url|.
+  void Put(const std::string& url, std::unique_ptr<const ChunkIndex> index);
+
+  // Returns the windows of the stream at |url| that cover media times
+  // [|start_us|, |end_us|), with times relative to |start_us|, or null if
+  // the stream hasn't been scanned.
+  std::unique_ptr<ChunkIndex> Get(const std::string& url,
+                                  int64_t start_us,
+                                  int64_t end_us) const;
+
+  RawCCIndexCache(const RawCCIndexCache& other) = delete;
+  RawCCIndexCache& operator=(const RawCCIndexCache& other) = delete;
+
+ private:
+  static constexpr size_t kMaxIndexes = 16;
+
+  mutable base::Lock lock_;  // Protects everything below
+  std::map<std::string, std::unique_ptr<const ChunkIndex>> indexes_;
+  // Oldest first.
+  std::list<std::string> urls_;
+};
+
+}  // namespace extractor
+}  // namespace ndash
+
+#endif  // NDASH_EXTRACTOR_RAWCC_INDEX_EXTRACTOR_H_
@@ -0,0 +1,168 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "extractor/rawcc_index_extractor.h"
+
+#include <cstring>
+#include <memory>
+#include <string>
+
+#include "base/files/file_path.h"
+#include "base/files/file_util.h"
+#include "extractor/chunk_index.h"
+#include "extractor/extractor_output_mock.h"
+#include "extractor/unbuffered_extractor_input.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "test/test_data.h"
+#include "upstream/data_source.h"
+
+namespace ndash {
+namespace extractor {
+
+namespace {
+
+// Gives the data in pieces of at most |piece_size|.
+class StringDataSource : public upstream::DataSourceInterface {
+ public:
+  StringDataSource(const std::string& data, size_t piece_size)
+      : data_(data), piece_size_(piece_size) {}
+
+  ssize_t Open(const upstream::DataSpec& data_spec,
+               const base::CancellationFlag* cancel) override {
+    return data_.size();
+  }
+
+  void Close() override {}
+
+  ssize_t Read(void* buffer, size_t read_length) override {
+    size_t avail = std::min(std::min(data_.size() - pos_, read_length),
+                            piece_size_);
+    if (avail == 0) {
+      return upstream::RESULT_END_OF_INPUT;
+    }
+    memcpy(buffer, data_.data() + pos_, avail);
+    pos_ += avail;
+    return avail;
+  }
+
+ private:
+  const std::string data_;
+  const size_t piece_size_;
+  size_t pos_ = 0;
+};
+
+// Scans |rawcc| and returns the index given.
+std::unique_ptr<const ChunkIndex> Scan(const std::string& rawcc) {
+  StringDataSource data_source(rawcc, 1000);
+  ::testing::NiceMock<MockExtractorOutput> output;
+  RawCCIndexExtractor extractor;
+  extractor.Init(&output);
+
+  UnbufferedExtractorInput input(&data_source, 0, rawcc.size());
+  int result;
+  do {
+    result = extractor.Read(&input, nullptr);
+  } while (result == ExtractorInterface::RESULT_CONTINUE);
+  EXPECT_EQ(ExtractorInterface::RESULT_END_OF_INPUT, result);
+
+  return std::unique_ptr<const ChunkIndex>(
+      static_cast<const ChunkIndex*>(output.given_seek_map_.release()));
+}
+
+}  // namespace
+
+TEST(RawCCIndexExtractorTest, IndexesFileInWindows) {
+  base::FilePath path(FLAGS_test_data_path);
+  path = path.AppendASCII("test/data/rawcc");
+  std::string rawcc;
+  ASSERT_TRUE(base::ReadFileToString(path, &rawcc));
+
+  std::unique_ptr<const ChunkIndex> index = Scan(rawcc);
+  ASSERT_TRUE(index);
+
+  // The file covers about 1211 seconds.
+  ASSERT_EQ(41, index->GetChunkCount());
+  EXPECT_EQ(0u, index->offsets()[0]);
+  uint64_t next_offset = 0;
+  for (int32_t i = 0; i < index->GetChunkCount(); i++) {
+    EXPECT_EQ(next_offset, index->offsets()[i]);
+    next_offset += index->sizes()[i];
+    if (i > 0) {
+      EXPECT_EQ(index->times_us()[i - 1] + index->durations_us()[i - 1],
+                index->times_us()[i]);
+      EXPECT_GE(index->durations_us()[i - 1],
+                static_cast<uint64_t>(RawCCIndexExtractor::kWindowDurationUs));
+    }
+  }
+  EXPECT_EQ(rawcc.size(), next_offset);
+}
+
+TEST(RawCCIndexExtractorTest, BadHeader) {
+  const char bad_header[] = {'B', 'A', 'R', 'F', 0x00, 0x00, 0x00, 0x00};
+  StringDataSource data_source(std::string(bad_header, sizeof(bad_header)),
+                               sizeof(bad_header));
+  ::testing::StrictMock<MockExtractorOutput> output;
+  RawCCIndexExtractor extractor;
+  extractor.Init(&output);
+
+  UnbufferedExtractorInput input(&data_source, 0, sizeof(bad_header));
+  EXPECT_EQ(ExtractorInterface::RESULT_IO_ERROR,
+            extractor.Read(&input, nullptr));
+}
+
+TEST(RawCCIndexCacheTest, GetsWindowsOfPeriod) {
+  base::FilePath path(FLAGS_test_data_path);
+  path = path.AppendASCII("test/data/rawcc");
+  std::string rawcc;
+  ASSERT_TRUE(base::ReadFileToString(path, &rawcc));
+
+  std::unique_ptr<const ChunkIndex> index = Scan(rawcc);
+  ASSERT_TRUE(index);
+  int64_t first_us = index->times_us()[0];
+  int64_t window_3_us = index->times_us()[3];
+  int64_t window_3_offset = index->offsets()[3];
+
+  RawCCIndexCache cache;
+  EXPECT_FALSE(cache.Get("http://a/cc", 0, 1));
+  cache.Put("http://a/cc", std::move(index));
+  EXPECT_FALSE(cache.Get("http://b/cc", 0, 1));
+
+  // A period from the middle of window 3 that lasts two minutes.
+  int64_t start_us = window_3_us + 1000000;
+  int64_t end_us = start_us + 120000000;
+  std::unique_ptr<ChunkIndex> slice =
+      cache.Get("http://a/cc", start_us, end_us);
+  ASSERT_TRUE(slice);
+  ASSERT_EQ(5, slice->GetChunkCount());
+  EXPECT_EQ(static_cast<uint64_t>(window_3_offset), slice->offsets()[0]);
+  uint64_t total_us = 0;
+  for (int32_t i = 0; i < slice->GetChunkCount(); i++) {
+    EXPECT_EQ(total_us, slice->times_us()[i]);
+    total_us += slice->durations_us()[i];
+  }
+  EXPECT_EQ(static_cast<uint64_t>(end_us - start_us), total_us);
+
+  // A period before the captions start still gets the first window.
+  slice = cache.Get("http://a/cc", 0, first_us / 2);
+  ASSERT_TRUE(slice);
+  ASSERT_EQ(1, slice->GetChunkCount());
+  EXPECT_EQ(0u, slice->offsets()[0]);
+  EXPECT_EQ(0u, slice->times_us()[0]);
+}
+
+}  // namespace extractor
+}  // namespace ndash
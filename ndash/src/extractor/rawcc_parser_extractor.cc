@@ -16,6 +16,7 @@
 
 #include "extractor/rawcc_parser_extractor.h"
 
+#include <algorithm>
 #include <cstdint>
 #include <limits>
 #include <memory>
@@ -39,20 +40,27 @@ namespace extractor {
 namespace {
 constexpr size_t kRawCCHeaderSize = 8;
 constexpr uint32_t kRawCCHeader = 'R' << 24 | 'C' << 16 | 'C' << 8 | 0x01;
-constexpr size_t kRawCCFlagsSize = 3;
 
 constexpr size_t kRawCCPtsAndCountSizeV0 = 5;
 constexpr size_t kRawCCSampleSize = 3;
 
 constexpr size_t kSampleEntrySize = 8;
 
+uint32_t ReadUint32(const uint8_t* data) {
+  // network byte order
+  return static_cast<uint32_t>(data[0]) << 24 | data[1] << 16 | data[2] << 8 |
+         data[3];
+}
+
 }  // namespace
 
 RawCCParserExtractor::RawCCParserExtractor(
     const base::TimeDelta sample_offset,
     std::unique_ptr<base::TimeDelta> trunc_start_pts,
-    std::unique_ptr<base::TimeDelta> trunc_end_pts)
+    std::unique_ptr<base::TimeDelta> trunc_end_pts,
+    bool windowed)
     : sample_offset_(sample_offset),
+      windowed_(windowed),
       trunc_start_pts_(std::move(trunc_start_pts)),
       trunc_end_pts_(std::move(trunc_end_pts)),
       output_(nullptr),
@@ -73,20 +81,6 @@ bool RawCCParserExtractor::Sniff(ExtractorInputInterface* input) {
   return true;
 }
 
-uint8_t RawCCParserExtractor::ReadByte() {
-  uint8_t v = buf_[read_pos_++];
-  return v;
-}
-
-uint32_t RawCCParserExtractor::ReadInt() {
-  // network byte order
-  uint32_t v = buf_[read_pos_++] << 24;
-  v |= buf_[read_pos_++] << 16;
-  v |= buf_[read_pos_++] << 8;
-  v |= buf_[read_pos_++];
-  return v;
-}
-
 int RawCCParserExtractor::Read(ExtractorInputInterface* input,
                                int64_t* seek_position) {
   int n = available();
@@ -100,6 +94,12 @@ int RawCCParserExtractor::Read(ExtractorInputInterface* input,
     write_pos_ = 0;
   }
 
+  if (windowed_ && state_ == PARSING_HEADER && n == 0 &&
+      input->GetPosition() != 0) {
+    // A window other than the first starts at a record.
+    state_ = PARSING_PTS_AND_COUNT;
+  }
+
   ssize_t result = input->Read(buf_ + write_pos_, kReadBufferSize - write_pos_);
 
   if (result == 0)
@@ -117,41 +117,37 @@ int RawCCParserExtractor::Read(ExtractorInputInterface* input,
 
   write_pos_ += result;
 
+  // Decode straight from the buffer; a state only waits for more data when
+  // what it needs isn't all there.
   while (read_pos_ < write_pos_) {
-    base::TimeDelta this_sample_pts;
+    const uint8_t* data = buf_ + read_pos_;
     switch (state_) {
-      case PARSING_HEADER:
-        if ((available()) < kRawCCHeaderSize) {
+      case PARSING_HEADER: {
+        if (available() < kRawCCHeaderSize) {
           // Waiting for more data.
           VLOG(3) << "PARSING_HEADER: waiting for more data";
           return RESULT_CONTINUE;
-        } else {
-          size_t read_start = read_pos_;
-          uint32_t hdr = ReadInt();
-          if (hdr != kRawCCHeader) {
-            LOG(ERROR) << "Invalid RAWCC header";
-            return RESULT_IO_ERROR;
-          }
-
-          version_ = ReadByte();
-          // Grab pts and count from cc packet.
-          if (version_ != 0x00) {
-            // TODO(rmrossi): Support version 1 with 8 byte pts.
-            LOG(ERROR) << "Unsupported rawcc version";
-            return RESULT_IO_ERROR;
-          }
-
-          // Skip over flags. None are used yet.
-          read_pos_ += kRawCCFlagsSize;
-          // Fall through to the next state.
-          VLOG(3) << "PARSING_HEADER -> PARSING_PTS_AND_COUNT";
-          state_ = PARSING_PTS_AND_COUNT;
-
-          size_t read_end = read_pos_;
-          DCHECK_EQ(read_end - read_start, kRawCCHeaderSize);
         }
-      // No break
-      case PARSING_PTS_AND_COUNT:
+        if (ReadUint32(data) != kRawCCHeader) {
+          LOG(ERROR) << "Invalid RAWCC header";
+          return RESULT_IO_ERROR;
+        }
+
+        version_ = data[4];
+        // Grab pts and count from cc packet.
+        if (version_ != 0x00) {
+          // TODO(rmrossi): Support version 1 with 8 byte pts.
+          LOG(ERROR) << "Unsupported rawcc version";
+          return RESULT_IO_ERROR;
+        }
+
+        // The flags that follow the version aren't used yet.
+        read_pos_ += kRawCCHeaderSize;
+        VLOG(3) << "PARSING_HEADER -> PARSING_PTS_AND_COUNT";
+        state_ = PARSING_PTS_AND_COUNT;
+        break;
+      }
+      case PARSING_PTS_AND_COUNT: {
         if (available() < kRawCCPtsAndCountSizeV0) {
           // Waiting for more data.
           VLOG(3) << "PARSING_PTS_AND_COUNT: waiting for more data";
@@ -159,9 +155,11 @@ int RawCCParserExtractor::Read(ExtractorInputInterface* input,
         }
 
         // 45khz
-        pts_ = ReadInt();
+        pts_ = ReadUint32(data);
+        expected_count_ = data[4];
+        read_pos_ += kRawCCPtsAndCountSizeV0;
 
-        this_sample_pts = base::TimeDelta::FromMicroseconds(
+        base::TimeDelta this_sample_pts = base::TimeDelta::FromMicroseconds(
             util::Util::ScaleLargeTimestamp(pts_, util::kMicrosPerMs, 45));
 
         producing_to_queue_ = true;
@@ -180,73 +178,31 @@ int RawCCParserExtractor::Read(ExtractorInputInterface* input,
           sample_pts_ = this_sample_pts.InMicroseconds();
         }
 
-        expected_count_ = ReadByte();
+        entry_pts_ = pts_;
+        if (sample_offset_ != base::TimeDelta()) {
+          // This brings us to how far into the stream this sample is
+          // relative to the beginning, back in 45khz.
+          entry_pts_ = (this_sample_pts + sample_offset_).InMilliseconds() * 45;
+        }
 
         sample_index_ = 0;
-        // Fall through to the next state.
         VLOG(3) << "PARSING_PTS_AND_COUNT -> PARSING_ENTRIES";
         state_ = PARSING_ENTRIES;
-      // No break
-      case PARSING_ENTRIES:
-        // Translate |expected_count_| entries.
-        while (sample_index_ < expected_count_) {
-          if (available() < kRawCCSampleSize) {
-            // Need more bytes.
-            VLOG(3) << "PARSING_ENTRIES: waiting for more data";
-            return RESULT_CONTINUE;
-          }
-
-          uint8_t flags = ReadByte();
-          uint8_t cc1 = ReadByte();
-          uint8_t cc2 = ReadByte();
-
-          if (!producing_to_queue_) {
-            // We are not within range yet.
-            sample_index_++;
-            continue;
-          }
-
-          // Translate rawcc format into UDP format.
-          char entry[kSampleEntrySize];
-          size_t pos = 0;
-          uint32_t entry_pts = pts_;
-
-          if (sample_offset_ != base::TimeDelta()) {
-            // Convert from 45khz to time
-            base::TimeDelta sample_pts = base::TimeDelta::FromMicroseconds(
-                util::Util::ScaleLargeTimestamp(pts_, util::kMicrosPerMs, 45));
-            // This brings us to how far into the stream this sample is
-            // relative to the beginning.
-            sample_pts += sample_offset_;
-            // Back to 45khz
-            entry_pts = sample_pts.InMilliseconds() * 45;
-          }
-
-          // Back to 45khz
-          // network byte order
-          entry[pos++] = (entry_pts >> 24) & 0xFF;
-          entry[pos++] = (entry_pts >> 16) & 0xFF;
-          entry[pos++] = (entry_pts >> 8) & 0xFF;
-          entry[pos++] = entry_pts & 0xFF;
-          // field
-          entry[pos++] = (flags & 0x03);
-          // cc1
-          entry[pos++] = cc1;
-          // cc2
-          entry[pos++] = cc2;
-          // cc_valid
-          entry[pos++] = (flags & 0x04) != 0;
-
-          DCHECK_EQ(pos, kSampleEntrySize);
-          // Write the sample.
-          if (!WriteFully(&entry[0], kSampleEntrySize)) {
-            return RESULT_IO_ERROR;
-          }
-          sample_index_++;
-          total_written_++;
-          if (total_written_ > kMaxEntriesPerSample) {
-            FlushSample();
-          }
+        break;
+      }
+      case PARSING_ENTRIES: {
+        // Translate as many of the |expected_count_| entries as are here.
+        size_t count = std::min(expected_count_ - sample_index_,
+                                available() / kRawCCSampleSize);
+        if (producing_to_queue_ && !WriteEntries(data, count)) {
+          return RESULT_IO_ERROR;
+        }
+        read_pos_ += count * kRawCCSampleSize;
+        sample_index_ += count;
+        if (sample_index_ < expected_count_) {
+          // Need more bytes.
+          VLOG(3) << "PARSING_ENTRIES: waiting for more data";
+          return RESULT_CONTINUE;
         }
 
         // Reset for next iteration.
@@ -254,7 +210,8 @@ int RawCCParserExtractor::Read(ExtractorInputInterface* input,
         sample_index_ = 0;
         VLOG(3) << "PARSING_ENTRIES -> PARSING_PTS_AND_COUNT";
         state_ = PARSING_PTS_AND_COUNT;
-        // No break
+        break;
+      }
     }
   }
 
@@ -262,6 +219,39 @@ int RawCCParserExtractor::Read(ExtractorInputInterface* input,
   return RESULT_CONTINUE;
 }
 
+bool RawCCParserExtractor::WriteEntries(const uint8_t* entries, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    const uint8_t* src = entries + i * kRawCCSampleSize;
+    uint8_t flags = src[0];
+
+    // Translate rawcc format into UDP format.
+    char entry[kSampleEntrySize];
+    // network byte order
+    entry[0] = (entry_pts_ >> 24) & 0xFF;
+    entry[1] = (entry_pts_ >> 16) & 0xFF;
+    entry[2] = (entry_pts_ >> 8) & 0xFF;
+    entry[3] = entry_pts_ & 0xFF;
+    // field
+    entry[4] = (flags & 0x03);
+    // cc1
+    entry[5] = src[1];
+    // cc2
+    entry[6] = src[2];
+    // cc_valid
+    entry[7] = (flags & 0x04) != 0;
+
+    // Write the sample.
+    if (!WriteFully(&entry[0], kSampleEntrySize)) {
+      return false;
+    }
+    total_written_++;
+    if (total_written_ > kMaxEntriesPerSample) {
+      FlushSample();
+    }
+  }
+  return true;
+}
+
 void RawCCParserExtractor::FlushSample() {
   if (total_written_ > 0 && producing_to_queue_) {
     int64_t last_pts =
@@ -306,6 +296,7 @@ void RawCCParserExtractor::Reset() {
   producing_to_queue_ = true;
   sample_pts_ = 0;
   pts_ = 0;
+  entry_pts_ = 0;
   version_ = 0;
   state_ = PARSING_HEADER;
 }
@@ -55,12 +55,16 @@ class RawCCParserExtractor : public ExtractorInterface {
   // sample_offset : Offset used to translate PTS into the master timeline.
   // trunc_start_pts : The earliest PTS we should allow into the sample queue.
   // trunc_end_pts: The latest PTS we should allow into the sample queue.
+  // windowed: The stream is loaded in the windows a RawCCIndexExtractor
+  //           found, so input that doesn't start at the beginning of the
+  //           stream starts at a record rather than the header.
   // NOTE: |trunc_start_pts| and |trunc_end_pts| should be media time PTS
   //       values, not master time-line values.
   RawCCParserExtractor(
       const base::TimeDelta sample_offset = base::TimeDelta(),
       std::unique_ptr<base::TimeDelta> trunc_start_pts = nullptr,
-      std::unique_ptr<base::TimeDelta> trunc_end_pts = nullptr);
+      std::unique_ptr<base::TimeDelta> trunc_end_pts = nullptr,
+      bool windowed = false);
   ~RawCCParserExtractor() override;
 
   void Init(ExtractorOutputInterface* output) override;
@@ -70,13 +74,14 @@ class RawCCParserExtractor : public ExtractorInterface {
   void Release() override;
 
  private:
-  static constexpr size_t kReadBufferSize = 4096;
+  static constexpr size_t kReadBufferSize = 16384;
   static constexpr size_t kMaxEntriesPerSample = 120;
 
   enum ParsingState { PARSING_HEADER, PARSING_PTS_AND_COUNT, PARSING_ENTRIES };
 
-  uint8_t ReadByte();
-  uint32_t ReadInt();
+  // Translates |count| rawcc entries at |entries| and writes them to the
+  // current sample.
+  bool WriteEntries(const uint8_t* entries, size_t count);
   bool WriteFully(const char* src, size_t num);
 
   void FlushSample();
@@ -88,6 +93,7 @@ class RawCCParserExtractor : public ExtractorInterface {
 
   // Used to translate to master timeline.
   base::TimeDelta sample_offset_;
+  const bool windowed_;
   // The earliest media PTS value that will be allowed into the sample queue.
   std::unique_ptr<base::TimeDelta> trunc_start_pts_;
   // The latest media PTS value that will be allowed into the sample queue.
@@ -102,6 +108,8 @@ class RawCCParserExtractor : public ExtractorInterface {
   uint8_t version_;
   // pts from most recent rawcc sample (45khz clock).
   uint32_t pts_;
+  // |pts_| translated to the master timeline, for the entries.
+  uint32_t entry_pts_;
   // pts converted to microseconds for the sample queue.
   int64_t sample_pts_;
   // The number of samples expected from the rawcc stream.
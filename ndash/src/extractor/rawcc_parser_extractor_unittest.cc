@@ -308,6 +308,40 @@ TEST(RawCCParserExtractorTest, ParseFile) {
   } while (true);
 }
 
+// Tests a window that doesn't start the stream is parsed from a record.
+TEST(RawCCParserExtractorTest, ParseWindow) {
+  FakeDataSource data_source;
+  StrictMock<MockExtractorOutput> output;
+  StrictMock<MockTrackOutput> track_out;
+  RawCCParserExtractor rpe(base::TimeDelta(), nullptr, nullptr, true);
+
+  EXPECT_CALL(output, RegisterTrack(0)).WillOnce(Return(&track_out));
+  rpe.Init(&output);
+
+  // The window starts after the header.
+  constexpr int kHeaderSize = 8;
+  UnbufferedExtractorInput input(&data_source, kHeaderSize,
+                                 sizeof(good_packet) - kHeaderSize);
+  data_source.SetNextReadSrc(&good_packet[kHeaderSize],
+                             sizeof(good_packet) - kHeaderSize);
+
+  // Make every write succeed completely.
+  EXPECT_CALL(track_out, WriteSampleDataFixThis(_, 8, _, _))
+      .WillRepeatedly(DoAll(SetArgPointee<3>(8), Return(true)));
+
+  // time will be in 45khz clock
+  const base::TimeDelta pts = base::TimeDelta::FromMicroseconds(
+      util::Util::ScaleLargeTimestamp(1, util::kMicrosPerMs, 45));
+
+  EXPECT_CALL(track_out,
+              WriteSampleMetadata(pts.InMicroseconds(), 0,
+                                  util::kSampleFlagSync, 5 * 8, 0, IsNull(),
+                                  IsNull(), IsNull(), IsNull()));
+
+  int read_num = rpe.Read(&input, nullptr);
+  EXPECT_EQ(ExtractorInterface::RESULT_CONTINUE, read_num);
+}
+
 // Tests we can reset half way through parsing and not get errors.
 TEST(RawCCParserExtractorTest, Reset) {
   FakeDataSource data_source;
@@ -16,6 +16,7 @@
 
 #include "extractor/rolling_sample_buffer.h"
 
+#include "base/trace_event/trace_event.h"
 #include "upstream/allocator.h"
 #include "util/util.h"
 
@@ -75,6 +76,11 @@ int32_t RollingSampleBuffer::GetReadIndex() const {
   return info_queue_.GetReadIndex();
 }
 
+size_t RollingSampleBuffer::GetBytesAllocated() const {
+  base::AutoLock lock(lock_);
+  return data_queue_.size() * allocation_length_;
+}
+
 bool RollingSampleBuffer::PeekSample(SampleHolder* sample_holder) {
   return info_queue_.PeekSample(sample_holder, &extras_holder_);
 }
@@ -95,6 +101,16 @@ bool RollingSampleBuffer::SkipToKeyframeBefore(int64_t timeUs) {
   return true;
 }
 
+bool RollingSampleBuffer::DiscardUntil(int64_t time_us) {
+  base::AutoLock lock(lock_);
+  int64_t next_offset = info_queue_.DiscardUntil(time_us);
+  if (next_offset == -1) {
+    return false;
+  }
+  DropDownstreamTo(next_offset);
+  return true;
+}
+
 bool RollingSampleBuffer::ReadSample(SampleHolder* sample_holder) {
   DCHECK(sample_holder != nullptr);
   base::AutoLock lock(lock_);
@@ -217,6 +233,10 @@ void RollingSampleBuffer::CommitSample(int64_t sample_time_us,
                                        const std::string* iv,
                                        std::vector<int32_t>* num_bytes_clear,
                                        std::vector<int32_t>* num_bytes_enc) {
+  TRACE_EVENT_INSTANT2(TRACE_DISABLED_BY_DEFAULT("ndash.frames"),
+                       "RollingSampleBuffer::CommitSample",
+                       TRACE_EVENT_SCOPE_THREAD, "time_us", sample_time_us,
+                       "size", size);
   info_queue_.CommitSample(sample_time_us, duration_us, flags, position, size,
                            encryption_key_id, iv, num_bytes_clear,
                            num_bytes_enc);
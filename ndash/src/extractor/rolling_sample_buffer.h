@@ -52,6 +52,10 @@ class RollingSampleBuffer {
   // Returns the current absolute read index.
   int32_t GetReadIndex() const;
 
+  // Returns the size of the allocations holding sample data. May be called
+  // from any thread.
+  size_t GetBytesAllocated() const;
+
   // Fills the holder with information about the current sample, but does not
   // write its data.
   // holder: The holder into which the current sample information should be
@@ -68,6 +72,11 @@ class RollingSampleBuffer {
   // Returns true if the skip was successful. False otherwise.
   bool SkipToKeyframeBefore(int64_t time_us);
 
+  // Skips all samples before the first one at or after the specified time.
+  // time_us: The time up to which samples should be skipped.
+  // Returns true if any samples were skipped.
+  bool DiscardUntil(int64_t time_us);
+
   // Reads the current sample, advancing the read index to the next sample.
   // sample_holder: The holder into which the current sample should be written.
   // Returns true if a sample was read, false if there is no current sample.
@@ -25,6 +25,7 @@
 #include "base/callback.h"
 #include "base/logging.h"
 #include "base/memory/ref_counted.h"
+#include "base/trace_event/trace_event.h"
 #include "drm/drm_init_data.h"
 #include "drm/drm_session_manager.h"
 #include "drm/scheme_init_data.h"
@@ -187,11 +188,26 @@ bool StreamParserExtractor::Sniff(ExtractorInputInterface* input) {
 int StreamParserExtractor::Read(ExtractorInputInterface* input,
                                 int64_t* seek_position) {
   uint8_t buf[kReadBufferSize];
-
-  ssize_t result = input->Read(buf, sizeof(buf));
+  const uint8_t* data = buf;
+  ssize_t result;
+
+  if (input->CanReadView()) {
+    // The input holds the data already (e.g. a mapped file), so parse it
+    // where it is.
+    const void* view = nullptr;
+    result = input->ReadView(&view, kReadBufferSize);
+    data = static_cast<const uint8_t*>(view);
+  } else {
+    result = input->Read(buf, sizeof(buf));
+  }
 
   if (result > 0) {
-    if (parser_->Parse(buf, result)) {
+    bool parsed;
+    {
+      TRACE_EVENT1("ndash", "MP4StreamParser::Parse", "bytes", result);
+      parsed = parser_->Parse(data, result);
+    }
+    if (parsed) {
       return RESULT_CONTINUE;
     } else {
       // Probably not really appropriate, but we'll figure out better error
@@ -523,6 +539,16 @@ void StreamParserExtractor::ProcessBuffers(
     }
 
     int flags = buf->is_key_frame() ? util::kSampleFlagSync : 0;
+    switch (buf->dependency()) {
+      case media::StreamParserBuffer::DEPENDENCY_REFERENCE:
+        flags |= util::kSampleFlagReference;
+        break;
+      case media::StreamParserBuffer::DEPENDENCY_NON_REFERENCE:
+        flags |= util::kSampleFlagNonReference;
+        break;
+      case media::StreamParserBuffer::DEPENDENCY_UNKNOWN:
+        break;
+    }
     const std::string* encryption_key_id = nullptr;
     const std::string* iv = nullptr;
     const media::DecryptConfig* decrypt_config = buf->decrypt_config();
@@ -15,6 +15,9 @@
  */
 
 #include "extractor/stream_parser_extractor.h"
+#include "base/bind.h"
+#include "base/files/file_path.h"
+#include "base/files/file_util.h"
 #include "base/memory/ref_counted.h"
 #include "drm/drm_session_manager_mock.h"
 #include "extractor/chunk_index_unittest.h"
@@ -31,8 +34,10 @@
 #include "mp4/audio_decoder_config.h"
 #include "mp4/channel_layout.h"
 #include "mp4/encryption_scheme.h"
+#include "mp4/es_descriptor.h"
 #include "mp4/media_track.h"
 #include "mp4/media_tracks.h"
+#include "mp4/mp4_stream_parser.h"
 #include "mp4/rect.h"
 #include "mp4/size.h"
 #include "mp4/stream_parser_buffer.h"
@@ -40,6 +45,7 @@
 #include "mp4/video_decoder_config.h"
 #include "mp4/video_types.h"
 #include "test/stream_parser_mock.h"
+#include "test/test_data.h"
 #include "util/util.h"
 
 namespace ndash {
@@ -61,6 +67,63 @@ using ::testing::StrictMock;
 using ::testing::Values;
 using ::testing::_;
 
+namespace {
+void OnInit(const media::StreamParser::InitParameters& params) {}
+
+bool OnNewConfig(std::unique_ptr<media::MediaTracks> tracks,
+                 const media::StreamParser::TextTrackConfigMap& text_configs) {
+  return true;
+}
+
+// Counts the video samples the parser could or couldn't classify.
+bool CountDependencies(int* classified,
+                       int* unclassified,
+                       const media::StreamParser::BufferQueue& audio_buffers,
+                       const media::StreamParser::BufferQueue& video_buffers,
+                       const media::StreamParser::TextBufferQueueMap& text) {
+  for (const auto& buffer : video_buffers) {
+    if (buffer->dependency() ==
+        media::StreamParserBuffer::DEPENDENCY_UNKNOWN) {
+      (*unclassified)++;
+    } else {
+      (*classified)++;
+    }
+  }
+  return true;
+}
+
+void OnEncryptedMediaInitData(media::EmeInitDataType type,
+                              const std::vector<uint8_t>& init_data) {}
+
+void OnMediaSegment() {}
+
+void OnSidx(std::unique_ptr<std::vector<uint32_t>> sizes,
+            std::unique_ptr<std::vector<uint64_t>> offsets,
+            std::unique_ptr<std::vector<uint64_t>> durations_us,
+            std::unique_ptr<std::vector<uint64_t>> times_us) {}
+
+// Parses an H.264 file with frame classification on or off.
+void ParseBear(bool classify, int* classified, int* unclassified) {
+  std::string data;
+  ASSERT_TRUE(base::ReadFileToString(
+      base::FilePath(FLAGS_test_data_path)
+          .AppendASCII("test/data/bear-1280x720-av_frag.mp4"),
+      &data));
+  std::set<int> audio_object_types;
+  audio_object_types.insert(media::mp4::kISO_14496_3);
+  media::mp4::MP4StreamParser parser(audio_object_types, false);
+  parser.set_classify_dependencies(classify);
+  parser.Init(base::Bind(&OnInit), base::Bind(&OnNewConfig),
+              base::Bind(&CountDependencies, classified, unclassified), true,
+              base::Bind(&OnEncryptedMediaInitData),
+              base::Bind(&OnMediaSegment), base::Bind(&OnMediaSegment),
+              base::Bind(&OnSidx),
+              scoped_refptr<media::MediaLog>(new media::MediaLog()));
+  EXPECT_TRUE(parser.Parse(reinterpret_cast<const uint8_t*>(data.data()),
+                           data.size()));
+}
+}  // namespace
+
 class StreamParserExtractorTest : public ::testing::TestWithParam<std::string> {
  public:
   void SetUp() {
@@ -388,6 +451,8 @@ TEST_P(StreamParserExtractorTest, SingleTrackConfigAndBuffers) {
     data_buffer_queue.push_back(media::StreamParserBuffer::CopyFrom(
         buf2, kBufSize, false, stream_type, 0));
     data_buffer_queue.back()->set_timestamp(kBufTimestamp2);
+    data_buffer_queue.back()->set_dependency(
+        media::StreamParserBuffer::DEPENDENCY_NON_REFERENCE);
     data_buffer_queue.back()->set_duration(kDuration);
     if (is_encrypted) {
       std::unique_ptr<media::DecryptConfig> decrypt_config(
@@ -418,6 +483,8 @@ TEST_P(StreamParserExtractorTest, SingleTrackConfigAndBuffers) {
     data_buffer_queue.push_back(media::StreamParserBuffer::CopyFrom(
         buf4, kBufSize2, true, stream_type, 0));
     data_buffer_queue.back()->set_timestamp(kBufTimestamp4);
+    data_buffer_queue.back()->set_dependency(
+        media::StreamParserBuffer::DEPENDENCY_REFERENCE);
     data_buffer_queue.back()->set_duration(kDuration2);
     if (is_encrypted) {
       std::unique_ptr<media::DecryptConfig> decrypt_config(
@@ -463,15 +530,17 @@ TEST_P(StreamParserExtractorTest, SingleTrackConfigAndBuffers) {
       .WillOnce(DoAll(SetArgPointee<3>(kBufSize), Return(true)));
   if (is_encrypted) {
     EXPECT_CALL(track_out,
-                WriteSampleMetadata(kBufTimestamp2.InMicroseconds(),
-                                    kDuration.InMicroseconds(),
-                                    util::kSampleFlagEncrypted, kBufSize, 0,
-                                    Pointee(Eq(key_id)), Pointee(Eq(iv)),
-                                    Not(IsNull()), Not(IsNull())));
+                WriteSampleMetadata(
+                    kBufTimestamp2.InMicroseconds(),
+                    kDuration.InMicroseconds(),
+                    util::kSampleFlagNonReference | util::kSampleFlagEncrypted,
+                    kBufSize, 0, Pointee(Eq(key_id)), Pointee(Eq(iv)),
+                    Not(IsNull()), Not(IsNull())));
   } else {
     EXPECT_CALL(track_out,
                 WriteSampleMetadata(kBufTimestamp2.InMicroseconds(),
-                                    kDuration.InMicroseconds(), 0, kBufSize, 0,
+                                    kDuration.InMicroseconds(),
+                                    util::kSampleFlagNonReference, kBufSize, 0,
                                     IsNull(), IsNull(), IsNull(), IsNull()));
   }
 
@@ -491,15 +560,17 @@ TEST_P(StreamParserExtractorTest, SingleTrackConfigAndBuffers) {
         track_out,
         WriteSampleMetadata(kBufTimestamp4.InMicroseconds(),
                             kDuration2.InMicroseconds(),
-                            util::kSampleFlagSync | util::kSampleFlagEncrypted,
+                            util::kSampleFlagSync | util::kSampleFlagReference |
+                                util::kSampleFlagEncrypted,
                             kBufSize2, 0, Pointee(Eq(key_id)), Pointee(Eq(iv)),
                             Not(IsNull()), Not(IsNull())));
   } else {
     EXPECT_CALL(track_out,
-                WriteSampleMetadata(kBufTimestamp4.InMicroseconds(),
-                                    kDuration2.InMicroseconds(),
-                                    util::kSampleFlagSync, kBufSize2, 0,
-                                    IsNull(), IsNull(), IsNull(), IsNull()));
+                WriteSampleMetadata(
+                    kBufTimestamp4.InMicroseconds(),
+                    kDuration2.InMicroseconds(),
+                    util::kSampleFlagSync | util::kSampleFlagReference,
+                    kBufSize2, 0, IsNull(), IsNull(), IsNull(), IsNull()));
   }
 
   EXPECT_THAT(new_buffers_cb_.Run(empty_buffer_queue, data_buffer_queue,
@@ -559,5 +630,18 @@ TEST_F(StreamParserExtractorTest, NewSIDX) {
   EXPECT_THAT(seek_map->GetPosition(30000), Eq(kTestData.at(3).offset));
 }
 
+TEST(StreamParserExtractorFrameTest, ClassificationCanBeTurnedOff) {
+  int classified = 0;
+  int unclassified = 0;
+  ParseBear(true, &classified, &unclassified);
+  EXPECT_GT(classified, 0);
+  EXPECT_EQ(0, unclassified);
+
+  classified = 0;
+  ParseBear(false, &classified, &unclassified);
+  EXPECT_EQ(0, classified);
+  EXPECT_GT(unclassified, 0);
+}
+
 }  // namespace extractor
 }  // namespace ndash
@@ -43,6 +43,20 @@ ssize_t UnbufferedExtractorInput::Read(void* buffer, size_t length) {
   return result;
 }
 
+bool UnbufferedExtractorInput::CanReadView() const {
+  return data_source_->CanReadView();
+}
+
+ssize_t UnbufferedExtractorInput::ReadView(const void** data, size_t length) {
+  ssize_t result = data_source_->ReadView(data, length);
+
+  if (result > 0) {
+    position_ += result;
+  }
+
+  return result;
+}
+
 bool UnbufferedExtractorInput::ReadFully(void* buffer,
                                          size_t length,
                                          bool* end_of_input) {
@@ -47,6 +47,8 @@ class UnbufferedExtractorInput : public ExtractorInputInterface {
   ~UnbufferedExtractorInput() override;
 
   ssize_t Read(void* buffer, size_t length) override;
+  bool CanReadView() const override;
+  ssize_t ReadView(const void** data, size_t length) override;
 
   void ResetPeekPosition() override;
   int64_t GetPeekPosition() const override;
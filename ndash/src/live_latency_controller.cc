@@ -0,0 +1,64 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "live_latency_controller.h"
+
+#include <algorithm>
+
+namespace ndash {
+
+constexpr int64_t LiveLatencyController::kToleranceMs;
+constexpr float LiveLatencyController::kGainPerSecond;
+constexpr float LiveLatencyController::kMinRate;
+constexpr float LiveLatencyController::kMaxRate;
+
+LiveLatencyController::LiveLatencyController(base::TimeDelta target_latency)
+    : target_latency_(target_latency) {}
+
+LiveLatencyController::~LiveLatencyController() {}
+
+void LiveLatencyController::UpdateLatency(base::TimeDelta latency) {
+  latency_ = latency;
+  has_latency_ = true;
+}
+
+void LiveLatencyController::Reset() {
+  has_latency_ = false;
+  latency_ = base::TimeDelta();
+}
+
+float LiveLatencyController::GetCatchupRate() const {
+  if (!has_latency_) {
+    return 1.0f;
+  }
+  base::TimeDelta error = latency_ - target_latency_;
+  if (error.magnitude() <= base::TimeDelta::FromMilliseconds(kToleranceMs)) {
+    return 1.0f;
+  }
+  float rate = 1.0f + kGainPerSecond * error.InSecondsF();
+  return std::min(kMaxRate, std::max(kMinRate, rate));
+}
+
+// static
+base::Time LiveLatencyController::GetAvailabilityTime(
+    base::Time availability_start,
+    base::TimeDelta period_start,
+    base::TimeDelta pto,
+    base::TimeDelta media_time) {
+  return availability_start + period_start + (media_time - pto);
+}
+
+}  // namespace ndash
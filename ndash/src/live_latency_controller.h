@@ -0,0 +1,73 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NDASH_LIVE_LATENCY_CONTROLLER_H_
+#define NDASH_LIVE_LATENCY_CONTROLLER_H_
+
+#include "base/time/time.h"
+
+namespace ndash {
+
+// Holds a live stream at a target distance behind the live edge. ndash does
+// not own the presentation clock, so rather than changing the rate itself it
+// suggests one for the client to render at: slightly faster when playback has
+// drifted behind the target, slightly slower when it is too close to the edge.
+// This is unrelated to PlaybackRate, which selects trick play.
+class LiveLatencyController {
+ public:
+  // Latencies this close to the target are left alone.
+  static constexpr int64_t kToleranceMs = 100;
+  // Rate change per second of latency error.
+  static constexpr float kGainPerSecond = 0.1f;
+  // Bounds on the suggested rate, kept small enough to go unnoticed.
+  static constexpr float kMinRate = 0.95f;
+  static constexpr float kMaxRate = 1.1f;
+
+  explicit LiveLatencyController(base::TimeDelta target_latency);
+  ~LiveLatencyController();
+
+  // Records the current distance between the live edge and the playback
+  // position.
+  void UpdateLatency(base::TimeDelta latency);
+  // Forgets the measured latency, e.g. after a seek.
+  void Reset();
+
+  base::TimeDelta target_latency() const { return target_latency_; }
+  bool has_latency() const { return has_latency_; }
+  base::TimeDelta latency() const { return latency_; }
+
+  // Returns the rate the client should render at, 1 when on target or when no
+  // latency has been measured.
+  float GetCatchupRate() const;
+
+  // Returns the wall-clock time at which the media at |media_time| on the
+  // timeline of a representation became available: |availability_start|,
+  // plus the start of its period, plus |media_time| less the
+  // presentationTimeOffset |pto| of the representation.
+  static base::Time GetAvailabilityTime(base::Time availability_start,
+                                        base::TimeDelta period_start,
+                                        base::TimeDelta pto,
+                                        base::TimeDelta media_time);
+
+ private:
+  const base::TimeDelta target_latency_;
+  bool has_latency_ = false;
+  base::TimeDelta latency_;
+};
+
+}  // namespace ndash
+
+#endif  // NDASH_LIVE_LATENCY_CONTROLLER_H_
@@ -0,0 +1,109 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "live_latency_controller.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace ndash {
+
+using ::testing::Eq;
+using ::testing::FloatEq;
+using ::testing::Gt;
+using ::testing::Lt;
+
+namespace {
+base::TimeDelta Ms(int64_t ms) {
+  return base::TimeDelta::FromMilliseconds(ms);
+}
+}  // namespace
+
+TEST(LiveLatencyControllerTest, NormalRateWithoutLatency) {
+  LiveLatencyController controller(Ms(1500));
+
+  EXPECT_THAT(controller.target_latency(), Eq(Ms(1500)));
+  EXPECT_THAT(controller.has_latency(), Eq(false));
+  EXPECT_THAT(controller.GetCatchupRate(), FloatEq(1.0f));
+}
+
+TEST(LiveLatencyControllerTest, NormalRateWithinTolerance) {
+  LiveLatencyController controller(Ms(1500));
+
+  controller.UpdateLatency(Ms(1500));
+  EXPECT_THAT(controller.GetCatchupRate(), FloatEq(1.0f));
+  controller.UpdateLatency(
+      Ms(1500 + LiveLatencyController::kToleranceMs));
+  EXPECT_THAT(controller.GetCatchupRate(), FloatEq(1.0f));
+  controller.UpdateLatency(
+      Ms(1500 - LiveLatencyController::kToleranceMs));
+  EXPECT_THAT(controller.GetCatchupRate(), FloatEq(1.0f));
+}
+
+TEST(LiveLatencyControllerTest, SpeedsUpWhenBehind) {
+  LiveLatencyController controller(Ms(1500));
+
+  controller.UpdateLatency(Ms(2000));
+  float small_error_rate = controller.GetCatchupRate();
+  EXPECT_THAT(small_error_rate, Gt(1.0f));
+  EXPECT_THAT(small_error_rate,
+              FloatEq(1.0f + LiveLatencyController::kGainPerSecond * 0.5f));
+
+  // Large errors are capped.
+  controller.UpdateLatency(Ms(60000));
+  EXPECT_THAT(controller.GetCatchupRate(),
+              FloatEq(LiveLatencyController::kMaxRate));
+}
+
+TEST(LiveLatencyControllerTest, SlowsDownWhenAhead) {
+  LiveLatencyController controller(Ms(1500));
+
+  controller.UpdateLatency(Ms(1000));
+  EXPECT_THAT(controller.GetCatchupRate(), Lt(1.0f));
+
+  controller.UpdateLatency(Ms(-5000));
+  EXPECT_THAT(controller.GetCatchupRate(),
+              FloatEq(LiveLatencyController::kMinRate));
+}
+
+TEST(LiveLatencyControllerTest, Reset) {
+  LiveLatencyController controller(Ms(1500));
+
+  controller.UpdateLatency(Ms(5000));
+  EXPECT_THAT(controller.has_latency(), Eq(true));
+  EXPECT_THAT(controller.latency(), Eq(Ms(5000)));
+
+  controller.Reset();
+  EXPECT_THAT(controller.has_latency(), Eq(false));
+  EXPECT_THAT(controller.GetCatchupRate(), FloatEq(1.0f));
+}
+
+TEST(LiveLatencyControllerTest, AvailabilityTimeThroughPeriodAndOffset) {
+  base::Time availability_start =
+      base::Time::UnixEpoch() + base::TimeDelta::FromDays(17000);
+
+  // The first period starts with the stream and its media starts at 0.
+  EXPECT_THAT(LiveLatencyController::GetAvailabilityTime(
+                  availability_start, Ms(0), Ms(0), Ms(12000)),
+              Eq(availability_start + Ms(12000)));
+
+  // The same media time in a second period, 100s in, whose representation
+  // has a presentationTimeOffset of 7s, is 5s into that period.
+  EXPECT_THAT(LiveLatencyController::GetAvailabilityTime(
+                  availability_start, Ms(100000), Ms(7000), Ms(12000)),
+              Eq(availability_start + Ms(105000)));
+}
+
+}  // namespace ndash
@@ -16,7 +16,10 @@
 
 #include "load_control.h"
 
+#include <algorithm>
+
 #include "base/logging.h"
+#include "memory_governor.h"
 
 namespace {
 
@@ -73,7 +76,33 @@ LoadControl::LoadControl(upstream::AllocatorInterface* allocator,
       filling_buffers_(false),
       last_loading_notify_(false) {}
 
-LoadControl::~LoadControl() {}
+LoadControl::~LoadControl() {
+  if (governor_) {
+    governor_->Unregister(this);
+  }
+}
+
+void LoadControl::SetMemoryGovernor(MemoryGovernor* governor, int priority) {
+  DCHECK(!governor_);
+  DCHECK(loaders_.empty());
+  governor_ = governor;
+  governor_->Register(this, priority);
+}
+
+int32_t LoadControl::GetTargetBufferSize() const {
+  if (!governor_) {
+    return target_buffer_size_;
+  }
+  return std::min<int64_t>(target_buffer_size_, governor_->GetLimit(this));
+}
+
+bool LoadControl::IsWithinMemoryBudget() const {
+  if (!governor_) {
+    return true;
+  }
+  size_t budget = governor_->GetBudget();
+  return budget == 0 || governor_->GetTotalBytesAllocated() < budget;
+}
 
 void LoadControl::Register(upstream::LoaderInterface* loader,
                            int32_t buffer_size_contribution) {
@@ -81,6 +110,9 @@ void LoadControl::Register(upstream::LoaderInterface* loader,
   loader_states_[loader] =
       std::unique_ptr<LoaderState>(new LoaderState(buffer_size_contribution));
   target_buffer_size_ += buffer_size_contribution;
+  if (governor_) {
+    governor_->SetRequest(this, target_buffer_size_);
+  }
 }
 
 void LoadControl::Unregister(upstream::LoaderInterface* loader) {
@@ -90,14 +122,17 @@ void LoadControl::Unregister(upstream::LoaderInterface* loader) {
   LoaderState* state = loader_states_[loader].get();
   target_buffer_size_ -= state->buffer_size_contribution;
   loader_states_.erase(loader);
+  if (governor_) {
+    governor_->SetRequest(this, target_buffer_size_);
+  }
   UpdateControlState();
 }
 
 void LoadControl::TrimAllocator() {
-  allocator_->Trim(target_buffer_size_);
+  allocator_->Trim(GetTargetBufferSize());
 }
 
-upstream::AllocatorInterface* LoadControl::GetAllocator() {
+upstream::AllocatorInterface* LoadControl::GetAllocator() const {
   return allocator_;
 }
 
@@ -123,9 +158,14 @@ bool LoadControl::Update(upstream::LoaderInterface* loader,
     loader_state->loading = loading;
   }
 
+  // Under memory pressure other sessions may have shrunk our target, which
+  // holds back loads until playback brings the buffer under it.
+  int32_t target_buffer_size = GetTargetBufferSize();
+
   // Update the buffer state.
   size_t current_buffer_size = allocator_->GetTotalBytesAllocated();
-  int32_t buffer_state = GetBufferState(current_buffer_size);
+  int32_t buffer_state =
+      GetBufferState(current_buffer_size, target_buffer_size);
   bool buffer_state_changed = buffer_state_ != buffer_state;
 
   if (buffer_state_changed) {
@@ -141,16 +181,27 @@ bool LoadControl::Update(upstream::LoaderInterface* loader,
   }
 
   VLOG(1) << "current_buffer_size " << current_buffer_size
-          << " target_buffer_size_ " << target_buffer_size_
+          << " target_buffer_size " << target_buffer_size
           << " playback_position_us " << playback_position_us
           << " next_load_position_us " << next_load_position_us
           << " max_load_start_position_us_ " << max_load_start_position_us_;
 
-  return current_buffer_size < (size_t)target_buffer_size_ &&
+  return current_buffer_size < (size_t)target_buffer_size &&
          next_load_position_us != -1 &&
          next_load_position_us <= max_load_start_position_us_;
 }
 
+void LoadControl::GetLoadAllowance(int64_t playback_position_us,
+                                   int64_t next_load_position_us,
+                                   int64_t* duration_us,
+                                   int64_t* bytes) const {
+  *duration_us = std::max<int64_t>(
+      0, playback_position_us + high_watermark_us_ - next_load_position_us);
+  *bytes = std::max<int64_t>(
+      0, static_cast<int64_t>(GetTargetBufferSize()) -
+             static_cast<int64_t>(allocator_->GetTotalBytesAllocated()));
+}
+
 int32_t LoadControl::GetLoaderBufferState(int64_t playback_position_us,
                                           int64_t next_load_position_us) {
   if (next_load_position_us == -1) {
@@ -166,8 +217,9 @@ int32_t LoadControl::GetLoaderBufferState(int64_t playback_position_us,
   }
 }
 
-int32_t LoadControl::GetBufferState(int32_t current_buffer_size) {
-  float buffer_load = (float)current_buffer_size / target_buffer_size_;
+int32_t LoadControl::GetBufferState(int32_t current_buffer_size,
+                                    int32_t target_buffer_size) {
+  float buffer_load = (float)current_buffer_size / target_buffer_size;
   return buffer_load > high_buffer_load_
              ? kAboveHighWatermark
              : buffer_load < low_buffer_load_ ? kBelowLowWatermark
@@ -35,6 +35,8 @@
 
 namespace ndash {
 
+class MemoryGovernor;
+
 // Interface definition for a callback to be notified of LoadControl events.
 class LoadControlEventListenerInterface {
  public:
@@ -111,15 +113,34 @@ class LoadControl {
                 int32_t buffer_size_contribution);
   void Unregister(upstream::LoaderInterface* loader);
   void TrimAllocator();
-  upstream::AllocatorInterface* GetAllocator();
+  upstream::AllocatorInterface* GetAllocator() const;
+
+  // Limits the buffer to what |governor| allows, sharing its budget with the
+  // other sessions at |priority|. Must be called before any loader registers.
+  void SetMemoryGovernor(MemoryGovernor* governor, int priority);
+  // Returns the number of bytes the loaders may fill: the sum of their
+  // contributions, less any cut made by the memory governor.
+  int32_t GetTargetBufferSize() const;
+  // Returns whether all the sessions sharing the memory governor's budget
+  // together hold less than it. Always true without a governor or budget.
+  bool IsWithinMemoryBudget() const;
 
   bool Update(upstream::LoaderInterface* loader,
               int64_t playback_position_us,
               int64_t next_load_position_us,
               bool loading);
 
+  // Returns in |duration_us| how much media a loader at
+  // |next_load_position_us| can add before reaching the high watermark, and in
+  // |bytes| how much room is left in the buffer. Both are zero once full.
+  void GetLoadAllowance(int64_t playback_position_us,
+                        int64_t next_load_position_us,
+                        int64_t* duration_us,
+                        int64_t* bytes) const;
+
  private:
   upstream::AllocatorInterface* allocator_;
+  MemoryGovernor* governor_ = nullptr;
   // TODO(rmrossi): Consider eliminating the set and iterate over map keys
   // instead.
   std::set<upstream::LoaderInterface*> loaders_;
@@ -140,7 +161,8 @@ class LoadControl {
 
   int32_t GetLoaderBufferState(int64_t playbackPositionUs,
                                int64_t nextLoadPositionUs);
-  int32_t GetBufferState(int32_t currentBufferSize);
+  int32_t GetBufferState(int32_t current_buffer_size,
+                         int32_t target_buffer_size);
   void UpdateControlState();
   void NotifyLoadingChanged(bool loading);
 };
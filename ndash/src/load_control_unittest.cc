@@ -175,4 +175,29 @@ TEST(LoadControlTests, LoadControlListener) {
   EXPECT_THAT(loading, Eq(false));
 }
 
+TEST(LoadControlTests, LoadAllowance) {
+  upstream::MockAllocator allocator;
+  LoadControl load_control(&allocator, nullptr, 15000, 30000, 0.2, 0.8);
+  upstream::MockLoaderInterface mock_loader;
+  load_control.Register(&mock_loader, 1024 * 100);
+
+  int64_t duration_us;
+  int64_t bytes;
+  EXPECT_CALL(allocator, GetTotalBytesAllocated())
+      .WillRepeatedly(Return(1024 * 40));
+  load_control.GetLoadAllowance(util::kMicrosPerSecond * 5,
+                                util::kMicrosPerSecond * 20, &duration_us,
+                                &bytes);
+  EXPECT_THAT(duration_us, Eq(util::kMicrosPerSecond * 15));
+  EXPECT_THAT(bytes, Eq(1024 * 60));
+
+  // Past the high watermark, or with the buffer full, there is no room.
+  EXPECT_CALL(allocator, GetTotalBytesAllocated())
+      .WillRepeatedly(Return(1024 * 120));
+  load_control.GetLoadAllowance(0, util::kMicrosPerSecond * 40, &duration_us,
+                                &bytes);
+  EXPECT_THAT(duration_us, Eq(0));
+  EXPECT_THAT(bytes, Eq(0));
+}
+
 }  // namespace ndash
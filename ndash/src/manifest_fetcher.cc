@@ -16,18 +16,30 @@
 
 #include "manifest_fetcher.h"
 
+#include <utility>
+
 #include "base/bind.h"
 #include "base/callback_helpers.h"
+#include "base/trace_event/trace_event.h"
 #include "upstream/constants.h"
 #include "upstream/curl_data_source.h"
 #include "upstream/data_spec.h"
+#include "upstream/default_uri_data_source.h"
+#include "upstream/network_trace.h"
 
 namespace ndash {
 
 constexpr size_t kBufSize = 8192;
 
-ManifestLoadable::ManifestLoadable(const std::string& manifest_uri)
-    : manifest_uri_(manifest_uri) {
+ManifestLoadable::ManifestLoadable(
+    const std::string& manifest_uri,
+    scoped_refptr<base::TaskRunner> curl_task_runner,
+    upstream::NetworkTrace* network_trace,
+    const util::ThreadConfig* thread_config)
+    : manifest_uri_(manifest_uri),
+      curl_task_runner_(curl_task_runner),
+      network_trace_(network_trace),
+      thread_config_(thread_config) {
   load_buffer_ = std::unique_ptr<char[]>(new char[kBufSize + 1]);
 }
 
@@ -42,24 +54,34 @@ bool ManifestLoadable::IsLoadCanceled() const {
 }
 
 bool ManifestLoadable::Load() {
+  TRACE_EVENT1("ndash", "ManifestLoadable::Load", "uri", manifest_uri_);
   upstream::Uri uri(manifest_uri_);
   upstream::DataSpec manifest_spec(uri);
-  upstream::CurlDataSource data_source("manifest");
-  if (data_source.Open(manifest_spec) != upstream::RESULT_IO_ERROR) {
+  std::unique_ptr<upstream::HttpDataSourceInterface> data_source(
+      new upstream::DefaultUriDataSource(
+          std::unique_ptr<upstream::HttpDataSourceInterface>(
+              new upstream::CurlDataSource(
+                  "manifest", nullptr, false,
+                  upstream::CurlDataSource::kDefaultMaxBufLength,
+                  curl_task_runner_, thread_config_))));
+  if (network_trace_) {
+    data_source = network_trace_->Wrap(std::move(data_source), nullptr);
+  }
+  if (data_source->Open(manifest_spec) != upstream::RESULT_IO_ERROR) {
     ssize_t num_read;
 
     do {
-      num_read = data_source.Read(load_buffer_.get(), kBufSize - 1);
+      num_read = data_source->Read(load_buffer_.get(), kBufSize - 1);
       if (num_read > 0) {
         load_buffer_[num_read] = '\0';
         manifest_xml_.append(load_buffer_.get());
       }
     } while (num_read != upstream::RESULT_END_OF_INPUT &&
              num_read != upstream::RESULT_IO_ERROR);
-    data_source.Close();
+    data_source->Close();
     return true;
   }
-  data_source.Close();
+  data_source->Close();
   return false;
 }
 
@@ -73,15 +95,25 @@ const std::string& ManifestLoadable::GetManifestXml() const {
 
 ManifestFetcher::ManifestFetcher(const std::string& manifest_uri,
                                  scoped_refptr<base::TaskRunner> task_runner,
-                                 EventListenerInterface* event_listener)
-    : loader_("manifest_loader"),
+                                 EventListenerInterface* event_listener,
+                                 upstream::LoaderPool* loader_pool,
+                                 const util::ThreadConfig* thread_config)
+    : loader_pool_(loader_pool),
+      thread_config_(thread_config),
+      loader_(loader_pool ? new upstream::LoaderThread(
+                                loader_pool->loader_task_runner())
+                          : new upstream::LoaderThread("manifest_loader",
+                                                       thread_config)),
       manifest_uri_(manifest_uri),
       task_runner_(task_runner),
       event_listener_(event_listener),
       load_error_(NONE),
       load_error_count_(0) {}
 
-ManifestFetcher::~ManifestFetcher() {}
+ManifestFetcher::~ManifestFetcher() {
+  // Wait for any load in flight before |current_loadable_| is destroyed.
+  loader_.reset();
+}
 
 void ManifestFetcher::UpdateManifestUri(const std::string& manifest_uri) {
   manifest_uri_ = manifest_uri;
@@ -110,13 +142,15 @@ bool ManifestFetcher::RequestRefresh() {
     return false;
   }
 
-  if (!loader_.IsLoading()) {
+  if (!loader_->IsLoading()) {
     // TODO(rmrossi): Consider re-using the loadable rather than creating one
     // with each request.
-    current_loadable_ =
-        std::unique_ptr<ManifestLoadable>(new ManifestLoadable(manifest_uri_));
+    current_loadable_ = std::unique_ptr<ManifestLoadable>(new ManifestLoadable(
+        manifest_uri_,
+        loader_pool_ ? loader_pool_->network_task_runner() : nullptr,
+        network_trace_, thread_config_));
     current_load_start_timestamp_ = now;
-    loader_.StartLoading(
+    loader_->StartLoading(
         current_loadable_.get(),
         base::Bind(&ManifestFetcher::LoadComplete, base::Unretained(this)));
     NotifyManifestRefreshStarted();
@@ -157,7 +191,7 @@ void ManifestFetcher::Enable() {
 void ManifestFetcher::Disable() {
   DCHECK_GT(enabled_count_, 0);
   if (--enabled_count_ == 0) {
-    loader_.CancelLoading();
+    loader_->CancelLoading();
   }
 }
 
@@ -165,8 +199,12 @@ void ManifestFetcher::ProcessLoadCompleted() {
   const std::string& xml = current_loadable_->GetManifestXml();
 
   base::TimeTicks now = base::TimeTicks::Now();
-  manifest_ = parser_.Parse(current_loadable_->GetManifestUri(),
-                            base::StringPiece(xml));
+  {
+    TRACE_EVENT1("ndash", "MediaPresentationDescriptionParser::Parse",
+                 "bytes", xml.size());
+    manifest_ = parser_.Parse(current_loadable_->GetManifestUri(),
+                              base::StringPiece(xml));
+  }
 
   if (manifest_.get() != nullptr) {
     manifest_load_start_timestamp_ = current_load_start_timestamp_;
@@ -25,14 +25,32 @@
 #include "base/time/time.h"
 #include "mpd/dash_manifest_representation_parser.h"
 #include "mpd/media_presentation_description.h"
+#include "upstream/loader_pool.h"
 #include "upstream/loader_thread.h"
 
 namespace ndash {
 
+namespace upstream {
+class NetworkTrace;
+}  // namespace upstream
+
+namespace util {
+class ThreadConfig;
+}  // namespace util
+
 // A loadable that buffers a manifest xml document.
 class ManifestLoadable : public upstream::LoadableInterface {
  public:
-  ManifestLoadable(const std::string& manifest_uri);
+  // curl_task_runner: runs the transfer on a shared pool instead of a
+  // dedicated CURL thread (nullptr if none).
+  // network_trace: records or replays the transfer (nullptr if none).
+  // thread_config: how to start the CURL thread (nullptr for the settings of
+  // all players).
+  ManifestLoadable(
+      const std::string& manifest_uri,
+      scoped_refptr<base::TaskRunner> curl_task_runner = nullptr,
+      upstream::NetworkTrace* network_trace = nullptr,
+      const util::ThreadConfig* thread_config = nullptr);
   ~ManifestLoadable() override;
 
   void CancelLoad() override;
@@ -45,6 +63,9 @@ class ManifestLoadable : public upstream::LoadableInterface {
   std::unique_ptr<char[]> load_buffer_;
   std::string manifest_uri_;
   std::string manifest_xml_;
+  scoped_refptr<base::TaskRunner> curl_task_runner_;
+  upstream::NetworkTrace* network_trace_;
+  const util::ThreadConfig* thread_config_;
 };
 
 class EventListenerInterface;
@@ -63,11 +84,22 @@ class ManifestFetcher {
 
   // Create a new manifest fetcher for the given manifest uri.
   // Callback events will be posted to the the given task_runner.
+  // If |loader_pool| is given, loads run on its shared threads. Otherwise
+  // its threads are started with |thread_config| (if given, it must outlive
+  // this object).
   ManifestFetcher(const std::string& manifest_uri,
                   scoped_refptr<base::TaskRunner> task_runner,
-                  EventListenerInterface* event_listener = nullptr);
+                  EventListenerInterface* event_listener = nullptr,
+                  upstream::LoaderPool* loader_pool = nullptr,
+                  const util::ThreadConfig* thread_config = nullptr);
   ~ManifestFetcher();
 
+  // Records or replays manifest loads with |network_trace|, which must
+  // outlive this object.
+  void SetNetworkTrace(upstream::NetworkTrace* network_trace) {
+    network_trace_ = network_trace;
+  }
+
   // Change the manifest uri this manifest fetcher is fetching from.
   void UpdateManifestUri(const std::string& manifest_uri);
 
@@ -104,7 +136,10 @@ class ManifestFetcher {
   void Disable();
 
  private:
-  upstream::LoaderThread loader_;
+  upstream::LoaderPool* loader_pool_;
+  const util::ThreadConfig* thread_config_;
+  upstream::NetworkTrace* network_trace_ = nullptr;
+  std::unique_ptr<upstream::LoaderThread> loader_;
   mpd::MediaPresentationDescriptionParser parser_;
 
   std::string manifest_uri_;
@@ -0,0 +1,143 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "memory_governor.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "base/lazy_instance.h"
+#include "base/logging.h"
+#include "load_control.h"
+
+namespace ndash {
+
+namespace {
+base::LazyInstance<MemoryGovernor>::Leaky g_governor =
+    LAZY_INSTANCE_INITIALIZER;
+}  // namespace
+
+constexpr int MemoryGovernor::kDefaultPriority;
+
+// static
+MemoryGovernor* MemoryGovernor::GetInstance() {
+  return g_governor.Pointer();
+}
+
+MemoryGovernor::MemoryGovernor() {}
+
+MemoryGovernor::~MemoryGovernor() {
+  DCHECK(clients_.empty());
+}
+
+void MemoryGovernor::SetBudget(size_t budget) {
+  base::AutoLock auto_lock(lock_);
+  budget_ = budget;
+  Rebalance();
+}
+
+size_t MemoryGovernor::GetBudget() const {
+  base::AutoLock auto_lock(lock_);
+  return budget_;
+}
+
+void MemoryGovernor::Register(LoadControl* load_control, int priority) {
+  base::AutoLock auto_lock(lock_);
+  DCHECK(clients_.find(load_control) == clients_.end());
+  clients_[load_control].priority = std::max(priority, 1);
+  Rebalance();
+}
+
+void MemoryGovernor::Unregister(LoadControl* load_control) {
+  base::AutoLock auto_lock(lock_);
+  DCHECK(clients_.find(load_control) != clients_.end());
+  clients_.erase(load_control);
+  Rebalance();
+}
+
+void MemoryGovernor::SetRequest(LoadControl* load_control, size_t request) {
+  base::AutoLock auto_lock(lock_);
+  auto it = clients_.find(load_control);
+  DCHECK(it != clients_.end());
+  it->second.request = request;
+  Rebalance();
+}
+
+size_t MemoryGovernor::GetLimit(const LoadControl* load_control) const {
+  base::AutoLock auto_lock(lock_);
+  auto it = clients_.find(const_cast<LoadControl*>(load_control));
+  return it == clients_.end() ? 0 : it->second.limit;
+}
+
+size_t MemoryGovernor::GetTotalBytesAllocated() const {
+  base::AutoLock auto_lock(lock_);
+  size_t total = 0;
+  for (const auto& client : clients_) {
+    total += client.first->GetAllocator()->GetTotalBytesAllocated();
+  }
+  return total;
+}
+
+void MemoryGovernor::Rebalance() {
+  lock_.AssertAcquired();
+
+  size_t total_request = 0;
+  for (const auto& client : clients_) {
+    total_request += client.second.request;
+  }
+  if (budget_ == 0 || total_request <= budget_) {
+    for (auto& client : clients_) {
+      client.second.limit = client.second.request;
+    }
+    return;
+  }
+
+  // Water-filling: meet every request smaller than its share of what is left,
+  // then divide the remainder among the rest by priority.
+  std::vector<Client*> unmet;
+  for (auto& client : clients_) {
+    unmet.push_back(&client.second);
+  }
+  size_t remaining = budget_;
+  while (true) {
+    int total_priority = 0;
+    for (const Client* client : unmet) {
+      total_priority += client->priority;
+    }
+    double per_priority = static_cast<double>(remaining) / total_priority;
+
+    std::vector<Client*> still_unmet;
+    for (Client* client : unmet) {
+      if (client->request <= client->priority * per_priority) {
+        client->limit = client->request;
+        remaining -= client->request;
+      } else {
+        still_unmet.push_back(client);
+      }
+    }
+    if (still_unmet.size() == unmet.size()) {
+      for (Client* client : unmet) {
+        client->limit = static_cast<size_t>(client->priority * per_priority);
+      }
+      break;
+    }
+    unmet.swap(still_unmet);
+  }
+  VLOG(1) << "Over memory budget: " << total_request << " bytes requested, "
+          << budget_ << " available";
+}
+
+}  // namespace ndash
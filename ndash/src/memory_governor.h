@@ -0,0 +1,88 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NDASH_MEMORY_GOVERNOR_H_
+#define NDASH_MEMORY_GOVERNOR_H_
+
+#include <cstddef>
+#include <map>
+
+#include "base/synchronization/lock.h"
+
+namespace ndash {
+
+class LoadControl;
+
+// Shares a byte budget for buffered media between the LoadControls of every
+// session in the process, so that running several players at once (e.g. for
+// picture-in-picture) makes their buffers shallower instead of running out of
+// memory.
+//
+// Each LoadControl asks for the sum of its tracks' buffer sizes. While all the
+// requests fit in the budget, each is met. Otherwise the budget is divided in
+// proportion to priority; a request smaller than its share is met in full and
+// the rest is divided among the others. Safe to use from any thread.
+class MemoryGovernor {
+ public:
+  static constexpr int kDefaultPriority = 1;
+
+  // Returns the governor shared by all sessions. It has no budget until
+  // SetBudget() is called.
+  static MemoryGovernor* GetInstance();
+
+  MemoryGovernor();
+  ~MemoryGovernor();
+
+  // Sets the number of bytes that all sessions together may buffer, or 0 for
+  // no limit.
+  void SetBudget(size_t budget);
+  size_t GetBudget() const;
+
+  // Adds |load_control| with |priority| (at least 1). It asks for nothing
+  // until SetRequest() is called.
+  void Register(LoadControl* load_control, int priority);
+  void Unregister(LoadControl* load_control);
+
+  // Sets how many bytes |load_control| would buffer if there were no budget.
+  void SetRequest(LoadControl* load_control, size_t request);
+  // Returns how many bytes |load_control| may buffer.
+  size_t GetLimit(const LoadControl* load_control) const;
+
+  // Returns the bytes allocated by the allocators of all the registered
+  // LoadControls.
+  size_t GetTotalBytesAllocated() const;
+
+  MemoryGovernor(const MemoryGovernor& other) = delete;
+  MemoryGovernor& operator=(const MemoryGovernor& other) = delete;
+
+ private:
+  struct Client {
+    int priority = kDefaultPriority;
+    size_t request = 0;
+    size_t limit = 0;
+  };
+
+  // Recomputes every client's limit. Called with |lock_| held.
+  void Rebalance();
+
+  mutable base::Lock lock_;  // Protects everything below
+  size_t budget_ = 0;
+  std::map<LoadControl*, Client> clients_;
+};
+
+}  // namespace ndash
+
+#endif  // NDASH_MEMORY_GOVERNOR_H_
@@ -0,0 +1,150 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "memory_governor.h"
+
+#include <memory>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "load_control.h"
+#include "upstream/allocator_mock.h"
+#include "upstream/loader_mock.h"
+
+using ::testing::Return;
+
+namespace ndash {
+
+namespace {
+
+// One session: a LoadControl with a single loader asking for |request|
+// bytes.
+struct Session {
+  Session(MemoryGovernor* governor, int priority, int32_t request)
+      : load_control(&allocator) {
+    EXPECT_CALL(allocator, GetTotalBytesAllocated())
+        .WillRepeatedly(Return(0));
+    load_control.SetMemoryGovernor(governor, priority);
+    load_control.Register(&loader, request);
+  }
+  ~Session() { load_control.Unregister(&loader); }
+
+  upstream::MockAllocator allocator;
+  upstream::MockLoaderInterface loader;
+  LoadControl load_control;
+};
+
+}  // namespace
+
+TEST(MemoryGovernorTest, MeetsRequestsWithinBudget) {
+  MemoryGovernor governor;
+  Session a(&governor, 1, 1000);
+  Session b(&governor, 1, 2000);
+
+  // No budget, then one that fits everything.
+  EXPECT_EQ(1000, a.load_control.GetTargetBufferSize());
+  EXPECT_EQ(2000, b.load_control.GetTargetBufferSize());
+  governor.SetBudget(3000);
+  EXPECT_EQ(1000, a.load_control.GetTargetBufferSize());
+  EXPECT_EQ(2000, b.load_control.GetTargetBufferSize());
+}
+
+TEST(MemoryGovernorTest, DividesBudgetBetweenSessions) {
+  const size_t kBudget = 10000;
+  MemoryGovernor governor;
+  governor.SetBudget(kBudget);
+
+  std::vector<std::unique_ptr<Session>> sessions;
+  for (int i = 0; i < 4; i++) {
+    sessions.emplace_back(new Session(&governor, 1, 8000));
+  }
+  size_t total = 0;
+  for (const auto& session : sessions) {
+    EXPECT_EQ(2500, session->load_control.GetTargetBufferSize());
+    total += session->load_control.GetTargetBufferSize();
+  }
+  EXPECT_LE(total, kBudget);
+
+  // Closing sessions gives the budget back to the rest.
+  sessions.pop_back();
+  sessions.pop_back();
+  EXPECT_EQ(5000, sessions[0]->load_control.GetTargetBufferSize());
+  EXPECT_EQ(5000, sessions[1]->load_control.GetTargetBufferSize());
+  sessions.pop_back();
+  EXPECT_EQ(8000, sessions[0]->load_control.GetTargetBufferSize());
+}
+
+TEST(MemoryGovernorTest, SharesByPriority) {
+  MemoryGovernor governor;
+  governor.SetBudget(8000);
+  Session main(&governor, 3, 8000);
+  Session pip(&governor, 1, 8000);
+
+  EXPECT_EQ(6000, main.load_control.GetTargetBufferSize());
+  EXPECT_EQ(2000, pip.load_control.GetTargetBufferSize());
+}
+
+TEST(MemoryGovernorTest, MeetsSmallRequestsInFull) {
+  MemoryGovernor governor;
+  governor.SetBudget(9000);
+  Session small(&governor, 1, 1000);
+  Session big1(&governor, 1, 8000);
+  Session big2(&governor, 1, 8000);
+
+  // The small session needs less than a third, so the big ones split what
+  // it leaves.
+  EXPECT_EQ(1000, small.load_control.GetTargetBufferSize());
+  EXPECT_EQ(4000, big1.load_control.GetTargetBufferSize());
+  EXPECT_EQ(4000, big2.load_control.GetTargetBufferSize());
+}
+
+TEST(MemoryGovernorTest, HoldsBackLoadsWhenCut) {
+  MemoryGovernor governor;
+  Session a(&governor, 1, 8000);
+  EXPECT_CALL(a.loader, IsLoading()).WillRepeatedly(Return(false));
+  EXPECT_CALL(a.allocator, GetTotalBytesAllocated())
+      .WillRepeatedly(Return(5000));
+
+  EXPECT_TRUE(a.load_control.Update(&a.loader, 0, 0, false));
+
+  // Another session arrives under a budget; the first must shrink to 4000,
+  // below what it already holds.
+  governor.SetBudget(8000);
+  Session b(&governor, 1, 8000);
+  EXPECT_FALSE(a.load_control.Update(&a.loader, 0, 0, false));
+  EXPECT_FALSE(a.load_control.Update(&a.loader, 0, 0, false));
+}
+
+TEST(MemoryGovernorTest, ReportsWhenBudgetUsedUp) {
+  MemoryGovernor governor;
+  Session a(&governor, 1, 8000);
+  Session b(&governor, 1, 8000);
+  EXPECT_CALL(a.allocator, GetTotalBytesAllocated())
+      .WillRepeatedly(Return(3000));
+  EXPECT_CALL(b.allocator, GetTotalBytesAllocated())
+      .WillRepeatedly(Return(2000));
+
+  // Without a budget there is always room.
+  EXPECT_TRUE(a.load_control.IsWithinMemoryBudget());
+  governor.SetBudget(6000);
+  EXPECT_TRUE(a.load_control.IsWithinMemoryBudget());
+  // Both sessions count, whichever asks.
+  governor.SetBudget(5000);
+  EXPECT_FALSE(a.load_control.IsWithinMemoryBudget());
+  EXPECT_FALSE(b.load_control.IsWithinMemoryBudget());
+}
+
+}  // namespace ndash
@@ -0,0 +1,56 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NDASH_MPD_BASE_URL_H_
+#define NDASH_MPD_BASE_URL_H_
+
+#include <cstdint>
+#include <string>
+
+namespace ndash {
+
+namespace mpd {
+
+// One of the alternative locations a representation's segments can be
+// fetched from, as given by a BaseURL element (resolved against those of the
+// enclosing elements). The attributes are the ones DVB-DASH defines for
+// choosing between CDNs.
+struct BaseUrl {
+  static constexpr int32_t kDefaultPriority = 1;
+  static constexpr int32_t kDefaultWeight = 1;
+
+  explicit BaseUrl(const std::string& url)
+      : url(url),
+        service_location(url),
+        priority(kDefaultPriority),
+        weight(kDefaultWeight) {}
+
+  // The resolved, absolute URL.
+  std::string url;
+  // Locations sharing a service location are served by the same CDN and
+  // fail together.
+  std::string service_location;
+  // Lower values are preferred.
+  int32_t priority;
+  // Relative preference among locations of equal priority.
+  int32_t weight;
+};
+
+}  // namespace mpd
+
+}  // namespace ndash
+
+#endif  // NDASH_MPD_BASE_URL_H_
@@ -92,7 +92,8 @@ MediaPresentationDescriptionParser::ParseMediaPresentationDescription(
   int64_t next_period_start_ms = dynamic ? -1 : 0;
   bool seen_early_access_period = false;
   bool seen_first_base_Url = false;
-  std::string base_url_override(base_url);
+  const std::vector<BaseUrl> base_urls(1, BaseUrl(base_url));
+  std::vector<BaseUrl> base_urls_override(base_urls);
 
   int ret;
   int parent_depth = xmlTextReaderDepth(reader);
@@ -106,9 +107,10 @@ MediaPresentationDescriptionParser::ParseMediaPresentationDescription(
     xmlNodePtr child = xmlTextReaderCurrentNode(reader);
     if (CurrentNodeNameEquals(reader, "BaseURL")) {
       if (!seen_first_base_Url) {
-        base_url_override = ParseBaseUrl(reader, base_url_override);
+        base_urls_override.clear();
         seen_first_base_Url = true;
       }
+      ParseBaseUrl(reader, base_urls, &base_urls_override);
     } else if (CurrentNodeNameEquals(reader, "SupplementalProperty")) {
       supplemental_properties.push_back(ParseDescriptorType(child));
     } else if (CurrentNodeNameEquals(reader, "EssentialProperty")) {
@@ -120,7 +122,7 @@ MediaPresentationDescriptionParser::ParseMediaPresentationDescription(
     } else if (CurrentNodeNameEquals(reader, "Period") &&
                !seen_early_access_period) {
       std::pair<std::unique_ptr<Period>, int64_t> period_with_duration_ms =
-          ParsePeriod(reader, base_url_override, next_period_start_ms);
+          ParsePeriod(reader, base_urls_override, next_period_start_ms);
       Period* period = period_with_duration_ms.first.get();
       if (period == nullptr) {
         LOG(FATAL) << "Could not parse period.";
@@ -219,9 +221,10 @@ MediaPresentationDescriptionParser::BuildDescriptorTypeElement(
 }
 
 std::pair<std::unique_ptr<Period>, int64_t>
-MediaPresentationDescriptionParser::ParsePeriod(xmlTextReaderPtr reader,
-                                                const std::string& base_url,
-                                                int64_t defaultStartMs) const {
+MediaPresentationDescriptionParser::ParsePeriod(
+    xmlTextReaderPtr reader,
+    const std::vector<BaseUrl>& base_urls,
+    int64_t defaultStartMs) const {
   xmlNodePtr node = xmlTextReaderCurrentNode(reader);
   std::string id = GetAttributeValue(node, "id");
   int64_t start_ms = ParseDuration(node, "start", defaultStartMs);
@@ -231,7 +234,8 @@ MediaPresentationDescriptionParser::ParsePeriod(xmlTextReaderPtr reader,
   std::vector<std::unique_ptr<AdaptationSet>> adaptation_sets;
   std::vector<std::unique_ptr<DescriptorType>> supplemental_properties;
 
-  std::string base_url_override(base_url);
+  std::vector<BaseUrl> base_urls_override(base_urls);
+  std::string base_url_override(base_urls.front().url);
   bool seen_first_base_url = false;
   int ret;
   int parent_depth = xmlTextReaderDepth(reader);
@@ -245,14 +249,16 @@ MediaPresentationDescriptionParser::ParsePeriod(xmlTextReaderPtr reader,
     xmlNodePtr child = xmlTextReaderCurrentNode(reader);
     if (NodeNameEquals(child, "BaseURL")) {
       if (!seen_first_base_url) {
-        base_url_override = ParseBaseUrl(reader, base_url_override);
+        base_urls_override.clear();
         seen_first_base_url = true;
       }
+      ParseBaseUrl(reader, base_urls, &base_urls_override);
+      base_url_override = base_urls_override.front().url;
     } else if (CurrentNodeNameEquals(reader, "SupplementalProperty")) {
       supplemental_properties.push_back(ParseDescriptorType(child));
     } else if (NodeNameEquals(child, "AdaptationSet")) {
       std::unique_ptr<AdaptationSet> adaptation_set =
-          ParseAdaptationSet(reader, base_url_override, segment_base.get());
+          ParseAdaptationSet(reader, base_urls_override, segment_base.get());
       if (adaptation_set.get() == nullptr) {
         return std::pair<std::unique_ptr<Period>, int64_t>(nullptr, -1);
       }
@@ -300,7 +306,7 @@ std::unique_ptr<Period> MediaPresentationDescriptionParser::BuildPeriod(
 std::unique_ptr<AdaptationSet>
 MediaPresentationDescriptionParser::ParseAdaptationSet(
     xmlTextReaderPtr reader,
-    const std::string& base_url,
+    const std::vector<BaseUrl>& base_urls,
     SegmentBase* segment_base) const {
   xmlNodePtr node = xmlTextReaderCurrentNode(reader);
   int32_t id;
@@ -344,7 +350,8 @@ MediaPresentationDescriptionParser::ParseAdaptationSet(
   std::unique_ptr<SegmentBase> segment_base_override;
   std::vector<std::unique_ptr<Representation>> representations;
 
-  std::string base_url_override(base_url);
+  std::vector<BaseUrl> base_urls_override(base_urls);
+  std::string base_url_override(base_urls.front().url);
   bool seen_first_base_Url = false;
   int ret;
   int parent_depth = xmlTextReaderDepth(reader);
@@ -358,9 +365,11 @@ MediaPresentationDescriptionParser::ParseAdaptationSet(
     xmlNodePtr child = xmlTextReaderCurrentNode(reader);
     if (NodeNameEquals(child, "BaseURL")) {
       if (!seen_first_base_Url) {
-        base_url_override = ParseBaseUrl(reader, base_url_override);
+        base_urls_override.clear();
         seen_first_base_Url = true;
       }
+      ParseBaseUrl(reader, base_urls, &base_urls_override);
+      base_url_override = base_urls_override.front().url;
     } else if (CurrentNodeNameEquals(reader, "SupplementalProperty")) {
       supplemental_properties.push_back(ParseDescriptorType(child));
     } else if (CurrentNodeNameEquals(reader, "EssentialProperty")) {
@@ -379,7 +388,7 @@ MediaPresentationDescriptionParser::ParseAdaptationSet(
           CheckContentTypeConsistency(content_type, ParseContentType(child));
     } else if (NodeNameEquals(child, "Representation")) {
       std::unique_ptr<Representation> representation = ParseRepresentation(
-          reader, base_url_override, mime_type, codecs, width, height,
+          reader, base_urls_override, mime_type, codecs, width, height,
           frame_rate, max_playout_rate, audio_channels, audio_sampling_rate,
           language, segment_base, &content_protections_builder);
       if (representation.get() == nullptr) {
@@ -538,7 +547,7 @@ MediaPresentationDescriptionParser::BuildContentProtection(
 std::unique_ptr<Representation>
 MediaPresentationDescriptionParser::ParseRepresentation(
     xmlTextReaderPtr reader,
-    const std::string& base_url,
+    const std::vector<BaseUrl>& base_urls,
     const std::string& adaptation_set_mime_type,
     const std::string& adaptation_set_codecs,
     int32_t adaptation_set_width,
@@ -602,7 +611,8 @@ MediaPresentationDescriptionParser::ParseRepresentation(
 
   std::unique_ptr<SegmentBase> segment_base_override;
 
-  std::string base_url_override(base_url);
+  std::vector<BaseUrl> base_urls_override(base_urls);
+  std::string base_url_override(base_urls.front().url);
   bool seen_first_base_Url = false;
   int ret;
   int parent_depth = xmlTextReaderDepth(reader);
@@ -616,9 +626,11 @@ MediaPresentationDescriptionParser::ParseRepresentation(
     xmlNodePtr child = xmlTextReaderCurrentNode(reader);
     if (NodeNameEquals(child, "BaseURL")) {
       if (!seen_first_base_Url) {
-        base_url_override = ParseBaseUrl(reader, base_url_override);
+        base_urls_override.clear();
         seen_first_base_Url = true;
       }
+      ParseBaseUrl(reader, base_urls, &base_urls_override);
+      base_url_override = base_urls_override.front().url;
     } else if (CurrentNodeNameEquals(reader, "SupplementalProperty")) {
       supplemental_properties.push_back(ParseDescriptorType(child));
     } else if (CurrentNodeNameEquals(reader, "EssentialProperty")) {
@@ -670,16 +682,22 @@ MediaPresentationDescriptionParser::ParseRepresentation(
     segment_base = segment_base_override.get();
   }
 
+  std::unique_ptr<Representation> representation;
   if (segment_base_override.get() != nullptr) {
     // The representation will own its own segment base.
-    return BuildRepresentation(content_id_, -1, format,
-                               std::move(segment_base_override),
-                               &supplemental_properties, &essential_properties);
+    representation = BuildRepresentation(
+        content_id_, -1, format, std::move(segment_base_override),
+        &supplemental_properties, &essential_properties);
   } else {
     // The representation will refer to a segment base owned by a higher level.
-    return BuildRepresentation(content_id_, -1, format, segment_base,
-                               &supplemental_properties, &essential_properties);
+    representation =
+        BuildRepresentation(content_id_, -1, format, segment_base,
+                            &supplemental_properties, &essential_properties);
   }
+  if (representation) {
+    representation->SetBaseUrls(std::move(base_urls_override));
+  }
+  return representation;
 }
 
 util::Format MediaPresentationDescriptionParser::BuildFormat(
@@ -1252,11 +1270,46 @@ int64_t MediaPresentationDescriptionParser::ParseDateTime(
   return default_value;
 }
 
-std::string MediaPresentationDescriptionParser::ParseBaseUrl(
+void MediaPresentationDescriptionParser::ParseBaseUrl(
     xmlTextReaderPtr reader,
-    const std::string& parent_base_url) {
+    const std::vector<BaseUrl>& parent_base_urls,
+    std::vector<BaseUrl>* base_urls) {
+  // The DVB attributes are matched by local name; xmlGetProp ignores
+  // namespaces.
+  xmlNodePtr node = xmlTextReaderCurrentNode(reader);
+  std::string service_location = GetAttributeValue(node, "serviceLocation");
+  int32_t priority;
+  int32_t weight;
+  bool has_priority =
+      ParseInt(node, "priority", &priority, -1) && priority != -1;
+  bool has_weight = ParseInt(node, "weight", &weight, -1) && weight != -1;
   std::string base_url = NextText(reader);
-  return util::UriUtil::Resolve(parent_base_url, base_url);
+
+  for (const BaseUrl& parent : parent_base_urls) {
+    BaseUrl resolved(util::UriUtil::Resolve(parent.url, base_url));
+    // A relative URL stays with its parent's CDN unless it says otherwise.
+    if (resolved.url != base_url) {
+      resolved.service_location = parent.service_location;
+      resolved.priority = parent.priority;
+      resolved.weight = parent.weight;
+    }
+    if (!service_location.empty()) {
+      resolved.service_location = service_location;
+    }
+    if (has_priority) {
+      resolved.priority = priority;
+    }
+    if (has_weight) {
+      resolved.weight = weight;
+    }
+    bool duplicate = false;
+    for (const BaseUrl& other : *base_urls) {
+      duplicate = duplicate || other.url == resolved.url;
+    }
+    if (!duplicate) {
+      base_urls->push_back(resolved);
+    }
+  }
 }
 
 bool MediaPresentationDescriptionParser::ParseInt(xmlNodePtr node,
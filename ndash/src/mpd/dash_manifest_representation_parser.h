@@ -25,6 +25,7 @@
 #include "base/memory/ref_counted.h"
 #include "base/strings/string_piece.h"
 #include "drm/scheme_init_data.h"
+#include "mpd/base_url.h"
 #include "mpd/content_protections_builder.h"
 #include "mpd/media_presentation_description.h"
 #include "mpd/segment_list.h"
@@ -74,7 +75,7 @@ class MediaPresentationDescriptionParser {
 
   std::pair<std::unique_ptr<Period>, int64_t> ParsePeriod(
       xmlTextReaderPtr reader,
-      const std::string& base_url,
+      const std::vector<BaseUrl>& base_urls,
       int64_t default_start_ms) const;
 
   std::unique_ptr<Period> BuildPeriod(
@@ -90,7 +91,7 @@ class MediaPresentationDescriptionParser {
   // Returns null on parsing error.
   std::unique_ptr<AdaptationSet> ParseAdaptationSet(
       xmlTextReaderPtr reader,
-      const std::string& base_url,
+      const std::vector<BaseUrl>& base_urls,
       SegmentBase* segment_base) const;
 
   std::unique_ptr<AdaptationSet> BuildAdaptationSet(
@@ -119,7 +120,7 @@ class MediaPresentationDescriptionParser {
 
   std::unique_ptr<Representation> ParseRepresentation(
       xmlTextReaderPtr reader,
-      const std::string& base_url,
+      const std::vector<BaseUrl>& base_urls,
       const std::string& adaptation_set_mime_type,
       const std::string& adaptation_set_codecs,
       int32_t adaptation_set_width,
@@ -267,8 +268,12 @@ class MediaPresentationDescriptionParser {
                                const std::string& name,
                                int64_t default_value);
 
-  static std::string ParseBaseUrl(xmlTextReaderPtr reader,
-                                  const std::string& parent_base_url);
+  // Parses a BaseURL element, resolving it against each of
+  // |parent_base_urls| and appending the results to |base_urls|. The first
+  // result is the first parent resolved against.
+  static void ParseBaseUrl(xmlTextReaderPtr reader,
+                           const std::vector<BaseUrl>& parent_base_urls,
+                           std::vector<BaseUrl>* base_urls);
 
   static bool ParseInt(xmlNodePtr node,
                        const std::string& name,
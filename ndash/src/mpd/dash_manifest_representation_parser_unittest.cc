@@ -119,6 +119,77 @@ TEST(DashParserTests, SegmentBaseTest) {
   EXPECT_EQ("https://base_mpd", index_uri->GetUriString());
 }
 
+TEST(DashParserTests, MultipleBaseUrls) {
+  MediaPresentationDescriptionParser p;
+
+  std::string xml("<?xml version=\"1.0\" encoding=\"UTF-8\"?>");
+  xml.append(
+      "<MPD xmlns:dvb=\"urn:dvb:dash:dash-extensions:2014-1\" "
+      "type=\"static\" mediaPresentationDuration=\"PT60S\">");
+  xml.append(
+      "<BaseURL dvb:serviceLocation=\"a\" dvb:priority=\"1\" "
+      "dvb:weight=\"2\">http://cdn-a.example/movie/</BaseURL>");
+  xml.append(
+      "<BaseURL dvb:serviceLocation=\"b\" dvb:priority=\"1\">"
+      "http://cdn-b.example/movie/</BaseURL>");
+  xml.append(
+      "<BaseURL dvb:serviceLocation=\"c\" dvb:priority=\"3\">"
+      "http://cdn-c.example/movie/</BaseURL>");
+  xml.append("<Period>");
+  xml.append("<AdaptationSet mimeType=\"video/mp4\">");
+  xml.append(
+      "<Representation id=\"1\" codecs=\"avc1.64001f\" "
+      "bandwidth=\"1000000\">");
+  xml.append("<BaseURL>video/</BaseURL>");
+  xml.append("<SegmentBase indexRange=\"1000-2000\">");
+  xml.append("<Initialization range=\"0-999\"/>");
+  xml.append("</SegmentBase>");
+  xml.append("</Representation>");
+  xml.append(
+      "<Representation id=\"2\" codecs=\"avc1.64001f\" "
+      "bandwidth=\"2000000\">");
+  xml.append("<BaseURL>http://origin.example/video.mp4</BaseURL>");
+  xml.append("</Representation>");
+  xml.append("</AdaptationSet>");
+  xml.append("</Period>");
+  xml.append("</MPD>");
+
+  scoped_refptr<MediaPresentationDescription> mpd =
+      p.Parse("http://somewhere/manifest.mpd", base::StringPiece(xml));
+  ASSERT_TRUE(mpd.get() != nullptr);
+  AdaptationSet* adaptation_set =
+      mpd->GetPeriod(0)->GetAdaptationSets().at(0).get();
+  const Representation* rep1 =
+      adaptation_set->GetRepresentations()->at(0).get();
+  const Representation* rep2 =
+      adaptation_set->GetRepresentations()->at(1).get();
+
+  // Segments are resolved against the first base URL, as before.
+  EXPECT_EQ("http://cdn-a.example/movie/video/",
+            rep1->GetInitializationUri()->GetUriString());
+
+  // A relative BaseURL is resolved against each of the enclosing ones, and
+  // keeps their attributes.
+  const std::vector<BaseUrl>& base_urls = rep1->GetBaseUrls();
+  ASSERT_EQ(3, base_urls.size());
+  EXPECT_EQ("http://cdn-a.example/movie/video/", base_urls[0].url);
+  EXPECT_EQ("a", base_urls[0].service_location);
+  EXPECT_EQ(1, base_urls[0].priority);
+  EXPECT_EQ(2, base_urls[0].weight);
+  EXPECT_EQ("http://cdn-b.example/movie/video/", base_urls[1].url);
+  EXPECT_EQ("b", base_urls[1].service_location);
+  EXPECT_EQ(1, base_urls[1].weight);
+  EXPECT_EQ("http://cdn-c.example/movie/video/", base_urls[2].url);
+  EXPECT_EQ(3, base_urls[2].priority);
+
+  // An absolute one replaces them, with the default attributes.
+  ASSERT_EQ(1, rep2->GetBaseUrls().size());
+  EXPECT_EQ("http://origin.example/video.mp4", rep2->GetBaseUrls()[0].url);
+  EXPECT_EQ("http://origin.example/video.mp4",
+            rep2->GetBaseUrls()[0].service_location);
+  EXPECT_EQ(1, rep2->GetBaseUrls()[0].priority);
+}
+
 TEST(DashParserTests, SegmentListTest) {
   MediaPresentationDescriptionParser p;
 
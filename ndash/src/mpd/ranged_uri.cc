@@ -52,18 +52,22 @@ int32_t RangedUri::GetLength() const {
   return length_;
 }
 
-std::unique_ptr<RangedUri> RangedUri::AttemptMerge(
-    const RangedUri* other) const {
+std::unique_ptr<RangedUri> RangedUri::AttemptMerge(const RangedUri* other,
+                                                   int32_t max_gap) const {
   if (other == nullptr || GetUriString() != other->GetUriString()) {
     return nullptr;
-  } else if (length_ != -1 && start_ + length_ == other->start_) {
-    return std::unique_ptr<RangedUri>(
-        new RangedUri(base_uri_, reference_uri_, start_,
-                      other->length_ == -1 ? -1 : length_ + other->length_));
-  } else if (other->length_ != -1 && other->start_ + other->length_ == start_) {
-    return std::unique_ptr<RangedUri>(
-        new RangedUri(base_uri_, reference_uri_, other->start_,
-                      length_ == -1 ? -1 : other->length_ + length_));
+  } else if (length_ != -1 && start_ + length_ <= other->start_ &&
+             other->start_ - (start_ + length_) <= max_gap) {
+    int64_t gap = other->start_ - (start_ + length_);
+    return std::unique_ptr<RangedUri>(new RangedUri(
+        base_uri_, reference_uri_, start_,
+        other->length_ == -1 ? -1 : length_ + gap + other->length_));
+  } else if (other->length_ != -1 && other->start_ + other->length_ <= start_ &&
+             start_ - (other->start_ + other->length_) <= max_gap) {
+    int64_t gap = start_ - (other->start_ + other->length_);
+    return std::unique_ptr<RangedUri>(new RangedUri(
+        base_uri_, reference_uri_, other->start_,
+        length_ == -1 ? -1 : other->length_ + gap + length_));
   } else {
     return nullptr;
   }
@@ -54,7 +54,10 @@ class RangedUri {
   // overlap.
   // If other is null then the merge is considered unsuccessful, and null is
   // returned.
-  std::unique_ptr<RangedUri> AttemptMerge(const RangedUri* other) const;
+  // Regions up to |max_gap| bytes apart are merged too, the result spanning
+  // the gap between them.
+  std::unique_ptr<RangedUri> AttemptMerge(const RangedUri* other,
+                                          int32_t max_gap = 0) const;
 
   bool operator==(const RangedUri& other) const;
   RangedUri& operator=(const RangedUri& other);
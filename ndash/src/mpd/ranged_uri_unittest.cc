@@ -84,5 +84,30 @@ TEST(RangedUriTests, AttemptMerge) {
   EXPECT_EQ(nullptr, merged4);
 }
 
+TEST(RangedUriTests, AttemptMergeWithGap) {
+  std::string base_uri = "http://somewhere/";
+  RangedUri ranged_uri1(&base_uri, "/segment1", 100, 10);
+  RangedUri ranged_uri2(&base_uri, "/segment1", 118, 10);
+
+  EXPECT_EQ(nullptr, ranged_uri1.AttemptMerge(&ranged_uri2));
+  EXPECT_EQ(nullptr, ranged_uri1.AttemptMerge(&ranged_uri2, 7));
+
+  // The merged range takes in the gap, whichever comes first.
+  std::unique_ptr<RangedUri> merged1 =
+      ranged_uri1.AttemptMerge(&ranged_uri2, 8);
+  ASSERT_NE(nullptr, merged1);
+  EXPECT_EQ(100, merged1->GetStart());
+  EXPECT_EQ(28, merged1->GetLength());
+  std::unique_ptr<RangedUri> merged2 =
+      ranged_uri2.AttemptMerge(&ranged_uri1, 8);
+  ASSERT_NE(nullptr, merged2);
+  EXPECT_EQ(100, merged2->GetStart());
+  EXPECT_EQ(28, merged2->GetLength());
+
+  // Overlapping ranges are never merged.
+  RangedUri ranged_uri3(&base_uri, "/segment1", 105, 10);
+  EXPECT_EQ(nullptr, ranged_uri1.AttemptMerge(&ranged_uri3, 100));
+}
+
 }  // namespace mpd
 }  // namespace ndash
@@ -17,8 +17,10 @@
 #ifndef NDASH_MPD_REPRESENTATION_H_
 #define NDASH_MPD_REPRESENTATION_H_
 
+#include <utility>
 #include <vector>
 
+#include "mpd/base_url.h"
 #include "mpd/dash_segment_index.h"
 #include "mpd/descriptor_type.h"
 #include "mpd/ranged_uri.h"
@@ -108,6 +110,14 @@ class Representation {
   size_t GetEssentialPropertyCount() const;
   const DescriptorType* GetEssentialProperty(int32_t index) const;
 
+  // The locations the representation's segments can be fetched from. The
+  // first is the one the segment base's URLs were resolved against. May be
+  // empty if the representation was not made by the manifest parser.
+  const std::vector<BaseUrl>& GetBaseUrls() const { return base_urls_; }
+  void SetBaseUrls(std::vector<BaseUrl> base_urls) {
+    base_urls_ = std::move(base_urls);
+  }
+
  protected:
   Representation(
       const std::string& content_id,
@@ -147,6 +157,7 @@ class Representation {
 
   std::vector<std::unique_ptr<DescriptorType>> supplemental_properties_;
   std::vector<std::unique_ptr<DescriptorType>> essential_properties_;
+  std::vector<BaseUrl> base_urls_;
 };
 
 }  // namespace mpd
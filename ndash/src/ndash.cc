@@ -22,10 +22,15 @@
 
 #include "base/at_exit.h"
 #include "base/command_line.h"
+#include "base/lazy_instance.h"
 #include "base/logging.h"
 #include "base/strings/string_number_conversions.h"
+#include "base/synchronization/lock.h"
 #include "dash_thread.h"
+#include "drm/cdm_session_cache.h"
+#include "memory_governor.h"
 #include "ndash.h"
+#include "util/thread_config.h"
 
 struct ndash_handle {
   ndash::DashThread* dash_thread;
@@ -33,13 +38,19 @@ struct ndash_handle {
 
 namespace {
 const char kLoggingLevel[] = "log-level";
+// Guards the globals below; handles may be created and destroyed from
+// several threads when a process runs more than one player.
+base::LazyInstance<base::Lock>::Leaky global_lock = LAZY_INSTANCE_INITIALIZER;
 base::AtExitManager* exit_manager;
+int live_handles = 0;
 bool checked_switches = false;
 }  // namespace
 
 ndash_handle* ndash_create(DashPlayerCallbacks* callbacks, void* context) {
+  base::AutoLock lock(global_lock.Get());
   if (!exit_manager)
     exit_manager = new base::AtExitManager;
+  live_handles++;
 
   if (!checked_switches) {
     checked_switches = true;
@@ -95,7 +106,7 @@ ndash_handle* ndash_create(DashPlayerCallbacks* callbacks, void* context) {
 
   ndash::DashThread* player = new ndash::DashThread("dash_thread", context);
   player->SetPlayerCallbacks(callbacks);
-  player->Start();
+  player->StartWithThreadConfig();
   return new ndash_handle{player};
 }
 
@@ -119,7 +130,11 @@ void ndash_destroy(ndash_handle* handle) {
     delete handle;
   }
 
-  if (exit_manager) {
+  base::AutoLock lock(global_lock.Get());
+  if (handle && live_handles > 0)
+    live_handles--;
+  // Singletons may still be in use by other players.
+  if (exit_manager && live_handles == 0) {
     delete exit_manager;
     exit_manager = nullptr;
   }
@@ -135,6 +150,17 @@ int ndash_load(ndash_handle* handle,
   return 1;
 }
 
+int ndash_load_async(ndash_handle* handle,
+                     const char* url,
+                     float initial_time_sec,
+                     DashPlayerLoadedFunc loaded_func) {
+  if (handle && handle->dash_thread && loaded_func) {
+    handle->dash_thread->LoadAsync(url, initial_time_sec, loaded_func);
+    return 0;
+  }
+  return 1;
+}
+
 void ndash_unload(ndash_handle* handle) {
   if (handle && handle->dash_thread) {
     handle->dash_thread->Unload();
@@ -209,6 +235,21 @@ int ndash_makeLicenseRequest(struct ndash_handle* handle,
   return -1;
 }
 
+int ndash_prefetch_license(struct ndash_handle* handle,
+                           const void* pssh,
+                           size_t pssh_len) {
+  if (handle && handle->dash_thread && pssh) {
+    std::string pssh_box(static_cast<const char*>(pssh), pssh_len);
+    return handle->dash_thread->PrefetchLicense(pssh_box) ? 0 : -1;
+  }
+  return -1;
+}
+
+void ndash_set_license_cache_expiry(MediaDurationMs expiry_ms) {
+  ndash::drm::CdmSessionCache::GetInstance()->SetExpiry(
+      base::TimeDelta::FromMilliseconds(expiry_ms));
+}
+
 void ndash_report_playback_state(ndash_handle* handle, DashStreamState state) {
   if (handle && handle->dash_thread) {
     handle->dash_thread->ReportPlaybackState(state);
@@ -253,6 +294,108 @@ MediaTimeMs ndash_get_first_time(ndash_handle* handle) {
   return -1;
 }
 
+float ndash_get_catchup_rate(ndash_handle* handle) {
+  if (handle && handle->dash_thread) {
+    return ndash::DashThread::GetCatchupRate(handle->dash_thread);
+  }
+  return 1.0f;
+}
+
+MediaDurationMs ndash_get_live_latency(ndash_handle* handle) {
+  if (handle && handle->dash_thread) {
+    return ndash::DashThread::GetLiveLatencyMs(handle->dash_thread);
+  }
+  return -1;
+}
+
+int ndash_get_memory_usage(ndash_handle* handle, DashMemoryUsage* usage) {
+  if (handle && handle->dash_thread && usage) {
+    return ndash::DashThread::GetMemoryUsage(handle->dash_thread, usage);
+  }
+  return -1;
+}
+
+void ndash_set_memory_budget(size_t budget_bytes) {
+  ndash::MemoryGovernor::GetInstance()->SetBudget(budget_bytes);
+}
+
+int ndash_set_thread_config(const char* role, const char* config) {
+  ndash::util::ThreadRole parsed_role;
+  if (role && config &&
+      ndash::util::ThreadConfig::GetInstance()->Set(role, config,
+                                                    &parsed_role)) {
+    return 0;
+  }
+  return -1;
+}
+
+int ndash_get_stream_counts(ndash_handle* handle,
+                            int* num_video_streams,
+                            int* num_audio_streams,
+                            int* num_cc_streams) {
+  if (handle && handle->dash_thread && num_video_streams &&
+      num_audio_streams && num_cc_streams) {
+    return ndash::DashThread::GetStreamCounts(
+        handle->dash_thread, num_video_streams, num_audio_streams,
+        num_cc_streams);
+  }
+  return -1;
+}
+
+int ndash_get_stream_info(ndash_handle* handle,
+                          DashFrameType type,
+                          int stream,
+                          DashStreamInfo* info) {
+  if (handle && handle->dash_thread && info) {
+    return ndash::DashThread::GetStreamInfo(handle->dash_thread, type, stream,
+                                            info);
+  }
+  return -1;
+}
+
+int ndash_set_audio_stream(ndash_handle* handle, int stream) {
+  if (handle && handle->dash_thread) {
+    return ndash::DashThread::SetAudioStream(handle->dash_thread, stream);
+  }
+  return -1;
+}
+
+int ndash_set_cc_stream(ndash_handle* handle, int stream) {
+  if (handle && handle->dash_thread) {
+    return ndash::DashThread::SetSpuStream(handle->dash_thread, stream);
+  }
+  return -1;
+}
+
+int ndash_set_viewport_size(ndash_handle* handle, int width, int height) {
+  if (handle && handle->dash_thread) {
+    return ndash::DashThread::SetViewportSize(handle->dash_thread, width,
+                                              height);
+  }
+  return -1;
+}
+
+int ndash_set_decoder_limits(ndash_handle* handle,
+                             int max_width,
+                             int max_height,
+                             float max_frame_rate) {
+  if (handle && handle->dash_thread) {
+    return ndash::DashThread::SetDecoderLimits(handle->dash_thread, max_width,
+                                               max_height, max_frame_rate);
+  }
+  return -1;
+}
+
+int ndash_report_rendered_frames(ndash_handle* handle,
+                                 int rendered_frames,
+                                 int dropped_frames) {
+  if (handle && handle->dash_thread) {
+    return ndash::DashThread::ReportRenderedFrames(
+        handle->dash_thread, rendered_frames, dropped_frames);
+  }
+  return -1;
+}
+
 MediaDurationMs ndash_get_duration(ndash_handle* handle) {
   if (handle && handle->dash_thread) {
     return ndash::DashThread::GetDurationMs(handle->dash_thread);
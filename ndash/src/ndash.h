@@ -105,6 +105,23 @@ NDASH_EXPORT int ndash_load(struct ndash_handle* handle,
                             // TODO(rdaum): Switch to MediaTime*?
                             float initial_time_sec);
 
+// Called once a load started by ndash_load_async() has finished, with what
+// ndash_load() would have returned: 0 for success, otherwise a failure
+// occurred.
+typedef void (*DashPlayerLoadedFunc)(void* context, int result);
+
+// Like ndash_load() but returns straight away, so the caller can set up its
+// decoders while the manifest and first segments are fetched. |loaded_func|
+// is called exactly once, on an internal thread, when the codecs are known
+// (ndash_get_video_codec_settings() and ndash_get_audio_codec_settings() may
+// then be used) or the load failed, and at the latest when ndash_unload() is
+// called. It must not call ndash_load*(), ndash_unload() or ndash_destroy().
+// Returns 0 if the load was started.
+NDASH_EXPORT int ndash_load_async(struct ndash_handle* handle,
+                                  const char* url,
+                                  float initial_time_sec,
+                                  DashPlayerLoadedFunc loaded_func);
+
 // Unload the player, releasing all resources held.
 NDASH_EXPORT void ndash_unload(struct ndash_handle* handle);
 
@@ -235,6 +252,14 @@ typedef enum {
 // Indicates that the PTS is available for the frame.
 // TODO(rdaum): Switch has_pts uses to this.
 #define DASH_FRAME_INFO_FLAG_HAS_PTS 4
+// Indicates that decoding can start at this frame.
+#define DASH_FRAME_INFO_FLAG_KEY_FRAME 8
+// Indicates that other frames are predicted from this one.
+#define DASH_FRAME_INFO_FLAG_REFERENCE 16
+// Indicates that no other frame is predicted from this one, so it can be
+// skipped. Neither this nor DASH_FRAME_INFO_FLAG_REFERENCE is set for frames
+// that weren't classified (only H.264 video is).
+#define DASH_FRAME_INFO_FLAG_NON_REFERENCE 32
 
 struct DashFrameInfo {
   DashFrameType type;
@@ -298,6 +323,123 @@ NDASH_EXPORT int ndash_seek(struct ndash_handle* handle, MediaTimeMs time);
 NDASH_EXPORT int ndash_set_playback_rate(struct ndash_handle* handle,
                                          float rate);
 
+// For live streams played with the "live-target-latency-ms" attribute, returns
+// the rate the client should render at (e.g. by resampling audio) to converge
+// on the target latency. This is close to 1 and, unlike
+// ndash_set_playback_rate(), does not change what ndash delivers. Returns 1
+// when no correction is needed or latency is not being controlled.
+NDASH_EXPORT float ndash_get_catchup_rate(struct ndash_handle* handle);
+
+// Returns the distance (milliseconds) between the live edge and the media
+// time last reported by the client, or -1 if unknown or not controlled.
+NDASH_EXPORT MediaDurationMs ndash_get_live_latency(
+    struct ndash_handle* handle);
+
+// Bytes of memory holding buffered media, as reported by
+// ndash_get_memory_usage().
+typedef struct {
+  size_t budget;           // Shared by all players, or 0 for no limit.
+  size_t total_allocated;  // By all players.
+  size_t limit;            // What this player may currently buffer.
+  size_t allocated;        // By this player, of which:
+  size_t video_allocated;  //   by its video track,
+  size_t audio_allocated;  //   by its audio track,
+  size_t text_allocated;   //   by its caption track.
+} DashMemoryUsage;
+
+// Fills |usage| with the memory this player and all others buffer media in.
+// Returns 0 on success, otherwise the player isn't loaded.
+NDASH_EXPORT int ndash_get_memory_usage(struct ndash_handle* handle,
+                                        DashMemoryUsage* usage);
+
+// Limits the memory that all players in the process together buffer media
+// in to |budget_bytes|, or 0 (the default) for no limit. When the players
+// would use more, each buffers less, in proportion to its "memory-priority"
+// attribute, and loads are held back until playback frees enough. Takes
+// effect on loaded players too.
+NDASH_EXPORT void ndash_set_memory_budget(size_t budget_bytes);
+
+// Configures the threads of |role| that every player in the process starts
+// from now on:
+//   "control": each player's own thread, started by ndash_create()
+//   "loader": manifest and media loader threads, started by ndash_load()
+//   "network": network transfer threads, started by ndash_load()
+//   "drm": each player's license thread, started by ndash_create()
+// |config| is a comma-separated list of settings, e.g.
+// "policy=fifo,priority=10,affinity=0x3" or "nice=-5,stack=256k":
+//   "policy": "other", "batch", "idle", "fifo" or "rr" (see sched(7))
+//   "priority": 1-99, the real-time priority for "fifo" and "rr"
+//   "nice": -20 to 19
+//   "affinity": the CPUs the threads may run on, as a mask (e.g. 0x3 for
+//               CPUs 0 and 1)
+//   "stack": the stack size in bytes, optionally followed by k or m
+// Settings left out keep the defaults; "" restores them all. Settings the
+// process lacks the privilege for are logged and skipped when a thread
+// starts. A player's "thread-<role>" attributes take precedence over this.
+// The threads of the shared executor (see the "executor" attribute) are not
+// configured. Returns 0 on success.
+NDASH_EXPORT int ndash_set_thread_config(const char* role, const char* config);
+
+// Gets the number of video, audio and caption streams (adaptation sets) in
+// the period being played. Returns 0 on success, otherwise the player isn't
+// loaded.
+NDASH_EXPORT int ndash_get_stream_counts(struct ndash_handle* handle,
+                                         int* num_video_streams,
+                                         int* num_audio_streams,
+                                         int* num_cc_streams);
+
+// Describes a stream, as returned by ndash_get_stream_info().
+typedef struct {
+  char language[16];  // As in the manifest, e.g. "en"; may be empty.
+  char codecs[64];    // RFC 6381 codecs, e.g. "mp4a.40.2".
+  int channels;       // Audio streams only.
+  int selected;       // Non-zero for the stream being played.
+} DashStreamInfo;
+
+// Fills |info| for |stream|, from 0 to the count given by
+// ndash_get_stream_counts(), of the audio or caption streams (|type|).
+// Returns 0 on success.
+NDASH_EXPORT int ndash_get_stream_info(struct ndash_handle* handle,
+                                       DashFrameType type,
+                                       int stream,
+                                       DashStreamInfo* info);
+
+// Switches to another audio or caption stream. Frames from the new stream
+// follow the last one delivered from the old; the client need not flush.
+// With the "alternate-track-buffer-ms" attribute set the switch is immediate,
+// otherwise the new stream is loaded first. The codec can change, so check
+// ndash_get_audio_codec_settings() when ndash_copy_frame() next returns
+// audio. While a load started by ndash_load_async() is still under way, the
+// stream asked for is the one playback starts with. Returns 0 on success;
+// streams can't be switched while seeking or in trick play.
+NDASH_EXPORT int ndash_set_audio_stream(struct ndash_handle* handle,
+                                        int stream);
+NDASH_EXPORT int ndash_set_cc_stream(struct ndash_handle* handle, int stream);
+
+// Tells the player the size, in pixels, that video is shown at. Video larger
+// than needed to fill it isn't loaded. 0x0 (the default) means unknown.
+// Returns 0 on success.
+NDASH_EXPORT int ndash_set_viewport_size(struct ndash_handle* handle,
+                                         int width,
+                                         int height);
+
+// Tells the player the largest video the decoder can play smoothly; larger
+// or faster video isn't loaded. 0 for any of the limits (the default) means
+// no limit. Returns 0 on success.
+NDASH_EXPORT int ndash_set_decoder_limits(struct ndash_handle* handle,
+                                          int max_width,
+                                          int max_height,
+                                          float max_frame_rate);
+
+// Reports video frames shown since the last call: |rendered_frames| on time
+// and |dropped_frames| dropped or shown late. Call it regularly, e.g. once a
+// second. When many frames are dropped the player steps down to a lower
+// bitrate, and steps back up once they have recovered for a while. Returns 0
+// on success.
+NDASH_EXPORT int ndash_report_rendered_frames(struct ndash_handle* handle,
+                                              int rendered_frames,
+                                              int dropped_frames);
+
 // Synchronously obtain a playback license from the license server.
 // message_key_blob : The key message blob constructed by the CDM
 // message_key_blob_len : The number of bytes in the message blob.
@@ -312,6 +454,23 @@ NDASH_EXPORT int ndash_make_license_request(struct ndash_handle* handle,
                                             void** license,
                                             size_t* license_len);
 
+// Fetches the playback license for |pssh| (a PSSH box, as found in the
+// manifest or init segment of the content) in the background, e.g. for the
+// channels next to the one playing. With the "license-cache" attribute set to
+// "shared", any player that then plays content with that PSSH within the
+// cache expiry (see ndash_set_license_cache_expiry()) starts without a
+// license request; otherwise only this one does. Returns 0 if the fetch was
+// started.
+NDASH_EXPORT int ndash_prefetch_license(struct ndash_handle* handle,
+                                        const void* pssh,
+                                        size_t pssh_len);
+
+// Sets how long after it is fetched a license in the shared cache (see the
+// "license-cache" attribute) is used for new players; ten minutes by default.
+// It should not exceed the license duration. Sessions no player uses are
+// closed once they expire.
+NDASH_EXPORT void ndash_set_license_cache_expiry(MediaDurationMs expiry_ms);
+
 typedef enum {
   DASH_STREAM_STATE_BUFFERING,
   DASH_STREAM_STATE_PLAYING,
@@ -337,6 +496,95 @@ NDASH_EXPORT void ndash_report_playback_error(struct ndash_handle* handle,
                                               int is_fatal);
 
 // TODO(rdaum): Document available attributes and semantics.
+//
+// "thread-control", "thread-loader", "thread-network", "thread-drm":
+// configures this player's threads of that role, with the settings of
+// ndash_set_thread_config(), in place of those given to it. Other players
+// are not affected. The settings are also applied (all but the stack size)
+// to the control and DRM threads, which are running already; ones left out
+// are put back to what those threads inherited from the thread that called
+// ndash_create(). Loader and network threads pick them up when they start, so
+// set them before ndash_load().
+//
+// "license-cache": "shared" gets CDM sessions, with their licenses, from a
+// cache shared by every player in the process that sets it, so that a player
+// starting on content another one plays, played recently or prefetched (see
+// ndash_prefetch_license()) joins that session instead of requesting a
+// license. This requires the players to share one CDM; sessions are opened
+// and closed through the callbacks and context of whichever player needs to.
+// "player" (the default) gives each player its own sessions. Must be set
+// before ndash_load().
+//
+// "executor": "shared" runs this player's loaders and network transfers on a
+// fixed-size pool of threads shared by every player in the process, instead
+// of dedicated threads per track ("dedicated", the default). Prefetches of
+// the next segment still get a thread per track. Must be set before
+// ndash_load(). Pool sizes are taken from the loader-pool-threads and
+// network-pool-threads switches when the first shared player loads.
+//
+// "live-target-latency-ms": for live streams, start this many milliseconds
+// behind the live edge (which need not be a segment boundary) and suggest
+// catch-up rates to stay there; see ndash_get_catchup_rate(). Segments are
+// requested as soon as they start, so with an origin that delivers CMAF
+// chunks as they are produced (chunked transfer) samples reach the client
+// well before their segment is complete. "0" (the default) disables this.
+// Must be set before ndash_load().
+//
+// "quality-upgrade": what to do with buffered video when the bandwidth
+// estimate allows a better format. "discard" (the default) drops buffered
+// segments well ahead of the playback position and loads the better format
+// from there. "replace" keeps playing them while they are loaded again in the
+// better format, then switches at the next keyframe, so the buffer never
+// shrinks for the upgrade. Replacing stops, keeping what is buffered, if the
+// buffer runs low first. Must be set before ndash_load().
+//
+// "non-reference-drop-rate": the playback rate, e.g. "2", from which H.264
+// video frames that no other frame is predicted from are dropped rather than
+// delivered (see DASH_FRAME_INFO_FLAG_NON_REFERENCE). This bounds the decode
+// cost of fast forward on streams without trick play tracks. "0" (the
+// default) delivers every frame. Must be set before ndash_load().
+//
+// "frame-classification": "on" (the default) looks into the first slice of
+// each H.264 video frame to tell reference from non-reference frames, and
+// "off" skips that work on devices that need neither the frame flags nor
+// non-reference-drop-rate. With "off", DashFrameInfo has neither
+// DASH_FRAME_INFO_FLAG_REFERENCE nor DASH_FRAME_INFO_FLAG_NON_REFERENCE and
+// no frame is dropped. Must be set before ndash_load().
+//
+// "memory-priority": this player's weight, an integer of at least 1, when the
+// budget set by ndash_set_memory_budget() is divided between players. "1" is
+// the default; e.g. "3" for a main player and "1" for a picture-in-picture
+// one. Must be set before ndash_load().
+//
+// "alternate-track-buffer-ms": keep this many milliseconds of every other
+// audio and caption stream buffered, so that ndash_set_audio_stream() and
+// ndash_set_cc_stream() switch without waiting for a load. "0" (the default)
+// loads only the streams being played. Must be set before ndash_load().
+//
+// "trace-file": a path starts recording a trace of what the player does
+// (manifest and segment transfers, parsing, license requests, format
+// switches), and "" stops recording and writes it to that path as Chrome
+// trace JSON, which about:tracing and Perfetto can open. The trace is also
+// written if the player is destroyed while recording. Only one trace can be
+// recorded at a time in a process.
+//
+// "trace-categories": the categories recorded by the next "trace-file",
+// comma-separated. "ndash" (the default) leaves out the per-sample and
+// per-frame events; add "disabled-by-default-ndash.frames" for those.
+//
+// "network-record-file": a path to record every manifest and segment
+// request of the session to, with the response and when each piece of it
+// arrived. License requests are not recorded. Must be set before
+// ndash_load().
+//
+// "network-replay-file": a path recorded by "network-record-file" to play
+// the session from instead of the network. Requests that weren't recorded
+// fail. Must be set before ndash_load().
+//
+// "network-replay-pace": "recorded" (the default) serves each piece of a
+// replayed response when it arrived in the recording, so that adaptation
+// sees the same bandwidth; "fast" serves them at once.
+//
 // Returns 0 on success, otherwise a failure occurred.
 NDASH_EXPORT int ndash_set_attribute(struct ndash_handle* handle,
                                      const char* attribute_name,
@@ -0,0 +1,422 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "offline/download_plan.h"
+
+#include <cinttypes>
+#include <memory>
+#include <utility>
+
+#include "base/logging.h"
+#include "base/strings/stringprintf.h"
+#include "mpd/adaptation_set.h"
+#include "mpd/content_protection.h"
+#include "mpd/dash_segment_index.h"
+#include "mpd/media_presentation_description.h"
+#include "mpd/period.h"
+#include "mpd/ranged_uri.h"
+#include "mpd/representation.h"
+#include "mpd/segment_base.h"
+#include "mpd/single_segment_base.h"
+#include "util/format.h"
+#include "util/mime_types.h"
+#include "util/util.h"
+
+namespace ndash {
+namespace offline {
+
+namespace {
+const char kAudioChannelConfigurationScheme[] =
+    "urn:mpeg:dash:23003:3:audio_channel_configuration:2011";
+
+std::string EscapeXml(const std::string& text) {
+  std::string escaped;
+  for (char c : text) {
+    switch (c) {
+      case '&':
+        escaped.append("&amp;");
+        break;
+      case '<':
+        escaped.append("&lt;");
+        break;
+      case '>':
+        escaped.append("&gt;");
+        break;
+      case '"':
+        escaped.append("&quot;");
+        break;
+      default:
+        escaped.push_back(c);
+    }
+  }
+  return escaped;
+}
+
+std::string FormatDuration(int64_t duration_ms) {
+  return base::StringPrintf("PT%.3fS", duration_ms / 1000.0);
+}
+
+const char* ContentTypeName(mpd::AdaptationType type) {
+  switch (type) {
+    case mpd::AdaptationType::VIDEO:
+      return util::kBaseTypeVideo;
+    case mpd::AdaptationType::AUDIO:
+      return util::kBaseTypeAudio;
+    case mpd::AdaptationType::TEXT:
+      return util::kBaseTypeText;
+    default:
+      return nullptr;
+  }
+}
+
+// The range attribute of |uri|, or an empty string if it has none.
+std::string FormatRange(const mpd::RangedUri* uri) {
+  if (!uri || uri->GetLength() == -1) {
+    return std::string();
+  }
+  return base::StringPrintf("%" PRId64 "-%" PRId64, uri->GetStart(),
+                            uri->GetStart() + uri->GetLength() - 1);
+}
+
+// Returns a SegmentTimeline of segments starting at |times| and lasting
+// |durations| (both in microseconds).
+std::string Timeline(const std::vector<int64_t>& times,
+                     const std::vector<int64_t>& durations) {
+  std::string result("     <SegmentTimeline>\n");
+  // Collapse runs of back to back segments of equal durations into r="".
+  size_t i = 0;
+  int64_t next_time = -1;
+  while (i < times.size()) {
+    size_t run = 1;
+    while (i + run < times.size() && durations[i + run] == durations[i] &&
+           times[i + run] == times[i + run - 1] + durations[i]) {
+      run++;
+    }
+    result.append("      <S");
+    if (times[i] != next_time) {
+      base::StringAppendF(&result, " t=\"%" PRId64 "\"", times[i]);
+    }
+    base::StringAppendF(&result, " d=\"%" PRId64 "\"", durations[i]);
+    if (run > 1) {
+      base::StringAppendF(&result, " r=\"%zu\"", run - 1);
+    }
+    result.append("/>\n");
+    i += run;
+    next_time = times[i - 1] + durations[i - 1];
+  }
+  result.append("     </SegmentTimeline>\n");
+  return result;
+}
+}  // namespace
+
+DownloadRequest::DownloadRequest() {}
+
+DownloadRequest::DownloadRequest(const DownloadRequest& other) = default;
+
+DownloadRequest::~DownloadRequest() {}
+
+constexpr int64_t DownloadPlan::kDefaultMaxCoalescedBytes;
+
+DownloadPlan::DownloadPlan(int64_t max_coalesced_bytes)
+    : max_coalesced_bytes_(max_coalesced_bytes) {}
+
+DownloadPlan::~DownloadPlan() {}
+
+// static
+std::vector<RepresentationKey> DownloadPlan::SelectHighestBandwidth(
+    const mpd::MediaPresentationDescription& manifest) {
+  std::vector<RepresentationKey> selection;
+  for (size_t p = 0; p < manifest.GetPeriodCount(); p++) {
+    const mpd::Period* period = manifest.GetPeriod(p);
+    for (size_t a = 0; a < period->GetAdaptationSetCount(); a++) {
+      const mpd::AdaptationSet* adaptation_set = period->GetAdaptationSet(a);
+      int32_t best = -1;
+      for (int32_t r = 0; r < adaptation_set->NumRepresentations(); r++) {
+        if (best < 0 ||
+            adaptation_set->GetRepresentation(r)->GetFormat().GetBitrate() >
+                adaptation_set->GetRepresentation(best)
+                    ->GetFormat()
+                    .GetBitrate()) {
+          best = r;
+        }
+      }
+      if (best >= 0) {
+        selection.push_back({static_cast<int32_t>(p), static_cast<int32_t>(a),
+                             best});
+      }
+    }
+  }
+  return selection;
+}
+
+bool DownloadPlan::Build(const mpd::MediaPresentationDescription& manifest,
+                         const std::vector<RepresentationKey>& selection) {
+  directories_.clear();
+  requests_.clear();
+  manifest_.clear();
+  total_segments_ = 0;
+
+  if (manifest.IsDynamic()) {
+    LOG(ERROR) << "Live presentations can't be downloaded";
+    return false;
+  }
+  for (const RepresentationKey& key : selection) {
+    const mpd::Period* period =
+        key.period_index >= 0 &&
+                key.period_index < static_cast<int32_t>(
+                                       manifest.GetPeriodCount())
+            ? manifest.GetPeriod(key.period_index)
+            : nullptr;
+    const mpd::AdaptationSet* adaptation_set =
+        period && key.adaptation_set_index >= 0 &&
+                key.adaptation_set_index < static_cast<int32_t>(
+                                               period->GetAdaptationSetCount())
+            ? period->GetAdaptationSet(key.adaptation_set_index)
+            : nullptr;
+    if (!adaptation_set || key.representation_index < 0 ||
+        key.representation_index >= adaptation_set->NumRepresentations()) {
+      LOG(ERROR) << "No representation " << key.period_index << "/"
+                 << key.adaptation_set_index << "/"
+                 << key.representation_index;
+      return false;
+    }
+  }
+
+  manifest_ = base::StringPrintf(
+      "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+      "<MPD xmlns=\"urn:mpeg:DASH:schema:MPD:2011\" "
+      "profiles=\"urn:mpeg:dash:profile:isoff-live:2011\" type=\"static\" "
+      "minBufferTime=\"%s\"",
+      FormatDuration(manifest.GetMinBufferTime()).c_str());
+  if (manifest.GetDuration() >= 0) {
+    base::StringAppendF(&manifest_, " mediaPresentationDuration=\"%s\"",
+                        FormatDuration(manifest.GetDuration()).c_str());
+  }
+  manifest_.append(">\n");
+
+  for (size_t p = 0; p < manifest.GetPeriodCount(); p++) {
+    const mpd::Period* period = manifest.GetPeriod(p);
+    int64_t period_duration_ms = manifest.GetPeriodDuration(p);
+    int64_t period_duration_us = period_duration_ms == -1
+                                     ? util::kUnknownTimeUs
+                                     : period_duration_ms * 1000;
+    manifest_.append(" <Period");
+    if (!period->GetId().empty()) {
+      base::StringAppendF(&manifest_, " id=\"%s\"",
+                          EscapeXml(period->GetId()).c_str());
+    }
+    base::StringAppendF(&manifest_, " start=\"%s\">\n",
+                        FormatDuration(period->GetStartMs()).c_str());
+
+    for (size_t a = 0; a < period->GetAdaptationSetCount(); a++) {
+      const mpd::AdaptationSet* adaptation_set = period->GetAdaptationSet(a);
+      std::vector<int32_t> representations;
+      for (const RepresentationKey& key : selection) {
+        if (key.period_index == static_cast<int32_t>(p) &&
+            key.adaptation_set_index == static_cast<int32_t>(a)) {
+          representations.push_back(key.representation_index);
+        }
+      }
+      if (representations.empty()) {
+        continue;
+      }
+
+      manifest_.append("  <AdaptationSet");
+      if (adaptation_set->GetId() >= 0) {
+        base::StringAppendF(&manifest_, " id=\"%d\"", adaptation_set->GetId());
+      }
+      const char* content_type = ContentTypeName(adaptation_set->GetType());
+      if (content_type) {
+        base::StringAppendF(&manifest_, " contentType=\"%s\"", content_type);
+      }
+      manifest_.append(">\n");
+      for (int32_t i = 0; i < adaptation_set->NumContentProtections(); i++) {
+        // Key systems find their init data in the pssh boxes of the
+        // initialization segments.
+        base::StringAppendF(
+            &manifest_, "   <ContentProtection schemeIdUri=\"%s\"/>\n",
+            EscapeXml(
+                adaptation_set->GetContentProtection(i)->GetSchemeUriId())
+                .c_str());
+      }
+      for (int32_t r : representations) {
+        std::string directory = base::StringPrintf(
+            "p%zu_a%zu_r%d", p, a, r);
+        if (!AddRepresentation(*adaptation_set->GetRepresentation(r),
+                               period_duration_us, directory)) {
+          return false;
+        }
+      }
+      manifest_.append("  </AdaptationSet>\n");
+    }
+    manifest_.append(" </Period>\n");
+  }
+  manifest_.append("</MPD>\n");
+  return true;
+}
+
+bool DownloadPlan::AddRepresentation(const mpd::Representation& representation,
+                                     int64_t period_duration_us,
+                                     const std::string& directory) {
+  const util::Format& format = representation.GetFormat();
+  const mpd::SegmentBase* segment_base = representation.GetSegmentBase();
+  const mpd::DashSegmentIndexInterface* index = representation.GetIndex();
+  if (!segment_base || (!segment_base->IsSingleSegment() && !index)) {
+    LOG(ERROR) << "Representation " << format.GetId() << " has no segments";
+    return false;
+  }
+  directories_.push_back(directory);
+
+  manifest_.append("   <Representation");
+  base::StringAppendF(&manifest_,
+                      " id=\"%s\" mimeType=\"%s\" codecs=\"%s\" "
+                      "bandwidth=\"%d\"",
+                      EscapeXml(format.GetId()).c_str(),
+                      EscapeXml(format.GetMimeType()).c_str(),
+                      EscapeXml(format.GetCodecs()).c_str(),
+                      format.GetBitrate());
+  if (format.GetWidth() > 0 && format.GetHeight() > 0) {
+    base::StringAppendF(&manifest_, " width=\"%d\" height=\"%d\"",
+                        format.GetWidth(), format.GetHeight());
+  }
+  if (format.GetFrameRate() > 0) {
+    base::StringAppendF(&manifest_, " frameRate=\"%g\"", format.GetFrameRate());
+  }
+  if (format.GetAudioSamplingRate() > 0) {
+    base::StringAppendF(&manifest_, " audioSamplingRate=\"%d\"",
+                        format.GetAudioSamplingRate());
+  }
+  if (!format.GetLanguage().empty()) {
+    base::StringAppendF(&manifest_, " lang=\"%s\"",
+                        EscapeXml(format.GetLanguage()).c_str());
+  }
+  manifest_.append(">\n");
+  if (format.GetAudioChannels() > 0) {
+    base::StringAppendF(&manifest_,
+                        "    <AudioChannelConfiguration schemeIdUri=\"%s\" "
+                        "value=\"%d\"/>\n",
+                        kAudioChannelConfigurationScheme,
+                        format.GetAudioChannels());
+  }
+
+  if (segment_base->IsSingleSegment()) {
+    // Fetched whole, so that the initialization and index ranges still hold.
+    const std::string* uri =
+        static_cast<const mpd::SingleSegmentBase*>(segment_base)->GetUri();
+    std::string path = directory + "/media.mp4";
+    AddSegment(*uri, 0, upstream::LENGTH_UNBOUNDED, path);
+    total_segments_++;
+
+    base::StringAppendF(&manifest_, "    <BaseURL>%s</BaseURL>\n",
+                        path.c_str());
+    base::StringAppendF(&manifest_,
+                        "    <SegmentBase timescale=\"%" PRId64
+                        "\" presentationTimeOffset=\"%" PRId64 "\"",
+                        segment_base->GetTimeScale(),
+                        segment_base->GetPresentationTimeOffset());
+    std::string index_range = FormatRange(representation.GetIndexUri());
+    if (!index_range.empty()) {
+      base::StringAppendF(&manifest_, " indexRange=\"%s\"",
+                          index_range.c_str());
+    }
+    std::string initialization_range =
+        FormatRange(representation.GetInitializationUri());
+    if (!initialization_range.empty()) {
+      base::StringAppendF(&manifest_,
+                          ">\n     <Initialization range=\"%s\"/>\n"
+                          "    </SegmentBase>\n",
+                          initialization_range.c_str());
+    } else {
+      manifest_.append("/>\n");
+    }
+    manifest_.append("   </Representation>\n");
+    return true;
+  }
+
+  int32_t first = index->GetFirstSegmentNum();
+  int32_t last = index->GetLastSegmentNum(period_duration_us);
+  if (last == mpd::DashSegmentIndexInterface::kIndexUnbounded || last < first) {
+    LOG(ERROR) << "Representation " << format.GetId()
+               << " has no last segment";
+    return false;
+  }
+
+  const mpd::RangedUri* initialization = representation.GetInitializationUri();
+  if (initialization) {
+    AddSegment(initialization->GetUriString(), initialization->GetStart(),
+               initialization->GetLength(), directory + "/init.mp4");
+  }
+  // Times are kept to the microsecond, as the index has them.
+  int64_t presentation_time_offset_us =
+      representation.GetPresentationTimeOffsetUs();
+  std::vector<int64_t> times;
+  std::vector<int64_t> durations;
+  for (int32_t n = first; n <= last; n++) {
+    std::unique_ptr<mpd::RangedUri> uri = index->GetSegmentUrl(n);
+    AddSegment(uri->GetUriString(), uri->GetStart(), uri->GetLength(),
+               base::StringPrintf("%s/%d.m4s", directory.c_str(), n));
+    times.push_back(index->GetTimeUs(n) + presentation_time_offset_us);
+    durations.push_back(index->GetDurationUs(n, period_duration_us));
+  }
+  total_segments_ += last - first + 1;
+
+  base::StringAppendF(&manifest_,
+                      "    <SegmentTemplate timescale=\"%d\" "
+                      "presentationTimeOffset=\"%" PRId64
+                      "\" startNumber=\"%d\"",
+                      util::kMicrosPerSecond, presentation_time_offset_us,
+                      first);
+  if (initialization) {
+    base::StringAppendF(&manifest_, " initialization=\"%s/init.mp4\"",
+                        directory.c_str());
+  }
+  base::StringAppendF(&manifest_, " media=\"%s/$Number$.m4s\">\n",
+                      directory.c_str());
+  manifest_.append(Timeline(times, durations));
+  manifest_.append(
+      "    </SegmentTemplate>\n"
+      "   </Representation>\n");
+  return true;
+}
+
+void DownloadPlan::AddSegment(const std::string& uri,
+                              int64_t position,
+                              int64_t length,
+                              const std::string& path) {
+  if (length < 0) {
+    length = upstream::LENGTH_UNBOUNDED;
+  }
+  if (!requests_.empty()) {
+    DownloadRequest& previous = requests_.back();
+    if (previous.uri == uri && previous.length != upstream::LENGTH_UNBOUNDED &&
+        length != upstream::LENGTH_UNBOUNDED &&
+        previous.position + previous.length == position &&
+        previous.length + length <= max_coalesced_bytes_) {
+      previous.length += length;
+      previous.outputs.push_back({path, length});
+      return;
+    }
+  }
+  DownloadRequest request;
+  request.uri = uri;
+  request.position = position;
+  request.length = length;
+  request.outputs.push_back({path, length});
+  requests_.push_back(std::move(request));
+}
+
+}  // namespace offline
+}  // namespace ndash
@@ -0,0 +1,125 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NDASH_OFFLINE_DOWNLOAD_PLAN_H_
+#define NDASH_OFFLINE_DOWNLOAD_PLAN_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "upstream/constants.h"
+
+namespace ndash {
+
+namespace mpd {
+class MediaPresentationDescription;
+class Representation;
+}  // namespace mpd
+
+namespace offline {
+
+// A representation of a manifest, by its position in it.
+struct RepresentationKey {
+  int32_t period_index;
+  int32_t adaptation_set_index;
+  int32_t representation_index;
+};
+
+// A request made by a download, and the files its response is split between.
+struct DownloadRequest {
+  struct Output {
+    // Relative to the download directory, with '/' separators.
+    std::string path;
+    // Bytes of the response written to |path|, or LENGTH_UNBOUNDED for the
+    // rest of it.
+    int64_t length;
+  };
+
+  DownloadRequest();
+  DownloadRequest(const DownloadRequest& other);
+  ~DownloadRequest();
+
+  std::string uri;
+  int64_t position = 0;
+  int64_t length = upstream::LENGTH_UNBOUNDED;
+  std::vector<Output> outputs;
+};
+
+// Works out what to fetch to keep a copy of some of the representations of a
+// static manifest, and writes the manifest that plays that copy.
+//
+// The initialization and media segments of each representation are saved as
+// separate files (single segment representations as the one file they are)
+// so that the copy is played through SegmentTemplates. Byte ranges of the
+// same resource that follow each other are fetched with one request, up to
+// |max_coalesced_bytes|.
+class DownloadPlan {
+ public:
+  static constexpr int64_t kDefaultMaxCoalescedBytes = 4 * 1024 * 1024;
+
+  explicit DownloadPlan(
+      int64_t max_coalesced_bytes = kDefaultMaxCoalescedBytes);
+  ~DownloadPlan();
+
+  // The representation with the highest bandwidth in each adaptation set.
+  static std::vector<RepresentationKey> SelectHighestBandwidth(
+      const mpd::MediaPresentationDescription& manifest);
+
+  // Plans the download of |selection| from |manifest|, replacing any earlier
+  // plan. Returns false if it can't be downloaded: the manifest is dynamic, a
+  // selected representation doesn't exist or has no end.
+  bool Build(const mpd::MediaPresentationDescription& manifest,
+             const std::vector<RepresentationKey>& selection);
+
+  // Directories (relative to the download directory) that the outputs of
+  // requests() go in.
+  const std::vector<std::string>& directories() const { return directories_; }
+  const std::vector<DownloadRequest>& requests() const { return requests_; }
+  // The manifest of the downloaded copy. Paths in it are relative to the
+  // download directory.
+  const std::string& manifest() const { return manifest_; }
+
+  int64_t total_segments() const { return total_segments_; }
+
+ private:
+  // Adds the requests for |representation|, saved under |directory|, and its
+  // elements in the manifest.
+  bool AddRepresentation(const mpd::Representation& representation,
+                         int64_t period_duration_us,
+                         const std::string& directory);
+  // Adds a request for |length| bytes of |uri| from |position| into |path|,
+  // appending it to the previous request when it continues it.
+  void AddSegment(const std::string& uri,
+                  int64_t position,
+                  int64_t length,
+                  const std::string& path);
+
+  const int64_t max_coalesced_bytes_;
+
+  std::vector<std::string> directories_;
+  std::vector<DownloadRequest> requests_;
+  std::string manifest_;
+  int64_t total_segments_ = 0;
+
+  DownloadPlan(const DownloadPlan& other) = delete;
+  DownloadPlan& operator=(const DownloadPlan& other) = delete;
+};
+
+}  // namespace offline
+}  // namespace ndash
+
+#endif  // NDASH_OFFLINE_DOWNLOAD_PLAN_H_
@@ -0,0 +1,244 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "offline/download_plan.h"
+
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "mpd/adaptation_set.h"
+#include "mpd/dash_manifest_representation_parser.h"
+#include "mpd/dash_segment_index.h"
+#include "mpd/media_presentation_description.h"
+#include "mpd/period.h"
+#include "mpd/ranged_uri.h"
+#include "mpd/representation.h"
+#include "upstream/constants.h"
+
+namespace ndash {
+namespace offline {
+
+namespace {
+const char kSourceUri[] = "http://cdn.example/movie/manifest.mpd";
+const char kCopyUri[] = "file:///offline/manifest.mpd";
+
+// Video as ranges of one file (and a lower bandwidth alternative as separate
+// files), audio as a single segment.
+const char kManifest[] =
+    "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+    "<MPD xmlns=\"urn:mpeg:DASH:schema:MPD:2011\" type=\"static\" "
+    "minBufferTime=\"PT2S\" mediaPresentationDuration=\"PT6S\">\n"
+    " <Period id=\"main\" start=\"PT0S\">\n"
+    "  <AdaptationSet id=\"0\" contentType=\"video\">\n"
+    "   <ContentProtection "
+    "schemeIdUri=\"urn:mpeg:dash:mp4protection:2011\"/>\n"
+    "   <Representation id=\"v1\" mimeType=\"video/mp4\" "
+    "codecs=\"avc1.4d401f\" bandwidth=\"1000000\" width=\"1280\" "
+    "height=\"720\">\n"
+    "    <SegmentList timescale=\"1000\" duration=\"2000\">\n"
+    "     <Initialization sourceURL=\"video.mp4\" range=\"0-99\"/>\n"
+    "     <SegmentURL media=\"video.mp4\" mediaRange=\"100-299\"/>\n"
+    "     <SegmentURL media=\"video.mp4\" mediaRange=\"300-499\"/>\n"
+    "     <SegmentURL media=\"video.mp4\" mediaRange=\"500-699\"/>\n"
+    "    </SegmentList>\n"
+    "   </Representation>\n"
+    "   <Representation id=\"v0\" mimeType=\"video/mp4\" "
+    "codecs=\"avc1.4d401e\" bandwidth=\"500000\" width=\"640\" "
+    "height=\"360\">\n"
+    "    <SegmentTemplate timescale=\"1000\" duration=\"2000\" "
+    "startNumber=\"1\" initialization=\"v0/init.mp4\" "
+    "media=\"v0/$Number$.m4s\"/>\n"
+    "   </Representation>\n"
+    "  </AdaptationSet>\n"
+    "  <AdaptationSet id=\"1\" contentType=\"audio\">\n"
+    "   <Representation id=\"a\" mimeType=\"audio/mp4\" "
+    "codecs=\"mp4a.40.2\" bandwidth=\"128000\" audioSamplingRate=\"48000\" "
+    "lang=\"en\">\n"
+    "    <AudioChannelConfiguration schemeIdUri=\"urn:mpeg:dash:23003:3:"
+    "audio_channel_configuration:2011\" value=\"2\"/>\n"
+    "    <BaseURL>audio.mp4</BaseURL>\n"
+    "    <SegmentBase indexRange=\"50-149\">\n"
+    "     <Initialization range=\"0-49\"/>\n"
+    "    </SegmentBase>\n"
+    "   </Representation>\n"
+    "  </AdaptationSet>\n"
+    " </Period>\n"
+    "</MPD>\n";
+
+scoped_refptr<mpd::MediaPresentationDescription> Parse(
+    const std::string& uri,
+    const std::string& xml) {
+  return mpd::MediaPresentationDescriptionParser().Parse(uri, xml);
+}
+
+const mpd::Representation* GetRepresentation(
+    const mpd::MediaPresentationDescription& manifest,
+    int32_t adaptation_set,
+    int32_t representation) {
+  return manifest.GetPeriod(0)
+      ->GetAdaptationSet(adaptation_set)
+      ->GetRepresentation(representation);
+}
+}  // namespace
+
+TEST(DownloadPlanTest, SelectHighestBandwidth) {
+  scoped_refptr<mpd::MediaPresentationDescription> manifest =
+      Parse(kSourceUri, kManifest);
+  ASSERT_TRUE(manifest);
+  std::vector<RepresentationKey> selection =
+      DownloadPlan::SelectHighestBandwidth(*manifest);
+  ASSERT_EQ(2u, selection.size());
+  EXPECT_EQ(0, selection[0].adaptation_set_index);
+  EXPECT_EQ(0, selection[0].representation_index);
+  EXPECT_EQ(1, selection[1].adaptation_set_index);
+  EXPECT_EQ(0, selection[1].representation_index);
+}
+
+TEST(DownloadPlanTest, CoalescesRanges) {
+  scoped_refptr<mpd::MediaPresentationDescription> manifest =
+      Parse(kSourceUri, kManifest);
+  ASSERT_TRUE(manifest);
+  std::vector<RepresentationKey> selection =
+      DownloadPlan::SelectHighestBandwidth(*manifest);
+
+  DownloadPlan plan;
+  ASSERT_TRUE(plan.Build(*manifest, selection));
+  EXPECT_EQ(4, plan.total_segments());
+  ASSERT_EQ(2u, plan.directories().size());
+  ASSERT_EQ(2u, plan.requests().size());
+
+  // The initialization and media ranges of the video follow each other.
+  const DownloadRequest& video = plan.requests()[0];
+  EXPECT_EQ("http://cdn.example/movie/video.mp4", video.uri);
+  EXPECT_EQ(0, video.position);
+  EXPECT_EQ(700, video.length);
+  ASSERT_EQ(4u, video.outputs.size());
+  EXPECT_EQ(plan.directories()[0] + "/init.mp4", video.outputs[0].path);
+  EXPECT_EQ(100, video.outputs[0].length);
+  EXPECT_EQ(plan.directories()[0] + "/3.m4s", video.outputs[3].path);
+  EXPECT_EQ(200, video.outputs[3].length);
+
+  // Single segments are fetched whole.
+  const DownloadRequest& audio = plan.requests()[1];
+  EXPECT_EQ("http://cdn.example/movie/audio.mp4", audio.uri);
+  EXPECT_EQ(0, audio.position);
+  EXPECT_EQ(upstream::LENGTH_UNBOUNDED, audio.length);
+  ASSERT_EQ(1u, audio.outputs.size());
+  EXPECT_EQ(plan.directories()[1] + "/media.mp4", audio.outputs[0].path);
+
+  // Up to the limit.
+  DownloadPlan small_plan(300);
+  ASSERT_TRUE(small_plan.Build(*manifest, selection));
+  ASSERT_EQ(4u, small_plan.requests().size());
+  EXPECT_EQ(300, small_plan.requests()[0].length);
+  EXPECT_EQ(2u, small_plan.requests()[0].outputs.size());
+  EXPECT_EQ(300, small_plan.requests()[1].position);
+  EXPECT_EQ(200, small_plan.requests()[1].length);
+
+  // Separate files are separate requests.
+  ASSERT_TRUE(plan.Build(*manifest, {{0, 0, 1}}));
+  ASSERT_EQ(4u, plan.requests().size());
+  EXPECT_EQ("http://cdn.example/movie/v0/init.mp4", plan.requests()[0].uri);
+  EXPECT_EQ("http://cdn.example/movie/v0/3.m4s", plan.requests()[3].uri);
+  EXPECT_EQ(upstream::LENGTH_UNBOUNDED, plan.requests()[3].length);
+}
+
+TEST(DownloadPlanTest, ManifestPlaysTheCopy) {
+  scoped_refptr<mpd::MediaPresentationDescription> source =
+      Parse(kSourceUri, kManifest);
+  ASSERT_TRUE(source);
+  DownloadPlan plan;
+  ASSERT_TRUE(plan.Build(*source, DownloadPlan::SelectHighestBandwidth(
+                                      *source)));
+
+  scoped_refptr<mpd::MediaPresentationDescription> copy =
+      Parse(kCopyUri, plan.manifest());
+  ASSERT_TRUE(copy) << plan.manifest();
+  EXPECT_FALSE(copy->IsDynamic());
+  EXPECT_EQ(source->GetDuration(), copy->GetDuration());
+  ASSERT_EQ(1u, copy->GetPeriodCount());
+  EXPECT_EQ("main", copy->GetPeriod(0)->GetId());
+  ASSERT_EQ(2u, copy->GetPeriod(0)->GetAdaptationSetCount());
+
+  const mpd::AdaptationSet* video_set =
+      copy->GetPeriod(0)->GetAdaptationSet(0);
+  EXPECT_EQ(mpd::AdaptationType::VIDEO, video_set->GetType());
+  EXPECT_EQ(1, video_set->NumContentProtections());
+  ASSERT_EQ(1, video_set->NumRepresentations());
+
+  const mpd::Representation* source_video = GetRepresentation(*source, 0, 0);
+  const mpd::Representation* video = GetRepresentation(*copy, 0, 0);
+  EXPECT_EQ(source_video->GetFormat(), video->GetFormat());
+  ASSERT_TRUE(video->GetInitializationUri());
+  EXPECT_EQ("file:///offline/" + plan.directories()[0] + "/init.mp4",
+            video->GetInitializationUri()->GetUriString());
+  EXPECT_EQ(-1, video->GetInitializationUri()->GetLength());
+
+  const mpd::DashSegmentIndexInterface* source_index =
+      source_video->GetIndex();
+  const mpd::DashSegmentIndexInterface* index = video->GetIndex();
+  const int64_t period_duration_us = 6000000;
+  int32_t first = source_index->GetFirstSegmentNum();
+  ASSERT_EQ(first, index->GetFirstSegmentNum());
+  ASSERT_EQ(source_index->GetLastSegmentNum(period_duration_us),
+            index->GetLastSegmentNum(period_duration_us));
+  for (int32_t n = first;
+       n <= source_index->GetLastSegmentNum(period_duration_us); n++) {
+    EXPECT_EQ(source_index->GetTimeUs(n), index->GetTimeUs(n));
+    EXPECT_EQ(source_index->GetDurationUs(n, period_duration_us),
+              index->GetDurationUs(n, period_duration_us));
+    EXPECT_EQ("file:///offline/" + plan.directories()[0] + "/" +
+                  std::to_string(n) + ".m4s",
+              index->GetSegmentUrl(n)->GetUriString());
+  }
+
+  // The single segment keeps its ranges.
+  const mpd::Representation* source_audio = GetRepresentation(*source, 1, 0);
+  const mpd::Representation* audio = GetRepresentation(*copy, 1, 0);
+  EXPECT_EQ(source_audio->GetFormat(), audio->GetFormat());
+  ASSERT_TRUE(audio->GetIndexUri());
+  EXPECT_EQ("file:///offline/" + plan.directories()[1] + "/media.mp4",
+            audio->GetIndexUri()->GetUriString());
+  EXPECT_EQ(50, audio->GetIndexUri()->GetStart());
+  EXPECT_EQ(100, audio->GetIndexUri()->GetLength());
+  ASSERT_TRUE(audio->GetInitializationUri());
+  EXPECT_EQ(0, audio->GetInitializationUri()->GetStart());
+  EXPECT_EQ(50, audio->GetInitializationUri()->GetLength());
+}
+
+TEST(DownloadPlanTest, RejectsWhatCantBeDownloaded) {
+  scoped_refptr<mpd::MediaPresentationDescription> manifest =
+      Parse(kSourceUri, kManifest);
+  ASSERT_TRUE(manifest);
+  DownloadPlan plan;
+  EXPECT_FALSE(plan.Build(*manifest, {{0, 0, 2}}));
+  EXPECT_FALSE(plan.Build(*manifest, {{0, 2, 0}}));
+  EXPECT_FALSE(plan.Build(*manifest, {{1, 0, 0}}));
+
+  std::string live(kManifest);
+  live.replace(live.find("type=\"static\""), strlen("type=\"static\""),
+               "type=\"dynamic\"");
+  scoped_refptr<mpd::MediaPresentationDescription> live_manifest =
+      Parse(kSourceUri, live);
+  ASSERT_TRUE(live_manifest);
+  EXPECT_FALSE(plan.Build(*live_manifest, {{0, 0, 0}}));
+}
+
+}  // namespace offline
+}  // namespace ndash
@@ -0,0 +1,354 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "offline/downloader.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "base/files/file.h"
+#include "base/files/file_util.h"
+#include "base/logging.h"
+#include "base/threading/simple_thread.h"
+#include "mpd/dash_manifest_representation_parser.h"
+#include "mpd/media_presentation_description.h"
+#include "upstream/constants.h"
+#include "upstream/curl_data_source.h"
+#include "upstream/data_spec.h"
+#include "upstream/default_uri_data_source.h"
+#include "upstream/http_data_source.h"
+#include "upstream/uri.h"
+
+namespace ndash {
+namespace offline {
+
+namespace {
+constexpr size_t kReadSize = 64 * 1024;
+const base::FilePath::CharType kPartExtension[] = FILE_PATH_LITERAL("part");
+
+// Files are written here until they are complete.
+base::FilePath PartPath(const base::FilePath& path) {
+  return path.AddExtension(kPartExtension);
+}
+
+// Replaces |path| with its complete part file.
+bool Commit(const base::FilePath& path) {
+  if (!base::ReplaceFile(PartPath(path), path, nullptr)) {
+    LOG(ERROR) << "Couldn't rename " << PartPath(path).value();
+    return false;
+  }
+  return true;
+}
+}  // namespace
+
+constexpr size_t Downloader::kDefaultParallelTransfers;
+const char Downloader::kManifestName[] = "manifest.mpd";
+
+int64_t Downloader::Progress::BitsPerSecond() const {
+  int64_t elapsed_us = elapsed.InMicroseconds();
+  return elapsed_us > 0 ? bytes * 8 * base::Time::kMicrosecondsPerSecond /
+                              elapsed_us
+                        : 0;
+}
+
+// Runs requests of the download one after another on a thread of its own.
+class Downloader::Transfer : public base::DelegateSimpleThread::Delegate {
+ public:
+  explicit Transfer(Downloader* downloader)
+      : downloader_(downloader),
+        data_source_(CreateDataSource()),
+        buffer_(new char[kReadSize]) {}
+  ~Transfer() override {}
+
+  // base::DelegateSimpleThread::Delegate
+  void Run() override {
+    const DownloadRequest* request;
+    while ((request = downloader_->TakeRequest()) != nullptr) {
+      if (IsSaved(*request)) {
+        downloader_->RequestDone(true, false, 0);
+        continue;
+      }
+      bool saved = false;
+      int64_t bytes = 0;
+      for (int attempt = 0; attempt <= downloader_->options_.max_retries &&
+                            !saved && !downloader_->cancel_.IsSet();
+           attempt++) {
+        saved = Fetch(*request, &bytes);
+      }
+      downloader_->RequestDone(false, !saved, bytes);
+    }
+  }
+
+ private:
+  base::FilePath OutputPath(const DownloadRequest& request,
+                            size_t output) const {
+    return downloader_->directory_.AppendASCII(request.outputs[output].path);
+  }
+
+  bool IsSaved(const DownloadRequest& request) const {
+    for (size_t i = 0; i < request.outputs.size(); i++) {
+      if (!base::PathExists(OutputPath(request, i))) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Fetches |request| and saves its outputs, adding the bytes transferred to
+  // |bytes|. Returns true if all of them were saved.
+  bool Fetch(const DownloadRequest& request, int64_t* bytes) {
+    upstream::DataSpec spec(upstream::Uri(request.uri), request.position,
+                            request.length, nullptr);
+    if (data_source_->Open(spec, &downloader_->cancel_) ==
+        upstream::RESULT_IO_ERROR) {
+      data_source_->Close();
+      LOG(WARNING) << "Couldn't fetch " << spec.DebugString();
+      return false;
+    }
+
+    request_ = &request;
+    output_ = 0;
+    bool ok = true;
+    for (;;) {
+      ssize_t result = data_source_->Read(buffer_.get(), kReadSize);
+      if (result == upstream::RESULT_END_OF_INPUT) {
+        break;
+      }
+      if (result < 0 || downloader_->cancel_.IsSet()) {
+        ok = false;
+        break;
+      }
+      *bytes += result;
+      if (!Write(buffer_.get(), result)) {
+        ok = false;
+        break;
+      }
+    }
+    data_source_->Close();
+
+    // An output without a length takes the rest of the response.
+    if (ok && file_.IsValid() &&
+        request.outputs[output_].length == upstream::LENGTH_UNBOUNDED) {
+      file_.Close();
+      ok = Commit(OutputPath(request, output_++));
+    }
+    file_.Close();
+    if (ok && output_ != request.outputs.size()) {
+      LOG(WARNING) << spec.DebugString() << " ended early";
+      ok = false;
+    }
+    request_ = nullptr;
+    return ok;
+  }
+
+  // Writes |size| bytes of the response to the outputs they belong to.
+  bool Write(const char* data, size_t size) {
+    while (size > 0) {
+      if (output_ == request_->outputs.size()) {
+        LOG(WARNING) << request_->uri << " is longer than expected";
+        return false;
+      }
+      const DownloadRequest::Output& output = request_->outputs[output_];
+      if (!file_.IsValid()) {
+        file_.Initialize(PartPath(OutputPath(*request_, output_)),
+                         base::File::FLAG_CREATE_ALWAYS |
+                             base::File::FLAG_WRITE);
+        if (!file_.IsValid()) {
+          LOG(ERROR) << "Couldn't create "
+                     << PartPath(OutputPath(*request_, output_)).value();
+          return false;
+        }
+        written_ = 0;
+      }
+      size_t count = size;
+      if (output.length != upstream::LENGTH_UNBOUNDED) {
+        count = std::min<int64_t>(count, output.length - written_);
+      }
+      if (file_.WriteAtCurrentPos(data, count) != static_cast<int>(count)) {
+        LOG(ERROR) << "Couldn't write " << output.path;
+        return false;
+      }
+      data += count;
+      size -= count;
+      written_ += count;
+      if (written_ == output.length) {
+        file_.Close();
+        if (!Commit(OutputPath(*request_, output_++))) {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  Downloader* const downloader_;
+  const std::unique_ptr<upstream::HttpDataSourceInterface> data_source_;
+  const std::unique_ptr<char[]> buffer_;
+
+  // The request being fetched, the output being written and the bytes
+  // written to it so far.
+  const DownloadRequest* request_ = nullptr;
+  size_t output_ = 0;
+  base::File file_;
+  int64_t written_ = 0;
+
+  DISALLOW_COPY_AND_ASSIGN(Transfer);
+};
+
+Downloader::Downloader(const Options& options,
+                       const ProgressCallback& progress_callback)
+    : options_(options),
+      progress_callback_(progress_callback),
+      plan_(options.max_coalesced_bytes) {}
+
+Downloader::~Downloader() {}
+
+bool Downloader::Download(const std::string& manifest_uri,
+                          const std::vector<RepresentationKey>& selection,
+                          const base::FilePath& directory) {
+  // A Cancel() of an earlier download mustn't stop this one. No transfer
+  // thread is left to read the flag, so clearing it here is safe.
+  cancel_.UnsafeResetForTesting();
+  {
+    base::AutoLock auto_lock(lock_);
+    start_time_ = base::TimeTicks::Now();
+    next_request_ = 0;
+    progress_ = Progress();
+  }
+
+  std::string xml;
+  {
+    std::unique_ptr<upstream::HttpDataSourceInterface> data_source =
+        CreateDataSource();
+    if (data_source->Open(upstream::DataSpec(upstream::Uri(manifest_uri)),
+                          &cancel_) != upstream::RESULT_IO_ERROR) {
+      xml = data_source->ReadAllToString();
+    }
+    data_source->Close();
+  }
+  if (xml.empty()) {
+    LOG(ERROR) << "Couldn't fetch " << manifest_uri;
+    return false;
+  }
+  scoped_refptr<mpd::MediaPresentationDescription> manifest =
+      mpd::MediaPresentationDescriptionParser().Parse(manifest_uri, xml);
+  if (!manifest) {
+    LOG(ERROR) << "Couldn't parse " << manifest_uri;
+    return false;
+  }
+  if (!plan_.Build(*manifest,
+                   selection.empty()
+                       ? DownloadPlan::SelectHighestBandwidth(*manifest)
+                       : selection)) {
+    return false;
+  }
+
+  directory_ = directory;
+  for (const std::string& subdirectory : plan_.directories()) {
+    if (!base::CreateDirectory(directory_.AppendASCII(subdirectory))) {
+      LOG(ERROR) << "Couldn't create " << subdirectory << " in "
+                 << directory_.value();
+      return false;
+    }
+  }
+  {
+    base::AutoLock auto_lock(lock_);
+    progress_.requests_total = plan_.requests().size();
+  }
+
+  // Each transfer blocks on one request at a time; there are no more of them
+  // than there are requests.
+  size_t thread_count = std::max<size_t>(
+      1, std::min(options_.parallel_transfers, plan_.requests().size()));
+  std::vector<std::unique_ptr<Transfer>> transfers;
+  base::DelegateSimpleThreadPool pool("Download", thread_count);
+  for (size_t i = 0; i < thread_count; i++) {
+    transfers.emplace_back(new Transfer(this));
+    pool.AddWork(transfers.back().get());
+  }
+  pool.Start();
+  pool.JoinAll();
+
+  Progress progress = GetProgress();
+  if (cancel_.IsSet() || progress.requests_failed > 0 ||
+      progress.requests_done != progress.requests_total) {
+    LOG(WARNING) << "Download of " << manifest_uri << " incomplete: "
+                 << progress.requests_done << "/" << progress.requests_total
+                 << " requests done, " << progress.requests_failed
+                 << " failed";
+    return false;
+  }
+
+  base::FilePath manifest_path = directory_.AppendASCII(kManifestName);
+  const std::string& local_manifest = plan_.manifest();
+  if (base::WriteFile(PartPath(manifest_path), local_manifest.data(),
+                      local_manifest.size()) !=
+          static_cast<int>(local_manifest.size()) ||
+      !Commit(manifest_path)) {
+    LOG(ERROR) << "Couldn't write " << manifest_path.value();
+    return false;
+  }
+  VLOG(1) << "Downloaded " << manifest_uri << ": " << progress.bytes
+          << " bytes, " << progress.BitsPerSecond() << " bps";
+  return true;
+}
+
+void Downloader::Cancel() {
+  cancel_.Set();
+}
+
+Downloader::Progress Downloader::GetProgress() const {
+  base::AutoLock auto_lock(lock_);
+  Progress progress = progress_;
+  progress.elapsed = base::TimeTicks::Now() - start_time_;
+  return progress;
+}
+
+// static
+std::unique_ptr<upstream::HttpDataSourceInterface>
+Downloader::CreateDataSource() {
+  return std::unique_ptr<upstream::HttpDataSourceInterface>(
+      new upstream::DefaultUriDataSource(
+          std::unique_ptr<upstream::HttpDataSourceInterface>(
+              new upstream::CurlDataSource("download"))));
+}
+
+const DownloadRequest* Downloader::TakeRequest() {
+  base::AutoLock auto_lock(lock_);
+  if (cancel_.IsSet() || next_request_ == plan_.requests().size()) {
+    return nullptr;
+  }
+  return &plan_.requests()[next_request_++];
+}
+
+void Downloader::RequestDone(bool skipped, bool failed, int64_t bytes) {
+  Progress progress;
+  {
+    base::AutoLock auto_lock(lock_);
+    progress_.requests_done++;
+    progress_.requests_skipped += skipped;
+    progress_.requests_failed += failed;
+    progress_.bytes += bytes;
+    progress = progress_;
+    progress.elapsed = base::TimeTicks::Now() - start_time_;
+  }
+  if (!progress_callback_.is_null()) {
+    progress_callback_.Run(progress);
+  }
+}
+
+}  // namespace offline
+}  // namespace ndash
@@ -0,0 +1,133 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NDASH_OFFLINE_DOWNLOADER_H_
+#define NDASH_OFFLINE_DOWNLOADER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/callback.h"
+#include "base/files/file_path.h"
+#include "base/macros.h"
+#include "base/synchronization/cancellation_flag.h"
+#include "base/synchronization/lock.h"
+#include "base/time/time.h"
+#include "offline/download_plan.h"
+
+namespace ndash {
+
+namespace upstream {
+class HttpDataSourceInterface;
+}  // namespace upstream
+
+namespace offline {
+
+// Downloads DASH content for offline playback (or to warm a CDN): the
+// initialization and media segments of some representations, fetched with
+// many transfers at once, and a manifest that plays them through ndash.
+//
+// A download is resumable. Every file is written under a temporary name and
+// renamed when complete, and requests whose files are all there already are
+// skipped, so running the same download again picks up where a failed or
+// canceled one stopped. The manifest is written last.
+class Downloader {
+ public:
+  static constexpr size_t kDefaultParallelTransfers = 8;
+  // The name of the manifest in the download directory.
+  static const char kManifestName[];
+
+  struct Options {
+    // How many requests are in flight at once.
+    size_t parallel_transfers = kDefaultParallelTransfers;
+    // Passed to DownloadPlan.
+    int64_t max_coalesced_bytes = DownloadPlan::kDefaultMaxCoalescedBytes;
+    // How many times a failed request is retried before the download fails.
+    int max_retries = 2;
+  };
+
+  struct Progress {
+    int64_t BitsPerSecond() const;
+
+    int requests_total = 0;
+    // Requests finished so far, including those skipped or failed.
+    int requests_done = 0;
+    // Requests whose files were already downloaded.
+    int requests_skipped = 0;
+    int requests_failed = 0;
+    // Bytes transferred (not counting skipped requests).
+    int64_t bytes = 0;
+    base::TimeDelta elapsed;
+  };
+  // Called on a transfer thread after each request.
+  typedef base::Callback<void(const Progress&)> ProgressCallback;
+
+  explicit Downloader(const Options& options,
+                      const ProgressCallback& progress_callback =
+                          ProgressCallback());
+  ~Downloader();
+
+  // Downloads |selection| (the highest bandwidth representation of every
+  // adaptation set if empty) of the manifest at |manifest_uri| into
+  // |directory|. Blocks until every request is done or the download is
+  // canceled. Returns true if the whole copy is in |directory|.
+  bool Download(const std::string& manifest_uri,
+                const std::vector<RepresentationKey>& selection,
+                const base::FilePath& directory);
+
+  // Makes the Download() in progress stop as soon as the requests in flight
+  // end. A later Download() runs to completion again. Must be called on the
+  // thread that made the downloader (base::CancellationFlag checks that).
+  void Cancel();
+
+  // May be called from any thread.
+  Progress GetProgress() const;
+
+ private:
+  class Transfer;
+
+  // Makes the data source for a transfer thread, or for the manifest.
+  static std::unique_ptr<upstream::HttpDataSourceInterface> CreateDataSource();
+
+  // Takes the next request for a transfer thread, or returns nullptr if there
+  // are none left or the download was canceled.
+  const DownloadRequest* TakeRequest();
+  // Records the outcome of a request.
+  void RequestDone(bool skipped, bool failed, int64_t bytes);
+
+  const Options options_;
+  const ProgressCallback progress_callback_;
+  base::CancellationFlag cancel_;
+
+  DownloadPlan plan_;
+  base::FilePath directory_;
+  base::TimeTicks start_time_;
+
+  // Guards the following.
+  mutable base::Lock lock_;
+  size_t next_request_ = 0;
+  Progress progress_;
+
+  DISALLOW_COPY_AND_ASSIGN(Downloader);
+};
+
+}  // namespace offline
+}  // namespace ndash
+
+#endif  // NDASH_OFFLINE_DOWNLOADER_H_
@@ -0,0 +1,232 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "offline/downloader.h"
+
+#include <string>
+#include <vector>
+
+#include "base/bind.h"
+#include "base/files/file_util.h"
+#include "base/files/scoped_temp_dir.h"
+#include "base/synchronization/waitable_event.h"
+#include "base/threading/simple_thread.h"
+#include "gtest/gtest.h"
+#include "mpd/dash_manifest_representation_parser.h"
+#include "mpd/media_presentation_description.h"
+
+namespace ndash {
+namespace offline {
+
+namespace {
+// Two representations of separate segment files, one as ranges of a file.
+const char kManifest[] =
+    "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+    "<MPD xmlns=\"urn:mpeg:DASH:schema:MPD:2011\" type=\"static\" "
+    "minBufferTime=\"PT2S\" mediaPresentationDuration=\"PT4S\">\n"
+    " <Period start=\"PT0S\">\n"
+    "  <AdaptationSet id=\"0\" contentType=\"video\">\n"
+    "   <Representation id=\"v\" mimeType=\"video/mp4\" "
+    "codecs=\"avc1.4d401f\" bandwidth=\"1000000\" width=\"1280\" "
+    "height=\"720\">\n"
+    "    <SegmentTemplate timescale=\"1000\" duration=\"2000\" "
+    "startNumber=\"1\" initialization=\"v/init.mp4\" "
+    "media=\"v/$Number$.m4s\"/>\n"
+    "   </Representation>\n"
+    "  </AdaptationSet>\n"
+    "  <AdaptationSet id=\"1\" contentType=\"audio\">\n"
+    "   <Representation id=\"a\" mimeType=\"audio/mp4\" "
+    "codecs=\"mp4a.40.2\" bandwidth=\"128000\" audioSamplingRate=\"48000\">\n"
+    "    <SegmentList timescale=\"1000\" duration=\"2000\">\n"
+    "     <Initialization sourceURL=\"audio.mp4\" range=\"0-9\"/>\n"
+    "     <SegmentURL media=\"audio.mp4\" mediaRange=\"10-29\"/>\n"
+    "     <SegmentURL media=\"audio.mp4\" mediaRange=\"30-59\"/>\n"
+    "    </SegmentList>\n"
+    "   </Representation>\n"
+    "  </AdaptationSet>\n"
+    " </Period>\n"
+    "</MPD>\n";
+
+const std::vector<RepresentationKey> kSelection = {{0, 0, 0}, {0, 1, 0}};
+
+void CountProgress(int* calls, const Downloader::Progress& progress) {
+  (*calls)++;
+}
+
+// Tells |request_done| about a finished request and waits for |resume|.
+void PauseAfterRequest(base::WaitableEvent* request_done,
+                       base::WaitableEvent* resume,
+                       const Downloader::Progress& progress) {
+  request_done->Signal();
+  resume->Wait();
+}
+
+// Runs a download on a thread of its own.
+class DownloadRunner : public base::DelegateSimpleThread::Delegate {
+ public:
+  DownloadRunner(Downloader* downloader,
+                 const std::string& manifest_uri,
+                 const base::FilePath& directory)
+      : downloader_(downloader),
+        manifest_uri_(manifest_uri),
+        directory_(directory) {}
+
+  void Run() override {
+    result_ = downloader_->Download(manifest_uri_, kSelection, directory_);
+  }
+
+  bool result() const { return result_; }
+
+ private:
+  Downloader* const downloader_;
+  const std::string manifest_uri_;
+  const base::FilePath directory_;
+  bool result_ = false;
+};
+}  // namespace
+
+class DownloaderTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    ASSERT_TRUE(dir_.CreateUniqueTempDir());
+    source_ = dir_.path().Append("source");
+    copy_ = dir_.path().Append("copy");
+    ASSERT_TRUE(base::CreateDirectory(source_.Append("v")));
+    Put("manifest.mpd", kManifest);
+    Put("v/init.mp4", "video init");
+    Put("v/1.m4s", std::string(1000, '1'));
+    Put("v/2.m4s", std::string(2000, '2'));
+    audio_ = "audioinit" + std::string(51, 'a');
+    Put("audio.mp4", audio_);
+    manifest_uri_ = "file://" + source_.Append("manifest.mpd").value();
+  }
+
+  void Put(const std::string& path, const std::string& contents) {
+    ASSERT_EQ(static_cast<int>(contents.size()),
+              base::WriteFile(source_.Append(path), contents.data(),
+                              contents.size()));
+  }
+
+  std::string Get(const std::string& path) {
+    std::string contents;
+    EXPECT_TRUE(base::ReadFileToString(copy_.Append(path), &contents))
+        << path;
+    return contents;
+  }
+
+  base::ScopedTempDir dir_;
+  base::FilePath source_;
+  base::FilePath copy_;
+  std::string audio_;
+  std::string manifest_uri_;
+};
+
+TEST_F(DownloaderTest, DownloadsAndResumes) {
+  int progress_calls = 0;
+  Downloader::Options options;
+  options.parallel_transfers = 3;
+  {
+    Downloader downloader(options, base::Bind(&CountProgress,
+                                              &progress_calls));
+    ASSERT_TRUE(downloader.Download(manifest_uri_, kSelection, copy_));
+    Downloader::Progress progress = downloader.GetProgress();
+    // Three video files, and the audio ranges in one request.
+    EXPECT_EQ(4, progress.requests_total);
+    EXPECT_EQ(4, progress.requests_done);
+    EXPECT_EQ(0, progress.requests_skipped);
+    EXPECT_EQ(0, progress.requests_failed);
+    EXPECT_EQ(10 + 1000 + 2000 + 60, progress.bytes);
+    EXPECT_EQ(4, progress_calls);
+  }
+
+  EXPECT_EQ("video init", Get("p0_a0_r0/init.mp4"));
+  EXPECT_EQ(std::string(1000, '1'), Get("p0_a0_r0/1.m4s"));
+  EXPECT_EQ(std::string(2000, '2'), Get("p0_a0_r0/2.m4s"));
+  EXPECT_EQ(audio_.substr(0, 10), Get("p0_a1_r0/init.mp4"));
+  EXPECT_EQ(audio_.substr(10, 20), Get("p0_a1_r0/1.m4s"));
+  EXPECT_EQ(audio_.substr(30, 30), Get("p0_a1_r0/2.m4s"));
+  EXPECT_FALSE(base::PathExists(copy_.Append("p0_a0_r0/1.m4s.part")));
+
+  std::string manifest = Get(Downloader::kManifestName);
+  scoped_refptr<mpd::MediaPresentationDescription> copy =
+      mpd::MediaPresentationDescriptionParser().Parse(
+          "file://" + copy_.Append(Downloader::kManifestName).value(),
+          manifest);
+  ASSERT_TRUE(copy);
+  EXPECT_EQ(2u, copy->GetPeriod(0)->GetAdaptationSetCount());
+
+  // Only what's missing is fetched again.
+  ASSERT_TRUE(base::DeleteFile(copy_.Append("p0_a0_r0/2.m4s"), false));
+  Downloader downloader(options);
+  ASSERT_TRUE(downloader.Download(manifest_uri_, kSelection, copy_));
+  Downloader::Progress progress = downloader.GetProgress();
+  EXPECT_EQ(4, progress.requests_done);
+  EXPECT_EQ(3, progress.requests_skipped);
+  EXPECT_EQ(2000, progress.bytes);
+  EXPECT_EQ(std::string(2000, '2'), Get("p0_a0_r0/2.m4s"));
+}
+
+TEST_F(DownloaderTest, Failures) {
+  ASSERT_TRUE(base::DeleteFile(source_.Append("v/2.m4s"), false));
+  Downloader::Options options;
+  options.max_retries = 1;
+  Downloader downloader(options);
+  EXPECT_FALSE(downloader.Download(manifest_uri_, kSelection, copy_));
+  Downloader::Progress progress = downloader.GetProgress();
+  EXPECT_EQ(4, progress.requests_done);
+  EXPECT_EQ(1, progress.requests_failed);
+  // Nothing is left looking complete.
+  EXPECT_FALSE(base::PathExists(copy_.Append("p0_a0_r0/2.m4s")));
+  EXPECT_FALSE(base::PathExists(copy_.Append(Downloader::kManifestName)));
+
+  // The rest is picked up once the file is back.
+  Put("v/2.m4s", std::string(2000, '2'));
+  EXPECT_TRUE(downloader.Download(manifest_uri_, kSelection, copy_));
+  EXPECT_EQ(3, downloader.GetProgress().requests_skipped);
+  EXPECT_TRUE(base::PathExists(copy_.Append(Downloader::kManifestName)));
+
+  EXPECT_FALSE(
+      downloader.Download(manifest_uri_ + ".missing", kSelection, copy_));
+}
+
+TEST_F(DownloaderTest, CancelThenDownload) {
+  base::WaitableEvent request_done(false, false);
+  base::WaitableEvent resume(true, false);
+  Downloader::Options options;
+  options.parallel_transfers = 1;
+  Downloader downloader(options, base::Bind(&PauseAfterRequest,
+                                            &request_done, &resume));
+
+  DownloadRunner runner(&downloader, manifest_uri_, copy_);
+  base::DelegateSimpleThread thread(&runner, "Download");
+  thread.Start();
+  request_done.Wait();
+  downloader.Cancel();
+  resume.Signal();
+  thread.Join();
+  EXPECT_FALSE(runner.result());
+  EXPECT_EQ(1, downloader.GetProgress().requests_done);
+  EXPECT_FALSE(base::PathExists(copy_.Append(Downloader::kManifestName)));
+
+  // The cancel doesn't stick to the next download.
+  EXPECT_TRUE(downloader.Download(manifest_uri_, kSelection, copy_));
+  EXPECT_EQ(4, downloader.GetProgress().requests_done);
+  EXPECT_EQ(1, downloader.GetProgress().requests_skipped);
+  EXPECT_TRUE(base::PathExists(copy_.Append(Downloader::kManifestName)));
+}
+
+}  // namespace offline
+}  // namespace ndash
@@ -19,6 +19,10 @@
 
 #include <string>
 
+#include "base/time/time.h"
+#include "memory_governor.h"
+#include "tracing.h"
+
 namespace ndash {
 
 // A container for player attributes.
@@ -31,6 +35,43 @@ class PlayerAttributes {
   std::string auth_token;
   // The license server url from which to fetch playback licenses.
   std::string license_url;
+  // Run loaders and network transfers on the process-wide LoaderPool instead
+  // of dedicated per-track threads.
+  bool shared_executor = false;
+  // For live streams, how far behind the live edge to play. Zero keeps the
+  // default behaviour (no latency control).
+  base::TimeDelta live_target_latency;
+  // Directory in which state is kept from one session to the next (see
+  // SessionStateStore), or empty for none.
+  std::string session_state_dir;
+  // Load buffered video again in the new format after an upswitch, instead
+  // of keeping or discarding it (see ChunkSampleSource).
+  bool replace_on_upswitch = false;
+  // The playback rate (either direction) from which video frames that no
+  // other frame is predicted from are dropped instead of decoded, or 0 to
+  // decode them all.
+  double non_reference_drop_rate = 0;
+  // Mark H.264 video frames as reference or non-reference frames while
+  // parsing them.
+  bool classify_frames = true;
+  // How far ahead the audio and caption streams that are not selected are
+  // loaded, so that switching to one is immediate, or zero to load only the
+  // selected ones.
+  base::TimeDelta alternate_track_buffer;
+  // This player's weight when the MemoryGovernor divides its budget.
+  int memory_priority = MemoryGovernor::kDefaultPriority;
+  // Where the trace being recorded is written when it stops, or empty if
+  // this player isn't recording one.
+  std::string trace_file;
+  // The trace categories to record (see StartTracing()).
+  std::string trace_categories = kDefaultTraceCategories;
+  // Where the network traffic of this session is recorded to, or replayed
+  // from (see NetworkTrace), or empty for neither.
+  std::string network_record_file;
+  std::string network_replay_file;
+  // Whether a replay keeps the timing of the recording, rather than serving
+  // everything as fast as it can.
+  bool network_replay_paced = true;
 };
 
 }  // namespace ndash
@@ -87,6 +87,14 @@ SampleSourceReaderInterface::ReadResult SampleSourceTrackRenderer::ReadFrame(
     return SampleSourceReaderInterface::NOTHING_READ;
   }
 
+  // Buffer() only runs every update interval. Samples are published as each
+  // one is parsed from a chunk that is still loading, so check again rather
+  // than leave them waiting for the next update (which would otherwise set
+  // the time to first frame after loading or seeking).
+  if (!source_is_ready_) {
+    source_is_ready_ = source_->ContinueBuffering(position_us);
+  }
+
   // NOTE: At this point in the ExoPlayer implementation, we would call into
   // the subclass implementation to do some work.  In our case, we consume from
   // the sample queue so we can deliver it back to the pull reader.
@@ -146,6 +146,7 @@ TEST(SampleSourceTrackRenderer, BufferAndReadFrames) {
   // Nothing to read yet.
   EXPECT_CALL(source_reader, ReadDiscontinuity())
       .WillOnce(Return(SampleSourceReaderInterface::NO_DISCONTINUITY));
+  EXPECT_CALL(source_reader, ContinueBuffering(0)).WillOnce(Return(false));
   int result = track.ReadFrame(0, &format_holder, &sample_holder, &error);
   EXPECT_EQ(SampleSourceReaderInterface::NOTHING_READ, result);
 
@@ -164,4 +165,51 @@ TEST(SampleSourceTrackRenderer, BufferAndReadFrames) {
   EXPECT_CALL(source_reader, Release());
 }
 
+TEST(SampleSourceTrackRenderer, ReadsSamplesPublishedBetweenBuffers) {
+  std::unique_ptr<MediaFormat> format = MediaFormat::CreateVideoFormat(
+      "1", "video/mp4", "h264", 2200000, 32768, 1234567, 640, 480,
+      MakeInitData(), 16, 45, 1.666);
+
+  SampleSourceReaderMock source_reader;
+  SampleSourceMock source;
+  EXPECT_CALL(source, Register()).WillOnce(Return(&source_reader));
+  EXPECT_CALL(source_reader, Prepare(0)).WillOnce(Return(true));
+  EXPECT_CALL(source_reader, GetDurationUs())
+      .WillRepeatedly(Return(format->GetDurationUs()));
+
+  SampleSourceTrackRenderer track(&source);
+  EXPECT_EQ(true, track.Prepare(0));
+  TrackCriteria criteria("video");
+  EXPECT_CALL(source_reader, Enable(_, 0));
+  EXPECT_EQ(true, track.Enable(&criteria, 0, false));
+  EXPECT_EQ(true, track.Start());
+
+  // The chunk has started loading but nothing has been parsed.
+  EXPECT_CALL(source_reader, ContinueBuffering(0)).WillOnce(Return(false));
+  track.Buffer(0);
+
+  // The first sample is parsed before the next Buffer() call; it can be read
+  // straight away.
+  MediaFormatHolder format_holder;
+  SampleHolder sample_holder(true);
+  bool error;
+  EXPECT_CALL(source_reader, ReadDiscontinuity())
+      .WillOnce(Return(SampleSourceReaderInterface::NO_DISCONTINUITY));
+  EXPECT_CALL(source_reader, ContinueBuffering(0)).WillOnce(Return(true));
+  EXPECT_CALL(source_reader, ReadData(0, _, _))
+      .WillOnce(Return(SampleSourceReaderInterface::SAMPLE_READ));
+  int result = track.ReadFrame(0, &format_holder, &sample_holder, &error);
+  EXPECT_EQ(SampleSourceReaderInterface::SAMPLE_READ, result);
+
+  // Once ready, reads do not buffer again.
+  EXPECT_CALL(source_reader, ReadDiscontinuity())
+      .WillOnce(Return(SampleSourceReaderInterface::NO_DISCONTINUITY));
+  EXPECT_CALL(source_reader, ReadData(0, _, _))
+      .WillOnce(Return(SampleSourceReaderInterface::SAMPLE_READ));
+  result = track.ReadFrame(0, &format_holder, &sample_holder, &error);
+  EXPECT_EQ(SampleSourceReaderInterface::SAMPLE_READ, result);
+
+  EXPECT_CALL(source_reader, Release());
+}
+
 }  // namespace ndash
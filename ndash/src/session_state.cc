@@ -0,0 +1,308 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "session_state.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include "base/files/file_enumerator.h"
+#include "base/files/file_util.h"
+#include "base/files/important_file_writer.h"
+#include "base/logging.h"
+#include "base/md5.h"
+#include "base/pickle.h"
+#include "upstream/bandwidth_meter.h"
+#include "upstream/constants.h"
+#include "upstream/data_spec.h"
+#include "util/uri_util.h"
+
+namespace ndash {
+
+namespace {
+// Bumped whenever a file format changes; files of other versions are
+// ignored.
+const int kVersion = 1;
+const char kSegmentPrefix[] = "segment-";
+
+std::string ContentOf(const std::string& manifest_url) {
+  return manifest_url.substr(0, manifest_url.find('?'));
+}
+
+std::string SegmentKey(const upstream::DataSpec& data_spec) {
+  return data_spec.uri.uri() + "@" + std::to_string(data_spec.position) +
+         "+" + std::to_string(data_spec.length);
+}
+
+bool ReadPickle(const base::FilePath& path,
+                std::string* contents,
+                std::unique_ptr<base::Pickle>* pickle) {
+  if (!base::ReadFileToString(path, contents)) {
+    return false;
+  }
+  pickle->reset(new base::Pickle(contents->data(), contents->size()));
+  return true;
+}
+
+bool WritePickle(const base::FilePath& path, const base::Pickle& pickle) {
+  return base::ImportantFileWriter::WriteFileAtomically(
+      path, base::StringPiece(static_cast<const char*>(pickle.data()),
+                              pickle.size()));
+}
+}  // namespace
+
+constexpr int SessionStateStore::kMaxSegments;
+constexpr size_t SessionStateStore::kMaxSegmentSize;
+
+SessionStateStore::SessionStateStore(const base::FilePath& directory,
+                                     const std::string& manifest_url)
+    : directory_(directory),
+      host_(util::UriUtil::Resolve(manifest_url, "/")),
+      content_(ContentOf(manifest_url)),
+      bitrate_estimate_(upstream::BandwidthMeterInterface::kNoEstimate) {}
+
+SessionStateStore::~SessionStateStore() {}
+
+void SessionStateStore::Load() {
+  std::string contents;
+  std::unique_ptr<base::Pickle> pickle;
+  int version;
+
+  if (ReadPickle(HostStatePath(), &contents, &pickle)) {
+    base::PickleIterator iter(*pickle);
+    std::string host;
+    int64_t bitrate;
+    int64_t time;
+    if (iter.ReadInt(&version) && version == kVersion &&
+        iter.ReadString(&host) && host == host_ && iter.ReadInt64(&bitrate) &&
+        iter.ReadInt64(&time)) {
+      bitrate_estimate_ = bitrate;
+      bitrate_estimate_time_ = base::Time::FromInternalValue(time);
+    }
+  }
+
+  if (ReadPickle(ContentStatePath(), &contents, &pickle)) {
+    base::PickleIterator iter(*pickle);
+    std::string content;
+    int count;
+    if (iter.ReadInt(&version) && version == kVersion &&
+        iter.ReadString(&content) && content == content_ &&
+        iter.ReadInt(&count)) {
+      for (int i = 0; i < count; i++) {
+        int type;
+        std::string id;
+        if (!iter.ReadInt(&type) || !iter.ReadString(&id)) {
+          break;
+        }
+        selected_format_ids_[static_cast<mpd::AdaptationType>(type)] = id;
+      }
+    }
+  }
+}
+
+bool SessionStateStore::Save() {
+  if (!base::CreateDirectory(directory_)) {
+    LOG(WARNING) << "Couldn't create " << directory_.value();
+    return false;
+  }
+
+  bool ok = true;
+  if (bitrate_estimate_ != upstream::BandwidthMeterInterface::kNoEstimate) {
+    base::Pickle pickle;
+    pickle.WriteInt(kVersion);
+    pickle.WriteString(host_);
+    pickle.WriteInt64(bitrate_estimate_);
+    pickle.WriteInt64(bitrate_estimate_time_.ToInternalValue());
+    ok &= WritePickle(HostStatePath(), pickle);
+  }
+
+  base::Pickle pickle;
+  pickle.WriteInt(kVersion);
+  pickle.WriteString(content_);
+  pickle.WriteInt(selected_format_ids_.size());
+  for (const auto& selected : selected_format_ids_) {
+    pickle.WriteInt(static_cast<int>(selected.first));
+    pickle.WriteString(selected.second);
+  }
+  ok &= WritePickle(ContentStatePath(), pickle);
+
+  LOG_IF(WARNING, !ok) << "Couldn't save session state in "
+                       << directory_.value();
+  return ok;
+}
+
+int64_t SessionStateStore::GetBitrateEstimate(base::Time now,
+                                              base::TimeDelta max_age) const {
+  if (now - bitrate_estimate_time_ > max_age) {
+    return upstream::BandwidthMeterInterface::kNoEstimate;
+  }
+  return bitrate_estimate_;
+}
+
+void SessionStateStore::SetBitrateEstimate(int64_t bitrate, base::Time now) {
+  bitrate_estimate_ = bitrate;
+  bitrate_estimate_time_ = now;
+}
+
+std::string SessionStateStore::GetSelectedFormatId(
+    mpd::AdaptationType type) const {
+  auto it = selected_format_ids_.find(type);
+  return it == selected_format_ids_.end() ? std::string() : it->second;
+}
+
+void SessionStateStore::SetSelectedFormatId(mpd::AdaptationType type,
+                                            const std::string& id) {
+  selected_format_ids_[type] = id;
+}
+
+bool SessionStateStore::GetSegment(const upstream::DataSpec& data_spec,
+                                   std::string* data) {
+  const std::string segment_key = SegmentKey(data_spec);
+  std::string contents;
+  std::unique_ptr<base::Pickle> pickle;
+  {
+    base::AutoLock auto_lock(segment_lock_);
+    if (!ReadPickle(SegmentPath(segment_key), &contents, &pickle)) {
+      return false;
+    }
+  }
+
+  base::PickleIterator iter(*pickle);
+  int version;
+  std::string key;
+  // The key is checked in case two of them hash to the same file name.
+  return iter.ReadInt(&version) && version == kVersion &&
+         iter.ReadString(&key) && key == segment_key && iter.ReadString(data);
+}
+
+void SessionStateStore::PutSegment(const upstream::DataSpec& data_spec,
+                                   const std::string& data) {
+  if (data.size() > kMaxSegmentSize) {
+    return;
+  }
+  const std::string segment_key = SegmentKey(data_spec);
+  base::Pickle pickle;
+  pickle.WriteInt(kVersion);
+  pickle.WriteString(segment_key);
+  pickle.WriteString(data);
+
+  base::AutoLock auto_lock(segment_lock_);
+  if (!base::CreateDirectory(directory_) ||
+      !WritePickle(SegmentPath(segment_key), pickle)) {
+    LOG(WARNING) << "Couldn't save segment " << segment_key;
+    return;
+  }
+  TrimSegments();
+}
+
+base::FilePath SessionStateStore::HostStatePath() const {
+  return directory_.Append("host-" + base::MD5String(host_));
+}
+
+base::FilePath SessionStateStore::ContentStatePath() const {
+  return directory_.Append("content-" + base::MD5String(content_));
+}
+
+base::FilePath SessionStateStore::SegmentPath(
+    const std::string& segment_key) const {
+  return directory_.Append(kSegmentPrefix + base::MD5String(segment_key));
+}
+
+void SessionStateStore::TrimSegments() {
+  segment_lock_.AssertAcquired();
+  std::vector<std::pair<base::Time, base::FilePath>> segments;
+  base::FileEnumerator enumerator(directory_, false,
+                                  base::FileEnumerator::FILES,
+                                  std::string(kSegmentPrefix) + "*");
+  for (base::FilePath path = enumerator.Next(); !path.empty();
+       path = enumerator.Next()) {
+    segments.emplace_back(enumerator.GetInfo().GetLastModifiedTime(), path);
+  }
+  if (segments.size() <= kMaxSegments) {
+    return;
+  }
+  std::sort(segments.begin(), segments.end());
+  for (size_t i = 0; i < segments.size() - kMaxSegments; i++) {
+    base::DeleteFile(segments[i].second, false);
+  }
+}
+
+SessionStateDataSource::SessionStateDataSource(
+    upstream::DataSourceInterface* upstream,
+    SessionStateStore* store)
+    : upstream_(upstream), store_(store) {}
+
+SessionStateDataSource::~SessionStateDataSource() {}
+
+ssize_t SessionStateDataSource::Open(const upstream::DataSpec& data_spec,
+                                     const base::CancellationFlag* cancel) {
+  DCHECK(!from_store_ && !reading_upstream_);
+  if (!data_spec.post_body && store_->GetSegment(data_spec, &data_)) {
+    VLOG(2) << "Using stored " << data_spec.DebugString();
+    from_store_ = true;
+    return data_.size();
+  }
+
+  ssize_t result = upstream_->Open(data_spec, cancel);
+  reading_upstream_ = true;
+  if (result != upstream::RESULT_IO_ERROR && !data_spec.post_body) {
+    data_spec_.reset(new upstream::DataSpec(data_spec));
+  }
+  return result;
+}
+
+void SessionStateDataSource::Close() {
+  if (reading_upstream_) {
+    upstream_->Close();
+  }
+  data_spec_.reset();
+  data_.clear();
+  read_pos_ = 0;
+  from_store_ = false;
+  reading_upstream_ = false;
+}
+
+ssize_t SessionStateDataSource::Read(void* buffer, size_t read_length) {
+  if (from_store_) {
+    if (read_pos_ == data_.size()) {
+      return upstream::RESULT_END_OF_INPUT;
+    }
+    size_t count = std::min(read_length, data_.size() - read_pos_);
+    memcpy(buffer, data_.data() + read_pos_, count);
+    read_pos_ += count;
+    return count;
+  }
+
+  ssize_t result = upstream_->Read(buffer, read_length);
+  if (data_spec_) {
+    if (result >= 0 &&
+        data_.size() + result <= SessionStateStore::kMaxSegmentSize) {
+      data_.append(static_cast<const char*>(buffer), result);
+    } else if (result == upstream::RESULT_END_OF_INPUT) {
+      store_->PutSegment(*data_spec_, data_);
+      data_spec_.reset();
+    } else {
+      // Too large to keep, or failed.
+      data_spec_.reset();
+      data_.clear();
+    }
+  }
+  return result;
+}
+
+}  // namespace ndash
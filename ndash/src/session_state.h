@@ -0,0 +1,134 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NDASH_SESSION_STATE_H_
+#define NDASH_SESSION_STATE_H_
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+
+#include "base/files/file_path.h"
+#include "base/macros.h"
+#include "base/synchronization/lock.h"
+#include "base/time/time.h"
+#include "mpd/adaptation_set.h"
+#include "upstream/data_source.h"
+
+namespace ndash {
+
+namespace upstream {
+class DataSpec;
+}  // namespace upstream
+
+// State carried from one session to the next so that a player starting on
+// content it has recently played (or on a host it has recently used) does
+// not begin from scratch: the bandwidth estimate, the format chosen for each
+// adaptation set, and the initialization and index segments.
+//
+// Everything lives in files under one directory, which several players may
+// share. The bandwidth estimate is kept per host; the rest per manifest URL
+// (ignoring the query, which often carries a per-session token).
+class SessionStateStore {
+ public:
+  // How many segments are kept before the least recently written go.
+  static constexpr int kMaxSegments = 64;
+  // Larger segments are not kept.
+  static constexpr size_t kMaxSegmentSize = 1024 * 1024;
+
+  SessionStateStore(const base::FilePath& directory,
+                    const std::string& manifest_url);
+  ~SessionStateStore();
+
+  // Reads what an earlier session saved, if anything.
+  void Load();
+  // Writes the bandwidth estimate and selected formats. Returns false on
+  // error.
+  bool Save();
+
+  // Returns the saved bandwidth estimate if it was made no earlier than
+  // |max_age| before |now|, or BandwidthMeterInterface::kNoEstimate.
+  int64_t GetBitrateEstimate(base::Time now, base::TimeDelta max_age) const;
+  void SetBitrateEstimate(int64_t bitrate, base::Time now);
+
+  // Returns the id of the format last selected for |type|, or "".
+  std::string GetSelectedFormatId(mpd::AdaptationType type) const;
+  void SetSelectedFormatId(mpd::AdaptationType type, const std::string& id);
+
+  // Segments are keyed by the URI and byte range of |data_spec|. These may be
+  // called from any thread.
+  bool GetSegment(const upstream::DataSpec& data_spec, std::string* data);
+  void PutSegment(const upstream::DataSpec& data_spec, const std::string& data);
+
+ private:
+  base::FilePath HostStatePath() const;
+  base::FilePath ContentStatePath() const;
+  base::FilePath SegmentPath(const std::string& segment_key) const;
+  // Deletes the oldest segments beyond kMaxSegments.
+  void TrimSegments();
+
+  const base::FilePath directory_;
+  // Scheme and authority of the manifest URL, e.g. "http://cdn.example/".
+  const std::string host_;
+  // Manifest URL without its query.
+  const std::string content_;
+
+  int64_t bitrate_estimate_;
+  base::Time bitrate_estimate_time_;
+  std::map<mpd::AdaptationType, std::string> selected_format_ids_;
+
+  // Serializes segment file access.
+  base::Lock segment_lock_;
+
+  DISALLOW_COPY_AND_ASSIGN(SessionStateStore);
+};
+
+// Serves requests from the segments in a SessionStateStore when it has them,
+// and otherwise from |upstream|, keeping what was read in the store once the
+// request completes. Meant for initialization and index requests, which are
+// small and repeat every time the same content is played.
+class SessionStateDataSource : public upstream::DataSourceInterface {
+ public:
+  // |upstream| and |store| must outlive this object.
+  SessionStateDataSource(upstream::DataSourceInterface* upstream,
+                         SessionStateStore* store);
+  ~SessionStateDataSource() override;
+
+  // DataSourceInterface
+  ssize_t Open(const upstream::DataSpec& data_spec,
+               const base::CancellationFlag* cancel = nullptr) override;
+  void Close() override;
+  ssize_t Read(void* buffer, size_t read_length) override;
+
+ private:
+  upstream::DataSourceInterface* const upstream_;
+  SessionStateStore* const store_;
+
+  // The request being read from |upstream_| and kept, or null.
+  std::unique_ptr<upstream::DataSpec> data_spec_;
+  // Stored data, or data read so far from upstream.
+  std::string data_;
+  size_t read_pos_ = 0;
+  bool from_store_ = false;
+  bool reading_upstream_ = false;
+
+  DISALLOW_COPY_AND_ASSIGN(SessionStateDataSource);
+};
+
+}  // namespace ndash
+
+#endif  // NDASH_SESSION_STATE_H_
@@ -0,0 +1,217 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "session_state.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+#include "base/files/file_enumerator.h"
+#include "base/files/scoped_temp_dir.h"
+#include "gtest/gtest.h"
+#include "upstream/bandwidth_meter.h"
+#include "upstream/constants.h"
+#include "upstream/data_spec.h"
+
+namespace ndash {
+
+namespace {
+
+const char kManifestUrl[] = "http://cdn.example/movie/manifest.mpd?token=1";
+
+// Serves |body| for any request, counting the requests.
+class StringDataSource : public upstream::DataSourceInterface {
+ public:
+  explicit StringDataSource(const std::string& body) : body_(body) {}
+
+  ssize_t Open(const upstream::DataSpec& data_spec,
+               const base::CancellationFlag* cancel) override {
+    opens_++;
+    pos_ = 0;
+    return body_.size();
+  }
+  void Close() override {}
+  ssize_t Read(void* buffer, size_t read_length) override {
+    if (pos_ == body_.size()) {
+      return upstream::RESULT_END_OF_INPUT;
+    }
+    size_t count = std::min(read_length, body_.size() - pos_);
+    memcpy(buffer, body_.data() + pos_, count);
+    pos_ += count;
+    return count;
+  }
+
+  int opens() const { return opens_; }
+
+ private:
+  const std::string body_;
+  size_t pos_ = 0;
+  int opens_ = 0;
+};
+
+upstream::DataSpec SpecFor(const std::string& uri, int64_t position = 0) {
+  return upstream::DataSpec(upstream::Uri(uri), position, 100, nullptr);
+}
+
+std::string ReadAll(upstream::DataSourceInterface* source) {
+  std::string out;
+  char buffer[5];
+  while (true) {
+    ssize_t count = source->Read(buffer, sizeof(buffer));
+    if (count < 0) {
+      EXPECT_EQ(upstream::RESULT_END_OF_INPUT, count);
+      break;
+    }
+    out.append(buffer, count);
+  }
+  return out;
+}
+
+int CountFiles(const base::FilePath& directory, const std::string& pattern) {
+  base::FileEnumerator enumerator(directory, false,
+                                  base::FileEnumerator::FILES, pattern);
+  int count = 0;
+  while (!enumerator.Next().empty()) {
+    count++;
+  }
+  return count;
+}
+
+}  // namespace
+
+TEST(SessionStateStoreTest, SavesAndLoads) {
+  base::ScopedTempDir dir;
+  ASSERT_TRUE(dir.CreateUniqueTempDir());
+  const base::Time now = base::Time::Now();
+  const base::TimeDelta max_age = base::TimeDelta::FromMinutes(10);
+
+  {
+    SessionStateStore store(dir.path(), kManifestUrl);
+    store.Load();
+    EXPECT_EQ(upstream::BandwidthMeterInterface::kNoEstimate,
+              store.GetBitrateEstimate(now, max_age));
+    EXPECT_EQ("", store.GetSelectedFormatId(mpd::AdaptationType::VIDEO));
+
+    store.SetBitrateEstimate(4000000, now);
+    store.SetSelectedFormatId(mpd::AdaptationType::VIDEO, "video-720p");
+    store.SetSelectedFormatId(mpd::AdaptationType::AUDIO, "audio-en");
+    EXPECT_TRUE(store.Save());
+  }
+
+  // A new session token in the query does not matter.
+  SessionStateStore store(dir.path(),
+                          "http://cdn.example/movie/manifest.mpd?token=2");
+  store.Load();
+  EXPECT_EQ(4000000, store.GetBitrateEstimate(
+                         now + base::TimeDelta::FromMinutes(1), max_age));
+  EXPECT_EQ(upstream::BandwidthMeterInterface::kNoEstimate,
+            store.GetBitrateEstimate(now + base::TimeDelta::FromMinutes(11),
+                                     max_age));
+  EXPECT_EQ("video-720p",
+            store.GetSelectedFormatId(mpd::AdaptationType::VIDEO));
+  EXPECT_EQ("audio-en", store.GetSelectedFormatId(mpd::AdaptationType::AUDIO));
+  EXPECT_EQ("", store.GetSelectedFormatId(mpd::AdaptationType::TEXT));
+}
+
+TEST(SessionStateStoreTest, KeyedByHostAndContent) {
+  base::ScopedTempDir dir;
+  ASSERT_TRUE(dir.CreateUniqueTempDir());
+  const base::Time now = base::Time::Now();
+  const base::TimeDelta max_age = base::TimeDelta::FromMinutes(10);
+
+  {
+    SessionStateStore store(dir.path(), kManifestUrl);
+    store.SetBitrateEstimate(4000000, now);
+    store.SetSelectedFormatId(mpd::AdaptationType::VIDEO, "video-720p");
+    EXPECT_TRUE(store.Save());
+  }
+
+  // Other content on the same host shares the estimate only.
+  SessionStateStore other_content(dir.path(),
+                                  "http://cdn.example/show/manifest.mpd");
+  other_content.Load();
+  EXPECT_EQ(4000000, other_content.GetBitrateEstimate(now, max_age));
+  EXPECT_EQ("", other_content.GetSelectedFormatId(mpd::AdaptationType::VIDEO));
+
+  SessionStateStore other_host(dir.path(),
+                               "http://other.example/movie/manifest.mpd");
+  other_host.Load();
+  EXPECT_EQ(upstream::BandwidthMeterInterface::kNoEstimate,
+            other_host.GetBitrateEstimate(now, max_age));
+}
+
+TEST(SessionStateStoreTest, Segments) {
+  base::ScopedTempDir dir;
+  ASSERT_TRUE(dir.CreateUniqueTempDir());
+  SessionStateStore store(dir.path(), kManifestUrl);
+
+  std::string data;
+  EXPECT_FALSE(store.GetSegment(SpecFor("http://cdn.example/init.mp4"), &data));
+  store.PutSegment(SpecFor("http://cdn.example/init.mp4"), "moov");
+  EXPECT_TRUE(store.GetSegment(SpecFor("http://cdn.example/init.mp4"), &data));
+  EXPECT_EQ("moov", data);
+  // Byte ranges are part of the key.
+  EXPECT_FALSE(
+      store.GetSegment(SpecFor("http://cdn.example/init.mp4", 100), &data));
+
+  for (int i = 0; i < SessionStateStore::kMaxSegments + 5; i++) {
+    store.PutSegment(SpecFor("http://cdn.example/init.mp4", i * 100 + 1),
+                     "sidx");
+  }
+  EXPECT_EQ(SessionStateStore::kMaxSegments,
+            CountFiles(dir.path(), "segment-*"));
+}
+
+TEST(SessionStateDataSourceTest, StoresThenServes) {
+  base::ScopedTempDir dir;
+  ASSERT_TRUE(dir.CreateUniqueTempDir());
+  SessionStateStore store(dir.path(), kManifestUrl);
+  StringDataSource upstream("initialization segment");
+  const upstream::DataSpec data_spec = SpecFor("http://cdn.example/init.mp4");
+
+  {
+    SessionStateDataSource source(&upstream, &store);
+    EXPECT_EQ(22, source.Open(data_spec));
+    EXPECT_EQ("initialization segment", ReadAll(&source));
+    source.Close();
+    EXPECT_EQ(1, upstream.opens());
+
+    // Served from the store now, also by a later session.
+    EXPECT_EQ(22, source.Open(data_spec));
+    EXPECT_EQ("initialization segment", ReadAll(&source));
+    source.Close();
+    EXPECT_EQ(1, upstream.opens());
+  }
+
+  SessionStateStore later_store(dir.path(), kManifestUrl);
+  SessionStateDataSource later_source(&upstream, &later_store);
+  EXPECT_EQ(22, later_source.Open(data_spec));
+  EXPECT_EQ("initialization segment", ReadAll(&later_source));
+  later_source.Close();
+  EXPECT_EQ(1, upstream.opens());
+
+  // A request closed before the end is not kept.
+  const upstream::DataSpec other_spec = SpecFor("http://cdn.example/a.mp4");
+  EXPECT_EQ(22, later_source.Open(other_spec));
+  char buffer[4];
+  EXPECT_EQ(4, later_source.Read(buffer, sizeof(buffer)));
+  later_source.Close();
+  std::string data;
+  EXPECT_FALSE(later_store.GetSegment(other_spec, &data));
+}
+
+}  // namespace ndash
@@ -0,0 +1,117 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tracing.h"
+
+#include "base/bind.h"
+#include "base/files/file_util.h"
+#include "base/location.h"
+#include "base/logging.h"
+#include "base/memory/ref_counted_memory.h"
+#include "base/synchronization/waitable_event.h"
+#include "base/threading/thread.h"
+#include "base/trace_event/trace_config.h"
+#include "base/trace_event/trace_log.h"
+
+namespace ndash {
+
+namespace {
+
+// Collects the pieces TraceLog::Flush() produces and writes them out as a
+// JSON array once the last has arrived.
+class TraceFileWriter {
+ public:
+  explicit TraceFileWriter(const base::FilePath& path)
+      : path_(path), done_(true, false) {}
+
+  void OnTraceData(const scoped_refptr<base::RefCountedString>& events,
+                   bool has_more_events) {
+    if (!events->data().empty()) {
+      if (!json_.empty()) {
+        json_.append(",\n");
+      }
+      json_.append(events->data());
+    }
+    if (has_more_events) {
+      return;
+    }
+
+    json_ = "[" + json_ + "]\n";
+    ok_ = base::WriteFile(path_, json_.data(), json_.size()) ==
+          static_cast<int>(json_.size());
+    LOG_IF(WARNING, !ok_) << "Couldn't write trace to " << path_.value();
+    done_.Signal();
+  }
+
+  bool Wait() {
+    done_.Wait();
+    return ok_;
+  }
+
+ private:
+  const base::FilePath path_;
+  std::string json_;
+  bool ok_ = false;
+  base::WaitableEvent done_;
+};
+
+void Flush(TraceFileWriter* writer) {
+  base::trace_event::TraceLog::GetInstance()->Flush(base::Bind(
+      &TraceFileWriter::OnTraceData, base::Unretained(writer)));
+}
+
+}  // namespace
+
+const char kDefaultTraceCategories[] = "ndash";
+
+bool StartTracing(const std::string& categories) {
+  base::trace_event::TraceLog* trace_log =
+      base::trace_event::TraceLog::GetInstance();
+  if (trace_log->IsEnabled()) {
+    return false;
+  }
+  trace_log->SetEnabled(
+      base::trace_event::TraceConfig(categories,
+                                     base::trace_event::RECORD_UNTIL_FULL),
+      base::trace_event::TraceLog::RECORDING_MODE);
+  VLOG(1) << "Tracing " << categories;
+  return true;
+}
+
+bool StopTracing(const base::FilePath& path) {
+  base::trace_event::TraceLog* trace_log =
+      base::trace_event::TraceLog::GetInstance();
+  if (!trace_log->IsEnabled()) {
+    return false;
+  }
+  trace_log->SetDisabled();
+
+  // Threads that buffer their own events hand them over from their message
+  // loops, and the flush completes on a message loop too, so it is run from
+  // a thread of its own.
+  base::Thread flush_thread("ndash-trace-flush");
+  if (!flush_thread.Start()) {
+    return false;
+  }
+  TraceFileWriter writer(path);
+  flush_thread.task_runner()->PostTask(
+      FROM_HERE, base::Bind(&Flush, base::Unretained(&writer)));
+  bool ok = writer.Wait();
+  flush_thread.Stop();
+  return ok;
+}
+
+}  // namespace ndash
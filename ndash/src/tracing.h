@@ -0,0 +1,54 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NDASH_TRACING_H_
+#define NDASH_TRACING_H_
+
+#include <string>
+
+#include "base/files/file_path.h"
+
+namespace ndash {
+
+// Recording of the trace events (see base/trace_event/trace_event.h) that
+// ndash emits, written out as Chrome trace JSON for about:tracing or
+// Perfetto.
+//
+// ndash's events are in the "ndash" category, except for the per-sample and
+// per-frame ones, which are in "disabled-by-default-ndash.frames" and must be
+// asked for by name. While nothing is recording, each event costs a load and
+// a branch.
+//
+// Tracing is process-wide, so there can only be one recording at a time.
+
+// The categories recorded unless others are asked for.
+extern const char kDefaultTraceCategories[];
+
+// Starts recording the events of |categories|, a comma-separated list in
+// which "-" excludes a category and "*" is a wildcard. Returns false if a
+// recording is already in progress.
+bool StartTracing(const std::string& categories);
+
+// Stops recording and writes what was recorded to |path|. Blocks until the
+// file is written, collecting events from threads that buffer their own; do
+// not call it on one of those (a thread with a message loop that has emitted
+// events), or that thread's events are lost after a timeout. Returns false if
+// nothing was recording or the file could not be written.
+bool StopTracing(const base::FilePath& path);
+
+}  // namespace ndash
+
+#endif  // NDASH_TRACING_H_
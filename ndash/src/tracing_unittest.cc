@@ -0,0 +1,85 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tracing.h"
+
+#include <memory>
+#include <set>
+#include <string>
+
+#include "base/files/file_util.h"
+#include "base/files/scoped_temp_dir.h"
+#include "base/json/json_reader.h"
+#include "base/trace_event/trace_event.h"
+#include "base/values.h"
+#include "gtest/gtest.h"
+
+namespace ndash {
+
+namespace {
+
+// Returns the names of the events in the trace file at |path|.
+std::set<std::string> ReadEventNames(const base::FilePath& path) {
+  std::set<std::string> names;
+  std::string json;
+  EXPECT_TRUE(base::ReadFileToString(path, &json));
+  std::unique_ptr<base::Value> value = base::JSONReader::Read(json);
+  const base::ListValue* events = nullptr;
+  EXPECT_TRUE(value && value->GetAsList(&events));
+  if (!events) {
+    return names;
+  }
+  for (size_t i = 0; i < events->GetSize(); i++) {
+    const base::DictionaryValue* event;
+    std::string name;
+    if (events->GetDictionary(i, &event) && event->GetString("name", &name)) {
+      names.insert(name);
+    }
+  }
+  return names;
+}
+
+}  // namespace
+
+TEST(TracingTest, RecordsDefaultCategories) {
+  base::ScopedTempDir temp_dir;
+  ASSERT_TRUE(temp_dir.CreateUniqueTempDir());
+  base::FilePath path = temp_dir.path().AppendASCII("trace.json");
+
+  EXPECT_FALSE(StopTracing(path));
+  ASSERT_TRUE(StartTracing(kDefaultTraceCategories));
+  EXPECT_FALSE(StartTracing(kDefaultTraceCategories));
+
+  { TRACE_EVENT0("ndash", "TracingTestSpan"); }
+  TRACE_EVENT_INSTANT0(TRACE_DISABLED_BY_DEFAULT("ndash.frames"),
+                       "TracingTestFrame", TRACE_EVENT_SCOPE_THREAD);
+
+  ASSERT_TRUE(StopTracing(path));
+  std::set<std::string> names = ReadEventNames(path);
+  EXPECT_EQ(1u, names.count("TracingTestSpan"));
+  EXPECT_EQ(0u, names.count("TracingTestFrame"));
+
+  // Once stopped, a new recording can start.
+  ASSERT_TRUE(StartTracing("disabled-by-default-ndash.frames"));
+  TRACE_EVENT_INSTANT0(TRACE_DISABLED_BY_DEFAULT("ndash.frames"),
+                       "TracingTestFrame", TRACE_EVENT_SCOPE_THREAD);
+  ASSERT_TRUE(StopTracing(path));
+  names = ReadEventNames(path);
+  EXPECT_EQ(0u, names.count("TracingTestSpan"));
+  EXPECT_EQ(1u, names.count("TracingTestFrame"));
+}
+
+}  // namespace ndash
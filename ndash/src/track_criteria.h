@@ -56,6 +56,12 @@ struct TrackCriteria {
 
   // If non-empty, tracks marked with the given codec are preferred.
   std::string preferred_codec;
+
+  // If >= 0 and trick tracks are not preferred, the track at this position
+  // among those with a matching mime type (see
+  // PeriodHolder::GetAdaptationSets()) is selected and the preferences above
+  // are ignored, as long as there is one.
+  int adaptation_set_index = -1;
 };
 
 }  // namespace ndash
@@ -25,14 +25,21 @@
 #include <map>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "base/bind.h"
+#include "base/lazy_instance.h"
+#include "base/location.h"
 #include "base/logging.h"
 #include "base/strings/string_piece.h"
 #include "base/strings/string_split.h"
 #include "base/strings/string_util.h"
+#include "base/threading/worker_pool.h"
+#include "base/trace_event/trace_event.h"
 #include "upstream/constants.h"
 #include "upstream/data_spec.h"
+#include "upstream/host_stats.h"
+#include "util/thread_config.h"
 
 namespace ndash {
 namespace upstream {
@@ -40,6 +47,79 @@ namespace upstream {
 namespace {
 const char kHttpScheme[] = "http:";
 const char kHttpsScheme[] = "https:";
+// Preconnects that take longer than this are given up on.
+const long kPreconnectTimeoutMs = 10000;
+
+// DNS lookups and TLS sessions shared by all CurlDataSources in the process,
+// so that a request to a host another source has already talked to can skip
+// the lookup and resume the TLS session. Connections are not shared: libcurl
+// does not support sharing them between easy handles used on different
+// threads, so each CurlDataSource keeps its own. Nor are cookies, which must
+// not leak from one player's session to another's.
+class CurlShare {
+ public:
+  CurlShare() : share_(curl_share_init()) {
+    CHECK(share_);
+    curl_share_setopt(share_, CURLSHOPT_LOCKFUNC, &CurlShare::LockData);
+    curl_share_setopt(share_, CURLSHOPT_UNLOCKFUNC, &CurlShare::UnlockData);
+    curl_share_setopt(share_, CURLSHOPT_USERDATA, this);
+    curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+  }
+
+  CURLSH* get() const { return share_; }
+
+ private:
+  static void LockData(CURL* handle,
+                       curl_lock_data data,
+                       curl_lock_access access,
+                       void* userptr) {
+    static_cast<CurlShare*>(userptr)->locks_[data].Acquire();
+  }
+  static void UnlockData(CURL* handle, curl_lock_data data, void* userptr) {
+    static_cast<CurlShare*>(userptr)->locks_[data].Release();
+  }
+
+  CURLSH* const share_;
+  base::Lock locks_[CURL_LOCK_DATA_LAST];
+};
+
+base::LazyInstance<CurlShare>::Leaky g_curl_share = LAZY_INSTANCE_INITIALIZER;
+
+// Runs on a worker thread.
+void PreconnectOnWorker(const std::string& url, int connections) {
+  CURLM* multi = curl_multi_init();
+  std::vector<CURL*> easies;
+  for (int i = 0; i < connections; i++) {
+    CURL* easy = curl_easy_init();
+    curl_easy_setopt(easy, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(easy, CURLOPT_SHARE, g_curl_share.Get().get());
+    curl_easy_setopt(easy, CURLOPT_URL, url.c_str());
+    curl_easy_setopt(easy, CURLOPT_PROTOCOLS,
+                     static_cast<long>(CURLPROTO_HTTP | CURLPROTO_HTTPS));
+    // Only connect (and for https, finish the handshake); no request is
+    // made.
+    curl_easy_setopt(easy, CURLOPT_CONNECT_ONLY, 1L);
+    curl_easy_setopt(easy, CURLOPT_CONNECTTIMEOUT_MS, kPreconnectTimeoutMs);
+    curl_multi_add_handle(multi, easy);
+    easies.push_back(easy);
+  }
+
+  int running = 0;
+  do {
+    if (curl_multi_perform(multi, &running) != CURLM_OK ||
+        curl_multi_poll(multi, nullptr, 0, 1000, nullptr) != CURLM_OK) {
+      break;
+    }
+  } while (running > 0);
+
+  for (CURL* easy : easies) {
+    curl_multi_remove_handle(multi, easy);
+    curl_easy_cleanup(easy);
+  }
+  curl_multi_cleanup(multi);
+  VLOG(2) << "Preconnected " << connections << " to " << url;
+}
 }  // namespace
 
 // The maximum size of the buffer before further writes will block.
@@ -48,7 +128,9 @@ constexpr size_t CurlDataSource::kDefaultMaxBufLength;
 CurlDataSource::CurlDataSource(const std::string& content_type,
                                TransferListenerInterface* listener,
                                bool use_global_lock,
-                               size_t max_buffer_size)
+                               size_t max_buffer_size,
+                               scoped_refptr<base::TaskRunner> curl_task_runner,
+                               const util::ThreadConfig* thread_config)
     : use_global_lock_(use_global_lock),
       max_buffer_size_(max_buffer_size),
       listener_(listener),
@@ -61,7 +143,8 @@ CurlDataSource::CurlDataSource(const std::string& content_type,
       headers_done_(true, false),
       response_headers_(),
       easy_(curl_easy_init(), curl_easy_cleanup),
-      curl_thread_(std::string("CURL:") + content_type) {
+      curl_thread_(std::string("CURL:") + content_type),
+      curl_task_runner_(curl_task_runner) {
   // This is a hack to serialize HTTP requests, mostly so that video and audio
   // don't download concurrently, improving the amount of CPU available for
   // HTTPS decryption on a single stream, which is needed to make the bandwidth
@@ -79,15 +162,42 @@ CurlDataSource::CurlDataSource(const std::string& content_type,
   global_active_ = &active;
   global_active_done_ = &active_done;
 
-  curl_thread_.Start();
+  if (!curl_task_runner_) {
+    if (!thread_config) {
+      thread_config = util::ThreadConfig::GetInstance();
+    }
+    thread_config->StartThread(util::ThreadRole::NETWORK, &curl_thread_);
+    curl_task_runner_ = curl_thread_.task_runner();
+  }
+}
+
+// static
+void CurlDataSource::Preconnect(const std::string& url, int connections) {
+  if (connections <= 0 ||
+      !(base::StartsWith(url, kHttpScheme,
+                         base::CompareCase::INSENSITIVE_ASCII) ||
+        base::StartsWith(url, kHttpsScheme,
+                         base::CompareCase::INSENSITIVE_ASCII))) {
+    return;
+  }
+  base::WorkerPool::PostTask(
+      FROM_HERE, base::Bind(&PreconnectOnWorker, url, connections), true);
 }
 
 CurlDataSource::~CurlDataSource() {
-  curl_thread_.Stop();
+  if (curl_thread_.IsRunning()) {
+    curl_thread_.Stop();
+  } else {
+    // No thread to join: stop any transfer still running on the shared pool.
+    Close();
+  }
 }
 
 ssize_t CurlDataSource::Open(const DataSpec& data_spec,
                              const base::CancellationFlag* cancel) {
+  // Open() returns once the response headers are in, so this spans the time
+  // to first byte.
+  TRACE_EVENT1("ndash", "CurlDataSource::Open", "uri", data_spec.uri.uri());
   if (open_) {
     // Can't have multiple simultaneous requests (DataSourceInterface spec)
     LOG(ERROR) << "Failed to open: request already in progress";
@@ -114,6 +224,8 @@ ssize_t CurlDataSource::Open(const DataSpec& data_spec,
 
   open_ = true;
   SetCurlOption(true, CURLOPT_NOSIGNAL, 1, "disable signals");
+  SetCurlOption(true, CURLOPT_SHARE, g_curl_share.Get().get(),
+                "shared connections");
   memset(curl_error_buf_, 0, sizeof(curl_error_buf_));
   // TODO(adewhurst): Useful error handling
   SetCurlOption(true, CURLOPT_ERRORBUFFER, curl_error_buf_, "error buffer");
@@ -198,9 +310,9 @@ ssize_t CurlDataSource::Open(const DataSpec& data_spec,
     return DataSourceError(HTTP_IO_ERROR);
   }
 
-  CHECK(curl_thread_.IsRunning());
+  CHECK(curl_task_runner_);
   active_ = true;
-  curl_thread_.task_runner()->PostTask(
+  curl_task_runner_->PostTask(
       FROM_HERE,
       base::Bind(&CurlDataSource::CurlPerform, base::Unretained(this)));
 
@@ -233,7 +345,19 @@ ssize_t CurlDataSource::Open(const DataSpec& data_spec,
   return tentative_length_;
 }
 
+// static
+bool CurlDataSource::IsHostFailure(CURLcode result,
+                                   HttpDataSourceError http_error,
+                                   int response_code,
+                                   bool stopped_by_reader) {
+  if (http_error == HTTP_RESPONSE_CODE_ERROR) {
+    return response_code >= 500;
+  }
+  return result != CURLE_WRITE_ERROR && !stopped_by_reader;
+}
+
 void CurlDataSource::CurlPerform() {
+  TRACE_EVENT0("ndash", "CurlDataSource::CurlPerform");
   curl_handoff_time_ = base::TimeTicks::Now();
   curl_first_header_time_ = base::TimeDelta();
   curl_processing_time_ = base::TimeDelta();
@@ -258,8 +382,25 @@ void CurlDataSource::CurlPerform() {
     if (result != CURLE_OK) {
       LOG(INFO) << "Could not fetch: CURL result " << result
                 << " / CURL error buffer " << curl_error_buf_;
+      if (host_stats_ && IsHostFailure(result, http_error_,
+                                       GetResponseCode(), load_error_)) {
+        host_stats_->OnError(uri_);
+      }
       load_error_ = true;
     } else {
+      if (host_stats_) {
+        double bytes = 0;
+        double total_time = 0;
+        curl_easy_getinfo(easy_.get(), CURLINFO_SIZE_DOWNLOAD, &bytes);
+        curl_easy_getinfo(easy_.get(), CURLINFO_TOTAL_TIME, &total_time);
+        // Time spent waiting for the reader to make room isn't the host's.
+        // The time to the first header is the request's latency.
+        host_stats_->OnTransfer(
+            uri_, static_cast<int64_t>(bytes),
+            base::TimeDelta::FromMicroseconds(total_time * 1000000) -
+                curl_waiting_time_,
+            curl_first_header_time_);
+      }
       eof_ = true;
 
       writer_.Signal();
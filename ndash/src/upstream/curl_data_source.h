@@ -28,16 +28,25 @@
 #include <string>
 
 #include "base/macros.h"
+#include "base/memory/ref_counted.h"
 #include "base/strings/string_piece.h"
 #include "base/synchronization/cancellation_flag.h"
 #include "base/synchronization/condition_variable.h"
 #include "base/synchronization/lock.h"
+#include "base/task_runner.h"
 #include "base/threading/thread.h"
 #include "upstream/transfer_listener.h"
 
 namespace ndash {
+
+namespace util {
+class ThreadConfig;
+}  // namespace util
+
 namespace upstream {
 
+class HostStats;
+
 class CurlDataSource : public HttpDataSourceInterface {
  public:
   // The maximum size of the internal buffer. This is also the maximum allowed
@@ -63,10 +72,16 @@ class CurlDataSource : public HttpDataSourceInterface {
   // use_global_lock: serialize this DataSource with others that use global lock
   // max_buffer_size: The maximum internal buffer size before CURL thread is
   //                  blocked
+  // curl_task_runner: runs transfers on a shared pool (see LoaderPool)
+  //                   instead of a dedicated CURL thread (nullptr if none)
+  // thread_config: how to start the CURL thread (nullptr for the settings of
+  //                all players)
   CurlDataSource(const std::string& content_type,
                  TransferListenerInterface* listener = nullptr,
                  bool use_global_lock = false,
-                 size_t max_buffer_size = kDefaultMaxBufLength);
+                 size_t max_buffer_size = kDefaultMaxBufLength,
+                 scoped_refptr<base::TaskRunner> curl_task_runner = nullptr,
+                 const util::ThreadConfig* thread_config = nullptr);
   ~CurlDataSource() override;
 
   // DataSourceInterface
@@ -93,6 +108,26 @@ class CurlDataSource : public HttpDataSourceInterface {
   // If max_length is 0, then uses max_buffer_size passed at construction time.
   std::string ReadAllToString(size_t max_length = 0) override;
 
+  // Connects to the host of |url| |connections| times in the background
+  // without making a request, so that the lookup and TLS session are in the
+  // DNS and TLS session caches all CurlDataSources share by the time they
+  // make their first request there. Does nothing for URLs that are not
+  // http(s).
+  static void Preconnect(const std::string& url, int connections);
+
+  // Reports each transfer's throughput, or its failure, to |host_stats|
+  // (nullptr for none). Must be called before the first Open().
+  void SetHostStats(HostStats* host_stats) { host_stats_ = host_stats; }
+
+  // Whether a transfer that ended with |result| shows its host to be failing:
+  // it couldn't be reached, timed out or answered with a server error. Client
+  // errors such as a 404 for a segment not yet at the live edge, and
+  // transfers the reader stopped, say nothing about the host.
+  static bool IsHostFailure(CURLcode result,
+                            HttpDataSourceError http_error,
+                            int response_code,
+                            bool stopped_by_reader);
+
  private:
   friend class CurlDataSourceTest;
 
@@ -105,6 +140,7 @@ class CurlDataSource : public HttpDataSourceInterface {
 
   // No lock required: set by constructor
   TransferListenerInterface* const listener_;
+  HostStats* host_stats_ = nullptr;
 
   // No lock required: request data. Only modified when Curl thread is idle.
   bool open_ = false;    // Open() was called, so Close() needs to reset
@@ -165,6 +201,8 @@ class CurlDataSource : public HttpDataSourceInterface {
   HttpDataSourceError http_error_ = HTTP_OK;
 
   base::Thread curl_thread_;
+  // Either |curl_thread_|'s task runner or a shared pool's.
+  scoped_refptr<base::TaskRunner> curl_task_runner_;
 
   base::TimeTicks load_start_time_;
 
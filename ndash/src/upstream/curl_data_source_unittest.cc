@@ -20,18 +20,25 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 
+#include <atomic>
 #include <cstdio>
 #include <cstring>
 #include <string>
 
+#include "base/bind.h"
+#include "base/location.h"
 #include "base/logging.h"
+#include "base/message_loop/message_loop.h"
 #include "base/strings/string_piece.h"
 #include "base/strings/string_util.h"
+#include "base/synchronization/waitable_event.h"
+#include "base/threading/platform_thread.h"
 #include "curl/curl.h"
 #include "curl/easy.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "upstream/data_spec.h"
+#include "upstream/loader_pool.h"
 #include "upstream/transfer_listener_mock.h"
 #include "upstream/uri.h"
 
@@ -211,6 +218,49 @@ TEST_F(CurlDataSourceTest, CurlFromFileTest) {
   CleanupTempFile();
 }
 
+namespace {
+// Stands in for a transfer that stalls until released.
+void BlockTransfer(base::WaitableEvent* release, std::atomic<int>* running) {
+  (*running)++;
+  release->Wait();
+  (*running)--;
+}
+}  // namespace
+
+// Prefetching sources are created without a task runner, so that a stalled
+// prefetch can never hold up the shared network pool, nor wait on it.
+TEST_F(CurlDataSourceTest, OwnThreadDoesNotWaitForNetworkPool) {
+  base::MessageLoop top_loop;
+  // The network pool at its smallest, unless already running, with every
+  // thread held by a stalled transfer.
+  LoaderPool::SetThreadCounts(1, 1);
+  LoaderPool* pool = LoaderPool::GetInstance();
+
+  base::WaitableEvent release(true, false);
+  std::atomic<int> running(0);
+  const int network_threads = pool->network_threads();
+  for (int i = 0; i < network_threads; i++) {
+    pool->network_task_runner()->PostTask(
+        FROM_HERE, base::Bind(&BlockTransfer, base::Unretained(&release),
+                              base::Unretained(&running)));
+  }
+  while (running.load() < network_threads) {
+    base::PlatformThread::YieldCurrentThread();
+  }
+
+  // Nothing listens on the discard port, so the transfer fails at once, but
+  // it has to run to find that out.
+  CurlDataSource data_source("test-prefetch");
+  EXPECT_EQ(RESULT_IO_ERROR,
+            data_source.Open(DataSpec(Uri("http://127.0.0.1:9/"))));
+  data_source.Close();
+
+  release.Signal();
+  while (running.load() > 0) {
+    base::PlatformThread::YieldCurrentThread();
+  }
+}
+
 TEST_F(CurlDataSourceTest, CurlRangeFromFileTest) {
   std::string file_uri_string("file://");
   static const char kFileContents[128] = "1234567890abcde\n";
@@ -446,6 +496,24 @@ TEST_F(CurlDataSourceTest, TransferListenerCallbacks) {
   CleanupTempFile();
 }
 
+TEST(CurlDataSourceHostFailureTest, OnlyUnreachableOrFailingHosts) {
+  // Client errors, such as asking for a segment not yet at the live edge,
+  // are no reason to stop using a host.
+  EXPECT_FALSE(CurlDataSource::IsHostFailure(
+      CURLE_HTTP_RETURNED_ERROR, HTTP_RESPONSE_CODE_ERROR, 404, false));
+  EXPECT_TRUE(CurlDataSource::IsHostFailure(
+      CURLE_HTTP_RETURNED_ERROR, HTTP_RESPONSE_CODE_ERROR, 503, false));
+  EXPECT_TRUE(CurlDataSource::IsHostFailure(CURLE_COULDNT_CONNECT, HTTP_OK,
+                                            0, false));
+  EXPECT_TRUE(CurlDataSource::IsHostFailure(CURLE_OPERATION_TIMEDOUT,
+                                            HTTP_OK, 0, false));
+  // Nor are transfers the reader gave up on.
+  EXPECT_FALSE(
+      CurlDataSource::IsHostFailure(CURLE_WRITE_ERROR, HTTP_OK, 200, false));
+  EXPECT_FALSE(CurlDataSource::IsHostFailure(CURLE_ABORTED_BY_CALLBACK,
+                                             HTTP_OK, 200, true));
+}
+
 // Network tests are disabled because external network requests are not
 // appropriate for unit tests. Enable these by hand to run them, or run with
 // --gtest_also_run_disabled_tests
@@ -71,6 +71,17 @@ class DataSourceInterface {
   // - RESULT_IO_ERROR, if there was an error
   virtual ssize_t Read(void* buffer, size_t read_length) = 0;
 
+  // Whether ReadView() can be used on the opened source.
+  virtual bool CanReadView() const { return false; }
+
+  // Like Read(), but rather than copying the data into a buffer, points
+  // |*data| at up to |max_length| bytes of it held by the source. They stay
+  // valid until the next call on the source. Only for sources that
+  // CanReadView().
+  virtual ssize_t ReadView(const void** data, size_t max_length) {
+    return RESULT_IO_ERROR;
+  }
+
  protected:
   DataSourceInterface() {}
 };
@@ -17,6 +17,7 @@
 #ifndef NDASH_UPSTREAM_DEFAULT_ALLOCATOR_H_
 #define NDASH_UPSTREAM_DEFAULT_ALLOCATOR_H_
 
+#include <atomic>
 #include <cstdint>
 #include <cstdlib>
 
@@ -43,7 +44,9 @@ class DefaultAllocator : public AllocatorInterface {
 
  private:
   const size_t individual_allocation_size_;
-  size_t allocated_count_ = 0;
+  // Allocations are made and released by the loaders of every track, and
+  // counted by MemoryGovernor on any player's thread.
+  std::atomic<size_t> allocated_count_{0};
 };
 
 }  // namespace upstream
@@ -64,6 +64,15 @@ int64_t DefaultBandwidthMeter::GetBitrateEstimate() const {
   return bitrate_estimate_;
 }
 
+void DefaultBandwidthMeter::SetInitialEstimate(int64_t bitrate) {
+  base::AutoLock auto_lock(lock_);
+  // The averager is left empty, so the first sample replaces the seed
+  // outright.
+  if (bitrate_estimate_ == kNoEstimate && bitrate > 0) {
+    bitrate_estimate_ = bitrate;
+  }
+}
+
 void DefaultBandwidthMeter::OnTransferStart() {
   base::AutoLock auto_lock(lock_);
 
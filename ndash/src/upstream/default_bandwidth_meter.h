@@ -56,6 +56,11 @@ class DefaultBandwidthMeter : public BandwidthMeterInterface,
   // May be called by any thread
   int64_t GetBitrateEstimate() const override;
 
+  // Reports |bitrate| (e.g. remembered from an earlier session) as the
+  // estimate until the first transfer produces one. Does nothing once there
+  // is an estimate.
+  void SetInitialEstimate(int64_t bitrate);
+
   // Will be called by loader thread(s); locking required
   void OnTransferStart() override;
   void OnBytesTransferred(int32_t bytes) override;
@@ -127,6 +127,35 @@ TEST_F(DefaultBandwidthMeterTest, NoSamples) {
               Eq(BandwidthMeterInterface::kNoEstimate));
 }
 
+TEST_F(DefaultBandwidthMeterTest, InitialEstimate) {
+  ConstructTestBandwidthMeter();
+
+  meter_->SetInitialEstimate(0);
+  EXPECT_THAT(meter_->GetBitrateEstimate(),
+              Eq(BandwidthMeterInterface::kNoEstimate));
+
+  meter_->SetInitialEstimate(5000000);
+  EXPECT_THAT(meter_->GetBitrateEstimate(), Eq(5000000));
+
+  // The first measurement replaces the seed.
+  EXPECT_CALL(*averager_, AddSample(_, _));
+  EXPECT_CALL(*averager_, GetAverage()).WillOnce(Return(800));
+  EXPECT_CALL(*sample_receiver_, BandwidthSampleCallback(_, _, 800));
+  meter_->OnTransferStart();
+  meter_->OnBytesTransferred(2500);
+  test_clock_->Advance(base::TimeDelta::FromSeconds(25));
+  meter_->OnTransferEnd();
+  {
+    base::RunLoop loop;
+    loop.RunUntilIdle();
+  }
+  EXPECT_THAT(meter_->GetBitrateEstimate(), Eq(800));
+
+  // Later seeds are ignored.
+  meter_->SetInitialEstimate(5000000);
+  EXPECT_THAT(meter_->GetBitrateEstimate(), Eq(800));
+}
+
 TEST_F(DefaultBandwidthMeterTest, SingleStreams) {
   ConstructTestBandwidthMeter();
 
@@ -0,0 +1,96 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "upstream/default_uri_data_source.h"
+
+#include <utility>
+
+#include "upstream/data_spec.h"
+
+namespace ndash {
+namespace upstream {
+
+DefaultUriDataSource::DefaultUriDataSource(
+    std::unique_ptr<HttpDataSourceInterface> http_source,
+    TransferListenerInterface* listener)
+    : http_source_(std::move(http_source)),
+      file_source_(listener),
+      current_(http_source_.get()) {}
+
+DefaultUriDataSource::~DefaultUriDataSource() {}
+
+ssize_t DefaultUriDataSource::Open(const DataSpec& data_spec,
+                                   const base::CancellationFlag* cancel) {
+  if (FileDataSource::IsFileUri(data_spec.uri.uri())) {
+    current_ = &file_source_;
+  } else {
+    current_ = http_source_.get();
+  }
+  return current_->Open(data_spec, cancel);
+}
+
+void DefaultUriDataSource::Close() {
+  current_->Close();
+}
+
+ssize_t DefaultUriDataSource::Read(void* buffer, size_t read_length) {
+  return current_->Read(buffer, read_length);
+}
+
+bool DefaultUriDataSource::CanReadView() const {
+  return current_->CanReadView();
+}
+
+ssize_t DefaultUriDataSource::ReadView(const void** data, size_t max_length) {
+  return current_->ReadView(data, max_length);
+}
+
+const char* DefaultUriDataSource::GetUri() const {
+  return current_->GetUri();
+}
+
+void DefaultUriDataSource::SetRequestProperty(const std::string& name,
+                                              const std::string& value) {
+  http_source_->SetRequestProperty(name, value);
+}
+
+void DefaultUriDataSource::ClearRequestProperty(const std::string& name) {
+  http_source_->ClearRequestProperty(name);
+}
+
+void DefaultUriDataSource::ClearAllRequestProperties() {
+  http_source_->ClearAllRequestProperties();
+}
+
+const std::multimap<std::string, std::string>*
+DefaultUriDataSource::GetResponseHeaders() const {
+  return current_->GetResponseHeaders();
+}
+
+int DefaultUriDataSource::GetResponseCode() const {
+  return current_->GetResponseCode();
+}
+
+HttpDataSourceError DefaultUriDataSource::GetHttpError() const {
+  return current_->GetHttpError();
+}
+
+std::string DefaultUriDataSource::ReadAllToString(size_t max_length) {
+  return current_->ReadAllToString(max_length);
+}
+
+}  // namespace upstream
+}  // namespace ndash
@@ -0,0 +1,78 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NDASH_UPSTREAM_DEFAULT_URI_DATA_SOURCE_H_
+#define NDASH_UPSTREAM_DEFAULT_URI_DATA_SOURCE_H_
+
+#include <map>
+#include <memory>
+#include <string>
+
+#include "base/macros.h"
+#include "upstream/file_data_source.h"
+#include "upstream/http_data_source.h"
+
+namespace ndash {
+namespace upstream {
+
+class TransferListenerInterface;
+
+// An HttpDataSourceInterface that picks a source for each request by its URI
+// scheme: file:// URIs are read by a FileDataSource, everything else goes to
+// |http_source|. Request properties are set on |http_source|.
+class DefaultUriDataSource : public HttpDataSourceInterface {
+ public:
+  // listener: given to the FileDataSource; |http_source| should have been
+  //           made with the same one
+  DefaultUriDataSource(std::unique_ptr<HttpDataSourceInterface> http_source,
+                       TransferListenerInterface* listener = nullptr);
+  ~DefaultUriDataSource() override;
+
+  // DataSourceInterface
+  ssize_t Open(const DataSpec& data_spec,
+               const base::CancellationFlag* cancel = nullptr) override;
+  void Close() override;
+  ssize_t Read(void* buffer, size_t read_length) override;
+  bool CanReadView() const override;
+  ssize_t ReadView(const void** data, size_t max_length) override;
+
+  // UriDataSourceInterface
+  const char* GetUri() const override;
+
+  // HttpDataSourceInterface
+  void SetRequestProperty(const std::string& name,
+                          const std::string& value) override;
+  void ClearRequestProperty(const std::string& name) override;
+  void ClearAllRequestProperties() override;
+  const std::multimap<std::string, std::string>* GetResponseHeaders()
+      const override;
+  int GetResponseCode() const override;
+  HttpDataSourceError GetHttpError() const override;
+  std::string ReadAllToString(size_t max_length = 0) override;
+
+ private:
+  const std::unique_ptr<HttpDataSourceInterface> http_source_;
+  FileDataSource file_source_;
+  // The source of the last request opened (|http_source_| before any).
+  HttpDataSourceInterface* current_;
+
+  DISALLOW_COPY_AND_ASSIGN(DefaultUriDataSource);
+};
+
+}  // namespace upstream
+}  // namespace ndash
+
+#endif  // NDASH_UPSTREAM_DEFAULT_URI_DATA_SOURCE_H_
@@ -0,0 +1,84 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "upstream/default_uri_data_source.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "base/files/file_util.h"
+#include "base/files/scoped_temp_dir.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "upstream/constants.h"
+#include "upstream/data_spec.h"
+#include "upstream/http_data_source_mock.h"
+#include "upstream/uri.h"
+
+namespace ndash {
+namespace upstream {
+
+using ::testing::_;
+using ::testing::Return;
+
+TEST(DefaultUriDataSourceTest, PicksSourceByScheme) {
+  base::ScopedTempDir dir;
+  ASSERT_TRUE(dir.CreateUniqueTempDir());
+  const std::string contents = "local segment";
+  ASSERT_EQ(static_cast<int>(contents.size()),
+            base::WriteFile(dir.path().Append("seg1.m4s"), contents.data(),
+                            contents.size()));
+  const std::string file_uri = "file://" + dir.path().value() + "/seg1.m4s";
+
+  std::unique_ptr<MockHttpDataSource> owned_http_source(new MockHttpDataSource);
+  MockHttpDataSource* http_source = owned_http_source.get();
+  DefaultUriDataSource source(std::move(owned_http_source));
+
+  // Request properties are only for the HTTP source.
+  EXPECT_CALL(*http_source, SetRequestProperty("Cookie", "a=b"));
+  source.SetRequestProperty("Cookie", "a=b");
+
+  const std::string http_uri = "http://cdn.example/seg1.m4s";
+  EXPECT_CALL(*http_source, Open(_, _)).WillOnce(Return(1000));
+  EXPECT_CALL(*http_source, GetUri()).WillOnce(Return(http_uri.c_str()));
+  EXPECT_CALL(*http_source, Read(_, 100)).WillOnce(Return(100));
+  EXPECT_CALL(*http_source, Close());
+  EXPECT_EQ(1000, source.Open(DataSpec(Uri(http_uri))));
+  EXPECT_STREQ(http_uri.c_str(), source.GetUri());
+  EXPECT_FALSE(source.CanReadView());
+  char buffer[100];
+  EXPECT_EQ(100, source.Read(buffer, sizeof(buffer)));
+  source.Close();
+  ::testing::Mock::VerifyAndClearExpectations(http_source);
+
+  // The HTTP source isn't touched for a file:// URI.
+  EXPECT_CALL(*http_source, Open(_, _)).Times(0);
+  EXPECT_CALL(*http_source, Read(_, _)).Times(0);
+  EXPECT_EQ(static_cast<ssize_t>(contents.size()),
+            source.Open(DataSpec(Uri(file_uri))));
+  EXPECT_STREQ(file_uri.c_str(), source.GetUri());
+  EXPECT_EQ(200, source.GetResponseCode());
+  EXPECT_TRUE(source.CanReadView());
+  const void* data;
+  ASSERT_EQ(5, source.ReadView(&data, 5));
+  EXPECT_EQ("local", std::string(static_cast<const char*>(data), 5));
+  EXPECT_EQ(contents.substr(5), source.ReadAllToString());
+  source.Close();
+}
+
+}  // namespace upstream
+}  // namespace ndash
@@ -0,0 +1,270 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "upstream/file_data_source.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include "base/logging.h"
+#include "base/posix/eintr_wrapper.h"
+#include "base/strings/string_util.h"
+#include "upstream/constants.h"
+#include "upstream/data_spec.h"
+#include "upstream/transfer_listener.h"
+
+namespace ndash {
+namespace upstream {
+
+namespace {
+const char kFileScheme[] = "file://";
+const char kLocalhost[] = "localhost";
+// The limit for ReadAllToString() when none is given.
+constexpr size_t kDefaultMaxReadAllLength = 10 * 1024 * 1024;
+
+int HexValue(char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  } else if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  } else if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+
+// Returns the path of a file:// URI (with an empty or localhost host),
+// unescaped, or an empty string if there is none.
+std::string PathFromUri(const std::string& uri) {
+  std::string rest = uri.substr(strlen(kFileScheme));
+  if (base::StartsWith(rest, kLocalhost, base::CompareCase::SENSITIVE)) {
+    rest = rest.substr(strlen(kLocalhost));
+  }
+  rest = rest.substr(0, rest.find_first_of("?#"));
+  if (rest.empty() || rest[0] != '/') {
+    return std::string();
+  }
+  std::string path;
+  for (size_t i = 0; i < rest.size(); i++) {
+    int high = i + 2 < rest.size() ? HexValue(rest[i + 1]) : -1;
+    int low = i + 2 < rest.size() ? HexValue(rest[i + 2]) : -1;
+    if (rest[i] == '%' && high >= 0 && low >= 0) {
+      path.push_back(static_cast<char>(high * 16 + low));
+      i += 2;
+    } else {
+      path.push_back(rest[i]);
+    }
+  }
+  return path;
+}
+}  // namespace
+
+constexpr size_t FileDataSource::kMapWindowSize;
+
+FileDataSource::FileDataSource(TransferListenerInterface* listener)
+    : listener_(listener) {}
+
+FileDataSource::~FileDataSource() {
+  Close();
+}
+
+// static
+bool FileDataSource::IsFileUri(const std::string& uri) {
+  return base::StartsWith(uri, kFileScheme,
+                          base::CompareCase::INSENSITIVE_ASCII);
+}
+
+ssize_t FileDataSource::Open(const DataSpec& data_spec,
+                             const base::CancellationFlag* cancel) {
+  DCHECK_EQ(-1, fd_) << "Close() the previous request first";
+  uri_ = data_spec.uri.uri();
+  http_error_ = HTTP_IO_ERROR;
+  if (cancel && cancel->IsSet()) {
+    return RESULT_IO_ERROR;
+  }
+
+  std::string path = IsFileUri(uri_) ? PathFromUri(uri_) : std::string();
+  if (path.empty()) {
+    LOG(WARNING) << "Not a local file: " << uri_;
+    return RESULT_IO_ERROR;
+  }
+  fd_ = HANDLE_EINTR(open(path.c_str(), O_RDONLY | O_CLOEXEC));
+  if (fd_ < 0) {
+    PLOG(WARNING) << "Couldn't open " << path;
+    return RESULT_IO_ERROR;
+  }
+  struct stat st;
+  if (fstat(fd_, &st) != 0) {
+    PLOG(WARNING) << "Couldn't stat " << path;
+    return RESULT_IO_ERROR;
+  }
+  int64_t size = st.st_size;
+  if (data_spec.position > size ||
+      (data_spec.length != LENGTH_UNBOUNDED &&
+       data_spec.position + data_spec.length > size)) {
+    LOG(WARNING) << data_spec.DebugString() << " goes past the end of "
+                 << path << " (" << size << " bytes)";
+    return RESULT_IO_ERROR;
+  }
+  position_ = data_spec.position;
+  end_ = data_spec.length == LENGTH_UNBOUNDED ? size
+                                              : position_ + data_spec.length;
+
+  // The range is read through once; let the kernel read ahead of us.
+  posix_fadvise(fd_, position_, end_ - position_, POSIX_FADV_SEQUENTIAL);
+  posix_fadvise(fd_, position_,
+                std::min<int64_t>(end_ - position_, kMapWindowSize),
+                POSIX_FADV_WILLNEED);
+
+  http_error_ = HTTP_OK;
+  if (listener_) {
+    listener_->OnTransferStart();
+    transfer_started_ = true;
+  }
+  return end_ - position_;
+}
+
+void FileDataSource::Close() {
+  Unmap();
+  if (fd_ >= 0) {
+    IGNORE_EINTR(close(fd_));
+    fd_ = -1;
+  }
+  if (transfer_started_) {
+    listener_->OnTransferEnd();
+    transfer_started_ = false;
+  }
+  position_ = 0;
+  end_ = 0;
+}
+
+ssize_t FileDataSource::Read(void* buffer, size_t read_length) {
+  const void* data;
+  ssize_t result = ReadView(&data, read_length);
+  if (result > 0) {
+    memcpy(buffer, data, result);
+  }
+  return result;
+}
+
+bool FileDataSource::CanReadView() const {
+  return true;
+}
+
+ssize_t FileDataSource::ReadView(const void** data, size_t max_length) {
+  if (fd_ < 0 || http_error_ != HTTP_OK) {
+    return RESULT_IO_ERROR;
+  }
+  if (position_ == end_) {
+    return RESULT_END_OF_INPUT;
+  }
+  if (max_length == 0) {
+    return 0;
+  }
+  if (!map_ || position_ >= map_offset_ + static_cast<int64_t>(map_length_)) {
+    if (!MapWindow()) {
+      return RESULT_IO_ERROR;
+    }
+  }
+  size_t offset = position_ - map_offset_;
+  size_t count = std::min(max_length, map_length_ - offset);
+  *data = static_cast<const char*>(map_) + offset;
+  position_ += count;
+  if (listener_) {
+    listener_->OnBytesTransferred(count);
+  }
+  return count;
+}
+
+const char* FileDataSource::GetUri() const {
+  return uri_.c_str();
+}
+
+void FileDataSource::SetRequestProperty(const std::string& name,
+                                        const std::string& value) {}
+
+void FileDataSource::ClearRequestProperty(const std::string& name) {}
+
+void FileDataSource::ClearAllRequestProperties() {}
+
+const std::multimap<std::string, std::string>*
+FileDataSource::GetResponseHeaders() const {
+  return &response_headers_;
+}
+
+int FileDataSource::GetResponseCode() const {
+  return fd_ >= 0 && http_error_ == HTTP_OK ? 200 : 0;
+}
+
+HttpDataSourceError FileDataSource::GetHttpError() const {
+  return http_error_;
+}
+
+std::string FileDataSource::ReadAllToString(size_t max_length) {
+  if (max_length == 0) {
+    max_length = kDefaultMaxReadAllLength;
+  }
+  std::string out;
+  const void* data;
+  ssize_t result;
+  while ((result = ReadView(&data, max_length + 1 - out.size())) > 0) {
+    out.append(static_cast<const char*>(data), result);
+    if (out.size() > max_length) {
+      LOG(ERROR) << __FUNCTION__ << " response too large";
+      return std::string();
+    }
+  }
+  return result == RESULT_END_OF_INPUT ? out : std::string();
+}
+
+bool FileDataSource::MapWindow() {
+  Unmap();
+  static const int64_t page_size = sysconf(_SC_PAGESIZE);
+  map_offset_ = position_ - position_ % page_size;
+  map_length_ = std::min<int64_t>(kMapWindowSize, end_ - map_offset_);
+  map_ = mmap(nullptr, map_length_, PROT_READ, MAP_PRIVATE, fd_, map_offset_);
+  if (map_ == MAP_FAILED) {
+    PLOG(WARNING) << "Couldn't map " << uri_ << " at " << map_offset_;
+    map_ = nullptr;
+    http_error_ = HTTP_IO_ERROR;
+    return false;
+  }
+  madvise(map_, map_length_, MADV_SEQUENTIAL);
+  // Have the next window read in while this one is consumed.
+  int64_t next_offset = map_offset_ + map_length_;
+  if (next_offset < end_) {
+    posix_fadvise(fd_, next_offset,
+                  std::min<int64_t>(kMapWindowSize, end_ - next_offset),
+                  POSIX_FADV_WILLNEED);
+  }
+  return true;
+}
+
+void FileDataSource::Unmap() {
+  if (map_) {
+    munmap(map_, map_length_);
+    map_ = nullptr;
+    map_length_ = 0;
+  }
+}
+
+}  // namespace upstream
+}  // namespace ndash
@@ -0,0 +1,104 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NDASH_UPSTREAM_FILE_DATA_SOURCE_H_
+#define NDASH_UPSTREAM_FILE_DATA_SOURCE_H_
+
+#include <map>
+#include <string>
+
+#include "base/macros.h"
+#include "upstream/http_data_source.h"
+
+namespace ndash {
+namespace upstream {
+
+class TransferListenerInterface;
+
+// Reads file:// URIs straight from the file system: the requested range is
+// memory mapped a window at a time, and Read() copies out of the mapping or
+// ReadView() hands it out as it is. There is no thread or buffering
+// involved.
+//
+// It answers like an HTTP source would (200 with no headers), so it can stand
+// in for one; request properties are ignored. Files must not shrink while
+// they are read.
+class FileDataSource : public HttpDataSourceInterface {
+ public:
+  // The most of a file mapped at once.
+  static constexpr size_t kMapWindowSize = 4 * 1024 * 1024;
+
+  // listener: gets called when transfers start/end (nullptr if none)
+  explicit FileDataSource(TransferListenerInterface* listener = nullptr);
+  ~FileDataSource() override;
+
+  // Whether |uri| is a file:// URI.
+  static bool IsFileUri(const std::string& uri);
+
+  // DataSourceInterface
+  ssize_t Open(const DataSpec& data_spec,
+               const base::CancellationFlag* cancel = nullptr) override;
+  void Close() override;
+  ssize_t Read(void* buffer, size_t read_length) override;
+  bool CanReadView() const override;
+  ssize_t ReadView(const void** data, size_t max_length) override;
+
+  // UriDataSourceInterface
+  const char* GetUri() const override;
+
+  // HttpDataSourceInterface
+  void SetRequestProperty(const std::string& name,
+                          const std::string& value) override;
+  void ClearRequestProperty(const std::string& name) override;
+  void ClearAllRequestProperties() override;
+  const std::multimap<std::string, std::string>* GetResponseHeaders()
+      const override;
+  int GetResponseCode() const override;
+  HttpDataSourceError GetHttpError() const override;
+  std::string ReadAllToString(size_t max_length = 0) override;
+
+ private:
+  // Maps the window holding |position_|, replacing the one before it.
+  // Returns false on failure.
+  bool MapWindow();
+  void Unmap();
+
+  TransferListenerInterface* const listener_;
+
+  std::string uri_;
+  int fd_ = -1;
+  bool transfer_started_ = false;
+  HttpDataSourceError http_error_ = HTTP_OK;
+  const std::multimap<std::string, std::string> response_headers_;
+
+  // The next byte to read, and the end of the requested range, as file
+  // offsets.
+  int64_t position_ = 0;
+  int64_t end_ = 0;
+
+  // The current mapping, of |map_length_| bytes from the page aligned file
+  // offset |map_offset_|.
+  void* map_ = nullptr;
+  size_t map_length_ = 0;
+  int64_t map_offset_ = 0;
+
+  DISALLOW_COPY_AND_ASSIGN(FileDataSource);
+};
+
+}  // namespace upstream
+}  // namespace ndash
+
+#endif  // NDASH_UPSTREAM_FILE_DATA_SOURCE_H_
@@ -0,0 +1,199 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "upstream/file_data_source.h"
+
+#include <string>
+
+#include "base/files/file_util.h"
+#include "base/files/scoped_temp_dir.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "upstream/constants.h"
+#include "upstream/data_spec.h"
+#include "upstream/transfer_listener_mock.h"
+#include "upstream/uri.h"
+
+namespace ndash {
+namespace upstream {
+
+using ::testing::_;
+
+namespace {
+// Returns |length| bytes that differ from one offset to the next.
+std::string MakeContents(size_t length) {
+  std::string contents(length, '\0');
+  for (size_t i = 0; i < length; i++) {
+    contents[i] = static_cast<char>(i * 7 + i / 251);
+  }
+  return contents;
+}
+}  // namespace
+
+class FileDataSourceTest : public ::testing::Test {
+ protected:
+  void SetUp() override { ASSERT_TRUE(dir_.CreateUniqueTempDir()); }
+
+  // Writes |contents| to |name| and returns its file:// URI.
+  std::string WriteFile(const std::string& name, const std::string& contents) {
+    base::FilePath path = dir_.path().Append(name);
+    EXPECT_EQ(static_cast<int>(contents.size()),
+              base::WriteFile(path, contents.data(), contents.size()));
+    return "file://" + dir_.path().value() + "/" + name;
+  }
+
+  // Reads what's left of the open request with Read() calls of |chunk| bytes.
+  std::string ReadAll(FileDataSource* source, size_t chunk) {
+    std::string out;
+    std::string buffer(chunk, '\0');
+    ssize_t result;
+    while ((result = source->Read(&buffer[0], chunk)) > 0) {
+      out.append(buffer, 0, result);
+    }
+    EXPECT_EQ(RESULT_END_OF_INPUT, result);
+    return out;
+  }
+
+  base::ScopedTempDir dir_;
+};
+
+TEST_F(FileDataSourceTest, IsFileUri) {
+  EXPECT_TRUE(FileDataSource::IsFileUri("file:///sdcard/movie.mpd"));
+  EXPECT_TRUE(FileDataSource::IsFileUri("FILE:///sdcard/movie.mpd"));
+  EXPECT_FALSE(FileDataSource::IsFileUri("http://cdn.example/movie.mpd"));
+  EXPECT_FALSE(FileDataSource::IsFileUri("/sdcard/movie.mpd"));
+}
+
+TEST_F(FileDataSourceTest, ReadsWholeFileAndRanges) {
+  const std::string contents = MakeContents(10000);
+  const std::string uri = WriteFile("segment.m4s", contents);
+  FileDataSource source;
+
+  EXPECT_EQ(10000, source.Open(DataSpec(Uri(uri))));
+  EXPECT_EQ(200, source.GetResponseCode());
+  EXPECT_EQ(HTTP_OK, source.GetHttpError());
+  EXPECT_STREQ(uri.c_str(), source.GetUri());
+  EXPECT_EQ(contents, ReadAll(&source, 999));
+  source.Close();
+
+  EXPECT_EQ(500, source.Open(DataSpec(Uri(uri), 1234, 500, nullptr)));
+  EXPECT_EQ(contents.substr(1234, 500), ReadAll(&source, 64));
+  source.Close();
+
+  // An unbounded range runs to the end of the file.
+  EXPECT_EQ(100,
+            source.Open(DataSpec(Uri(uri), 9900, LENGTH_UNBOUNDED, nullptr)));
+  EXPECT_EQ(contents.substr(9900), source.ReadAllToString());
+  source.Close();
+}
+
+TEST_F(FileDataSourceTest, ReadsAcrossMapWindows) {
+  const size_t length = FileDataSource::kMapWindowSize * 2 + 4321;
+  const std::string contents = MakeContents(length);
+  const std::string uri = WriteFile("big.m4s", contents);
+  FileDataSource source;
+
+  // Start off a page boundary so the windows don't line up with the range.
+  const int64_t position = 3000;
+  const int64_t range = length - position - 10;
+  ASSERT_EQ(range, source.Open(DataSpec(Uri(uri), position, range, nullptr)));
+  EXPECT_EQ(contents.substr(position, range), ReadAll(&source, 65536 + 17));
+  source.Close();
+}
+
+TEST_F(FileDataSourceTest, ReadView) {
+  const std::string contents = MakeContents(4096);
+  const std::string uri = WriteFile("init.mp4", contents);
+  FileDataSource source;
+  EXPECT_TRUE(source.CanReadView());
+
+  ASSERT_EQ(100, source.Open(DataSpec(Uri(uri), 10, 100, nullptr)));
+  const void* data;
+  ASSERT_EQ(60, source.ReadView(&data, 60));
+  EXPECT_EQ(contents.substr(10, 60),
+            std::string(static_cast<const char*>(data), 60));
+  ASSERT_EQ(40, source.ReadView(&data, 60));
+  EXPECT_EQ(contents.substr(70, 40),
+            std::string(static_cast<const char*>(data), 40));
+  EXPECT_EQ(RESULT_END_OF_INPUT, source.ReadView(&data, 60));
+  source.Close();
+}
+
+TEST_F(FileDataSourceTest, UnescapesPaths) {
+  const std::string contents = "<MPD/>";
+  WriteFile("my movie.mpd", contents);
+  FileDataSource source;
+
+  std::string uri = "file://localhost" + dir_.path().value() +
+                    "/my%20movie.mpd?token=1#t=10";
+  EXPECT_EQ(6, source.Open(DataSpec(Uri(uri))));
+  EXPECT_EQ(contents, source.ReadAllToString());
+  source.Close();
+}
+
+TEST_F(FileDataSourceTest, Errors) {
+  const std::string uri = WriteFile("short.m4s", MakeContents(100));
+  FileDataSource source;
+
+  EXPECT_EQ(RESULT_IO_ERROR,
+            source.Open(DataSpec(Uri(uri + ".missing"))));
+  EXPECT_EQ(HTTP_IO_ERROR, source.GetHttpError());
+  source.Close();
+
+  // Ranges have to lie inside the file.
+  EXPECT_EQ(RESULT_IO_ERROR,
+            source.Open(DataSpec(Uri(uri), 50, 51, nullptr)));
+  source.Close();
+  EXPECT_EQ(RESULT_IO_ERROR,
+            source.Open(DataSpec(Uri(uri), 101, LENGTH_UNBOUNDED, nullptr)));
+  source.Close();
+
+  // Only local paths are understood.
+  EXPECT_EQ(RESULT_IO_ERROR,
+            source.Open(DataSpec(Uri("file://server/share/short.m4s"))));
+  source.Close();
+  EXPECT_EQ(RESULT_IO_ERROR,
+            source.Open(DataSpec(Uri("http://cdn.example/short.m4s"))));
+  source.Close();
+
+  char buffer[10];
+  EXPECT_EQ(RESULT_IO_ERROR, source.Read(buffer, sizeof(buffer)));
+}
+
+TEST_F(FileDataSourceTest, NotifiesListener) {
+  const std::string uri = WriteFile("segment.m4s", MakeContents(1000));
+  MockTransferListener listener;
+  FileDataSource source(&listener);
+
+  ::testing::InSequence sequence;
+  EXPECT_CALL(listener, OnTransferStart());
+  EXPECT_CALL(listener, OnBytesTransferred(600));
+  EXPECT_CALL(listener, OnBytesTransferred(400));
+  EXPECT_CALL(listener, OnTransferEnd());
+  EXPECT_CALL(listener, OnBytesTransferred(_)).Times(0);
+
+  ASSERT_EQ(1000, source.Open(DataSpec(Uri(uri))));
+  char buffer[600];
+  EXPECT_EQ(600, source.Read(buffer, sizeof(buffer)));
+  EXPECT_EQ(400, source.Read(buffer, sizeof(buffer)));
+  EXPECT_EQ(RESULT_END_OF_INPUT, source.Read(buffer, sizeof(buffer)));
+  source.Close();
+  // A second Close() doesn't end the transfer again.
+  source.Close();
+}
+
+}  // namespace upstream
+}  // namespace ndash
@@ -0,0 +1,130 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "upstream/host_stats.h"
+
+#include "base/logging.h"
+#include "base/memory/ptr_util.h"
+#include "base/time/default_tick_clock.h"
+#include "util/uri_util.h"
+
+namespace ndash {
+namespace upstream {
+
+namespace {
+// Weight of a new sample in the moving average.
+const double kSampleWeight = 0.3;
+
+void AddSample(double* average, double sample) {
+  if (*average == HostStats::kNoEstimate) {
+    *average = sample;
+  } else {
+    *average += kSampleWeight * (sample - *average);
+  }
+}
+}  // namespace
+
+constexpr int64_t HostStats::kNoEstimate;
+constexpr int64_t HostStats::kMinSampleBytes;
+constexpr int64_t HostStats::kExclusionSeconds;
+
+HostStats::HostStats()
+    : HostStats(base::WrapUnique(new base::DefaultTickClock)) {}
+
+HostStats::HostStats(std::unique_ptr<base::TickClock> clock)
+    : clock_(std::move(clock)) {}
+
+HostStats::~HostStats() {}
+
+std::string HostStats::HostOf(const std::string& url) {
+  return util::UriUtil::Resolve(url, "/");
+}
+
+void HostStats::OnTransfer(const std::string& url,
+                           int64_t bytes,
+                           base::TimeDelta elapsed,
+                           base::TimeDelta first_byte) {
+  if (elapsed <= base::TimeDelta() || first_byte > elapsed) {
+    return;
+  }
+  // Every request says something about latency, however small; only the
+  // larger ones say much about throughput.
+  base::TimeDelta transfer_time = elapsed - first_byte;
+  bool has_latency = first_byte > base::TimeDelta();
+  bool has_throughput =
+      bytes >= kMinSampleBytes && transfer_time > base::TimeDelta();
+  if (!has_latency && !has_throughput) {
+    return;
+  }
+
+  base::AutoLock auto_lock(lock_);
+  last_host_ = HostOf(url);
+  Entry& entry = hosts_[last_host_];
+  if (has_latency) {
+    AddSample(&entry.latency_us, first_byte.InMicroseconds());
+  }
+  if (has_throughput) {
+    AddSample(&entry.throughput, bytes * 8 / transfer_time.InSecondsF());
+  }
+}
+
+void HostStats::OnError(const std::string& url) {
+  std::string host = HostOf(url);
+  VLOG(1) << "Avoiding " << host << " for " << kExclusionSeconds << "s";
+  base::AutoLock auto_lock(lock_);
+  hosts_[host].excluded_until =
+      clock_->NowTicks() + base::TimeDelta::FromSeconds(kExclusionSeconds);
+}
+
+int64_t HostStats::GetThroughput(const std::string& host) const {
+  base::AutoLock auto_lock(lock_);
+  auto it = hosts_.find(host);
+  return it == hosts_.end() ? kNoEstimate
+                            : static_cast<int64_t>(it->second.throughput);
+}
+
+base::TimeDelta HostStats::GetLatency(const std::string& host) const {
+  base::AutoLock auto_lock(lock_);
+  auto it = hosts_.find(host);
+  if (it == hosts_.end() || it->second.latency_us == kNoEstimate) {
+    return base::TimeDelta();
+  }
+  return base::TimeDelta::FromMicroseconds(it->second.latency_us);
+}
+
+base::TimeDelta HostStats::PredictTransferTime(const std::string& host,
+                                               int64_t bytes) const {
+  int64_t throughput = GetThroughput(host);
+  if (throughput == kNoEstimate || throughput == 0) {
+    return base::TimeDelta::Max();
+  }
+  return GetLatency(host) + base::TimeDelta::FromSecondsD(
+                                static_cast<double>(bytes) * 8 / throughput);
+}
+
+std::string HostStats::GetLastHost() const {
+  base::AutoLock auto_lock(lock_);
+  return last_host_;
+}
+
+bool HostStats::IsExcluded(const std::string& host) const {
+  base::AutoLock auto_lock(lock_);
+  auto it = hosts_.find(host);
+  return it != hosts_.end() && clock_->NowTicks() < it->second.excluded_until;
+}
+
+}  // namespace upstream
+}  // namespace ndash
@@ -0,0 +1,108 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NDASH_UPSTREAM_HOST_STATS_H_
+#define NDASH_UPSTREAM_HOST_STATS_H_
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+
+#include "base/synchronization/lock.h"
+#include "base/time/tick_clock.h"
+#include "base/time/time.h"
+
+namespace ndash {
+namespace upstream {
+
+// Keeps a throughput estimate and recent failures for each host media is
+// fetched from, so that when a manifest offers several CDNs the best one can
+// be used and a failing one avoided.
+//
+// When transfers report their time to first byte, the request latency is
+// estimated apart from the throughput after the first byte, so that the time
+// a request of any size will take can be predicted: small requests are
+// mostly latency, and folding that into a single rate underestimates what
+// large ones get.
+//
+// Hosts are identified by the scheme and authority of a URL, e.g.
+// "http://cdn.example/". Safe to use from any thread.
+class HostStats {
+ public:
+  constexpr static int64_t kNoEstimate = -1;
+  // Transfers smaller than this say more about latency than throughput and
+  // are not counted.
+  constexpr static int64_t kMinSampleBytes = 16 * 1024;
+  // How long a host is avoided after a failed transfer.
+  constexpr static int64_t kExclusionSeconds = 60;
+
+  HostStats();
+  // Expanded constructor with dependency injection for testing
+  explicit HostStats(std::unique_ptr<base::TickClock> clock);
+  ~HostStats();
+
+  // Returns the host part of |url|.
+  static std::string HostOf(const std::string& url);
+
+  // Records a completed transfer of |bytes| from |url| taking |elapsed|, of
+  // which |first_byte| went by before the response started (zero if not
+  // known, in which case the latency estimate is left alone and the
+  // throughput includes it).
+  void OnTransfer(const std::string& url,
+                  int64_t bytes,
+                  base::TimeDelta elapsed,
+                  base::TimeDelta first_byte = base::TimeDelta());
+  // Records a failed transfer from |url|.
+  void OnError(const std::string& url);
+
+  // Returns the estimated throughput from |host| in bits per second, or
+  // kNoEstimate.
+  int64_t GetThroughput(const std::string& host) const;
+  // Returns the estimated time from making a request to |host| to the start
+  // of the response, or zero if there is no estimate.
+  base::TimeDelta GetLatency(const std::string& host) const;
+  // Returns how long a request for |bytes| from |host| is expected to take:
+  // the latency plus |bytes| at the throughput. Returns base::TimeDelta::Max()
+  // if there is no throughput estimate.
+  base::TimeDelta PredictTransferTime(const std::string& host,
+                                      int64_t bytes) const;
+  // Returns the host of the last transfer recorded, or an empty string.
+  std::string GetLastHost() const;
+  // Whether |host| failed within the last kExclusionSeconds.
+  bool IsExcluded(const std::string& host) const;
+
+ private:
+  struct Entry {
+    double throughput = kNoEstimate;
+    double latency_us = kNoEstimate;
+    base::TimeTicks excluded_until;
+  };
+
+  const std::unique_ptr<base::TickClock> clock_;
+
+  mutable base::Lock lock_;  // Protects |hosts_| and |last_host_|
+  std::map<std::string, Entry> hosts_;
+  std::string last_host_;
+
+  HostStats(const HostStats& other) = delete;
+  HostStats& operator=(const HostStats& other) = delete;
+};
+
+}  // namespace upstream
+}  // namespace ndash
+
+#endif  // NDASH_UPSTREAM_HOST_STATS_H_
@@ -0,0 +1,124 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "upstream/host_stats.h"
+
+#include <memory>
+
+#include "base/memory/ptr_util.h"
+#include "base/test/simple_test_tick_clock.h"
+#include "base/time/time.h"
+#include "gtest/gtest.h"
+
+namespace ndash {
+namespace upstream {
+
+TEST(HostStatsTest, HostOf) {
+  EXPECT_EQ("http://cdn.example/",
+            HostStats::HostOf("http://cdn.example/movie/seg1.m4s?token=1"));
+  EXPECT_EQ("https://cdn.example:8443/",
+            HostStats::HostOf("https://cdn.example:8443/seg1.m4s"));
+}
+
+TEST(HostStatsTest, Throughput) {
+  HostStats host_stats;
+  EXPECT_EQ(HostStats::kNoEstimate,
+            host_stats.GetThroughput("http://a.example/"));
+
+  // 1 MB in a second.
+  host_stats.OnTransfer("http://a.example/seg1", 1000000,
+                        base::TimeDelta::FromSeconds(1));
+  EXPECT_EQ(8000000, host_stats.GetThroughput("http://a.example/"));
+  EXPECT_EQ(HostStats::kNoEstimate,
+            host_stats.GetThroughput("http://b.example/"));
+
+  // Later samples move the estimate part of the way.
+  host_stats.OnTransfer("http://a.example/seg2", 2000000,
+                        base::TimeDelta::FromSeconds(1));
+  int64_t throughput = host_stats.GetThroughput("http://a.example/");
+  EXPECT_LT(8000000, throughput);
+  EXPECT_GT(16000000, throughput);
+
+  // Small transfers are ignored.
+  host_stats.OnTransfer("http://b.example/init", HostStats::kMinSampleBytes - 1,
+                        base::TimeDelta::FromMilliseconds(1));
+  EXPECT_EQ(HostStats::kNoEstimate,
+            host_stats.GetThroughput("http://b.example/"));
+}
+
+TEST(HostStatsTest, Latency) {
+  HostStats host_stats;
+  EXPECT_EQ(base::TimeDelta(), host_stats.GetLatency("http://a.example/"));
+  EXPECT_EQ(base::TimeDelta::Max(),
+            host_stats.PredictTransferTime("http://a.example/", 1000));
+  EXPECT_EQ("", host_stats.GetLastHost());
+
+  // A small transfer gives latency only.
+  host_stats.OnTransfer("http://a.example/audio1", 1000,
+                        base::TimeDelta::FromMilliseconds(310),
+                        base::TimeDelta::FromMilliseconds(300));
+  EXPECT_EQ(base::TimeDelta::FromMilliseconds(300),
+            host_stats.GetLatency("http://a.example/"));
+  EXPECT_EQ(HostStats::kNoEstimate,
+            host_stats.GetThroughput("http://a.example/"));
+  EXPECT_EQ("http://a.example/", host_stats.GetLastHost());
+
+  // The throughput leaves out the time to the first byte: 1 MB in a second
+  // after it.
+  host_stats.OnTransfer("http://a.example/video1", 1000000,
+                        base::TimeDelta::FromMilliseconds(1300),
+                        base::TimeDelta::FromMilliseconds(300));
+  EXPECT_EQ(8000000, host_stats.GetThroughput("http://a.example/"));
+  EXPECT_EQ(base::TimeDelta::FromMilliseconds(300),
+            host_stats.GetLatency("http://a.example/"));
+  EXPECT_EQ(base::TimeDelta::FromMilliseconds(800),
+            host_stats.PredictTransferTime("http://a.example/", 500000));
+  EXPECT_EQ(base::TimeDelta::FromMilliseconds(300),
+            host_stats.PredictTransferTime("http://a.example/", 0));
+
+  // Later latencies move the estimate part of the way.
+  host_stats.OnTransfer("http://b.example/video1", 1000000,
+                        base::TimeDelta::FromMilliseconds(1100),
+                        base::TimeDelta::FromMilliseconds(100));
+  host_stats.OnTransfer("http://a.example/audio2", 1000,
+                        base::TimeDelta::FromMilliseconds(110),
+                        base::TimeDelta::FromMilliseconds(100));
+  base::TimeDelta latency = host_stats.GetLatency("http://a.example/");
+  EXPECT_LT(base::TimeDelta::FromMilliseconds(100), latency);
+  EXPECT_GT(base::TimeDelta::FromMilliseconds(300), latency);
+  EXPECT_EQ(base::TimeDelta::FromMilliseconds(100),
+            host_stats.GetLatency("http://b.example/"));
+  EXPECT_EQ("http://a.example/", host_stats.GetLastHost());
+}
+
+TEST(HostStatsTest, Exclusion) {
+  base::SimpleTestTickClock* clock = new base::SimpleTestTickClock;
+  HostStats host_stats{std::unique_ptr<base::TickClock>(clock)};
+  EXPECT_FALSE(host_stats.IsExcluded("http://a.example/"));
+
+  host_stats.OnError("http://a.example/seg1");
+  EXPECT_TRUE(host_stats.IsExcluded("http://a.example/"));
+  EXPECT_FALSE(host_stats.IsExcluded("http://b.example/"));
+
+  clock->Advance(
+      base::TimeDelta::FromSeconds(HostStats::kExclusionSeconds - 1));
+  EXPECT_TRUE(host_stats.IsExcluded("http://a.example/"));
+  clock->Advance(base::TimeDelta::FromSeconds(1));
+  EXPECT_FALSE(host_stats.IsExcluded("http://a.example/"));
+}
+
+}  // namespace upstream
+}  // namespace ndash
@@ -0,0 +1,83 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "upstream/loader_pool.h"
+
+#include <algorithm>
+
+#include "base/lazy_instance.h"
+#include "base/logging.h"
+#include "base/synchronization/lock.h"
+#include "base/threading/sequenced_worker_pool.h"
+
+namespace ndash {
+namespace upstream {
+
+namespace {
+base::LazyInstance<base::Lock>::Leaky g_pool_lock = LAZY_INSTANCE_INITIALIZER;
+LoaderPool* g_pool = nullptr;
+size_t g_loader_threads = LoaderPool::kDefaultLoaderThreads;
+size_t g_network_threads = LoaderPool::kDefaultNetworkThreads;
+}  // namespace
+
+constexpr size_t LoaderPool::kDefaultLoaderThreads;
+constexpr size_t LoaderPool::kDefaultNetworkThreads;
+
+// static
+LoaderPool* LoaderPool::GetInstance() {
+  base::AutoLock auto_lock(g_pool_lock.Get());
+  if (!g_pool) {
+    g_pool = new LoaderPool(g_loader_threads, g_network_threads);
+  }
+  return g_pool;
+}
+
+// static
+bool LoaderPool::SetThreadCounts(size_t loader_threads,
+                                 size_t network_threads) {
+  base::AutoLock auto_lock(g_pool_lock.Get());
+  if (g_pool) {
+    VLOG(1) << "Loader pool already running with "
+                 << g_pool->loader_threads() << "/"
+                 << g_pool->network_threads() << " threads";
+    return false;
+  }
+  g_loader_threads = std::max<size_t>(loader_threads, 1);
+  g_network_threads = std::max(network_threads, g_loader_threads);
+  return true;
+}
+
+LoaderPool::LoaderPool(size_t loader_threads, size_t network_threads)
+    : loader_threads_(loader_threads),
+      network_threads_(network_threads),
+      loader_pool_(new base::SequencedWorkerPool(loader_threads, "Loader")),
+      network_pool_(new base::SequencedWorkerPool(network_threads, "CURL")) {
+  VLOG(1) << "Started shared loader pool: " << loader_threads_ << " loader, "
+          << network_threads_ << " network threads";
+}
+
+LoaderPool::~LoaderPool() {}
+
+scoped_refptr<base::TaskRunner> LoaderPool::loader_task_runner() const {
+  return loader_pool_;
+}
+
+scoped_refptr<base::TaskRunner> LoaderPool::network_task_runner() const {
+  return network_pool_;
+}
+
+}  // namespace upstream
+}  // namespace ndash
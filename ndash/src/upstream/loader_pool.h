@@ -0,0 +1,82 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NDASH_UPSTREAM_LOADER_POOL_H_
+#define NDASH_UPSTREAM_LOADER_POOL_H_
+
+#include <cstddef>
+
+#include "base/memory/ref_counted.h"
+#include "base/task_runner.h"
+
+namespace base {
+class SequencedWorkerPool;
+}  // namespace base
+
+namespace ndash {
+namespace upstream {
+
+// Process-wide worker pools shared by every player that opts in to them (see
+// the "executor" player attribute). Without them, each player spawns a
+// dedicated loader thread per track and a CURL thread per data source; with
+// them, any number of players share a fixed set of threads.
+//
+// Loads and CURL transfers both block for the duration of a request, so they
+// run on separate pools. A load waiting on its transfer can then never hold
+// the worker that the transfer needs. Prefetch transfers, which can stall
+// until a later load reads them, stay off the network pool for the same
+// reason.
+class LoaderPool {
+ public:
+  static constexpr size_t kDefaultLoaderThreads = 8;
+  static constexpr size_t kDefaultNetworkThreads = 8;
+
+  // Returns the shared pools, creating them on first use. The first call must
+  // happen on a thread that has a MessageLoop.
+  static LoaderPool* GetInstance();
+
+  // Overrides the number of worker threads. Only takes effect when called
+  // before the first GetInstance(); returns false otherwise. The network pool
+  // is never made smaller than the loader pool, since every running load may
+  // have a transfer in progress.
+  static bool SetThreadCounts(size_t loader_threads, size_t network_threads);
+
+  // Runs LoadableInterface::Load() calls. See LoaderThread.
+  scoped_refptr<base::TaskRunner> loader_task_runner() const;
+  // Runs CURL transfers. See CurlDataSource.
+  scoped_refptr<base::TaskRunner> network_task_runner() const;
+
+  size_t loader_threads() const { return loader_threads_; }
+  size_t network_threads() const { return network_threads_; }
+
+  LoaderPool(const LoaderPool& other) = delete;
+  LoaderPool& operator=(const LoaderPool& other) = delete;
+
+ private:
+  LoaderPool(size_t loader_threads, size_t network_threads);
+  // Never destroyed: players may be torn down in any order at process exit.
+  ~LoaderPool();
+
+  const size_t loader_threads_;
+  const size_t network_threads_;
+  scoped_refptr<base::SequencedWorkerPool> loader_pool_;
+  scoped_refptr<base::SequencedWorkerPool> network_pool_;
+};
+
+}  // namespace upstream
+}  // namespace ndash
+
+#endif  // NDASH_UPSTREAM_LOADER_POOL_H_
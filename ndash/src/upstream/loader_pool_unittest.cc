@@ -0,0 +1,166 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "upstream/loader_pool.h"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "base/bind.h"
+#include "base/callback.h"
+#include "base/message_loop/message_loop.h"
+#include "base/run_loop.h"
+#include "base/synchronization/waitable_event.h"
+#include "base/threading/platform_thread.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "upstream/loader_thread.h"
+
+namespace ndash {
+namespace upstream {
+
+using ::testing::Eq;
+using ::testing::Ge;
+
+namespace {
+
+// A loadable that blocks until released, so a test can hold pool workers.
+class BlockingLoadable : public LoadableInterface {
+ public:
+  BlockingLoadable(base::WaitableEvent* release, std::atomic<int>* running)
+      : release_(release), running_(running) {}
+  ~BlockingLoadable() override {}
+
+  void CancelLoad() override { canceled_ = true; }
+  bool IsLoadCanceled() const override { return canceled_; }
+  bool Load() override {
+    (*running_)++;
+    release_->Wait();
+    loaded_ = true;
+    return true;
+  }
+
+  bool loaded() const { return loaded_; }
+
+ private:
+  base::WaitableEvent* release_;
+  std::atomic<int>* running_;
+  std::atomic<bool> canceled_{false};
+  std::atomic<bool> loaded_{false};
+};
+
+class DoneCounter {
+ public:
+  DoneCounter(int expected, const base::Closure& quit)
+      : expected_(expected), quit_(quit) {}
+
+  void Done(LoadableInterface* loadable, LoaderOutcome outcome) {
+    outcomes_.push_back(outcome);
+    if (static_cast<int>(outcomes_.size()) == expected_) {
+      quit_.Run();
+    }
+  }
+
+  const std::vector<LoaderOutcome>& outcomes() const { return outcomes_; }
+
+ private:
+  int expected_;
+  base::Closure quit_;
+  std::vector<LoaderOutcome> outcomes_;
+};
+
+void IgnoreOutcome(LoadableInterface* loadable, LoaderOutcome outcome) {}
+
+}  // namespace
+
+TEST(LoaderPoolTest, SingleInstance) {
+  base::MessageLoop top_loop;
+
+  LoaderPool* pool = LoaderPool::GetInstance();
+  ASSERT_THAT(pool, ::testing::NotNull());
+  EXPECT_THAT(LoaderPool::GetInstance(), Eq(pool));
+  EXPECT_THAT(pool->network_threads(), Ge(pool->loader_threads()));
+
+  // Too late to resize a running pool.
+  EXPECT_THAT(LoaderPool::SetThreadCounts(1, 1), Eq(false));
+}
+
+TEST(LoaderPoolTest, MoreLoadersThanThreads) {
+  base::MessageLoop top_loop;
+  LoaderPool* pool = LoaderPool::GetInstance();
+
+  // Twice as many loaders as workers: all of them must still complete once
+  // the first batch is released.
+  const int num_loaders = pool->loader_threads() * 2;
+
+  base::WaitableEvent release(true, false);
+  std::atomic<int> running(0);
+  std::vector<std::unique_ptr<BlockingLoadable>> loadables;
+  std::vector<std::unique_ptr<LoaderThread>> loaders;
+
+  base::RunLoop loop;
+  DoneCounter counter(num_loaders, loop.QuitClosure());
+
+  for (int i = 0; i < num_loaders; i++) {
+    loadables.emplace_back(new BlockingLoadable(&release, &running));
+    loaders.emplace_back(new LoaderThread(pool->loader_task_runner()));
+    EXPECT_THAT(loaders.back()->StartLoading(
+                    loadables.back().get(),
+                    base::Bind(&DoneCounter::Done, base::Unretained(&counter))),
+                Eq(true));
+    EXPECT_THAT(loaders.back()->IsLoading(), Eq(true));
+  }
+
+  release.Signal();
+  loop.Run();
+
+  EXPECT_THAT(running.load(), Eq(num_loaders));
+  ASSERT_THAT(counter.outcomes().size(), Eq(static_cast<size_t>(num_loaders)));
+  for (LoaderOutcome outcome : counter.outcomes()) {
+    EXPECT_THAT(outcome, Eq(LOAD_COMPLETE));
+  }
+  for (const auto& loader : loaders) {
+    EXPECT_THAT(loader->IsLoading(), Eq(false));
+  }
+}
+
+TEST(LoaderPoolTest, DestructorWaitsForLoad) {
+  base::MessageLoop top_loop;
+  LoaderPool* pool = LoaderPool::GetInstance();
+
+  base::WaitableEvent release(true, false);
+  std::atomic<int> running(0);
+  BlockingLoadable loadable(&release, &running);
+
+  {
+    LoaderThread loader(pool->loader_task_runner());
+    EXPECT_THAT(loader.StartLoading(
+                    &loadable, base::Bind(&IgnoreOutcome)),
+                Eq(true));
+    while (running.load() == 0) {
+      base::PlatformThread::YieldCurrentThread();
+    }
+    release.Signal();
+  }
+
+  // The load must have finished by the time the loader is gone, even though
+  // the reply was never delivered.
+  EXPECT_THAT(loadable.loaded(), Eq(true));
+}
+
+}  // namespace upstream
+}  // namespace ndash
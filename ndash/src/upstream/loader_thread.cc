@@ -22,15 +22,35 @@
 #include "base/callback.h"
 #include "base/message_loop/message_loop.h"
 #include "base/threading/thread.h"
+#include "util/thread_config.h"
 
 namespace ndash {
 namespace upstream {
 
-LoaderThread::LoaderThread(const std::string& thread_name)
-    : callback_(), thread_(thread_name), weak_ptr_factory_(this) {}
+LoaderThread::LoaderThread(const std::string& thread_name,
+                           const util::ThreadConfig* thread_config)
+    : callback_(),
+      thread_(thread_name),
+      thread_config_(thread_config),
+      run_done_(true, true),
+      weak_ptr_factory_(this) {}
+
+LoaderThread::LoaderThread(scoped_refptr<base::TaskRunner> task_runner)
+    : callback_(),
+      thread_("unused"),
+      task_runner_(task_runner),
+      shared_runner_(true),
+      run_done_(true, true),
+      weak_ptr_factory_(this) {
+  started_ = true;
+}
 
 LoaderThread::~LoaderThread() {
-  if (started_) {
+  if (shared_runner_) {
+    // Same guarantee as Thread::Stop(): the loadable is not touched after
+    // this returns.
+    run_done_.Wait();
+  } else if (started_) {
     thread_.Stop();
   }
 }
@@ -38,12 +58,15 @@ LoaderThread::~LoaderThread() {
 bool LoaderThread::StartLoading(LoadableInterface* loadable,
                                 const LoadDoneCallback& callback) {
   if (!started_) {
-    started_ = thread_.Start();
+    const util::ThreadConfig* config =
+        thread_config_ ? thread_config_ : util::ThreadConfig::GetInstance();
+    started_ = config->StartThread(util::ThreadRole::LOADER, &thread_);
 
     if (!started_) {
       LOG(WARNING) << "Couldn't start loader thread " << thread_.thread_name();
       return false;
     }
+    task_runner_ = thread_.task_runner();
   }
 
   if (loading_) {
@@ -55,11 +78,13 @@ bool LoaderThread::StartLoading(LoadableInterface* loadable,
   current_loadable_ = loadable;
   callback_ = callback;
 
-  if (!thread_.task_runner()->PostTaskAndReply(
+  run_done_.Reset();
+  if (!task_runner_->PostTaskAndReply(
           FROM_HERE, base::Bind(&LoaderThread::RunLoad, base::Unretained(this)),
           base::Bind(&LoaderThread::DoneLoad,
                      weak_ptr_factory_.GetWeakPtr()))) {
     // Couldn't post the task, so run the callback immediately to report error
+    run_done_.Signal();
     base::MessageLoop::current()->task_runner()->PostTask(
         FROM_HERE,
         base::Bind(&LoaderThread::DoneLoad, weak_ptr_factory_.GetWeakPtr()));
@@ -81,6 +106,7 @@ void LoaderThread::CancelLoading() {
 void LoaderThread::RunLoad() {
   if (current_loadable_->IsLoadCanceled()) {
     loadable_outcome_ = LOAD_CANCELED;
+    run_done_.Signal();
     return;
   }
 
@@ -93,6 +119,7 @@ void LoaderThread::RunLoad() {
   } else {
     loadable_outcome_ = LOAD_ERROR;
   }
+  run_done_.Signal();
 }
 
 void LoaderThread::DoneLoad() {
@@ -20,16 +20,29 @@
 #include <string>
 
 #include "base/callback.h"
+#include "base/memory/ref_counted.h"
+#include "base/synchronization/waitable_event.h"
+#include "base/task_runner.h"
 #include "base/threading/thread.h"
 #include "upstream/loader.h"
 
 namespace ndash {
+
+namespace util {
+class ThreadConfig;
+}  // namespace util
+
 namespace upstream {
 
 class LoaderThread : public LoaderInterface {
  public:
   // thread_name: A name for the Loader's thread.
-  LoaderThread(const std::string& thread_name);
+  // thread_config: How to start it (nullptr for the settings of all players).
+  LoaderThread(const std::string& thread_name,
+               const util::ThreadConfig* thread_config = nullptr);
+  // task_runner: Runs loads on a shared pool (see LoaderPool) instead of a
+  // dedicated thread. The destructor blocks until any running load returns.
+  explicit LoaderThread(scoped_refptr<base::TaskRunner> task_runner);
   ~LoaderThread() override;
 
   // Must only be called on the same thread that constructs and destructs the
@@ -57,6 +70,14 @@ class LoaderThread : public LoaderInterface {
   LoaderOutcome loadable_outcome_ = LOAD_ERROR;
 
   base::Thread thread_;
+  const util::ThreadConfig* thread_config_ = nullptr;
+
+  // Either |thread_|'s task runner (once started) or a shared pool's.
+  scoped_refptr<base::TaskRunner> task_runner_;
+  bool shared_runner_ = false;
+  // Signaled whenever no RunLoad() is queued or running. Only used with a
+  // shared task runner, where there is no thread to join on destruction.
+  base::WaitableEvent run_done_;
 
   base::WeakPtrFactory<LoaderThread> weak_ptr_factory_;
 };
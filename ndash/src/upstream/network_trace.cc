@@ -0,0 +1,229 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "upstream/network_trace.h"
+
+#include <cstring>
+#include <utility>
+
+#include "base/files/file_util.h"
+#include "base/logging.h"
+#include "base/pickle.h"
+#include "upstream/data_spec.h"
+#include "upstream/recording_data_source.h"
+#include "upstream/replay_data_source.h"
+
+namespace ndash {
+namespace upstream {
+
+namespace {
+// Bumped whenever the file format changes; files of other versions are
+// rejected.
+const int kVersion = 1;
+
+// A file is a pickle holding kVersion followed by one pickle per transfer,
+// each preceded by its size.
+std::string Frame(const base::Pickle& pickle) {
+  uint32_t size = pickle.size();
+  std::string framed(reinterpret_cast<const char*>(&size), sizeof(size));
+  framed.append(static_cast<const char*>(pickle.data()), pickle.size());
+  return framed;
+}
+
+void WriteTransfer(const NetworkTrace::Transfer& transfer,
+                   base::Pickle* pickle) {
+  pickle->WriteString(transfer.key);
+  pickle->WriteInt64(transfer.open_result);
+  pickle->WriteInt64(transfer.open_time.InMicroseconds());
+  pickle->WriteInt(transfer.response_code);
+  pickle->WriteInt(transfer.http_error);
+  pickle->WriteInt(transfer.response_headers.size());
+  for (const auto& header : transfer.response_headers) {
+    pickle->WriteString(header.first);
+    pickle->WriteString(header.second);
+  }
+  pickle->WriteInt(transfer.read_results.size());
+  for (size_t i = 0; i < transfer.read_results.size(); i++) {
+    pickle->WriteInt64(transfer.read_results[i]);
+    pickle->WriteInt64(transfer.read_times[i].InMicroseconds());
+  }
+  pickle->WriteString(transfer.data);
+}
+
+bool ReadTransfer(base::PickleIterator* iter,
+                  NetworkTrace::Transfer* transfer) {
+  int64_t open_time_us;
+  int http_error;
+  int header_count;
+  if (!iter->ReadString(&transfer->key) ||
+      !iter->ReadInt64(&transfer->open_result) ||
+      !iter->ReadInt64(&open_time_us) ||
+      !iter->ReadInt(&transfer->response_code) ||
+      !iter->ReadInt(&http_error) || !iter->ReadLength(&header_count)) {
+    return false;
+  }
+  transfer->open_time = base::TimeDelta::FromMicroseconds(open_time_us);
+  transfer->http_error = static_cast<HttpDataSourceError>(http_error);
+  for (int i = 0; i < header_count; i++) {
+    std::string name;
+    std::string value;
+    if (!iter->ReadString(&name) || !iter->ReadString(&value)) {
+      return false;
+    }
+    transfer->response_headers.emplace(std::move(name), std::move(value));
+  }
+  int read_count;
+  if (!iter->ReadLength(&read_count)) {
+    return false;
+  }
+  for (int i = 0; i < read_count; i++) {
+    int64_t result;
+    int64_t time_us;
+    if (!iter->ReadInt64(&result) || !iter->ReadInt64(&time_us)) {
+      return false;
+    }
+    transfer->read_results.push_back(result);
+    transfer->read_times.push_back(base::TimeDelta::FromMicroseconds(time_us));
+  }
+  return iter->ReadString(&transfer->data);
+}
+}  // namespace
+
+NetworkTrace::Transfer::Transfer() {}
+
+NetworkTrace::Transfer::~Transfer() {}
+
+NetworkTrace::NetworkTrace() {}
+
+NetworkTrace::~NetworkTrace() {}
+
+// static
+std::string NetworkTrace::KeyOf(const DataSpec& data_spec) {
+  return data_spec.uri.uri() + "@" + std::to_string(data_spec.position) + "+" +
+         std::to_string(data_spec.length);
+}
+
+bool NetworkTrace::StartRecording(const base::FilePath& path) {
+  base::Pickle pickle;
+  pickle.WriteInt(kVersion);
+  const std::string framed = Frame(pickle);
+  base::AutoLock auto_lock(lock_);
+  if (base::WriteFile(path, framed.data(), framed.size()) !=
+      static_cast<int>(framed.size())) {
+    LOG(ERROR) << "Couldn't write network trace " << path.value();
+    return false;
+  }
+  recording_path_ = path;
+  return true;
+}
+
+void NetworkTrace::Add(const Transfer& transfer) {
+  DCHECK(recording());
+  base::Pickle pickle;
+  WriteTransfer(transfer, &pickle);
+  const std::string framed = Frame(pickle);
+  base::AutoLock auto_lock(lock_);
+  if (!base::AppendToFile(recording_path_, framed.data(), framed.size())) {
+    LOG(WARNING) << "Couldn't record " << transfer.key;
+  }
+}
+
+bool NetworkTrace::Load(const base::FilePath& path) {
+  std::string contents;
+  if (!base::ReadFileToString(path, &contents)) {
+    LOG(ERROR) << "Couldn't read network trace " << path.value();
+    return false;
+  }
+
+  const char* start = contents.data();
+  const char* end = start + contents.size();
+  std::map<std::string, std::deque<std::unique_ptr<Transfer>>> transfers;
+  bool version_ok = false;
+  while (start != end) {
+    uint32_t size;
+    if (static_cast<size_t>(end - start) < sizeof(size)) {
+      break;
+    }
+    memcpy(&size, start, sizeof(size));
+    if (size > static_cast<size_t>(end - start) - sizeof(size)) {
+      break;
+    }
+    const char* next = start + sizeof(size) + size;
+    base::Pickle pickle(start + sizeof(size), size);
+    base::PickleIterator iter(pickle);
+    if (!version_ok) {
+      int version;
+      if (!iter.ReadInt(&version) || version != kVersion) {
+        break;
+      }
+      version_ok = true;
+    } else {
+      std::unique_ptr<Transfer> transfer(new Transfer);
+      if (!ReadTransfer(&iter, transfer.get())) {
+        break;
+      }
+      std::string key = transfer->key;
+      transfers[key].push_back(std::move(transfer));
+    }
+    start = next;
+  }
+  if (!version_ok) {
+    LOG(ERROR) << "Bad network trace " << path.value();
+    return false;
+  }
+  // A recording cut short by a crash can end with part of a transfer; the
+  // rest is still good.
+  if (start != end) {
+    LOG(WARNING) << "Ignoring " << end - start << " bytes at the end of "
+                 << path.value();
+  }
+
+  base::AutoLock auto_lock(lock_);
+  transfers_ = std::move(transfers);
+  return true;
+}
+
+std::unique_ptr<NetworkTrace::Transfer> NetworkTrace::Take(
+    const DataSpec& data_spec) {
+  base::AutoLock auto_lock(lock_);
+  auto it = transfers_.find(KeyOf(data_spec));
+  if (it == transfers_.end()) {
+    return nullptr;
+  }
+  std::unique_ptr<Transfer> transfer = std::move(it->second.front());
+  it->second.pop_front();
+  if (it->second.empty()) {
+    transfers_.erase(it);
+  }
+  return transfer;
+}
+
+std::unique_ptr<HttpDataSourceInterface> NetworkTrace::Wrap(
+    std::unique_ptr<HttpDataSourceInterface> upstream,
+    TransferListenerInterface* listener,
+    HostStats* host_stats) {
+  if (recording()) {
+    return std::unique_ptr<HttpDataSourceInterface>(
+        new RecordingDataSource(std::move(upstream), this));
+  }
+  std::unique_ptr<ReplayDataSource> replay(
+      new ReplayDataSource(this, listener));
+  replay->SetHostStats(host_stats);
+  return std::move(replay);
+}
+
+}  // namespace upstream
+}  // namespace ndash
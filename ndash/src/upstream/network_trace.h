@@ -0,0 +1,118 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NDASH_UPSTREAM_NETWORK_TRACE_H_
+#define NDASH_UPSTREAM_NETWORK_TRACE_H_
+
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/files/file_path.h"
+#include "base/synchronization/lock.h"
+#include "base/time/time.h"
+#include "upstream/http_data_source.h"
+
+namespace ndash {
+namespace upstream {
+
+class DataSpec;
+class HostStats;
+class TransferListenerInterface;
+
+// The requests a player made and what came back, with the time each piece
+// arrived, so that a session can be played again without the network and
+// with the same inputs to adaptation. RecordingDataSource adds to a trace
+// being recorded; ReplayDataSource serves from a loaded one.
+//
+// A trace being recorded is appended to its file as each request is closed,
+// so that it survives the player crashing. Either kind may be shared by all
+// the data sources of a player, from any thread.
+class NetworkTrace {
+ public:
+  // One request, from Open() to Close().
+  struct Transfer {
+    Transfer();
+    ~Transfer();
+
+    // Identifies the request: the URI and byte range.
+    std::string key;
+    // What Open() returned, and how long after it was called.
+    int64_t open_result = 0;
+    base::TimeDelta open_time;
+    int response_code = 0;
+    HttpDataSourceError http_error = HTTP_OK;
+    std::multimap<std::string, std::string> response_headers;
+    // What each Read() returned (a size, or a RESULT_ value) and how long
+    // after Open() was called. The bytes of all of them are in |data|.
+    std::vector<int64_t> read_results;
+    std::vector<base::TimeDelta> read_times;
+    std::string data;
+  };
+
+  NetworkTrace();
+  ~NetworkTrace();
+
+  // Returns the key for requests of |data_spec|.
+  static std::string KeyOf(const DataSpec& data_spec);
+
+  // Starts recording to |path|, replacing what it held. Returns false on
+  // error.
+  bool StartRecording(const base::FilePath& path);
+  // Appends |transfer| to the file being recorded.
+  void Add(const Transfer& transfer);
+
+  // Reads the trace at |path| for replay. Returns false on error.
+  bool Load(const base::FilePath& path);
+  // Removes and returns the earliest transfer loaded for |data_spec|, or null
+  // if there are no more. Requests repeated during the session, like the
+  // manifest of a live stream, are served in the order they were recorded.
+  std::unique_ptr<Transfer> Take(const DataSpec& data_spec);
+
+  // Whether ReplayDataSource waits until each piece arrived when recorded,
+  // rather than serving everything at once. True by default.
+  void set_paced(bool paced) { paced_ = paced; }
+  bool paced() const { return paced_; }
+
+  bool recording() const { return !recording_path_.empty(); }
+
+  // Returns a data source for the player to use in place of |upstream|: one
+  // that records |upstream|, or one that replays this trace and reports to
+  // |listener| and |host_stats| (either may be null) as |upstream| would
+  // have.
+  std::unique_ptr<HttpDataSourceInterface> Wrap(
+      std::unique_ptr<HttpDataSourceInterface> upstream,
+      TransferListenerInterface* listener,
+      HostStats* host_stats = nullptr);
+
+  NetworkTrace(const NetworkTrace& other) = delete;
+  NetworkTrace& operator=(const NetworkTrace& other) = delete;
+
+ private:
+  base::FilePath recording_path_;
+  bool paced_ = true;
+
+  base::Lock lock_;  // Protects everything below
+  std::map<std::string, std::deque<std::unique_ptr<Transfer>>> transfers_;
+};
+
+}  // namespace upstream
+}  // namespace ndash
+
+#endif  // NDASH_UPSTREAM_NETWORK_TRACE_H_
@@ -0,0 +1,138 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "upstream/network_trace.h"
+
+#include <string>
+
+#include "base/files/file_util.h"
+#include "base/files/scoped_temp_dir.h"
+#include "gtest/gtest.h"
+#include "upstream/constants.h"
+#include "upstream/data_spec.h"
+#include "upstream/uri.h"
+
+namespace ndash {
+namespace upstream {
+
+namespace {
+NetworkTrace::Transfer MakeTransfer(const DataSpec& data_spec,
+                                    const std::string& data) {
+  NetworkTrace::Transfer transfer;
+  transfer.key = NetworkTrace::KeyOf(data_spec);
+  transfer.open_result = data.size();
+  transfer.open_time = base::TimeDelta::FromMilliseconds(30);
+  transfer.response_code = 206;
+  transfer.response_headers.emplace("content-type", "video/mp4");
+  transfer.read_results.push_back(data.size());
+  transfer.read_times.push_back(base::TimeDelta::FromMilliseconds(45));
+  transfer.read_results.push_back(RESULT_END_OF_INPUT);
+  transfer.read_times.push_back(base::TimeDelta::FromMilliseconds(46));
+  transfer.data = data;
+  return transfer;
+}
+}  // namespace
+
+TEST(NetworkTraceTest, RecordsAndLoads) {
+  base::ScopedTempDir dir;
+  ASSERT_TRUE(dir.CreateUniqueTempDir());
+  base::FilePath path = dir.path().Append("trace");
+  const DataSpec manifest(Uri("http://cdn.example/manifest.mpd"));
+  const DataSpec segment(Uri("http://cdn.example/video.mp4"), 1000, 500,
+                         nullptr);
+
+  {
+    NetworkTrace trace;
+    EXPECT_FALSE(trace.recording());
+    ASSERT_TRUE(trace.StartRecording(path));
+    EXPECT_TRUE(trace.recording());
+    trace.Add(MakeTransfer(manifest, "<MPD v1/>"));
+    trace.Add(MakeTransfer(segment, std::string(500, 'v')));
+    trace.Add(MakeTransfer(manifest, "<MPD v2/>"));
+  }
+
+  NetworkTrace trace;
+  ASSERT_TRUE(trace.Load(path));
+  EXPECT_FALSE(trace.recording());
+
+  // Another range of the same URI is another request.
+  EXPECT_FALSE(trace.Take(
+      DataSpec(Uri("http://cdn.example/video.mp4"), 0, 500, nullptr)));
+
+  std::unique_ptr<NetworkTrace::Transfer> transfer = trace.Take(segment);
+  ASSERT_TRUE(transfer);
+  EXPECT_EQ(500, transfer->open_result);
+  EXPECT_EQ(base::TimeDelta::FromMilliseconds(30), transfer->open_time);
+  EXPECT_EQ(206, transfer->response_code);
+  EXPECT_EQ(HTTP_OK, transfer->http_error);
+  ASSERT_EQ(1u, transfer->response_headers.size());
+  EXPECT_EQ("video/mp4", transfer->response_headers.begin()->second);
+  ASSERT_EQ(2u, transfer->read_results.size());
+  EXPECT_EQ(500, transfer->read_results[0]);
+  EXPECT_EQ(RESULT_END_OF_INPUT, transfer->read_results[1]);
+  EXPECT_EQ(base::TimeDelta::FromMilliseconds(46), transfer->read_times[1]);
+  EXPECT_EQ(std::string(500, 'v'), transfer->data);
+  EXPECT_FALSE(trace.Take(segment));
+
+  // Repeated requests come back in the order they were made.
+  transfer = trace.Take(manifest);
+  ASSERT_TRUE(transfer);
+  EXPECT_EQ("<MPD v1/>", transfer->data);
+  transfer = trace.Take(manifest);
+  ASSERT_TRUE(transfer);
+  EXPECT_EQ("<MPD v2/>", transfer->data);
+  EXPECT_FALSE(trace.Take(manifest));
+}
+
+TEST(NetworkTraceTest, LoadsTruncated) {
+  base::ScopedTempDir dir;
+  ASSERT_TRUE(dir.CreateUniqueTempDir());
+  base::FilePath path = dir.path().Append("trace");
+  const DataSpec first(Uri("http://cdn.example/1.mp4"));
+  const DataSpec second(Uri("http://cdn.example/2.mp4"));
+
+  {
+    NetworkTrace trace;
+    ASSERT_TRUE(trace.StartRecording(path));
+    trace.Add(MakeTransfer(first, "first"));
+    trace.Add(MakeTransfer(second, "second"));
+  }
+  std::string contents;
+  ASSERT_TRUE(base::ReadFileToString(path, &contents));
+  ASSERT_EQ(static_cast<int>(contents.size() - 10),
+            base::WriteFile(path, contents.data(), contents.size() - 10));
+
+  NetworkTrace trace;
+  ASSERT_TRUE(trace.Load(path));
+  EXPECT_TRUE(trace.Take(first));
+  EXPECT_FALSE(trace.Take(second));
+}
+
+TEST(NetworkTraceTest, RejectsBadFile) {
+  base::ScopedTempDir dir;
+  ASSERT_TRUE(dir.CreateUniqueTempDir());
+  base::FilePath path = dir.path().Append("trace");
+
+  NetworkTrace trace;
+  EXPECT_FALSE(trace.Load(path));
+  const char garbage[] = "not a trace";
+  ASSERT_EQ(static_cast<int>(sizeof(garbage)),
+            base::WriteFile(path, garbage, sizeof(garbage)));
+  EXPECT_FALSE(trace.Load(path));
+}
+
+}  // namespace upstream
+}  // namespace ndash
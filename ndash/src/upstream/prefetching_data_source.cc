@@ -0,0 +1,283 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "upstream/prefetching_data_source.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "base/bind.h"
+#include "base/location.h"
+#include "base/logging.h"
+#include "base/time/time.h"
+#include "upstream/data_spec.h"
+
+namespace ndash {
+namespace upstream {
+
+constexpr size_t PrefetchingDataSource::kDefaultMaxBufferSize;
+
+namespace {
+// How often blocked readers check their cancellation flag.
+const base::TimeDelta kCancelPollInterval =
+    base::TimeDelta::FromMilliseconds(20);
+// Requests that may be opened ahead of the prefetched one before it is
+// considered a bad guess.
+const int kMaxPassedOver = 1;
+const size_t kFetchReadSize = 64 * 1024;
+
+bool SameRequest(const DataSpec& a, const DataSpec& b) {
+  return a.uri.uri() == b.uri.uri() &&
+         a.absolute_stream_position == b.absolute_stream_position &&
+         a.position == b.position && a.length == b.length &&
+         a.flags == b.flags && !a.post_body && !b.post_body;
+}
+}  // namespace
+
+PrefetchingDataSource::PrefetchingDataSource(
+    DataSourceInterface* upstream,
+    std::unique_ptr<DataSourceInterface> prefetch_source,
+    scoped_refptr<base::TaskRunner> task_runner,
+    size_t max_buffer_size)
+    : upstream_(upstream),
+      prefetch_source_(std::move(prefetch_source)),
+      task_runner_(task_runner),
+      max_buffer_size_(max_buffer_size),
+      fetch_idle_(true, true),
+      changed_(&lock_) {
+  DCHECK(upstream_);
+  DCHECK(prefetch_source_);
+  DCHECK(task_runner_);
+}
+
+PrefetchingDataSource::~PrefetchingDataSource() {
+  {
+    base::AutoLock auto_lock(lock_);
+    AbandonPrefetch();
+  }
+  fetch_idle_.Wait();
+}
+
+bool PrefetchingDataSource::Prefetch(const DataSpec& data_spec) {
+  base::AutoLock auto_lock(lock_);
+  if (prefetch_spec_ && SameRequest(*prefetch_spec_, data_spec)) {
+    return true;
+  }
+  if (claimed_ || fetch_cancel_.IsSet()) {
+    return false;
+  }
+  AbandonPrefetch();
+  if (!fetch_idle_.IsSignaled()) {
+    return false;
+  }
+
+  VLOG(2) << "Prefetching " << data_spec.DebugString();
+  prefetch_spec_.reset(new DataSpec(data_spec));
+  passed_over_ = 0;
+  opened_ = false;
+  done_ = false;
+  failed_ = false;
+  length_ = 0;
+  data_.clear();
+  read_pos_ = 0;
+
+  fetch_idle_.Reset();
+  if (!task_runner_->PostTask(FROM_HERE,
+                              base::Bind(&PrefetchingDataSource::Fetch,
+                                         base::Unretained(this)))) {
+    prefetch_spec_.reset();
+    fetch_idle_.Signal();
+    return false;
+  }
+  return true;
+}
+
+void PrefetchingDataSource::Cancel() {
+  fetch_cancel_.Set();
+  base::AutoLock auto_lock(lock_);
+  if (!claimed_) {
+    AbandonPrefetch();
+  }
+}
+
+ssize_t PrefetchingDataSource::Open(const DataSpec& data_spec,
+                                    const base::CancellationFlag* cancel) {
+  DCHECK(!reading_upstream_ && !reading_prefetch_);
+  {
+    base::AutoLock auto_lock(lock_);
+    if (prefetch_spec_ && !claimed_ &&
+        SameRequest(*prefetch_spec_, data_spec)) {
+      claimed_ = true;
+      reading_prefetch_ = true;
+      reader_cancel_ = cancel;
+      while (!opened_ && !failed_) {
+        if (!WaitForChange(cancel)) {
+          return RESULT_IO_ERROR;
+        }
+      }
+      if (opened_) {
+        VLOG(2) << "Using prefetch of " << data_spec.DebugString();
+        return length_;
+      }
+      // Nothing was received, so the request can simply be made again.
+      AbandonPrefetch();
+      reading_prefetch_ = false;
+      reader_cancel_ = nullptr;
+    } else if (prefetch_spec_ && !claimed_ &&
+               ++passed_over_ > kMaxPassedOver) {
+      VLOG(2) << "Abandoning prefetch of " << prefetch_spec_->DebugString();
+      AbandonPrefetch();
+    }
+  }
+
+  reading_upstream_ = true;
+  return upstream_->Open(data_spec, cancel);
+}
+
+void PrefetchingDataSource::Close() {
+  if (reading_upstream_) {
+    upstream_->Close();
+    reading_upstream_ = false;
+  } else if (reading_prefetch_) {
+    base::AutoLock auto_lock(lock_);
+    AbandonPrefetch();
+    reading_prefetch_ = false;
+    reader_cancel_ = nullptr;
+  }
+}
+
+ssize_t PrefetchingDataSource::Read(void* buffer, size_t read_length) {
+  if (reading_upstream_) {
+    return upstream_->Read(buffer, read_length);
+  }
+  DCHECK(reading_prefetch_);
+
+  base::AutoLock auto_lock(lock_);
+  while (read_pos_ == data_.size() && !done_) {
+    if (!WaitForChange(reader_cancel_)) {
+      return RESULT_IO_ERROR;
+    }
+  }
+  if (read_pos_ < data_.size()) {
+    size_t count = std::min(read_length, data_.size() - read_pos_);
+    memcpy(buffer, data_.data() + read_pos_, count);
+    read_pos_ += count;
+    if (read_pos_ == data_.size()) {
+      data_.clear();
+      read_pos_ = 0;
+      // Let a prefetch waiting for room carry on.
+      changed_.Broadcast();
+    }
+    return count;
+  }
+  return failed_ ? RESULT_IO_ERROR : RESULT_END_OF_INPUT;
+}
+
+bool PrefetchingDataSource::CanReadView() const {
+  return reading_upstream_ && upstream_->CanReadView();
+}
+
+ssize_t PrefetchingDataSource::ReadView(const void** data, size_t max_length) {
+  DCHECK(reading_upstream_);
+  return upstream_->ReadView(data, max_length);
+}
+
+void PrefetchingDataSource::Fetch() {
+  // An abandoned prefetch is noticed whenever the transfer makes progress.
+  // Only Cancel() stops the transfer outright: flags may only be set on the
+  // thread that made them, and abandoning happens on several.
+  std::unique_ptr<DataSpec> data_spec;
+  {
+    base::AutoLock auto_lock(lock_);
+    if (prefetch_spec_) {
+      data_spec.reset(new DataSpec(*prefetch_spec_));
+    }
+  }
+
+  bool failed = true;
+  if (data_spec) {
+    ssize_t length = prefetch_source_->Open(*data_spec, &fetch_cancel_);
+    bool abandoned;
+    {
+      base::AutoLock auto_lock(lock_);
+      if (length == RESULT_IO_ERROR) {
+        failed_ = true;
+      } else {
+        opened_ = true;
+        length_ = length;
+      }
+      abandoned = !prefetch_spec_;
+      changed_.Broadcast();
+    }
+
+    if (length != RESULT_IO_ERROR && !abandoned) {
+      std::unique_ptr<char[]> buffer(new char[kFetchReadSize]);
+      while (true) {
+        ssize_t count = prefetch_source_->Read(buffer.get(), kFetchReadSize);
+        if (count == RESULT_END_OF_INPUT) {
+          failed = false;
+          break;
+        }
+        if (count < 0) {
+          break;
+        }
+        base::AutoLock auto_lock(lock_);
+        if (!prefetch_spec_) {
+          break;
+        }
+        data_.append(buffer.get(), count);
+        changed_.Broadcast();
+        // Hold off reading more until the reader has caught up.
+        while (data_.size() >= max_buffer_size_ && prefetch_spec_ &&
+               !fetch_cancel_.IsSet()) {
+          changed_.TimedWait(kCancelPollInterval);
+        }
+        if (!prefetch_spec_) {
+          break;
+        }
+      }
+    }
+    prefetch_source_->Close();
+  }
+
+  {
+    base::AutoLock auto_lock(lock_);
+    done_ = true;
+    failed_ = failed_ || failed;
+    changed_.Broadcast();
+  }
+  fetch_idle_.Signal();
+}
+
+void PrefetchingDataSource::AbandonPrefetch() {
+  lock_.AssertAcquired();
+  if (!prefetch_spec_) {
+    return;
+  }
+  prefetch_spec_.reset();
+  claimed_ = false;
+  data_.clear();
+  read_pos_ = 0;
+}
+
+bool PrefetchingDataSource::WaitForChange(const base::CancellationFlag* cancel) {
+  lock_.AssertAcquired();
+  changed_.TimedWait(kCancelPollInterval);
+  return !cancel || !cancel->IsSet();
+}
+
+}  // namespace upstream
+}  // namespace ndash
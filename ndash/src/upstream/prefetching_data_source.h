@@ -0,0 +1,134 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NDASH_UPSTREAM_PREFETCHING_DATA_SOURCE_H_
+#define NDASH_UPSTREAM_PREFETCHING_DATA_SOURCE_H_
+
+#include <memory>
+#include <string>
+
+#include "base/macros.h"
+#include "base/memory/ref_counted.h"
+#include "base/synchronization/cancellation_flag.h"
+#include "base/synchronization/condition_variable.h"
+#include "base/synchronization/lock.h"
+#include "base/synchronization/waitable_event.h"
+#include "base/task_runner.h"
+#include "upstream/data_source.h"
+
+namespace ndash {
+namespace upstream {
+
+class DataSpec;
+
+// A DataSource that can start fetching a request before it is opened, on a
+// second DataSource of its own. This lets a chunk source overlap a request
+// with the one before it, e.g. the first media segment with its
+// initialization segment.
+//
+// Prefetched data is handed to the reader as it arrives, so a prefetch of a
+// segment that is still being produced (live) is no slower to read than a
+// regular request. Everything that was not prefetched goes to |upstream|.
+class PrefetchingDataSource : public DataSourceInterface {
+ public:
+  // The most prefetched data held for the reader before the prefetch stops
+  // reading from the network to wait for it.
+  static constexpr size_t kDefaultMaxBufferSize = 1048576;  // 1 MB
+
+  // |upstream| serves regular requests and must outlive this object.
+  // Prefetches are made with |prefetch_source|, one at a time, by tasks
+  // posted to |task_runner|, and buffer up to |max_buffer_size| bytes.
+  PrefetchingDataSource(DataSourceInterface* upstream,
+                        std::unique_ptr<DataSourceInterface> prefetch_source,
+                        scoped_refptr<base::TaskRunner> task_runner,
+                        size_t max_buffer_size = kDefaultMaxBufferSize);
+  ~PrefetchingDataSource() override;
+
+  // Starts fetching |data_spec| in the background. It is meant for the
+  // request after the one about to be opened: a prefetch that is passed over
+  // by two other requests is abandoned, as is one replaced by a later
+  // Prefetch(). Returns false if the previous prefetch is still being read
+  // or has not finished unwinding.
+  //
+  // May be called from any thread.
+  bool Prefetch(const DataSpec& data_spec);
+
+  // Stops any prefetch, including one still waiting on the network, and
+  // refuses new ones, so that destroying this object doesn't wait for the
+  // transfer. Must be called on the thread that created this object.
+  void Cancel();
+
+  // DataSourceInterface
+  ssize_t Open(const DataSpec& data_spec,
+               const base::CancellationFlag* cancel = nullptr) override;
+  void Close() override;
+  ssize_t Read(void* buffer, size_t read_length) override;
+  // Views are only offered for requests that go to |upstream|.
+  bool CanReadView() const override;
+  ssize_t ReadView(const void** data, size_t max_length) override;
+
+ private:
+  // Runs on |task_runner_|.
+  void Fetch();
+
+  // Stops the prefetch (if any) and forgets about it. Must be called with
+  // |lock_| held.
+  void AbandonPrefetch();
+
+  // Waits for |changed_| up to a short interval so that |cancel| is polled.
+  // Returns false if |cancel| is set. Must be called with |lock_| held.
+  bool WaitForChange(const base::CancellationFlag* cancel);
+
+  DataSourceInterface* const upstream_;
+  const std::unique_ptr<DataSourceInterface> prefetch_source_;
+  const scoped_refptr<base::TaskRunner> task_runner_;
+  const size_t max_buffer_size_;
+
+  // Set by Cancel() to stop a prefetch that is waiting on the network.
+  base::CancellationFlag fetch_cancel_;
+
+  // Signaled while no Fetch() task is queued or running.
+  base::WaitableEvent fetch_idle_;
+
+  // Only touched by the reader (Open/Read/Close).
+  bool reading_upstream_ = false;
+  bool reading_prefetch_ = false;
+  const base::CancellationFlag* reader_cancel_ = nullptr;
+
+  base::Lock lock_;
+  base::ConditionVariable changed_;
+  // Everything below is protected by |lock_|.
+  // The request being prefetched, or null once it has been abandoned.
+  std::unique_ptr<DataSpec> prefetch_spec_;
+  // Number of other requests opened since the prefetch started.
+  int passed_over_ = 0;
+  // Set once the reader has opened the prefetched request.
+  bool claimed_ = false;
+  bool opened_ = false;
+  bool done_ = false;
+  bool failed_ = false;
+  ssize_t length_ = 0;
+  // Received data; the reader has consumed the first |read_pos_| bytes.
+  std::string data_;
+  size_t read_pos_ = 0;
+
+  DISALLOW_COPY_AND_ASSIGN(PrefetchingDataSource);
+};
+
+}  // namespace upstream
+}  // namespace ndash
+
+#endif  // NDASH_UPSTREAM_PREFETCHING_DATA_SOURCE_H_
@@ -0,0 +1,283 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "upstream/prefetching_data_source.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+#include "base/bind.h"
+#include "base/location.h"
+#include "base/synchronization/lock.h"
+#include "base/synchronization/waitable_event.h"
+#include "base/threading/platform_thread.h"
+#include "base/threading/thread.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "upstream/data_source_mock.h"
+#include "upstream/data_spec.h"
+
+namespace ndash {
+namespace upstream {
+
+using ::testing::_;
+using ::testing::Return;
+
+namespace {
+
+// Serves |body| for any request. Until Release() is called it returns only
+// the first |held_at| bytes, then blocks, as if the rest were still on the
+// network.
+class FakeDataSource : public DataSourceInterface {
+ public:
+  FakeDataSource(const std::string& body, size_t held_at)
+      : body_(body),
+        held_at_(held_at),
+        released_(true, held_at >= body.size()),
+        opened_(false, false) {}
+
+  ssize_t Open(const DataSpec& data_spec,
+               const base::CancellationFlag* cancel) override {
+    opens_++;
+    last_uri_ = data_spec.uri.uri();
+    cancel_ = cancel;
+    pos_ = 0;
+    opened_.Signal();
+    return fail_open_ ? RESULT_IO_ERROR : body_.size();
+  }
+  void Close() override {}
+  ssize_t Read(void* buffer, size_t read_length) override {
+    if (pos_ == held_at_) {
+      while (!released_.TimedWait(base::TimeDelta::FromMilliseconds(5))) {
+        if (cancel_ && cancel_->IsSet()) {
+          return RESULT_IO_ERROR;
+        }
+      }
+    }
+    if (pos_ == body_.size()) {
+      return RESULT_END_OF_INPUT;
+    }
+    size_t end = pos_ < held_at_ ? held_at_ : body_.size();
+    size_t count = std::min(read_length, end - pos_);
+    memcpy(buffer, body_.data() + pos_, count);
+    base::AutoLock auto_lock(pos_lock_);
+    pos_ += count;
+    return count;
+  }
+
+  void Release() { released_.Signal(); }
+  size_t position() const {
+    base::AutoLock auto_lock(pos_lock_);
+    return pos_;
+  }
+  void WaitForOpen() { opened_.Wait(); }
+  void set_fail_open(bool fail) { fail_open_ = fail; }
+  int opens() const { return opens_; }
+  const std::string& last_uri() const { return last_uri_; }
+
+ private:
+  const std::string body_;
+  const size_t held_at_;
+  base::WaitableEvent released_;
+  base::WaitableEvent opened_;
+  const base::CancellationFlag* cancel_ = nullptr;
+  mutable base::Lock pos_lock_;
+  size_t pos_ = 0;
+  bool fail_open_ = false;
+  int opens_ = 0;
+  std::string last_uri_;
+};
+
+DataSpec SpecFor(const std::string& uri) {
+  return DataSpec(Uri(uri), 0, LENGTH_UNBOUNDED, nullptr);
+}
+
+std::string ReadAll(DataSourceInterface* source) {
+  std::string out;
+  char buffer[7];
+  while (true) {
+    ssize_t count = source->Read(buffer, sizeof(buffer));
+    if (count < 0) {
+      EXPECT_EQ(RESULT_END_OF_INPUT, count);
+      break;
+    }
+    out.append(buffer, count);
+  }
+  return out;
+}
+
+class PrefetchingDataSourceTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    ASSERT_TRUE(thread_.Start());
+  }
+
+  void Create(const std::string& body,
+              size_t held_at,
+              size_t max_buffer_size =
+                  PrefetchingDataSource::kDefaultMaxBufferSize) {
+    fake_ = new FakeDataSource(body, held_at);
+    source_.reset(new PrefetchingDataSource(
+        &upstream_, std::unique_ptr<DataSourceInterface>(fake_),
+        thread_.task_runner(), max_buffer_size));
+  }
+
+  base::Thread thread_{"prefetch"};
+  MockDataSource upstream_;
+  FakeDataSource* fake_ = nullptr;
+  std::unique_ptr<PrefetchingDataSource> source_;
+};
+
+}  // namespace
+
+TEST_F(PrefetchingDataSourceTest, ServesPrefetchedRequest) {
+  Create("media segment body", 5);
+  EXPECT_CALL(upstream_, Open(_, _)).Times(0);
+
+  ASSERT_TRUE(source_->Prefetch(SpecFor("http://a/seg1")));
+  fake_->WaitForOpen();
+  EXPECT_EQ(1, fake_->opens());
+  EXPECT_EQ("http://a/seg1", fake_->last_uri());
+
+  EXPECT_EQ(18, source_->Open(SpecFor("http://a/seg1")));
+  // The first bytes can be read before the fetch has finished.
+  char buffer[5];
+  EXPECT_EQ(5, source_->Read(buffer, sizeof(buffer)));
+  EXPECT_EQ("media", std::string(buffer, 5));
+  fake_->Release();
+  EXPECT_EQ(" segment body", ReadAll(source_.get()));
+  source_->Close();
+}
+
+TEST_F(PrefetchingDataSourceTest, OtherRequestsGoUpstream) {
+  Create("media", 5);
+  ASSERT_TRUE(source_->Prefetch(SpecFor("http://a/seg1")));
+
+  // The initialization request ahead of the prefetched one.
+  EXPECT_CALL(upstream_, Open(_, _)).WillOnce(Return(4));
+  EXPECT_CALL(upstream_, Read(_, _)).WillOnce(Return(RESULT_END_OF_INPUT));
+  EXPECT_CALL(upstream_, Close());
+  EXPECT_EQ(4, source_->Open(SpecFor("http://a/init")));
+  char buffer[4];
+  EXPECT_EQ(RESULT_END_OF_INPUT, source_->Read(buffer, sizeof(buffer)));
+  source_->Close();
+
+  EXPECT_EQ(5, source_->Open(SpecFor("http://a/seg1")));
+  EXPECT_EQ("media", ReadAll(source_.get()));
+  source_->Close();
+  EXPECT_EQ(1, fake_->opens());
+}
+
+TEST_F(PrefetchingDataSourceTest, AbandonsPrefetchPassedOver) {
+  Create("media", 5);
+  ASSERT_TRUE(source_->Prefetch(SpecFor("http://a/seg1")));
+
+  EXPECT_CALL(upstream_, Open(_, _)).Times(3).WillRepeatedly(Return(4));
+  EXPECT_CALL(upstream_, Close()).Times(3);
+  source_->Open(SpecFor("http://a/init"));
+  source_->Close();
+  source_->Open(SpecFor("http://a/seg7"));
+  source_->Close();
+  // A seek elsewhere; the guess was wrong and seg1 now goes upstream too.
+  source_->Open(SpecFor("http://a/seg1"));
+  source_->Close();
+}
+
+TEST_F(PrefetchingDataSourceTest, FallsBackWhenPrefetchFails) {
+  Create("media", 5);
+  fake_->set_fail_open(true);
+  ASSERT_TRUE(source_->Prefetch(SpecFor("http://a/seg1")));
+
+  EXPECT_CALL(upstream_, Open(_, _)).WillOnce(Return(5));
+  EXPECT_CALL(upstream_, Close());
+  EXPECT_EQ(5, source_->Open(SpecFor("http://a/seg1")));
+  source_->Close();
+}
+
+TEST_F(PrefetchingDataSourceTest, CancelWhileWaiting) {
+  Create("media segment body", 5);
+  ASSERT_TRUE(source_->Prefetch(SpecFor("http://a/seg1")));
+  fake_->WaitForOpen();
+  base::CancellationFlag cancel;
+  EXPECT_EQ(18, source_->Open(SpecFor("http://a/seg1"), &cancel));
+  char buffer[5];
+  EXPECT_EQ(5, source_->Read(buffer, sizeof(buffer)));
+  cancel.Set();
+  EXPECT_EQ(RESULT_IO_ERROR, source_->Read(buffer, sizeof(buffer)));
+  source_->Close();
+
+  // The abandoned fetch stops when it next makes progress; a new prefetch
+  // can start once it has.
+  fake_->Release();
+  while (!source_->Prefetch(SpecFor("http://a/seg2"))) {
+    base::PlatformThread::Sleep(base::TimeDelta::FromMilliseconds(1));
+  }
+  fake_->WaitForOpen();
+  EXPECT_EQ("http://a/seg2", fake_->last_uri());
+  EXPECT_EQ(18, source_->Open(SpecFor("http://a/seg2")));
+  EXPECT_EQ("media segment body", ReadAll(source_.get()));
+  source_->Close();
+}
+
+TEST_F(PrefetchingDataSourceTest, DestroyWithPrefetchInFlight) {
+  Create("media segment body", 5);
+  ASSERT_TRUE(source_->Prefetch(SpecFor("http://a/seg1")));
+  fake_->WaitForOpen();
+  // The fetch is abandoned as the rest of the body arrives.
+  base::Thread network("network");
+  ASSERT_TRUE(network.Start());
+  ASSERT_TRUE(network.task_runner()->PostDelayedTask(
+      FROM_HERE,
+      base::Bind(&FakeDataSource::Release, base::Unretained(fake_)),
+      base::TimeDelta::FromMilliseconds(20)));
+  source_.reset();
+}
+
+TEST_F(PrefetchingDataSourceTest, CancelStopsPrefetch) {
+  // The rest of the body never arrives; destruction must not wait for it.
+  Create("media segment body", 5);
+  ASSERT_TRUE(source_->Prefetch(SpecFor("http://a/seg1")));
+  fake_->WaitForOpen();
+  source_->Cancel();
+  EXPECT_FALSE(source_->Prefetch(SpecFor("http://a/seg2")));
+  source_.reset();
+}
+
+TEST_F(PrefetchingDataSourceTest, BufferIsBounded) {
+  const size_t kBodySize = 256 * 1024;
+  const size_t kMaxBufferSize = 64 * 1024;
+  std::string body(kBodySize, 'x');
+  for (size_t i = 0; i < kBodySize; i += 1000) {
+    body[i] = 'a' + i % 26;
+  }
+  Create(body, kBodySize, kMaxBufferSize);
+  ASSERT_TRUE(source_->Prefetch(SpecFor("http://a/seg1")));
+  fake_->WaitForOpen();
+
+  // Nobody is reading, so the prefetch stops once the buffer is full.
+  base::PlatformThread::Sleep(base::TimeDelta::FromMilliseconds(50));
+  EXPECT_LE(fake_->position(), kMaxBufferSize);
+
+  EXPECT_EQ(static_cast<ssize_t>(kBodySize),
+            source_->Open(SpecFor("http://a/seg1")));
+  EXPECT_EQ(body, ReadAll(source_.get()));
+  source_->Close();
+  EXPECT_EQ(kBodySize, fake_->position());
+}
+
+}  // namespace upstream
+}  // namespace ndash
@@ -0,0 +1,121 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "upstream/recording_data_source.h"
+
+#include <utility>
+
+#include "base/logging.h"
+#include "upstream/constants.h"
+#include "upstream/data_spec.h"
+
+namespace ndash {
+namespace upstream {
+
+RecordingDataSource::RecordingDataSource(
+    std::unique_ptr<HttpDataSourceInterface> upstream,
+    NetworkTrace* trace)
+    : upstream_(std::move(upstream)), trace_(trace) {}
+
+RecordingDataSource::~RecordingDataSource() {}
+
+ssize_t RecordingDataSource::Open(const DataSpec& data_spec,
+                                  const base::CancellationFlag* cancel) {
+  DCHECK(!transfer_);
+  open_time_ = base::TimeTicks::Now();
+  ssize_t result = upstream_->Open(data_spec, cancel);
+  if (data_spec.post_body) {
+    return result;
+  }
+
+  transfer_.reset(new NetworkTrace::Transfer);
+  transfer_->key = NetworkTrace::KeyOf(data_spec);
+  transfer_->open_result = result;
+  transfer_->open_time = base::TimeTicks::Now() - open_time_;
+  transfer_->response_code = upstream_->GetResponseCode();
+  transfer_->http_error = upstream_->GetHttpError();
+  const std::multimap<std::string, std::string>* headers =
+      upstream_->GetResponseHeaders();
+  if (headers) {
+    transfer_->response_headers = *headers;
+  }
+  return result;
+}
+
+void RecordingDataSource::Close() {
+  upstream_->Close();
+  if (transfer_) {
+    trace_->Add(*transfer_);
+    transfer_.reset();
+  }
+}
+
+ssize_t RecordingDataSource::Read(void* buffer, size_t read_length) {
+  ssize_t result = upstream_->Read(buffer, read_length);
+  if (transfer_) {
+    transfer_->read_results.push_back(result);
+    transfer_->read_times.push_back(base::TimeTicks::Now() - open_time_);
+    if (result > 0) {
+      transfer_->data.append(static_cast<const char*>(buffer), result);
+    }
+  }
+  return result;
+}
+
+const char* RecordingDataSource::GetUri() const {
+  return upstream_->GetUri();
+}
+
+void RecordingDataSource::SetRequestProperty(const std::string& name,
+                                             const std::string& value) {
+  upstream_->SetRequestProperty(name, value);
+}
+
+void RecordingDataSource::ClearRequestProperty(const std::string& name) {
+  upstream_->ClearRequestProperty(name);
+}
+
+void RecordingDataSource::ClearAllRequestProperties() {
+  upstream_->ClearAllRequestProperties();
+}
+
+const std::multimap<std::string, std::string>*
+RecordingDataSource::GetResponseHeaders() const {
+  return upstream_->GetResponseHeaders();
+}
+
+int RecordingDataSource::GetResponseCode() const {
+  return upstream_->GetResponseCode();
+}
+
+HttpDataSourceError RecordingDataSource::GetHttpError() const {
+  return upstream_->GetHttpError();
+}
+
+std::string RecordingDataSource::ReadAllToString(size_t max_length) {
+  std::string data = upstream_->ReadAllToString(max_length);
+  if (transfer_) {
+    transfer_->read_results.push_back(data.size());
+    transfer_->read_times.push_back(base::TimeTicks::Now() - open_time_);
+    transfer_->data.append(data);
+    transfer_->read_results.push_back(RESULT_END_OF_INPUT);
+    transfer_->read_times.push_back(transfer_->read_times.back());
+  }
+  return data;
+}
+
+}  // namespace upstream
+}  // namespace ndash
@@ -0,0 +1,76 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NDASH_UPSTREAM_RECORDING_DATA_SOURCE_H_
+#define NDASH_UPSTREAM_RECORDING_DATA_SOURCE_H_
+
+#include <map>
+#include <memory>
+#include <string>
+
+#include "base/time/time.h"
+#include "upstream/http_data_source.h"
+#include "upstream/network_trace.h"
+
+namespace ndash {
+namespace upstream {
+
+// Passes everything through to |upstream|, adding each request and what it
+// returned to a NetworkTrace being recorded. POST requests (license
+// requests) are not recorded.
+class RecordingDataSource : public HttpDataSourceInterface {
+ public:
+  // |trace| must outlive this object.
+  RecordingDataSource(std::unique_ptr<HttpDataSourceInterface> upstream,
+                      NetworkTrace* trace);
+  ~RecordingDataSource() override;
+
+  // DataSourceInterface
+  ssize_t Open(const DataSpec& data_spec,
+               const base::CancellationFlag* cancel = nullptr) override;
+  void Close() override;
+  ssize_t Read(void* buffer, size_t read_length) override;
+
+  // UriDataSourceInterface
+  const char* GetUri() const override;
+
+  // HttpDataSourceInterface
+  void SetRequestProperty(const std::string& name,
+                          const std::string& value) override;
+  void ClearRequestProperty(const std::string& name) override;
+  void ClearAllRequestProperties() override;
+  const std::multimap<std::string, std::string>* GetResponseHeaders()
+      const override;
+  int GetResponseCode() const override;
+  HttpDataSourceError GetHttpError() const override;
+  std::string ReadAllToString(size_t max_length = 0) override;
+
+  RecordingDataSource(const RecordingDataSource& other) = delete;
+  RecordingDataSource& operator=(const RecordingDataSource& other) = delete;
+
+ private:
+  const std::unique_ptr<HttpDataSourceInterface> upstream_;
+  NetworkTrace* const trace_;
+
+  // The request being recorded, or null.
+  std::unique_ptr<NetworkTrace::Transfer> transfer_;
+  base::TimeTicks open_time_;
+};
+
+}  // namespace upstream
+}  // namespace ndash
+
+#endif  // NDASH_UPSTREAM_RECORDING_DATA_SOURCE_H_
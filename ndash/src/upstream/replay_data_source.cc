@@ -0,0 +1,176 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "upstream/replay_data_source.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "base/logging.h"
+#include "base/threading/platform_thread.h"
+#include "upstream/constants.h"
+#include "upstream/data_spec.h"
+#include "upstream/host_stats.h"
+#include "upstream/transfer_listener.h"
+
+namespace ndash {
+namespace upstream {
+
+namespace {
+// How often a paced wait checks for cancellation.
+constexpr int64_t kCancelCheckIntervalMs = 10;
+}  // namespace
+
+ReplayDataSource::ReplayDataSource(NetworkTrace* trace,
+                                   TransferListenerInterface* listener)
+    : trace_(trace), listener_(listener) {}
+
+ReplayDataSource::~ReplayDataSource() {}
+
+ssize_t ReplayDataSource::Open(const DataSpec& data_spec,
+                               const base::CancellationFlag* cancel) {
+  DCHECK(!transfer_);
+  open_time_ = base::TimeTicks::Now();
+  cancel_ = cancel;
+  uri_ = data_spec.uri.uri();
+  transfer_ = trace_->Take(data_spec);
+  if (!transfer_) {
+    LOG(WARNING) << "Not in network trace: " << data_spec.DebugString();
+    return RESULT_IO_ERROR;
+  }
+  if (!WaitUntil(transfer_->open_time)) {
+    return RESULT_IO_ERROR;
+  }
+  if (transfer_->open_result == RESULT_IO_ERROR && host_stats_) {
+    host_stats_->OnError(uri_);
+  }
+  if (transfer_->open_result != RESULT_IO_ERROR && listener_) {
+    listener_->OnTransferStart();
+    transfer_started_ = true;
+  }
+  return transfer_->open_result;
+}
+
+void ReplayDataSource::Close() {
+  EndTransfer();
+  transfer_.reset();
+  cancel_ = nullptr;
+  read_index_ = 0;
+  read_offset_ = 0;
+  data_pos_ = 0;
+}
+
+ssize_t ReplayDataSource::Read(void* buffer, size_t read_length) {
+  if (!transfer_) {
+    return RESULT_IO_ERROR;
+  }
+  if (read_index_ == transfer_->read_results.size()) {
+    // The recorded request was closed before this.
+    VLOG(1) << "Read past the end of the recording of " << transfer_->key;
+    return RESULT_IO_ERROR;
+  }
+  if (!WaitUntil(transfer_->read_times[read_index_])) {
+    return RESULT_IO_ERROR;
+  }
+
+  int64_t result = transfer_->read_results[read_index_];
+  if (result <= 0) {
+    if (host_stats_ && result == RESULT_END_OF_INPUT) {
+      host_stats_->OnTransfer(uri_, transfer_->data.size(),
+                              transfer_->read_times[read_index_],
+                              transfer_->open_time);
+    } else if (host_stats_ && result == RESULT_IO_ERROR) {
+      host_stats_->OnError(uri_);
+    }
+    read_index_++;
+    if (result != 0) {
+      EndTransfer();
+    }
+    return result;
+  }
+  size_t count =
+      std::min(read_length, static_cast<size_t>(result - read_offset_));
+  DCHECK_LE(data_pos_ + count, transfer_->data.size());
+  memcpy(buffer, transfer_->data.data() + data_pos_, count);
+  data_pos_ += count;
+  read_offset_ += count;
+  if (read_offset_ == result) {
+    read_index_++;
+    read_offset_ = 0;
+  }
+  if (listener_) {
+    listener_->OnBytesTransferred(count);
+  }
+  return count;
+}
+
+const char* ReplayDataSource::GetUri() const {
+  return uri_.c_str();
+}
+
+const std::multimap<std::string, std::string>*
+ReplayDataSource::GetResponseHeaders() const {
+  return transfer_ ? &transfer_->response_headers : nullptr;
+}
+
+int ReplayDataSource::GetResponseCode() const {
+  return transfer_ ? transfer_->response_code : 0;
+}
+
+HttpDataSourceError ReplayDataSource::GetHttpError() const {
+  return transfer_ ? transfer_->http_error : HTTP_IO_ERROR;
+}
+
+std::string ReplayDataSource::ReadAllToString(size_t max_length) {
+  std::string out;
+  char buffer[4096];
+  ssize_t result;
+  while ((result = Read(buffer, sizeof(buffer))) >= 0) {
+    out.append(buffer, result);
+    if (max_length != 0 && out.size() > max_length) {
+      LOG(ERROR) << __FUNCTION__ << " response too large";
+      return std::string();
+    }
+  }
+  return result == RESULT_END_OF_INPUT ? out : std::string();
+}
+
+bool ReplayDataSource::WaitUntil(base::TimeDelta time) {
+  if (!trace_->paced()) {
+    return true;
+  }
+  base::TimeTicks until = open_time_ + time;
+  for (base::TimeTicks now = base::TimeTicks::Now(); now < until;
+       now = base::TimeTicks::Now()) {
+    if (cancel_ && cancel_->IsSet()) {
+      return false;
+    }
+    base::PlatformThread::Sleep(std::min(
+        until - now,
+        base::TimeDelta::FromMilliseconds(kCancelCheckIntervalMs)));
+  }
+  return true;
+}
+
+void ReplayDataSource::EndTransfer() {
+  if (transfer_started_) {
+    listener_->OnTransferEnd();
+    transfer_started_ = false;
+  }
+}
+
+}  // namespace upstream
+}  // namespace ndash
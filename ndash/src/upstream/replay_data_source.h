@@ -0,0 +1,101 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NDASH_UPSTREAM_REPLAY_DATA_SOURCE_H_
+#define NDASH_UPSTREAM_REPLAY_DATA_SOURCE_H_
+
+#include <map>
+#include <memory>
+#include <string>
+
+#include "base/time/time.h"
+#include "upstream/http_data_source.h"
+#include "upstream/network_trace.h"
+
+namespace ndash {
+namespace upstream {
+
+class HostStats;
+class TransferListenerInterface;
+
+// Serves requests from a loaded NetworkTrace instead of the network. Each
+// Open() and Read() returns what it did when recorded and, if the trace is
+// paced, only once as much time has passed since Open() as did then, so a
+// bandwidth meter given as |listener| makes the same estimates. Requests
+// that weren't recorded (or were recorded fewer times) fail.
+class ReplayDataSource : public HttpDataSourceInterface {
+ public:
+  // |trace| must outlive this object. |listener| may be null.
+  ReplayDataSource(NetworkTrace* trace, TransferListenerInterface* listener);
+  ~ReplayDataSource() override;
+
+  // Reports each replayed transfer to |host_stats| (nullptr for none) with
+  // the timings it was recorded with: the time to open as the time to first
+  // byte, and the time to the end of input as the total. This is what the
+  // recorded source saw too, as long as the reader kept up with it. Recorded
+  // failures are reported as errors. Must be called before the first Open().
+  void SetHostStats(HostStats* host_stats) { host_stats_ = host_stats; }
+
+  // DataSourceInterface
+  ssize_t Open(const DataSpec& data_spec,
+               const base::CancellationFlag* cancel = nullptr) override;
+  void Close() override;
+  ssize_t Read(void* buffer, size_t read_length) override;
+
+  // UriDataSourceInterface
+  const char* GetUri() const override;
+
+  // HttpDataSourceInterface
+  void SetRequestProperty(const std::string& name,
+                          const std::string& value) override {}
+  void ClearRequestProperty(const std::string& name) override {}
+  void ClearAllRequestProperties() override {}
+  const std::multimap<std::string, std::string>* GetResponseHeaders()
+      const override;
+  int GetResponseCode() const override;
+  HttpDataSourceError GetHttpError() const override;
+  std::string ReadAllToString(size_t max_length = 0) override;
+
+  ReplayDataSource(const ReplayDataSource& other) = delete;
+  ReplayDataSource& operator=(const ReplayDataSource& other) = delete;
+
+ private:
+  // Waits until |time| after Open() was called, if the trace is paced.
+  // Returns false if canceled first.
+  bool WaitUntil(base::TimeDelta time);
+  void EndTransfer();
+
+  NetworkTrace* const trace_;
+  TransferListenerInterface* const listener_;
+  HostStats* host_stats_ = nullptr;
+
+  // The request being replayed, or null.
+  std::unique_ptr<NetworkTrace::Transfer> transfer_;
+  std::string uri_;
+  const base::CancellationFlag* cancel_ = nullptr;
+  base::TimeTicks open_time_;
+  bool transfer_started_ = false;
+  // The next recorded read, how much of it has been returned, and where its
+  // bytes start in the transfer's data.
+  size_t read_index_ = 0;
+  int64_t read_offset_ = 0;
+  size_t data_pos_ = 0;
+};
+
+}  // namespace upstream
+}  // namespace ndash
+
+#endif  // NDASH_UPSTREAM_REPLAY_DATA_SOURCE_H_
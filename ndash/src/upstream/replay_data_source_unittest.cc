@@ -0,0 +1,176 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "upstream/replay_data_source.h"
+
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+
+#include "base/files/scoped_temp_dir.h"
+#include "base/threading/platform_thread.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "upstream/constants.h"
+#include "upstream/data_spec.h"
+#include "upstream/http_data_source_mock.h"
+#include "upstream/network_trace.h"
+#include "upstream/recording_data_source.h"
+#include "upstream/transfer_listener_mock.h"
+#include "upstream/uri.h"
+
+namespace ndash {
+namespace upstream {
+
+using ::testing::_;
+using ::testing::Invoke;
+using ::testing::InSequence;
+using ::testing::Return;
+using ::testing::StrictMock;
+
+namespace {
+const char kBody[] = "0123456789abcdefghij";
+constexpr int64_t kReadDelayMs = 50;
+
+// Records a request of |data_spec| whose body arrives in two halves, the
+// second kReadDelayMs after the first.
+void Record(NetworkTrace* trace, const DataSpec& data_spec) {
+  std::unique_ptr<MockHttpDataSource> upstream(new MockHttpDataSource);
+  const std::multimap<std::string, std::string> headers{
+      {"content-type", "video/mp4"}};
+  const size_t half = strlen(kBody) / 2;
+  {
+    InSequence sequence;
+    EXPECT_CALL(*upstream, Open(_, _)).WillOnce(Return(strlen(kBody)));
+    EXPECT_CALL(*upstream, Read(_, _))
+        .WillOnce(Invoke([half](void* buffer, size_t length) {
+          memcpy(buffer, kBody, half);
+          return half;
+        }))
+        .WillOnce(Invoke([half](void* buffer, size_t length) {
+          base::PlatformThread::Sleep(
+              base::TimeDelta::FromMilliseconds(kReadDelayMs));
+          memcpy(buffer, kBody + half, half);
+          return half;
+        }))
+        .WillOnce(Return(RESULT_END_OF_INPUT));
+    EXPECT_CALL(*upstream, Close());
+  }
+  EXPECT_CALL(*upstream, GetResponseCode()).WillRepeatedly(Return(200));
+  EXPECT_CALL(*upstream, GetHttpError()).WillRepeatedly(Return(HTTP_OK));
+  EXPECT_CALL(*upstream, GetResponseHeaders())
+      .WillRepeatedly(Return(&headers));
+
+  RecordingDataSource recording(std::move(upstream), trace);
+  char buffer[64];
+  ASSERT_EQ(static_cast<ssize_t>(strlen(kBody)), recording.Open(data_spec));
+  EXPECT_EQ(200, recording.GetResponseCode());
+  ssize_t result;
+  std::string body;
+  while ((result = recording.Read(buffer, sizeof(buffer))) > 0) {
+    body.append(buffer, result);
+  }
+  EXPECT_EQ(RESULT_END_OF_INPUT, result);
+  EXPECT_EQ(kBody, body);
+  recording.Close();
+}
+}  // namespace
+
+class ReplayDataSourceTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    ASSERT_TRUE(dir_.CreateUniqueTempDir());
+    base::FilePath path = dir_.path().Append("trace");
+    {
+      NetworkTrace recording;
+      ASSERT_TRUE(recording.StartRecording(path));
+      Record(&recording, segment_);
+    }
+    ASSERT_TRUE(trace_.Load(path));
+  }
+
+  base::ScopedTempDir dir_;
+  const DataSpec segment_{Uri("http://cdn.example/video.mp4"), 100,
+                          static_cast<int64_t>(strlen(kBody)), nullptr};
+  NetworkTrace trace_;
+};
+
+TEST_F(ReplayDataSourceTest, ReplaysAsFastAsPossible) {
+  trace_.set_paced(false);
+  StrictMock<MockTransferListener> listener;
+  ReplayDataSource replay(&trace_, &listener);
+
+  {
+    InSequence sequence;
+    EXPECT_CALL(listener, OnTransferStart());
+    // Reads smaller than recorded split the pieces.
+    EXPECT_CALL(listener, OnBytesTransferred(4)).Times(2);
+    EXPECT_CALL(listener, OnBytesTransferred(2));
+    EXPECT_CALL(listener, OnBytesTransferred(4)).Times(2);
+    EXPECT_CALL(listener, OnBytesTransferred(2));
+    EXPECT_CALL(listener, OnTransferEnd());
+  }
+
+  ASSERT_EQ(static_cast<ssize_t>(strlen(kBody)), replay.Open(segment_));
+  EXPECT_EQ(200, replay.GetResponseCode());
+  EXPECT_EQ(HTTP_OK, replay.GetHttpError());
+  ASSERT_TRUE(replay.GetResponseHeaders());
+  EXPECT_EQ(1u, replay.GetResponseHeaders()->count("content-type"));
+  EXPECT_STREQ("http://cdn.example/video.mp4", replay.GetUri());
+
+  char buffer[4];
+  ssize_t result;
+  std::string body;
+  while ((result = replay.Read(buffer, sizeof(buffer))) > 0) {
+    body.append(buffer, result);
+  }
+  EXPECT_EQ(RESULT_END_OF_INPUT, result);
+  EXPECT_EQ(kBody, body);
+  replay.Close();
+
+  // It was only requested once.
+  EXPECT_EQ(RESULT_IO_ERROR, replay.Open(segment_));
+  replay.Close();
+}
+
+TEST_F(ReplayDataSourceTest, ReplaysWithRecordedTiming) {
+  ReplayDataSource replay(&trace_, nullptr);
+
+  base::TimeTicks start = base::TimeTicks::Now();
+  ASSERT_EQ(static_cast<ssize_t>(strlen(kBody)), replay.Open(segment_));
+  EXPECT_EQ(replay.ReadAllToString(), kBody);
+  EXPECT_GE(base::TimeTicks::Now() - start,
+            base::TimeDelta::FromMilliseconds(kReadDelayMs));
+  replay.Close();
+}
+
+TEST_F(ReplayDataSourceTest, CanceledWhileWaiting) {
+  ReplayDataSource replay(&trace_, nullptr);
+  base::CancellationFlag cancel;
+
+  ASSERT_EQ(static_cast<ssize_t>(strlen(kBody)),
+            replay.Open(segment_, &cancel));
+  char buffer[64];
+  EXPECT_EQ(static_cast<ssize_t>(strlen(kBody) / 2),
+            replay.Read(buffer, sizeof(buffer)));
+  cancel.Set();
+  EXPECT_EQ(RESULT_IO_ERROR, replay.Read(buffer, sizeof(buffer)));
+  replay.Close();
+}
+
+}  // namespace upstream
+}  // namespace ndash
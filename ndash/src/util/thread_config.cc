@@ -0,0 +1,305 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "util/thread_config.h"
+
+#include <errno.h>
+#include <sched.h>
+#include <sys/resource.h>
+
+#include <vector>
+
+#include "base/lazy_instance.h"
+#include "base/logging.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/string_split.h"
+#include "base/strings/string_util.h"
+#include "base/threading/thread.h"
+
+namespace ndash {
+namespace util {
+
+namespace {
+base::LazyInstance<ThreadConfig>::Leaky g_config = LAZY_INSTANCE_INITIALIZER;
+
+constexpr int kMinNice = -20;
+constexpr int kMaxNice = 19;
+
+bool ParsePolicy(const std::string& name, int* policy) {
+  static const struct {
+    const char* name;
+    int policy;
+  } kPolicies[] = {
+      {"other", SCHED_OTHER}, {"batch", SCHED_BATCH}, {"idle", SCHED_IDLE},
+      {"fifo", SCHED_FIFO},   {"rr", SCHED_RR},
+  };
+  for (const auto& entry : kPolicies) {
+    if (name == entry.name) {
+      *policy = entry.policy;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool ParseSize(const std::string& value, size_t* size) {
+  size_t multiplier = 1;
+  std::string digits = value;
+  if (!digits.empty()) {
+    char suffix = base::ToLowerASCII(digits.back());
+    if (suffix == 'k' || suffix == 'm') {
+      multiplier = suffix == 'k' ? 1024 : 1024 * 1024;
+      digits.pop_back();
+    }
+  }
+  if (!base::StringToSizeT(digits, size)) {
+    return false;
+  }
+  *size *= multiplier;
+  return true;
+}
+
+bool IsRealTime(int policy) {
+  return policy == SCHED_FIFO || policy == SCHED_RR;
+}
+}  // namespace
+
+bool ParseThreadRole(const std::string& name, ThreadRole* role) {
+  if (name == "control") {
+    *role = ThreadRole::CONTROL;
+  } else if (name == "loader") {
+    *role = ThreadRole::LOADER;
+  } else if (name == "network") {
+    *role = ThreadRole::NETWORK;
+  } else if (name == "drm") {
+    *role = ThreadRole::DRM;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+bool ParseThreadOptions(const std::string& spec, ThreadOptions* options) {
+  ThreadOptions parsed;
+  bool has_priority = false;
+  for (const std::string& setting : base::SplitString(
+           spec, ",", base::TRIM_WHITESPACE, base::SPLIT_WANT_NONEMPTY)) {
+    size_t equals = setting.find('=');
+    if (equals == std::string::npos) {
+      LOG(WARNING) << "Bad thread setting " << setting;
+      return false;
+    }
+    std::string name = setting.substr(0, equals);
+    std::string value = setting.substr(equals + 1);
+    bool ok;
+    if (name == "policy") {
+      ok = parsed.has_policy = ParsePolicy(value, &parsed.policy);
+    } else if (name == "priority") {
+      ok = has_priority = base::StringToInt(value, &parsed.sched_priority) &&
+                          parsed.sched_priority >= 1 &&
+                          parsed.sched_priority <= 99;
+    } else if (name == "nice") {
+      ok = parsed.has_nice = base::StringToInt(value, &parsed.nice) &&
+                             parsed.nice >= kMinNice && parsed.nice <= kMaxNice;
+    } else if (name == "affinity") {
+      ok = base::StartsWith(value, "0x", base::CompareCase::INSENSITIVE_ASCII)
+               ? base::HexStringToUInt64(value, &parsed.affinity_mask)
+               : base::StringToUint64(value, &parsed.affinity_mask);
+    } else if (name == "stack") {
+      ok = ParseSize(value, &parsed.stack_size);
+    } else {
+      ok = false;
+    }
+    if (!ok) {
+      LOG(WARNING) << "Bad thread setting " << setting;
+      return false;
+    }
+  }
+  if (has_priority && !(parsed.has_policy && IsRealTime(parsed.policy))) {
+    LOG(WARNING) << "A thread priority needs policy=fifo or policy=rr";
+    return false;
+  }
+  if (parsed.has_policy && IsRealTime(parsed.policy) && !has_priority) {
+    parsed.sched_priority = 1;
+  }
+  *options = parsed;
+  return true;
+}
+
+ThreadOptions GetThreadOptions(base::PlatformThreadId tid) {
+  ThreadOptions options;
+  int policy = sched_getscheduler(tid);
+  struct sched_param param = {};
+  if (policy >= 0 && sched_getparam(tid, &param) == 0) {
+    options.has_policy = true;
+    // Drop SCHED_RESET_ON_FORK, which may be or'ed in.
+    options.policy = policy & ~SCHED_RESET_ON_FORK;
+    options.sched_priority = param.sched_priority;
+  } else {
+    PLOG(WARNING) << "Couldn't get scheduling policy of thread " << tid;
+  }
+  // -1 is a valid nice value, so errors only show in errno.
+  errno = 0;
+  int nice = getpriority(PRIO_PROCESS, tid);
+  if (errno == 0) {
+    options.has_nice = true;
+    options.nice = nice;
+  } else {
+    PLOG(WARNING) << "Couldn't get nice of thread " << tid;
+  }
+  cpu_set_t cpus;
+  if (sched_getaffinity(tid, sizeof(cpus), &cpus) == 0) {
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+      if (!CPU_ISSET(cpu, &cpus)) {
+        continue;
+      }
+      if (cpu >= 64) {
+        options.affinity_mask = 0;
+        break;
+      }
+      options.affinity_mask |= 1ull << cpu;
+    }
+  } else {
+    PLOG(WARNING) << "Couldn't get affinity of thread " << tid;
+  }
+  return options;
+}
+
+bool ApplyThreadOptions(const ThreadOptions& options,
+                        base::PlatformThreadId tid,
+                        const ThreadOptions* reset_to) {
+  ThreadOptions target = options;
+  if (reset_to) {
+    if (!target.has_policy && reset_to->has_policy) {
+      target.has_policy = true;
+      target.policy = reset_to->policy;
+      target.sched_priority = reset_to->sched_priority;
+    }
+    if (!target.has_nice && reset_to->has_nice) {
+      target.has_nice = true;
+      target.nice = reset_to->nice;
+    }
+    if (!target.affinity_mask) {
+      target.affinity_mask = reset_to->affinity_mask;
+    }
+  }
+
+  bool ok = true;
+  if (target.has_policy) {
+    struct sched_param param = {};
+    param.sched_priority = target.sched_priority;
+    if (sched_setscheduler(tid, target.policy, &param) != 0) {
+      PLOG(WARNING) << "Couldn't set scheduling policy " << target.policy
+                    << " of thread " << tid;
+      ok = false;
+    }
+  }
+  // The nice value is per thread on Linux.
+  if (target.has_nice) {
+    if (setpriority(PRIO_PROCESS, tid, target.nice) != 0) {
+      PLOG(WARNING) << "Couldn't set nice " << target.nice << " of thread "
+                    << tid;
+      ok = false;
+    }
+  }
+  // Without a mask, only a reset needs to allow every CPU again.
+  if (target.affinity_mask || reset_to) {
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+      if (!target.affinity_mask ||
+          (cpu < 64 && (target.affinity_mask & (1ull << cpu)))) {
+        CPU_SET(cpu, &cpus);
+      }
+    }
+    if (sched_setaffinity(tid, sizeof(cpus), &cpus) != 0) {
+      PLOG(WARNING) << "Couldn't set affinity 0x" << std::hex
+                    << target.affinity_mask << std::dec << " of thread "
+                    << tid;
+      ok = false;
+    }
+  }
+  return ok;
+}
+
+// static
+ThreadConfig* ThreadConfig::GetInstance() {
+  return g_config.Pointer();
+}
+
+ThreadConfig::ThreadConfig() {}
+
+ThreadConfig::ThreadConfig(const ThreadConfig* fallback)
+    : fallback_(fallback) {}
+
+ThreadConfig::~ThreadConfig() {}
+
+void ThreadConfig::Set(ThreadRole role, const ThreadOptions& options) {
+  base::AutoLock auto_lock(lock_);
+  options_[role] = options;
+}
+
+bool ThreadConfig::Set(const std::string& role_name,
+                       const std::string& spec,
+                       ThreadRole* role) {
+  ThreadOptions options;
+  if (!ParseThreadRole(role_name, role)) {
+    LOG(WARNING) << "Unknown thread role " << role_name;
+    return false;
+  }
+  if (!ParseThreadOptions(spec, &options)) {
+    return false;
+  }
+  Set(*role, options);
+  return true;
+}
+
+ThreadOptions ThreadConfig::Get(ThreadRole role) const {
+  {
+    base::AutoLock auto_lock(lock_);
+    auto it = options_.find(role);
+    if (it != options_.end()) {
+      return it->second;
+    }
+  }
+  return fallback_ ? fallback_->Get(role) : ThreadOptions();
+}
+
+bool ThreadConfig::StartThread(ThreadRole role,
+                               base::Thread* thread,
+                               ThreadOptions* inherited) const {
+  ThreadOptions options = Get(role);
+  base::Thread::Options thread_options;
+  thread_options.stack_size = options.stack_size;
+  if (!thread->StartWithOptions(thread_options)) {
+    return false;
+  }
+  if (inherited) {
+    *inherited = GetThreadOptions(thread->GetThreadId());
+  }
+  ApplyThreadOptions(options, thread->GetThreadId());
+  return true;
+}
+
+bool ThreadConfig::Apply(ThreadRole role,
+                         base::Thread* thread,
+                         const ThreadOptions& inherited) const {
+  return ApplyThreadOptions(Get(role), thread->GetThreadId(), &inherited);
+}
+
+}  // namespace util
+}  // namespace ndash
@@ -0,0 +1,138 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef NDASH_UTIL_THREAD_CONFIG_H_
+#define NDASH_UTIL_THREAD_CONFIG_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+
+#include "base/synchronization/lock.h"
+#include "base/threading/platform_thread.h"
+
+namespace base {
+class Thread;
+}  // namespace base
+
+namespace ndash {
+namespace util {
+
+// What an internal thread is for; each role can be configured separately.
+enum class ThreadRole {
+  CONTROL,  // The player thread (DashThread)
+  LOADER,   // Loader threads for manifests and media chunks
+  NETWORK,  // CurlDataSource transfer threads
+  DRM,      // The DrmSessionManager license thread
+};
+
+// How threads of a role are scheduled and started. Fields that aren't set
+// leave the thread as it would otherwise be.
+struct ThreadOptions {
+  bool has_policy = false;
+  int policy = 0;  // SCHED_OTHER, SCHED_BATCH, SCHED_IDLE, SCHED_FIFO, ...
+  int sched_priority = 0;  // For SCHED_FIFO and SCHED_RR
+
+  bool has_nice = false;
+  int nice = 0;
+
+  // The CPUs the thread may run on, bit n for CPU n, or 0 for any.
+  uint64_t affinity_mask = 0;
+
+  // Zero for the default.
+  size_t stack_size = 0;
+};
+
+// Parses a role name: "control", "loader", "network" or "drm".
+bool ParseThreadRole(const std::string& name, ThreadRole* role);
+
+// Parses comma-separated settings, e.g.
+// "policy=fifo,priority=10,affinity=0x3,stack=256k" or "nice=-5":
+//   policy: other, batch, idle, fifo or rr
+//   priority: 1-99, for fifo and rr (1 if not given)
+//   nice: -20 to 19
+//   affinity: a CPU mask, hex with 0x or decimal
+//   stack: bytes, optionally followed by k or m
+// An empty string gives the defaults.
+bool ParseThreadOptions(const std::string& spec, ThreadOptions* options);
+
+// Returns the scheduling settings the running thread |tid| has now, with the
+// policy and nice value marked as set. CPUs past the 64 a mask can hold make
+// it any CPU.
+ThreadOptions GetThreadOptions(base::PlatformThreadId tid);
+
+// Applies the scheduling settings of |options| (all but the stack size) to
+// the running thread |tid|. If |reset_to| is given, those that aren't set are
+// put back to its settings (e.g. the ones the thread started with) rather than
+// left as they are. Settings the process isn't allowed (e.g. real-time
+// policies or negative nice values without the privilege) are logged and
+// skipped. Returns false if any were.
+bool ApplyThreadOptions(const ThreadOptions& options,
+                        base::PlatformThreadId tid,
+                        const ThreadOptions* reset_to = nullptr);
+
+// The options for each thread role. Threads are started through it so that
+// they get them; settings only affect threads started afterwards, unless
+// applied to a running one with Apply(). Safe to use from any thread.
+class ThreadConfig {
+ public:
+  // Returns the configuration used by all players.
+  static ThreadConfig* GetInstance();
+
+  ThreadConfig();
+  // Roles that aren't set here take their options from |fallback|, which must
+  // outlive this object. Used for the settings of a single player.
+  explicit ThreadConfig(const ThreadConfig* fallback);
+  ~ThreadConfig();
+
+  void Set(ThreadRole role, const ThreadOptions& options);
+  ThreadOptions Get(ThreadRole role) const;
+  // Parses |role_name| and |spec| (see ParseThreadOptions()) and sets them,
+  // also returning the role in |role|. Returns false if they don't parse.
+  bool Set(const std::string& role_name,
+           const std::string& spec,
+           ThreadRole* role);
+
+  // Starts |thread| with the stack size for |role| and applies the rest of
+  // its settings. If |inherited| is given, the settings the thread started
+  // with, before those, are stored in it for Apply(). Returns false if the
+  // thread didn't start (not if settings couldn't be applied).
+  bool StartThread(ThreadRole role,
+                   base::Thread* thread,
+                   ThreadOptions* inherited = nullptr) const;
+
+  // Applies the scheduling settings for |role| to the running |thread|,
+  // putting those that aren't set back to |inherited|, as StartThread() gave
+  // it.
+  bool Apply(ThreadRole role,
+             base::Thread* thread,
+             const ThreadOptions& inherited) const;
+
+  ThreadConfig(const ThreadConfig& other) = delete;
+  ThreadConfig& operator=(const ThreadConfig& other) = delete;
+
+ private:
+  const ThreadConfig* const fallback_ = nullptr;
+  mutable base::Lock lock_;  // Protects |options_|
+  std::map<ThreadRole, ThreadOptions> options_;
+};
+
+}  // namespace util
+}  // namespace ndash
+
+#endif  // NDASH_UTIL_THREAD_CONFIG_H_
@@ -0,0 +1,246 @@
+/*
+ * Copyright 2017 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "util/thread_config.h"
+
+#include <pthread.h>
+#include <sched.h>
+
+#include <string>
+#include <vector>
+
+#include "base/bind.h"
+#include "base/files/file_path.h"
+#include "base/files/file_util.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/string_split.h"
+#include "base/strings/string_util.h"
+#include "base/strings/stringprintf.h"
+#include "base/synchronization/waitable_event.h"
+#include "base/threading/thread.h"
+#include "gtest/gtest.h"
+
+namespace ndash {
+namespace util {
+
+namespace {
+// Returns the fields of /proc/self/task/<tid>/stat after the command name,
+// so that [0] is field 3 (the state).
+std::vector<std::string> ReadStat(base::PlatformThreadId tid) {
+  std::string stat;
+  base::ReadFileToString(
+      base::FilePath(base::StringPrintf("/proc/self/task/%d/stat", tid)),
+      &stat);
+  size_t end_of_name = stat.rfind(')');
+  if (end_of_name == std::string::npos) {
+    return std::vector<std::string>();
+  }
+  return base::SplitString(stat.substr(end_of_name + 1), " ",
+                           base::TRIM_WHITESPACE, base::SPLIT_WANT_NONEMPTY);
+}
+
+// Returns the value of |name| in /proc/self/task/<tid>/status.
+std::string ReadStatus(base::PlatformThreadId tid, const std::string& name) {
+  std::string status;
+  base::ReadFileToString(
+      base::FilePath(base::StringPrintf("/proc/self/task/%d/status", tid)),
+      &status);
+  for (const std::string& line : base::SplitString(
+           status, "\n", base::TRIM_WHITESPACE, base::SPLIT_WANT_NONEMPTY)) {
+    if (base::StartsWith(line, name + ":", base::CompareCase::SENSITIVE)) {
+      return base::TrimWhitespaceASCII(line.substr(name.size() + 1),
+                                       base::TRIM_ALL)
+          .as_string();
+    }
+  }
+  return std::string();
+}
+
+void GetStackSize(size_t* stack_size, base::WaitableEvent* done) {
+  pthread_attr_t attr;
+  if (pthread_getattr_np(pthread_self(), &attr) == 0) {
+    pthread_attr_getstacksize(&attr, stack_size);
+    pthread_attr_destroy(&attr);
+  }
+  done->Signal();
+}
+}  // namespace
+
+TEST(ThreadConfigTest, ParseThreadRole) {
+  ThreadRole role;
+  EXPECT_TRUE(ParseThreadRole("control", &role));
+  EXPECT_EQ(ThreadRole::CONTROL, role);
+  EXPECT_TRUE(ParseThreadRole("loader", &role));
+  EXPECT_EQ(ThreadRole::LOADER, role);
+  EXPECT_TRUE(ParseThreadRole("network", &role));
+  EXPECT_EQ(ThreadRole::NETWORK, role);
+  EXPECT_TRUE(ParseThreadRole("drm", &role));
+  EXPECT_EQ(ThreadRole::DRM, role);
+  EXPECT_FALSE(ParseThreadRole("ui", &role));
+}
+
+TEST(ThreadConfigTest, ParseThreadOptions) {
+  ThreadOptions options;
+  ASSERT_TRUE(ParseThreadOptions(
+      "policy=fifo, priority=10,affinity=0x3,stack=256k", &options));
+  EXPECT_TRUE(options.has_policy);
+  EXPECT_EQ(SCHED_FIFO, options.policy);
+  EXPECT_EQ(10, options.sched_priority);
+  EXPECT_FALSE(options.has_nice);
+  EXPECT_EQ(3u, options.affinity_mask);
+  EXPECT_EQ(256u * 1024, options.stack_size);
+
+  ASSERT_TRUE(ParseThreadOptions("nice=-5,affinity=12,stack=2M", &options));
+  EXPECT_FALSE(options.has_policy);
+  EXPECT_TRUE(options.has_nice);
+  EXPECT_EQ(-5, options.nice);
+  EXPECT_EQ(12u, options.affinity_mask);
+  EXPECT_EQ(2u * 1024 * 1024, options.stack_size);
+
+  // Real-time policies get the lowest priority unless told otherwise.
+  ASSERT_TRUE(ParseThreadOptions("policy=rr", &options));
+  EXPECT_EQ(SCHED_RR, options.policy);
+  EXPECT_EQ(1, options.sched_priority);
+
+  ASSERT_TRUE(ParseThreadOptions("", &options));
+  EXPECT_FALSE(options.has_policy);
+  EXPECT_FALSE(options.has_nice);
+  EXPECT_EQ(0u, options.affinity_mask);
+  EXPECT_EQ(0u, options.stack_size);
+
+  EXPECT_FALSE(ParseThreadOptions("policy=fast", &options));
+  EXPECT_FALSE(ParseThreadOptions("nice=20", &options));
+  EXPECT_FALSE(ParseThreadOptions("priority=10", &options));
+  EXPECT_FALSE(ParseThreadOptions("policy=fifo,priority=100", &options));
+  EXPECT_FALSE(ParseThreadOptions("affinity=0xg", &options));
+  EXPECT_FALSE(ParseThreadOptions("stack=big", &options));
+  EXPECT_FALSE(ParseThreadOptions("nice", &options));
+  EXPECT_FALSE(ParseThreadOptions("colour=blue", &options));
+}
+
+TEST(ThreadConfigTest, StartThread) {
+  // Pin to the first CPU this process may use.
+  cpu_set_t cpus;
+  ASSERT_EQ(0, sched_getaffinity(0, sizeof(cpus), &cpus));
+  int cpu = 0;
+  while (cpu < 64 && !CPU_ISSET(cpu, &cpus)) {
+    cpu++;
+  }
+  ASSERT_LT(cpu, 64);
+
+  // Settings that need no privilege.
+  ThreadConfig config;
+  ThreadRole role;
+  ASSERT_TRUE(config.Set(
+      "loader", base::StringPrintf("policy=batch,nice=5,affinity=0x%llx,"
+                                   "stack=1m",
+                                   1ull << cpu),
+      &role));
+  EXPECT_EQ(ThreadRole::LOADER, role);
+
+  base::Thread thread("configured");
+  ThreadOptions inherited;
+  ASSERT_TRUE(config.StartThread(ThreadRole::LOADER, &thread, &inherited));
+  base::PlatformThreadId tid = thread.GetThreadId();
+
+  // It started out like this thread.
+  ThreadOptions current = GetThreadOptions(base::PlatformThread::CurrentId());
+  EXPECT_TRUE(inherited.has_policy);
+  EXPECT_EQ(current.policy, inherited.policy);
+  EXPECT_TRUE(inherited.has_nice);
+  EXPECT_EQ(current.nice, inherited.nice);
+  EXPECT_EQ(current.affinity_mask, inherited.affinity_mask);
+
+  std::vector<std::string> stat = ReadStat(tid);
+  ASSERT_GT(stat.size(), 38u);
+  EXPECT_EQ("5", stat[16]);  // nice
+  EXPECT_EQ(base::IntToString(SCHED_BATCH), stat[38]);  // policy
+  EXPECT_EQ(base::IntToString(cpu), ReadStatus(tid, "Cpus_allowed_list"));
+
+  size_t stack_size = 0;
+  base::WaitableEvent done(true, false);
+  thread.task_runner()->PostTask(
+      FROM_HERE, base::Bind(&GetStackSize, base::Unretained(&stack_size),
+                            base::Unretained(&done)));
+  done.Wait();
+  EXPECT_GE(stack_size, 1024u * 1024);
+  EXPECT_LT(stack_size, 2u * 1024 * 1024);
+
+  // A role that isn't configured is left alone.
+  base::Thread other("unconfigured");
+  ASSERT_TRUE(config.StartThread(ThreadRole::NETWORK, &other));
+  stat = ReadStat(other.GetThreadId());
+  ASSERT_GT(stat.size(), 38u);
+  EXPECT_EQ(base::IntToString(SCHED_OTHER), stat[38]);
+
+  // Settings can change for a running thread. Those left out go back to
+  // what it started with, here a nicer batch thread.
+  ThreadOptions started_with = inherited;
+  started_with.policy = SCHED_BATCH;
+  started_with.sched_priority = 0;
+  started_with.nice = 9;
+  ASSERT_TRUE(config.Set("network", "nice=7", &role));
+  EXPECT_TRUE(config.Apply(ThreadRole::NETWORK, &other, started_with));
+  stat = ReadStat(other.GetThreadId());
+  ASSERT_GT(stat.size(), 38u);
+  EXPECT_EQ("7", stat[16]);
+  EXPECT_EQ(base::IntToString(SCHED_BATCH), stat[38]);
+  ASSERT_TRUE(config.Set("network", "", &role));
+  EXPECT_TRUE(config.Apply(ThreadRole::NETWORK, &other, started_with));
+  stat = ReadStat(other.GetThreadId());
+  ASSERT_GT(stat.size(), 38u);
+  EXPECT_EQ("9", stat[16]);
+
+  // Settings left out of a running thread's are put back to those it
+  // inherited.
+  ASSERT_TRUE(config.Set("loader", "", &role));
+  bool applied = config.Apply(ThreadRole::LOADER, &thread, inherited);
+  stat = ReadStat(tid);
+  ASSERT_GT(stat.size(), 38u);
+  EXPECT_EQ(base::IntToString(inherited.policy), stat[38]);
+  EXPECT_EQ(
+      ReadStatus(base::PlatformThread::CurrentId(), "Cpus_allowed_list"),
+      ReadStatus(tid, "Cpus_allowed_list"));
+  // Lowering the nice value takes privilege.
+  if (applied) {
+    EXPECT_EQ(base::IntToString(inherited.nice), stat[16]);
+  }
+
+  thread.Stop();
+  other.Stop();
+}
+
+TEST(ThreadConfigTest, Fallback) {
+  ThreadConfig all;
+  ThreadConfig player(&all);
+  ThreadRole role;
+  ASSERT_TRUE(all.Set("loader", "nice=5", &role));
+  ASSERT_TRUE(all.Set("network", "nice=6", &role));
+  ASSERT_TRUE(player.Set("loader", "nice=3", &role));
+
+  EXPECT_EQ(3, player.Get(ThreadRole::LOADER).nice);
+  EXPECT_EQ(5, all.Get(ThreadRole::LOADER).nice);
+  EXPECT_EQ(6, player.Get(ThreadRole::NETWORK).nice);
+
+  // An empty spec gives the player the defaults, whatever the others use.
+  ASSERT_TRUE(player.Set("network", "", &role));
+  EXPECT_FALSE(player.Get(ThreadRole::NETWORK).has_nice);
+  EXPECT_TRUE(all.Get(ThreadRole::NETWORK).has_nice);
+}
+
+}  // namespace util
+}  // namespace ndash
@@ -32,6 +32,10 @@ constexpr int64_t kMicrosPerMs = 1000;
 
 constexpr int64_t kSampleFlagSync = 0x0000001;
 constexpr int64_t kSampleFlagEncrypted = 0x0000002;
+// Other samples are, or aren't, predicted from this one. Neither is set when
+// the bitstream wasn't looked at.
+constexpr int64_t kSampleFlagReference = 0x0000004;
+constexpr int64_t kSampleFlagNonReference = 0x0000008;
 constexpr int64_t kSampleFlagDecodeOnly = 0x8000000;
 
 constexpr int32_t kResultEndOfInput = -1;
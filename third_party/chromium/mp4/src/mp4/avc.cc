@@ -73,6 +73,18 @@ bool AVC::ConvertFrameToAnnexB(int length_size,
   temp.swap(*buffer);
   buffer->reserve(temp.size() + 32);
 
+  // NALUs come in buffer order, so the subsample each one starts in is found
+  // by walking |subsamples| alongside, rather than searching from the start
+  // every time. |subsample_end| is the offset in |buffer| where the current
+  // subsample ends, taking earlier adjustments into account.
+  bool has_subsamples = subsamples && !subsamples->empty();
+  size_t subsample_index = 0;
+  size_t subsample_end = 0;
+  if (has_subsamples) {
+    subsample_end =
+        (*subsamples)[0].clear_bytes + (*subsamples)[0].cypher_bytes;
+  }
+
   size_t pos = 0;
   while (pos + length_size < temp.size()) {
     int nal_length = temp[pos];
@@ -87,12 +99,19 @@ bool AVC::ConvertFrameToAnnexB(int length_size,
     RCHECK(pos + nal_length <= temp.size());
     buffer->insert(buffer->end(), kAnnexBStartCode,
                    kAnnexBStartCode + kAnnexBStartCodeSize);
-    if (subsamples && !subsamples->empty()) {
-      uint8_t* buffer_pos = &(*(buffer->end() - kAnnexBStartCodeSize));
-      int subsample_index = FindSubsampleIndex(*buffer, subsamples, buffer_pos);
+    if (has_subsamples) {
+      size_t buffer_pos = buffer->size() - kAnnexBStartCodeSize;
+      while (subsample_end <= buffer_pos &&
+             subsample_index + 1 < subsamples->size()) {
+        ++subsample_index;
+        subsample_end += (*subsamples)[subsample_index].clear_bytes +
+                         (*subsamples)[subsample_index].cypher_bytes;
+      }
+      DCHECK_GT(subsample_end, buffer_pos);
       // We've replaced NALU size value with an AnnexB start code.
       int size_adjustment = kAnnexBStartCodeSize - length_size;
       (*subsamples)[subsample_index].clear_bytes += size_adjustment;
+      subsample_end += size_adjustment;
     }
     buffer->insert(buffer->end(), temp.begin() + pos,
                    temp.begin() + pos + nal_length);
@@ -178,6 +197,30 @@ bool AVC::IsValidAnnexB(const std::vector<uint8_t>& buffer,
   return IsValidAnnexB(&buffer[0], buffer.size(), subsamples);
 }
 
+bool AVC::IsReferenceFrame(const std::vector<uint8_t>& buffer,
+                           const std::vector<SubsampleEntry>& subsamples,
+                           bool* is_reference) {
+  if (buffer.empty())
+    return false;
+
+  H264Parser parser;
+  parser.SetEncryptedStream(&buffer[0], buffer.size(), subsamples);
+
+  H264NALU nalu;
+  while (parser.AdvanceToNextNALU(&nalu) == H264Parser::kOk) {
+    switch (nalu.nal_unit_type) {
+      case H264NALU::kNonIDRSlice:
+      case H264NALU::kSliceDataA:
+      case H264NALU::kIDRSlice:
+        *is_reference = nalu.nal_ref_idc != 0;
+        return true;
+      default:
+        break;
+    }
+  }
+  return false;
+}
+
 bool AVC::IsValidAnnexB(const uint8_t* buffer,
                         size_t size,
                         const std::vector<SubsampleEntry>& subsamples) {
@@ -55,6 +55,15 @@ class MEDIA_EXPORT AVC {
                             size_t size,
                             const std::vector<SubsampleEntry>& subsamples);
 
+  // Finds the first slice in Annex B |buffer| and sets |*is_reference| to
+  // whether other frames may be predicted from it (nal_ref_idc != 0). All the
+  // slices of a picture agree on that (Section 7.4.1 of ISO/IEC 14496-10), so
+  // the rest of |buffer| isn't looked at.
+  // Returns false if |buffer| contains no slice.
+  static bool IsReferenceFrame(const std::vector<uint8_t>& buffer,
+                               const std::vector<SubsampleEntry>& subsamples,
+                               bool* is_reference);
+
   // Given a |buffer| and |subsamples| information and |pts| pointer into the
   // |buffer| finds the index of the subsample |ptr| is pointing into.
   static int FindSubsampleIndex(const std::vector<uint8_t>& buffer,
@@ -457,5 +457,26 @@ TEST_F(AVCConversionTest, InsertParamSetsAnnexB) {
   }
 }
 
+TEST_F(AVCConversionTest, IsReferenceFrame) {
+  std::vector<uint8_t> buf;
+  std::vector<SubsampleEntry> subsamples;
+  bool is_reference = true;
+
+  StringToAnnexB("AUD SPS PPS P", &buf, &subsamples);
+  EXPECT_TRUE(AVC::IsReferenceFrame(buf, subsamples, &is_reference));
+  EXPECT_FALSE(is_reference);
+
+  // Only the first slice is looked at. Set nal_ref_idc in its header, which
+  // follows the SEI NALU and the start code.
+  StringToAnnexB("SEI P P", &buf, NULL);
+  buf[12] |= 0x60;
+  subsamples.clear();
+  EXPECT_TRUE(AVC::IsReferenceFrame(buf, subsamples, &is_reference));
+  EXPECT_TRUE(is_reference);
+
+  StringToAnnexB("AUD SPS PPS", &buf, NULL);
+  EXPECT_FALSE(AVC::IsReferenceFrame(buf, subsamples, &is_reference));
+}
+
 }  // namespace mp4
 }  // namespace media
@@ -18,6 +18,22 @@
 namespace media {
 namespace mp4 {
 
+namespace {
+
+// Reads the child |box| if present, otherwise resets it to its defaults. The
+// boxes of a fragment are parsed into the ones of the previous fragment, and
+// an absent child must not keep what that one held. Assigning a default box
+// copies it, which keeps the capacity of |box|'s vectors.
+template <typename T>
+bool ReadChildOrReset(BoxReader* reader, T* box) {
+  if (reader->HasChild(box))
+    return reader->ReadChild(box);
+  *box = T();
+  return true;
+}
+
+}  // namespace
+
 FileType::FileType() {}
 FileType::FileType(const FileType& other) = default;
 FileType::~FileType() {}
@@ -38,7 +54,6 @@ FourCC ProtectionSystemSpecificHeader::BoxType() const { return FOURCC_PSSH; }
 bool ProtectionSystemSpecificHeader::Parse(BoxReader* reader) {
   // Don't bother validating the box's contents.
   // Copy the entire box, including the header, for passing to EME as initData.
-  DCHECK(raw_box.empty());
   raw_box.assign(reader->data(), reader->data() + reader->size());
   return true;
 }
@@ -140,6 +155,7 @@ bool SampleAuxiliaryInformationSize::Parse(BoxReader* reader) {
          reader->Read4(&sample_count));
   if (default_sample_info_size == 0)
     return reader->ReadVec(&sample_info_sizes, sample_count);
+  sample_info_sizes.clear();
   return true;
 }
 
@@ -996,6 +1012,11 @@ bool TrackFragmentRun::Parse(BoxReader* reader) {
       sample_flags_present + sample_composition_time_offsets_present;
   RCHECK(reader->HasBytes(fields * sample_count));
 
+  // This may be a run of an earlier fragment being parsed into again.
+  sample_durations.clear();
+  sample_sizes.clear();
+  sample_flags.clear();
+  sample_composition_time_offsets.clear();
   if (sample_duration_present)
     sample_durations.resize(sample_count);
   if (sample_size_present)
@@ -1037,6 +1058,8 @@ bool SampleToGroup::Parse(BoxReader* reader) {
 
   if (reader->version() == 1)
     RCHECK(reader->Read4(&grouping_type_parameter));
+  else
+    grouping_type_parameter = 0;
 
   if (grouping_type != FOURCC_SEIG) {
     DLOG(WARNING) << "SampleToGroup box with grouping_type '" << grouping_type
@@ -1125,9 +1148,14 @@ bool TrackFragment::Parse(BoxReader* reader) {
          // Media Source specific: 'tfdt' required
          reader->ReadChild(&decode_time) &&
          reader->MaybeReadChildren(&runs) &&
-         reader->MaybeReadChild(&auxiliary_offset) &&
-         reader->MaybeReadChild(&auxiliary_size) &&
-         reader->MaybeReadChild(&sdtp));
+         ReadChildOrReset(reader, &auxiliary_offset) &&
+         ReadChildOrReset(reader, &auxiliary_size) &&
+         ReadChildOrReset(reader, &sdtp));
+
+  if (!reader->HasChild(&sample_group_description))
+    sample_group_description = SampleGroupDescription();
+  if (!reader->HasChild(&sample_to_group))
+    sample_to_group = SampleToGroup();
 
   // There could be multiple SampleGroupDescription and SampleToGroup boxes with
   // different grouping types. For common encryption, the relevant grouping type
@@ -150,7 +150,9 @@ class MEDIA_EXPORT BoxReader : public BufferReader {
   template<typename T> bool ReadChildren(
       std::vector<T>* children) WARN_UNUSED_RESULT;
 
-  // Read any number of children. False means error.
+  // Read any number of children. False means error. Boxes already in
+  // |children|, e.g. from the previous fragment, are parsed into again so that
+  // they keep the storage they have allocated.
   template<typename T> bool MaybeReadChildren(
       std::vector<T>* children) WARN_UNUSED_RESULT;
 
@@ -229,10 +231,8 @@ template<typename T> bool BoxReader::ReadChildren(std::vector<T>* children) {
 template<typename T>
 bool BoxReader::MaybeReadChildren(std::vector<T>* children) {
   DCHECK(scanned_);
-  DCHECK(children->empty());
 
-  children->resize(1);
-  FourCC child_type = (*children)[0].BoxType();
+  FourCC child_type = T().BoxType();
 
   ChildMap::iterator start_itr = children_.lower_bound(child_type);
   ChildMap::iterator end_itr = children_.upper_bound(child_type);
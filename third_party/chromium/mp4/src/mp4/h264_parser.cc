@@ -11,6 +11,7 @@
 #include "base/macros.h"
 #include "base/stl_util.h"
 #include "mp4/decrypt_config.h"
+#include "mp4/start_code.h"
 
 namespace media {
 
@@ -184,46 +185,40 @@ const H264SPS* H264Parser::GetSPS(int sps_id) const {
   return it->second;
 }
 
-static inline bool IsStartCode(const uint8_t* data) {
-  return data[0] == 0x00 && data[1] == 0x00 && data[2] == 0x01;
-}
-
 // static
 bool H264Parser::FindStartCode(const uint8_t* data,
                                off_t data_size,
                                off_t* offset,
                                off_t* start_code_size) {
   DCHECK_GE(data_size, 0);
-  off_t bytes_left = data_size;
-
-  while (bytes_left >= 3) {
-    if (IsStartCode(data)) {
-      // Found three-byte start code, set pointer at its beginning.
-      *offset = data_size - bytes_left;
-      *start_code_size = 3;
-
-      // If there is a zero byte before this start code,
-      // then it's actually a four-byte start code, so backtrack one byte.
-      if (*offset > 0 && *(data - 1) == 0x00) {
-        --(*offset);
-        ++(*start_code_size);
-      }
-
-      return true;
-    }
+  if (data_size < 3) {
+    // Note: there is no security issue when receiving a negative |data_size|
+    // since in this case |*offset| is 0 (valid offset).
+    *offset = 0;
+    *start_code_size = 0;
+    return false;
+  }
 
-    ++data;
-    --bytes_left;
+  size_t pos = FindStartCodePrefix(data, data_size);
+  if (pos == static_cast<size_t>(data_size)) {
+    // End of data: offset is pointing to the first byte that was not
+    // considered as a possible start of a start code.
+    *offset = data_size - 2;
+    *start_code_size = 0;
+    return false;
   }
 
-  // End of data: offset is pointing to the first byte that was not considered
-  // as a possible start of a start code.
-  // Note: there is no security issue when receiving a negative |data_size|
-  // since in this case, |bytes_left| is equal to |data_size| and thus
-  // |*offset| is equal to 0 (valid offset).
-  *offset = data_size - bytes_left;
-  *start_code_size = 0;
-  return false;
+  // Found three-byte start code, set pointer at its beginning.
+  *offset = pos;
+  *start_code_size = 3;
+
+  // If there is a zero byte before this start code,
+  // then it's actually a four-byte start code, so backtrack one byte.
+  if (pos > 0 && data[pos - 1] == 0x00) {
+    --(*offset);
+    ++(*start_code_size);
+  }
+  return true;
 }
 
 bool H264Parser::LocateNALU(off_t* nalu_size, off_t* start_code_size) {
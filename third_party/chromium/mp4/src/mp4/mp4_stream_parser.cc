@@ -29,6 +29,7 @@
 #include "mp4/es_descriptor.h"
 #include "mp4/rcheck.h"
 #include "mp4/adts_constants.h"
+#include "mp4/avc.h"
 
 namespace media {
 namespace mp4 {
@@ -47,6 +48,7 @@ MP4StreamParser::MP4StreamParser(const std::set<int>& audio_object_types,
       has_sbr_(has_sbr),
       is_audio_track_encrypted_(false),
       is_video_track_encrypted_(false),
+      classify_dependencies_(true),
       num_top_level_box_skipped_(0) {
 }
 
@@ -84,7 +86,6 @@ void MP4StreamParser::Init(
 
 void MP4StreamParser::Reset() {
   queue_.Reset();
-  runs_.reset();
   moof_head_ = 0;
   mdat_tail_ = 0;
 }
@@ -142,6 +143,7 @@ bool MP4StreamParser::Parse(const uint8_t* buf, int size) {
   if (err) {
     DLOG(ERROR) << "Error while parsing MP4";
     moov_.reset();
+    runs_.reset();
     Reset();
     ChangeState(kError);
     return false;
@@ -533,15 +535,14 @@ bool MP4StreamParser::ParseMoov(BoxReader* reader) {
 
 bool MP4StreamParser::ParseMoof(BoxReader* reader) {
   RCHECK(moov_.get());  // Must already have initialization segment
-  MovieFragment moof;
-  RCHECK(moof.Parse(reader));
+  RCHECK(moof_.Parse(reader));
   if (!runs_)
     runs_.reset(new TrackRunIterator(moov_.get(), media_log_));
-  RCHECK(runs_->Init(moof));
-  RCHECK(ComputeHighestEndOffset(moof));
+  RCHECK(runs_->Init(moof_));
+  RCHECK(ComputeHighestEndOffset(moof_));
 
-  if (!moof.pssh.empty())
-    OnEncryptedMediaInitData(moof.pssh);
+  if (!moof_.pssh.empty())
+    OnEncryptedMediaInitData(moof_.pssh);
 
   new_segment_cb_.Run();
   ChangeState(kWaitingForSampleData);
@@ -656,25 +657,36 @@ bool MP4StreamParser::EnqueueSample(BufferQueue* audio_buffers,
     subsamples = decrypt_config->subsamples();
   }
 
-  std::vector<uint8_t> frame_buf(buf, buf + runs_->sample_size());
+  frame_buf_.assign(buf, buf + runs_->sample_size());
+  StreamParserBuffer::Dependency dependency =
+      StreamParserBuffer::DEPENDENCY_UNKNOWN;
   if (video) {
     if (runs_->video_description().video_codec == kCodecH264 ||
         runs_->video_description().video_codec == kCodecHEVC) {
       DCHECK(runs_->video_description().frame_bitstream_converter);
       if (!runs_->video_description().frame_bitstream_converter->ConvertFrame(
-              &frame_buf, runs_->is_keyframe(), &subsamples)) {
+              &frame_buf_, runs_->is_keyframe(), &subsamples)) {
         MEDIA_LOG(ERROR, media_log_)
             << "Failed to prepare video sample for decode";
         *err = true;
         return false;
       }
     }
+    // Lets players shed decode load in trick play by dropping frames nothing
+    // else depends on.
+    bool is_reference;
+    if (classify_dependencies_ &&
+        runs_->video_description().video_codec == kCodecH264 &&
+        AVC::IsReferenceFrame(frame_buf_, subsamples, &is_reference)) {
+      dependency = is_reference ? StreamParserBuffer::DEPENDENCY_REFERENCE
+                                : StreamParserBuffer::DEPENDENCY_NON_REFERENCE;
+    }
   }
 
   if (audio) {
     if (ESDescriptor::IsAAC(runs_->audio_description().esds.object_type) &&
         !PrepareAACBuffer(runs_->audio_description().esds.aac,
-                          &frame_buf, &subsamples)) {
+                          &frame_buf_, &subsamples)) {
       MEDIA_LOG(ERROR, media_log_) << "Failed to prepare AAC sample for decode";
       *err = true;
       return false;
@@ -705,13 +717,14 @@ bool MP4StreamParser::EnqueueSample(BufferQueue* audio_buffers,
   // type and allow multiple tracks for same media type, if applicable. See
   // https://crbug.com/341581.
   scoped_refptr<StreamParserBuffer> stream_buf =
-      StreamParserBuffer::CopyFrom(&frame_buf[0], frame_buf.size(),
+      StreamParserBuffer::CopyFrom(&frame_buf_[0], frame_buf_.size(),
                                    runs_->is_keyframe(),
                                    buffer_type, 0);
 
   if (decrypt_config)
     stream_buf->set_decrypt_config(std::move(decrypt_config));
 
+  stream_buf->set_dependency(dependency);
   stream_buf->set_duration(runs_->duration());
   stream_buf->set_timestamp(runs_->cts());
   stream_buf->SetDecodeTimestamp(runs_->dts());
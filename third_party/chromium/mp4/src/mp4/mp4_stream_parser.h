@@ -42,6 +42,12 @@ class MEDIA_EXPORT MP4StreamParser : public StreamParser {
   void Flush() override;
   bool Parse(const uint8_t* buf, int size) override;
 
+  // Whether H.264 samples are marked as reference or non-reference frames
+  // (see StreamParserBuffer::dependency()). On by default.
+  void set_classify_dependencies(bool classify) {
+    classify_dependencies_ = classify;
+  }
+
  private:
   enum State {
     kWaitingForInit,
@@ -124,7 +130,14 @@ class MEDIA_EXPORT MP4StreamParser : public StreamParser {
   int64_t highest_end_offset_;
 
   std::unique_ptr<mp4::Movie> moov_;
+  // Kept between fragments, and through Flush(), so that each 'moof' is
+  // parsed into the boxes and runs of the previous one instead of allocating
+  // them anew.
+  mp4::MovieFragment moof_;
   std::unique_ptr<mp4::TrackRunIterator> runs_;
+  // The sample being converted for decode, kept so that its storage is
+  // reused by the next one.
+  std::vector<uint8_t> frame_buf_;
 
   bool has_audio_;
   bool has_video_;
@@ -135,6 +148,7 @@ class MEDIA_EXPORT MP4StreamParser : public StreamParser {
   bool has_sbr_;
   bool is_audio_track_encrypted_;
   bool is_video_track_encrypted_;
+  bool classify_dependencies_;
 
   // Tracks the number of MEDIA_LOGs for skipping top level boxes. Useful to
   // prevent log spam.
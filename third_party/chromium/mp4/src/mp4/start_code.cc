@@ -0,0 +1,148 @@
+// Copyright 2017 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "mp4/start_code.h"
+
+#include "base/cpu.h"
+
+#if defined(START_CODE_HAVE_SSE2)
+#include <immintrin.h>
+#endif
+
+#if defined(START_CODE_HAVE_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace media {
+
+namespace {
+
+typedef size_t (*FindFunction)(const uint8_t* data, size_t size);
+
+FindFunction SelectFindFunction() {
+#if defined(START_CODE_HAVE_SSE2)
+  if (base::CPU().has_avx2())
+    return &start_code::FindAVX2;
+  return &start_code::FindSSE2;
+#elif defined(START_CODE_HAVE_NEON)
+  return &start_code::FindNEON;
+#else
+  return &start_code::FindScalar;
+#endif
+}
+
+// Returns the position of the lowest set bit of a non-zero |mask|.
+inline int LowestBit(uint32_t mask) {
+  return __builtin_ctz(mask);
+}
+
+// Finishes a vectorized scan that stopped at |pos|, less than 2 + the vector
+// size from the end.
+inline size_t FindTail(const uint8_t* data, size_t size, size_t pos) {
+  return pos + start_code::FindScalar(data + pos, size - pos);
+}
+
+}  // namespace
+
+size_t FindStartCodePrefix(const uint8_t* data, size_t size) {
+  static const FindFunction find = SelectFindFunction();
+  return find(data, size);
+}
+
+namespace start_code {
+
+size_t FindScalar(const uint8_t* data, size_t size) {
+  // Look at the last byte of each three-byte window first: anything above 1
+  // rules out a start code beginning at any of the three positions.
+  size_t pos = 0;
+  while (pos + 2 < size) {
+    uint8_t last = data[pos + 2];
+    if (last > 1) {
+      pos += 3;
+    } else if (last == 1) {
+      if (data[pos] == 0 && data[pos + 1] == 0)
+        return pos;
+      pos += 3;
+    } else {
+      pos += data[pos + 1] == 0 ? 1 : 2;
+    }
+  }
+  return size;
+}
+
+#if defined(START_CODE_HAVE_SSE2)
+
+size_t FindSSE2(const uint8_t* data, size_t size) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i one = _mm_set1_epi8(1);
+  size_t pos = 0;
+  // Compares the 16 windows starting at |pos| at once.
+  for (; pos + 16 + 2 <= size; pos += 16) {
+    const uint8_t* p = data + pos;
+    __m128i first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    __m128i second = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 1));
+    __m128i third = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 2));
+    __m128i match = _mm_and_si128(
+        _mm_and_si128(_mm_cmpeq_epi8(first, zero),
+                      _mm_cmpeq_epi8(second, zero)),
+        _mm_cmpeq_epi8(third, one));
+    uint32_t mask = _mm_movemask_epi8(match);
+    if (mask)
+      return pos + LowestBit(mask);
+  }
+  return FindTail(data, size, pos);
+}
+
+__attribute__((target("avx2")))
+size_t FindAVX2(const uint8_t* data, size_t size) {
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i one = _mm256_set1_epi8(1);
+  size_t pos = 0;
+  for (; pos + 32 + 2 <= size; pos += 32) {
+    const uint8_t* p = data + pos;
+    __m256i first = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    __m256i second =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 1));
+    __m256i third = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 2));
+    __m256i match = _mm256_and_si256(
+        _mm256_and_si256(_mm256_cmpeq_epi8(first, zero),
+                         _mm256_cmpeq_epi8(second, zero)),
+        _mm256_cmpeq_epi8(third, one));
+    uint32_t mask = _mm256_movemask_epi8(match);
+    if (mask)
+      return pos + LowestBit(mask);
+  }
+  return FindTail(data, size, pos);
+}
+
+#endif  // defined(START_CODE_HAVE_SSE2)
+
+#if defined(START_CODE_HAVE_NEON)
+
+size_t FindNEON(const uint8_t* data, size_t size) {
+  const uint8x16_t zero = vdupq_n_u8(0);
+  const uint8x16_t one = vdupq_n_u8(1);
+  size_t pos = 0;
+  for (; pos + 16 + 2 <= size; pos += 16) {
+    const uint8_t* p = data + pos;
+    uint8x16_t match = vandq_u8(
+        vandq_u8(vceqq_u8(vld1q_u8(p), zero), vceqq_u8(vld1q_u8(p + 1), zero)),
+        vceqq_u8(vld1q_u8(p + 2), one));
+    // Each matching window is a 0xff byte; find the first.
+    uint64x2_t lanes = vreinterpretq_u64_u8(match);
+    uint64_t low = vgetq_lane_u64(lanes, 0);
+    uint64_t high = vgetq_lane_u64(lanes, 1);
+    if (low)
+      return pos + __builtin_ctzll(low) / 8;
+    if (high)
+      return pos + 8 + __builtin_ctzll(high) / 8;
+  }
+  return FindTail(data, size, pos);
+}
+
+#endif  // defined(START_CODE_HAVE_NEON)
+
+}  // namespace start_code
+
+}  // namespace media
@@ -0,0 +1,48 @@
+// Copyright 2017 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// Scanning for H.264/H.265 Annex B start codes, shared by the bitstream
+// converters and H264Parser. Runs of NAL unit payload are long and rarely
+// contain zero bytes, so the scan compares 16 or 32 bytes at a time where the
+// CPU allows.
+
+#ifndef MEDIA_FILTERS_START_CODE_H_
+#define MEDIA_FILTERS_START_CODE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "build/build_config.h"
+#include "mp4/media_export.h"
+
+namespace media {
+
+// Returns the offset in |data| of the first three-byte start code prefix
+// (0x00 0x00 0x01), or |size| if there is none. Uses the fastest of the
+// implementations below that the CPU supports.
+MEDIA_EXPORT size_t FindStartCodePrefix(const uint8_t* data, size_t size);
+
+// The implementations FindStartCodePrefix() chooses from, exposed for tests
+// and benchmarks. Each returns the same result.
+namespace start_code {
+
+MEDIA_EXPORT size_t FindScalar(const uint8_t* data, size_t size);
+
+#if defined(ARCH_CPU_X86_FAMILY) && defined(__SSE2__)
+#define START_CODE_HAVE_SSE2 1
+MEDIA_EXPORT size_t FindSSE2(const uint8_t* data, size_t size);
+// Only to be called if base::CPU().has_avx2().
+MEDIA_EXPORT size_t FindAVX2(const uint8_t* data, size_t size);
+#endif
+
+#if defined(ARCH_CPU_ARM_FAMILY) && defined(__ARM_NEON)
+#define START_CODE_HAVE_NEON 1
+MEDIA_EXPORT size_t FindNEON(const uint8_t* data, size_t size);
+#endif
+
+}  // namespace start_code
+
+}  // namespace media
+
+#endif  // MEDIA_FILTERS_START_CODE_H_
@@ -0,0 +1,106 @@
+// Copyright 2017 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "mp4/start_code.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "base/cpu.h"
+#include "base/rand_util.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace media {
+
+namespace {
+
+size_t FindNaive(const uint8_t* data, size_t size) {
+  for (size_t i = 0; i + 2 < size; ++i) {
+    if (data[i] == 0 && data[i + 1] == 0 && data[i + 2] == 1)
+      return i;
+  }
+  return size;
+}
+
+typedef size_t (*FindFunction)(const uint8_t* data, size_t size);
+
+std::vector<FindFunction> AvailableFunctions() {
+  std::vector<FindFunction> functions;
+  functions.push_back(&FindStartCodePrefix);
+  functions.push_back(&start_code::FindScalar);
+#if defined(START_CODE_HAVE_SSE2)
+  functions.push_back(&start_code::FindSSE2);
+  if (base::CPU().has_avx2())
+    functions.push_back(&start_code::FindAVX2);
+#endif
+#if defined(START_CODE_HAVE_NEON)
+  functions.push_back(&start_code::FindNEON);
+#endif
+  return functions;
+}
+
+// Checks every function against FindNaive() for every offset and length
+// within |buffer|.
+void CheckAllSpans(const std::vector<uint8_t>& buffer) {
+  std::vector<FindFunction> functions = AvailableFunctions();
+  for (size_t begin = 0; begin < buffer.size(); ++begin) {
+    for (size_t end = begin; end <= buffer.size(); ++end) {
+      const uint8_t* data = buffer.data() + begin;
+      size_t size = end - begin;
+      size_t expected = FindNaive(data, size);
+      for (size_t i = 0; i < functions.size(); ++i) {
+        ASSERT_EQ(expected, functions[i](data, size))
+            << "function " << i << " begin " << begin << " size " << size;
+      }
+    }
+  }
+}
+
+}  // namespace
+
+TEST(StartCodeTest, Empty) {
+  for (FindFunction find : AvailableFunctions()) {
+    EXPECT_EQ(0u, find(nullptr, 0));
+  }
+}
+
+TEST(StartCodeTest, SingleStartCode) {
+  // A start code at each position of a buffer longer than two vectors, with
+  // near misses around it.
+  for (size_t pos = 0; pos + 3 <= 80; ++pos) {
+    std::vector<uint8_t> buffer(80, 0x00);
+    for (size_t i = 0; i < buffer.size(); i += 2)
+      buffer[i] = 0x01;
+    buffer[pos] = 0x00;
+    buffer[pos + 1] = 0x00;
+    buffer[pos + 2] = 0x01;
+    size_t expected = FindNaive(buffer.data(), buffer.size());
+    for (FindFunction find : AvailableFunctions()) {
+      EXPECT_EQ(expected, find(buffer.data(), buffer.size())) << pos;
+    }
+  }
+}
+
+TEST(StartCodeTest, RandomBuffers) {
+  // Mostly zeros and ones so that start codes and near misses are common.
+  for (int round = 0; round < 20; ++round) {
+    std::vector<uint8_t> buffer(100);
+    for (size_t i = 0; i < buffer.size(); ++i) {
+      int r = base::RandInt(0, 15);
+      buffer[i] = r < 12 ? 0x00 : r < 14 ? 0x01 : static_cast<uint8_t>(r);
+    }
+    CheckAllSpans(buffer);
+  }
+}
+
+TEST(StartCodeTest, NoZeros) {
+  std::vector<uint8_t> buffer(100, 0xff);
+  buffer[97] = 0x00;
+  buffer[98] = 0x00;
+  CheckAllSpans(buffer);
+}
+
+}  // namespace media
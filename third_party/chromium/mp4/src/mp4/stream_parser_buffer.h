@@ -107,6 +107,14 @@ class MEDIA_EXPORT StreamParserBuffer : public DecoderBuffer {
   // Value used to signal an invalid decoder config ID.
   enum { kInvalidConfigId = -1 };
 
+  // Whether other frames are predicted from this one, where the parser could
+  // tell from the bitstream.
+  enum Dependency {
+    DEPENDENCY_UNKNOWN,
+    DEPENDENCY_REFERENCE,
+    DEPENDENCY_NON_REFERENCE,
+  };
+
   typedef DemuxerStream::Type Type;
   typedef StreamParser::TrackId TrackId;
 
@@ -185,6 +193,10 @@ class MEDIA_EXPORT StreamParserBuffer : public DecoderBuffer {
     is_duration_estimated_ = is_estimated;
   }
 
+  Dependency dependency() const { return dependency_; }
+
+  void set_dependency(Dependency dependency) { dependency_ = dependency; }
+
  private:
   StreamParserBuffer(const uint8_t* data,
                      int data_size,
@@ -202,6 +214,7 @@ class MEDIA_EXPORT StreamParserBuffer : public DecoderBuffer {
   BufferQueue splice_buffers_;
   scoped_refptr<StreamParserBuffer> preroll_buffer_;
   bool is_duration_estimated_;
+  Dependency dependency_;
 
   DISALLOW_COPY_AND_ASSIGN(StreamParserBuffer);
 };
@@ -50,7 +50,10 @@ struct TrackRunInfo {
   std::vector<CencSampleEncryptionInfoEntry> fragment_sample_encryption_info;
 
   TrackRunInfo();
+  TrackRunInfo(TrackRunInfo&& other);
   ~TrackRunInfo();
+
+  TrackRunInfo& operator=(TrackRunInfo&& other);
 };
 
 TrackRunInfo::TrackRunInfo()
@@ -63,7 +66,9 @@ TrackRunInfo::TrackRunInfo()
       aux_info_default_size(-1),
       aux_info_total_size(-1) {
 }
+TrackRunInfo::TrackRunInfo(TrackRunInfo&& other) = default;
 TrackRunInfo::~TrackRunInfo() {}
+TrackRunInfo& TrackRunInfo::operator=(TrackRunInfo&& other) = default;
 
 base::TimeDelta TimeDeltaFromRational(int64_t numer, int64_t denom) {
   // To avoid overflow, split the following calculation:
@@ -249,7 +254,9 @@ class CompareMinTrackRunDataOffset {
 };
 
 bool TrackRunIterator::Init(const MovieFragment& moof) {
-  runs_.clear();
+  // The runs of the previous fragment are overwritten rather than freed, so
+  // that their sample vectors are only reallocated when a run grows.
+  size_t run_count = 0;
 
   for (size_t i = 0; i < moof.tracks.size(); i++) {
     const TrackFragment& traf = moof.tracks[i];
@@ -313,7 +320,9 @@ bool TrackRunIterator::Init(const MovieFragment& moof) {
     int sample_count_sum = 0;
     for (size_t j = 0; j < traf.runs.size(); j++) {
       const TrackFragmentRun& trun = traf.runs[j];
-      TrackRunInfo tri;
+      if (run_count == runs_.size())
+        runs_.emplace_back();
+      TrackRunInfo& tri = runs_[run_count++];
       tri.track_id = traf.header.track_id;
       tri.timescale = trak->media.header.timescale;
       tri.start_dts = run_start_dts;
@@ -357,9 +366,11 @@ bool TrackRunIterator::Init(const MovieFragment& moof) {
         if (tri.aux_info_default_size == 0) {
           const std::vector<uint8_t>& sizes =
               traf.auxiliary_size.sample_info_sizes;
-          tri.aux_info_sizes.insert(
-              tri.aux_info_sizes.begin(), sizes.begin() + sample_count_sum,
+          tri.aux_info_sizes.assign(
+              sizes.begin() + sample_count_sum,
               sizes.begin() + sample_count_sum + trun.sample_count);
+        } else {
+          tri.aux_info_sizes.clear();
         }
 
         // If the default info size is positive, find the total size of the aux
@@ -376,6 +387,8 @@ bool TrackRunIterator::Init(const MovieFragment& moof) {
         }
       } else {
         tri.aux_info_start_offset = -1;
+        tri.aux_info_default_size = -1;
+        tri.aux_info_sizes.clear();
         tri.aux_info_total_size = 0;
       }
 
@@ -402,6 +415,7 @@ bool TrackRunIterator::Init(const MovieFragment& moof) {
           RCHECK(GetSampleEncryptionInfoEntry(tri, index));
         is_sample_to_group_valid = sample_to_group_itr.Advance();
       }
+      tri.sample_encryption_entries.clear();
       if (sample_encrytion_entries_count > 0) {
         RCHECK(sample_encrytion_entries_count >=
                sample_count_sum + trun.sample_count);
@@ -416,13 +430,13 @@ bool TrackRunIterator::Init(const MovieFragment& moof) {
               traf.sample_encryption.use_subsample_encryption));
         }
       }
-      runs_.push_back(tri);
       sample_count_sum += trun.sample_count;
     }
 
     // We should have iterated through all samples in SampleToGroup Box.
     RCHECK(!sample_to_group_itr.IsValid());
   }
+  runs_.resize(run_count);
 
   std::sort(runs_.begin(), runs_.end(), CompareMinTrackRunDataOffset());
   run_itr_ = runs_.begin();
@@ -677,6 +677,39 @@ TEST_F(TrackRunIteratorTest, DecryptConfigTestWithAuxInfo) {
   EXPECT_EQ(config->subsamples()[1].cypher_bytes, 4u);
 }
 
+TEST_F(TrackRunIteratorTest, ReinitTest) {
+  AddEncryption(&moov_.tracks[1]);
+  iter_.reset(new TrackRunIterator(&moov_, media_log_));
+
+  MovieFragment moof = CreateFragment();
+  AddAuxInfoHeaders(50, &moof.tracks[1]);
+  ASSERT_TRUE(iter_->Init(moof));
+  EXPECT_EQ(iter_->track_id(), 2u);
+  EXPECT_TRUE(iter_->CacheAuxInfo(kAuxInfo, arraysize(kAuxInfo)));
+
+  // The runs of the next fragment are initialized in place of these; nothing
+  // of the third run or the cached aux info may remain.
+  MovieFragment next_moof = CreateFragment();
+  next_moof.tracks[0].runs.resize(1);
+  ASSERT_TRUE(iter_->Init(next_moof));
+  EXPECT_EQ(iter_->track_id(), 1u);
+  EXPECT_EQ(iter_->sample_offset(), 100);
+  iter_->AdvanceRun();
+  EXPECT_EQ(iter_->track_id(), 2u);
+  EXPECT_EQ(iter_->aux_info_size(), 0);
+  EXPECT_FALSE(iter_->AuxInfoNeedsToBeCached());
+  int samples = 0;
+  for (; iter_->IsSampleValid(); iter_->AdvanceSample())
+    samples++;
+  EXPECT_EQ(samples, 10);
+  iter_->AdvanceRun();
+  EXPECT_FALSE(iter_->IsRunValid());
+
+  ASSERT_TRUE(iter_->Init(moof));
+  EXPECT_EQ(iter_->track_id(), 2u);
+  EXPECT_TRUE(iter_->AuxInfoNeedsToBeCached());
+}
+
 TEST_F(TrackRunIteratorTest, CencSampleGroupTest) {
   MovieFragment moof = CreateFragment();
 